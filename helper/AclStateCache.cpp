@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "AclStateCache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+static const quint32 CACHE_MAGIC = 0x43504143;  // "CPAC"
+static const quint32 CACHE_VERSION = 1;
+static const qint64 CACHE_MAX_AGE_SECS = 7 * 24 * 60 * 60;
+
+AclStateCache::AclStateCache(const QString &directory)
+    : m_directory(directory)
+{
+}
+
+void AclStateCache::setDirectory(const QString &directory)
+{
+    m_directory = directory;
+}
+
+QString AclStateCache::recordPath(const QString &path, uid_t uid) const
+{
+    const QByteArray key = QByteArray::number(uid) + ':' + QDir::cleanPath(path).toUtf8();
+    const QByteArray hash = QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex();
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(hash) + QStringLiteral(".acl");
+}
+
+DirectoryFingerprints AclStateCache::load(const QString &path, uid_t uid) const
+{
+    QFile file(recordPath(path, uid));
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) {
+        return {};
+    }
+
+    uchar *data = file.map(0, file.size());
+    if (!data) {
+        return {};
+    }
+
+    const QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(data), file.size());
+    QDataStream in(bytes);
+    in.setVersion(QDataStream::Qt_6_5);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString storedPath;
+    quint32 storedUid = 0;
+    qint64 preparedAt = 0;
+    DirectoryFingerprints fingerprints;
+    in >> magic >> version >> storedPath >> storedUid >> preparedAt >> fingerprints;
+    file.unmap(data);
+
+    if (in.status() != QDataStream::Ok || magic != CACHE_MAGIC || version != CACHE_VERSION
+        || storedPath != QDir::cleanPath(path) || storedUid != uid) {
+        qWarning() << "AclStateCache: Ignoring unusable record for" << path;
+        return {};
+    }
+
+    if (QDateTime::currentSecsSinceEpoch() - preparedAt > CACHE_MAX_AGE_SECS) {
+        return {};
+    }
+
+    return fingerprints;
+}
+
+bool AclStateCache::store(const QString &path, uid_t uid, const DirectoryFingerprints &fingerprints) const
+{
+    if (!QDir().mkpath(m_directory)) {
+        return false;
+    }
+
+    QSaveFile file(recordPath(path, uid));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_5);
+    out << CACHE_MAGIC << CACHE_VERSION << QDir::cleanPath(path) << quint32(uid)
+        << QDateTime::currentSecsSinceEpoch() << fingerprints;
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+void AclStateCache::remove(const QString &path, uid_t uid) const
+{
+    QFile::remove(recordPath(path, uid));
+}
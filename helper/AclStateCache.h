@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QString>
+
+#include "SystemOps.h"
+
+/**
+ * AclStateCache - On-disk record of trees the helper already granted ACLs on
+ *
+ * One small file per (root path, uid) under the state directory holds the
+ * directory fingerprints seen by the last successful recursive grant and
+ * when it ran. Feeding them back into SystemOps::grantUserAcl() lets the
+ * walk skip the entries of every directory that hasn't changed since, so
+ * only newly installed games are touched. Records expire after a week to
+ * bound how long an externally stripped ACL goes unnoticed.
+ *
+ * Files are read through a memory mapping and replaced atomically.
+ */
+class AclStateCache
+{
+public:
+    explicit AclStateCache(const QString &directory = QStringLiteral("/var/lib/couchplay/acl"));
+
+    QString directory() const { return m_directory; }
+    void setDirectory(const QString &directory);
+
+    /**
+     * Fingerprints recorded for @p path and @p uid
+     * @return Empty when there is no usable record (missing, stale, corrupt)
+     */
+    DirectoryFingerprints load(const QString &path, uid_t uid) const;
+
+    /**
+     * Record the fingerprints of a successful grant
+     * @return false if the record could not be written (the cache is best effort)
+     */
+    bool store(const QString &path, uid_t uid, const DirectoryFingerprints &fingerprints) const;
+
+    /** Forget the record for @p path and @p uid */
+    void remove(const QString &path, uid_t uid) const;
+
+private:
+    QString recordPath(const QString &path, uid_t uid) const;
+
+    QString m_directory;
+};
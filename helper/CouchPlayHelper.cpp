@@ -2,16 +2,27 @@
 // SPDX-FileCopyrightText: 2025 CouchPlay Contributors
 
 #include "CouchPlayHelper.h"
+#include "DrmFdinfo.h"
+#include "HelperMetrics.h"
+#include "InputRouter.h"
+#include "InstanceSupervisor.h"
+#include "PrepareInstanceSpec.h"
 #include "SystemOps.h"
 
+#include <QCryptographicHash>
 #include <QDBusConnection>
+#include <QDBusConnectionInterface>
 #include <QDBusMessage>
+#include <QDBusServiceWatcher>
+#include <QDBusUnixFileDescriptor>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QProcess>
 #include <QRegularExpression>
-#include <QThread>
+#include <QSaveFile>
+#include <QTimer>
 #include <QDebug>
 
 #include <unistd.h>
@@ -31,18 +42,93 @@ static const QString ACTION_ENABLE_LINGER = QStringLiteral("io.github.hikaps.cou
 static const QString ACTION_WAYLAND_ACCESS = QStringLiteral("io.github.hikaps.couchplay.setup-wayland-access");
 static const QString ACTION_LAUNCH_INSTANCE = QStringLiteral("io.github.hikaps.couchplay.launch-instance");
 static const QString ACTION_MANAGE_MOUNTS = QStringLiteral("io.github.hikaps.couchplay.manage-mounts");
+static const QString ACTION_PREPARE_INSTANCE = QStringLiteral("io.github.hikaps.couchplay.prepare-instance");
+static const QString ACTION_START_SESSION = QStringLiteral("io.github.hikaps.couchplay.start-session");
+
+// What AuthorizeSession() grants, the actions start-session implies
+static const QStringList SESSION_ACTIONS = {
+    ACTION_DEVICE_OWNER, ACTION_WAYLAND_ACCESS, ACTION_LAUNCH_INSTANCE, ACTION_MANAGE_MOUNTS, ACTION_PREPARE_INSTANCE,
+};
 
 // couchplay group name for managed users
 static const QString COUCHPLAY_GROUP = QStringLiteral("couchplay");
 
+// Extra group of ephemeral players, see CreateEphemeralUser()
+static const QString GUEST_GROUP = QStringLiteral("couchplay-guest");
+
+// Where udev looks for data/udev/00-couchplay-router.rules, see applyDeviceRoute()
+static const QStringList ROUTER_RULE_PATHS = {
+    QStringLiteral("/etc/udev/rules.d/00-couchplay-router.rules"),
+    QStringLiteral("/run/udev/rules.d/00-couchplay-router.rules"),
+    QStringLiteral("/usr/lib/udev/rules.d/00-couchplay-router.rules"),
+    QStringLiteral("/lib/udev/rules.d/00-couchplay-router.rules"),
+};
+
 CouchPlayHelper::CouchPlayHelper(SystemOps *ops, QObject *parent)
     : QObject(parent)
     , m_ops(ops ? ops : new RealSystemOps(this))
+    , m_supervisor(new InstanceSupervisor(m_ops, this))
+{
+    connect(m_supervisor, &InstanceSupervisor::exited, this,
+            [this](qint64 pid, int status, qint64 runtimeMs) {
+        m_launchedUnits.remove(pid);
+        m_instanceOwners.remove(pid);
+        qDebug() << "Instance" << pid << "exited with status" << status << "after" << runtimeMs << "ms";
+        Q_EMIT InstanceExited(pid, status, runtimeMs);
+    });
+    m_grantClock.start();
+}
+
+void CouchPlayHelper::setAclCacheDirectory(const QString &directory)
+{
+    m_aclCache.setDirectory(directory);
+}
+
+void CouchPlayHelper::setTemplateDirectory(const QString &directory)
+{
+    m_templateHome = directory;
+}
+
+void CouchPlayHelper::setMetricsFile(const QString &path)
+{
+    m_metricsFile = path;
+    if (path.isEmpty()) {
+        delete m_metricsTimer;
+        m_metricsTimer = nullptr;
+        return;
+    }
+
+    if (!m_metricsTimer) {
+        m_metricsTimer = new QTimer(this);
+        m_metricsTimer->setInterval(METRICS_INTERVAL_MS);
+        connect(m_metricsTimer, &QTimer::timeout, this, &CouchPlayHelper::writeMetricsFile);
+        m_metricsTimer->start();
+    }
+    writeMetricsFile();
+}
+
+bool CouchPlayHelper::writeMetricsFile()
 {
+    if (m_metricsFile.isEmpty()) {
+        return false;
+    }
+
+    // Renamed into place, so a scrape never reads half a file
+    QSaveFile file(m_metricsFile);
+    if (!file.open(QIODevice::WriteOnly) || file.write(m_metrics.toPrometheus(metricsGauges())) < 0
+        || !file.commit()) {
+        qWarning() << "Cannot write metrics to" << m_metricsFile << ":" << file.errorString();
+        return false;
+    }
+    return true;
 }
 
 CouchPlayHelper::~CouchPlayHelper()
 {
+    // Steps of user deletions still running use m_ops
+    m_teardownPool.clear();
+    m_teardownPool.waitForDone();
+
     // Clean up: remove runtime access for all compositor UIDs
     for (uint uid : m_runtimeAccessSetForUid) {
         QString runtimeDir = QStringLiteral("/run/user/%1").arg(uid);
@@ -52,9 +138,9 @@ CouchPlayHelper::~CouchPlayHelper()
         auto removeAcl = [&](const QString &path) {
             if (!m_ops->fileExists(path)) return;
             QProcess *proc = m_ops->createProcess();
-            m_ops->startProcess(proc, QStringLiteral("setfacl"),
+            startProcess(proc, QStringLiteral("setfacl"),
                 {QStringLiteral("-x"), QStringLiteral("g:%1").arg(group), path});
-            m_ops->waitForFinished(proc, 5000);
+            waitForFinished(proc, 5000);
             delete proc;
         };
         
@@ -76,24 +162,10 @@ CouchPlayHelper::~CouchPlayHelper()
     m_runtimeAccessSetForUid.clear();
 
     // Clean up: unmount all shared directories
-    if (!m_activeMounts.isEmpty()) {
-        for (const QString &username : m_activeMounts.keys()) {
-            for (const MountInfo &mount : m_activeMounts[username]) {
-                QProcess *umountProcess = m_ops->createProcess();
-                m_ops->startProcess(umountProcess, QStringLiteral("umount"), {mount.target});
-                m_ops->waitForFinished(umountProcess, 5000);
-                if (m_ops->processExitCode(umountProcess) != 0) {
-                    // Try lazy unmount
-                    QProcess *lazyProcess = m_ops->createProcess();
-                    m_ops->startProcess(lazyProcess, QStringLiteral("umount"), {QStringLiteral("-l"), mount.target});
-                    m_ops->waitForFinished(lazyProcess, 5000);
-                    delete lazyProcess;
-                }
-                delete umountProcess;
-            }
-        }
-        m_activeMounts.clear();
+    for (const QList<MountInfo> &mounts : std::as_const(m_activeMounts)) {
+        unmountAll(mounts);
     }
+    m_activeMounts.clear();
 
     // Clean up: stop all launched processes
     for (auto it = m_launchedProcesses.begin(); it != m_launchedProcesses.end(); ++it) {
@@ -113,10 +185,15 @@ CouchPlayHelper::~CouchPlayHelper()
     if (!m_modifiedDevices.isEmpty()) {
         ResetAllDevices();
     }
+
+    // Clean up: release routed devices (ungrab, destroy virtual devices)
+    delete m_inputRouter;
+    m_inputRouter = nullptr;
 }
 
 bool CouchPlayHelper::ChangeDeviceOwner(const QString &devicePath, uint uid)
 {
+    const HandlerScope handler(this, "ChangeDeviceOwner");
     // Validate input
     if (!isValidDevicePath(devicePath)) {
         sendErrorReply(QDBusError::InvalidArgs, 
@@ -139,20 +216,29 @@ bool CouchPlayHelper::ChangeDeviceOwner(const QString &devicePath, uint uid)
         return false;
     }
 
+    QString error;
+    if (!applyDeviceOwner(devicePath, uid, pw->pw_gid, error)) {
+        sendErrorReply(QDBusError::Failed, error);
+        return false;
+    }
+
+    return true;
+}
+
+bool CouchPlayHelper::applyDeviceOwner(const QString &devicePath, uint uid, gid_t gid, QString &error)
+{
     // Change ownership
-    if (m_ops->chown(devicePath, uid, pw->pw_gid) != 0) {
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("Failed to change ownership of %1: %2")
-                .arg(devicePath, QString::fromLocal8Bit(strerror(errno))));
+    if (m_ops->chown(devicePath, uid, gid) != 0) {
+        error = QStringLiteral("Failed to change ownership of %1: %2")
+                    .arg(devicePath, QString::fromLocal8Bit(strerror(errno)));
         return false;
     }
 
     // Set permissions to 0600 (owner read/write only) for input isolation
     // This ensures only the assigned user can read the device, not the group
     if (m_ops->chmod(devicePath, 0600) != 0) {
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("Failed to set permissions on %1: %2")
-                .arg(devicePath, QString::fromLocal8Bit(strerror(errno))));
+        error = QStringLiteral("Failed to set permissions on %1: %2")
+                    .arg(devicePath, QString::fromLocal8Bit(strerror(errno)));
         return false;
     }
 
@@ -164,8 +250,114 @@ bool CouchPlayHelper::ChangeDeviceOwner(const QString &devicePath, uint uid)
     return true;
 }
 
+QString CouchPlayHelper::applyDeviceRoute(const QString &devicePath, uint uid, gid_t gid, QString &error)
+{
+    // Without the rule the host compositor would take every virtual device as its own input
+    bool ruleInstalled = false;
+    for (const QString &path : ROUTER_RULE_PATHS) {
+        ruleInstalled = ruleInstalled || m_ops->fileExists(path);
+    }
+    if (!ruleInstalled) {
+        qWarning() << "RouteDevice: udev rule 00-couchplay-router.rules is not installed, not routing" << devicePath;
+        error = QStringLiteral("The udev rule for routed devices is not installed. "
+                               "Please run: sudo ./scripts/install-helper.sh install");
+        return QString();
+    }
+
+    if (!m_inputRouter) {
+        m_inputRouter = m_ops->createInputRouter(this);
+        if (!m_inputRouter) {
+            error = QStringLiteral("Input routing is not available");
+            return QString();
+        }
+    }
+
+    // Routing a virtual device would feed it back into itself
+    if (m_inputRouter->isVirtualNode(devicePath)) {
+        error = QStringLiteral("Cannot route a CouchPlay virtual device: %1").arg(devicePath);
+        return QString();
+    }
+
+    return m_inputRouter->route(devicePath, uid, gid, error);
+}
+
+QString CouchPlayHelper::RouteDevice(const QString &devicePath, uint uid)
+{
+    const HandlerScope handler(this, "RouteDevice");
+    if (!isValidDevicePath(devicePath)) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("Invalid device path: %1").arg(devicePath));
+        return QString();
+    }
+
+    if (!checkAuthorization(ACTION_DEVICE_OWNER)) {
+        sendErrorReply(QDBusError::AccessDenied,
+            QStringLiteral("Not authorized to change device ownership"));
+        return QString();
+    }
+
+    struct passwd *pw = m_ops->getpwuid(uid);
+    if (!pw) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("User with UID %1 does not exist").arg(uid));
+        return QString();
+    }
+
+    QString error;
+    const QString node = applyDeviceRoute(devicePath, uid, pw->pw_gid, error);
+    if (node.isEmpty()) {
+        sendErrorReply(QDBusError::Failed, error);
+    }
+    return node;
+}
+
+bool CouchPlayHelper::UnrouteDevice(const QString &devicePath)
+{
+    const HandlerScope handler(this, "UnrouteDevice");
+    if (!devicePath.startsWith(QStringLiteral("/dev/input/")) || devicePath.contains(QStringLiteral(".."))) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("Invalid device path: %1").arg(devicePath));
+        return false;
+    }
+
+    if (!checkAuthorization(ACTION_DEVICE_OWNER)) {
+        sendErrorReply(QDBusError::AccessDenied,
+            QStringLiteral("Not authorized to change device ownership"));
+        return false;
+    }
+
+    return m_inputRouter && m_inputRouter->unroute(devicePath);
+}
+
+int CouchPlayHelper::StopInputRouting()
+{
+    const HandlerScope handler(this, "StopInputRouting");
+    // No auth check: only releases devices, like ResetAllDevices()
+    return m_inputRouter ? m_inputRouter->clear() : 0;
+}
+
+QVariantMap CouchPlayHelper::GetInputRouterStats()
+{
+    if (!m_inputRouter) {
+        return {{QStringLiteral("devices"), 0}, {QStringLiteral("events"), quint64(0)}};
+    }
+    return m_inputRouter->stats();
+}
+
+bool CouchPlayHelper::restoreDevice(const QString &devicePath, gid_t inputGid)
+{
+    // Reset to root:input with 0660 permissions
+    if (m_ops->chown(devicePath, 0, inputGid) == 0 &&
+        m_ops->chmod(devicePath, 0660) == 0) {
+        m_modifiedDevices.removeAll(devicePath);
+        return true;
+    }
+    return false;
+}
+
 int CouchPlayHelper::ChangeDeviceOwnerBatch(const QStringList &devicePaths, uint uid)
 {
+    const HandlerScope handler(this, "ChangeDeviceOwnerBatch");
     int successCount = 0;
     for (const QString &path : devicePaths) {
         if (ChangeDeviceOwner(path, uid)) {
@@ -177,6 +369,7 @@ int CouchPlayHelper::ChangeDeviceOwnerBatch(const QStringList &devicePaths, uint
 
 bool CouchPlayHelper::ResetDeviceOwner(const QString &devicePath)
 {
+    const HandlerScope handler(this, "ResetDeviceOwner");
     if (!isValidDevicePath(devicePath)) {
         sendErrorReply(QDBusError::InvalidArgs, 
             QStringLiteral("Invalid device path: %1").arg(devicePath));
@@ -213,6 +406,7 @@ bool CouchPlayHelper::ResetDeviceOwner(const QString &devicePath)
 
 int CouchPlayHelper::ResetAllDevices()
 {
+    const HandlerScope handler(this, "ResetAllDevices");
     int successCount = 0;
     QStringList devices = m_modifiedDevices; // Copy since we modify during iteration
     
@@ -222,11 +416,8 @@ int CouchPlayHelper::ResetAllDevices()
 
     for (const QString &path : devices) {
         // Direct reset without auth check for cleanup scenarios
-        // Reset to root:input with 0660 permissions
-        if (m_ops->chown(path, 0, inputGid) == 0 &&
-            m_ops->chmod(path, 0660) == 0) {
+        if (restoreDevice(path, inputGid)) {
             successCount++;
-            m_modifiedDevices.removeAll(path);
         }
     }
     
@@ -235,6 +426,7 @@ int CouchPlayHelper::ResetAllDevices()
 
 uint CouchPlayHelper::CreateUser(const QString &username, const QString &fullName)
 {
+    const HandlerScope handler(this, "CreateUser");
     // Validate username (alphanumeric, lowercase, starts with letter)
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -256,32 +448,167 @@ uint CouchPlayHelper::CreateUser(const QString &username, const QString &fullNam
         return 0;
     }
 
-    // Ensure couchplay group exists (create if needed)
-    QProcess *groupProcess = m_ops->createProcess();
-    m_ops->startProcess(groupProcess, QStringLiteral("groupadd"), {QStringLiteral("-f"), COUCHPLAY_GROUP});
-    m_ops->waitForFinished(groupProcess, 10000);
-    delete groupProcess;
-    // -f flag means no error if group exists, so we don't check exit code
+    QString error;
+    const uint uid = addUser(username, fullName, {}, true, error);
+    if (uid == 0) {
+        sendErrorReply(QDBusError::Failed, error);
+        return 0;
+    }
+
+    qDebug() << "Created user" << username << "with UID" << uid;
+    return uid;
+}
+
+uint CouchPlayHelper::CreateEphemeralUser(const QString &username, const QString &fullName)
+{
+    const HandlerScope handler(this, "CreateEphemeralUser");
+    static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
+    if (!validUsername.match(username).hasMatch()) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("Invalid username format"));
+        return 0;
+    }
+
+    if (!checkAuthorization(ACTION_CREATE_USER)) {
+        sendErrorReply(QDBusError::AccessDenied,
+            QStringLiteral("Not authorized to create users"));
+        return 0;
+    }
+
+    if (userExists(username)) {
+        sendErrorReply(QDBusError::Failed,
+            QStringLiteral("User '%1' already exists").arg(username));
+        return 0;
+    }
+
+    if (!m_ops->isDirectory(m_templateHome)) {
+        sendErrorReply(QDBusError::Failed,
+            QStringLiteral("No player template saved yet"));
+        return 0;
+    }
+
+    // The home comes from the template instead of /etc/skel
+    QString error;
+    const uint uid = addUser(username, fullName, {GUEST_GROUP}, false, error);
+    if (uid == 0) {
+        sendErrorReply(QDBusError::Failed, error);
+        return 0;
+    }
+
+    struct passwd *pw = m_ops->getpwnam(username.toLocal8Bit().constData());
+    const QString home = pw ? QString::fromLocal8Bit(pw->pw_dir) : QString();
+    const gid_t gid = pw ? pw->pw_gid : 0;
+    QElapsedTimer timer;
+    timer.start();
+    FileTransfer transfer;
+    transfer.error = QStringLiteral("No home directory");
+    if (!home.isEmpty()) {
+        transfer = m_ops->seedDirectory(m_templateHome, home, uid, gid);
+    }
+    if (!transfer.success) {
+        // seedDirectory() leaves no half-made home behind; the account goes too
+        QProcess *process = m_ops->createProcess();
+        startProcess(process, QStringLiteral("userdel"), {username});
+        waitForFinished(process, 30000);
+        delete process;
+        sendErrorReply(QDBusError::Failed,
+            QStringLiteral("Failed to clone the player template: %1").arg(transfer.error));
+        return 0;
+    }
+
+    qDebug() << "Created ephemeral user" << username << "with UID" << uid << "from"
+             << transfer.bytes << "template bytes in" << timer.elapsed() << "ms";
+    return uid;
+}
+
+bool CouchPlayHelper::SaveUserTemplate(const QString &username)
+{
+    const HandlerScope handler(this, "SaveUserTemplate");
+    static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
+    if (!validUsername.match(username).hasMatch()) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("Invalid username format"));
+        return false;
+    }
+
+    if (!checkAuthorization(ACTION_CREATE_USER)) {
+        sendErrorReply(QDBusError::AccessDenied,
+            QStringLiteral("Not authorized to create users"));
+        return false;
+    }
+
+    // Only CouchPlay's own players: the template is readable by every guest
+    if (!userExists(username) || !IsInCouchPlayGroup(username)) {
+        sendErrorReply(QDBusError::AccessDenied,
+            QStringLiteral("User '%1' is not a CouchPlay user").arg(username));
+        return false;
+    }
+
+    // Built next to the current template, which is only replaced once complete
+    const QString staging = m_templateHome + QStringLiteral(".new");
+    const QString previous = m_templateHome + QStringLiteral(".old");
+    QDir(staging).removeRecursively();
+    QDir(previous).removeRecursively();
+    m_ops->mkpath(QFileInfo(m_templateHome).path());
+
+    const FileTransfer transfer = m_ops->seedDirectory(getUserHome(username), staging, 0, 0);
+    if (!transfer.success) {
+        sendErrorReply(QDBusError::Failed,
+            QStringLiteral("Failed to save the player template: %1").arg(transfer.error));
+        return false;
+    }
+
+    const bool hadTemplate = QFileInfo::exists(m_templateHome);
+    if ((hadTemplate && !QDir().rename(m_templateHome, previous)) || !QDir().rename(staging, m_templateHome)) {
+        if (hadTemplate && !QFileInfo::exists(m_templateHome)) {
+            QDir().rename(previous, m_templateHome);
+        }
+        QDir(staging).removeRecursively();
+        sendErrorReply(QDBusError::Failed,
+            QStringLiteral("Failed to replace the player template"));
+        return false;
+    }
+    QDir(previous).removeRecursively();
+
+    qDebug() << "Saved player template from" << username << "(" << transfer.bytes << "bytes)";
+    return true;
+}
+
+bool CouchPlayHelper::HasUserTemplate()
+{
+    return m_ops->isDirectory(m_templateHome);
+}
+
+uint CouchPlayHelper::addUser(const QString &username, const QString &fullName, const QStringList &extraGroups,
+                              bool createHome, QString &error)
+{
+    // Ensure the groups exist (create if needed); -f means no error if one
+    // does, so the exit code isn't checked
+    for (const QString &group : QStringList{COUCHPLAY_GROUP} + extraGroups) {
+        QProcess *groupProcess = m_ops->createProcess();
+        startProcess(groupProcess, QStringLiteral("groupadd"), {QStringLiteral("-f"), group});
+        waitForFinished(groupProcess, 10000);
+        delete groupProcess;
+    }
 
     // Create user with useradd
     QProcess *process = m_ops->createProcess();
     QStringList args;
-    args << QStringLiteral("-m")  // Create home directory
+    args << (createHome ? QStringLiteral("-m") : QStringLiteral("-M"))  // Create home directory or not
          << QStringLiteral("-c") << fullName
          << QStringLiteral("-s") << QStringLiteral("/bin/bash");
 
     // Add supplementary groups: input (for gamepad access) and couchplay (for management)
-    args << QStringLiteral("-G") << QStringLiteral("input,") + COUCHPLAY_GROUP;
+    args << QStringLiteral("-G") << (QStringList{QStringLiteral("input"), COUCHPLAY_GROUP} + extraGroups).join(QLatin1Char(','));
 
     args << username;
 
-    m_ops->startProcess(process, QStringLiteral("useradd"), args);
-    m_ops->waitForFinished(process, 30000);
+    startProcess(process, QStringLiteral("useradd"), args);
+    waitForFinished(process, 30000);
 
     if (m_ops->processExitCode(process) != 0) {
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("Failed to create user: %1")
-                .arg(QString::fromLocal8Bit(m_ops->readStandardError(process))));
+        error = QStringLiteral("Failed to create user: %1")
+                    .arg(QString::fromLocal8Bit(m_ops->readStandardError(process)));
         delete process;
         return 0;
     }
@@ -290,26 +617,18 @@ uint CouchPlayHelper::CreateUser(const QString &username, const QString &fullNam
     // Get the new user's UID
     uint uid = getUserUid(username);
     if (uid == 0) {
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("User created but could not retrieve UID"));
+        error = QStringLiteral("User created but could not retrieve UID");
         return 0;
     }
 
     // Enable linger for the new user so their systemd user session starts at boot
     // This is required for machinectl shell to work properly
-    QProcess *lingerProcess = m_ops->createProcess();
-    m_ops->startProcess(lingerProcess, QStringLiteral("loginctl"),
-        {QStringLiteral("enable-linger"), username});
-    m_ops->waitForFinished(lingerProcess, 30000);
-
-    if (m_ops->processExitCode(lingerProcess) != 0) {
-        qWarning() << "Failed to enable linger for" << username
-                   << ":" << QString::fromLocal8Bit(m_ops->readStandardError(lingerProcess));
+    QString lingerError;
+    if (!applyLinger(username, lingerError)) {
+        qWarning() << "Failed to enable linger for" << username << ":" << lingerError;
         // Don't fail user creation, just warn - linger can be enabled later
     }
-    delete lingerProcess;
 
-    qDebug() << "Created user" << username << "with UID" << uid;
     return uid;
 }
 
@@ -363,6 +682,7 @@ bool CouchPlayHelper::IsInCouchPlayGroup(const QString &username)
 
 bool CouchPlayHelper::DeleteUser(const QString &username, bool removeHome)
 {
+    const HandlerScope handler(this, "DeleteUser");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -391,100 +711,143 @@ bool CouchPlayHelper::DeleteUser(const QString &username, bool removeHome)
         return false;
     }
 
+    if (m_deletions.contains(username)) {
+        sendErrorReply(QDBusError::Failed,
+            QStringLiteral("User '%1' is already being deleted").arg(username));
+        return false;
+    }
+
     // Get the user's UID before deletion (needed for IPC cleanup)
     struct passwd *pw = m_ops->getpwnam(username.toLocal8Bit().constData());
-    uid_t userUid = pw ? pw->pw_uid : 0;
-
-    // Disable linger first
-    QProcess *lingerProcess = m_ops->createProcess();
-    m_ops->startProcess(lingerProcess, QStringLiteral("loginctl"),
-        {QStringLiteral("disable-linger"), username});
-    m_ops->waitForFinished(lingerProcess, 10000);
-    delete lingerProcess;
-    // Don't fail if this doesn't work
-
-    // Kill any running processes for the user
-    QProcess *pkillProcess = m_ops->createProcess();
-    m_ops->startProcess(pkillProcess, QStringLiteral("pkill"), {QStringLiteral("-u"), username});
-    m_ops->waitForFinished(pkillProcess, 10000);
-    delete pkillProcess;
-    // Don't fail if there are no processes to kill
-
-    // Wait a moment for processes to terminate
-    QThread::msleep(500);
-
-    // Clean up IPC resources (semaphores, shared memory, message queues) owned by the user
-    // This prevents "Permission denied" errors if a new user is created with the same name
-    // but a different UID, and tries to access stale IPC resources from the old user.
-    if (userUid > 0) {
-        // Remove semaphores owned by the user
-        QProcess *ipcrm = m_ops->createProcess();
-        m_ops->startProcess(ipcrm, QStringLiteral("/bin/bash"),
-            {QStringLiteral("-c"),
-             QStringLiteral("ipcs -s | awk '$3 == %1 {print $2}' | xargs -r ipcrm -s").arg(userUid)});
-        m_ops->waitForFinished(ipcrm, 10000);
-        delete ipcrm;
-
-        // Remove shared memory segments owned by the user
-        QProcess *shmrm = m_ops->createProcess();
-        m_ops->startProcess(shmrm, QStringLiteral("/bin/bash"),
-            {QStringLiteral("-c"),
-             QStringLiteral("ipcs -m | awk '$3 == %1 {print $2}' | xargs -r ipcrm -m").arg(userUid)});
-        m_ops->waitForFinished(shmrm, 10000);
-        delete shmrm;
-
-        // Remove message queues owned by the user
-        QProcess *msgrm = m_ops->createProcess();
-        m_ops->startProcess(msgrm, QStringLiteral("/bin/bash"),
-            {QStringLiteral("-c"),
-             QStringLiteral("ipcs -q | awk '$3 == %1 {print $2}' | xargs -r ipcrm -q").arg(userUid)});
-        m_ops->waitForFinished(msgrm, 10000);
-        delete msgrm;
-
-        // Clean up /tmp files owned by the user (Steam dumps, etc.)
-        QProcess *tmprm = m_ops->createProcess();
-        m_ops->startProcess(tmprm, QStringLiteral("find"),
-            {QStringLiteral("/tmp"), QStringLiteral("-user"), QString::number(userUid),
-             QStringLiteral("-delete")});
-        m_ops->waitForFinished(tmprm, 30000);
-        delete tmprm;
-
-        // Clean up /dev/shm files owned by the user
-        QProcess *shmfilerm = m_ops->createProcess();
-        m_ops->startProcess(shmfilerm, QStringLiteral("find"),
-            {QStringLiteral("/dev/shm"), QStringLiteral("-user"), QString::number(userUid),
-             QStringLiteral("-delete")});
-        m_ops->waitForFinished(shmfilerm, 10000);
-        delete shmfilerm;
-    }
-
-    // Delete user with userdel
-    QProcess *process = m_ops->createProcess();
-    QStringList args;
-    if (removeHome) {
-        args << QStringLiteral("-r");  // Remove home directory
-    }
-    args << username;
+    const uid_t userUid = pw ? pw->pw_uid : 0;
+    SystemOps *ops = m_ops;
 
-    m_ops->startProcess(process, QStringLiteral("userdel"), args);
-    m_ops->waitForFinished(process, 30000);
+    HelperMetrics *metrics = &m_metrics;
 
-    if (m_ops->processExitCode(process) != 0) {
-        QString errorMsg = QString::fromLocal8Bit(m_ops->readStandardError(process));
-        qWarning() << "DeleteUser failed:" << errorMsg;
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("Failed to delete user: %1").arg(errorMsg));
+    const TeardownStep userdel{QStringLiteral("userdel"), [ops, metrics, username, removeHome] {
+        QProcess *process = ops->createProcess();
+        QStringList args;
+        if (removeHome) {
+            args << QStringLiteral("-r");  // Remove home directory
+        }
+        args << username;
+
+        metrics->processStarted(process, QStringLiteral("userdel"));
+        ops->startProcess(process, QStringLiteral("userdel"), args);
+        const bool finished = ops->waitForFinished(process, 30000);
+        metrics->processFinished(process, finished, ops->processExitCode(process));
+
+        QString error;
+        if (ops->processExitCode(process) != 0) {
+            error = QStringLiteral("Failed to delete user: %1")
+                        .arg(QString::fromLocal8Bit(ops->readStandardError(process)));
+        }
         delete process;
-        return false;
+        return error;
+    }};
+
+    m_deletions.insert(username, 0);
+    if (userUid == 0) {
+        // Never signal or clean up after root, whatever the group says
+        runTeardownStage(username, {userdel}, [this, username] { finishDeletion(username, QString()); });
+        return true;
     }
-    delete process;
 
-    qDebug() << "Deleted user" << username;
+    // Stopping the user comes first: logind would restart the user manager
+    // of a lingering user, and live processes keep IPC objects and files in use.
+    // None of the steps up to userdel fails the deletion.
+    const QList<TeardownStep> stopUser{
+        {QStringLiteral("linger"), [ops, userUid] {
+            QString error;
+            if (!ops->setUserLinger(userUid, false, error)) {
+                qWarning() << "Failed to disable linger for UID" << userUid << ":" << error;
+            }
+            return QString();
+        }},
+        {QStringLiteral("processes"), [ops, userUid] {
+            if (const int alive = ops->killUserProcesses(userUid, 5000)) {
+                qWarning() << alive << "processes of UID" << userUid << "did not exit";
+            }
+            return QString();
+        }},
+    };
+
+    // Stale IPC resources would give "Permission denied" to a new user that
+    // gets the same name but a different UID
+    QList<TeardownStep> cleanUp{
+        {QStringLiteral("ipc"), [ops, userUid] {
+            ops->removeUserIpc(userUid);
+            return QString();
+        }},
+        // Steam dumps and the like
+        {QStringLiteral("tmp"), [ops, userUid] {
+            ops->removeOwnedFiles(QStringLiteral("/tmp"), userUid);
+            return QString();
+        }},
+        {QStringLiteral("shm"), [ops, userUid] {
+            ops->removeOwnedFiles(QStringLiteral("/dev/shm"), userUid);
+            return QString();
+        }},
+    };
+    if (removeHome) {
+        // The upper layers of writable shares hold the player's files as well
+        const QString overlays = m_overlayRoot + QLatin1Char('/') + username;
+        cleanUp.append({QStringLiteral("overlays"), [overlays] {
+            QDir(overlays).removeRecursively();
+            return QString();
+        }});
+    }
+
+    runTeardownStage(username, stopUser, [this, username, cleanUp, userdel] {
+        runTeardownStage(username, cleanUp, [this, username, userdel] {
+            runTeardownStage(username, {userdel}, [this, username] { finishDeletion(username, QString()); });
+        });
+    });
     return true;
 }
 
+void CouchPlayHelper::runTeardownStage(const QString &username, const QList<TeardownStep> &steps,
+                                       const std::function<void()> &next)
+{
+    m_deletions[username] = steps.size();
+    for (const TeardownStep &step : steps) {
+        m_teardownPool.start([this, username, step, next] {
+            const QString error = step.second();
+            QMetaObject::invokeMethod(
+                this,
+                [this, username, name = step.first, error, next] {
+                    Q_EMIT UserDeletionProgress(username, name);
+                    if (!error.isEmpty()) {
+                        finishDeletion(username, error);
+                        return;
+                    }
+                    // A failed sibling may have finished the deletion already
+                    auto it = m_deletions.find(username);
+                    if (it != m_deletions.end() && --*it == 0) {
+                        next();
+                    }
+                },
+                Qt::QueuedConnection);
+        });
+    }
+}
+
+void CouchPlayHelper::finishDeletion(const QString &username, const QString &error)
+{
+    if (!m_deletions.remove(username)) {
+        return;
+    }
+    if (error.isEmpty()) {
+        qDebug() << "Deleted user" << username;
+    } else {
+        qWarning() << "DeleteUser failed:" << error;
+    }
+    Q_EMIT UserDeletionFinished(username, error.isEmpty(), error);
+}
+
 bool CouchPlayHelper::EnableLinger(const QString &username)
 {
+    const HandlerScope handler(this, "EnableLinger");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -506,16 +869,26 @@ bool CouchPlayHelper::EnableLinger(const QString &username)
         return false;
     }
 
+    QString error;
+    if (!applyLinger(username, error)) {
+        sendErrorReply(QDBusError::Failed, error);
+        return false;
+    }
+
+    return true;
+}
+
+bool CouchPlayHelper::applyLinger(const QString &username, QString &error)
+{
     // Enable linger via loginctl
     QProcess *process = m_ops->createProcess();
-    m_ops->startProcess(process, QStringLiteral("loginctl"),
+    startProcess(process, QStringLiteral("loginctl"),
         {QStringLiteral("enable-linger"), username});
-    m_ops->waitForFinished(process, 30000);
+    waitForFinished(process, 30000);
 
     if (m_ops->processExitCode(process) != 0) {
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("Failed to enable linger: %1")
-                .arg(QString::fromLocal8Bit(m_ops->readStandardError(process))));
+        error = QStringLiteral("Failed to enable linger: %1")
+                    .arg(QString::fromLocal8Bit(m_ops->readStandardError(process)));
         delete process;
         return false;
     }
@@ -533,6 +906,7 @@ bool CouchPlayHelper::IsLingerEnabled(const QString &username)
 
 bool CouchPlayHelper::SetupRuntimeAccess(uint compositorUid)
 {
+    const HandlerScope handler(this, "SetupRuntimeAccess");
     if (!checkAuthorization(ACTION_WAYLAND_ACCESS)) {
         sendErrorReply(QDBusError::AccessDenied, 
             QStringLiteral("Not authorized to set up runtime access"));
@@ -547,11 +921,24 @@ bool CouchPlayHelper::SetupRuntimeAccess(uint compositorUid)
         return false;
     }
 
+    QString error;
+    if (!applyRuntimeAccess(compositorUid, error)) {
+        // Optional sockets failing leaves no error, just a false result
+        if (!error.isEmpty()) {
+            sendErrorReply(QDBusError::Failed, error);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+bool CouchPlayHelper::applyRuntimeAccess(uint compositorUid, QString &error)
+{
     QString runtimeDir = QStringLiteral("/run/user/%1").arg(compositorUid);
 
     if (!m_ops->fileExists(runtimeDir)) {
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("Runtime directory %1 does not exist").arg(runtimeDir));
+        error = QStringLiteral("Runtime directory %1 does not exist").arg(runtimeDir);
         return false;
     }
 
@@ -564,9 +951,9 @@ bool CouchPlayHelper::SetupRuntimeAccess(uint compositorUid)
             return true;  // Not an error - optional paths
         }
         QProcess *proc = m_ops->createProcess();
-        m_ops->startProcess(proc, QStringLiteral("setfacl"),
+        startProcess(proc, QStringLiteral("setfacl"),
             {QStringLiteral("-m"), QStringLiteral("g:%1:%2").arg(group, perm), path});
-        m_ops->waitForFinished(proc, 5000);
+        waitForFinished(proc, 5000);
         bool success = (m_ops->processExitCode(proc) == 0);
         if (!success) {
             qWarning() << "Failed to set ACL on" << path << ":"
@@ -578,16 +965,14 @@ bool CouchPlayHelper::SetupRuntimeAccess(uint compositorUid)
 
     // Runtime directory - traverse permission
     if (!setAcl(runtimeDir, QStringLiteral("x"))) {
-        sendErrorReply(QDBusError::Failed, 
-            QStringLiteral("Failed to set ACL on runtime directory"));
+        error = QStringLiteral("Failed to set ACL on runtime directory");
         return false;
     }
 
     // Wayland socket
     QString waylandSocket = runtimeDir + QStringLiteral("/wayland-0");
     if (!setAcl(waylandSocket, QStringLiteral("rw"))) {
-        sendErrorReply(QDBusError::Failed, 
-            QStringLiteral("Failed to set ACL on Wayland socket"));
+        error = QStringLiteral("Failed to set ACL on Wayland socket");
         return false;
     }
 
@@ -606,9 +991,9 @@ bool CouchPlayHelper::SetupRuntimeAccess(uint compositorUid)
     QString pulseDir = runtimeDir + QStringLiteral("/pulse");
     if (m_ops->fileExists(pulseDir)) {
         QProcess *proc = m_ops->createProcess();
-        m_ops->startProcess(proc, QStringLiteral("setfacl"),
+        startProcess(proc, QStringLiteral("setfacl"),
             {QStringLiteral("-m"), QStringLiteral("g:%1:x,m::x").arg(group), pulseDir});
-        m_ops->waitForFinished(proc, 5000);
+        waitForFinished(proc, 5000);
         if (m_ops->processExitCode(proc) != 0) {
             qWarning() << "Failed to set ACL on" << pulseDir << ":"
                        << QString::fromLocal8Bit(m_ops->readStandardError(proc));
@@ -627,6 +1012,7 @@ bool CouchPlayHelper::SetupRuntimeAccess(uint compositorUid)
 
 bool CouchPlayHelper::RemoveRuntimeAccess(uint compositorUid)
 {
+    const HandlerScope handler(this, "RemoveRuntimeAccess");
     if (!checkAuthorization(ACTION_WAYLAND_ACCESS)) {
         sendErrorReply(QDBusError::AccessDenied, 
             QStringLiteral("Not authorized to remove runtime access"));
@@ -643,9 +1029,9 @@ bool CouchPlayHelper::RemoveRuntimeAccess(uint compositorUid)
             return true;
         }
         QProcess *proc = m_ops->createProcess();
-        m_ops->startProcess(proc, QStringLiteral("setfacl"),
+        startProcess(proc, QStringLiteral("setfacl"),
             {QStringLiteral("-x"), QStringLiteral("g:%1").arg(group), path});
-        m_ops->waitForFinished(proc, 5000);
+        waitForFinished(proc, 5000);
         bool result = (m_ops->processExitCode(proc) == 0);
         delete proc;
         // Don't fail on removal errors - file may have been deleted
@@ -676,20 +1062,281 @@ QString CouchPlayHelper::Version()
     return HELPER_VERSION;
 }
 
-bool CouchPlayHelper::checkAuthorization(const QString &action)
+void CouchPlayHelper::BeginTrace()
 {
-    return m_ops->checkAuthorization(action);
+    m_trace.begin(caller());
 }
 
-bool CouchPlayHelper::isValidDevicePath(const QString &path)
+void CouchPlayHelper::SetTraceParent(const QString &method, qulonglong spanId)
 {
-    // Must be under /dev/input/
-    if (!path.startsWith(QStringLiteral("/dev/input/"))) {
-        return false;
+    m_trace.setParent(caller(), method, spanId);
+}
+
+QVariantMap CouchPlayHelper::TakeTrace()
+{
+    QVariantMap result;
+    result[QStringLiteral("pid")] = qint64(getpid());
+    result[QStringLiteral("spans")] = m_trace.take(caller());
+    return result;
+}
+
+QVariantMap CouchPlayHelper::AuthorizeSession()
+{
+    const HandlerScope handler(this, "AuthorizeSession");
+    const QString client = caller();
+
+    // A live grant is renewed without another polkit round trip
+    bool authorized = useSessionGrant(client, ACTION_PREPARE_INSTANCE);
+    if (!authorized) {
+        QElapsedTimer timer;
+        timer.start();
+        authorized = m_ops->checkAuthorization(ACTION_START_SESSION, client, true);
+        m_metrics.recordAuthorization(quint64(timer.nsecsElapsed() / 1000), authorized);
+
+        if (authorized && !client.isEmpty()) {
+            watchGrantHolder(client);
+            m_sessionGrants.insert(client, m_grantClock.elapsed() + m_sessionGrantTimeout);
+        }
     }
 
-    // Check for path traversal attempts
-    if (path.contains(QStringLiteral(".."))) {
+    QVariantMap result;
+    result[QStringLiteral("authorized")] = authorized;
+    result[QStringLiteral("expiresInMs")] = authorized ? m_sessionGrantTimeout : 0;
+    return result;
+}
+
+bool CouchPlayHelper::AuthorizeAction(const QString &action)
+{
+    const HandlerScope handler(this, "AuthorizeAction");
+    if (!action.startsWith(QLatin1String("io.github.hikaps.couchplay."))) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("Unknown action: %1").arg(action));
+        return false;
+    }
+
+    const QString client = caller();
+    QElapsedTimer timer;
+    timer.start();
+    const bool authorized = m_ops->checkAuthorization(action, client, true);
+    m_metrics.recordAuthorization(quint64(timer.nsecsElapsed() / 1000), authorized);
+
+    if (authorized && !client.isEmpty()) {
+        watchGrantHolder(client);
+        m_actionGrants[client].insert(action, m_grantClock.elapsed() + ACTION_GRANT_TIMEOUT_MS);
+    }
+    return authorized;
+}
+
+void CouchPlayHelper::EndSession()
+{
+    dropSessionGrant(caller());
+}
+
+void CouchPlayHelper::setSessionGrantTimeout(int msecs)
+{
+    m_sessionGrantTimeout = msecs;
+}
+
+bool CouchPlayHelper::useSessionGrant(const QString &client, const QString &action)
+{
+    if (client.isEmpty() || !SESSION_ACTIONS.contains(action)) {
+        return false;
+    }
+    const auto it = m_sessionGrants.find(client);
+    if (it == m_sessionGrants.end()) {
+        return false;
+    }
+
+    const qint64 now = m_grantClock.elapsed();
+    if (now >= it.value() && !holdsResources(client)) {
+        dropSessionGrant(client);
+        return false;
+    }
+    // Sliding expiry: a session that keeps calling keeps its grant
+    it.value() = now + m_sessionGrantTimeout;
+    return true;
+}
+
+bool CouchPlayHelper::useActionGrant(const QString &client, const QString &action)
+{
+    const auto it = m_actionGrants.find(client);
+    if (it == m_actionGrants.end()) {
+        return false;
+    }
+    const qint64 expiry = it->take(action);
+    if (it->isEmpty()) {
+        m_actionGrants.erase(it);
+    }
+    return expiry > m_grantClock.elapsed();
+}
+
+bool CouchPlayHelper::holdsResources(const QString &client)
+{
+    for (auto it = m_instanceOwners.begin(); it != m_instanceOwners.end();) {
+        if (!m_launchedUnits.contains(it.key()) && !m_launchedProcesses.contains(it.key())) {
+            it = m_instanceOwners.erase(it);  // Exited without the supervisor noticing
+        } else if (it.value() == client) {
+            return true;
+        } else {
+            ++it;
+        }
+    }
+    for (const QList<MountInfo> &mounts : std::as_const(m_activeMounts)) {
+        for (const MountInfo &mount : mounts) {
+            if (mount.owner == client) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CouchPlayHelper::ownsInstance(qint64 pid) const
+{
+    const QString client = caller();
+    return !client.isEmpty() && m_instanceOwners.value(pid) == client
+        && (m_launchedUnits.contains(pid) || m_launchedProcesses.contains(pid));
+}
+
+bool CouchPlayHelper::ownsMounts(const QString &username) const
+{
+    const QString client = caller();
+    if (client.isEmpty()) {
+        return false;
+    }
+    bool any = false;
+    for (auto it = m_activeMounts.cbegin(); it != m_activeMounts.cend(); ++it) {
+        if (!username.isEmpty() && it.key() != username) {
+            continue;
+        }
+        for (const MountInfo &mount : it.value()) {
+            if (mount.owner != client) {
+                return false;
+            }
+            any = true;
+        }
+    }
+    return any;
+}
+
+void CouchPlayHelper::watchGrantHolder(const QString &client)
+{
+    if (!m_grantWatcher) {
+        m_grantWatcher = new QDBusServiceWatcher(this);
+        m_grantWatcher->setConnection(connection());
+        m_grantWatcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+        connect(m_grantWatcher, &QDBusServiceWatcher::serviceUnregistered, this,
+                &CouchPlayHelper::dropSessionGrant);
+    }
+    if (!m_grantWatcher->watchedServices().contains(client)) {
+        m_grantWatcher->addWatchedService(client);
+    }
+}
+
+void CouchPlayHelper::dropSessionGrant(const QString &client)
+{
+    const bool session = m_sessionGrants.remove(client);
+    const bool actions = m_actionGrants.remove(client);
+    if ((session || actions) && m_grantWatcher) {
+        m_grantWatcher->removeWatchedService(client);
+    }
+}
+
+QString CouchPlayHelper::caller() const
+{
+    return calledFromDBus() ? message().service() : QString();
+}
+
+bool CouchPlayHelper::callerUid(uint &uid) const
+{
+    if (!calledFromDBus() || !connection().interface()) {
+        return false;
+    }
+    const QDBusReply<uint> reply = connection().interface()->serviceUid(message().service());
+    if (!reply.isValid()) {
+        return false;
+    }
+    uid = reply.value();
+    return true;
+}
+
+QVariantMap CouchPlayHelper::GetMetrics()
+{
+    return m_metrics.snapshot(metricsGauges());
+}
+
+QVariantMap CouchPlayHelper::metricsGauges() const
+{
+    int mounts = 0;
+    for (const QList<MountInfo> &userMounts : m_activeMounts) {
+        mounts += userMounts.size();
+    }
+
+    return {
+        {QStringLiteral("activeMounts"), mounts},
+        {QStringLiteral("instances"), int(m_launchedUnits.size() + m_launchedProcesses.size())},
+        {QStringLiteral("ownedDevices"), int(m_modifiedDevices.size())},
+        {QStringLiteral("userDeletions"), int(m_deletions.size())},
+    };
+}
+
+CouchPlayHelper::HandlerScope::HandlerScope(CouchPlayHelper *helper, const char *method)
+    : m_call(helper->m_metrics, method)
+    , m_trace(helper->m_trace, helper->caller(), method)
+{
+}
+
+void CouchPlayHelper::sendErrorReply(const QString &name, const QString &message) const
+{
+    m_metrics.fail();
+    QDBusContext::sendErrorReply(name, message);
+}
+
+void CouchPlayHelper::sendErrorReply(QDBusError::ErrorType type, const QString &message) const
+{
+    m_metrics.fail();
+    QDBusContext::sendErrorReply(type, message);
+}
+
+void CouchPlayHelper::startProcess(QProcess *process, const QString &program, const QStringList &arguments)
+{
+    m_metrics.processStarted(process, program);
+    m_ops->startProcess(process, program, arguments);
+}
+
+bool CouchPlayHelper::waitForFinished(QProcess *process, int msecs)
+{
+    const bool finished = m_ops->waitForFinished(process, msecs);
+    m_metrics.processFinished(process, finished, finished ? m_ops->processExitCode(process) : -1);
+    return finished;
+}
+
+bool CouchPlayHelper::checkAuthorization(const QString &action)
+{
+    const QString client = caller();
+    if (useSessionGrant(client, action) || useActionGrant(client, action)) {
+        return true;
+    }
+
+    // Never prompts: a prompt would hold up every other caller of the
+    // helper until answered, so only AuthorizeSession() and
+    // AuthorizeAction() may ask the user
+    QElapsedTimer timer;
+    timer.start();
+    const bool authorized = m_ops->checkAuthorization(action, client, false);
+    m_metrics.recordAuthorization(quint64(timer.nsecsElapsed() / 1000), authorized);
+    return authorized;
+}
+
+bool CouchPlayHelper::isValidDevicePath(const QString &path)
+{
+    // Must be under /dev/input/
+    if (!path.startsWith(QStringLiteral("/dev/input/"))) {
+        return false;
+    }
+
+    // Check for path traversal attempts
+    if (path.contains(QStringLiteral(".."))) {
         return false;
     }
 
@@ -712,6 +1359,7 @@ qint64 CouchPlayHelper::LaunchInstance(const QString &username, uint compositorU
                                         const QString &gameCommand,
                                         const QStringList &environment)
 {
+    const HandlerScope handler(this, "LaunchInstance");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -741,54 +1389,108 @@ qint64 CouchPlayHelper::LaunchInstance(const QString &username, uint compositorU
         return 0;
     }
 
+    QString error;
+    qint64 pid = startInstanceProcess(username, compositorUid, gamescopeArgs, gameCommand,
+                                      environment, QVariantMap(), error);
+    if (pid <= 0) {
+        sendErrorReply(QDBusError::Failed, error);
+        return 0;
+    }
+
+    return pid;
+}
+
+qint64 CouchPlayHelper::startInstanceProcess(const QString &username, uint compositorUid,
+                                             const QStringList &gamescopeArgs,
+                                             const QString &gameCommand,
+                                             const QStringList &environment,
+                                             const QVariantMap &unitProperties,
+                                             QString &error)
+{
     // Set up runtime access for couchplay group (once per compositor)
     // This grants access to Wayland, PipeWire, and PulseAudio sockets
     if (!m_runtimeAccessSetForUid.contains(compositorUid)) {
-        if (!SetupRuntimeAccess(compositorUid)) {
-            qWarning() << "Failed to set up runtime access for compositor" << compositorUid;
+        QString accessError;
+        if (!applyRuntimeAccess(compositorUid, accessError)) {
+            qWarning() << "Failed to set up runtime access for compositor" << compositorUid << accessError;
             // Continue anyway - may already be set from previous session
         }
     }
 
+    // Preferred: a transient service, so the PID we hand out is gamescope
+    // itself and Stop/Kill reach its whole cgroup
+    struct passwd *pw = m_ops->getpwnam(username.toLocal8Bit().constData());
+    if (pw) {
+        TransientUnitSpec unit = buildInstanceUnit(username, pw->pw_uid, compositorUid,
+                                                   gamescopeArgs, gameCommand, environment);
+        unit.properties = unitProperties;
+        QString unitError;
+        const qint64 unitStartUs = HelperTrace::nowUs();
+        const qint64 pid = m_ops->startTransientUnit(unit, unitError);
+        m_trace.record(QStringLiteral("StartTransientUnit"), unitStartUs, HelperTrace::nowUs() - unitStartUs);
+        if (pid > 0) {
+            // Supervised units are forgotten when they exit; without pidfd
+            // support, forget units whose processes are gone
+            for (auto it = m_launchedUnits.begin(); it != m_launchedUnits.end();) {
+                it = m_supervisor->isWatching(it.key())
+                        || m_ops->fileExists(QStringLiteral("/proc/%1").arg(it.key()))
+                    ? std::next(it)
+                    : m_launchedUnits.erase(it);
+            }
+            m_launchedUnits.insert(pid, unit.name);
+            m_instanceOwners.insert(pid, caller());
+            m_supervisor->watch(pid);
+            qDebug() << "LaunchInstance: Started" << unit.name << "PID" << pid << "for user" << username;
+            return pid;
+        }
+        qWarning() << "LaunchInstance: Transient unit failed, falling back to machinectl:" << unitError;
+    }
+    if (!unitProperties.isEmpty()) {
+        qWarning() << "LaunchInstance: Resource limits need a transient unit, ignoring them for" << username;
+    }
+
     // Build the command to execute
     QString command = buildInstanceCommand(username, compositorUid, gamescopeArgs,
                                             gameCommand, environment);
 
-    // Create and start the process
+    // Create and start the process. The instance logs to the journal, so no
+    // pipes are kept open to the helper.
     QProcess *process = m_ops->createProcess(this);
-    
+    process->setStandardOutputFile(QProcess::nullDevice());
+    process->setStandardErrorFile(QProcess::nullDevice());
+
     // Connect to finished signal to clean up
     connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
             this, [this, process](int exitCode, QProcess::ExitStatus exitStatus) {
         Q_UNUSED(exitCode)
         Q_UNUSED(exitStatus)
-        qint64 pid = process->processId();
-        
-        // Clean up from our tracking map
-        m_launchedProcesses.remove(pid);
+        // processId() is 0 once the process has finished
+        m_launchedProcesses.remove(m_launchedProcesses.key(process));
         process->deleteLater();
     });
 
-    // Start the process
+    // Start the process (an instance, counted in the gauges rather than as a child process)
     m_ops->startProcess(process, QStringLiteral("/bin/bash"), {QStringLiteral("-c"), command});
 
     if (!process->waitForStarted(5000)) {
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("Failed to start process: %1").arg(process->errorString()));
+        error = QStringLiteral("Failed to start process: %1").arg(process->errorString());
         delete process;
         return 0;
     }
 
     qint64 pid = process->processId();
     m_launchedProcesses.insert(pid, process);
-    
+    m_instanceOwners.insert(pid, caller());
+    m_supervisor->watch(pid);
+
     qDebug() << "LaunchInstance: Started PID" << pid << "for user" << username;
     return pid;
 }
 
 bool CouchPlayHelper::StopInstance(qint64 pid)
 {
-    if (!checkAuthorization(ACTION_LAUNCH_INSTANCE)) {
+    const HandlerScope handler(this, "StopInstance");
+    if (!ownsInstance(pid) && !checkAuthorization(ACTION_LAUNCH_INSTANCE)) {
         sendErrorReply(QDBusError::AccessDenied, 
             QStringLiteral("Not authorized to stop instances"));
         return false;
@@ -800,8 +1502,24 @@ bool CouchPlayHelper::StopInstance(qint64 pid)
         return false;
     }
 
+    // Transient units are signalled as a whole cgroup
+    if (m_launchedUnits.contains(pid)) {
+        const QString unit = m_launchedUnits.value(pid);
+        if (m_ops->killUnit(unit, SIGTERM)) {
+            return true;
+        }
+        // Unit is gone: don't signal a PID that may have been reused
+        m_launchedUnits.remove(pid);
+        sendErrorReply(QDBusError::Failed,
+            QStringLiteral("Instance %1 is no longer running").arg(pid));
+        return false;
+    }
+
     // Check if we have this process
     if (m_launchedProcesses.contains(pid)) {
+        if (m_supervisor->sendSignal(pid, SIGTERM)) {
+            return true;
+        }
         QProcess *process = m_launchedProcesses.value(pid);
         if (process && process->state() != QProcess::NotRunning) {
             process->terminate();
@@ -821,9 +1539,148 @@ bool CouchPlayHelper::StopInstance(qint64 pid)
     return false;
 }
 
-bool CouchPlayHelper::KillInstance(qint64 pid)
+bool CouchPlayHelper::SetInstanceResources(qint64 pid, const QVariantMap &resources)
 {
+    const HandlerScope handler(this, "SetInstanceResources");
     if (!checkAuthorization(ACTION_LAUNCH_INSTANCE)) {
+        sendErrorReply(QDBusError::AccessDenied,
+            QStringLiteral("Not authorized to change instance resources"));
+        return false;
+    }
+
+    QString error;
+    const QVariantMap properties = unitResourceProperties(resources, error);
+    if (!error.isEmpty()) {
+        sendErrorReply(QDBusError::InvalidArgs, error);
+        return false;
+    }
+
+    if (!m_launchedUnits.contains(pid)) {
+        sendErrorReply(QDBusError::NotSupported,
+            QStringLiteral("Instance %1 was not launched as a systemd unit").arg(pid));
+        return false;
+    }
+
+    if (properties.isEmpty()) {
+        return true;
+    }
+
+    if (!m_ops->setUnitProperties(m_launchedUnits.value(pid), properties, error)) {
+        sendErrorReply(QDBusError::Failed, error);
+        return false;
+    }
+
+    qDebug() << "SetInstanceResources:" << m_launchedUnits.value(pid) << properties.keys();
+    return true;
+}
+
+QVariantMap CouchPlayHelper::GetInstanceGpuUsage(qint64 pid)
+{
+    const HandlerScope handler(this, "GetInstanceGpuUsage");
+    if (!m_launchedUnits.contains(pid) && !m_launchedProcesses.contains(pid)) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("Instance %1 was not launched by the helper").arg(pid));
+        return QVariantMap();
+    }
+    return DrmFdinfo::read(DrmFdinfo::processTree(pid)).toVariantMap();
+}
+
+QVariantMap CouchPlayHelper::ReadInstanceLog(const QString &username, const QString &cursor, int maxLines)
+{
+    const HandlerScope handler(this, "ReadInstanceLog");
+    static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
+    if (!validUsername.match(username).hasMatch()) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("Invalid username format"));
+        return QVariantMap();
+    }
+
+    if (!checkAuthorization(ACTION_LAUNCH_INSTANCE)) {
+        sendErrorReply(QDBusError::AccessDenied,
+            QStringLiteral("Not authorized to read instance logs"));
+        return QVariantMap();
+    }
+
+    QString nextCursor;
+    const QList<JournalEntry> entries = m_ops->readJournal(QStringLiteral("couchplay-%1").arg(username), cursor,
+                                                           qBound(1, maxLines, MAX_LOG_LINES), nextCursor);
+    QVariantList list;
+    list.reserve(entries.size());
+    for (const JournalEntry &entry : entries) {
+        list.append(QVariantMap{
+            {QStringLiteral("message"), entry.message},
+            {QStringLiteral("timestamp"), entry.timestampUs / 1000},
+            {QStringLiteral("priority"), entry.priority},
+        });
+    }
+
+    QVariantMap result;
+    result[QStringLiteral("entries")] = list;
+    result[QStringLiteral("cursor")] = nextCursor;
+    return result;
+}
+
+QVariantMap CouchPlayHelper::unitResourceProperties(const QVariantMap &resources, QString &error)
+{
+    // Weights are relative to the other instances and the rest of the
+    // system (default 100); 0 or absent keys keep systemd's defaults
+    QVariantMap properties;
+
+    auto weight = [&](const QString &key, const QString &property) {
+        const int value = resources.value(key, 0).toInt();
+        if (value == 0) {
+            return;
+        }
+        if (value < 1 || value > 10000) {
+            error = QStringLiteral("%1 must be between 1 and 10000").arg(key);
+            return;
+        }
+        properties[property] = QVariant::fromValue(quint64(value));
+    };
+    weight(QStringLiteral("cpuWeight"), QStringLiteral("CPUWeight"));
+    weight(QStringLiteral("ioWeight"), QStringLiteral("IOWeight"));
+
+    const qint64 memoryHighMb = resources.value(QStringLiteral("memoryHighMb"), 0).toLongLong();
+    if (memoryHighMb < 0) {
+        error = QStringLiteral("memoryHighMb must not be negative");
+    } else if (memoryHighMb > 0) {
+        properties[QStringLiteral("MemoryHigh")] = QVariant::fromValue(quint64(memoryHighMb) * 1024 * 1024);
+    }
+
+    // "0-3,8-11" -> AllowedCPUs bitmask, byte n holds CPUs 8n..8n+7
+    const QString cpuCores = resources.value(QStringLiteral("cpuCores")).toString().trimmed();
+    if (!cpuCores.isEmpty()) {
+        static constexpr int MAX_CPUS = 1024;
+        QByteArray mask;
+        for (const QString &range : cpuCores.split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+            const QStringList bounds = range.trimmed().split(QLatin1Char('-'));
+            bool firstOk = false;
+            bool lastOk = bounds.size() == 1;
+            const int first = bounds.first().toInt(&firstOk);
+            const int last = bounds.size() == 2 ? bounds.last().toInt(&lastOk) : first;
+            if (bounds.size() > 2 || !firstOk || !lastOk || first < 0 || last < first || last >= MAX_CPUS) {
+                error = QStringLiteral("Invalid CPU list '%1'").arg(cpuCores);
+                return QVariantMap();
+            }
+            if (mask.size() <= last / 8) {
+                mask.append(last / 8 + 1 - mask.size(), '\0');
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                mask[cpu / 8] = char(mask.at(cpu / 8) | (1 << (cpu % 8)));
+            }
+        }
+        if (!mask.isEmpty()) {
+            properties[QStringLiteral("AllowedCPUs")] = mask;
+        }
+    }
+
+    return error.isEmpty() ? properties : QVariantMap();
+}
+
+bool CouchPlayHelper::KillInstance(qint64 pid)
+{
+    const HandlerScope handler(this, "KillInstance");
+    if (!ownsInstance(pid) && !checkAuthorization(ACTION_LAUNCH_INSTANCE)) {
         sendErrorReply(QDBusError::AccessDenied, 
             QStringLiteral("Not authorized to kill instances"));
         return false;
@@ -835,8 +1692,24 @@ bool CouchPlayHelper::KillInstance(qint64 pid)
         return false;
     }
 
+    // Transient units are signalled as a whole cgroup
+    if (m_launchedUnits.contains(pid)) {
+        const QString unit = m_launchedUnits.value(pid);
+        if (m_ops->killUnit(unit, SIGKILL)) {
+            return true;
+        }
+        // Unit is gone: don't signal a PID that may have been reused
+        m_launchedUnits.remove(pid);
+        sendErrorReply(QDBusError::Failed,
+            QStringLiteral("Instance %1 is no longer running").arg(pid));
+        return false;
+    }
+
     // Check if we have this process
     if (m_launchedProcesses.contains(pid)) {
+        if (m_supervisor->sendSignal(pid, SIGKILL)) {
+            return true;
+        }
         QProcess *process = m_launchedProcesses.value(pid);
         if (process && process->state() != QProcess::NotRunning) {
             process->kill();
@@ -855,48 +1728,91 @@ bool CouchPlayHelper::KillInstance(qint64 pid)
     return false;
 }
 
-QString CouchPlayHelper::buildInstanceCommand(const QString &username, uint compositorUid,
-                                               const QStringList &gamescopeArgs,
-                                               const QString &gameCommand,
-                                               const QStringList &environment)
+QStringList CouchPlayHelper::instanceEnvironment(uint compositorUid, const QStringList &environment)
 {
-    // Build environment exports for the user
-    // Key insight: Let the user use their OWN XDG_RUNTIME_DIR
-    // (so gamescope can create lockfiles there), but point WAYLAND_DISPLAY
-    // to the compositor user's Wayland socket as an absolute path.
-    
-    QStringList exports;
-    
+    QStringList vars;
+
     // Compositor user's runtime directory for Wayland socket
     QString compositorRuntimeDir = QStringLiteral("/run/user/%1").arg(compositorUid);
     QString compositorWaylandSocket = compositorRuntimeDir + QStringLiteral("/wayland-0");
-    
+
     // Set WAYLAND_DISPLAY to the absolute path of the compositor user's Wayland socket
     // The user has ACL access to this socket (set up by SetupWaylandAccess)
-    exports << QStringLiteral("export WAYLAND_DISPLAY=%1").arg(compositorWaylandSocket);
-    
+    vars << QStringLiteral("WAYLAND_DISPLAY=%1").arg(compositorWaylandSocket);
+
     // For audio, point to the compositor user's PipeWire and PulseAudio sockets
     // PipeWire uses PIPEWIRE_RUNTIME_DIR if set, otherwise XDG_RUNTIME_DIR
-    exports << QStringLiteral("export PIPEWIRE_RUNTIME_DIR=%1").arg(compositorRuntimeDir);
+    vars << QStringLiteral("PIPEWIRE_RUNTIME_DIR=%1").arg(compositorRuntimeDir);
     // PulseAudio clients (including games via SDL) need PULSE_SERVER to find the socket
-    exports << QStringLiteral("export PULSE_SERVER=unix:%1/pulse/native").arg(compositorRuntimeDir);
-    
+    vars << QStringLiteral("PULSE_SERVER=unix:%1/pulse/native").arg(compositorRuntimeDir);
+
     // Add any additional environment variables from the caller
+    vars << environment;
+    return vars;
+}
+
+TransientUnitSpec CouchPlayHelper::buildInstanceUnit(const QString &username, uid_t uid, uint compositorUid,
+                                                     const QStringList &gamescopeArgs,
+                                                     const QString &gameCommand,
+                                                     const QStringList &environment)
+{
+    static quint64 launchCount = 0;
+
+    TransientUnitSpec unit;
+    unit.name = QStringLiteral("couchplay-%1-%2.service").arg(username).arg(++launchCount);
+    unit.description = QStringLiteral("CouchPlay instance for %1").arg(username);
+    unit.user = username;
+    unit.uid = uid;
+    unit.syslogIdentifier = QStringLiteral("couchplay-%1").arg(username);
+
+    // Fields for filtering the journal: journalctl COUCHPLAY_USER=alice, or
+    // COUCHPLAY_INSTANCE=1 when the client numbered the instance
+    unit.logFields << QStringLiteral("COUCHPLAY_USER=%1").arg(username);
     for (const QString &var : environment) {
-        exports << QStringLiteral("export %1").arg(var);
+        if (var.startsWith(QLatin1String("COUCHPLAY_INSTANCE="))) {
+            unit.logFields << var;
+        }
     }
 
-    // Build the gamescope command with logging
-    QString logFile = QStringLiteral("/tmp/couchplay-%1.log").arg(username);
+    // Running as a system service, so provide what a login session would:
+    // the user's own runtime directory and session bus, plus the compositor sockets
+    const QString runtimeDir = QStringLiteral("/run/user/%1").arg(uid);
+    unit.environment << QStringLiteral("XDG_RUNTIME_DIR=%1").arg(runtimeDir)
+                     << QStringLiteral("DBUS_SESSION_BUS_ADDRESS=unix:path=%1/bus").arg(runtimeDir)
+                     << instanceEnvironment(compositorUid, environment);
+
+    // Arguments are passed as-is; only the game command, a shell command line
+    // by contract, goes through a shell
+    unit.argv << QStringLiteral("/usr/bin/gamescope") << gamescopeArgs
+              << QStringLiteral("--") << QStringLiteral("/bin/bash") << QStringLiteral("-c") << gameCommand;
+    return unit;
+}
+
+QString CouchPlayHelper::buildInstanceCommand(const QString &username, uint compositorUid,
+                                               const QStringList &gamescopeArgs,
+                                               const QString &gameCommand,
+                                               const QStringList &environment)
+{
+    // Build environment exports for the user
+    // Key insight: Let the user use their OWN XDG_RUNTIME_DIR
+    // (so gamescope can create lockfiles there), but point WAYLAND_DISPLAY
+    // to the compositor user's Wayland socket as an absolute path.
     
+    QStringList exports;
+    for (const QString &var : instanceEnvironment(compositorUid, environment)) {
+        exports << QStringLiteral("export %1").arg(var);
+    }
+
     // Escape the game command for embedding in bash -c
     QString gameCommandForBash = gameCommand;
     gameCommandForBash.replace(QLatin1Char('"'), QStringLiteral("\\\""));
     gameCommandForBash.replace(QLatin1Char('$'), QStringLiteral("\\$"));
     gameCommandForBash.replace(QLatin1Char('`'), QStringLiteral("\\`"));
     
-    QString gamescopeCmd = QStringLiteral("/usr/bin/gamescope %1 -- /bin/bash -c \"%2\" 2>&1 | tee %3")
-                               .arg(gamescopeArgs.join(QLatin1Char(' ')), gameCommandForBash, logFile);
+    // systemd-cat connects gamescope's stdout and stderr to the journal and
+    // execs it, under the same identifier transient units log with
+    QString gamescopeCmd = QStringLiteral("systemd-cat -t couchplay-%1 /usr/bin/gamescope %2 -- /bin/bash -c \"%3\"")
+                               .arg(username, gamescopeArgs.join(QLatin1Char(' ')), gameCommandForBash);
 
     // Escape the entire gamescopeCmd for embedding in single quotes
     QString escapedGamescopeCmd = gamescopeCmd;
@@ -938,6 +1854,7 @@ QString CouchPlayHelper::computeMountTarget(const QString &source, const QString
 int CouchPlayHelper::MountSharedDirectories(const QString &username, uint compositorUid,
                                              const QStringList &directories)
 {
+    const HandlerScope handler(this, "MountSharedDirectories");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -976,72 +1893,167 @@ int CouchPlayHelper::MountSharedDirectories(const QString &username, uint compos
     int successCount = 0;
 
     for (const QString &dirSpec : directories) {
-        // Parse "source|alias" format
-        QStringList parts = dirSpec.split(QLatin1Char('|'));
-        if (parts.isEmpty()) {
-            continue;
+        if (bindMount(username, dirSpec, userHome, compositorHome, compositorUid)) {
+            successCount++;
         }
+    }
 
-        QString source = parts.at(0);
-        QString alias = parts.size() > 1 ? parts.at(1) : QString();
+    return successCount;
+}
 
-        // Validate source path exists
-        if (!m_ops->fileExists(source)) {
-            qWarning() << "MountSharedDirectories: Source path does not exist:" << source;
-            continue;
+bool CouchPlayHelper::bindMount(const QString &username, const QString &dirSpec,
+                                const QString &userHome, const QString &compositorHome, uint compositorUid)
+{
+    // Parse "source|alias" format
+    QStringList parts = dirSpec.split(QLatin1Char('|'));
+    if (parts.isEmpty()) {
+        return false;
+    }
+
+    QString source = parts.at(0);
+    QString alias = parts.size() > 1 ? parts.at(1) : QString();
+    const bool overlay = parts.size() > 2 && parts.at(2) == QStringLiteral("overlay");
+
+    // Validate source path exists
+    if (!m_ops->fileExists(source)) {
+        qWarning() << "MountSharedDirectories: Source path does not exist:" << source;
+        return false;
+    }
+
+    // Validate source is a directory
+    if (!m_ops->isDirectory(source)) {
+        qWarning() << "MountSharedDirectories: Source is not a directory:" << source;
+        return false;
+    }
+
+    // Compute target path
+    QString target = computeMountTarget(source, alias, userHome, compositorHome);
+
+    // Already mounted, e.g. by a warm standby preparation
+    for (const MountInfo &mount : m_activeMounts.value(username)) {
+        if (mount.source == source && mount.target == target) {
+            return true;
         }
+    }
 
-        // Validate source is a directory
-        if (!m_ops->isDirectory(source)) {
-            qWarning() << "MountSharedDirectories: Source is not a directory:" << source;
-            continue;
+    // Create target directory if it doesn't exist
+    if (!m_ops->fileExists(target)) {
+        if (!m_ops->mkpath(target)) {
+            qWarning() << "MountSharedDirectories: Failed to create target directory:" << target;
+            return false;
+        }
+        // Set ownership of created directory to the target user
+        uint userUid = getUserUid(username);
+        struct passwd *pw = m_ops->getpwuid(userUid);
+        if (pw) {
+            m_ops->chown(target, userUid, pw->pw_gid);
         }
+    }
 
-        // Compute target path
-        QString target = computeMountTarget(source, alias, userHome, compositorHome);
+    if (overlay && overlayMount(username, source, target, compositorUid)) {
+        return true;
+    }
 
-        // Create target directory if it doesn't exist
-        if (!m_ops->fileExists(target)) {
-            if (!m_ops->mkpath(target)) {
-                qWarning() << "MountSharedDirectories: Failed to create target directory:" << target;
-                continue;
-            }
-            // Set ownership of created directory to the target user
-            uint userUid = getUserUid(username);
-            struct passwd *pw = m_ops->getpwuid(userUid);
-            if (pw) {
-                m_ops->chown(target, userUid, pw->pw_gid);
-            }
-        }
+    QString error;
+    if (!m_ops->bindMount(source, target, error)) {
+        qWarning() << "MountSharedDirectories: Failed to mount" << source << "to" << target << ":" << error;
+        return false;
+    }
 
-        // Perform bind mount
-        QProcess *mountProcess = m_ops->createProcess();
-        m_ops->startProcess(mountProcess, QStringLiteral("mount"),
-            {QStringLiteral("--bind"), source, target});
-        m_ops->waitForFinished(mountProcess, 10000);
+    // Track the mount for cleanup
+    MountInfo info;
+    info.source = source;
+    info.target = target;
+    info.owner = caller();
+    m_activeMounts[username].append(info);
 
-        if (m_ops->processExitCode(mountProcess) != 0) {
-            qWarning() << "MountSharedDirectories: Failed to mount" << source << "to" << target
-                       << ":" << QString::fromLocal8Bit(m_ops->readStandardError(mountProcess));
-            delete mountProcess;
-            continue;
-        }
-        delete mountProcess;
+    return true;
+}
 
-        // Track the mount for cleanup
-        MountInfo info;
-        info.source = source;
-        info.target = target;
-        m_activeMounts[username].append(info);
+bool CouchPlayHelper::overlayMount(const QString &username, const QString &source, const QString &target,
+                                   uint compositorUid)
+{
+    // Each lookup reuses the previous one's buffer, so copy out before the next
+    struct passwd *compositor = m_ops->getpwuid(compositorUid);
+    if (!compositor) {
+        return false;
+    }
+    const gid_t compositorGid = compositor->pw_gid;
+    const uint userUid = getUserUid(username);
+    struct passwd *pw = m_ops->getpwuid(userUid);
+    if (!pw) {
+        return false;
+    }
+    const gid_t userGid = pw->pw_gid;
+
+    // Layers are keyed by source so a user's changes come back next session
+    // (resolved where possible, so a path and a link to it share one)
+    const QString canonical = QFileInfo(source).canonicalFilePath();
+    const QString key = QString::fromLatin1(
+        QCryptographicHash::hash(QFile::encodeName(canonical.isEmpty() ? QDir::cleanPath(source) : canonical),
+                                 QCryptographicHash::Sha256).toHex());
+    const QString layer = QStringLiteral("/run/couchplay/layers/%1/%2").arg(username, key);
+    const QString upper = QStringLiteral("%1/%2/%3/upper").arg(m_overlayRoot, username, key);
+    const QString work = QStringLiteral("%1/%2/%3/work").arg(m_overlayRoot, username, key);
+
+    // Root only: the idmapped view shows the compositor's files as the user's,
+    // and nothing the user owns lies on the way to a directory root creates.
+    // Only the upper layer's root is the user's, it becomes the mount's root.
+    if (!m_ops->mkpath(layer) || m_ops->chmod(QStringLiteral("/run/couchplay/layers"), 0700) != 0
+        || !m_ops->mkpath(upper) || !m_ops->mkpath(work) || m_ops->chmod(m_overlayRoot, 0700) != 0
+        || m_ops->chown(upper, userUid, userGid) != 0) {
+        qWarning() << "MountSharedDirectories: Failed to create overlay layers for" << target;
+        return false;
+    }
 
-        successCount++;
+    QString error;
+    if (!m_ops->mountIdmapped(source, layer, compositorUid, compositorGid, userUid, userGid, error)) {
+        qWarning() << "MountSharedDirectories: No idmapped mount of" << source << "- using a bind mount:" << error;
+        return false;
+    }
+    if (!m_ops->mountOverlay(layer, upper, work, target, error)) {
+        qWarning() << "MountSharedDirectories: No overlay at" << target << "- using a bind mount:" << error;
+        unmountTarget(layer);
+        return false;
     }
 
-    return successCount;
+    MountInfo info;
+    info.source = source;
+    info.target = target;
+    info.layer = layer;
+    info.owner = caller();
+    m_activeMounts[username].append(info);
+    return true;
+}
+
+bool CouchPlayHelper::unmountTarget(const QString &target)
+{
+    QString error;
+    if (!m_ops->unmount(target, error)) {
+        qWarning() << "Failed to unmount" << target << ":" << error;
+        return false;
+    }
+    return true;
+}
+
+int CouchPlayHelper::unmountAll(const QList<MountInfo> &mounts)
+{
+    int count = 0;
+    // Reverse order in case of nested mounts; an overlay before its lower layer
+    for (qsizetype i = mounts.size() - 1; i >= 0; --i) {
+        if (unmountTarget(mounts.at(i).target)) {
+            ++count;
+        }
+        if (!mounts.at(i).layer.isEmpty()) {
+            unmountTarget(mounts.at(i).layer);
+        }
+    }
+    return count;
 }
 
 int CouchPlayHelper::UnmountSharedDirectories(const QString &username)
 {
+    const HandlerScope handler(this, "UnmountSharedDirectories");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -1050,7 +2062,7 @@ int CouchPlayHelper::UnmountSharedDirectories(const QString &username)
         return 0;
     }
 
-    if (!checkAuthorization(ACTION_MANAGE_MOUNTS)) {
+    if (!ownsMounts(username) && !checkAuthorization(ACTION_MANAGE_MOUNTS)) {
         sendErrorReply(QDBusError::AccessDenied, 
             QStringLiteral("Not authorized to manage mounts"));
         return 0;
@@ -1060,84 +2072,25 @@ int CouchPlayHelper::UnmountSharedDirectories(const QString &username)
         return 0;  // No mounts to remove
     }
 
-    int successCount = 0;
-    QList<MountInfo> mounts = m_activeMounts[username];
-
-    // Unmount in reverse order (in case of nested mounts)
-    for (int i = mounts.size() - 1; i >= 0; --i) {
-        const MountInfo &mount = mounts.at(i);
-
-        QProcess *umountProcess = m_ops->createProcess();
-        m_ops->startProcess(umountProcess, QStringLiteral("umount"), {mount.target});
-        m_ops->waitForFinished(umountProcess, 10000);
-
-        if (m_ops->processExitCode(umountProcess) == 0) {
-            successCount++;
-            delete umountProcess;
-        } else {
-            // Try lazy unmount as fallback
-            QProcess *lazyUmount = m_ops->createProcess();
-            m_ops->startProcess(lazyUmount, QStringLiteral("umount"), {QStringLiteral("-l"), mount.target});
-            m_ops->waitForFinished(lazyUmount, 10000);
-
-            if (m_ops->processExitCode(lazyUmount) == 0) {
-                successCount++;
-            } else {
-                qWarning() << "UnmountSharedDirectories: Failed to unmount" << mount.target
-                           << ":" << QString::fromLocal8Bit(m_ops->readStandardError(umountProcess));
-            }
-            delete umountProcess;
-            delete lazyUmount;
-        }
-    }
-
+    const int successCount = unmountAll(m_activeMounts.value(username));
     m_activeMounts.remove(username);
     return successCount;
 }
 
 int CouchPlayHelper::UnmountAllSharedDirectories()
 {
-    if (!checkAuthorization(ACTION_MANAGE_MOUNTS)) {
+    const HandlerScope handler(this, "UnmountAllSharedDirectories");
+    if (!ownsMounts() && !checkAuthorization(ACTION_MANAGE_MOUNTS)) {
         sendErrorReply(QDBusError::AccessDenied, 
             QStringLiteral("Not authorized to manage mounts"));
         return 0;
     }
 
     int totalCount = 0;
-    QStringList users = m_activeMounts.keys();
-
-    for (const QString &username : users) {
-        // Call without auth check since we already checked above
-        QList<MountInfo> mounts = m_activeMounts[username];
-        
-        for (int i = mounts.size() - 1; i >= 0; --i) {
-            const MountInfo &mount = mounts.at(i);
-
-            QProcess *umountProcess = m_ops->createProcess();
-            m_ops->startProcess(umountProcess, QStringLiteral("umount"), {mount.target});
-            m_ops->waitForFinished(umountProcess, 10000);
-
-            if (m_ops->processExitCode(umountProcess) == 0) {
-                totalCount++;
-                delete umountProcess;
-            } else {
-                // Try lazy unmount as fallback
-                QProcess *lazyUmount = m_ops->createProcess();
-                m_ops->startProcess(lazyUmount, QStringLiteral("umount"), {QStringLiteral("-l"), mount.target});
-                m_ops->waitForFinished(lazyUmount, 10000);
-
-                if (m_ops->processExitCode(lazyUmount) == 0) {
-                    totalCount++;
-                } else {
-                    qWarning() << "UnmountAllSharedDirectories: Failed to unmount" << mount.target;
-                }
-                delete umountProcess;
-                delete lazyUmount;
-            }
-        }
-        
-        m_activeMounts.remove(username);
+    for (const QList<MountInfo> &mounts : std::as_const(m_activeMounts)) {
+        totalCount += unmountAll(mounts);
     }
+    m_activeMounts.clear();
 
     return totalCount;
 }
@@ -1145,6 +2098,7 @@ int CouchPlayHelper::UnmountAllSharedDirectories()
 bool CouchPlayHelper::CopyFileToUser(const QString &sourcePath, const QString &targetPath,
                                       const QString &username)
 {
+    const HandlerScope handler(this, "CopyFileToUser");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -1238,6 +2192,7 @@ bool CouchPlayHelper::CopyFileToUser(const QString &sourcePath, const QString &t
 bool CouchPlayHelper::WriteFileToUser(const QByteArray &content, const QString &targetPath,
                                        const QString &username)
 {
+    const HandlerScope handler(this, "WriteFileToUser");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -1259,48 +2214,143 @@ bool CouchPlayHelper::WriteFileToUser(const QByteArray &content, const QString &
         return false;
     }
 
+    QString error;
+    if (!writeUserFile(content, targetPath, username, error)) {
+        sendErrorReply(QDBusError::Failed, error);
+        return false;
+    }
+
+    return true;
+}
+
+QVariantMap CouchPlayHelper::CopyFileDescriptorToUser(const QDBusUnixFileDescriptor &source,
+                                                     const QString &targetPath, const QString &username)
+{
+    const HandlerScope handler(this, "CopyFileDescriptorToUser");
+    QVariantMap result;
+    result[QStringLiteral("success")] = false;
+
+    // Validate username
+    static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
+    if (!validUsername.match(username).hasMatch()) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("Invalid username format"));
+        return result;
+    }
+
+    if (!checkAuthorization(ACTION_MANAGE_MOUNTS)) {
+        sendErrorReply(QDBusError::AccessDenied,
+            QStringLiteral("Not authorized to copy files"));
+        return result;
+    }
+
+    if (!userExists(username)) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("User '%1' does not exist").arg(username));
+        return result;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const FileTransfer transfer = transferUserFile(source, targetPath, username);
+    result[QStringLiteral("success")] = transfer.success;
+    result[QStringLiteral("bytes")] = transfer.bytes;
+    result[QStringLiteral("elapsedMs")] = timer.elapsed();
+    result[QStringLiteral("method")] = transfer.method;
+    if (!transfer.success) {
+        qWarning() << "CopyFileDescriptorToUser: Failed to write" << targetPath << "-" << transfer.error;
+        result[QStringLiteral("error")] = transfer.error;
+    }
+    return result;
+}
+
+FileTransfer CouchPlayHelper::transferUserFile(const QDBusUnixFileDescriptor &source, const QString &targetPath,
+                                               const QString &username)
+{
+    FileTransfer transfer;
+
+    // Only regular files (memfd included): a pipe or socket could block the helper
+    struct stat st;
+    if (!source.isValid() || fstat(source.fileDescriptor(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        transfer.error = QStringLiteral("Source must be a regular file descriptor");
+        return transfer;
+    }
+
+    // Meant for arbitrary payloads, so unlike WriteFileToUser the target
+    // must stay inside the user's home
+    const QString userHome = getUserHome(username);
+    const QString cleanTarget = QDir::cleanPath(targetPath);
+    if (userHome.isEmpty() || !cleanTarget.startsWith(userHome + QLatin1Char('/'))) {
+        transfer.error = QStringLiteral("Target must be inside the home of '%1'").arg(username);
+        return transfer;
+    }
+
+    const uid_t uid = getUserUid(username);
+    struct passwd *pw = m_ops->getpwuid(uid);
+    if (!pw) {
+        transfer.error = QStringLiteral("Could not get user info for '%1'").arg(username);
+        return transfer;
+    }
+    // The user owns the home, so its directories are walked without following symlinks
+    return m_ops->transferFile(source.fileDescriptor(), userHome, cleanTarget, uid, pw->pw_gid, 0644);
+}
+
+bool CouchPlayHelper::prepareUserFileDirectory(const QString &targetPath, const QString &username,
+                                               uid_t &uid, gid_t &gid, QString &error)
+{
     // Get user info for ownership
     uint userUid = getUserUid(username);
     struct passwd *pw = m_ops->getpwuid(userUid);
     if (!pw) {
         qWarning() << "WriteFileToUser: Could not get user info for" << username;
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("Could not get user info for '%1'").arg(username));
+        error = QStringLiteral("Could not get user info for '%1'").arg(username);
         return false;
     }
+    uid = userUid;
+    gid = pw->pw_gid;
 
     // Create parent directories if needed
-    int lastSlash = targetPath.lastIndexOf(QLatin1Char('/'));
-    QString targetDir = (lastSlash >= 0) ? targetPath.left(lastSlash) : QStringLiteral(".");
+    const QString cleanTarget = QDir::cleanPath(targetPath);
+    const int lastSlash = cleanTarget.lastIndexOf(QLatin1Char('/'));
+    const QString targetDir = (lastSlash >= 0) ? cleanTarget.left(lastSlash) : QStringLiteral(".");
+
+    // Inside the home (which the user controls) no component may be a symlink,
+    // so nothing is created or chowned elsewhere
+    const QString userHome = getUserHome(username);
+    if (!userHome.isEmpty() && (targetDir == userHome || targetDir.startsWith(userHome + QLatin1Char('/')))) {
+        if (!m_ops->makeDirectoryBelow(userHome, targetDir, uid, gid, error)) {
+            qWarning() << "WriteFileToUser:" << error;
+            return false;
+        }
+        return true;
+    }
 
     if (!m_ops->mkpath(targetDir)) {
         qWarning() << "WriteFileToUser: Failed to create directory:" << targetDir;
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("Failed to create directory: %1").arg(targetDir));
+        error = QStringLiteral("Failed to create directory: %1").arg(targetDir);
         return false;
     }
+    return true;
+}
 
-    // Set ownership on created directories
-    QString userHome = getUserHome(username);
-    QStringList pathParts = targetDir.mid(userHome.length()).split(QLatin1Char('/'), Qt::SkipEmptyParts);
-    QString currentPath = userHome;
-    for (const QString &part : pathParts) {
-        currentPath += QStringLiteral("/") + part;
-        if (m_ops->fileExists(currentPath)) {
-            m_ops->chown(currentPath, userUid, pw->pw_gid);
-        }
+bool CouchPlayHelper::writeUserFile(const QByteArray &content, const QString &targetPath,
+                                    const QString &username, QString &error)
+{
+    uid_t userUid = 0;
+    gid_t userGid = 0;
+    if (!prepareUserFileDirectory(targetPath, username, userUid, userGid, error)) {
+        return false;
     }
 
     // Write the file
     if (!m_ops->writeFile(targetPath, content)) {
         qWarning() << "WriteFileToUser: Failed to write to" << targetPath;
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("Failed to write to file"));
+        error = QStringLiteral("Failed to write to file");
         return false;
     }
 
     // Set ownership on the file
-    if (m_ops->chown(targetPath, userUid, pw->pw_gid) != 0) {
+    if (m_ops->chown(targetPath, userUid, userGid) != 0) {
         qWarning() << "WriteFileToUser: Failed to set ownership on" << targetPath;
         // Don't fail - file was written successfully
     }
@@ -1315,6 +2365,7 @@ bool CouchPlayHelper::WriteFileToUser(const QByteArray &content, const QString &
 
 bool CouchPlayHelper::CreateUserDirectory(const QString &path, const QString &username)
 {
+    const HandlerScope handler(this, "CreateUserDirectory");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -1368,6 +2419,7 @@ bool CouchPlayHelper::CreateUserDirectory(const QString &path, const QString &us
 
 bool CouchPlayHelper::SetDirectoryAcl(const QString &path, const QString &username, bool recursive)
 {
+    const HandlerScope handler(this, "SetDirectoryAcl");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -1396,41 +2448,54 @@ bool CouchPlayHelper::SetDirectoryAcl(const QString &path, const QString &userna
         return false;
     }
 
-    // Build setfacl command
-    // setfacl -m u:username:rx /path (non-recursive)
-    // setfacl -R -m u:username:rx /path (recursive)
-    QStringList args;
-    if (recursive) {
-        args << QStringLiteral("-R");
+    QString error;
+    if (!applyAcl(path, username, recursive, error)) {
+        sendErrorReply(QDBusError::Failed, error);
+        return false;
     }
-    args << QStringLiteral("-m");
-    args << QStringLiteral("u:%1:rx").arg(username);
-    args << path;
 
-    QProcess *setfacl = m_ops->createProcess();
-    m_ops->startProcess(setfacl, QStringLiteral("setfacl"), args);
+    return true;
+}
 
-    if (!m_ops->waitForFinished(setfacl, 60000)) {  // 60 second timeout for recursive operations
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("setfacl timed out for path: %1").arg(path));
-        delete setfacl;
+bool CouchPlayHelper::applyAcl(const QString &path, const QString &username, bool recursive,
+                               QString &error)
+{
+    // Equivalent of setfacl [-R] -m u:username:rx, applied in-process.
+    // Entries that already grant rx are not rewritten, and for recursive
+    // grants the fingerprints from the previous run let unchanged
+    // directories skip their entries entirely.
+    const uid_t uid = getUserUid(username);
+    const DirectoryFingerprints known = recursive ? m_aclCache.load(path, uid) : DirectoryFingerprints();
+
+    AclResult acl = m_ops->grantUserAcl(path, uid, recursive, known);
+    if (!acl.success) {
+        m_aclCache.remove(path, uid);
+        error = QStringLiteral("Failed to set ACL on %1: %2").arg(path, acl.error);
         return false;
     }
 
-    if (m_ops->processExitCode(setfacl) != 0) {
-        QString errorOutput = QString::fromUtf8(m_ops->readStandardError(setfacl));
-        sendErrorReply(QDBusError::Failed,
-            QStringLiteral("setfacl failed for path %1: %2").arg(path, errorOutput));
-        delete setfacl;
-        return false;
+    if (acl.failed > 0) {
+        qWarning() << "SetDirectoryAcl:" << acl.failed << "entries under" << path
+                   << "could not be updated, first error:" << acl.error;
+    }
+    qDebug() << "SetDirectoryAcl:" << path << "-" << acl.updated << "updated,"
+             << acl.unchanged << "already set," << acl.skipped << "unchanged directories skipped";
+
+    if (recursive) {
+        // Only a complete pass may be trusted next time
+        if (acl.failed == 0 && !acl.directories.isEmpty()) {
+            m_aclCache.store(path, uid, acl.directories);
+        } else {
+            m_aclCache.remove(path, uid);
+        }
     }
-    delete setfacl;
 
     return true;
 }
 
 bool CouchPlayHelper::SetPathAclWithParents(const QString &path, const QString &username)
 {
+    const HandlerScope handler(this, "SetPathAclWithParents");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -1459,6 +2524,12 @@ bool CouchPlayHelper::SetPathAclWithParents(const QString &path, const QString &
         return false;
     }
 
+    QString error;
+    return applyAclWithParents(path, username, error);
+}
+
+bool CouchPlayHelper::applyAclWithParents(const QString &path, const QString &username, QString &error)
+{
     // Safe boundaries where we stop traversing upward
     // These are directories that either already have proper permissions
     // or we shouldn't modify
@@ -1513,6 +2584,9 @@ bool CouchPlayHelper::SetPathAclWithParents(const QString &path, const QString &
     }
 
     // Set ACL on each path (non-recursive, just rx for traversal)
+    // The remaining paths are still tried after a failure, but the caller
+    // is told the user may not be able to reach the target
+    const uid_t uid = getUserUid(username);
     bool allSucceeded = true;
     for (const QString &p : pathsToSet) {
         if (!m_ops->fileExists(p)) {
@@ -1520,28 +2594,14 @@ bool CouchPlayHelper::SetPathAclWithParents(const QString &path, const QString &
             continue;
         }
 
-        QStringList args;
-        args << QStringLiteral("-m");
-        args << QStringLiteral("u:%1:rx").arg(username);
-        args << p;
-
-        QProcess *setfacl = m_ops->createProcess();
-        m_ops->startProcess(setfacl, QStringLiteral("setfacl"), args);
-
-        if (!m_ops->waitForFinished(setfacl, 5000)) {
-            qWarning() << "SetPathAclWithParents: setfacl timed out for:" << p;
+        AclResult acl = m_ops->grantUserAcl(p, uid, false, {});
+        if (!acl.success) {
+            qWarning() << "SetPathAclWithParents: Failed to set ACL on" << p << ":" << acl.error;
+            if (allSucceeded) {
+                error = QStringLiteral("Failed to set ACL on %1: %2").arg(p, acl.error);
+            }
             allSucceeded = false;
-            delete setfacl;
-            continue;
-        }
-
-        if (m_ops->processExitCode(setfacl) != 0) {
-            QString errorOutput = QString::fromUtf8(m_ops->readStandardError(setfacl));
-            qWarning() << "SetPathAclWithParents: setfacl failed for" << p << ":" << errorOutput;
-            // Continue anyway - some paths might not support ACLs (e.g., NTFS)
-            // but mount point does
         }
-        delete setfacl;
     }
 
     return allSucceeded;
@@ -1549,6 +2609,7 @@ bool CouchPlayHelper::SetPathAclWithParents(const QString &path, const QString &
 
 QString CouchPlayHelper::GetUserSteamId(const QString &username)
 {
+    const HandlerScope handler(this, "GetUserSteamId");
     // Validate username
     static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
     if (!validUsername.match(username).hasMatch()) {
@@ -1593,3 +2654,268 @@ QString CouchPlayHelper::GetUserSteamId(const QString &username)
 
     return QString();
 }
+
+QVariantMap CouchPlayHelper::PrepareInstance(const QString &username, uint compositorUid,
+                                             const QVariantMap &spec)
+{
+    const HandlerScope handler(this, "PrepareInstance");
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+
+    QVariantMap result;
+    result[QStringLiteral("success")] = false;
+    result[QStringLiteral("pid")] = qint64(0);
+
+    // Validate username
+    static QRegularExpression validUsername(QStringLiteral("^[a-z][a-z0-9_-]{0,31}$"));
+    if (!validUsername.match(username).hasMatch()) {
+        sendErrorReply(QDBusError::InvalidArgs, 
+            QStringLiteral("Invalid username format"));
+        return result;
+    }
+
+    // A single authorization covers every step below
+    if (!checkAuthorization(ACTION_PREPARE_INSTANCE)) {
+        sendErrorReply(QDBusError::AccessDenied, 
+            QStringLiteral("Not authorized to prepare instances"));
+        return result;
+    }
+
+    // Resolve both users once for all steps (copy out of the static passwd buffer)
+    struct passwd *pw = m_ops->getpwnam(username.toLocal8Bit().constData());
+    if (!pw) {
+        sendErrorReply(QDBusError::InvalidArgs, 
+            QStringLiteral("User '%1' does not exist").arg(username));
+        return result;
+    }
+    const uint userUid = pw->pw_uid;
+    const gid_t userGid = pw->pw_gid;
+    const QString userHome = QString::fromLocal8Bit(pw->pw_dir);
+
+    const QString compositorHome = getUserHomeByUid(compositorUid);
+    if (compositorHome.isEmpty()) {
+        sendErrorReply(QDBusError::InvalidArgs,
+            QStringLiteral("Compositor user with UID %1 does not exist").arg(compositorUid));
+        return result;
+    }
+
+    const PrepareInstanceSpec request = PrepareInstanceSpec::fromVariantMap(spec);
+
+    // Caches are read from the compositor's home as root, so that home must
+    // be the caller's own and not one it merely names
+    uint callerId = 0;
+    if (!request.sharedCaches.isEmpty() && (!callerUid(callerId) || callerId != compositorUid)) {
+        sendErrorReply(QDBusError::AccessDenied,
+            QStringLiteral("Caches can only be shared from the caller's own home"));
+        return result;
+    }
+
+    QStringList steps;
+    QElapsedTimer stepTimer;
+    auto recordStep = [&](const QString &name, bool success, int count, const QString &error) {
+        const qint64 elapsedUs = stepTimer.nsecsElapsed() / 1000;
+        m_trace.record(name, HelperTrace::nowUs() - elapsedUs, elapsedUs);
+        steps << name;
+        result[name + QStringLiteral(".success")] = success;
+        result[name + QStringLiteral(".count")] = count;
+        result[name + QStringLiteral(".elapsedMs")] = stepTimer.elapsed();
+        if (!error.isEmpty()) {
+            result[name + QStringLiteral(".error")] = error;
+        }
+    };
+
+    QString failure;  // Set when a required step fails
+    QStringList changedDevices;
+    const qsizetype existingMounts = m_activeMounts.value(username).size();
+
+    // Step 0: user session - linger and compositor socket access (best effort)
+    if (request.session) {
+        stepTimer.start();
+        QString error;
+        bool success = IsLingerEnabled(username) || applyLinger(username, error);
+        if (!m_runtimeAccessSetForUid.contains(compositorUid)) {
+            QString accessError;
+            if (!applyRuntimeAccess(compositorUid, accessError)) {
+                success = false;
+                if (error.isEmpty()) {
+                    error = accessError;
+                }
+            }
+        }
+        recordStep(QStringLiteral("session"), success, success ? 1 : 0, error);
+    }
+
+    // Step 1: device ownership (required)
+    if (!request.devices.isEmpty()) {
+        stepTimer.start();
+        QString error;
+        for (const QString &path : request.devices) {
+            if (!isValidDevicePath(path)) {
+                error = QStringLiteral("Invalid device path: %1").arg(path);
+                break;
+            }
+            if (request.routeDevices) {
+                if (applyDeviceRoute(path, userUid, userGid, error).isEmpty()) {
+                    break;
+                }
+            } else if (!applyDeviceOwner(path, userUid, userGid, error)) {
+                break;
+            }
+            changedDevices << path;
+        }
+        recordStep(QStringLiteral("devices"), error.isEmpty(), changedDevices.size(), error);
+        failure = error;
+    }
+
+    // Step 2: shared directory bind mounts (best effort, like MountSharedDirectories)
+    if (failure.isEmpty() && !request.sharedDirectories.isEmpty()) {
+        stepTimer.start();
+        int count = 0;
+        for (const QString &dirSpec : request.sharedDirectories) {
+            if (bindMount(username, dirSpec, userHome, compositorHome, compositorUid)) {
+                count++;
+            }
+        }
+        recordStep(QStringLiteral("mounts"), count == request.sharedDirectories.size(), count, QString());
+    }
+
+    // Step 3: launcher ACLs (best effort - some filesystems don't support ACLs)
+    if (failure.isEmpty() && !(request.aclPaths.isEmpty() && request.recursiveAclPaths.isEmpty())) {
+        stepTimer.start();
+        int count = 0;
+        QString error;
+        for (const QString &path : request.aclPaths) {
+            if (!m_ops->fileExists(path)) {
+                error = QStringLiteral("Path does not exist: %1").arg(path);
+                continue;
+            }
+            if (applyAclWithParents(path, username, error)) {
+                count++;
+            }
+        }
+        for (const QString &path : request.recursiveAclPaths) {
+            if (!m_ops->fileExists(path)) {
+                error = QStringLiteral("Path does not exist: %1").arg(path);
+                continue;
+            }
+            if (applyAcl(path, username, true, error)) {
+                count++;
+            }
+        }
+        const int requested = request.aclPaths.size() + request.recursiveAclPaths.size();
+        recordStep(QStringLiteral("acls"), count == requested, count, error);
+    }
+
+    // Step 4: config files such as shortcuts.vdf (best effort)
+    if (failure.isEmpty() && !request.files.isEmpty()) {
+        stepTimer.start();
+        int count = 0;
+        QString error;
+        qint64 bytes = 0;
+        for (auto it = request.files.constBegin(); it != request.files.constEnd(); ++it) {
+            if (it.value().userType() == qMetaTypeId<QDBusUnixFileDescriptor>()) {
+                const FileTransfer transfer =
+                    transferUserFile(it.value().value<QDBusUnixFileDescriptor>(), it.key(), username);
+                if (transfer.success) {
+                    bytes += transfer.bytes;
+                    count++;
+                } else {
+                    error = transfer.error;
+                }
+            } else if (writeUserFile(it.value().toByteArray(), it.key(), username, error)) {
+                bytes += it.value().toByteArray().size();
+                count++;
+            }
+        }
+        recordStep(QStringLiteral("files"), count == request.files.size(), count, error);
+        result[QStringLiteral("files.bytes")] = bytes;
+    }
+
+    // Step 5: shared caches, seeded by reflink where the user has none yet (best effort)
+    if (failure.isEmpty() && !request.sharedCaches.isEmpty()) {
+        stepTimer.start();
+        int count = 0;
+        QString error;
+        qint64 bytes = 0;
+        for (const QString &path : request.sharedCaches) {
+            // Checked as given; seedDirectory() refuses symlinks below the home
+            const QString source = QDir::cleanPath(path);
+            if (!source.startsWith(compositorHome + QLatin1Char('/'))) {
+                error = QStringLiteral("Cache must be inside the compositor's home: %1").arg(path);
+                continue;
+            }
+            // An existing copy (or a mounted steam root) is the player's own, never replaced
+            const QString target = computeMountTarget(source, QString(), userHome, compositorHome);
+            if (m_ops->fileExists(target)) {
+                count++;
+                continue;
+            }
+            uid_t uid = 0;
+            gid_t gid = 0;
+            if (!prepareUserFileDirectory(target, username, uid, gid, error)) {
+                continue;
+            }
+            const FileTransfer transfer = m_ops->seedDirectory(source, target, uid, gid, compositorHome);
+            if (transfer.success) {
+                bytes += transfer.bytes;
+                count++;
+            } else {
+                error = transfer.error;
+            }
+        }
+        recordStep(QStringLiteral("caches"), count == request.sharedCaches.size(), count, error);
+        result[QStringLiteral("caches.bytes")] = bytes;
+    }
+
+    // Step 6: launch (required when requested)
+    if (failure.isEmpty() && request.launch) {
+        stepTimer.start();
+        QString error;
+        const QVariantMap unitProperties = unitResourceProperties(request.resources, error);
+        qint64 pid = error.isEmpty()
+            ? startInstanceProcess(username, compositorUid, request.gamescopeArgs,
+                                   request.gameCommand, request.environment, unitProperties, error)
+            : 0;
+        recordStep(QStringLiteral("launch"), pid > 0, pid > 0 ? 1 : 0, error);
+        if (pid > 0) {
+            result[QStringLiteral("pid")] = pid;
+        } else {
+            failure = error;
+        }
+    }
+
+    if (!failure.isEmpty()) {
+        // Undo what this call changed so the instance is left untouched
+        stepTimer.start();
+        struct group *inputGroup = m_ops->getgrnam("input");
+        gid_t inputGid = inputGroup ? inputGroup->gr_gid : 0;
+        for (const QString &path : std::as_const(changedDevices)) {
+            if (request.routeDevices) {
+                if (m_inputRouter) {
+                    m_inputRouter->unroute(path);
+                }
+            } else {
+                restoreDevice(path, inputGid);
+            }
+        }
+
+        int unmounted = 0;
+        if (m_activeMounts.contains(username)) {
+            QList<MountInfo> &mounts = m_activeMounts[username];
+            unmounted = unmountAll(mounts.mid(existingMounts));
+            mounts.remove(existingMounts, mounts.size() - existingMounts);
+            if (mounts.isEmpty()) {
+                m_activeMounts.remove(username);
+            }
+        }
+        recordStep(QStringLiteral("rollback"), true, changedDevices.size() + unmounted, QString());
+
+        qWarning() << "PrepareInstance: Failed for user" << username << "-" << failure;
+        result[QStringLiteral("error")] = failure;
+    }
+
+    result[QStringLiteral("success")] = failure.isEmpty();
+    result[QStringLiteral("steps")] = steps;
+    result[QStringLiteral("elapsedMs")] = totalTimer.elapsed();
+    return result;
+}
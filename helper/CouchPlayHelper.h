@@ -5,15 +5,29 @@
 
 #include <QObject>
 #include <QDBusContext>
+#include <QDBusUnixFileDescriptor>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QMap>
 #include <QProcess>
 #include <QSet>
 #include <QString>
 #include <QStringList>
+#include <QThreadPool>
+#include <QVariantMap>
 
+#include <functional>
+
+#include "AclStateCache.h"
+#include "HelperMetrics.h"
+#include "HelperTrace.h"
 #include "SystemOps.h"
 
 // Forward declaration
+class InputRouter;
+class InstanceSupervisor;
+class QDBusServiceWatcher;
+class QTimer;
 class RealSystemOps;
 
 /**
@@ -24,7 +38,7 @@ class RealSystemOps;
  * - Creating Linux users for secondary players
  * - Enabling systemd linger for user sessions
  * - Setting up Wayland socket ACLs
- * - Changing input device ownership
+ * - Changing input device ownership, or routing devices to players
  *
  * D-Bus interface: io.github.hikaps.CouchPlayHelper
  * Object path: /io/github/hikaps/CouchPlayHelper
@@ -38,6 +52,19 @@ public:
     explicit CouchPlayHelper(SystemOps *ops = nullptr, QObject *parent = nullptr);
     ~CouchPlayHelper() override;
 
+    // Where recursive ACL grants are remembered (default /var/lib/couchplay/acl)
+    void setAclCacheDirectory(const QString &directory);
+    // Home that ephemeral players are cloned from (default /var/lib/couchplay/template)
+    void setTemplateDirectory(const QString &directory);
+    // Write GetMetrics() in the Prometheus text format to @p path every
+    // METRICS_INTERVAL_MS (empty: don't)
+    void setMetricsFile(const QString &path);
+    bool writeMetricsFile();
+    // How long a session grant outlives the last call it authorized
+    void setSessionGrantTimeout(int msecs);
+
+    static constexpr int METRICS_INTERVAL_MS = 15000;
+
 public Q_SLOTS:
     /**
      * Create a new Linux user for split-screen gaming
@@ -49,13 +76,53 @@ public Q_SLOTS:
      */
     uint CreateUser(const QString &username, const QString &fullName);
 
+    /**
+     * Create a throwaway player from the saved template home
+     *
+     * Like CreateUser, but the home is a reflink clone of the template
+     * (see SaveUserTemplate) owned by the new user, so Steam's runtime and
+     * controller configs are there from the start and nothing is
+     * downloaded again. The user is also added to the couchplay-guest
+     * group so the client can discard it when the session ends. Needs a
+     * filesystem that can share extents (btrfs, XFS).
+     *
+     * @param username Desired username (lowercase, alphanumeric)
+     * @param fullName Full name for the user
+     * @return UID of created user, or 0 on failure
+     */
+    uint CreateEphemeralUser(const QString &username, const QString &fullName);
+
+    /**
+     * Save a player's home as the template for ephemeral players
+     *
+     * The home is reflinked into the template directory, owned by root,
+     * and replaces the previous template atomically once complete. Every
+     * guest gets a copy, so the player should be logged out of Steam and
+     * anything else that keeps credentials.
+     *
+     * @param username Player whose home to copy (must be in couchplay group)
+     * @return true if successful
+     */
+    bool SaveUserTemplate(const QString &username);
+
+    /**
+     * Check whether a template for ephemeral players has been saved
+     */
+    bool HasUserTemplate();
+
     /**
      * Delete a CouchPlay user account
      * Only users in the couchplay group can be deleted
      *
+     * Returns once the request is validated. The teardown runs in the
+     * background: linger and the user's processes first, then SysV IPC,
+     * /tmp and /dev/shm at the same time, then userdel. Each finished step
+     * emits UserDeletionProgress, the end UserDeletionFinished. Several
+     * users can be deleted at once, the same user only once at a time.
+     *
      * @param username Username to delete (must be in couchplay group)
      * @param removeHome If true, also delete the user's home directory
-     * @return true if successful
+     * @return true if the deletion was started
      */
     bool DeleteUser(const QString &username, bool removeHome);
 
@@ -150,6 +217,45 @@ public Q_SLOTS:
      */
     int ResetAllDevices();
 
+    /**
+     * Route an input device to a user through the input router
+     *
+     * Alternative to ChangeDeviceOwner(): the physical device is grabbed and
+     * its events are forwarded to a virtual device owned by @p uid. Routing
+     * an already routed device to another user only swaps the forwarding
+     * target, so reassignment is instant.
+     *
+     * @param devicePath Path to the physical device (e.g., /dev/input/event5)
+     * @param uid User ID that should receive the device's input
+     * @return Path of the user's virtual event node
+     */
+    QString RouteDevice(const QString &devicePath, uint uid);
+
+    /**
+     * Stop routing a device and release the grab
+     *
+     * @param devicePath Path to the physical device
+     * @return true if the device was routed
+     */
+    bool UnrouteDevice(const QString &devicePath);
+
+    /**
+     * Release every routed device
+     * Called automatically on helper shutdown
+     *
+     * @return Number of devices released
+     */
+    int StopInputRouting();
+
+    /**
+     * Get input router statistics
+     *
+     * @return "devices", "virtualDevices", "events", "batches", "dropped"
+     *         and per-event forwarding latency "latencyMeanUs",
+     *         "latencyP50Us", "latencyP99Us", "latencyMaxUs"
+     */
+    QVariantMap GetInputRouterStats();
+
     /**
      * Get version of the helper daemon
      *
@@ -157,13 +263,81 @@ public Q_SLOTS:
      */
     QString Version();
 
+    /**
+     * Record how long this caller's calls take, see HelperTrace
+     *
+     * Needs no authorization: a caller only ever gets the timings of its
+     * own calls back.
+     */
+    void BeginTrace();
+
+    /**
+     * Attribute the caller's next call of @p method to its span @p spanId
+     */
+    void SetTraceParent(const QString &method, qulonglong spanId);
+
+    /**
+     * Stop recording and return what was recorded since BeginTrace
+     *
+     * @return "pid" of the helper and "spans" (see HelperTrace::take())
+     */
+    QVariantMap TakeTrace();
+
+    /**
+     * Call counts and latencies since the helper started, see HelperMetrics
+     *
+     * @return HelperMetrics::snapshot() with the gauges "activeMounts",
+     *         "instances", "ownedDevices" and "userDeletions"
+     */
+    QVariantMap GetMetrics();
+
+    /**
+     * Authorize the caller once for a whole session
+     *
+     * Asks polkit for the start-session action, prompting if needed. When
+     * granted, the caller's session calls (device ownership, display
+     * access, mounts, preparing and launching instances) are authorized
+     * in-process until EndSession(), the caller disconnecting, or
+     * SESSION_GRANT_TIMEOUT_MS without such a call while it has no instance
+     * running and no mount up. Creating and deleting
+     * users and linger are not covered, see AuthorizeAction(). Calling it
+     * again while the grant is live just renews it.
+     *
+     * Other methods never prompt: without a grant they fail with
+     * AccessDenied, and the client authorizes here or in AuthorizeAction()
+     * and calls again. Stopping, killing and unmounting what the caller
+     * set up itself needs no grant.
+     *
+     * @return "authorized" and "expiresInMs"
+     */
+    QVariantMap AuthorizeSession();
+
+    /**
+     * Authorize the caller's next call that needs @p action
+     *
+     * For the actions polkit grants with a prompt every time (creating and
+     * deleting users, linger). Asks polkit, prompting if needed; the grant
+     * is used up by that call or lapses after ACTION_GRANT_TIMEOUT_MS.
+     *
+     * @param action One of CouchPlay's polkit action IDs
+     * @return Whether polkit granted it
+     */
+    bool AuthorizeAction(const QString &action);
+
+    /**
+     * Drop the caller's session grant
+     */
+    void EndSession();
+
     /**
      * Launch a gamescope instance as a specified user
      *
      * This method handles all the complexity of running gamescope as any user:
      * - Sets up runtime access for couchplay group (once per compositor)
-     * - Spawns the process via machinectl shell
-     * - Returns the PID for tracking
+     * - Starts gamescope as a transient systemd service running as the user,
+     *   logging to the journal (identifier couchplay-USER); falls back to
+     *   machinectl shell if systemd refuses the unit
+     * - Returns the gamescope PID for tracking
      *
      * @param username User to run as
      * @param compositorUid UID of compositor user (for runtime access setup)
@@ -193,6 +367,54 @@ public Q_SLOTS:
      */
     bool KillInstance(qint64 pid);
 
+    /**
+     * Change the cgroup resource controls of a running instance
+     *
+     * Keys (all optional, 0 or empty keeps the default):
+     * - "cpuWeight" (int, 1-10000): CPU share relative to other instances
+     * - "ioWeight" (int, 1-10000): block IO share
+     * - "memoryHighMb" (int): memory.high, reclaim pressure above this
+     * - "cpuCores" (string, e.g. "0-3,8-11"): cpuset the instance may run on
+     *
+     * Only instances launched as transient units can be changed; the change
+     * lasts until the instance exits.
+     *
+     * @param pid Instance PID returned by LaunchInstance or PrepareInstance
+     * @param resources Resource controls as described above
+     * @return true if the controls were applied
+     */
+    bool SetInstanceResources(qint64 pid, const QVariantMap &resources);
+
+    /**
+     * GPU usage of a launched instance from its processes' DRM fdinfo
+     *
+     * fdinfo of another user's processes is only readable by root, so the
+     * client asks here instead of reading it itself. Limited to instances
+     * launched by this helper; needs no authorization since it only reads
+     * counters.
+     *
+     * @param pid Instance PID returned by LaunchInstance or PrepareInstance
+     * @return DrmFdinfo::toVariantMap() of the instance's process tree
+     */
+    QVariantMap GetInstanceGpuUsage(qint64 pid);
+
+    /**
+     * Read an instance's output back from the journal
+     *
+     * Instances log to the journal under the identifier "couchplay-USER"
+     * (transient units also add COUCHPLAY_USER and COUCHPLAY_INSTANCE
+     * fields). The system journal isn't readable by the client, so it tails
+     * it through here: pass the returned cursor back to get what was logged
+     * since, at most @p maxLines per call.
+     *
+     * @param username Player whose instance to read
+     * @param cursor Cursor from the previous call, empty for the last @p maxLines
+     * @param maxLines Entries to return, 1-1000
+     * @return "entries" (list of {"message", "timestamp" (ms since the
+     *         epoch), "priority" (syslog level)}, oldest first) and "cursor"
+     */
+    QVariantMap ReadInstanceLog(const QString &username, const QString &cursor, int maxLines);
+
     /**
      * Mount shared directories for a user
      *
@@ -201,9 +423,17 @@ public Q_SLOTS:
      * relative path. For paths outside, they're mounted at the specified alias
      * or under ~/.couchplay/mounts/ if no alias is provided.
      *
+     * With the "overlay" mode the user gets a writable view instead: an
+     * overlay of an idmapped, read-only mount of the source (files owned by
+     * the compositor user appear as the user's own) under a per-user upper
+     * layer in /var/lib/couchplay/overlays/. Setup cost doesn't depend on the
+     * size of the tree and no ACLs are needed. Falls back to a bind mount
+     * where the kernel or filesystem can't do this.
+     *
      * @param username Target user (must exist)
      * @param compositorUid UID of the compositor user (for determining home-relative paths)
-     * @param directories List of "source|alias" strings (alias empty for home-relative)
+     * @param directories List of "source|alias" or "source|alias|overlay" strings
+     *                    (alias empty for home-relative)
      * @return Number of successful mounts
      */
     int MountSharedDirectories(const QString &username, uint compositorUid,
@@ -304,15 +534,122 @@ public Q_SLOTS:
     bool WriteFileToUser(const QByteArray &content, const QString &targetPath,
                          const QString &username);
 
+    /**
+     * Copy a file the caller opened into a user's directory
+     *
+     * The content never travels over the bus: @p source is a regular file or
+     * memfd (ideally sealed), read from offset 0. It is reflinked where the
+     * filesystem allows, copied in the kernel otherwise, and replaces
+     * @p targetPath atomically, owned by the user with mode 0644.
+     * @p targetPath must lie inside the user's home.
+     *
+     * @param source Descriptor to read the content from
+     * @param targetPath Target file path (will be created/overwritten)
+     * @param username Target user
+     * @return "success" (bool), "bytes" (qint64), "elapsedMs" (qint64),
+     *         "method" ("reflink", "copy_file_range", "sendfile" or "copy")
+     *         and "error" when it failed
+     */
+    QVariantMap CopyFileDescriptorToUser(const QDBusUnixFileDescriptor &source, const QString &targetPath,
+                                         const QString &username);
+
+    /**
+     * Prepare everything one player needs in a single call
+     *
+     * Authorizes once and resolves the user once, then runs the steps
+     * requested in @p spec (see PrepareInstanceSpec): user session setup
+     * (linger, runtime socket ACLs), device ownership,
+     * shared directory mounts, launcher ACLs, file writes, shared cache
+     * seeding and optionally the launch itself. Device ownership and launch are required: if either
+     * fails, the devices and mounts changed by this call are rolled back.
+     * The other steps are best effort and only reported.
+     *
+     * @param username Target user
+     * @param compositorUid UID of the user running the compositor
+     * @param spec PrepareInstanceSpec as a{sv}
+     * @return "success" (bool), "pid" (qint64, 0 unless launched), "error",
+     *         "elapsedMs", "steps" (names in execution order) and for each
+     *         step "<name>.success", "<name>.count", "<name>.elapsedMs" and
+     *         "<name>.error" when it failed
+     */
+    QVariantMap PrepareInstance(const QString &username, uint compositorUid,
+                                const QVariantMap &spec);
+
+Q_SIGNALS:
+    /**
+     * A step of DeleteUser finished: "linger", "processes", "ipc", "tmp",
+     * "shm" or "userdel"
+     */
+    void UserDeletionProgress(const QString &username, const QString &step);
+
+    /**
+     * DeleteUser is done; @p error is set when it failed
+     */
+    void UserDeletionFinished(const QString &username, bool success, const QString &error);
+
+    /**
+     * A launched instance exited
+     *
+     * @p status is the exit code, 128 + the signal number if it was killed,
+     * or -1 when the helper can't know it (transient units are children of
+     * systemd). @p runtimeMs counts from the launch.
+     */
+    void InstanceExited(qint64 pid, int status, qint64 runtimeMs);
+
 private:
+    // Times a D-Bus handler for HelperMetrics and, if the caller is tracing, HelperTrace
+    class HandlerScope
+    {
+    public:
+        HandlerScope(CouchPlayHelper *helper, const char *method);
+
+    private:
+        HelperMetrics::Call m_call;
+        HelperTrace::Scope m_trace;
+    };
+
     bool checkAuthorization(const QString &action);
+    // Whether @p client holds a live session grant covering @p action (renews it)
+    bool useSessionGrant(const QString &client, const QString &action);
+    // Whether @p client holds a live AuthorizeAction() grant of @p action (uses it up)
+    bool useActionGrant(const QString &client, const QString &action);
+    // Whether @p client launched an instance that still runs or made a mount that is still up
+    bool holdsResources(const QString &client);
+    // Whether the caller launched instance @p pid, which it may then stop without a grant
+    bool ownsInstance(qint64 pid) const;
+    // Whether the caller made every mount of @p username (of everyone if empty), and there is one
+    bool ownsMounts(const QString &username = QString()) const;
+    // Drops @p client's grants once it disconnects
+    void watchGrantHolder(const QString &client);
+    void dropSessionGrant(const QString &client);
     bool isValidDevicePath(const QString &path);
+    QString caller() const;  // The D-Bus sender of the current call, empty for internal calls
+    // The uid the bus daemon reports for caller(); false for internal calls or when unknown
+    bool callerUid(uint &uid) const;
+
+    // QDBusContext's, counting the running call as failed in HelperMetrics
+    void sendErrorReply(const QString &name, const QString &message = QString()) const;
+    void sendErrorReply(QDBusError::ErrorType type, const QString &message = QString()) const;
+
+    // SystemOps' process calls, accounted in HelperMetrics
+    void startProcess(QProcess *process, const QString &program, const QStringList &arguments);
+    bool waitForFinished(QProcess *process, int msecs);
+    QVariantMap metricsGauges() const;
 
     // Internal helpers (not exposed via D-Bus)
     bool userExists(const QString &username);
+    // useradd with the couchplay and input groups plus @p extraGroups, then
+    // linger (best effort); UID or 0 with @p error set
+    uint addUser(const QString &username, const QString &fullName, const QStringList &extraGroups,
+                 bool createHome, QString &error);
     uint getUserUid(const QString &username);
     QString getUserHome(const QString &username);
     QString getUserHomeByUid(uint uid);
+    QStringList instanceEnvironment(uint compositorUid, const QStringList &environment);
+    TransientUnitSpec buildInstanceUnit(const QString &username, uid_t uid, uint compositorUid,
+                                        const QStringList &gamescopeArgs,
+                                        const QString &gameCommand,
+                                        const QStringList &environment);
     QString buildInstanceCommand(const QString &username, uint compositorUid,
                                   const QStringList &gamescopeArgs,
                                   const QString &gameCommand,
@@ -320,19 +657,98 @@ private:
     QString computeMountTarget(const QString &source, const QString &alias,
                                const QString &userHome, const QString &compositorHome);
 
+    // Step implementations shared by the single-purpose methods and
+    // PrepareInstance (no validation or authorization, errors via @p error)
+    bool applyLinger(const QString &username, QString &error);
+    bool applyRuntimeAccess(uint compositorUid, QString &error);
+    bool applyDeviceOwner(const QString &devicePath, uint uid, gid_t gid, QString &error);
+    QString applyDeviceRoute(const QString &devicePath, uint uid, gid_t gid, QString &error);
+    bool restoreDevice(const QString &devicePath, gid_t inputGid);
+    bool bindMount(const QString &username, const QString &dirSpec,
+                   const QString &userHome, const QString &compositorHome, uint compositorUid);
+    bool overlayMount(const QString &username, const QString &source, const QString &target,
+                      uint compositorUid);
+    bool unmountTarget(const QString &target);
+    bool applyAcl(const QString &path, const QString &username, bool recursive, QString &error);
+    bool applyAclWithParents(const QString &path, const QString &username, QString &error);
+    bool prepareUserFileDirectory(const QString &targetPath, const QString &username,
+                                  uid_t &uid, gid_t &gid, QString &error);
+    bool writeUserFile(const QByteArray &content, const QString &targetPath,
+                       const QString &username, QString &error);
+    FileTransfer transferUserFile(const QDBusUnixFileDescriptor &source, const QString &targetPath,
+                                  const QString &username);
+    qint64 startInstanceProcess(const QString &username, uint compositorUid,
+                                const QStringList &gamescopeArgs,
+                                const QString &gameCommand,
+                                const QStringList &environment,
+                                const QVariantMap &unitProperties,
+                                QString &error);
+    static constexpr int MAX_LOG_LINES = 1000;
+
+    // SetInstanceResources() keys to systemd unit properties; empty on error
+    static QVariantMap unitResourceProperties(const QVariantMap &resources, QString &error);
+
+    // DeleteUser stages: the steps run concurrently on m_teardownPool, @p next
+    // follows once all are done. A step returns an error to end the deletion.
+    using TeardownStep = std::pair<QString, std::function<QString()>>;
+    void runTeardownStage(const QString &username, const QList<TeardownStep> &steps,
+                          const std::function<void()> &next);
+    void finishDeletion(const QString &username, const QString &error);
+
     QStringList m_modifiedDevices;
-    QMap<qint64, QProcess *> m_launchedProcesses;  // PID -> QProcess
+    QMap<qint64, QProcess *> m_launchedProcesses;  // PID -> QProcess (machinectl fallback)
+    QMap<qint64, QString> m_launchedUnits;  // gamescope PID -> transient unit name
+    QMap<qint64, QString> m_instanceOwners;  // PID -> client that launched it
 
     // Track active mounts per user for cleanup
     struct MountInfo {
         QString source;
         QString target;
+        QString layer;  // Idmapped lower layer of an overlay, unmounted after target
+        QString owner;  // Client that mounted it
     };
     QMap<QString, QList<MountInfo>> m_activeMounts;  // username -> list of mounts
+    // Detach @p mounts, newest first; how many targets came off
+    int unmountAll(const QList<MountInfo> &mounts);
 
     // Track which compositor UIDs have runtime access set up
     QSet<uint> m_runtimeAccessSetForUid;
 
+    // Fingerprints of trees already granted recursive ACLs
+    AclStateCache m_aclCache;
+
+    QString m_templateHome = QStringLiteral("/var/lib/couchplay/template");
+    // Upper layers of writable shares, per user and source
+    QString m_overlayRoot = QStringLiteral("/var/lib/couchplay/overlays");
+
+    // Deletions in progress: username -> steps of the current stage still running
+    QHash<QString, int> m_deletions;
+    QThreadPool m_teardownPool;
+
+    // Created on first RouteDevice (nullptr when unavailable)
+    InputRouter *m_inputRouter = nullptr;
+
     // System operations abstraction (for testing/mocking)
     SystemOps *m_ops;
+
+    // pidfds of launched instances, reports InstanceExited
+    InstanceSupervisor *m_supervisor;
+
+    // Handler timings for tracing clients
+    HelperTrace m_trace;
+
+    // Daemon-lifetime counters, see GetMetrics()
+    mutable HelperMetrics m_metrics;
+    QString m_metricsFile;
+    QTimer *m_metricsTimer = nullptr;
+
+    // Session grants: caller -> m_grantClock time (ms) the grant expires at
+    static constexpr int SESSION_GRANT_TIMEOUT_MS = 30 * 60 * 1000;
+    QHash<QString, qint64> m_sessionGrants;
+    QElapsedTimer m_grantClock;
+    int m_sessionGrantTimeout = SESSION_GRANT_TIMEOUT_MS;
+    // One-shot grants: caller -> action -> m_grantClock time (ms) the grant expires at
+    static constexpr int ACTION_GRANT_TIMEOUT_MS = 60 * 1000;
+    QHash<QString, QHash<QString, qint64>> m_actionGrants;
+    QDBusServiceWatcher *m_grantWatcher = nullptr;  // Drops grants of disconnected callers
 };
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QVariantMap>
+
+/**
+ * DrmFdinfo - GPU usage of a process tree from the DRM fdinfo of its fds
+ *
+ * Shared by the helper (which can read other users' fdinfo) and the
+ * client's InstanceTelemetry. See the kernel's drm-usage-stats document for
+ * the keys. Engine times are cumulative, callers take the difference of two
+ * samples. On the bus it travels as a{sv}: "clients", "memoryBytes" and one
+ * "engine.NAME" entry per engine, in nanoseconds.
+ */
+struct DrmFdinfo {
+    QHash<QString, qint64> engineNs; // Busy time per engine ("gfx", "render", ...)
+    qint64 memoryBytes = -1;         // VRAM (or device-local memory), -1 if not reported
+    int clients = 0;                 // DRM clients found, each counted once
+
+    QVariantMap toVariantMap() const
+    {
+        QVariantMap map;
+        map[QStringLiteral("clients")] = clients;
+        map[QStringLiteral("memoryBytes")] = memoryBytes;
+        for (auto it = engineNs.constBegin(); it != engineNs.constEnd(); ++it) {
+            map[QStringLiteral("engine.") + it.key()] = it.value();
+        }
+        return map;
+    }
+
+    static DrmFdinfo fromVariantMap(const QVariantMap &map)
+    {
+        DrmFdinfo usage;
+        usage.clients = map.value(QStringLiteral("clients")).toInt();
+        usage.memoryBytes = map.value(QStringLiteral("memoryBytes"), -1).toLongLong();
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            if (it.key().startsWith(QLatin1String("engine."))) {
+                usage.engineNs.insert(it.key().mid(7), it.value().toLongLong());
+            }
+        }
+        return usage;
+    }
+
+    /**
+     * PIDs of the instance @p pid belongs to: its whole cgroup when it runs
+     * in its own couchplay-*.service, otherwise just @p pid
+     */
+    static QList<qint64> processTree(qint64 pid,
+                                     const QString &procRoot = QStringLiteral("/proc"),
+                                     const QString &cgroupRoot = QStringLiteral("/sys/fs/cgroup"))
+    {
+        QFile cgroupFile(QStringLiteral("%1/%2/cgroup").arg(procRoot).arg(pid));
+        if (cgroupFile.open(QIODevice::ReadOnly)) {
+            const QList<QByteArray> lines = cgroupFile.readAll().split('\n');
+            for (const QByteArray &line : lines) {
+                if (!line.startsWith("0::")) {
+                    continue;
+                }
+                const QString cgroup = QString::fromUtf8(line.mid(3).trimmed());
+                if (!cgroup.contains(QLatin1String("/couchplay-")) || !cgroup.endsWith(QLatin1String(".service"))) {
+                    break;
+                }
+                QFile procs(cgroupRoot + cgroup + QStringLiteral("/cgroup.procs"));
+                if (!procs.open(QIODevice::ReadOnly)) {
+                    break;
+                }
+                QList<qint64> pids;
+                const QList<QByteArray> entries = procs.readAll().split('\n');
+                for (const QByteArray &entry : entries) {
+                    bool ok = false;
+                    const qint64 member = entry.trimmed().toLongLong(&ok);
+                    if (ok && member > 0) {
+                        pids.append(member);
+                    }
+                }
+                if (!pids.isEmpty()) {
+                    return pids;
+                }
+                break;
+            }
+        }
+        return {pid};
+    }
+
+    /**
+     * Sum the DRM clients open in @p pids. Only fds pointing at /dev/dri
+     * are read; a client shared between fds or processes is counted once.
+     */
+    static DrmFdinfo read(const QList<qint64> &pids, const QString &procRoot = QStringLiteral("/proc"))
+    {
+        DrmFdinfo usage;
+        QSet<QByteArray> seenClients;
+        qint64 memory = 0;
+        bool memoryReported = false;
+
+        for (qint64 pid : pids) {
+            const QString fdDir = QStringLiteral("%1/%2/fd").arg(procRoot).arg(pid);
+            const QStringList fds = QDir(fdDir).entryList(QDir::Files | QDir::System | QDir::NoDotAndDotDot);
+            for (const QString &fd : fds) {
+                if (!QFile::symLinkTarget(fdDir + QLatin1Char('/') + fd).startsWith(QLatin1String("/dev/dri/"))) {
+                    continue;
+                }
+                QFile fdinfo(QStringLiteral("%1/%2/fdinfo/%3").arg(procRoot).arg(pid).arg(fd));
+                if (!fdinfo.open(QIODevice::ReadOnly)) {
+                    continue;
+                }
+
+                QByteArray pdev;
+                QByteArray clientId;
+                QHash<QString, qint64> engines;
+                qint64 residentMemory = -1;
+                qint64 legacyMemory = -1;
+                const QList<QByteArray> lines = fdinfo.readAll().split('\n');
+                for (const QByteArray &line : lines) {
+                    const int colon = line.indexOf(':');
+                    if (colon <= 0 || !line.startsWith("drm-")) {
+                        continue;
+                    }
+                    const QByteArray key = line.left(colon);
+                    const QByteArray value = line.mid(colon + 1).trimmed();
+                    if (key == "drm-pdev") {
+                        pdev = value;
+                    } else if (key == "drm-client-id") {
+                        clientId = value;
+                    } else if (key.startsWith("drm-engine-") && !key.startsWith("drm-engine-capacity-")) {
+                        engines.insert(QString::fromLatin1(key.mid(11)), value.split(' ').first().toLongLong());
+                    } else if (key.startsWith("drm-resident-vram") || key.startsWith("drm-resident-local")) {
+                        residentMemory = qMax<qint64>(residentMemory, 0) + parseSize(value);
+                    } else if (key == "drm-memory-vram") {
+                        // Older amdgpu name, also still printed next to the resident keys
+                        legacyMemory = parseSize(value);
+                    }
+                }
+                const qint64 clientMemory = residentMemory >= 0 ? residentMemory : legacyMemory;
+
+                if (clientId.isEmpty() || seenClients.contains(pdev + '/' + clientId)) {
+                    continue;
+                }
+                seenClients.insert(pdev + '/' + clientId);
+                usage.clients++;
+                for (auto it = engines.constBegin(); it != engines.constEnd(); ++it) {
+                    usage.engineNs[it.key()] += it.value();
+                }
+                if (clientMemory >= 0) {
+                    memory += clientMemory;
+                    memoryReported = true;
+                }
+            }
+        }
+
+        usage.memoryBytes = memoryReported ? memory : -1;
+        return usage;
+    }
+
+    // "123 KiB" -> bytes; a bare number is already in bytes
+    static qint64 parseSize(const QByteArray &value)
+    {
+        const QList<QByteArray> parts = value.simplified().split(' ');
+        qint64 size = parts.value(0).toLongLong();
+        const QByteArray unit = parts.value(1);
+        if (unit == "KiB") {
+            size *= 1024;
+        } else if (unit == "MiB") {
+            size *= 1024 * 1024;
+        } else if (unit == "GiB") {
+            size *= qint64(1024) * 1024 * 1024;
+        }
+        return size;
+    }
+};
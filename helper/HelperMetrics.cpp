@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "HelperMetrics.h"
+
+#include <QMutexLocker>
+#include <QProcess>
+
+#include <algorithm>
+
+// Dynamic properties of a QProcess between processStarted() and processFinished()
+static const char PROGRAM_PROPERTY[] = "couchplayMetricsProgram";
+static const char START_PROPERTY[] = "couchplayMetricsStartNs";
+
+namespace {
+
+QByteArray seconds(quint64 micros)
+{
+    return QByteArray::number(double(micros) / 1e6, 'g', 9);
+}
+
+QByteArray label(const char *name, const QString &value)
+{
+    QString escaped = value;
+    escaped.replace(QLatin1Char('\\'), QLatin1String("\\\\")).replace(QLatin1Char('"'), QLatin1String("\\\""));
+    return QByteArray(name) + "=\"" + escaped.toUtf8() + '"';
+}
+
+// activeMounts -> active_mounts
+QByteArray snakeCase(const QString &name)
+{
+    QByteArray result;
+    for (const QChar c : name) {
+        if (c.isUpper()) {
+            result += '_';
+        }
+        result += char(c.toLower().toLatin1());
+    }
+    return result;
+}
+
+void appendHeader(QByteArray &out, const char *metric, const char *type, const char *help)
+{
+    out += QByteArray("# HELP ") + metric + ' ' + help + '\n';
+    out += QByteArray("# TYPE ") + metric + ' ' + type + '\n';
+}
+
+template<typename Map>
+QStringList sortedKeys(const Map &map)
+{
+    QStringList keys = map.keys();
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+} // namespace
+
+HelperMetrics::Call::Call(HelperMetrics &metrics, const char *method)
+    : m_metrics(metrics)
+    , m_method(method)
+    , m_outer(metrics.m_current)
+{
+    m_metrics.m_current = this;
+    m_timer.start();
+}
+
+HelperMetrics::Call::~Call()
+{
+    m_metrics.m_current = m_outer;
+    m_metrics.recordCall(QString::fromLatin1(m_method), quint64(m_timer.nsecsElapsed() / 1000), m_failed);
+}
+
+HelperMetrics::HelperMetrics()
+{
+    m_uptime.start();
+}
+
+void HelperMetrics::fail()
+{
+    if (m_current) {
+        m_current->m_failed = true;
+    }
+}
+
+HelperMetrics::Series &HelperMetrics::series(QHash<QString, std::shared_ptr<Series>> &map, const QString &name)
+{
+    std::shared_ptr<Series> &entry = map[name];
+    if (!entry) {
+        entry = std::make_shared<Series>();
+    }
+    return *entry;
+}
+
+void HelperMetrics::recordCall(const QString &method, quint64 micros, bool failed)
+{
+    QMutexLocker locker(&m_mutex);
+    Series &entry = series(m_methods, method);
+    entry.latency.record(micros);
+    if (failed) {
+        ++entry.failures;
+    }
+}
+
+void HelperMetrics::recordAuthorization(quint64 micros, bool granted)
+{
+    QMutexLocker locker(&m_mutex);
+    m_authorization.latency.record(micros);
+    if (!granted) {
+        ++m_authorization.failures;
+    }
+}
+
+void HelperMetrics::processStarted(QProcess *process, const QString &program)
+{
+    process->setProperty(PROGRAM_PROPERTY, program);
+    process->setProperty(START_PROPERTY, m_uptime.nsecsElapsed());
+
+    QMutexLocker locker(&m_mutex);
+    ++series(m_processes, program).running;
+}
+
+void HelperMetrics::processFinished(QProcess *process, bool finished, int exitCode)
+{
+    const QString program = process->property(PROGRAM_PROPERTY).toString();
+    if (program.isEmpty()) {
+        return;  // Not started through processStarted(), or already accounted for
+    }
+    const qint64 startNs = process->property(START_PROPERTY).toLongLong();
+    process->setProperty(PROGRAM_PROPERTY, QVariant());
+    process->setProperty(START_PROPERTY, QVariant());
+
+    // A wait that gave up on a live process is a timeout, e.g. a hung mount;
+    // one that returned for a process that never ran is a failed spawn
+    const bool timedOut = !finished && process->state() != QProcess::NotRunning;
+
+    QMutexLocker locker(&m_mutex);
+    Series &entry = series(m_processes, program);
+    --entry.running;
+    entry.latency.record(quint64(qMax<qint64>(0, m_uptime.nsecsElapsed() - startNs) / 1000));
+    if (timedOut) {
+        ++entry.timeouts;
+    }
+    if (!finished || exitCode != 0) {
+        ++entry.failures;
+    }
+}
+
+QVariantMap HelperMetrics::seriesMap(const Series &series)
+{
+    return {
+        {QStringLiteral("count"), series.latency.count()},
+        {QStringLiteral("failures"), series.failures},
+        {QStringLiteral("meanUs"), series.latency.mean()},
+        {QStringLiteral("p50Us"), series.latency.percentile(0.5)},
+        {QStringLiteral("p99Us"), series.latency.percentile(0.99)},
+        {QStringLiteral("maxUs"), series.latency.maximum()},
+    };
+}
+
+QVariantMap HelperMetrics::snapshot(const QVariantMap &gauges) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QVariantMap methods;
+    for (auto it = m_methods.cbegin(); it != m_methods.cend(); ++it) {
+        methods.insert(it.key(), seriesMap(*it.value()));
+    }
+
+    QVariantMap processes;
+    for (auto it = m_processes.cbegin(); it != m_processes.cend(); ++it) {
+        QVariantMap entry = seriesMap(*it.value());
+        entry.insert(QStringLiteral("timeouts"), it.value()->timeouts);
+        entry.insert(QStringLiteral("running"), it.value()->running);
+        processes.insert(it.key(), entry);
+    }
+
+    return {
+        {QStringLiteral("uptimeMs"), m_uptime.elapsed()},
+        {QStringLiteral("methods"), methods},
+        {QStringLiteral("authorization"), seriesMap(m_authorization)},
+        {QStringLiteral("processes"), processes},
+        {QStringLiteral("gauges"), gauges},
+    };
+}
+
+void HelperMetrics::appendHistogram(QByteArray &out, const char *metric, const QByteArray &labels,
+                                    const LatencyHistogram &histogram)
+{
+    const QByteArray prefix = labels.isEmpty() ? QByteArray() : labels + ',';
+    quint64 cumulative = 0;
+    for (int i = 0; i < LatencyHistogram::BUCKETS - 1; ++i) {
+        cumulative += histogram.bucket(i);
+        out += QByteArray(metric) + "_bucket{" + prefix + "le=\"" + seconds(LatencyHistogram::upperBound(i))
+            + "\"} " + QByteArray::number(cumulative) + '\n';
+    }
+    const QByteArray braces = labels.isEmpty() ? QByteArray() : '{' + labels + '}';
+    out += QByteArray(metric) + "_bucket{" + prefix + "le=\"+Inf\"} " + QByteArray::number(histogram.count()) + '\n';
+    out += QByteArray(metric) + "_sum" + braces + ' ' + seconds(histogram.sum()) + '\n';
+    out += QByteArray(metric) + "_count" + braces + ' ' + QByteArray::number(histogram.count()) + '\n';
+}
+
+QByteArray HelperMetrics::toPrometheus(const QVariantMap &gauges) const
+{
+    QMutexLocker locker(&m_mutex);
+    QByteArray out;
+
+    appendHeader(out, "couchplay_helper_uptime_seconds", "gauge", "Time since the helper started");
+    out += "couchplay_helper_uptime_seconds " + seconds(quint64(m_uptime.elapsed()) * 1000) + '\n';
+
+    const QStringList methods = sortedKeys(m_methods);
+    appendHeader(out, "couchplay_helper_call_duration_seconds", "histogram", "D-Bus handler latency");
+    for (const QString &method : methods) {
+        appendHistogram(out, "couchplay_helper_call_duration_seconds", label("method", method),
+                        m_methods.value(method)->latency);
+    }
+    appendHeader(out, "couchplay_helper_call_failures_total", "counter", "D-Bus calls answered with an error");
+    for (const QString &method : methods) {
+        out += "couchplay_helper_call_failures_total{" + label("method", method) + "} "
+            + QByteArray::number(m_methods.value(method)->failures) + '\n';
+    }
+
+    appendHeader(out, "couchplay_helper_authorization_duration_seconds", "histogram", "Authorization check latency");
+    appendHistogram(out, "couchplay_helper_authorization_duration_seconds", QByteArray(), m_authorization.latency);
+    appendHeader(out, "couchplay_helper_authorization_denied_total", "counter", "Denied authorization checks");
+    out += "couchplay_helper_authorization_denied_total " + QByteArray::number(m_authorization.failures) + '\n';
+
+    const QStringList programs = sortedKeys(m_processes);
+    appendHeader(out, "couchplay_helper_process_duration_seconds", "histogram", "Child process run time");
+    for (const QString &program : programs) {
+        appendHistogram(out, "couchplay_helper_process_duration_seconds", label("program", program),
+                        m_processes.value(program)->latency);
+    }
+    appendHeader(out, "couchplay_helper_process_failures_total", "counter",
+                 "Child processes that failed to start, timed out or exited non-zero");
+    for (const QString &program : programs) {
+        out += "couchplay_helper_process_failures_total{" + label("program", program) + "} "
+            + QByteArray::number(m_processes.value(program)->failures) + '\n';
+    }
+    appendHeader(out, "couchplay_helper_process_timeouts_total", "counter", "Waits for a child process that timed out");
+    for (const QString &program : programs) {
+        out += "couchplay_helper_process_timeouts_total{" + label("program", program) + "} "
+            + QByteArray::number(m_processes.value(program)->timeouts) + '\n';
+    }
+    appendHeader(out, "couchplay_helper_processes_running", "gauge", "Child processes started and not waited for yet");
+    for (const QString &program : programs) {
+        out += "couchplay_helper_processes_running{" + label("program", program) + "} "
+            + QByteArray::number(m_processes.value(program)->running) + '\n';
+    }
+
+    for (const QString &name : sortedKeys(gauges)) {
+        const QByteArray metric = "couchplay_helper_" + snakeCase(name);
+        appendHeader(out, metric.constData(), "gauge", "Current value");
+        out += metric + ' ' + QByteArray::number(gauges.value(name).toLongLong()) + '\n';
+    }
+
+    return out;
+}
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+
+#include "LatencyHistogram.h"
+
+#include <memory>
+
+class QProcess;
+
+/**
+ * HelperMetrics - Counters and latency histograms of the helper's work
+ *
+ * Kept for the lifetime of the daemon: D-Bus handler calls and failures
+ * (error replies) per method, authorization checks, and child processes
+ * per program (spawns, failures, timeouts, still running). Latencies go
+ * into LatencyHistograms, so percentiles are bucket upper bounds (powers
+ * of two in µs).
+ *
+ * snapshot() is what GetMetrics returns; toPrometheus() renders the same
+ * data in the Prometheus text exposition format for the node exporter's
+ * textfile collector. Gauges (mounts, instances, ...) belong to the caller
+ * and are passed in. Thread-safe: DeleteUser steps spawn processes from
+ * the teardown pool.
+ */
+class HelperMetrics
+{
+public:
+    /**
+     * Times a D-Bus handler; an error reply sent meanwhile (see fail())
+     * counts the call as failed. Handlers that call other handlers nest.
+     */
+    class Call
+    {
+    public:
+        Call(HelperMetrics &metrics, const char *method);
+        ~Call();
+
+        Call(const Call &) = delete;
+        Call &operator=(const Call &) = delete;
+
+    private:
+        friend class HelperMetrics;
+
+        HelperMetrics &m_metrics;
+        const char *m_method;
+        Call *m_outer;
+        QElapsedTimer m_timer;
+        bool m_failed = false;
+    };
+
+    HelperMetrics();
+
+    /** Count the innermost running Call as failed (GUI thread only) */
+    void fail();
+
+    void recordCall(const QString &method, quint64 micros, bool failed);
+    void recordAuthorization(quint64 micros, bool granted);
+
+    /** A child process was started; its duration is measured from here */
+    void processStarted(QProcess *process, const QString &program);
+
+    /**
+     * A wait for a child process returned
+     * @param finished What waitForFinished() returned
+     * @param exitCode Exit code if finished
+     */
+    void processFinished(QProcess *process, bool finished, int exitCode);
+
+    /**
+     * @return "uptimeMs", "methods", "authorization", "processes" and "gauges",
+     *         latency series as {"count", "failures", "meanUs", "p50Us", "p99Us", "maxUs"}
+     */
+    QVariantMap snapshot(const QVariantMap &gauges) const;
+
+    QByteArray toPrometheus(const QVariantMap &gauges) const;
+
+private:
+    struct Series {
+        LatencyHistogram latency;
+        quint64 failures = 0;
+        quint64 timeouts = 0;   // Processes only
+        qint64 running = 0;     // Processes only
+    };
+
+    Series &series(QHash<QString, std::shared_ptr<Series>> &map, const QString &name);
+    static QVariantMap seriesMap(const Series &series);
+    static void appendHistogram(QByteArray &out, const char *metric, const QByteArray &labels,
+                                const LatencyHistogram &histogram);
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_uptime;
+    QHash<QString, std::shared_ptr<Series>> m_methods;
+    QHash<QString, std::shared_ptr<Series>> m_processes;
+    Series m_authorization;
+    Call *m_current = nullptr;
+};
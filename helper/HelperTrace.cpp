@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "HelperTrace.h"
+
+#include <QVariantMap>
+
+#include <time.h>
+
+qint64 HelperTrace::nowUs()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+HelperTrace::Scope::Scope(HelperTrace &trace, const QString &client, const char *method)
+    : m_trace(trace)
+    , m_previousClient(trace.m_activeClient)
+{
+    if (!m_trace.m_clients.contains(client)) {
+        // Steps of an untraced handler don't belong to an enclosing traced one
+        m_trace.m_activeClient.clear();
+        return;
+    }
+
+    const QString name = QString::fromLatin1(method);
+    m_trace.m_activeClient = client;
+    m_startUs = nowUs();
+    Span span;
+    span.name = name;
+    span.startUs = m_startUs;
+    span.parent = m_trace.m_clients[client].parents.take(name);
+    m_index = m_trace.append(span);
+    ++m_trace.m_depth;
+}
+
+HelperTrace::Scope::~Scope()
+{
+    if (!m_trace.m_activeClient.isEmpty() && m_startUs > 0) {
+        --m_trace.m_depth;
+        auto it = m_trace.m_clients.find(m_trace.m_activeClient);
+        if (m_index >= 0 && it != m_trace.m_clients.end() && m_index < it->spans.size()) {
+            it->spans[m_index].durationUs = nowUs() - m_startUs;
+        }
+    }
+    m_trace.m_activeClient = m_previousClient;
+}
+
+void HelperTrace::begin(const QString &client)
+{
+    if (client.isEmpty()) {
+        return;
+    }
+
+    if (!m_clients.contains(client) && m_clients.size() >= MAX_CLIENTS) {
+        auto oldest = m_clients.begin();
+        for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+            if (it->order < oldest->order) {
+                oldest = it;
+            }
+        }
+        m_clients.erase(oldest);
+    }
+
+    Client &entry = m_clients[client];
+    entry = Client();
+    entry.order = ++m_order;
+}
+
+void HelperTrace::setParent(const QString &client, const QString &method, quint64 spanId)
+{
+    auto it = m_clients.find(client);
+    if (it != m_clients.end()) {
+        it->parents.insert(method, spanId);
+    }
+}
+
+QVariantList HelperTrace::take(const QString &client)
+{
+    QVariantList spans;
+    const Client entry = m_clients.take(client);
+    spans.reserve(entry.spans.size());
+    for (const Span &span : entry.spans) {
+        spans.append(QVariantMap{
+            {QStringLiteral("name"), span.name},
+            {QStringLiteral("start"), span.startUs},
+            {QStringLiteral("duration"), span.durationUs},
+            {QStringLiteral("depth"), span.depth},
+            {QStringLiteral("parent"), span.parent},
+        });
+    }
+    return spans;
+}
+
+void HelperTrace::record(const QString &name, qint64 startUs, qint64 durationUs)
+{
+    if (m_activeClient.isEmpty()) {
+        return;
+    }
+    Span span;
+    span.name = name;
+    span.startUs = startUs;
+    span.durationUs = durationUs;
+    append(span);
+}
+
+int HelperTrace::append(Span span)
+{
+    auto it = m_clients.find(m_activeClient);
+    if (it == m_clients.end() || it->spans.size() >= MAX_SPANS) {
+        return -1;
+    }
+    span.depth = m_depth;
+    it->spans.append(span);
+    return int(it->spans.size() - 1);
+}
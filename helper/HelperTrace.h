@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVariantList>
+
+/**
+ * HelperTrace - Handler timings for clients that are tracing a session start
+ *
+ * A client calls BeginTrace, and before each call it wants attributed sends
+ * SetTraceParent with the method name and the ID of its own span for the
+ * call. The bus delivers one connection's messages in order and handlers run
+ * one at a time, so the next handler of that method picks the ID up.
+ * TakeTrace hands the spans back and stops recording.
+ *
+ * Times are CLOCK_MONOTONIC microseconds, the clock of the client's trace,
+ * so both sides line up on one timeline. Nothing is recorded for clients
+ * that aren't tracing; at most MAX_CLIENTS trace at once (the oldest is
+ * dropped, e.g. one that crashed mid-trace) with MAX_SPANS each.
+ */
+class HelperTrace
+{
+public:
+    static constexpr int MAX_CLIENTS = 8;
+    static constexpr int MAX_SPANS = 4096;
+
+    class Scope
+    {
+    public:
+        /** A handler called by @p client, the D-Bus sender (empty when not called over D-Bus) */
+        Scope(HelperTrace &trace, const QString &client, const char *method);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        HelperTrace &m_trace;
+        QString m_previousClient;
+        qint64 m_startUs = 0;
+        int m_index = -1;
+    };
+
+    /** Start recording for @p client, dropping what it recorded before */
+    void begin(const QString &client);
+
+    /** The next call of @p method by @p client belongs to the client's span @p spanId */
+    void setParent(const QString &client, const QString &method, quint64 spanId);
+
+    /**
+     * Stop recording for @p client
+     * @return Its spans as {"name", "start", "duration" (us), "depth", "parent"}
+     */
+    QVariantList take(const QString &client);
+
+    bool isTracing(const QString &client) const { return m_clients.contains(client); }
+
+    /** A finished step of the handler being traced, e.g. one PrepareInstance step */
+    void record(const QString &name, qint64 startUs, qint64 durationUs);
+
+    static qint64 nowUs();
+
+private:
+    struct Span {
+        QString name;
+        qint64 startUs = 0;
+        qint64 durationUs = 0;
+        int depth = 0;
+        quint64 parent = 0;
+    };
+
+    struct Client {
+        QList<Span> spans;
+        QHash<QString, quint64> parents;  // method -> client span of its next call
+        quint64 order = 0;
+    };
+
+    int append(Span span);
+
+    QHash<QString, Client> m_clients;
+    QString m_activeClient;  // Sender of the handler running now, if tracing
+    int m_depth = 0;
+    quint64 m_order = 0;
+};
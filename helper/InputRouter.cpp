@@ -0,0 +1,509 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "InputRouter.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// input_events read (and written) per syscall; a full gamepad report is far smaller
+static constexpr int READ_BATCH = 64;
+static constexpr int EPOLL_BATCH = 16;
+
+namespace {
+
+constexpr int longsForBits(int bits)
+{
+    return (bits + int(8 * sizeof(long)) - 1) / int(8 * sizeof(long));
+}
+
+bool testBit(const unsigned long *bits, int bit)
+{
+    return bits[bit / (8 * sizeof(long))] & (1UL << (bit % (8 * sizeof(long))));
+}
+
+QString errnoString()
+{
+    return QString::fromLocal8Bit(strerror(errno));
+}
+
+quint64 elapsedMicros(const struct timespec &now, const struct input_event &event)
+{
+    const qint64 micros = (qint64(now.tv_sec) - qint64(event.input_event_sec)) * 1000000
+        + (qint64(now.tv_nsec) / 1000 - qint64(event.input_event_usec));
+    return micros > 0 ? quint64(micros) : 0;
+}
+
+} // namespace
+
+// ============ InputRouter ============
+
+InputRouter::InputRouter(QObject *parent)
+    : QObject(parent)
+{
+}
+
+InputRouter::~InputRouter()
+{
+    clear();
+    stopThread();
+}
+
+bool InputRouter::ensureThread(QString &error)
+{
+    if (m_thread) {
+        return true;
+    }
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_wakeFd < 0) {
+        error = QStringLiteral("Failed to set up input router: %1").arg(errnoString());
+        stopThread();
+        return false;
+    }
+
+    struct epoll_event wake;
+    memset(&wake, 0, sizeof(wake));
+    wake.events = EPOLLIN;
+    wake.data.fd = m_wakeFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &wake);
+
+    m_stopping.store(false);
+    m_thread = QThread::create([this]() {
+        run();
+    });
+    m_thread->setObjectName(QStringLiteral("InputRouter"));
+    m_thread->start(QThread::TimeCriticalPriority);
+
+    qDebug() << "InputRouter: Forwarding thread started";
+    return true;
+}
+
+void InputRouter::stopThread()
+{
+    if (m_thread) {
+        m_stopping.store(true);
+        const quint64 one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            qWarning() << "InputRouter: Failed to wake forwarding thread:" << errnoString();
+        }
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+        m_epollFd = -1;
+    }
+}
+
+QString InputRouter::route(const QString &devicePath, uid_t uid, gid_t gid, QString &error)
+{
+    if (!ensureThread(error)) {
+        return QString();
+    }
+
+    Source *source = m_sources.value(devicePath);
+    const bool created = !source;
+    if (created) {
+        const int fd = open(devicePath.toLocal8Bit().constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            error = QStringLiteral("Failed to open %1: %2").arg(devicePath, errnoString());
+            return QString();
+        }
+
+        // Timestamps on the same clock as the latency measurement
+        int clock = CLOCK_MONOTONIC;
+        ioctl(fd, EVIOCSCLOCKID, &clock);
+
+        if (ioctl(fd, EVIOCGRAB, 1) < 0) {
+            error = QStringLiteral("Failed to grab %1: %2").arg(devicePath, errnoString());
+            close(fd);
+            return QString();
+        }
+
+        source = new Source;
+        source->fd = fd;
+        source->path = devicePath;
+    }
+
+    auto mirror = source->mirrors.constFind(uid);
+    if (mirror == source->mirrors.constEnd()) {
+        const Mirror newMirror = createMirror(source, uid, gid, error);
+        if (newMirror.fd < 0) {
+            if (created) {
+                ioctl(source->fd, EVIOCGRAB, 0);
+                close(source->fd);
+                delete source;
+            }
+            return QString();
+        }
+        mirror = source->mirrors.insert(uid, newMirror);
+    }
+
+    if (created) {
+        m_sources.insert(devicePath, source);
+        {
+            QMutexLocker lock(&m_mutex);
+            m_sourcesByFd.insert(source->fd, source);
+        }
+        source->targetUid = uid;
+        source->targetFd.store(mirror->fd, std::memory_order_release);
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = source->fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, source->fd, &event) < 0) {
+            error = QStringLiteral("Failed to watch %1: %2").arg(devicePath, errnoString());
+            unroute(devicePath);
+            return QString();
+        }
+        qDebug() << "InputRouter: Routing" << devicePath << "to" << mirror->node << "for UID" << uid;
+    } else if (source->targetUid != uid) {
+        // The swap: the forwarding thread picks up the new target with its next read
+        const int previousFd = source->targetFd.exchange(mirror->fd, std::memory_order_acq_rel);
+        source->targetUid = uid;
+        releaseHeldKeys(source, previousFd);
+        qDebug() << "InputRouter: Rerouted" << devicePath << "to" << mirror->node << "for UID" << uid;
+    }
+
+    return mirror->node;
+}
+
+bool InputRouter::unroute(const QString &devicePath)
+{
+    Source *source = m_sources.take(devicePath);
+    if (!source) {
+        return false;
+    }
+
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, source->fd, nullptr);
+    {
+        // Waits for a batch in flight; the thread can't see the source afterwards
+        QMutexLocker lock(&m_mutex);
+        m_sourcesByFd.remove(source->fd);
+    }
+
+    releaseHeldKeys(source, source->targetFd.load());
+    ioctl(source->fd, EVIOCGRAB, 0);
+    close(source->fd);
+    for (Mirror &mirror : source->mirrors) {
+        destroyMirror(mirror);
+    }
+    delete source;
+
+    qDebug() << "InputRouter: Released" << devicePath;
+    return true;
+}
+
+int InputRouter::clear()
+{
+    int released = 0;
+    const QStringList paths = m_sources.keys();
+    for (const QString &path : paths) {
+        if (unroute(path)) {
+            released++;
+        }
+    }
+
+    if (released > 0) {
+        qInfo() << "InputRouter: Released" << released << "devices after forwarding"
+                << m_events.load() << "events, latency mean" << m_latency.mean()
+                << "us, p99" << m_latency.percentile(0.99) << "us, max" << m_latency.maximum() << "us";
+    }
+    return released;
+}
+
+bool InputRouter::isVirtualNode(const QString &path) const
+{
+    for (const Source *source : m_sources) {
+        for (const Mirror &mirror : source->mirrors) {
+            if (mirror.node == path) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+QVariantMap InputRouter::stats() const
+{
+    int virtualDevices = 0;
+    for (const Source *source : m_sources) {
+        virtualDevices += source->mirrors.size();
+    }
+
+    QVariantMap result;
+    result[QStringLiteral("devices")] = int(m_sources.size());
+    result[QStringLiteral("virtualDevices")] = virtualDevices;
+    result[QStringLiteral("events")] = m_events.load(std::memory_order_relaxed);
+    result[QStringLiteral("batches")] = m_batches.load(std::memory_order_relaxed);
+    result[QStringLiteral("dropped")] = m_dropped.load(std::memory_order_relaxed);
+    result[QStringLiteral("latencyMeanUs")] = m_latency.mean();
+    result[QStringLiteral("latencyP50Us")] = m_latency.percentile(0.5);
+    result[QStringLiteral("latencyP99Us")] = m_latency.percentile(0.99);
+    result[QStringLiteral("latencyMaxUs")] = m_latency.maximum();
+    return result;
+}
+
+void InputRouter::resetStats()
+{
+    m_events.store(0);
+    m_batches.store(0);
+    m_dropped.store(0);
+    m_latency.reset();
+}
+
+void InputRouter::run()
+{
+    struct epoll_event ready[EPOLL_BATCH];
+
+    while (!m_stopping.load()) {
+        const int count = epoll_wait(m_epollFd, ready, EPOLL_BATCH, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qWarning() << "InputRouter: epoll_wait failed:" << errnoString();
+            break;
+        }
+
+        QMutexLocker lock(&m_mutex);
+        for (int i = 0; i < count; ++i) {
+            const int fd = ready[i].data.fd;
+            if (fd == m_wakeFd) {
+                quint64 value;
+                while (read(m_wakeFd, &value, sizeof(value)) > 0) {
+                }
+                continue;
+            }
+
+            Source *source = m_sourcesByFd.value(fd);
+            if (!source) {
+                continue;  // Unrouted after epoll_wait returned
+            }
+
+            if (ready[i].events & (EPOLLHUP | EPOLLERR)) {
+                // Unplugged; stop polling it and let the main thread clean up
+                epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+                const QString path = source->path;
+                QMetaObject::invokeMethod(this, [this, path]() {
+                    unroute(path);
+                }, Qt::QueuedConnection);
+                continue;
+            }
+
+            forward(source);
+        }
+    }
+}
+
+void InputRouter::forward(Source *source)
+{
+    struct input_event events[READ_BATCH];
+
+    while (true) {
+        const ssize_t bytes = read(source->fd, events, sizeof(events));
+        if (bytes <= 0) {
+            break;  // EAGAIN: drained
+        }
+        const int count = int(bytes / sizeof(struct input_event));
+
+        const int target = source->targetFd.load(std::memory_order_acquire);
+        if (target < 0 || write(target, events, count * sizeof(struct input_event)) < 0) {
+            m_dropped.fetch_add(count, std::memory_order_relaxed);
+        } else {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            for (int i = 0; i < count; ++i) {
+                m_latency.record(elapsedMicros(now, events[i]));
+            }
+        }
+
+        m_events.fetch_add(count, std::memory_order_relaxed);
+        m_batches.fetch_add(1, std::memory_order_relaxed);
+
+        if (count < READ_BATCH) {
+            break;
+        }
+    }
+}
+
+void InputRouter::releaseHeldKeys(const Source *source, int targetFd)
+{
+    if (targetFd < 0) {
+        return;
+    }
+
+    unsigned long held[longsForBits(KEY_CNT)] = {};
+    if (ioctl(source->fd, EVIOCGKEY(sizeof(held)), held) < 0) {
+        return;
+    }
+
+    struct input_event events[READ_BATCH];
+    int count = 0;
+    auto flush = [&]() {
+        memset(&events[count], 0, sizeof(struct input_event));
+        events[count].type = EV_SYN;
+        events[count].code = SYN_REPORT;
+        ++count;
+        if (write(targetFd, events, count * sizeof(struct input_event)) < 0) {
+            qWarning() << "InputRouter: Failed to release keys on" << source->path << ":" << errnoString();
+        }
+        count = 0;
+    };
+
+    for (int code = 0; code < KEY_CNT; ++code) {
+        if (!testBit(held, code)) {
+            continue;
+        }
+        memset(&events[count], 0, sizeof(struct input_event));
+        events[count].type = EV_KEY;
+        events[count].code = code;
+        events[count].value = 0;
+        if (++count == READ_BATCH - 1) {
+            flush();
+        }
+    }
+    if (count > 0) {
+        flush();
+    }
+}
+
+InputRouter::Mirror InputRouter::createMirror(const Source *source, uid_t uid, gid_t gid, QString &error)
+{
+    Mirror mirror;
+
+    const int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        error = QStringLiteral("Failed to open /dev/uinput: %1").arg(errnoString());
+        return mirror;
+    }
+
+    auto fail = [&](const QString &message) {
+        error = QStringLiteral("%1 for %2: %3").arg(message, source->path, errnoString());
+        close(fd);
+        return Mirror();
+    };
+
+    // Copy the capabilities games look at; force feedback and LEDs are not
+    // forwarded back to the physical device
+    struct Capability {
+        int type;
+        unsigned long request;
+        int count;
+    };
+    static const Capability capabilities[] = {
+        {EV_KEY, UI_SET_KEYBIT, KEY_CNT},
+        {EV_REL, UI_SET_RELBIT, REL_CNT},
+        {EV_ABS, UI_SET_ABSBIT, ABS_CNT},
+        {EV_MSC, UI_SET_MSCBIT, MSC_CNT},
+        {EV_SW, UI_SET_SWBIT, SW_CNT},
+    };
+
+    unsigned long eventBits[longsForBits(EV_CNT)] = {};
+    if (ioctl(source->fd, EVIOCGBIT(0, sizeof(eventBits)), eventBits) < 0) {
+        return fail(QStringLiteral("Failed to query event types"));
+    }
+
+    unsigned long codeBits[longsForBits(KEY_CNT)];
+    for (const Capability &capability : capabilities) {
+        if (!testBit(eventBits, capability.type)) {
+            continue;
+        }
+        memset(codeBits, 0, sizeof(codeBits));
+        if (ioctl(source->fd, EVIOCGBIT(capability.type, sizeof(codeBits)), codeBits) < 0) {
+            continue;
+        }
+        ioctl(fd, UI_SET_EVBIT, capability.type);
+        for (int code = 0; code < capability.count; ++code) {
+            if (!testBit(codeBits, code)) {
+                continue;
+            }
+            ioctl(fd, capability.request, code);
+            if (capability.type == EV_ABS) {
+                struct uinput_abs_setup abs;
+                memset(&abs, 0, sizeof(abs));
+                abs.code = code;
+                if (ioctl(source->fd, EVIOCGABS(code), &abs.absinfo) == 0) {
+                    ioctl(fd, UI_ABS_SETUP, &abs);
+                }
+            }
+        }
+    }
+
+    unsigned long propBits[longsForBits(INPUT_PROP_CNT)] = {};
+    if (ioctl(source->fd, EVIOCGPROP(sizeof(propBits)), propBits) >= 0) {
+        for (int prop = 0; prop < INPUT_PROP_CNT; ++prop) {
+            if (testBit(propBits, prop)) {
+                ioctl(fd, UI_SET_PROPBIT, prop);
+            }
+        }
+    }
+
+    // Same name and IDs as the physical device so SDL/Steam mappings apply
+    struct uinput_setup setup;
+    memset(&setup, 0, sizeof(setup));
+    ioctl(source->fd, EVIOCGID, &setup.id);
+    ioctl(source->fd, EVIOCGNAME(sizeof(setup.name) - 1), setup.name);
+
+    ioctl(fd, UI_SET_PHYS, INPUT_ROUTER_PHYS);
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        return fail(QStringLiteral("Failed to create virtual device"));
+    }
+
+    char sysname[64] = {};
+    if (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) {
+        ioctl(fd, UI_DEV_DESTROY);
+        return fail(QStringLiteral("Failed to look up virtual device"));
+    }
+
+    // devtmpfs creates the node synchronously with the device
+    const QDir sysDir(QStringLiteral("/sys/devices/virtual/input/") + QString::fromLatin1(sysname));
+    const QStringList events = sysDir.entryList({QStringLiteral("event*")}, QDir::Dirs | QDir::NoDotAndDotDot);
+    if (events.isEmpty()) {
+        ioctl(fd, UI_DEV_DESTROY);
+        errno = ENOENT;
+        return fail(QStringLiteral("Virtual device has no event node"));
+    }
+
+    mirror.node = QStringLiteral("/dev/input/") + events.first();
+    const QByteArray node = mirror.node.toLocal8Bit();
+    if (::chown(node.constData(), uid, gid) != 0 || ::chmod(node.constData(), 0600) != 0) {
+        ioctl(fd, UI_DEV_DESTROY);
+        return fail(QStringLiteral("Failed to hand virtual device to user"));
+    }
+
+    mirror.fd = fd;
+    return mirror;
+}
+
+void InputRouter::destroyMirror(Mirror &mirror)
+{
+    if (mirror.fd >= 0) {
+        ioctl(mirror.fd, UI_DEV_DESTROY);
+        close(mirror.fd);
+        mirror.fd = -1;
+    }
+}
@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+#include "LatencyHistogram.h"
+
+#include <atomic>
+#include <sys/types.h>
+
+class QThread;
+
+// Phys string given to virtual devices so clients can recognise (and hide) them
+inline constexpr char INPUT_ROUTER_PHYS[] = "couchplay-router/virtual";
+
+/**
+ * InputRouter - Forwards grabbed evdev devices to per-player uinput devices
+ *
+ * Alternative to handing /dev/input/eventN to a player by chown: the router
+ * EVIOCGRABs the physical device and mirrors it as a uinput device owned by
+ * the player. One epoll thread reads input_event batches from every grabbed
+ * device and writes each batch to its current target in a single write().
+ *
+ * Moving a device to another player only swaps the target fd (the first time
+ * a device is routed to a player its mirror is created once and kept), so a
+ * reassignment takes effect with the next event and needs no ownership
+ * round trip. Keys held on the previous target are released on the swap.
+ *
+ * The end-to-end latency of every forwarded event (kernel timestamp of the
+ * source event to completion of the write) is recorded in a LatencyHistogram.
+ */
+class InputRouter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InputRouter(QObject *parent = nullptr);
+    ~InputRouter() override;
+
+    /**
+     * Route @p devicePath to a virtual device owned by @p uid
+     *
+     * Grabs the device on first use. Routing an already routed device to a
+     * different user is an in-memory swap.
+     *
+     * @return Path of the player's virtual event node, empty on failure
+     */
+    QString route(const QString &devicePath, uid_t uid, gid_t gid, QString &error);
+
+    /**
+     * Stop forwarding @p devicePath, ungrab it and destroy its virtual devices
+     */
+    bool unroute(const QString &devicePath);
+
+    /**
+     * Unroute every device
+     * @return Number of devices released
+     */
+    int clear();
+
+    bool isRouted(const QString &devicePath) const { return m_sources.contains(devicePath); }
+    QStringList routedDevices() const { return m_sources.keys(); }
+
+    /**
+     * True if @p path is one of the virtual nodes created by this router
+     */
+    bool isVirtualNode(const QString &path) const;
+
+    /**
+     * Forwarding statistics: "devices", "virtualDevices", "events", "batches",
+     * "dropped" and "latencyMeanUs", "latencyP50Us", "latencyP99Us",
+     * "latencyMaxUs"
+     */
+    QVariantMap stats() const;
+    void resetStats();
+
+private:
+    struct Mirror {
+        int fd = -1;
+        QString node;  // /dev/input/eventN
+    };
+
+    struct Source {
+        int fd = -1;
+        QString path;
+        std::atomic<int> targetFd{-1};  // Read by the router thread
+        uid_t targetUid = 0;
+        QHash<uid_t, Mirror> mirrors;   // Main thread only
+    };
+
+    bool ensureThread(QString &error);
+    void stopThread();
+    void run();
+    void forward(Source *source);
+    void releaseHeldKeys(const Source *source, int targetFd);
+    Mirror createMirror(const Source *source, uid_t uid, gid_t gid, QString &error);
+    static void destroyMirror(Mirror &mirror);
+
+    QHash<QString, Source *> m_sources;  // device path -> source (main thread)
+
+    // Shared with the router thread, guarded by m_mutex
+    QMutex m_mutex;
+    QHash<int, Source *> m_sourcesByFd;
+
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    QThread *m_thread = nullptr;
+    std::atomic<bool> m_stopping{false};
+
+    std::atomic<quint64> m_events{0};
+    std::atomic<quint64> m_batches{0};
+    std::atomic<quint64> m_dropped{0};
+    LatencyHistogram m_latency;
+};
@@ -0,0 +1,105 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "InstanceSupervisor.h"
+#include "SystemOps.h"
+
+#include <QDebug>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+InstanceSupervisor::InstanceSupervisor(SystemOps *ops, QObject *parent)
+    : QObject(parent)
+    , m_ops(ops)
+{
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        qWarning() << "InstanceSupervisor: epoll_create1 failed:" << strerror(errno);
+        return;
+    }
+    m_notifier = new QSocketNotifier(m_epollFd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &InstanceSupervisor::onReadyRead);
+}
+
+InstanceSupervisor::~InstanceSupervisor()
+{
+    for (const Entry &entry : std::as_const(m_entries)) {
+        close(entry.fd);
+    }
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+    }
+}
+
+bool InstanceSupervisor::watch(qint64 pid)
+{
+    if (m_epollFd < 0 || pid <= 0) {
+        return false;
+    }
+    if (m_entries.contains(pid)) {
+        return true;
+    }
+
+    const int fd = m_ops->openPidfd(static_cast<pid_t>(pid));
+    if (fd < 0) {
+        qWarning() << "InstanceSupervisor: Cannot supervise PID" << pid << ":" << strerror(errno);
+        return false;
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = static_cast<quint64>(pid);
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        qWarning() << "InstanceSupervisor: epoll_ctl failed for PID" << pid << ":" << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    Entry entry;
+    entry.fd = fd;
+    entry.runtime.start();
+    m_entries.insert(pid, entry);
+    return true;
+}
+
+bool InstanceSupervisor::sendSignal(qint64 pid, int signal) const
+{
+    const auto it = m_entries.constFind(pid);
+    return it != m_entries.constEnd() && m_ops->signalPidfd(it->fd, signal);
+}
+
+void InstanceSupervisor::onReadyRead()
+{
+    static constexpr int MAX_EVENTS = 16;
+    struct epoll_event events[MAX_EVENTS];
+
+    int ready = 0;
+    do {
+        ready = epoll_wait(m_epollFd, events, MAX_EVENTS, 0);
+        for (int i = 0; i < ready; ++i) {
+            const qint64 pid = static_cast<qint64>(events[i].data.u64);
+            const auto it = m_entries.constFind(pid);
+            if (it == m_entries.constEnd()) {
+                continue;
+            }
+            const int status = m_ops->pidfdExitStatus(it->fd);
+            const qint64 runtimeMs = it->runtime.elapsed();
+            release(pid);
+
+            qDebug() << "InstanceSupervisor: PID" << pid << "exited with status" << status
+                     << "after" << runtimeMs << "ms";
+            Q_EMIT exited(pid, status, runtimeMs);
+        }
+    } while (ready == MAX_EVENTS);
+}
+
+void InstanceSupervisor::release(qint64 pid)
+{
+    const Entry entry = m_entries.take(pid);
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, entry.fd, nullptr);
+    close(entry.fd);
+}
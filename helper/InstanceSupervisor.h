@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+class QSocketNotifier;
+class SystemOps;
+
+/**
+ * InstanceSupervisor - Exit notifications for launched instances
+ *
+ * Holds a pidfd per instance (gamescope's main PID for transient units,
+ * the machinectl wrapper on the fallback path) and waits on all of them
+ * through one epoll set behind a single QSocketNotifier. A pidfd pins its
+ * process, so signals sent through sendSignal() can't reach a recycled
+ * PID, and the exit is seen whether or not the helper is the parent.
+ */
+class InstanceSupervisor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InstanceSupervisor(SystemOps *ops, QObject *parent = nullptr);
+    ~InstanceSupervisor() override;
+
+    /**
+     * Start supervising @p pid
+     * @return false if it is already gone or pidfds are unsupported
+     */
+    bool watch(qint64 pid);
+    bool isWatching(qint64 pid) const { return m_entries.contains(pid); }
+    QList<qint64> pids() const { return m_entries.keys(); }
+
+    /**
+     * Signal a supervised process through its pidfd
+     * @return false if @p pid isn't supervised or the signal failed
+     */
+    bool sendSignal(qint64 pid, int signal) const;
+
+Q_SIGNALS:
+    /**
+     * A supervised process exited and is no longer supervised
+     *
+     * @p status is the exit code, 128 + the signal number if it was killed,
+     * or -1 when it can't be known (the helper isn't the parent).
+     * @p runtimeMs counts from watch().
+     */
+    void exited(qint64 pid, int status, qint64 runtimeMs);
+
+private:
+    void onReadyRead();
+    void release(qint64 pid);
+
+    struct Entry {
+        int fd = -1;
+        QElapsedTimer runtime;
+    };
+
+    SystemOps *m_ops;
+    int m_epollFd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QHash<qint64, Entry> m_entries;
+};
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "LatencyHistogram.h"
+
+#include <QtAlgorithms>
+
+#include <cmath>
+
+void LatencyHistogram::record(quint64 micros)
+{
+    const int bucket = micros == 0 ? 0 : qMin(BUCKETS - 1, 64 - qCountLeadingZeroBits(micros));
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(micros, std::memory_order_relaxed);
+
+    quint64 previous = m_max.load(std::memory_order_relaxed);
+    while (micros > previous
+           && !m_max.compare_exchange_weak(previous, micros, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto &bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+quint64 LatencyHistogram::mean() const
+{
+    const quint64 total = count();
+    return total > 0 ? m_sum.load(std::memory_order_relaxed) / total : 0;
+}
+
+quint64 LatencyHistogram::percentile(double fraction) const
+{
+    const quint64 total = count();
+    if (total == 0) {
+        return 0;
+    }
+
+    const quint64 rank = qMax<quint64>(1, quint64(std::ceil(qBound(0.0, fraction, 1.0) * double(total))));
+    quint64 seen = 0;
+    for (int i = 0; i < BUCKETS - 1; ++i) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return quint64(1) << i;
+        }
+    }
+    return maximum();
+}
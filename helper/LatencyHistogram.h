@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QtGlobal>
+
+#include <atomic>
+
+/**
+ * LatencyHistogram - Lock-free log2 histogram of latencies
+ *
+ * Bucket 0 counts latencies below 1 µs, bucket i (i > 0) counts
+ * [2^(i-1), 2^i) µs. Safe to write from one thread and read from another
+ * (the input router's forwarding latencies, HelperMetrics).
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int BUCKETS = 24;  // Last bucket collects everything >= ~4 s
+
+    void record(quint64 micros);
+    void reset();
+
+    quint64 count() const { return m_count.load(std::memory_order_relaxed); }
+    quint64 maximum() const { return m_max.load(std::memory_order_relaxed); }
+    quint64 sum() const { return m_sum.load(std::memory_order_relaxed); }
+    quint64 mean() const;
+
+    /**
+     * Events in bucket @p index, see upperBound()
+     */
+    quint64 bucket(int index) const { return m_buckets[index].load(std::memory_order_relaxed); }
+
+    /**
+     * Upper bound (µs, exclusive) of bucket @p index
+     */
+    static quint64 upperBound(int index) { return quint64(1) << index; }
+
+    /**
+     * Upper bound (µs) of the bucket holding the @p fraction quantile
+     */
+    quint64 percentile(double fraction) const;
+
+private:
+    std::atomic<quint64> m_buckets[BUCKETS] = {};
+    std::atomic<quint64> m_count{0};
+    std::atomic<quint64> m_sum{0};
+    std::atomic<quint64> m_max{0};
+};
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QByteArray>
+#include <QDBusArgument>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+/**
+ * PrepareInstanceSpec - Work requested from CouchPlayHelper::PrepareInstance
+ *
+ * Shared by the helper and CouchPlayHelperClient. On the bus the spec
+ * travels as a{sv} using the key names noted next to each field, so older
+ * or newer peers simply ignore keys they don't know.
+ */
+struct PrepareInstanceSpec {
+    bool session = false;           // "session": linger for the user, runtime socket ACLs for the compositor
+    QStringList devices;            // "devices": input devices handed to the user (0600)
+    bool routeDevices = false;      // "routeDevices": forward devices through the input router instead
+    QStringList sharedDirectories;  // "sharedDirectories": "source|alias[|overlay]" mounts
+    QStringList aclPaths;           // "aclPaths": rx ACL on the path and its parents
+    QStringList recursiveAclPaths;  // "recursiveAclPaths": rx ACL on a whole tree
+    QStringList sharedCaches;       // "sharedCaches": compositor cache directories (shader caches,
+                                    // Proton prefixes) reflinked into the user's home if missing there;
+                                    // only accepted from the compositor user itself
+    QVariantMap files;              // "files": target path -> content (QByteArray, or a
+                                    // QDBusUnixFileDescriptor to read it from)
+
+    bool launch = false;            // "launch": start the instance once setup succeeded
+    QStringList gamescopeArgs;      // "gamescopeArgs"
+    QString gameCommand;            // "gameCommand"
+    QStringList environment;        // "environment"
+    QVariantMap resources;          // "resources": cgroup controls, see CouchPlayHelper::SetInstanceResources
+
+    QVariantMap toVariantMap() const
+    {
+        QVariantMap map;
+        map[QStringLiteral("session")] = session;
+        map[QStringLiteral("devices")] = devices;
+        map[QStringLiteral("routeDevices")] = routeDevices;
+        map[QStringLiteral("sharedDirectories")] = sharedDirectories;
+        map[QStringLiteral("aclPaths")] = aclPaths;
+        map[QStringLiteral("recursiveAclPaths")] = recursiveAclPaths;
+        map[QStringLiteral("sharedCaches")] = sharedCaches;
+        map[QStringLiteral("files")] = files;
+        map[QStringLiteral("launch")] = launch;
+        if (launch) {
+            map[QStringLiteral("gamescopeArgs")] = gamescopeArgs;
+            map[QStringLiteral("gameCommand")] = gameCommand;
+            map[QStringLiteral("environment")] = environment;
+            map[QStringLiteral("resources")] = resources;
+        }
+        return map;
+    }
+
+    static PrepareInstanceSpec fromVariantMap(const QVariantMap &map)
+    {
+        PrepareInstanceSpec spec;
+        spec.session = map.value(QStringLiteral("session")).toBool();
+        spec.devices = map.value(QStringLiteral("devices")).toStringList();
+        spec.routeDevices = map.value(QStringLiteral("routeDevices")).toBool();
+        spec.sharedDirectories = map.value(QStringLiteral("sharedDirectories")).toStringList();
+        spec.aclPaths = map.value(QStringLiteral("aclPaths")).toStringList();
+        spec.recursiveAclPaths = map.value(QStringLiteral("recursiveAclPaths")).toStringList();
+        spec.sharedCaches = map.value(QStringLiteral("sharedCaches")).toStringList();
+        // Nested a{sv} arrives as a QDBusArgument when received over the bus
+        const QVariant files = map.value(QStringLiteral("files"));
+        spec.files = files.userType() == qMetaTypeId<QDBusArgument>()
+            ? qdbus_cast<QVariantMap>(files.value<QDBusArgument>())
+            : files.toMap();
+        spec.launch = map.value(QStringLiteral("launch")).toBool();
+        spec.gamescopeArgs = map.value(QStringLiteral("gamescopeArgs")).toStringList();
+        spec.gameCommand = map.value(QStringLiteral("gameCommand")).toString();
+        spec.environment = map.value(QStringLiteral("environment")).toStringList();
+        const QVariant resources = map.value(QStringLiteral("resources"));
+        spec.resources = resources.userType() == qMetaTypeId<QDBusArgument>()
+            ? qdbus_cast<QVariantMap>(resources.value<QDBusArgument>())
+            : resources.toMap();
+        return spec;
+    }
+};
@@ -2,34 +2,476 @@
 // SPDX-FileCopyrightText: 2025 CouchPlay Contributors
 
 #include "SystemOps.h"
+#include "InputRouter.h"
+#include "UserDirectory.h"
 
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusMetaType>
+#include <QDBusObjectPath>
+#include <QDBusVariant>
+#include <QDebug>
+#include <QDeadlineTimer>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QRandomGenerator>
+#include <QThreadPool>
 
+#include <atomic>
 #include <cerrno>
 #include <cstring>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 
+#include <linux/fs.h>
+#include <linux/mount.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/msg.h>
+#include <sys/sem.h>
+#include <sys/shm.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#include <acl/libacl.h>
+#include <sys/acl.h>
+
+namespace {
+
+quint64 directoryFingerprint(const struct stat &st)
+{
+    // Mix inode and nanosecond mtime; a replaced directory gets a new inode
+    const quint64 mtime = quint64(st.st_mtim.tv_sec) * 1000000000ull + quint64(st.st_mtim.tv_nsec);
+    return (quint64(st.st_ino) * 0x9E3779B97F4A7C15ull) ^ mtime;
+}
+
+bool grantsReadExecute(acl_entry_t entry)
+{
+    acl_permset_t perms;
+    return acl_get_permset(entry, &perms) == 0
+        && acl_get_perm(perms, ACL_READ) == 1
+        && acl_get_perm(perms, ACL_EXECUTE) == 1;
+}
+
+/**
+ * Walks a directory tree applying a named-user rx entry.
+ *
+ * Everything is done relative to directory fds (openat/fstatat with
+ * O_NOFOLLOW) so symlinks inside the tree are never followed, matching
+ * setfacl -R's default physical walk. Subdirectories are handed to a thread
+ * pool while it has capacity and walked inline otherwise, which bounds the
+ * number of directory fds held open at once.
+ *
+ * A directory whose fingerprint matches the one it had in the previous walk
+ * has had no entries added since, so only its subdirectories are visited.
+ */
+class AclTreeWalker
+{
+public:
+    AclTreeWalker(uid_t uid, const DirectoryFingerprints &known)
+        : m_uid(uid)
+        , m_known(known)
+    {
+        m_pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), 8));
+        m_maxQueued = m_pool.maxThreadCount() * 4;
+    }
+
+    // Returns 1 when the ACL was rewritten, 0 when it already granted rx, -1 on error
+    int applyToFd(int fd)
+    {
+        acl_t acl = acl_get_fd(fd);
+        if (!acl) {
+            return -1;
+        }
+
+        acl_entry_t entry;
+        acl_entry_t userEntry = nullptr;
+        bool maskGrants = true;
+        for (int id = ACL_FIRST_ENTRY; acl_get_entry(acl, id, &entry) == 1; id = ACL_NEXT_ENTRY) {
+            acl_tag_t tag;
+            if (acl_get_tag_type(entry, &tag) != 0) {
+                continue;
+            }
+            if (tag == ACL_MASK) {
+                maskGrants = grantsReadExecute(entry);
+            } else if (tag == ACL_USER && !userEntry) {
+                auto *qualifier = static_cast<uid_t *>(acl_get_qualifier(entry));
+                if (qualifier && *qualifier == m_uid) {
+                    userEntry = entry;
+                }
+                acl_free(qualifier);
+            }
+        }
+
+        if (userEntry && maskGrants && grantsReadExecute(userEntry)) {
+            acl_free(acl);
+            return 0;
+        }
+
+        int result = -1;
+        if (!userEntry) {
+            if (acl_create_entry(&acl, &userEntry) != 0
+                || acl_set_tag_type(userEntry, ACL_USER) != 0
+                || acl_set_qualifier(userEntry, &m_uid) != 0) {
+                acl_free(acl);
+                return -1;
+            }
+        }
+
+        acl_permset_t perms;
+        if (acl_get_permset(userEntry, &perms) == 0
+            && acl_add_perm(perms, ACL_READ) == 0
+            && acl_add_perm(perms, ACL_EXECUTE) == 0
+            && acl_set_permset(userEntry, perms) == 0
+            && acl_calc_mask(&acl) == 0
+            && acl_set_fd(fd, acl) == 0) {
+            result = 1;
+        }
+
+        acl_free(acl);
+        return result;
+    }
+
+    void record(int outcome, const QString &path)
+    {
+        if (outcome > 0) {
+            m_updated++;
+        } else if (outcome == 0) {
+            m_unchanged++;
+        } else {
+            recordFailure(path);
+        }
+    }
+
+    void recordFailure(const QString &path)
+    {
+        const int err = errno;
+        m_failed++;
+        QMutexLocker locker(&m_dataMutex);
+        if (m_error.isEmpty()) {
+            m_error = QStringLiteral("%1: %2").arg(path, QString::fromLocal8Bit(strerror(err)));
+        }
+    }
+
+    // Walks the directory behind dirFd (already ACL'd by the caller) and closes it
+    void walk(int dirFd, const QString &path, const QString &relativePath)
+    {
+        struct stat dirStat;
+        bool entriesUnchanged = false;
+        if (fstat(dirFd, &dirStat) == 0) {
+            const quint64 fingerprint = directoryFingerprint(dirStat);
+            auto known = m_known.constFind(relativePath);
+            entriesUnchanged = known != m_known.constEnd() && known.value() == fingerprint;
+
+            QMutexLocker locker(&m_dataMutex);
+            m_seen.insert(relativePath, fingerprint);
+        }
+        if (entriesUnchanged) {
+            m_skipped++;
+        }
+
+        DIR *dir = fdopendir(dirFd);
+        if (!dir) {
+            recordFailure(path);
+            ::close(dirFd);
+            return;
+        }
+
+        while (struct dirent *ent = readdir(dir)) {
+            const char *name = ent->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+
+            // Unchanged directory: its entries already carry the ACL, only
+            // descend (d_type avoids a stat per file on most filesystems)
+            if (entriesUnchanged && ent->d_type != DT_DIR && ent->d_type != DT_UNKNOWN) {
+                continue;
+            }
+
+            const QString childName = QString::fromLocal8Bit(name);
+            const QString childPath = path + QLatin1Char('/') + childName;
+            struct stat st;
+            if (fstatat(::dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                recordFailure(childPath);
+                continue;
+            }
+
+            if (S_ISDIR(st.st_mode)) {
+                int childFd = openat(::dirfd(dir), name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                if (childFd < 0) {
+                    recordFailure(childPath);
+                    continue;
+                }
+                if (!entriesUnchanged) {
+                    record(applyToFd(childFd), childPath);
+                }
+
+                const QString childRelative = relativePath.isEmpty()
+                    ? childName : relativePath + QLatin1Char('/') + childName;
+                if (m_queued.load() < m_maxQueued) {
+                    m_queued++;
+                    m_pool.start([this, childFd, childPath, childRelative]() {
+                        walk(childFd, childPath, childRelative);
+                        m_queued--;
+                    });
+                } else {
+                    walk(childFd, childPath, childRelative);
+                }
+            } else if (S_ISREG(st.st_mode) && !entriesUnchanged) {
+                int fd = openat(::dirfd(dir), name, O_RDONLY | O_NOFOLLOW | O_NOCTTY | O_CLOEXEC);
+                if (fd < 0) {
+                    recordFailure(childPath);
+                    continue;
+                }
+                record(applyToFd(fd), childPath);
+                ::close(fd);
+            }
+            // Symlinks, sockets, FIFOs and device nodes are skipped
+        }
+
+        closedir(dir);
+    }
+
+    void waitForDone() { m_pool.waitForDone(); }
+
+    void fillResult(AclResult &result)
+    {
+        result.updated += m_updated.load();
+        result.unchanged += m_unchanged.load();
+        result.skipped += m_skipped.load();
+        result.failed += m_failed.load();
+        if (result.error.isEmpty()) {
+            result.error = m_error;
+        }
+        result.directories = m_seen;
+    }
+
+private:
+    uid_t m_uid;
+    const DirectoryFingerprints &m_known;
+    QThreadPool m_pool;
+    int m_maxQueued = 0;
+    std::atomic<int> m_queued{0};
+    std::atomic<qint64> m_updated{0};
+    std::atomic<qint64> m_unchanged{0};
+    std::atomic<qint64> m_skipped{0};
+    std::atomic<qint64> m_failed{0};
+    QMutex m_dataMutex;  // Guards m_error and m_seen
+    QString m_error;
+    DirectoryFingerprints m_seen;
+};
+
+} // namespace
+
+// StartTransientUnit() argument types: a(sv) properties, a(sasb) ExecStart
+// and a(sa(sv)) auxiliary units
+struct SystemdProperty {
+    QString name;
+    QDBusVariant value;
+};
+Q_DECLARE_METATYPE(SystemdProperty)
+
+struct SystemdExecCommand {
+    QString path;
+    QStringList argv;
+    bool ignoreFailure = false;
+};
+Q_DECLARE_METATYPE(SystemdExecCommand)
+
+struct SystemdAuxUnit {
+    QString name;
+    QList<SystemdProperty> properties;
+};
+Q_DECLARE_METATYPE(SystemdAuxUnit)
+
+static QDBusArgument &operator<<(QDBusArgument &arg, const SystemdProperty &property)
+{
+    arg.beginStructure();
+    arg << property.name << property.value;
+    arg.endStructure();
+    return arg;
+}
+
+static const QDBusArgument &operator>>(const QDBusArgument &arg, SystemdProperty &property)
+{
+    arg.beginStructure();
+    arg >> property.name >> property.value;
+    arg.endStructure();
+    return arg;
+}
+
+static QDBusArgument &operator<<(QDBusArgument &arg, const SystemdExecCommand &command)
+{
+    arg.beginStructure();
+    arg << command.path << command.argv << command.ignoreFailure;
+    arg.endStructure();
+    return arg;
+}
+
+static const QDBusArgument &operator>>(const QDBusArgument &arg, SystemdExecCommand &command)
+{
+    arg.beginStructure();
+    arg >> command.path >> command.argv >> command.ignoreFailure;
+    arg.endStructure();
+    return arg;
+}
+
+static QDBusArgument &operator<<(QDBusArgument &arg, const SystemdAuxUnit &unit)
+{
+    arg.beginStructure();
+    arg << unit.name << unit.properties;
+    arg.endStructure();
+    return arg;
+}
+
+static const QDBusArgument &operator>>(const QDBusArgument &arg, SystemdAuxUnit &unit)
+{
+    arg.beginStructure();
+    arg >> unit.name >> unit.properties;
+    arg.endStructure();
+    return arg;
+}
+
+namespace {
+
+const QString SYSTEMD_SERVICE = QStringLiteral("org.freedesktop.systemd1");
+const QString SYSTEMD_PATH = QStringLiteral("/org/freedesktop/systemd1");
+const QString SYSTEMD_MANAGER = QStringLiteral("org.freedesktop.systemd1.Manager");
+
+void registerSystemdTypes()
+{
+    static const bool registered = [] {
+        qDBusRegisterMetaType<SystemdProperty>();
+        qDBusRegisterMetaType<QList<SystemdProperty>>();
+        qDBusRegisterMetaType<SystemdExecCommand>();
+        qDBusRegisterMetaType<QList<SystemdExecCommand>>();
+        qDBusRegisterMetaType<SystemdAuxUnit>();
+        qDBusRegisterMetaType<QList<SystemdAuxUnit>>();
+        qDBusRegisterMetaType<QList<QByteArray>>();
+        return true;
+    }();
+    Q_UNUSED(registered)
+}
+
+SystemdProperty unitProperty(const QString &name, const QVariant &value)
+{
+    return SystemdProperty{name, QDBusVariant(value)};
+}
+
+QDBusMessage callSystemd(const QString &method, const QVariantList &arguments)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(SYSTEMD_SERVICE, SYSTEMD_PATH, SYSTEMD_MANAGER, method);
+    message.setArguments(arguments);
+    return QDBusConnection::systemBus().call(message);
+}
+
+// Service property of a loaded unit, invalid if the unit is unknown
+QVariant serviceProperty(const QString &unit, const QString &property)
+{
+    const QDBusMessage reply = callSystemd(QStringLiteral("GetUnit"), {unit});
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty()) {
+        return QVariant();
+    }
+
+    QDBusMessage get = QDBusMessage::createMethodCall(
+        SYSTEMD_SERVICE, reply.arguments().first().value<QDBusObjectPath>().path(),
+        QStringLiteral("org.freedesktop.DBus.Properties"), QStringLiteral("Get"));
+    get.setArguments({QStringLiteral("org.freedesktop.systemd1.Service"), property});
+    const QDBusMessage value = QDBusConnection::systemBus().call(get);
+    if (value.type() != QDBusMessage::ReplyMessage || value.arguments().isEmpty()) {
+        return QVariant();
+    }
+    return value.arguments().first().value<QDBusVariant>().variant();
+}
+
+} // namespace
+
 RealSystemOps::RealSystemOps(QObject *parent)
     : QObject(parent)
 {
 }
 
-// User/group lookup operations
+// User/group lookup operations, answered from the shared cache. Like the
+// libc calls, the result stays valid until the next call on this thread.
+namespace {
+
+struct passwd *fillPasswd(const std::optional<UserEntry> &entry)
+{
+    thread_local struct passwd pw;
+    thread_local QByteArray name, gecos, home, shell;
+    if (!entry) {
+        return nullptr;
+    }
+    name = entry->name.toLocal8Bit();
+    gecos = entry->gecos.toLocal8Bit();
+    home = QFile::encodeName(entry->home);
+    shell = QFile::encodeName(entry->shell);
+    pw = {};
+    pw.pw_name = name.data();
+    pw.pw_passwd = const_cast<char *>("x");
+    pw.pw_uid = entry->uid;
+    pw.pw_gid = entry->gid;
+    pw.pw_gecos = gecos.data();
+    pw.pw_dir = home.data();
+    pw.pw_shell = shell.data();
+    return &pw;
+}
+
+} // namespace
+
 struct passwd *RealSystemOps::getpwnam(const char *name)
 {
-    return ::getpwnam(name);
+    return fillPasswd(UserDirectory::instance().user(QString::fromLocal8Bit(name)));
 }
 
 struct passwd *RealSystemOps::getpwuid(uid_t uid)
 {
-    return ::getpwuid(uid);
+    return fillPasswd(UserDirectory::instance().user(uid));
 }
 
 struct group *RealSystemOps::getgrnam(const char *name)
 {
-    return ::getgrnam(name);
+    thread_local struct group gr;
+    thread_local QByteArray groupName;
+    thread_local QList<QByteArray> memberNames;
+    thread_local std::vector<char *> members;
+
+    const std::optional<GroupEntry> entry = UserDirectory::instance().group(QString::fromLocal8Bit(name));
+    if (!entry) {
+        return nullptr;
+    }
+    groupName = entry->name.toLocal8Bit();
+    memberNames.clear();
+    members.clear();
+    for (const QString &member : entry->members) {
+        memberNames.append(member.toLocal8Bit());
+    }
+    for (QByteArray &member : memberNames) {
+        members.push_back(member.data());
+    }
+    members.push_back(nullptr);
+
+    gr = {};
+    gr.gr_name = groupName.data();
+    gr.gr_passwd = const_cast<char *>("x");
+    gr.gr_gid = entry->gid;
+    gr.gr_mem = members.data();
+    return &gr;
 }
 
 // Filesystem operations
@@ -69,6 +511,337 @@ bool RealSystemOps::writeFile(const QString &path, const QByteArray &content)
     return written == content.size();
 }
 
+namespace {
+
+// Copy @p size bytes of @p sourceFd into the empty @p targetFd: a reflink
+// where the filesystem shares extents (btrfs, XFS), otherwise in-kernel
+// copies, read/write only as a last resort. Returns the bytes copied.
+qint64 copyFileContent(int sourceFd, int targetFd, qint64 size, QString &method)
+{
+    if (ioctl(targetFd, FICLONE, sourceFd) == 0) {
+        method = QStringLiteral("reflink");
+        return size;
+    }
+
+    off_t offset = 0;
+    method = QStringLiteral("copy_file_range");
+    while (offset < size) {
+        const ssize_t n = copy_file_range(sourceFd, &offset, targetFd, nullptr, size - offset, 0);
+        if (n <= 0 && !(n < 0 && errno == EINTR)) {
+            break;
+        }
+    }
+
+    // copy_file_range() refuses many cross-filesystem copies (e.g. from a memfd)
+    if (offset == 0 && size > 0) {
+        method = QStringLiteral("sendfile");
+        while (offset < size) {
+            const ssize_t n = sendfile(targetFd, sourceFd, &offset, size - offset);
+            if (n <= 0 && !(n < 0 && errno == EINTR)) {
+                break;
+            }
+        }
+    }
+
+    if (offset == 0 && size > 0) {
+        method = QStringLiteral("copy");
+        char buffer[64 * 1024];
+        while (offset < size) {
+            const ssize_t n = pread(sourceFd, buffer, sizeof(buffer), offset);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            ssize_t written = 0;
+            while (written < n) {
+                const ssize_t w = write(targetFd, buffer + written, n - written);
+                if (w < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (w <= 0) {
+                    return offset;
+                }
+                written += w;
+            }
+            offset += n;
+        }
+    }
+
+    return offset;
+}
+
+// Opens the directory @p path below @p root one component at a time with
+// O_NOFOLLOW, so a symlink anywhere below @p root (even one swapped in while
+// walking) fails with ELOOP or ENOTDIR instead of leading elsewhere
+int openDirectoryBelow(const QString &root, const QString &path)
+{
+    const QString base = QDir::cleanPath(root);
+    const QString clean = QDir::cleanPath(path);
+    if (!clean.startsWith(base + QLatin1Char('/'))) {
+        errno = EACCES;
+        return -1;
+    }
+
+    int fd = open(QFile::encodeName(base).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    const QStringList components = clean.mid(base.size() + 1).split(QLatin1Char('/'), Qt::SkipEmptyParts);
+    for (const QString &component : components) {
+        if (fd < 0) {
+            break;
+        }
+        const int next = openat(fd, QFile::encodeName(component).constData(),
+                                O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        const int savedErrno = errno;
+        close(fd);
+        errno = savedErrno;
+        fd = next;
+    }
+    return fd;
+}
+
+// Like openDirectoryBelow(), but @p path may be @p root itself and missing
+// components are created as uid:gid (mode 0755) before being opened
+int createDirectoryBelow(const QString &root, const QString &path, uid_t uid, gid_t gid)
+{
+    const QString base = QDir::cleanPath(root);
+    const QString clean = QDir::cleanPath(path);
+    if (clean != base && !clean.startsWith(base + QLatin1Char('/'))) {
+        errno = EACCES;
+        return -1;
+    }
+
+    int fd = open(QFile::encodeName(base).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    const QStringList components = clean.mid(base.size() + 1).split(QLatin1Char('/'), Qt::SkipEmptyParts);
+    for (const QString &component : components) {
+        if (fd < 0) {
+            break;
+        }
+        const QByteArray name = QFile::encodeName(component);
+        int next = -1;
+        if (mkdirat(fd, name.constData(), 0755) == 0) {
+            if (fchownat(fd, name.constData(), uid, gid, AT_SYMLINK_NOFOLLOW) == 0) {
+                next = openat(fd, name.constData(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            }
+        } else if (errno == EEXIST) {
+            next = openat(fd, name.constData(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        }
+        const int savedErrno = errno;
+        close(fd);
+        errno = savedErrno;
+        fd = next;
+    }
+    return fd;
+}
+
+// Recursive part of RealSystemOps::seedDirectory(); @p target exists already.
+// Takes ownership of @p sourceFd. Entries are opened relative to it without
+// following symlinks, @p source only names them in errors.
+bool seedTree(int sourceFd, const QByteArray &source, const QByteArray &target, uid_t uid, gid_t gid,
+              qint64 &bytes, QString &error)
+{
+    DIR *dir = fdopendir(sourceFd);
+    if (!dir) {
+        error = QStringLiteral("Failed to open %1: %2")
+                    .arg(QFile::decodeName(source), QString::fromLocal8Bit(strerror(errno)));
+        close(sourceFd);
+        return false;
+    }
+
+    const int fd = dirfd(dir);
+    bool ok = true;
+    while (struct dirent *entry = readdir(dir)) {
+        if (qstrcmp(entry->d_name, ".") == 0 || qstrcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        const QByteArray from = source + '/' + entry->d_name;
+        const QByteArray to = target + '/' + entry->d_name;
+
+        struct stat st;
+        if (fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;  // Removed meanwhile
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            const int child = openat(fd, entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (child < 0) {
+                ok = false;
+            } else if (mkdir(to.constData(), st.st_mode & 07777) != 0 || lchown(to.constData(), uid, gid) != 0) {
+                const int savedErrno = errno;
+                close(child);
+                errno = savedErrno;
+                ok = false;
+            } else {
+                ok = seedTree(child, from, to, uid, gid, bytes, error);
+            }
+        } else if (S_ISLNK(st.st_mode)) {
+            // Proton prefixes link drive letters and DLLs
+            char link[PATH_MAX];
+            const ssize_t length = readlinkat(fd, entry->d_name, link, sizeof(link) - 1);
+            if (length < 0) {
+                continue;
+            }
+            link[length] = '\0';
+            ok = symlink(link, to.constData()) == 0 && lchown(to.constData(), uid, gid) == 0;
+        } else if (S_ISREG(st.st_mode)) {
+            const int in = openat(fd, entry->d_name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+            const int out = open(to.constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW,
+                                 st.st_mode & 0777);
+            ok = in >= 0 && out >= 0 && ioctl(out, FICLONE, in) == 0 && fchown(out, uid, gid) == 0;
+            if (in >= 0) {
+                close(in);
+            }
+            if (out >= 0) {
+                close(out);
+            }
+            if (ok) {
+                bytes += st.st_size;
+            }
+        } else {
+            continue;  // Sockets, FIFOs and devices have no place in a cache
+        }
+
+        if (!ok) {
+            if (error.isEmpty()) {
+                error = QStringLiteral("Failed to seed %1: %2")
+                            .arg(QFile::decodeName(to), QString::fromLocal8Bit(strerror(errno)));
+            }
+            break;
+        }
+    }
+
+    closedir(dir);
+    return ok;
+}
+
+} // namespace
+
+FileTransfer RealSystemOps::seedDirectory(const QString &source, const QString &target, uid_t uid, gid_t gid,
+                                          const QString &root)
+{
+    FileTransfer result;
+    result.method = QStringLiteral("reflink");
+
+    const QByteArray from = QFile::encodeName(source);
+    const QByteArray to = QFile::encodeName(target);
+    const int fd = root.isEmpty() ? open(from.constData(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)
+                                  : openDirectoryBelow(root, source);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        result.error = QStringLiteral("Failed to open %1: %2")
+                           .arg(source, QString::fromLocal8Bit(strerror(errno)));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return result;
+    }
+    if (mkdir(to.constData(), st.st_mode & 07777) != 0 || lchown(to.constData(), uid, gid) != 0) {
+        result.error = QStringLiteral("Failed to create %1: %2")
+                           .arg(target, QString::fromLocal8Bit(strerror(errno)));
+        close(fd);
+        return result;
+    }
+
+    if (!seedTree(fd, from, to, uid, gid, result.bytes, result.error)) {
+        // Nothing half-seeded stays behind, the next session tries again
+        QDir(target).removeRecursively();
+        result.bytes = 0;
+        return result;
+    }
+
+    result.success = true;
+    return result;
+}
+
+bool RealSystemOps::makeDirectoryBelow(const QString &root, const QString &path, uid_t uid, gid_t gid,
+                                       QString &error)
+{
+    const int fd = createDirectoryBelow(root, path, uid, gid);
+    if (fd < 0) {
+        error = QStringLiteral("Failed to create directory %1: %2")
+                    .arg(path, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+FileTransfer RealSystemOps::transferFile(int sourceFd, const QString &root, const QString &path, uid_t uid, gid_t gid,
+                                         mode_t mode)
+{
+    FileTransfer result;
+    auto fail = [&result](const QString &what) {
+        result.error = QStringLiteral("%1: %2").arg(what, QString::fromLocal8Bit(strerror(errno)));
+        return result;
+    };
+
+    struct stat st;
+    if (fstat(sourceFd, &st) != 0) {
+        return fail(QStringLiteral("Failed to stat source"));
+    }
+
+    const QString clean = QDir::cleanPath(path);
+    const QString directory = clean.left(clean.lastIndexOf(QLatin1Char('/')));
+    const QByteArray name = QFile::encodeName(clean.mid(directory.size() + 1));
+    if (name.isEmpty() || name == "." || name == "..") {
+        errno = EINVAL;
+        return fail(QStringLiteral("Invalid target %1").arg(path));
+    }
+
+    // Everything below happens relative to the directory, so a symlink can't redirect it
+    const int dirFd = createDirectoryBelow(root, directory, uid, gid);
+    if (dirFd < 0) {
+        return fail(QStringLiteral("Failed to open %1").arg(directory));
+    }
+
+    // Unnamed until complete; filesystems without O_TMPFILE get a hidden temporary name
+    QByteArray tempName;
+    int fd = openat(dirFd, ".", O_TMPFILE | O_WRONLY | O_CLOEXEC, mode);
+    if (fd < 0 && (errno == EOPNOTSUPP || errno == EISDIR || errno == EINVAL)) {
+        tempName = name + ".couchplay-" + QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+        fd = openat(dirFd, tempName.constData(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, mode);
+    }
+    if (fd < 0) {
+        fail(QStringLiteral("Failed to create file in %1").arg(directory));
+        close(dirFd);
+        return result;
+    }
+
+    const qint64 copied = copyFileContent(sourceFd, fd, st.st_size, result.method);
+    bool ok = copied == st.st_size;
+    if (!ok) {
+        fail(QStringLiteral("Copied %1 of %2 bytes").arg(copied).arg(st.st_size));
+    } else if (fchown(fd, uid, gid) != 0 || fchmod(fd, mode) != 0) {
+        fail(QStringLiteral("Failed to set ownership"));
+        ok = false;
+    }
+
+    if (ok && tempName.isEmpty()) {
+        // linkat() can't replace, so name it next to the target and rename that over it
+        const QByteArray procPath = "/proc/self/fd/" + QByteArray::number(fd);
+        tempName = name + ".couchplay-" + QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+        if (linkat(AT_FDCWD, procPath.constData(), dirFd, tempName.constData(), AT_SYMLINK_FOLLOW) != 0) {
+            fail(QStringLiteral("Failed to link file"));
+            tempName.clear();
+            ok = false;
+        }
+    }
+    close(fd);
+
+    if (ok && renameat(dirFd, tempName.constData(), dirFd, name.constData()) != 0) {
+        fail(QStringLiteral("Failed to replace %1").arg(path));
+        ok = false;
+    }
+    if (!ok && !tempName.isEmpty()) {
+        unlinkat(dirFd, tempName.constData(), 0);
+    }
+    close(dirFd);
+
+    result.success = ok;
+    result.bytes = ok ? copied : 0;
+    return result;
+}
+
 // Device path validation
 bool RealSystemOps::statPath(const QString &path, struct stat *buf)
 {
@@ -91,6 +864,224 @@ int RealSystemOps::chmod(const QString &path, mode_t mode)
     return ::chmod(path.toLocal8Bit().constData(), mode);
 }
 
+// Mounts, through the mount API syscalls (glibc only wraps them since 2.36)
+namespace {
+
+QString errnoString(const char *what)
+{
+    return QStringLiteral("%1: %2").arg(QLatin1String(what), QString::fromLocal8Bit(strerror(errno)));
+}
+
+// The user namespace an idmapped mount takes its mapping from: held open by
+// a child that does nothing else, mapped by us from outside
+int idmapNamespace(uid_t fromUid, gid_t fromGid, uid_t toUid, gid_t toGid, QString &error)
+{
+    int ready[2];
+    int release[2];
+    if (pipe2(ready, O_CLOEXEC) != 0) {
+        error = errnoString("pipe");
+        return -1;
+    }
+    if (pipe2(release, O_CLOEXEC) != 0) {
+        error = errnoString("pipe");
+        close(ready[0]);
+        close(ready[1]);
+        return -1;
+    }
+
+    const pid_t child = fork();
+    if (child == 0) {
+        // Only async-signal-safe calls between fork and _exit
+        char byte = unshare(CLONE_NEWUSER) == 0 ? 1 : 0;
+        (void)!write(ready[1], &byte, 1);
+        (void)!read(release[0], &byte, 1);
+        _exit(0);
+    }
+    close(ready[1]);
+    close(release[0]);
+    if (child < 0) {
+        error = errnoString("fork");
+        close(ready[0]);
+        close(release[1]);
+        return -1;
+    }
+
+    int nsFd = -1;
+    char byte = 0;
+    if (read(ready[0], &byte, 1) == 1 && byte == 1) {
+        const QByteArray proc = "/proc/" + QByteArray::number(child);
+        const QByteArray uidMap = QByteArray::number(fromUid) + ' ' + QByteArray::number(toUid) + " 1\n";
+        const QByteArray gidMap = QByteArray::number(fromGid) + ' ' + QByteArray::number(toGid) + " 1\n";
+        auto writeMap = [](const QByteArray &path, const QByteArray &map) {
+            const int fd = open(path.constData(), O_WRONLY | O_CLOEXEC);
+            const bool ok = fd >= 0 && write(fd, map.constData(), map.size()) == map.size();
+            if (fd >= 0) {
+                close(fd);
+            }
+            return ok;
+        };
+        if (writeMap(proc + "/uid_map", uidMap) && writeMap(proc + "/gid_map", gidMap)) {
+            nsFd = open((proc + "/ns/user").constData(), O_RDONLY | O_CLOEXEC);
+        }
+        if (nsFd < 0) {
+            error = errnoString("Failed to map user namespace");
+        }
+    } else {
+        error = QStringLiteral("Failed to create a user namespace");
+    }
+
+    close(ready[0]);
+    close(release[1]);  // Lets the child exit
+    waitpid(child, nullptr, 0);
+    return nsFd;
+}
+
+bool moveMount(int mountFd, const QString &target, QString &error)
+{
+    if (syscall(SYS_move_mount, mountFd, "", AT_FDCWD, QFile::encodeName(target).constData(),
+                MOVE_MOUNT_F_EMPTY_PATH) != 0) {
+        error = errnoString("move_mount");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool RealSystemOps::mountIdmapped(const QString &source, const QString &target, uid_t fromUid, gid_t fromGid,
+                                  uid_t toUid, gid_t toGid, QString &error)
+{
+    const int treeFd = syscall(SYS_open_tree, AT_FDCWD, QFile::encodeName(source).constData(),
+                               OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC);
+    if (treeFd < 0) {
+        error = errnoString("open_tree");
+        return false;
+    }
+
+    const int nsFd = idmapNamespace(fromUid, fromGid, toUid, toGid, error);
+    if (nsFd < 0) {
+        close(treeFd);
+        return false;
+    }
+
+    struct mount_attr attr = {};
+    attr.attr_set = MOUNT_ATTR_IDMAP | MOUNT_ATTR_RDONLY | MOUNT_ATTR_NOSUID | MOUNT_ATTR_NODEV;
+    attr.userns_fd = nsFd;
+    bool ok = syscall(SYS_mount_setattr, treeFd, "", AT_EMPTY_PATH, &attr, sizeof(attr)) == 0;
+    if (!ok) {
+        // EINVAL: the filesystem doesn't support idmapped mounts
+        error = errnoString("mount_setattr");
+    }
+    close(nsFd);
+
+    ok = ok && moveMount(treeFd, target, error);
+    close(treeFd);
+    return ok;
+}
+
+bool RealSystemOps::mountOverlay(const QString &lower, const QString &upper, const QString &work,
+                                 const QString &target, QString &error)
+{
+    const int fsFd = syscall(SYS_fsopen, "overlay", FSOPEN_CLOEXEC);
+    if (fsFd < 0) {
+        error = errnoString("fsopen");
+        return false;
+    }
+
+    // Set one by one, so commas in the paths need no escaping
+    auto set = [fsFd](const char *key, const QString &value) {
+        return syscall(SYS_fsconfig, fsFd, FSCONFIG_SET_STRING, key,
+                       QFile::encodeName(value).constData(), 0) == 0;
+    };
+    bool ok = set("lowerdir", lower) && set("upperdir", upper) && set("workdir", work)
+        && syscall(SYS_fsconfig, fsFd, FSCONFIG_CMD_CREATE, nullptr, nullptr, 0) == 0;
+    if (!ok) {
+        error = errnoString("overlay");
+        close(fsFd);
+        return false;
+    }
+
+    const int mountFd = syscall(SYS_fsmount, fsFd, FSMOUNT_CLOEXEC, MOUNT_ATTR_NOSUID | MOUNT_ATTR_NODEV);
+    close(fsFd);
+    if (mountFd < 0) {
+        error = errnoString("fsmount");
+        return false;
+    }
+    ok = moveMount(mountFd, target, error);
+    close(mountFd);
+    return ok;
+}
+
+bool RealSystemOps::bindMount(const QString &source, const QString &target, QString &error)
+{
+    const QByteArray sourcePath = QFile::encodeName(source);
+    const int treeFd = syscall(SYS_open_tree, AT_FDCWD, sourcePath.constData(), OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC);
+    if (treeFd >= 0) {
+        const bool ok = moveMount(treeFd, target, error);
+        close(treeFd);
+        return ok;
+    }
+    if (errno != ENOSYS) {
+        error = errnoString("open_tree");
+        return false;
+    }
+
+    // Kernels before 5.2
+    if (syscall(SYS_mount, sourcePath.constData(), QFile::encodeName(target).constData(), nullptr,
+                MS_BIND, nullptr) != 0) {
+        error = errnoString("mount");
+        return false;
+    }
+    return true;
+}
+
+bool RealSystemOps::unmount(const QString &target, QString &error)
+{
+    // MNT_DETACH | UMOUNT_NOFOLLOW; <sys/mount.h> clashes with <linux/mount.h>
+    static constexpr int DETACH_FLAGS = 0x2 | 0x8;
+    if (syscall(SYS_umount2, QFile::encodeName(target).constData(), DETACH_FLAGS) != 0) {
+        error = errnoString("umount2");
+        return false;
+    }
+    return true;
+}
+
+// POSIX ACLs
+AclResult RealSystemOps::grantUserAcl(const QString &path, uid_t uid, bool recursive,
+                                      const DirectoryFingerprints &known)
+{
+    AclResult result;
+
+    // The path itself may be a symlink (e.g. a library on another drive),
+    // only links found while walking the tree are skipped
+    int fd = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_NOCTTY | O_CLOEXEC);
+    if (fd < 0) {
+        result.error = QStringLiteral("%1: %2").arg(path, QString::fromLocal8Bit(strerror(errno)));
+        return result;
+    }
+
+    AclTreeWalker walker(uid, known);
+    const int outcome = walker.applyToFd(fd);
+    if (outcome < 0) {
+        result.error = QStringLiteral("%1: %2").arg(path, QString::fromLocal8Bit(strerror(errno)));
+        ::close(fd);
+        return result;
+    }
+    walker.record(outcome, path);
+    result.success = true;
+
+    struct stat st;
+    if (recursive && fstat(fd, &st) == 0 && S_ISDIR(st.st_mode)) {
+        walker.walk(fd, path, QString());  // Takes ownership of fd
+        walker.waitForDone();
+    } else {
+        ::close(fd);
+    }
+
+    walker.fillResult(result);
+    return result;
+}
+
 // Process operations
 QProcess *RealSystemOps::createProcess(QObject *parent)
 {
@@ -130,16 +1121,426 @@ bool RealSystemOps::killProcess(pid_t pid, int signal)
     return ::kill(pid, signal) == 0;
 }
 
-// Authorization check
-bool RealSystemOps::checkAuthorization(const QString &action)
+int RealSystemOps::openPidfd(pid_t pid)
 {
-    // In a full implementation, this would check PolicyKit
-    // For now, we trust the D-Bus system bus ACL
-    // TODO: Implement proper PolicyKit authorization check
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+}
+
+bool RealSystemOps::signalPidfd(int pidfd, int signal)
+{
+    return syscall(SYS_pidfd_send_signal, pidfd, signal, nullptr, 0) == 0;
+}
 
-    Q_UNUSED(action)
+int RealSystemOps::pidfdExitStatus(int pidfd)
+{
+#ifndef P_PIDFD
+    static constexpr idtype_t P_PIDFD = static_cast<idtype_t>(3);
+#endif
+    // WNOWAIT: QProcess still reaps the children it started
+    siginfo_t info = {};
+    if (waitid(P_PIDFD, static_cast<id_t>(pidfd), &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid == 0) {
+        return -1;
+    }
+    return info.si_code == CLD_EXITED ? info.si_status : 128 + info.si_status;
+}
+
+namespace {
+
+// Real or effective UID from /proc/PID/status; /proc/PID itself is owned by
+// root for processes that aren't dumpable
+bool runsAs(int procFd, const char *pid, uid_t uid)
+{
+    const int fd = openat(procFd, (QByteArray(pid) + "/status").constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    char buffer[4096];
+    const ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0) {
+        return false;
+    }
+    buffer[length] = '\0';
+
+    const char *line = strstr(buffer, "\nUid:");
+    unsigned long real = 0;
+    unsigned long effective = 0;
+    return line && sscanf(line, "\nUid: %lu %lu", &real, &effective) == 2 && (real == uid || effective == uid);
+}
+
+// One of /proc/sysvipc/{sem,shm,msg}: the ID is the second column, the
+// owner's column is found by name in the header
+int removeSysvObjects(const char *table, uid_t uid, int (*remove)(int id))
+{
+    QFile file(QString::fromLatin1(table));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    if (lines.isEmpty()) {
+        return 0;
+    }
+    const qsizetype uidColumn = lines.first().simplified().split(' ').indexOf("uid");
+    if (uidColumn < 0) {
+        return 0;
+    }
 
-    // Check if caller is root or in appropriate group
-    // The system D-Bus policy should restrict who can call us
+    int removed = 0;
+    for (qsizetype i = 1; i < lines.size(); ++i) {
+        const QList<QByteArray> fields = lines[i].simplified().split(' ');
+        if (fields.size() <= uidColumn || fields[uidColumn].toUInt() != uid) {
+            continue;
+        }
+        if (remove(fields[1].toInt()) == 0) {
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+// Depth first like find -delete: a directory goes after its entries, if it
+// is then empty. Takes ownership of @p dirFd.
+int removeOwnedEntries(int dirFd, dev_t device, uid_t uid)
+{
+    DIR *dir = fdopendir(dirFd);
+    if (!dir) {
+        close(dirFd);
+        return 0;
+    }
+
+    int removed = 0;
+    while (dirent *entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        struct stat st;
+        if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 || st.st_dev != device) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            const int child = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (child >= 0) {
+                removed += removeOwnedEntries(child, device, uid);
+            }
+            if (st.st_uid == uid && unlinkat(dirfd(dir), entry->d_name, AT_REMOVEDIR) == 0) {
+                ++removed;
+            }
+        } else if (st.st_uid == uid && unlinkat(dirfd(dir), entry->d_name, 0) == 0) {
+            ++removed;
+        }
+    }
+    closedir(dir);
+    return removed;
+}
+
+} // namespace
+
+// User teardown
+int RealSystemOps::killUserProcesses(uid_t uid, int timeoutMs)
+{
+    // The whole slice in one write (kernel 5.14+)
+    const QByteArray cgroupKill = "/sys/fs/cgroup/user.slice/user-" + QByteArray::number(uid) + ".slice/cgroup.kill";
+    const int killFd = open(cgroupKill.constData(), O_WRONLY | O_CLOEXEC);
+    if (killFd >= 0) {
+        (void)!write(killFd, "1", 1);
+        close(killFd);
+    }
+
+    // Then whatever runs as the user, in the slice or not. The pidfd is
+    // opened before the owner check, so a recycled PID can't be signalled
+    // by mistake, and it becomes readable when the process has exited.
+    std::vector<pollfd> pidfds;
+    if (DIR *proc = opendir("/proc")) {
+        while (dirent *entry = readdir(proc)) {
+            char *end = nullptr;
+            const long pid = strtol(entry->d_name, &end, 10);
+            if (pid <= 0 || *end != '\0') {
+                continue;
+            }
+            const int fd = syscall(SYS_pidfd_open, pid, 0);
+            if (fd < 0) {
+                continue;
+            }
+            if (!runsAs(dirfd(proc), entry->d_name, uid)
+                || syscall(SYS_pidfd_send_signal, fd, SIGKILL, nullptr, 0) != 0) {
+                close(fd);
+                continue;
+            }
+            pidfds.push_back({fd, POLLIN, 0});
+        }
+        closedir(proc);
+    }
+
+    int alive = int(pidfds.size());
+    const QDeadlineTimer deadline(timeoutMs);
+    while (alive > 0 && !deadline.hasExpired()) {
+        const int ready = poll(pidfds.data(), pidfds.size(), int(deadline.remainingTime()));
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            break;
+        }
+        for (pollfd &pidfd : pidfds) {
+            if (pidfd.fd >= 0 && pidfd.revents != 0) {
+                close(pidfd.fd);
+                pidfd.fd = -1;  // poll() skips it from now on
+                --alive;
+            }
+        }
+    }
+    for (const pollfd &pidfd : pidfds) {
+        if (pidfd.fd >= 0) {
+            close(pidfd.fd);
+        }
+    }
+    return alive;
+}
+
+int RealSystemOps::removeUserIpc(uid_t uid)
+{
+    return removeSysvObjects("/proc/sysvipc/sem", uid, [](int id) { return semctl(id, 0, IPC_RMID); })
+        + removeSysvObjects("/proc/sysvipc/shm", uid, [](int id) { return shmctl(id, IPC_RMID, nullptr); })
+        + removeSysvObjects("/proc/sysvipc/msg", uid, [](int id) { return msgctl(id, IPC_RMID, nullptr); });
+}
+
+int RealSystemOps::removeOwnedFiles(const QString &root, uid_t uid)
+{
+    const int fd = open(QFile::encodeName(root).constData(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+    return removeOwnedEntries(fd, st.st_dev, uid);
+}
+
+bool RealSystemOps::setUserLinger(uid_t uid, bool enable, QString &error)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        QStringLiteral("org.freedesktop.login1"), QStringLiteral("/org/freedesktop/login1"),
+        QStringLiteral("org.freedesktop.login1.Manager"), QStringLiteral("SetUserLinger"));
+    message.setArguments({uint(uid), enable, false});
+    const QDBusMessage reply = QDBusConnection::systemBus().call(message);
+    if (reply.type() != QDBusMessage::ReplyMessage) {
+        error = reply.errorMessage();
+        return false;
+    }
     return true;
 }
+
+// Transient services
+qint64 RealSystemOps::startTransientUnit(const TransientUnitSpec &spec, QString &error)
+{
+    registerSystemdTypes();
+
+    if (spec.argv.isEmpty()) {
+        error = QStringLiteral("No command for unit %1").arg(spec.name);
+        return 0;
+    }
+
+    const QList<SystemdExecCommand> execStart{{spec.argv.first(), spec.argv, false}};
+    QList<SystemdProperty> properties{
+        unitProperty(QStringLiteral("Description"), spec.description),
+        // Start returns once the executable has been exec'd, so MainPID is final
+        unitProperty(QStringLiteral("Type"), QStringLiteral("exec")),
+        unitProperty(QStringLiteral("User"), spec.user),
+        unitProperty(QStringLiteral("Slice"), QStringLiteral("user-%1.slice").arg(spec.uid)),
+        unitProperty(QStringLiteral("WorkingDirectory"), QStringLiteral("~")),
+        unitProperty(QStringLiteral("ExecStart"), QVariant::fromValue(execStart)),
+        unitProperty(QStringLiteral("Environment"), spec.environment),
+        unitProperty(QStringLiteral("StandardOutput"), QStringLiteral("journal")),
+        unitProperty(QStringLiteral("StandardError"), QStringLiteral("journal")),
+        unitProperty(QStringLiteral("KillMode"), QStringLiteral("control-group")),
+        // Don't leave failed units behind, each launch gets a fresh name anyway
+        unitProperty(QStringLiteral("CollectMode"), QStringLiteral("inactive-or-failed")),
+    };
+    if (!spec.syslogIdentifier.isEmpty()) {
+        properties << unitProperty(QStringLiteral("SyslogIdentifier"), spec.syslogIdentifier);
+    }
+    if (!spec.logFields.isEmpty()) {
+        QList<QByteArray> fields;
+        for (const QString &field : spec.logFields) {
+            fields << field.toUtf8();
+        }
+        properties << unitProperty(QStringLiteral("LogExtraFields"), QVariant::fromValue(fields));
+    }
+    for (auto it = spec.properties.constBegin(); it != spec.properties.constEnd(); ++it) {
+        properties << unitProperty(it.key(), it.value());
+    }
+
+    const QDBusMessage reply = callSystemd(QStringLiteral("StartTransientUnit"), {
+        spec.name,
+        QStringLiteral("fail"),
+        QVariant::fromValue(properties),
+        QVariant::fromValue(QList<SystemdAuxUnit>()),
+    });
+    if (reply.type() != QDBusMessage::ReplyMessage) {
+        error = QStringLiteral("Failed to start %1: %2").arg(spec.name, reply.errorMessage());
+        return 0;
+    }
+
+    // The start job runs asynchronously; wait for the fork/exec
+    const QDeadlineTimer deadline(5000);
+    while (!deadline.hasExpired()) {
+        const QVariant mainPid = serviceProperty(spec.name, QStringLiteral("MainPID"));
+        if (!mainPid.isValid()) {
+            // Transient units are loaded by StartTransientUnit, gone means collected
+            error = QStringLiteral("Unit %1 exited during startup").arg(spec.name);
+            return 0;
+        }
+        if (mainPid.toLongLong() > 0) {
+            return mainPid.toLongLong();
+        }
+        const QString result = serviceProperty(spec.name, QStringLiteral("Result")).toString();
+        if (!result.isEmpty() && result != QStringLiteral("success")) {
+            error = QStringLiteral("Unit %1 failed to start: %2").arg(spec.name, result);
+            return 0;
+        }
+        QThread::msleep(10);
+    }
+
+    error = QStringLiteral("Timed out waiting for %1 to start").arg(spec.name);
+    callSystemd(QStringLiteral("StopUnit"), {spec.name, QStringLiteral("replace")});
+    return 0;
+}
+
+bool RealSystemOps::killUnit(const QString &unit, int signal)
+{
+    const QDBusMessage reply = callSystemd(QStringLiteral("KillUnit"), {unit, QStringLiteral("all"), signal});
+    return reply.type() == QDBusMessage::ReplyMessage;
+}
+
+bool RealSystemOps::setUnitProperties(const QString &unit, const QVariantMap &properties, QString &error)
+{
+    registerSystemdTypes();
+
+    QList<SystemdProperty> list;
+    for (auto it = properties.constBegin(); it != properties.constEnd(); ++it) {
+        list << unitProperty(it.key(), it.value());
+    }
+
+    // runtime=true: the change lasts until the unit stops, nothing is written to /etc
+    const QDBusMessage reply = callSystemd(QStringLiteral("SetUnitProperties"),
+                                           {unit, true, QVariant::fromValue(list)});
+    if (reply.type() != QDBusMessage::ReplyMessage) {
+        error = QStringLiteral("Failed to update %1: %2").arg(unit, reply.errorMessage());
+        return false;
+    }
+    return true;
+}
+
+QList<JournalEntry> RealSystemOps::readJournal(const QString &identifier, const QString &afterCursor,
+                                               int maxEntries, QString &cursor)
+{
+    cursor = afterCursor;
+
+    // From a cursor journalctl reads forward and stops after --lines,
+    // without one it starts that many entries before the end
+    QStringList args{QStringLiteral("--no-pager"), QStringLiteral("--quiet"),
+                     QStringLiteral("--output=json"), QStringLiteral("--lines=%1").arg(maxEntries)};
+    if (!afterCursor.isEmpty()) {
+        args << QStringLiteral("--after-cursor=%1").arg(afterCursor);
+    }
+    args << QStringLiteral("SYSLOG_IDENTIFIER=%1").arg(identifier);
+
+    QProcess journalctl;
+    journalctl.start(QStringLiteral("journalctl"), args);
+    if (!journalctl.waitForFinished(5000)) {
+        journalctl.kill();
+        journalctl.waitForFinished(1000);
+        return {};
+    }
+
+    QList<JournalEntry> entries;
+    const QList<QByteArray> lines = journalctl.readAllStandardOutput().split('\n');
+    for (const QByteArray &line : lines) {
+        const QJsonObject object = QJsonDocument::fromJson(line).object();
+        if (object.isEmpty()) {
+            continue;
+        }
+
+        JournalEntry entry;
+        // Messages that aren't valid UTF-8 come as an array of bytes
+        const QJsonValue message = object.value(QLatin1String("MESSAGE"));
+        if (message.isArray()) {
+            QByteArray bytes;
+            for (const QJsonValue &byte : message.toArray()) {
+                bytes.append(char(byte.toInt()));
+            }
+            entry.message = QString::fromUtf8(bytes);
+        } else {
+            entry.message = message.toString();
+        }
+        entry.timestampUs = object.value(QLatin1String("__REALTIME_TIMESTAMP")).toString().toLongLong();
+        bool ok = false;
+        const int priority = object.value(QLatin1String("PRIORITY")).toString().toInt(&ok);
+        if (ok) {
+            entry.priority = priority;
+        }
+        cursor = object.value(QLatin1String("__CURSOR")).toString();
+        entries.append(entry);
+    }
+    return entries;
+}
+
+// Input routing
+InputRouter *RealSystemOps::createInputRouter(QObject *parent)
+{
+    return new InputRouter(parent);
+}
+
+// Authorization check
+bool RealSystemOps::checkAuthorization(const QString &action, const QString &subject, bool allowInteraction)
+{
+    // The helper's own calls (cleanup on exit) need no authorization
+    if (subject.isEmpty()) {
+        return true;
+    }
+
+    // CheckAuthorization((sa{sv}) subject, s action, a{ss} details, u flags, s cancellation)
+    QDBusArgument subjectArg;
+    subjectArg.beginStructure();
+    subjectArg << QStringLiteral("system-bus-name");
+    subjectArg.beginMap(QMetaType::fromType<QString>(), QMetaType::fromType<QDBusVariant>());
+    subjectArg.beginMapEntry();
+    subjectArg << QStringLiteral("name") << QDBusVariant(subject);
+    subjectArg.endMapEntry();
+    subjectArg.endMap();
+    subjectArg.endStructure();
+
+    QDBusArgument details;
+    details.beginMap(QMetaType::fromType<QString>(), QMetaType::fromType<QString>());
+    details.endMap();
+
+    static constexpr uint ALLOW_USER_INTERACTION = 0x1;
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        QStringLiteral("org.freedesktop.PolicyKit1"), QStringLiteral("/org/freedesktop/PolicyKit1/Authority"),
+        QStringLiteral("org.freedesktop.PolicyKit1.Authority"), QStringLiteral("CheckAuthorization"));
+    message.setArguments({QVariant::fromValue(subjectArg), action, QVariant::fromValue(details),
+                          allowInteraction ? ALLOW_USER_INTERACTION : 0u, QString()});
+    // An interactive check waits for the user to answer the prompt
+    const QDBusMessage reply = QDBusConnection::systemBus().call(message, QDBus::Block,
+                                                                 allowInteraction ? 5 * 60 * 1000 : 25000);
+
+    if (reply.type() != QDBusMessage::ReplyMessage) {
+        // Including no polkitd at all: a root helper doesn't fall back to allowing
+        qWarning() << "polkit check of" << action << "failed:" << reply.errorMessage();
+        return false;
+    }
+    if (reply.arguments().isEmpty()) {
+        return false;
+    }
+
+    // (bba{ss}) is_authorized, is_challenge, details
+    const QDBusArgument result = reply.arguments().constFirst().value<QDBusArgument>();
+    bool authorized = false;
+    bool challenge = false;
+    result.beginStructure();
+    result >> authorized >> challenge;
+    result.endStructure();
+    return authorized;
+}
@@ -6,12 +6,14 @@
 #include <QByteArray>
 #include <QDir>
 #include <QFileInfo>
+#include <QHash>
 #include <QIODevice>
 #include <QObject>
 #include <QProcess>
 #include <QString>
 #include <QStringList>
 #include <QThread>
+#include <QVariantMap>
 
 #include <pwd.h>
 #include <grp.h>
@@ -19,6 +21,68 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+class InputRouter;
+
+/**
+ * DirectoryFingerprints - inode/mtime fingerprint per directory of a tree
+ *
+ * Keyed by path relative to the walked root ("" is the root itself). A
+ * directory's mtime changes whenever an entry is added, removed or renamed
+ * in it, but not when ACLs of its entries change.
+ */
+using DirectoryFingerprints = QHash<QString, quint64>;
+
+/**
+ * AclResult - Outcome of SystemOps::grantUserAcl()
+ */
+struct AclResult {
+    bool success = false;   // The root path was processed (entries below it may still fail)
+    qint64 updated = 0;     // Entries that received the ACL entry
+    qint64 unchanged = 0;   // Entries that already carried it and were not rewritten
+    qint64 skipped = 0;     // Directories whose entries were skipped as unchanged
+    qint64 failed = 0;      // Entries that could not be read or updated
+    QString error;          // First error encountered
+    DirectoryFingerprints directories;  // Fingerprints seen by a recursive walk
+};
+
+/**
+ * FileTransfer - Outcome of SystemOps::transferFile()
+ */
+struct FileTransfer {
+    bool success = false;
+    qint64 bytes = 0;       // Bytes now in the target
+    QString method;         // "reflink", "copy_file_range", "sendfile" or "copy"
+    QString error;
+};
+
+/**
+ * TransientUnitSpec - Service started by SystemOps::startTransientUnit()
+ *
+ * The service runs as @c user inside the user's slice (user-UID.slice), so
+ * it is accounted to the user like anything their own manager starts, but
+ * is owned by the system manager that the helper can talk to as root.
+ */
+struct TransientUnitSpec {
+    QString name;               // Unit name including the ".service" suffix
+    QString description;
+    QString user;               // User= of the service
+    uid_t uid = 0;              // Selects user-UID.slice
+    QStringList argv;           // argv[0] is the absolute path of the executable
+    QStringList environment;    // VAR=value, applied on top of the user's defaults
+    QString syslogIdentifier;   // Journal identifier for stdout/stderr
+    QStringList logFields;      // FIELD=value added to each of its journal entries
+    QVariantMap properties;     // Further unit properties, systemd names with D-Bus typed values
+};
+
+/**
+ * One line of an instance's output, as read back from the journal
+ */
+struct JournalEntry {
+    QString message;
+    qint64 timestampUs = 0;     // Wall clock, microseconds since the epoch
+    int priority = 6;           // syslog priority, stdout is "info"
+};
+
 /**
  * SystemOps - Abstract interface for system operations
  *
@@ -39,9 +103,30 @@ public:
     virtual bool fileExists(const QString &path) = 0;
     virtual bool isDirectory(const QString &path) = 0;
     virtual bool mkpath(const QString &path) = 0;
+    // Create the missing directories of @p path below @p root, owned by
+    // uid:gid. No component below @p root may be a symlink, not even one
+    // swapped in meanwhile; @p path may be @p root itself.
+    virtual bool makeDirectoryBelow(const QString &root, const QString &path, uid_t uid, gid_t gid,
+                                    QString &error) = 0;
     virtual bool removeFile(const QString &path) = 0;
     virtual bool copyFile(const QString &source, const QString &dest) = 0;
     virtual bool writeFile(const QString &path, const QByteArray &content) = 0;
+    // Copy everything in @p sourceFd (from offset 0) to @p path, owned by
+    // uid:gid with @p mode. The content is assembled in an unnamed file in
+    // the target directory and renamed over @p path once complete, so
+    // readers see either the old or the new file. @p path must lie below
+    // @p root; its directory is opened (and created, see makeDirectoryBelow())
+    // without following symlinks and everything happens relative to it.
+    virtual FileTransfer transferFile(int sourceFd, const QString &root, const QString &path, uid_t uid, gid_t gid,
+                                      mode_t mode) = 0;
+    // Recreate the tree at @p source as the new directory @p target, owned by
+    // uid:gid, with every regular file a reflink of the original (method
+    // "reflink"). Fails, leaving no target behind, if @p target exists or
+    // the filesystem can't share extents between the two. Symlinks in the
+    // tree are recreated, never followed; with @p root set, @p source must
+    // lie below it and no component of it below @p root may be a symlink.
+    virtual FileTransfer seedDirectory(const QString &source, const QString &target, uid_t uid, gid_t gid,
+                                       const QString &root = QString()) = 0;
 
     // Device path validation
     virtual bool statPath(const QString &path, struct stat *buf) = 0;
@@ -51,6 +136,25 @@ public:
     virtual int chown(const QString &path, uid_t owner, gid_t group) = 0;
     virtual int chmod(const QString &path, mode_t mode) = 0;
 
+    // Mounts. mountIdmapped() attaches a read-only view of @p source at
+    // @p target in which files owned by fromUid/fromGid appear as
+    // toUid/toGid (MOUNT_ATTR_IDMAP). mountOverlay() mounts @p lower with
+    // @p upper on top at @p target; both need kernel 5.19 or later.
+    virtual bool mountIdmapped(const QString &source, const QString &target, uid_t fromUid, gid_t fromGid,
+                               uid_t toUid, gid_t toGid, QString &error) = 0;
+    virtual bool mountOverlay(const QString &lower, const QString &upper, const QString &work,
+                              const QString &target, QString &error) = 0;
+    // Bind mount @p source at @p target (like mount --bind). unmount() detaches
+    // @p target at once (MNT_DETACH); files still open under it stay usable.
+    virtual bool bindMount(const QString &source, const QString &target, QString &error) = 0;
+    virtual bool unmount(const QString &target, QString &error) = 0;
+
+    // POSIX ACLs: add/extend a named-user entry to rx (like setfacl -m u:UID:rx),
+    // leaving entries that already grant it untouched. In a recursive walk the
+    // entries of directories whose fingerprint matches @p known are not checked.
+    virtual AclResult grantUserAcl(const QString &path, uid_t uid, bool recursive,
+                                   const DirectoryFingerprints &known) = 0;
+
     // Process operations
     virtual QProcess *createProcess(QObject *parent = nullptr) = 0;
     virtual void startProcess(QProcess *process, const QString &program, const QStringList &arguments) = 0;
@@ -64,8 +168,50 @@ public:
     // Process signaling
     virtual bool killProcess(pid_t pid, int signal) = 0;
 
-    // Authorization check
-    virtual bool checkAuthorization(const QString &action) = 0;
+    // pidfds for supervising launched instances. openPidfd() returns -1 if
+    // the process is gone or pidfds are unsupported; the fd becomes readable
+    // once the process exits. pidfdExitStatus() reads the exit status
+    // without reaping (the exit code, 128 + signal if killed) and returns -1
+    // unless the process is a child that hasn't been reaped yet.
+    virtual int openPidfd(pid_t pid) = 0;
+    virtual bool signalPidfd(int pidfd, int signal) = 0;
+    virtual int pidfdExitStatus(int pidfd) = 0;
+
+    // User teardown, all without child processes. killUserProcesses()
+    // SIGKILLs every process running as @p uid (the user's slice through
+    // cgroup.kill, the rest through pidfds) and waits up to @p timeoutMs for
+    // them to exit; returns how many are still alive. removeUserIpc() removes
+    // the SysV semaphores, shared memory segments and message queues owned by
+    // @p uid. removeOwnedFiles() deletes what @p uid owns below @p root like
+    // find ROOT -xdev -user UID -delete. The last two return how many objects
+    // were removed. setUserLinger() goes through logind.
+    virtual int killUserProcesses(uid_t uid, int timeoutMs) = 0;
+    virtual int removeUserIpc(uid_t uid) = 0;
+    virtual int removeOwnedFiles(const QString &root, uid_t uid) = 0;
+    virtual bool setUserLinger(uid_t uid, bool enable, QString &error) = 0;
+
+    // Transient services through systemd's D-Bus API (like systemd-run).
+    // startTransientUnit() returns the service's main PID once the executable
+    // has been started, 0 on failure; killUnit() signals every process in the
+    // unit's cgroup and fails if the unit is gone.
+    virtual qint64 startTransientUnit(const TransientUnitSpec &spec, QString &error) = 0;
+    virtual bool killUnit(const QString &unit, int signal) = 0;
+    // Change properties (e.g. CPUWeight) of a running unit until it stops
+    virtual bool setUnitProperties(const QString &unit, const QVariantMap &properties, QString &error) = 0;
+
+    // Journal entries with SYSLOG_IDENTIFIER=@p identifier, oldest first:
+    // the last @p maxEntries without a cursor, otherwise at most that many
+    // following @p afterCursor. @p cursor is set to the last entry returned
+    // (left at @p afterCursor when there is nothing new).
+    virtual QList<JournalEntry> readJournal(const QString &identifier, const QString &afterCursor,
+                                            int maxEntries, QString &cursor) = 0;
+
+    // Input routing (evdev grab + uinput); nullptr if unsupported
+    virtual InputRouter *createInputRouter(QObject *parent) = 0;
+
+    // Authorization check of the D-Bus caller @p subject (a unique bus name;
+    // empty for the helper itself). @p allowInteraction lets polkit prompt.
+    virtual bool checkAuthorization(const QString &action, const QString &subject, bool allowInteraction) = 0;
 };
 
 /**
@@ -87,9 +233,15 @@ public:
     bool fileExists(const QString &path) override;
     bool isDirectory(const QString &path) override;
     bool mkpath(const QString &path) override;
+    bool makeDirectoryBelow(const QString &root, const QString &path, uid_t uid, gid_t gid,
+                            QString &error) override;
     bool removeFile(const QString &path) override;
     bool copyFile(const QString &source, const QString &dest) override;
     bool writeFile(const QString &path, const QByteArray &content) override;
+    FileTransfer transferFile(int sourceFd, const QString &root, const QString &path, uid_t uid, gid_t gid,
+                              mode_t mode) override;
+    FileTransfer seedDirectory(const QString &source, const QString &target, uid_t uid, gid_t gid,
+                               const QString &root = QString()) override;
 
     // Device path validation
     bool statPath(const QString &path, struct stat *buf) override;
@@ -98,6 +250,16 @@ public:
     // Ownership and permissions
     int chown(const QString &path, uid_t owner, gid_t group) override;
     int chmod(const QString &path, mode_t mode) override;
+    bool mountIdmapped(const QString &source, const QString &target, uid_t fromUid, gid_t fromGid,
+                       uid_t toUid, gid_t toGid, QString &error) override;
+    bool mountOverlay(const QString &lower, const QString &upper, const QString &work,
+                      const QString &target, QString &error) override;
+    bool bindMount(const QString &source, const QString &target, QString &error) override;
+    bool unmount(const QString &target, QString &error) override;
+
+    // POSIX ACLs
+    AclResult grantUserAcl(const QString &path, uid_t uid, bool recursive,
+                           const DirectoryFingerprints &known) override;
 
     // Process operations
     QProcess *createProcess(QObject *parent = nullptr) override;
@@ -111,7 +273,26 @@ public:
 
     // Process signaling
     bool killProcess(pid_t pid, int signal) override;
+    int openPidfd(pid_t pid) override;
+    bool signalPidfd(int pidfd, int signal) override;
+    int pidfdExitStatus(int pidfd) override;
+
+    // User teardown
+    int killUserProcesses(uid_t uid, int timeoutMs) override;
+    int removeUserIpc(uid_t uid) override;
+    int removeOwnedFiles(const QString &root, uid_t uid) override;
+    bool setUserLinger(uid_t uid, bool enable, QString &error) override;
+
+    // Transient services
+    qint64 startTransientUnit(const TransientUnitSpec &spec, QString &error) override;
+    bool killUnit(const QString &unit, int signal) override;
+    bool setUnitProperties(const QString &unit, const QVariantMap &properties, QString &error) override;
+    QList<JournalEntry> readJournal(const QString &identifier, const QString &afterCursor,
+                                    int maxEntries, QString &cursor) override;
+
+    // Input routing
+    InputRouter *createInputRouter(QObject *parent) override;
 
     // Authorization check
-    bool checkAuthorization(const QString &action) override;
+    bool checkAuthorization(const QString &action, const QString &subject, bool allowInteraction) override;
 };
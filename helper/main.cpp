@@ -18,6 +18,9 @@ int main(int argc, char *argv[])
     // Create the helper service
     CouchPlayHelper helper;
 
+    // For the node exporter's textfile collector, see data/dbus/couchplay-helper.service
+    helper.setMetricsFile(qEnvironmentVariable("COUCHPLAY_HELPER_METRICS_FILE"));
+
     // Register on the system bus
     QDBusConnection systemBus = QDBusConnection::systemBus();
     
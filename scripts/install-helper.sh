@@ -32,6 +32,7 @@ LIBEXEC_DIR="/usr/local/libexec"
 DBUS_SYSTEM_DIR="/etc/dbus-1/system.d"
 DBUS_SERVICE_DIR="/usr/local/share/dbus-1/system-services"
 SYSTEMD_DIR="/etc/systemd/system"
+UDEV_RULES_DIR="/etc/udev/rules.d"
 # Polkit actions usually reside in /usr/share/polkit-1/actions.
 # On immutable systems, we try /etc/polkit-1/actions if /usr is read-only.
 if [ -w "/usr/share/polkit-1/actions" ]; then
@@ -112,6 +113,11 @@ install_helper() {
     install -Dm644 "${DATA_DIR}/polkit/io.github.hikaps.couchplay.policy" \
         "${POLKIT_DIR}/io.github.hikaps.couchplay.policy"
 
+    # Install udev rule for the input router's virtual devices
+    print_info "Installing udev rule..."
+    install -Dm644 "${DATA_DIR}/udev/00-couchplay-router.rules" \
+        "${UDEV_RULES_DIR}/00-couchplay-router.rules"
+
     # Reload systemd
     print_info "Reloading systemd..."
     systemctl daemon-reload
@@ -120,6 +126,11 @@ install_helper() {
     print_info "Reloading D-Bus configuration..."
     systemctl reload dbus 2>/dev/null || true
 
+    # Reload udev rules, applying them to devices that already exist
+    print_info "Reloading udev rules..."
+    udevadm control --reload-rules 2>/dev/null || true
+    udevadm trigger --subsystem-match=input --action=change 2>/dev/null || true
+
     # Enable and restart service (restart ensures new binary is loaded)
     print_info "Enabling and restarting service..."
     systemctl enable couchplay-helper.service
@@ -148,6 +159,7 @@ uninstall_helper() {
     rm -f "${DBUS_SERVICE_DIR}/io.github.hikaps.CouchPlayHelper.service"
     rm -f "${SYSTEMD_DIR}/couchplay-helper.service"
     rm -f "${POLKIT_DIR}/io.github.hikaps.couchplay.policy"
+    rm -f "${UDEV_RULES_DIR}/00-couchplay-router.rules"
 
     # Reload systemd
     print_info "Reloading systemd..."
@@ -157,6 +169,10 @@ uninstall_helper() {
     print_info "Reloading D-Bus configuration..."
     systemctl reload dbus 2>/dev/null || true
 
+    # Reload udev rules
+    print_info "Reloading udev rules..."
+    udevadm control --reload-rules 2>/dev/null || true
+
     print_info "Uninstallation complete!"
 }
 
@@ -200,6 +216,13 @@ status_helper() {
         echo -e "PolicyKit:       ${RED}Not installed${NC}"
     fi
 
+    # Check udev rule
+    if [[ -f "${UDEV_RULES_DIR}/00-couchplay-router.rules" ]]; then
+        echo -e "udev rule:       ${GREEN}Installed${NC}"
+    else
+        echo -e "udev rule:       ${RED}Not installed${NC}"
+    fi
+
     echo ""
 
     # Check service status
@@ -2,6 +2,9 @@
 // SPDX-FileCopyrightText: 2024 hikaps
 
 #include "AudioManager.h"
+#include "Logging.h"
+#include "PipeWireGraph.h"
+#include "StartupTrace.h"
 
 #include <QFile>
 #include <QDir>
@@ -9,12 +12,71 @@
 #include <QStandardPaths>
 #include <QDebug>
 
+#include <arpa/inet.h>
+#include <cerrno>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Port the TCP module listens on, see configureMultiUser()
+constexpr quint16 kTcpPort = 4713;
+
+// Whether something listens at @p address; a refused or missing socket answers at once
+bool acceptsConnections(int domain, const sockaddr *address, socklen_t length)
+{
+    const int fd = ::socket(domain, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool accepted = ::connect(fd, address, length) == 0 || errno == EAGAIN;
+    if (!accepted && errno == EINPROGRESS) {
+        pollfd pfd = {fd, POLLOUT, 0};
+        int error = 0;
+        socklen_t errorLength = sizeof(error);
+        accepted = ::poll(&pfd, 1, 100) == 1
+            && ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) == 0 && error == 0;
+    }
+    ::close(fd);
+    return accepted;
+}
+
+bool unixSocketAccepts(const QString &path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    const QByteArray encoded = QFile::encodeName(path);
+    if (encoded.size() >= qsizetype(sizeof(address.sun_path))) {
+        return false;
+    }
+    memcpy(address.sun_path, encoded.constData(), encoded.size());
+    return acceptsConnections(AF_UNIX, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+}
+
+bool loopbackPortAccepts(quint16 port)
+{
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return acceptsConnections(AF_INET, reinterpret_cast<const sockaddr *>(&address), sizeof(address));
+}
+
+} // namespace
+
 AudioManager::AudioManager(QObject *parent)
     : QObject(parent)
+    , m_runtimeDir(qEnvironmentVariable("XDG_RUNTIME_DIR", QStringLiteral("/run/user/%1").arg(getuid())))
 {
+    StartupTrace::Scope trace("AudioManager");
     // Detect audio server
-    if (QFile::exists(QStringLiteral("/run/user/1000/pipewire-0"))) {
+    if (QFile::exists(m_runtimeDir + QStringLiteral("/pipewire-0"))) {
         m_audioServer = QStringLiteral("pipewire");
+        connectGraph();
     } else {
         m_audioServer = QStringLiteral("pulseaudio");
     }
@@ -24,16 +86,88 @@ AudioManager::AudioManager(QObject *parent)
 
 AudioManager::~AudioManager() = default;
 
+void AudioManager::connectGraph()
+{
+    if (!PipeWireGraph::isCompiledIn()) {
+        return;
+    }
+
+    auto *graph = new PipeWireGraph(this);
+    QString error;
+    if (!graph->connectToDaemon(error)) {
+        qCWarning(couchplayCore) << "Per-player audio unavailable:" << error;
+        delete graph;
+        return;
+    }
+
+    connect(graph, &PipeWireGraph::disconnected, this, [this, graph]() {
+        qCWarning(couchplayCore) << "Lost the PipeWire connection, per-player sinks are gone";
+        graph->deleteLater();
+        m_graph = nullptr;
+        Q_EMIT perPlayerAudioChanged();
+    });
+    m_graph = graph;
+    Q_EMIT perPlayerAudioChanged();
+}
+
+bool AudioManager::hasPerPlayerAudio() const
+{
+    return m_graph && m_graph->isConnected();
+}
+
+QString AudioManager::playerSinkName(int index)
+{
+    return QStringLiteral("couchplay-player-%1").arg(index + 1);
+}
+
+bool AudioManager::createPlayerSinks(int count)
+{
+    if (!hasPerPlayerAudio()) {
+        return false;
+    }
+
+    const QStringList existing = m_graph->sinks();
+    bool ok = true;
+    for (int i = 0; i < count; ++i) {
+        const QString name = playerSinkName(i);
+        if (existing.contains(name)) {
+            continue;
+        }
+        QString error;
+        if (!m_graph->createSink(name, QStringLiteral("CouchPlay Player %1").arg(i + 1), error)) {
+            qCWarning(couchplayCore) << error;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+void AudioManager::removePlayerSinks()
+{
+    if (!m_graph) {
+        return;
+    }
+    for (const QString &name : m_graph->sinks()) {
+        m_graph->destroySink(name);
+    }
+}
+
 void AudioManager::checkConfiguration()
 {
     m_multiUserConfigured = false;
 
-    if (m_audioServer == QStringLiteral("pipewire")) {
-        // Check if PipeWire TCP module is configured
-        // Look for module-native-protocol-tcp in pipewire config
-        
+    // pipewire-pulse or PulseAudio itself; connecting is enough to know it runs
+    m_pulseServerRunning = unixSocketAccepts(m_runtimeDir + QStringLiteral("/pulse/native"));
+
+    // The TCP module is loaded when its port answers
+    if (loopbackPortAccepts(kTcpPort)) {
+        m_multiUserConfigured = true;
+    } else if (m_audioServer == QStringLiteral("pipewire")) {
+        // Configured but pipewire-pulse not restarted yet
         QStringList configPaths = {
+            QDir::homePath() + QStringLiteral("/.config/pipewire/pipewire-pulse.conf.d/"),
             QDir::homePath() + QStringLiteral("/.config/pipewire/pipewire.conf.d/"),
+            QStringLiteral("/etc/pipewire/pipewire-pulse.conf.d/"),
             QStringLiteral("/etc/pipewire/pipewire.conf.d/")
         };
 
@@ -47,7 +181,7 @@ void AudioManager::checkConfiguration()
                 if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
                     QString content = QString::fromUtf8(file.readAll());
                     if (content.contains(QStringLiteral("module-native-protocol-tcp")) ||
-                        content.contains(QStringLiteral("module-protocol-pulse"))) {
+                        content.contains(QStringLiteral("tcp:127.0.0.1:%1").arg(kTcpPort))) {
                         m_multiUserConfigured = true;
                         break;
                     }
@@ -55,14 +189,6 @@ void AudioManager::checkConfiguration()
             }
             if (m_multiUserConfigured) break;
         }
-    } else {
-        // PulseAudio - check for TCP module
-        QProcess pactl;
-        pactl.start(QStringLiteral("pactl"), {QStringLiteral("list"), QStringLiteral("modules")});
-        if (pactl.waitForFinished(3000)) {
-            QString output = QString::fromUtf8(pactl.readAllStandardOutput());
-            m_multiUserConfigured = output.contains(QStringLiteral("module-native-protocol-tcp"));
-        }
     }
 
     Q_EMIT configurationChanged();
@@ -101,48 +227,64 @@ context.modules = [
         file.write(configContent.toUtf8());
         file.close();
 
-        // Restart PipeWire to apply
-        QProcess::execute(QStringLiteral("systemctl"), 
-                          {QStringLiteral("--user"), QStringLiteral("restart"), QStringLiteral("pipewire-pulse")});
-
-        checkConfiguration();
+        // Restart PipeWire to apply, without waiting for systemd
+        auto *restart = new QProcess(this);
+        connect(restart, &QProcess::finished, this, [this, restart](int exitCode, QProcess::ExitStatus status) {
+            if (status != QProcess::NormalExit || exitCode != 0) {
+                Q_EMIT errorOccurred(QStringLiteral("Failed to restart pipewire-pulse"));
+            }
+            restart->deleteLater();
+            checkConfiguration();
+        });
+        connect(restart, &QProcess::errorOccurred, this, [this, restart](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                Q_EMIT errorOccurred(QStringLiteral("Failed to run systemctl"));
+                restart->deleteLater();
+            }
+        });
+        restart->start(QStringLiteral("systemctl"),
+                       {QStringLiteral("--user"), QStringLiteral("restart"), QStringLiteral("pipewire-pulse")});
         return true;
 
     } else {
         // PulseAudio - load TCP module
-        QProcess pactl;
-        pactl.start(QStringLiteral("pactl"), {
+        auto *pactl = new QProcess(this);
+        connect(pactl, &QProcess::finished, this, [this, pactl](int exitCode, QProcess::ExitStatus status) {
+            pactl->deleteLater();
+            if (status != QProcess::NormalExit || exitCode != 0) {
+                const QString message = QString::fromUtf8(pactl->readAllStandardError()).trimmed();
+                Q_EMIT errorOccurred(message.isEmpty() ? QStringLiteral("Failed to load PulseAudio TCP module") : message);
+                return;
+            }
+
+            // Make persistent by adding to default.pa
+            QString paConfigDir = QDir::homePath() + QStringLiteral("/.config/pulse/");
+            QDir().mkpath(paConfigDir);
+
+            QString defaultPa = paConfigDir + QStringLiteral("default.pa");
+            QFile file(defaultPa);
+
+            // Append to existing or create new
+            if (file.open(QIODevice::Append | QIODevice::Text)) {
+                file.write("\n# CouchPlay: Enable TCP for multi-user audio\n");
+                file.write("load-module module-native-protocol-tcp auth-ip-acl=127.0.0.1 port=4713\n");
+                file.close();
+            }
+
+            checkConfiguration();
+        });
+        connect(pactl, &QProcess::errorOccurred, this, [this, pactl](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                Q_EMIT errorOccurred(QStringLiteral("Failed to run pactl"));
+                pactl->deleteLater();
+            }
+        });
+        pactl->start(QStringLiteral("pactl"), {
             QStringLiteral("load-module"),
             QStringLiteral("module-native-protocol-tcp"),
             QStringLiteral("auth-ip-acl=127.0.0.1"),
             QStringLiteral("port=4713")
         });
-
-        if (!pactl.waitForFinished(5000)) {
-            Q_EMIT errorOccurred(QStringLiteral("Failed to load PulseAudio TCP module"));
-            return false;
-        }
-
-        if (pactl.exitCode() != 0) {
-            Q_EMIT errorOccurred(QString::fromUtf8(pactl.readAllStandardError()));
-            return false;
-        }
-
-        // Make persistent by adding to default.pa
-        QString paConfigDir = QDir::homePath() + QStringLiteral("/.config/pulse/");
-        QDir().mkpath(paConfigDir);
-
-        QString defaultPa = paConfigDir + QStringLiteral("default.pa");
-        QFile file(defaultPa);
-        
-        // Append to existing or create new
-        if (file.open(QIODevice::Append | QIODevice::Text)) {
-            file.write("\n# CouchPlay: Enable TCP for multi-user audio\n");
-            file.write("load-module module-native-protocol-tcp auth-ip-acl=127.0.0.1 port=4713\n");
-            file.close();
-        }
-
-        checkConfiguration();
         return true;
     }
 }
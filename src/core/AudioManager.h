@@ -4,12 +4,20 @@
 #pragma once
 
 #include <QObject>
+#include <QPointer>
 #include <QString>
 #include <QVariantMap>
 #include <qqmlintegration.h>
 
+class PipeWireGraph;
+
 /**
  * @brief Manages PipeWire/PulseAudio configuration for multi-user audio
+ *
+ * Probing connects to the sockets directly and never waits on a process.
+ * On PipeWire, the manager also keeps an in-process PipeWireGraph that
+ * hosts one sink per player (see createPlayerSinks()), so each instance's
+ * audio can be routed separately.
  */
 class AudioManager : public QObject
 {
@@ -17,6 +25,8 @@ class AudioManager : public QObject
     QML_ELEMENT
     Q_PROPERTY(bool multiUserConfigured READ isMultiUserConfigured NOTIFY configurationChanged)
     Q_PROPERTY(QString audioServer READ audioServer CONSTANT)
+    Q_PROPERTY(bool pulseServerRunning READ isPulseServerRunning NOTIFY configurationChanged)
+    Q_PROPERTY(bool perPlayerAudio READ hasPerPlayerAudio NOTIFY perPlayerAudioChanged)
 
 public:
     explicit AudioManager(QObject *parent = nullptr);
@@ -32,8 +42,20 @@ public:
      */
     QString audioServer() const { return m_audioServer; }
 
+    /**
+     * @brief Whether a PulseAudio server (or pipewire-pulse) accepts connections
+     */
+    bool isPulseServerRunning() const { return m_pulseServerRunning; }
+
+    /**
+     * @brief Whether per-player sinks can be created
+     */
+    bool hasPerPlayerAudio() const;
+
     /**
      * @brief Check current configuration status
+     *
+     * Only connects to the local sockets, so it is cheap enough for the GUI thread.
      */
     Q_INVOKABLE void checkConfiguration();
 
@@ -41,9 +63,29 @@ public:
      * @brief Configure PipeWire for multi-user audio sharing
      * This enables TCP module for audio sharing between users
      * Requires helper for system configuration
+     *
+     * The restart or module load runs in the background;
+     * configurationChanged() or errorOccurred() follows.
+     * @return false if it couldn't be started
      */
     Q_INVOKABLE bool configureMultiUser();
 
+    /**
+     * @brief Make sure players 0 to @p count - 1 each have their own sink
+     * @return false if per-player audio isn't available
+     */
+    Q_INVOKABLE bool createPlayerSinks(int count);
+
+    /**
+     * @brief Remove the sinks made by createPlayerSinks()
+     */
+    Q_INVOKABLE void removePlayerSinks();
+
+    /**
+     * @brief node.name of player @p index's sink, for PULSE_SINK and PIPEWIRE_NODE
+     */
+    static QString playerSinkName(int index);
+
     /**
      * @brief Get the audio server address for secondary instances
      */
@@ -51,9 +93,15 @@ public:
 
 Q_SIGNALS:
     void configurationChanged();
+    void perPlayerAudioChanged();
     void errorOccurred(const QString &message);
 
 private:
+    void connectGraph();
+
     bool m_multiUserConfigured = false;
+    bool m_pulseServerRunning = false;
     QString m_audioServer;
+    QString m_runtimeDir;
+    QPointer<PipeWireGraph> m_graph;
 };
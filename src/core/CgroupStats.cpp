@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "CgroupStats.h"
+
+#include <QFile>
+
+QString CgroupStats::cgroupOf(qint64 pid, const QString &procRoot)
+{
+    if (pid <= 0) {
+        return QString();
+    }
+
+    QFile file(QStringLiteral("%1/%2/cgroup").arg(procRoot).arg(pid));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    // The unified hierarchy is the "0::" entry
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith("0::")) {
+            return QString::fromUtf8(line.mid(3).trimmed());
+        }
+    }
+    return QString();
+}
+
+CgroupStats::Usage CgroupStats::readUsage(const QString &cgroupPath, const QString &cgroupRoot)
+{
+    Usage usage;
+    if (cgroupPath.isEmpty()) {
+        return usage;
+    }
+    const QString dir = cgroupRoot + cgroupPath;
+
+    QFile cpuStat(dir + QStringLiteral("/cpu.stat"));
+    if (cpuStat.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> lines = cpuStat.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            if (line.startsWith("usage_usec ")) {
+                bool ok = false;
+                const qint64 value = line.mid(11).trimmed().toLongLong(&ok);
+                if (ok) {
+                    usage.cpuUsageUs = value;
+                }
+                break;
+            }
+        }
+    }
+
+    QFile memory(dir + QStringLiteral("/memory.current"));
+    if (memory.open(QIODevice::ReadOnly)) {
+        bool ok = false;
+        const qint64 value = memory.readAll().trimmed().toLongLong(&ok);
+        if (ok) {
+            usage.memoryBytes = value;
+        }
+    }
+
+    return usage;
+}
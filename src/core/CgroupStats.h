@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QString>
+
+/**
+ * @brief CPU and memory counters of instances, read from their cgroups
+ *
+ * Helper-launched instances run in their own transient service, so the
+ * cgroup of the gamescope PID covers the instance and everything it
+ * started. Reads cgroup v2 cpu.stat (usage_usec) and memory.current; see
+ * InstanceTelemetry for the rates.
+ */
+class CgroupStats
+{
+public:
+    struct Usage {
+        qint64 cpuUsageUs = -1;  // -1 if unknown
+        qint64 memoryBytes = -1;
+    };
+
+    /**
+     * @brief cgroup v2 path of @p pid relative to the cgroup root, empty if unknown
+     */
+    static QString cgroupOf(qint64 pid, const QString &procRoot = QStringLiteral("/proc"));
+
+    /**
+     * @brief Current counters of @p cgroupPath
+     */
+    static Usage readUsage(const QString &cgroupPath, const QString &cgroupRoot = QStringLiteral("/sys/fs/cgroup"));
+};
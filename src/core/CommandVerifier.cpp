@@ -6,13 +6,52 @@
 
 #include <QDir>
 #include <QFileInfo>
+#include <QHash>
+#include <QMutex>
 #include <QProcess>
+#include <QSet>
 #include <QString>
 #include <QStringList>
 
 #include <pwd.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+namespace {
+
+// Names in one PATH directory, valid while the directory's mtime holds
+struct DirectoryListing {
+    qint64 mtimeSec = -1;
+    qint64 mtimeNsec = -1;
+    QSet<QString> names;
+};
+
+QMutex s_cacheMutex;
+QHash<QString, DirectoryListing> s_pathListings;
+QHash<QString, bool> s_flatpakApps;
+
+// Callers hold s_cacheMutex
+const QSet<QString> &directoryNames(const QString &directory)
+{
+    static const QSet<QString> empty;
+    struct stat st;
+    if (stat(QFile::encodeName(directory).constData(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        s_pathListings.remove(directory);
+        return empty;
+    }
+
+    DirectoryListing &listing = s_pathListings[directory];
+    if (listing.mtimeSec != st.st_mtim.tv_sec || listing.mtimeNsec != st.st_mtim.tv_nsec) {
+        listing.mtimeSec = st.st_mtim.tv_sec;
+        listing.mtimeNsec = st.st_mtim.tv_nsec;
+        const QStringList entries = QDir(directory).entryList(QDir::Files | QDir::System | QDir::NoDotAndDotDot);
+        listing.names = QSet<QString>(entries.cbegin(), entries.cend());
+    }
+    return listing.names;
+}
+
+} // namespace
+
 CommandVerificationResult CommandVerifier::verifyCommand(const QString &command)
 {
     CommandVerificationResult result;
@@ -83,7 +122,7 @@ CommandVerificationResult CommandVerifier::verifyCommand(const QString &command)
         result.isFlatpak = false;
         result.isAbsolutePath = false;
         
-        QString resolvedPath = resolveCommandPath(command);
+        QString resolvedPath = resolveCommandPath(command.split(QStringLiteral(" ")).first());
         if (resolvedPath.isEmpty()) {
             result.isValid = false;
             result.errorMessage = QString(QStringLiteral("Command not found in PATH: %1")).arg(command);
@@ -146,16 +185,7 @@ bool CommandVerifier::isAbsolutePath(const QString &command)
 
 bool CommandVerifier::commandExistsInPath(const QString &commandName)
 {
-    QProcess process;
-    process.setProgram(QStringLiteral("which"));
-    process.setArguments({commandName});
-    process.start();
-    
-    if (process.waitForFinished(2000)) {
-        return process.exitCode() == 0;
-    }
-    
-    return false;
+    return !resolveCommandPath(commandName).isEmpty();
 }
 
 bool CommandVerifier::isCommandExecutable(const QString &path)
@@ -191,16 +221,7 @@ bool CommandVerifier::isUserLocalCommand(const QString &command)
 
 bool CommandVerifier::isFlatpakAvailable()
 {
-    QProcess process;
-    process.setProgram(QStringLiteral("flatpak"));
-    process.setArguments({QStringLiteral("--version")});
-    process.start();
-    
-    if (process.waitForFinished(2000)) {
-        return process.exitCode() == 0;
-    }
-    
-    return false;
+    return commandExistsInPath(QStringLiteral("flatpak"));
 }
 
 bool CommandVerifier::isFlatpakAppInstalled(const QString &appID)
@@ -208,43 +229,57 @@ bool CommandVerifier::isFlatpakAppInstalled(const QString &appID)
     if (!isValidFlatpakAppId(appID)) {
         return false;
     }
-    
-    QProcess process;
-    process.setProgram(QStringLiteral("flatpak"));
-    process.setArguments({QStringLiteral("list"), QStringLiteral("--app"), QStringLiteral("--columns=application")});
-    process.start();
-    
-    if (process.waitForFinished(2000)) {
-        if (process.exitCode() == 0) {
-            QByteArray output = process.readAllStandardOutput();
-            QStringList installedApps = QString::fromUtf8(output).split(QStringLiteral("\n"));
-            return installedApps.contains(appID);
+
+    {
+        QMutexLocker locker(&s_cacheMutex);
+        const auto cached = s_flatpakApps.constFind(appID);
+        if (cached != s_flatpakApps.constEnd()) {
+            return *cached;
         }
     }
-    
-    return false;
+
+    bool installed = false;
+    if (isFlatpakAvailable()) {
+        QProcess process;
+        process.setProgram(QStringLiteral("flatpak"));
+        process.setArguments({QStringLiteral("info"), QStringLiteral("--show-ref"), appID});
+        process.start();
+        installed = process.waitForFinished(2000) && process.exitStatus() == QProcess::NormalExit
+            && process.exitCode() == 0;
+    }
+
+    // Apps are rarely installed while CouchPlay runs; remember the answer for the session
+    QMutexLocker locker(&s_cacheMutex);
+    s_flatpakApps.insert(appID, installed);
+    return installed;
 }
 
 QString CommandVerifier::resolveCommandPath(const QString &commandName)
 {
-    QProcess process;
-    process.setProgram(QStringLiteral("which"));
-    process.setArguments({commandName});
-    process.start();
-    
-    if (process.waitForFinished(2000)) {
-        if (process.exitCode() == 0) {
-            QByteArray output = process.readAllStandardOutput();
-            QString path = QString::fromUtf8(output).trimmed();
-            if (!path.isEmpty()) {
-                QFileInfo fileInfo(path);
-                if (fileInfo.exists() && fileInfo.isExecutable()) {
-                    return path;
-                }
+    if (commandName.isEmpty()) {
+        return QString();
+    }
+
+    // Like which: names with a slash are not looked up
+    if (commandName.contains(QLatin1Char('/'))) {
+        return isCommandExecutable(commandName) ? commandName : QString();
+    }
+
+    const QStringList directories = QString::fromLocal8Bit(qgetenv("PATH")).split(QLatin1Char(':'), Qt::SkipEmptyParts);
+    for (const QString &directory : directories) {
+        bool listed;
+        {
+            QMutexLocker locker(&s_cacheMutex);
+            listed = directoryNames(directory).contains(commandName);
+        }
+        if (listed) {
+            const QString path = directory + QLatin1Char('/') + commandName;
+            if (isCommandExecutable(path)) {
+                return path;
             }
         }
     }
-    
+
     return QString();
 }
 
@@ -25,6 +25,10 @@ struct CommandVerificationResult {
  * 
  * Provides methods to verify commands work properly for different users,
  * detecting Flatpak vs native commands, PATH resolution, and user-local commands.
+ *
+ * The checks are thread-safe and spawn nothing for PATH lookups: each PATH
+ * directory's listing is cached until its mtime changes, and
+ * `flatpak info` runs once per app ID per session.
  */
 class CommandVerifier
 {
@@ -0,0 +1,91 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "DeviceFilterModel.h"
+#include "DeviceListModel.h"
+
+DeviceFilterModel::DeviceFilterModel(QObject *parent)
+    : QSortFilterProxyModel(parent)
+{
+    // Assignments and hotplug only touch single rows; re-filter just those
+    setDynamicSortFilter(true);
+
+    connect(this, &QAbstractItemModel::rowsInserted, this, &DeviceFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::rowsRemoved, this, &DeviceFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::modelReset, this, &DeviceFilterModel::countChanged);
+    connect(this, &QAbstractItemModel::layoutChanged, this, &DeviceFilterModel::countChanged);
+}
+
+void DeviceFilterModel::setFilter(Filter filter)
+{
+    if (m_filter != filter) {
+        m_filter = filter;
+        invalidateRowsFilter();
+        Q_EMIT filterChanged();
+    }
+}
+
+void DeviceFilterModel::setShowVirtual(bool show)
+{
+    if (m_showVirtual != show) {
+        m_showVirtual = show;
+        invalidateRowsFilter();
+        Q_EMIT showVirtualChanged();
+    }
+}
+
+void DeviceFilterModel::setShowInternal(bool show)
+{
+    if (m_showInternal != show) {
+        m_showInternal = show;
+        invalidateRowsFilter();
+        Q_EMIT showInternalChanged();
+    }
+}
+
+void DeviceFilterModel::setAssignedInstance(int instanceIndex)
+{
+    if (m_assignedInstance != instanceIndex) {
+        m_assignedInstance = instanceIndex;
+        invalidateRowsFilter();
+        Q_EMIT assignedInstanceChanged();
+    }
+}
+
+bool DeviceFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    const QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+
+    if (m_assignedInstance != AnyInstance
+        && index.data(DeviceListModel::AssignedInstanceRole).toInt() != m_assignedInstance) {
+        return false;
+    }
+
+    if (m_filter == All) {
+        return true;
+    }
+
+    const QString type = index.data(DeviceListModel::TypeRole).toString();
+    const bool isVirtual = index.data(DeviceListModel::IsVirtualRole).toBool();
+    const bool isInternal = index.data(DeviceListModel::IsInternalRole).toBool();
+
+    if (!m_showVirtual && isVirtual) {
+        return false;
+    }
+
+    // Same rules as DeviceManager's list properties: controllers and mice
+    // ignore the internal-device setting
+    switch (m_filter) {
+    case Visible:
+        return (m_showInternal || !isInternal) && type != QStringLiteral("other");
+    case Controllers:
+        return type == QStringLiteral("controller");
+    case Keyboards:
+        return (m_showInternal || !isInternal) && type == QStringLiteral("keyboard");
+    case Mice:
+        return type == QStringLiteral("mouse");
+    case All:
+        break;
+    }
+    return true;
+}
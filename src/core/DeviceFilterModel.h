@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QSortFilterProxyModel>
+#include <qqmlintegration.h>
+
+/**
+ * @brief Filtered view over a DeviceListModel
+ *
+ * Applies the same rules as the DeviceManager list properties (device type,
+ * virtual/internal visibility) and can additionally restrict to devices
+ * assigned to one instance, so player drop zones don't need to filter in
+ * JavaScript.
+ */
+class DeviceFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(Filter filter READ filter WRITE setFilter NOTIFY filterChanged)
+    Q_PROPERTY(bool showVirtual READ showVirtual WRITE setShowVirtual NOTIFY showVirtualChanged)
+    Q_PROPERTY(bool showInternal READ showInternal WRITE setShowInternal NOTIFY showInternalChanged)
+    Q_PROPERTY(int assignedInstance READ assignedInstance WRITE setAssignedInstance NOTIFY assignedInstanceChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum Filter {
+        All,
+        Visible,      // Everything but "other" devices
+        Controllers,
+        Keyboards,
+        Mice,
+    };
+    Q_ENUM(Filter)
+
+    // assignedInstance value that disables the assignment filter
+    static constexpr int AnyInstance = -2;
+
+    explicit DeviceFilterModel(QObject *parent = nullptr);
+
+    Filter filter() const { return m_filter; }
+    void setFilter(Filter filter);
+
+    bool showVirtual() const { return m_showVirtual; }
+    void setShowVirtual(bool show);
+
+    bool showInternal() const { return m_showInternal; }
+    void setShowInternal(bool show);
+
+    int assignedInstance() const { return m_assignedInstance; }
+    void setAssignedInstance(int instanceIndex);
+
+    int count() const { return rowCount(); }
+
+Q_SIGNALS:
+    void filterChanged();
+    void showVirtualChanged();
+    void showInternalChanged();
+    void assignedInstanceChanged();
+    void countChanged();
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    Filter m_filter = All;
+    bool m_showVirtual = false;
+    bool m_showInternal = false;
+    int m_assignedInstance = AnyInstance;
+};
@@ -0,0 +1,178 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "DeviceListModel.h"
+
+#include <QSet>
+
+DeviceListModel::DeviceListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int DeviceListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_devices.size();
+}
+
+QVariant DeviceListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_devices.size()) {
+        return QVariant();
+    }
+
+    const InputDevice &device = m_devices.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return device.name;
+    case EventNumberRole:
+        return device.eventNumber;
+    case TypeRole:
+        return device.type;
+    case PathRole:
+        return device.path;
+    case JoyPathRole:
+        return device.joyPath;
+    case VendorIdRole:
+        return device.vendorId;
+    case ProductIdRole:
+        return device.productId;
+    case PhysPathRole:
+        return device.physPath;
+    case StableIdRole:
+        return device.stableId;
+    case AssignedRole:
+        return device.assigned;
+    case AssignedInstanceRole:
+        return device.assignedInstance;
+    case IsVirtualRole:
+        return device.isVirtual;
+    case IsInternalRole:
+        return device.isInternal;
+    case BatteryLevelRole:
+        return device.batteryLevel;
+    case BatteryChargingRole:
+        return device.batteryCharging;
+    case DeviceRole:
+        return toVariantMap(device);
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> DeviceListModel::roleNames() const
+{
+    return {
+        {EventNumberRole, "eventNumber"},
+        {NameRole, "name"},
+        {TypeRole, "type"},
+        {PathRole, "path"},
+        {JoyPathRole, "joyPath"},
+        {VendorIdRole, "vendorId"},
+        {ProductIdRole, "productId"},
+        {PhysPathRole, "physPath"},
+        {StableIdRole, "stableId"},
+        {AssignedRole, "assigned"},
+        {AssignedInstanceRole, "assignedInstance"},
+        {IsVirtualRole, "isVirtual"},
+        {IsInternalRole, "isInternal"},
+        {BatteryLevelRole, "batteryLevel"},
+        {BatteryChargingRole, "batteryCharging"},
+        {DeviceRole, "device"},
+    };
+}
+
+void DeviceListModel::sync(const QList<InputDevice> &devices)
+{
+    const int oldCount = m_devices.size();
+
+    QSet<int> incoming;
+    incoming.reserve(devices.size());
+    for (const InputDevice &device : devices) {
+        incoming.insert(device.eventNumber);
+    }
+
+    // Rows whose device went away
+    for (int row = m_devices.size() - 1; row >= 0; --row) {
+        if (!incoming.contains(m_devices.at(row).eventNumber)) {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_devices.removeAt(row);
+            endRemoveRows();
+        }
+    }
+
+    QSet<int> remaining;
+    remaining.reserve(m_devices.size());
+    for (const InputDevice &device : std::as_const(m_devices)) {
+        remaining.insert(device.eventNumber);
+    }
+
+    // Walk the new list: update rows in place, insert new devices where they appear
+    int row = 0;
+    for (const InputDevice &device : devices) {
+        if (row < m_devices.size() && m_devices.at(row).eventNumber == device.eventNumber) {
+            if (!sameDevice(m_devices.at(row), device)) {
+                m_devices[row] = device;
+                const QModelIndex changed = index(row);
+                Q_EMIT dataChanged(changed, changed);
+            }
+            ++row;
+        } else if (!remaining.contains(device.eventNumber)) {
+            beginInsertRows(QModelIndex(), row, row);
+            m_devices.insert(row, device);
+            endInsertRows();
+            ++row;
+        } else {
+            // Surviving devices changed order (full rescan after hotplug appends)
+            beginResetModel();
+            m_devices = devices;
+            endResetModel();
+            break;
+        }
+    }
+
+    if (m_devices.size() != oldCount) {
+        Q_EMIT countChanged();
+    }
+}
+
+QVariantMap DeviceListModel::toVariantMap(const InputDevice &device)
+{
+    QVariantMap map;
+    map[QStringLiteral("eventNumber")] = device.eventNumber;
+    map[QStringLiteral("name")] = device.name;
+    map[QStringLiteral("type")] = device.type;
+    map[QStringLiteral("path")] = device.path;
+    map[QStringLiteral("joyPath")] = device.joyPath;
+    map[QStringLiteral("vendorId")] = device.vendorId;
+    map[QStringLiteral("productId")] = device.productId;
+    map[QStringLiteral("physPath")] = device.physPath;
+    map[QStringLiteral("stableId")] = device.stableId;
+    map[QStringLiteral("assigned")] = device.assigned;
+    map[QStringLiteral("assignedInstance")] = device.assignedInstance;
+    map[QStringLiteral("isVirtual")] = device.isVirtual;
+    map[QStringLiteral("isInternal")] = device.isInternal;
+    map[QStringLiteral("batteryLevel")] = device.batteryLevel;
+    map[QStringLiteral("batteryCharging")] = device.batteryCharging;
+    return map;
+}
+
+bool DeviceListModel::sameDevice(const InputDevice &a, const InputDevice &b)
+{
+    return a.eventNumber == b.eventNumber
+        && a.assigned == b.assigned
+        && a.assignedInstance == b.assignedInstance
+        && a.isVirtual == b.isVirtual
+        && a.isInternal == b.isInternal
+        && a.batteryLevel == b.batteryLevel
+        && a.batteryCharging == b.batteryCharging
+        && a.name == b.name
+        && a.type == b.type
+        && a.path == b.path
+        && a.joyPath == b.joyPath
+        && a.vendorId == b.vendorId
+        && a.productId == b.productId
+        && a.physPath == b.physPath
+        && a.stableId == b.stableId;
+}
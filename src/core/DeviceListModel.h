@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QVariantMap>
+#include <qqmlintegration.h>
+
+#include "InputDevice.h"
+
+/**
+ * @brief List model of the input devices known to DeviceManager
+ *
+ * DeviceManager pushes its device list with sync(), which diffs it against
+ * the current rows and emits rowsInserted/rowsRemoved/dataChanged for just
+ * the rows that changed, so an assignment re-renders one delegate instead
+ * of every list. Filtered views are provided by DeviceFilterModel.
+ */
+class DeviceListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Provided by DeviceManager")
+
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum Roles {
+        EventNumberRole = Qt::UserRole + 1,
+        NameRole,
+        TypeRole,
+        PathRole,
+        JoyPathRole,
+        VendorIdRole,
+        ProductIdRole,
+        PhysPathRole,
+        StableIdRole,
+        AssignedRole,
+        AssignedInstanceRole,
+        IsVirtualRole,
+        IsInternalRole,
+        BatteryLevelRole,
+        BatteryChargingRole,
+        DeviceRole,  // All of the above as a map, for delegates taking a whole device
+    };
+    Q_ENUM(Roles)
+
+    explicit DeviceListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int count() const { return m_devices.size(); }
+
+    /**
+     * @brief Update the rows to match @p devices
+     *
+     * Removed and added devices become row removals/insertions, changed
+     * rows get dataChanged. Falls back to a model reset only if the
+     * surviving devices were reordered.
+     */
+    void sync(const QList<InputDevice> &devices);
+
+    /**
+     * @brief Convert a device to the QVariantMap shape used by QML
+     */
+    static QVariantMap toVariantMap(const InputDevice &device);
+
+Q_SIGNALS:
+    void countChanged();
+
+private:
+    static bool sameDevice(const InputDevice &a, const InputDevice &b);
+
+    QList<InputDevice> m_devices;
+};
@@ -2,25 +2,45 @@
 // SPDX-FileCopyrightText: 2025 CouchPlay Contributors
 
 #include "DeviceManager.h"
+#include "EvdevWorker.h"
+#include "InputDeviceScanner.h"
+#include "InputHotplugMonitor.h"
 #include "SettingsManager.h"
+#include "StartupTrace.h"
 
 #include <QFile>
 #include <QDir>
-#include <QTextStream>
-#include <QRegularExpression>
 #include <QDebug>
 
-// For device identification (rumble)
+// For probing device capabilities
 #include <fcntl.h>
 #include <unistd.h>
 #include <linux/input.h>
 #include <sys/ioctl.h>
+#include <algorithm>
 #include <cerrno>
 
+// Phys prefix of helper/InputRouter's virtual devices
+static constexpr char INPUT_ROUTER_PHYS_PREFIX[] = "couchplay-router/";
+
 DeviceManager::DeviceManager(QObject *parent)
     : QObject(parent)
     , m_debounceTimer(new QTimer(this))
+    , m_deviceModel(new DeviceListModel(this))
+    , m_evdev(new EvdevWorker(this))
 {
+    StartupTrace::Scope trace("DeviceManager");
+    m_visibleModel = createFilterModel(DeviceFilterModel::Visible);
+    m_controllerModel = createFilterModel(DeviceFilterModel::Controllers);
+    m_keyboardModel = createFilterModel(DeviceFilterModel::Keyboards);
+    m_mouseModel = createFilterModel(DeviceFilterModel::Mice);
+    
+    // Every change to m_devices is announced through devicesChanged
+    connect(this, &DeviceManager::devicesChanged, this, [this]() {
+        m_deviceModel->sync(m_devices);
+        updateRetainedDevices();
+    });
+    
     // Debounce timer to avoid refreshing too frequently during hotplug
     m_debounceTimer->setSingleShot(true);
     m_debounceTimer->setInterval(500); // 500ms debounce
@@ -32,17 +52,48 @@ DeviceManager::DeviceManager(QObject *parent)
 
 DeviceManager::~DeviceManager() = default;
 
+DeviceFilterModel *DeviceManager::createFilterModel(DeviceFilterModel::Filter filter)
+{
+    auto *model = new DeviceFilterModel(this);
+    model->setFilter(filter);
+    model->setShowVirtual(m_showVirtualDevices);
+    model->setShowInternal(m_showInternalDevices);
+    model->setSourceModel(m_deviceModel);
+    return model;
+}
+
 void DeviceManager::setupHotplugWatcher()
 {
     if (m_watcher) {
         delete m_watcher;
         m_watcher = nullptr;
     }
+    if (m_hotplugMonitor) {
+        delete m_hotplugMonitor;
+        m_hotplugMonitor = nullptr;
+    }
     
     if (!m_hotplugEnabled) {
         return;
     }
     
+    // Prefer per-device udev events; they arrive once the node is ready
+    m_hotplugMonitor = new InputHotplugMonitor(this);
+    if (m_hotplugMonitor->start()) {
+        connect(m_hotplugMonitor, &InputHotplugMonitor::eventDeviceAdded,
+                this, &DeviceManager::onEventDeviceAdded);
+        connect(m_hotplugMonitor, &InputHotplugMonitor::eventDeviceRemoved,
+                this, &DeviceManager::onEventDeviceRemoved);
+        connect(m_hotplugMonitor, &InputHotplugMonitor::powerSupplyChanged,
+                this, &DeviceManager::onPowerSupplyChanged);
+        connect(m_hotplugMonitor, &InputHotplugMonitor::overflowed,
+                this, &DeviceManager::onInputDirectoryChanged);
+        qDebug() << "DeviceManager: Hotplug monitor enabled (udev netlink)";
+        return;
+    }
+    delete m_hotplugMonitor;
+    m_hotplugMonitor = nullptr;
+    
     m_watcher = new QFileSystemWatcher(this);
     
     // Watch /dev/input for device changes
@@ -75,7 +126,7 @@ void DeviceManager::onDebounceTimeout()
     
     // Store old device list to detect changes
     QList<int> oldEventNumbers;
-    QMap<int, QString> oldDeviceNames;
+    QHash<int, QString> oldDeviceNames;
     QSet<QString> oldStableIds;
     for (const auto &device : m_devices) {
         oldEventNumbers.append(device.eventNumber);
@@ -103,19 +154,7 @@ void DeviceManager::onDebounceTimeout()
         const QString &stableId = it.key();
         if (!newStableIds.contains(stableId)) {
             // Device was assigned but is now disconnected - add to pending if not already there
-            bool alreadyPending = false;
-            for (const auto &pending : m_pendingDevices) {
-                if (pending[QStringLiteral("stableId")].toString() == stableId) {
-                    alreadyPending = true;
-                    break;
-                }
-            }
-            if (!alreadyPending) {
-                QVariantMap pending;
-                pending[QStringLiteral("stableId")] = stableId;
-                pending[QStringLiteral("name")] = it.value().second;
-                pending[QStringLiteral("instanceIndex")] = it.value().first;
-                m_pendingDevices.append(pending);
+            if (addPendingDevice({stableId, it.value().second, it.value().first})) {
                 pendingChanged = true;
                 qDebug() << "DeviceManager: Device disconnected, added to pending:" 
                          << it.value().second << "for instance" << it.value().first;
@@ -124,11 +163,12 @@ void DeviceManager::onDebounceTimeout()
     }
     
     // Restore assignments from persistent cache (survives across hotplug cycles)
-    for (auto &device : m_devices) {
-        if (m_assignmentCache.contains(device.stableId)) {
-            int instanceIndex = m_assignmentCache[device.stableId].first;
-            device.assigned = true;
-            device.assignedInstance = instanceIndex;
+    for (int slot = 0; slot < m_devices.size(); ++slot) {
+        const InputDevice device = m_devices.at(slot);
+        auto cached = m_assignmentCache.constFind(device.stableId);
+        if (cached != m_assignmentCache.constEnd()) {
+            int instanceIndex = cached->first;
+            setDeviceInstance(slot, instanceIndex);
             
             // Check if this is a reconnected device (wasn't present before)
             bool wasPresent = oldStableIds.contains(device.stableId);
@@ -140,31 +180,24 @@ void DeviceManager::onDebounceTimeout()
                 Q_EMIT deviceReconnected(device.stableId, device.eventNumber, instanceIndex);
                 
                 // Remove from pending list
-                for (int i = m_pendingDevices.size() - 1; i >= 0; --i) {
-                    if (m_pendingDevices[i][QStringLiteral("stableId")].toString() == device.stableId) {
-                        m_pendingDevices.removeAt(i);
-                        pendingChanged = true;
-                        Q_EMIT deviceAutoRestored(device.name, instanceIndex);
-                        break;
-                    }
+                if (takePendingDevice(device.stableId)) {
+                    pendingChanged = true;
+                    Q_EMIT deviceAutoRestored(device.name, instanceIndex);
                 }
             }
         }
     }
     
     // Detect added/removed devices for signals
-    QList<int> newEventNumbers;
     for (const auto &device : m_devices) {
-        newEventNumbers.append(device.eventNumber);
-        
-        if (!oldEventNumbers.contains(device.eventNumber)) {
+        if (!oldDeviceNames.contains(device.eventNumber)) {
             qDebug() << "DeviceManager: Device added:" << device.name;
             Q_EMIT deviceAdded(device.eventNumber, device.name);
         }
     }
     
     for (int oldEvent : oldEventNumbers) {
-        if (!newEventNumbers.contains(oldEvent)) {
+        if (!m_eventIndex.contains(oldEvent)) {
             qDebug() << "DeviceManager: Device removed:" << oldDeviceNames[oldEvent];
             Q_EMIT deviceRemoved(oldEvent, oldDeviceNames[oldEvent]);
         }
@@ -180,6 +213,259 @@ void DeviceManager::onDebounceTimeout()
     checkPendingDevices();
 }
 
+void DeviceManager::onEventDeviceAdded(int eventNumber)
+{
+    // Reading the procfs file is cheap, the costly part of a full rescan is
+    // re-probing and re-diffing every device; only this one is touched here
+    QList<InputDevice> scanned;
+    if (!readProcDevices(scanned)) {
+        return;
+    }
+    
+    auto it = std::find_if(scanned.begin(), scanned.end(), [eventNumber](const InputDevice &d) {
+        return d.eventNumber == eventNumber;
+    });
+    if (it == scanned.end()) {
+        // Ignored device, or not in procfs yet - let a full rescan reconcile
+        m_debounceTimer->start();
+        return;
+    }
+    
+    InputDevice device = *it;
+    const int existing = indexOfEventNumber(eventNumber);
+    if (existing >= 0) {
+        if (m_devices[existing].stableId == device.stableId) {
+            return;  // Already known (e.g. rescan raced the event)
+        }
+        // Event number reused by a different device; treat as remove + add
+        onEventDeviceRemoved(eventNumber);
+    }
+    
+    m_devices.append(device);
+    const int slot = m_devices.size() - 1;
+    indexDevice(slot);
+    
+    bool pendingChanged = false;
+    auto cached = m_assignmentCache.constFind(device.stableId);
+    if (!device.stableId.isEmpty() && cached != m_assignmentCache.constEnd()) {
+        const int instanceIndex = cached->first;
+        setDeviceInstance(slot, instanceIndex);
+        
+        qDebug() << "DeviceManager: Device reconnected:" << device.name
+                 << "stableId:" << device.stableId
+                 << "eventNumber:" << device.eventNumber;
+        Q_EMIT deviceReconnected(device.stableId, device.eventNumber, instanceIndex);
+        
+        if (takePendingDevice(device.stableId)) {
+            pendingChanged = true;
+            Q_EMIT deviceAutoRestored(device.name, instanceIndex);
+        }
+    }
+    
+    // The event number may have belonged to another device before
+    m_powerSupplies.rescan();
+    updateBatteries();
+    
+    qDebug() << "DeviceManager: Device added:" << device.name;
+    Q_EMIT deviceAdded(device.eventNumber, device.name);
+    Q_EMIT devicesChanged();
+    
+    if (pendingChanged) {
+        Q_EMIT pendingDevicesChanged();
+    }
+    
+    // Devices expected by a loaded profile but never assigned in this run
+    checkPendingDevices();
+}
+
+void DeviceManager::onEventDeviceRemoved(int eventNumber)
+{
+    const int index = indexOfEventNumber(eventNumber);
+    if (index < 0) {
+        return;
+    }
+    
+    const InputDevice device = m_devices.takeAt(index);
+    // Removal shifts later slots; hotplug removals are rare enough to reindex
+    rebuildIndices();
+    
+    // Controllers expose several nodes with the same stableId; it is only
+    // disconnected once the last one went away
+    bool pendingChanged = false;
+    auto cached = m_assignmentCache.constFind(device.stableId);
+    if (!device.stableId.isEmpty() && cached != m_assignmentCache.constEnd()
+        && !hasDeviceWithStableId(device.stableId)) {
+        if (addPendingDevice({device.stableId, cached->second, cached->first})) {
+            pendingChanged = true;
+            qDebug() << "DeviceManager: Device disconnected, added to pending:"
+                     << cached->second << "for instance" << cached->first;
+        }
+    }
+    
+    qDebug() << "DeviceManager: Device removed:" << device.name;
+    Q_EMIT deviceRemoved(device.eventNumber, device.name);
+    Q_EMIT devicesChanged();
+    
+    if (pendingChanged) {
+        Q_EMIT pendingDevicesChanged();
+    }
+}
+
+void DeviceManager::onPowerSupplyChanged(const QString &name)
+{
+    // Controllers report level and charger changes themselves, so nothing
+    // polls the batteries while games are running
+    if (m_powerSupplies.update(name) && updateBatteries()) {
+        Q_EMIT devicesChanged();
+    }
+}
+
+bool DeviceManager::updateBatteries()
+{
+    bool changed = false;
+    QSet<QString> low;
+    QList<int> lowSlots;
+    for (int slot = 0; slot < m_devices.size(); ++slot) {
+        InputDevice &device = m_devices[slot];
+        const PowerSupplyMonitor::Battery battery = m_powerSupplies.batteryFor(device.eventNumber);
+        if (device.batteryLevel != battery.level || device.batteryCharging != battery.charging) {
+            device.batteryLevel = battery.level;
+            device.batteryCharging = battery.charging;
+            changed = true;
+        }
+        // Controllers have several nodes on one battery; report it once
+        if (battery.level >= 0 && battery.level < LOW_BATTERY_PERCENT && !battery.charging
+            && !low.contains(battery.name)) {
+            low.insert(battery.name);
+            if (!m_lowBatteries.contains(battery.name)) {
+                lowSlots.append(slot);
+            }
+        }
+    }
+    m_lowBatteries = low;
+
+    for (int slot : lowSlots) {
+        const InputDevice &device = m_devices.at(slot);
+        qDebug() << "DeviceManager: Battery low:" << device.name << device.batteryLevel << "%";
+        Q_EMIT batteryLow(device.name, device.batteryLevel, device.assignedInstance);
+    }
+    return changed;
+}
+
+int DeviceManager::indexOfEventNumber(int eventNumber) const
+{
+    return m_eventIndex.value(eventNumber, -1);
+}
+
+bool DeviceManager::hasDeviceWithStableId(const QString &stableId) const
+{
+    return m_stableIdIndex.contains(stableId);
+}
+
+void DeviceManager::indexDevice(int slot)
+{
+    const InputDevice &device = m_devices[slot];
+    m_eventIndex.insert(device.eventNumber, slot);
+    // Multi-node devices share a stableId; lookups resolve to the first node
+    if (!device.stableId.isEmpty() && !m_stableIdIndex.contains(device.stableId)) {
+        m_stableIdIndex.insert(device.stableId, slot);
+    }
+    if (device.assignedInstance >= 0) {
+        instanceBits(device.assignedInstance).setBit(slot);
+    }
+}
+
+void DeviceManager::rebuildIndices()
+{
+    m_eventIndex.clear();
+    m_stableIdIndex.clear();
+    m_eventIndex.reserve(m_devices.size());
+    m_stableIdIndex.reserve(m_devices.size());
+    for (QBitArray &bits : m_instanceBits) {
+        bits.fill(false, m_devices.size());
+    }
+    for (int slot = 0; slot < m_devices.size(); ++slot) {
+        indexDevice(slot);
+    }
+}
+
+QBitArray &DeviceManager::instanceBits(int instanceIndex)
+{
+    if (m_instanceBits.size() <= instanceIndex) {
+        m_instanceBits.resize(instanceIndex + 1);
+    }
+    QBitArray &bits = m_instanceBits[instanceIndex];
+    if (bits.size() < m_devices.size()) {
+        bits.resize(m_devices.size());
+    }
+    return bits;
+}
+
+void DeviceManager::setDeviceInstance(int slot, int instanceIndex)
+{
+    InputDevice &device = m_devices[slot];
+    const int previous = device.assignedInstance;
+    if (previous >= 0 && previous < m_instanceBits.size() && slot < m_instanceBits[previous].size()) {
+        m_instanceBits[previous].clearBit(slot);
+    }
+    
+    device.assigned = (instanceIndex >= 0);
+    device.assignedInstance = instanceIndex;
+    if (instanceIndex >= 0) {
+        instanceBits(instanceIndex).setBit(slot);
+    }
+}
+
+QList<int> DeviceManager::slotsForInstance(int instanceIndex) const
+{
+    QList<int> result;
+    if (instanceIndex < 0) {
+        // Unassigned devices aren't indexed
+        for (int slot = 0; slot < m_devices.size(); ++slot) {
+            if (m_devices[slot].assignedInstance == instanceIndex) {
+                result.append(slot);
+            }
+        }
+        return result;
+    }
+    if (instanceIndex >= m_instanceBits.size()) {
+        return result;
+    }
+    
+    const QBitArray &bits = m_instanceBits[instanceIndex];
+    const int count = qMin(qsizetype(bits.size()), m_devices.size());
+    for (int slot = 0; slot < count; ++slot) {
+        if (bits.testBit(slot)) {
+            result.append(slot);
+        }
+    }
+    return result;
+}
+
+bool DeviceManager::addPendingDevice(const PendingDevice &pending)
+{
+    if (m_pendingStableIds.contains(pending.stableId)) {
+        return false;
+    }
+    m_pendingStableIds.insert(pending.stableId);
+    m_pendingDevices.append(pending);
+    return true;
+}
+
+bool DeviceManager::takePendingDevice(const QString &stableId)
+{
+    if (!m_pendingStableIds.remove(stableId)) {
+        return false;
+    }
+    for (int i = 0; i < m_pendingDevices.size(); ++i) {
+        if (m_pendingDevices[i].stableId == stableId) {
+            m_pendingDevices.removeAt(i);
+            break;
+        }
+    }
+    return true;
+}
+
 void DeviceManager::refresh()
 {
     m_devices.clear();
@@ -188,12 +474,21 @@ void DeviceManager::refresh()
 }
 
 void DeviceManager::parseDevices()
+{
+    readProcDevices(m_devices);
+    rebuildIndices();
+    m_powerSupplies.rescan();
+    updateBatteries();
+    qDebug() << "DeviceManager: Found" << m_devices.size() << "input devices";
+}
+
+bool DeviceManager::readProcDevices(QList<InputDevice> &devices)
 {
     QFile file(QStringLiteral("/proc/bus/input/devices"));
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "DeviceManager: Failed to open /proc/bus/input/devices";
         Q_EMIT errorOccurred(QStringLiteral("Failed to open /proc/bus/input/devices"));
-        return;
+        return false;
     }
     
     // Read entire file content (procfs files report size 0, so we must read all)
@@ -202,141 +497,79 @@ void DeviceManager::parseDevices()
     
     if (content.isEmpty()) {
         qWarning() << "DeviceManager: /proc/bus/input/devices is empty";
-        return;
+        return true;
     }
 
-    QTextStream stream(&content);
-    QString currentName;
-    QString currentHandlers;
-    QString currentPhys;
-    QString currentVendor;
-    QString currentProduct;
-    int currentEventNumber = -1;
-    int lineCount = 0;
-
-    static const QRegularExpression nameRegex(QStringLiteral("^N: Name=\"(.*)\"$"));
-    static const QRegularExpression handlersRegex(QStringLiteral("^H: Handlers=(.*)$"));
-    static const QRegularExpression eventRegex(QStringLiteral("event(\\d+)"));
-    static const QRegularExpression joyRegex(QStringLiteral("js(\\d+)"));
-    static const QRegularExpression physRegex(QStringLiteral("^P: Phys=(.*)$"));
-    static const QRegularExpression idRegex(QStringLiteral("^I: Bus=\\w+ Vendor=(\\w+) Product=(\\w+)"));
-
-    while (!stream.atEnd()) {
-        QString line = stream.readLine();
-        lineCount++;
-
-        if (line.isEmpty()) {
-            // End of device block - create device if we have valid data
-            if (!currentName.isEmpty() && currentEventNumber >= 0) {
-                InputDevice device;
-                device.eventNumber = currentEventNumber;
-                device.name = currentName;
-                device.path = QStringLiteral("/dev/input/event%1").arg(currentEventNumber);
-                
-                // Construct joystick path if a js handler was found
-                if (!currentHandlers.isEmpty()) {
-                    QRegularExpressionMatch joyMatch = joyRegex.match(currentHandlers);
-                    if (joyMatch.hasMatch()) {
-                        device.joyPath = QStringLiteral("/dev/input/js%1").arg(joyMatch.captured(1));
-                    }
-                }
-
-                device.type = detectDeviceType(currentName, currentHandlers);
-                device.vendorId = currentVendor;
-                device.productId = currentProduct;
-                device.physPath = currentPhys;
-                device.stableId = generateStableId(currentVendor, currentProduct, currentPhys);
-                device.assigned = false;
-                device.assignedInstance = -1;
-                device.isVirtual = isVirtualDevice(currentName, currentPhys);
-                device.isInternal = isInternalDevice(currentName);
-
-                if (m_settingsManager && m_settingsManager->ignoredDevices().contains(device.stableId)) {
-                    qDebug() << "DeviceManager: Ignoring device" << device.name << "stableId:" << device.stableId;
-                } else {
-                    m_devices.append(device);
-                }
-            }
-
-            // Reset for next device
-            currentName.clear();
-            currentHandlers.clear();
-            currentPhys.clear();
-            currentVendor.clear();
-            currentProduct.clear();
-            currentEventNumber = -1;
-            continue;
-        }
+    parseProcDevices(content, devices);
+    return true;
+}
 
-        // Parse name
-        QRegularExpressionMatch nameMatch = nameRegex.match(line);
-        if (nameMatch.hasMatch()) {
-            currentName = nameMatch.captured(1);
-            continue;
-        }
+void DeviceManager::parseProcDevices(const QByteArray &content, QList<InputDevice> &devices)
+{
+    QSet<QString> ignored;
+    if (m_settingsManager) {
+        const QStringList ignoredList = m_settingsManager->ignoredDevices();
+        ignored = QSet<QString>(ignoredList.cbegin(), ignoredList.cend());
+    }
 
-        // Parse handlers
-        QRegularExpressionMatch handlersMatch = handlersRegex.match(line);
-        if (handlersMatch.hasMatch()) {
-            currentHandlers = handlersMatch.captured(1);
+    QHash<int, ScannedDevice> scanned;
+    scanned.reserve(m_scanCache.size());
 
-            // Extract event number
-            QRegularExpressionMatch eventMatch = eventRegex.match(currentHandlers);
-            if (eventMatch.hasMatch()) {
-                currentEventNumber = eventMatch.captured(1).toInt();
-            }
-            continue;
-        }
-        
-        // Parse physical path
-        QRegularExpressionMatch physMatch = physRegex.match(line);
-        if (physMatch.hasMatch()) {
-            currentPhys = physMatch.captured(1);
-            continue;
-        }
-        
-        // Parse vendor/product ID
-        QRegularExpressionMatch idMatch = idRegex.match(line);
-        if (idMatch.hasMatch()) {
-            currentVendor = idMatch.captured(1);
-            currentProduct = idMatch.captured(2);
-            continue;
+    InputDeviceScanner::scan(content, [&](const ProcInputRecord &record) {
+        // Virtual devices the helper's input router feeds players through
+        if (record.phys.startsWith(INPUT_ROUTER_PHYS_PREFIX)) {
+            return;
         }
-    }
 
-    // Handle last device if file doesn't end with empty line
-    if (!currentName.isEmpty() && currentEventNumber >= 0) {
         InputDevice device;
-        device.eventNumber = currentEventNumber;
-        device.name = currentName;
-        device.path = QStringLiteral("/dev/input/event%1").arg(currentEventNumber);
-
-        // Construct joystick path if a js handler was found
-        if (!currentHandlers.isEmpty()) {
-            QRegularExpressionMatch joyMatch = joyRegex.match(currentHandlers);
-            if (joyMatch.hasMatch()) {
-                device.joyPath = QStringLiteral("/dev/input/js%1").arg(joyMatch.captured(1));
-            }
+        auto cached = m_scanCache.constFind(record.eventNumber);
+        if (cached != m_scanCache.constEnd() && QByteArrayView(cached->block) == record.block) {
+            // Unchanged block: skip decoding and type probing
+            device = cached->device;
+            scanned.insert(record.eventNumber, *cached);
+        } else {
+            device = makeDevice(record);
+            scanned.insert(record.eventNumber, {record.block.toByteArray(), device});
         }
 
-        device.type = detectDeviceType(currentName, currentHandlers);
-        device.vendorId = currentVendor;
-        device.productId = currentProduct;
-        device.physPath = currentPhys;
-        device.stableId = generateStableId(currentVendor, currentProduct, currentPhys);
-        device.assigned = false;
-        device.assignedInstance = -1;
-        device.isVirtual = isVirtualDevice(currentName, currentPhys);
-        device.isInternal = isInternalDevice(currentName);
-
-        if (m_settingsManager && m_settingsManager->ignoredDevices().contains(device.stableId)) {
+        if (ignored.contains(device.stableId)) {
             qDebug() << "DeviceManager: Ignoring device" << device.name << "stableId:" << device.stableId;
-        } else {
-            m_devices.append(device);
+            return;
         }
+        devices.append(device);
+    });
+
+    m_scanCache.swap(scanned);
+}
+
+InputDevice DeviceManager::makeDevice(const ProcInputRecord &record) const
+{
+    const QString name = QString::fromUtf8(record.name);
+    const QString handlers = QString::fromLatin1(record.handlers);
+    const QString phys = QString::fromUtf8(record.phys);
+    const QString vendor = QString::fromLatin1(record.vendor);
+    const QString product = QString::fromLatin1(record.product);
+
+    InputDevice device;
+    device.eventNumber = record.eventNumber;
+    device.name = name;
+    device.path = QStringLiteral("/dev/input/event") + QString::number(record.eventNumber);
+
+    // Construct joystick path if a js handler was found
+    if (record.joyNumber >= 0) {
+        device.joyPath = QStringLiteral("/dev/input/js") + QString::number(record.joyNumber);
     }
-    
-    qDebug() << "DeviceManager: Found" << m_devices.size() << "input devices";
+
+    device.type = detectDeviceType(name, handlers);
+    device.vendorId = vendor;
+    device.productId = product;
+    device.physPath = phys;
+    device.stableId = generateStableId(vendor, product, phys);
+    device.assigned = false;
+    device.assignedInstance = -1;
+    device.isVirtual = isVirtualDevice(name, phys);
+    device.isInternal = isInternalDevice(name);
+    return device;
 }
 
 QString DeviceManager::detectDeviceType(const QString &name, const QString &handlers) const
@@ -460,31 +693,30 @@ bool DeviceManager::isInternalDevice(const QString &name) const
 
 bool DeviceManager::assignDevice(int eventNumber, int instanceIndex)
 {
-    for (int i = 0; i < m_devices.size(); ++i) {
-        if (m_devices[i].eventNumber == eventNumber) {
-            int previousInstance = m_devices[i].assignedInstance;
-            m_devices[i].assigned = (instanceIndex >= 0);
-            m_devices[i].assignedInstance = instanceIndex;
-            
-            // Update persistent assignment cache
-            if (!m_devices[i].stableId.isEmpty()) {
-                if (instanceIndex >= 0) {
-                    m_assignmentCache[m_devices[i].stableId] = qMakePair(instanceIndex, m_devices[i].name);
-                } else {
-                    m_assignmentCache.remove(m_devices[i].stableId);
-                }
-            }
-            
-            Q_EMIT devicesChanged();
-            Q_EMIT deviceAssigned(eventNumber, instanceIndex, previousInstance);
-            qDebug() << "DeviceManager: Assigned device" << m_devices[i].name 
-                     << "to instance" << instanceIndex << "(was:" << previousInstance << ")";
-            return true;
+    const int slot = indexOfEventNumber(eventNumber);
+    if (slot < 0) {
+        Q_EMIT errorOccurred(QStringLiteral("Device event%1 not found").arg(eventNumber));
+        return false;
+    }
+    
+    int previousInstance = m_devices.at(slot).assignedInstance;
+    setDeviceInstance(slot, instanceIndex);
+    const InputDevice &device = m_devices.at(slot);
+    
+    // Update persistent assignment cache
+    if (!device.stableId.isEmpty()) {
+        if (instanceIndex >= 0) {
+            m_assignmentCache[device.stableId] = qMakePair(instanceIndex, device.name);
+        } else {
+            m_assignmentCache.remove(device.stableId);
         }
     }
-
-    Q_EMIT errorOccurred(QStringLiteral("Device event%1 not found").arg(eventNumber));
-    return false;
+    
+    Q_EMIT devicesChanged();
+    Q_EMIT deviceAssigned(eventNumber, instanceIndex, previousInstance);
+    qDebug() << "DeviceManager: Assigned device" << device.name 
+             << "to instance" << instanceIndex << "(was:" << previousInstance << ")";
+    return true;
 }
 
 void DeviceManager::unassignAll()
@@ -493,6 +725,7 @@ void DeviceManager::unassignAll()
         m_devices[i].assigned = false;
         m_devices[i].assignedInstance = -1;
     }
+    m_instanceBits.clear();
     Q_EMIT devicesChanged();
     qDebug() << "DeviceManager: Unassigned all devices";
 }
@@ -500,10 +733,8 @@ void DeviceManager::unassignAll()
 QList<int> DeviceManager::getDevicesForInstance(int instanceIndex) const
 {
     QList<int> result;
-    for (const auto &device : m_devices) {
-        if (device.assignedInstance == instanceIndex) {
-            result.append(device.eventNumber);
-        }
+    for (int slot : slotsForInstance(instanceIndex)) {
+        result.append(m_devices[slot].eventNumber);
     }
     return result;
 }
@@ -511,12 +742,11 @@ QList<int> DeviceManager::getDevicesForInstance(int instanceIndex) const
 QStringList DeviceManager::getDevicePathsForInstance(int instanceIndex) const
 {
     QStringList result;
-    for (const auto &device : m_devices) {
-        if (device.assignedInstance == instanceIndex) {
-            result.append(device.path);
-            if (!device.joyPath.isEmpty()) {
-                result.append(device.joyPath);
-            }
+    for (int slot : slotsForInstance(instanceIndex)) {
+        const InputDevice &device = m_devices[slot];
+        result.append(device.path);
+        if (!device.joyPath.isEmpty()) {
+            result.append(device.joyPath);
         }
     }
     return result;
@@ -525,10 +755,9 @@ QStringList DeviceManager::getDevicePathsForInstance(int instanceIndex) const
 int DeviceManager::autoAssignControllers()
 {
     // First, unassign all controllers
-    for (auto &device : m_devices) {
-        if (device.type == QStringLiteral("controller")) {
-            device.assigned = false;
-            device.assignedInstance = -1;
+    for (int slot = 0; slot < m_devices.size(); ++slot) {
+        if (m_devices[slot].type == QStringLiteral("controller")) {
+            setDeviceInstance(slot, -1);
         }
     }
     
@@ -546,8 +775,7 @@ int DeviceManager::autoAssignControllers()
     for (int instance = 0; instance < m_instanceCount && assignedCount < controllerIndices.size(); ++instance) {
         int deviceIndex = controllerIndices[assignedCount];
         int previousInstance = m_devices[deviceIndex].assignedInstance; // Will be -1 since we unassigned all above
-        m_devices[deviceIndex].assigned = true;
-        m_devices[deviceIndex].assignedInstance = instance;
+        setDeviceInstance(deviceIndex, instance);
         Q_EMIT deviceAssigned(m_devices[deviceIndex].eventNumber, instance, previousInstance);
         assignedCount++;
     }
@@ -560,110 +788,71 @@ int DeviceManager::autoAssignControllers()
 void DeviceManager::identifyDevice(int eventNumber)
 {
     // Find the device
-    const InputDevice *device = nullptr;
-    for (const auto &d : m_devices) {
-        if (d.eventNumber == eventNumber) {
-            device = &d;
-            break;
-        }
-    }
+    const int slot = indexOfEventNumber(eventNumber);
+    const InputDevice *device = slot >= 0 ? &m_devices[slot] : nullptr;
     
     if (!device) {
         Q_EMIT errorOccurred(QStringLiteral("Device not found"));
         return;
     }
     
-    // Only controllers support rumble
-    if (device->type != QStringLiteral("controller")) {
+    // Controllers rumble, keyboards flash their lock LEDs
+    if (device->type != QStringLiteral("controller") && device->type != QStringLiteral("keyboard")) {
         qDebug() << "DeviceManager: Device" << device->name << "does not support identification";
         return;
     }
-    
-    // Try to trigger rumble using force feedback
-    int fd = open(device->path.toLocal8Bit().constData(), O_RDWR);
-    if (fd < 0) {
-        qDebug() << "DeviceManager: Cannot open device for identification:" << device->path;
-        return;
-    }
-    
-    // Check for force feedback support
-    unsigned long features[4] = {0};
-    if (ioctl(fd, EVIOCGBIT(EV_FF, sizeof(features)), features) < 0) {
-        qWarning() << "DeviceManager: Failed to get FF features for" << device->name << "errno:" << errno;
-        close(fd);
-        return;
+
+    // Opened, uploaded and played on the worker thread
+    m_evdev->identify(device->path);
+}
+
+int DeviceManager::identifyAllControllers()
+{
+    // Player 1's controllers first, unassigned ones last
+    QList<const InputDevice *> controllers;
+    for (const InputDevice &device : std::as_const(m_devices)) {
+        if (device.type == QStringLiteral("controller") && !device.isVirtual) {
+            controllers.append(&device);
+        }
     }
+    std::stable_sort(controllers.begin(), controllers.end(), [](const InputDevice *a, const InputDevice *b) {
+        return uint(a->assignedInstance) < uint(b->assignedInstance);
+    });
 
-    // Create a simple rumble effect
-    struct ff_effect effect;
-    memset(&effect, 0, sizeof(effect));
-    effect.type = FF_RUMBLE;
-    effect.id = -1;
-    effect.u.rumble.strong_magnitude = 0xC000;
-    effect.u.rumble.weak_magnitude = 0xC000;
-    effect.replay.length = 1000; // 1000ms (matched to test_rumble)
-    effect.replay.delay = 0;
-    
-    if (ioctl(fd, EVIOCSFF, &effect) < 0) {
-        qWarning() << "DeviceManager: Failed to upload rumble effect to" << device->name << "errno:" << errno;
-        close(fd);
-        return;
+    QStringList paths;
+    for (const InputDevice *device : std::as_const(controllers)) {
+        paths.append(device->path);
     }
+    m_evdev->identifyAll(paths);
+    return paths.size();
+}
 
-    // Play the effect
-    struct input_event play;
-    memset(&play, 0, sizeof(play));
-    play.type = EV_FF;
-    play.code = effect.id;
-    play.value = 1;
-    
-    if (write(fd, &play, sizeof(play)) < 0) {
-        qWarning() << "DeviceManager: Failed to play rumble effect on" << device->name << "errno:" << errno;
-        close(fd);
-    } else {
-        // Keep FD open for duration of effect, otherwise kernel stops it immediately
-        // Use QTimer to close it asynchronously
-        QTimer::singleShot(effect.replay.length + 100, [fd, id = effect.id, name = device->name]() {
-            struct input_event stop;
-            memset(&stop, 0, sizeof(stop));
-            stop.type = EV_FF;
-            stop.code = id;
-            stop.value = 0;
-            if (write(fd, &stop, sizeof(stop)) < 0) {
-                // Best effort stop
-            }
-            close(fd);
-        });
+void DeviceManager::updateRetainedDevices()
+{
+    QStringList paths;
+    for (const InputDevice &device : std::as_const(m_devices)) {
+        if (device.assignedInstance >= 0 && device.type == QStringLiteral("controller")) {
+            paths.append(device.path);
+        }
+    }
+    if (paths != m_retainedPaths) {
+        m_retainedPaths = paths;
+        m_evdev->setRetained(paths);
     }
 }
 
 QVariantMap DeviceManager::getDevice(int eventNumber) const
 {
-    for (const auto &device : m_devices) {
-        if (device.eventNumber == eventNumber) {
-            return deviceToVariantMap(device);
-        }
+    const int slot = indexOfEventNumber(eventNumber);
+    if (slot >= 0) {
+        return deviceToVariantMap(m_devices[slot]);
     }
     return QVariantMap();
 }
 
 QVariantMap DeviceManager::deviceToVariantMap(const InputDevice &device) const
 {
-    QVariantMap map;
-    map[QStringLiteral("eventNumber")] = device.eventNumber;
-    map[QStringLiteral("name")] = device.name;
-    map[QStringLiteral("type")] = device.type;
-    map[QStringLiteral("path")] = device.path;
-    map[QStringLiteral("joyPath")] = device.joyPath;
-    map[QStringLiteral("vendorId")] = device.vendorId;
-    map[QStringLiteral("productId")] = device.productId;
-    map[QStringLiteral("physPath")] = device.physPath;
-    map[QStringLiteral("stableId")] = device.stableId;
-    map[QStringLiteral("assigned")] = device.assigned;
-    map[QStringLiteral("assignedInstance")] = device.assignedInstance;
-    map[QStringLiteral("isVirtual")] = device.isVirtual;
-    map[QStringLiteral("isInternal")] = device.isInternal;
-    return map;
+    return DeviceListModel::toVariantMap(device);
 }
 
 QVariantList DeviceManager::devicesAsVariant() const
@@ -745,6 +934,9 @@ void DeviceManager::setShowVirtualDevices(bool show)
 {
     if (m_showVirtualDevices != show) {
         m_showVirtualDevices = show;
+        for (DeviceFilterModel *model : {m_visibleModel, m_controllerModel, m_keyboardModel, m_mouseModel}) {
+            model->setShowVirtual(show);
+        }
         Q_EMIT showVirtualDevicesChanged();
         Q_EMIT devicesChanged();
     }
@@ -754,6 +946,9 @@ void DeviceManager::setShowInternalDevices(bool show)
 {
     if (m_showInternalDevices != show) {
         m_showInternalDevices = show;
+        for (DeviceFilterModel *model : {m_visibleModel, m_controllerModel, m_keyboardModel, m_mouseModel}) {
+            model->setShowInternal(show);
+        }
         Q_EMIT showInternalDevicesChanged();
         Q_EMIT devicesChanged();
     }
@@ -827,12 +1022,8 @@ int DeviceManager::findDeviceByStableId(const QString &stableId) const
         return -1;
     }
     
-    for (const auto &device : m_devices) {
-        if (device.stableId == stableId) {
-            return device.eventNumber;
-        }
-    }
-    return -1;
+    const int slot = m_stableIdIndex.value(stableId, -1);
+    return slot >= 0 ? m_devices[slot].eventNumber : -1;
 }
 
 bool DeviceManager::assignDeviceByStableId(const QString &stableId, int instanceIndex)
@@ -848,9 +1039,9 @@ bool DeviceManager::assignDeviceByStableId(const QString &stableId, int instance
 QStringList DeviceManager::getStableIdsForInstance(int instanceIndex) const
 {
     QStringList result;
-    for (const auto &device : m_devices) {
-        if (device.assignedInstance == instanceIndex && !device.stableId.isEmpty()) {
-            result.append(device.stableId);
+    for (int slot : slotsForInstance(instanceIndex)) {
+        if (!m_devices[slot].stableId.isEmpty()) {
+            result.append(m_devices[slot].stableId);
         }
     }
     return result;
@@ -859,10 +1050,8 @@ QStringList DeviceManager::getStableIdsForInstance(int instanceIndex) const
 QStringList DeviceManager::getDeviceNamesForInstance(int instanceIndex) const
 {
     QStringList result;
-    for (const auto &device : m_devices) {
-        if (device.assignedInstance == instanceIndex) {
-            result.append(device.name);
-        }
+    for (int slot : slotsForInstance(instanceIndex)) {
+        result.append(m_devices[slot].name);
     }
     return result;
 }
@@ -879,11 +1068,7 @@ void DeviceManager::restoreAssignmentsFromStableIds(int instanceIndex, const QSt
             // Device not connected - add to pending list
             qDebug() << "DeviceManager: Device" << name << "not connected, adding to pending list";
             
-            QVariantMap pending;
-            pending[QStringLiteral("stableId")] = stableId;
-            pending[QStringLiteral("name")] = name;
-            pending[QStringLiteral("instanceIndex")] = instanceIndex;
-            m_pendingDevices.append(pending);
+            addPendingDevice({stableId, name, instanceIndex});
         }
     }
     
@@ -897,12 +1082,17 @@ void DeviceManager::clearPendingDevicesForInstance(int instanceIndex)
     if (instanceIndex < 0) {
         // Clear all
         m_pendingDevices.clear();
+        m_pendingStableIds.clear();
     } else {
         // Remove only for specific instance
         m_pendingDevices.erase(
             std::remove_if(m_pendingDevices.begin(), m_pendingDevices.end(),
-                [instanceIndex](const QVariantMap &p) {
-                    return p[QStringLiteral("instanceIndex")].toInt() == instanceIndex;
+                [this, instanceIndex](const PendingDevice &p) {
+                    if (p.instanceIndex != instanceIndex) {
+                        return false;
+                    }
+                    m_pendingStableIds.remove(p.stableId);
+                    return true;
                 }),
             m_pendingDevices.end());
     }
@@ -913,7 +1103,11 @@ QVariantList DeviceManager::pendingDevicesAsVariant() const
 {
     QVariantList result;
     for (const auto &pending : m_pendingDevices) {
-        result.append(pending);
+        QVariantMap map;
+        map[QStringLiteral("stableId")] = pending.stableId;
+        map[QStringLiteral("name")] = pending.name;
+        map[QStringLiteral("instanceIndex")] = pending.instanceIndex;
+        result.append(map);
     }
     return result;
 }
@@ -925,19 +1119,17 @@ void DeviceManager::checkPendingDevices()
     }
     
     bool changed = false;
-    QList<QVariantMap> stillPending;
+    QList<PendingDevice> stillPending;
     
-    for (const auto &pending : m_pendingDevices) {
-        QString stableId = pending[QStringLiteral("stableId")].toString();
-        QString name = pending[QStringLiteral("name")].toString();
-        int instanceIndex = pending[QStringLiteral("instanceIndex")].toInt();
-        
-        int eventNumber = findDeviceByStableId(stableId);
+    // Iterate a copy, assignDevice() emits signals that may re-enter
+    const QList<PendingDevice> pendingDevices = m_pendingDevices;
+    for (const auto &pending : pendingDevices) {
+        int eventNumber = findDeviceByStableId(pending.stableId);
         if (eventNumber >= 0) {
             // Device reconnected! Assign it
-            if (assignDevice(eventNumber, instanceIndex)) {
-                qDebug() << "DeviceManager: Auto-restored device" << name << "to instance" << instanceIndex;
-                Q_EMIT deviceAutoRestored(name, instanceIndex);
+            if (assignDevice(eventNumber, pending.instanceIndex)) {
+                qDebug() << "DeviceManager: Auto-restored device" << pending.name << "to instance" << pending.instanceIndex;
+                Q_EMIT deviceAutoRestored(pending.name, pending.instanceIndex);
                 changed = true;
             } else {
                 stillPending.append(pending);
@@ -949,6 +1141,10 @@ void DeviceManager::checkPendingDevices()
     
     if (changed) {
         m_pendingDevices = stillPending;
+        m_pendingStableIds.clear();
+        for (const auto &pending : m_pendingDevices) {
+            m_pendingStableIds.insert(pending.stableId);
+        }
         Q_EMIT pendingDevicesChanged();
     }
 }
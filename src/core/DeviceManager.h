@@ -4,61 +4,37 @@
 #pragma once
 
 #include <QObject>
+#include <QBitArray>
+#include <QHash>
 #include <QList>
 #include <QMap>
 #include <QPair>
 #include <QSet>
 #include <QString>
+#include <QStringList>
 #include <QVariantMap>
 #include <QFileSystemWatcher>
 #include <QTimer>
 #include <qqmlintegration.h>
 
+#include "DeviceFilterModel.h"
+#include "DeviceListModel.h"
+#include "InputDevice.h"
+#include "PowerSupplyMonitor.h"
 #include "SettingsManager.h"
 
-/**
- * @brief Represents an input device (controller, keyboard, mouse)
- */
-struct InputDevice {
-    Q_GADGET
-    Q_PROPERTY(int eventNumber MEMBER eventNumber)
-    Q_PROPERTY(QString name MEMBER name)
-    Q_PROPERTY(QString type MEMBER type)
-    Q_PROPERTY(QString path MEMBER path)
-    Q_PROPERTY(QString joyPath MEMBER joyPath)
-    Q_PROPERTY(QString vendorId MEMBER vendorId)
-    Q_PROPERTY(QString productId MEMBER productId)
-    Q_PROPERTY(QString physPath MEMBER physPath)
-    Q_PROPERTY(bool assigned MEMBER assigned)
-    Q_PROPERTY(int assignedInstance MEMBER assignedInstance)
-    Q_PROPERTY(bool isVirtual MEMBER isVirtual)
-    Q_PROPERTY(bool isInternal MEMBER isInternal)
-    Q_PROPERTY(QString stableId MEMBER stableId)
-
-public:
-    int eventNumber = -1;
-    QString name;
-    QString type; // "controller", "keyboard", "mouse", "other"
-    QString path; // /dev/input/eventN
-    QString joyPath; // /dev/input/jsN (optional)
-    QString vendorId;
-    QString productId;
-    QString physPath; // Physical device path (for grouping)
-    QString stableId; // Stable identifier: "vendorId:productId:physPath" - survives hotplug/reboot
-    bool assigned = false;
-    int assignedInstance = -1;
-    bool isVirtual = false;  // Virtual/software device
-    bool isInternal = false; // Internal device (power buttons, etc.)
-};
-
-Q_DECLARE_METATYPE(InputDevice)
+class EvdevWorker;
+class InputHotplugMonitor;
+struct ProcInputRecord;
 
 /**
  * @brief Manages input device detection and assignment
  * 
  * Reads from /proc/bus/input/devices to detect available input devices
  * and manages their assignment to gamescope instances. Monitors for
- * hotplug events to automatically detect device changes.
+ * hotplug events to automatically detect device changes: udev netlink
+ * events update single devices immediately, a debounced full rescan is
+ * used when netlink is unavailable or events were lost.
  */
 class DeviceManager : public QObject
 {
@@ -70,6 +46,11 @@ class DeviceManager : public QObject
     Q_PROPERTY(QVariantList keyboards READ keyboardsAsVariant NOTIFY devicesChanged)
     Q_PROPERTY(QVariantList mice READ miceAsVariant NOTIFY devicesChanged)
     Q_PROPERTY(QVariantList visibleDevices READ visibleDevicesAsVariant NOTIFY devicesChanged)
+    Q_PROPERTY(DeviceListModel* deviceModel READ deviceModel CONSTANT)
+    Q_PROPERTY(DeviceFilterModel* visibleModel READ visibleModel CONSTANT)
+    Q_PROPERTY(DeviceFilterModel* controllerModel READ controllerModel CONSTANT)
+    Q_PROPERTY(DeviceFilterModel* keyboardModel READ keyboardModel CONSTANT)
+    Q_PROPERTY(DeviceFilterModel* mouseModel READ mouseModel CONSTANT)
     Q_PROPERTY(bool showVirtualDevices READ showVirtualDevices WRITE setShowVirtualDevices NOTIFY showVirtualDevicesChanged)
     Q_PROPERTY(bool showInternalDevices READ showInternalDevices WRITE setShowInternalDevices NOTIFY showInternalDevicesChanged)
     Q_PROPERTY(bool hotplugEnabled READ hotplugEnabled WRITE setHotplugEnabled NOTIFY hotplugEnabledChanged)
@@ -78,6 +59,9 @@ class DeviceManager : public QObject
     Q_PROPERTY(SettingsManager* settingsManager READ settingsManager WRITE setSettingsManager NOTIFY settingsManagerChanged)
 
 public:
+    // batteryLow() threshold
+    static constexpr int LOW_BATTERY_PERCENT = 15;
+
     explicit DeviceManager(QObject *parent = nullptr);
     ~DeviceManager() override;
 
@@ -141,6 +125,14 @@ public:
      */
     Q_INVOKABLE void identifyDevice(int eventNumber);
 
+    /**
+     * @brief Pulse every controller in turn, player 1's first
+     *
+     * Returns right away; the pulses run on the evdev worker.
+     * @return Number of controllers queued
+     */
+    Q_INVOKABLE int identifyAllControllers();
+
     /**
      * @brief Get a device by event number
      * @param eventNumber The event number
@@ -204,6 +196,15 @@ public:
      */
     Q_INVOKABLE void clearPendingDevicesForInstance(int instanceIndex);
 
+    /**
+     * @brief Parse the contents of /proc/bus/input/devices into @p devices
+     *
+     * Blocks that are byte-for-byte unchanged since the previous scan reuse
+     * the InputDevice built then, so only new devices are decoded and
+     * probed. Ignored devices are skipped. Public for tests and benchmarks.
+     */
+    void parseProcDevices(const QByteArray &content, QList<InputDevice> &devices);
+
     /**
      * @brief Get pending devices as QVariantList for QML
      * @return List of pending device info maps
@@ -217,6 +218,19 @@ public:
     QVariantList keyboardsAsVariant() const;
     QVariantList miceAsVariant() const;
     QVariantList visibleDevicesAsVariant() const;
+
+    /**
+     * @brief Row-level models of the device list
+     *
+     * Updated incrementally, so delegates bound to them survive assignment
+     * changes and hotplug; prefer these over the QVariantList properties,
+     * which rebuild every entry on each devicesChanged.
+     */
+    DeviceListModel* deviceModel() const { return m_deviceModel; }
+    DeviceFilterModel* visibleModel() const { return m_visibleModel; }
+    DeviceFilterModel* controllerModel() const { return m_controllerModel; }
+    DeviceFilterModel* keyboardModel() const { return m_keyboardModel; }
+    DeviceFilterModel* mouseModel() const { return m_mouseModel; }
     
     bool showVirtualDevices() const { return m_showVirtualDevices; }
     void setShowVirtualDevices(bool show);
@@ -258,6 +272,14 @@ Q_SIGNALS:
      * @brief Emitted when the pending devices list changes
      */
     void pendingDevicesChanged();
+    /**
+     * @brief A device battery dropped below LOW_BATTERY_PERCENT while discharging
+     *
+     * Emitted once per battery until it is charged (or reconnected).
+     * @param name Name of the device the battery powers
+     * @param instanceIndex Instance the device is assigned to, -1 if none
+     */
+    void batteryLow(const QString &name, int level, int instanceIndex);
     void errorOccurred(const QString &message);
     void showVirtualDevicesChanged();
     void showInternalDevicesChanged();
@@ -268,30 +290,89 @@ Q_SIGNALS:
 private Q_SLOTS:
     void onInputDirectoryChanged();
     void onDebounceTimeout();
+    void onEventDeviceAdded(int eventNumber);
+    void onEventDeviceRemoved(int eventNumber);
+    void onPowerSupplyChanged(const QString &name);
 
     void onIgnoredDevicesChanged();
 
 private:
     void parseDevices();
+    /**
+     * @brief Parse /proc/bus/input/devices into @p devices (ignored devices skipped)
+     * @return false if the file couldn't be read
+     */
+    bool readProcDevices(QList<InputDevice> &devices);
+    InputDevice makeDevice(const ProcInputRecord &record) const;
+    int indexOfEventNumber(int eventNumber) const;
+    bool hasDeviceWithStableId(const QString &stableId) const;
+
+    // Index maintenance; call indexDevice() after appending, rebuildIndices()
+    // after anything that shifts slots
+    void indexDevice(int slot);
+    void rebuildIndices();
+    QBitArray &instanceBits(int instanceIndex);
+    void setDeviceInstance(int slot, int instanceIndex);
+    QList<int> slotsForInstance(int instanceIndex) const;
+
+    struct PendingDevice {
+        QString stableId;
+        QString name;
+        int instanceIndex = -1;
+    };
+    bool addPendingDevice(const PendingDevice &pending);
+    bool takePendingDevice(const QString &stableId);
     QString detectDeviceType(const QString &name, const QString &handlers) const;
     bool isVirtualDevice(const QString &name, const QString &physPath) const;
     bool isInternalDevice(const QString &name) const;
     QVariantMap deviceToVariantMap(const InputDevice &device) const;
+    DeviceFilterModel *createFilterModel(DeviceFilterModel::Filter filter);
     void setupHotplugWatcher();
     void checkPendingDevices();
+    // Assigned controllers stay open on the evdev worker
+    void updateRetainedDevices();
+    /**
+     * @brief Copy battery state into m_devices and emit batteryLow()
+     * @return true if any device changed
+     */
+    bool updateBatteries();
 
     QList<InputDevice> m_devices;
+    
+    // Devices built by the previous scan, keyed by event number; reused
+    // while their procfs block is unchanged
+    struct ScannedDevice {
+        QByteArray block;
+        InputDevice device;
+    };
+    QHash<int, ScannedDevice> m_scanCache;
     SettingsManager *m_settingsManager = nullptr;
     QFileSystemWatcher *m_watcher = nullptr;
+    InputHotplugMonitor *m_hotplugMonitor = nullptr;
     QTimer *m_debounceTimer = nullptr;
     
+    DeviceListModel *m_deviceModel = nullptr;
+    EvdevWorker *m_evdev = nullptr;
+    QStringList m_retainedPaths;
+    PowerSupplyMonitor m_powerSupplies;
+    QSet<QString> m_lowBatteries;  // Supply names batteryLow() was emitted for
+    DeviceFilterModel *m_visibleModel = nullptr;
+    DeviceFilterModel *m_controllerModel = nullptr;
+    DeviceFilterModel *m_keyboardModel = nullptr;
+    DeviceFilterModel *m_mouseModel = nullptr;
+    
     // Persistent assignment cache: survives across hotplug cycles
     // Maps stableId -> {instanceIndex, deviceName}
     QMap<QString, QPair<int, QString>> m_assignmentCache;
     
     // Pending devices: devices that were expected from profile but not connected
-    // Format: {stableId, name, instanceIndex}
-    QList<QVariantMap> m_pendingDevices;
+    QList<PendingDevice> m_pendingDevices;
+    QSet<QString> m_pendingStableIds;
+    
+    // Lookup indices into m_devices (slot = list index)
+    QHash<int, int> m_eventIndex;         // eventNumber -> slot
+    QHash<QString, int> m_stableIdIndex;  // stableId -> first slot
+    QList<QBitArray> m_instanceBits;      // instance -> bit per assigned slot
     
     bool m_showVirtualDevices = false;
     bool m_showInternalDevices = false;
@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "EvdevWorker.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QMetaObject>
+#include <QTimer>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+
+namespace {
+
+constexpr unsigned long LED_MASK = (1UL << LED_NUML) | (1UL << LED_CAPSL) | (1UL << LED_SCROLLL);
+
+bool testBit(const unsigned long *bits, int bit)
+{
+    constexpr int width = sizeof(unsigned long) * 8;
+    return bits[bit / width] & (1UL << (bit % width));
+}
+
+bool writeEvent(int fd, quint16 type, quint16 code, qint32 value)
+{
+    struct input_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.code = code;
+    event.value = value;
+    return write(fd, &event, sizeof(event)) == sizeof(event);
+}
+
+bool writeLeds(int fd, unsigned long leds, unsigned long state)
+{
+    bool ok = true;
+    for (int led = LED_NUML; led <= LED_SCROLLL; ++led) {
+        if (leds & (1UL << led)) {
+            ok &= writeEvent(fd, EV_LED, led, (state >> led) & 1);
+        }
+    }
+    return ok && writeEvent(fd, EV_SYN, SYN_REPORT, 0);
+}
+
+QString errnoString()
+{
+    return QString::fromLocal8Bit(strerror(errno));
+}
+
+} // namespace
+
+EvdevWorker::EvdevWorker(QObject *parent)
+    : QObject(parent)
+    , m_context(new QObject)
+{
+    m_thread.setObjectName(QStringLiteral("EvdevWorker"));
+    m_context->moveToThread(&m_thread);
+    m_thread.start();
+}
+
+EvdevWorker::~EvdevWorker()
+{
+    QMetaObject::invokeMethod(m_context, [this]() {
+        m_closing = true;
+        for (const QString &path : m_nodes.keys()) {
+            closeNode(path);
+        }
+    }, Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_context;
+}
+
+void EvdevWorker::post(const std::function<void()> &command)
+{
+    QMetaObject::invokeMethod(m_context, command, Qt::QueuedConnection);
+}
+
+void EvdevWorker::setRetained(const QStringList &paths)
+{
+    post([this, paths]() {
+        m_retained = QSet<QString>(paths.cbegin(), paths.cend());
+        for (const QString &path : m_nodes.keys()) {
+            if (!m_retained.contains(path) && m_nodes.value(path).pulses == 0) {
+                closeNode(path);
+            }
+        }
+    });
+}
+
+void EvdevWorker::identify(const QString &path, int durationMs)
+{
+    post([this, path, durationMs]() {
+        runIdentify(path, durationMs);
+    });
+}
+
+void EvdevWorker::identifyAll(const QStringList &paths)
+{
+    post([this, paths]() {
+        const quint64 sequence = ++m_sequence;
+        for (int i = 0; i < paths.size(); ++i) {
+            QTimer::singleShot(i * (PULSE_MS + PULSE_GAP_MS), m_context, [this, sequence, path = paths.at(i)]() {
+                if (sequence == m_sequence) {
+                    runIdentify(path, PULSE_MS);
+                }
+            });
+        }
+    });
+}
+
+void EvdevWorker::runIdentify(const QString &path, int durationMs)
+{
+    if (m_closing) {
+        return;
+    }
+    QString error;
+    const bool success = pulse(path, durationMs, error);
+    if (!success) {
+        qDebug() << "EvdevWorker: Cannot identify" << path << "-" << error;
+    }
+    Q_EMIT identified(path, success, error);
+}
+
+EvdevWorker::Node *EvdevWorker::node(const QString &path, QString &error)
+{
+    const auto it = m_nodes.find(path);
+    if (it != m_nodes.end()) {
+        return &it.value();
+    }
+
+    // Non-blocking: nothing here may wait on a device
+    const int fd = ::open(QFile::encodeName(path).constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        error = errnoString();
+        return nullptr;
+    }
+
+    Node node;
+    node.fd = fd;
+    unsigned long bits[(FF_CNT + sizeof(unsigned long) * 8 - 1) / (sizeof(unsigned long) * 8)] = {0};
+    if (ioctl(fd, EVIOCGBIT(EV_FF, sizeof(bits)), bits) >= 0) {
+        node.rumble = testBit(bits, FF_RUMBLE);
+    }
+    unsigned long leds = 0;
+    if (ioctl(fd, EVIOCGBIT(EV_LED, sizeof(leds)), &leds) >= 0) {
+        node.leds = leds & LED_MASK;
+    }
+    return &m_nodes.insert(path, node).value();
+}
+
+bool EvdevWorker::pulse(const QString &path, int durationMs, QString &error)
+{
+    Node *n = node(path, error);
+    if (!n) {
+        return false;
+    }
+
+    bool played = false;
+    if (n->rumble) {
+        // Rewriting the uploaded effect instead of adding one per pulse
+        struct ff_effect effect;
+        memset(&effect, 0, sizeof(effect));
+        effect.type = FF_RUMBLE;
+        effect.id = n->effectId;
+        effect.u.rumble.strong_magnitude = 0xC000;
+        effect.u.rumble.weak_magnitude = 0xC000;
+        effect.replay.length = durationMs;
+        if (ioctl(n->fd, EVIOCSFF, &effect) >= 0) {
+            n->effectId = effect.id;
+            played = writeEvent(n->fd, EV_FF, effect.id, 1);
+        }
+    }
+    if (n->leds) {
+        if (n->pulses == 0) {
+            ioctl(n->fd, EVIOCGLED(sizeof(n->ledState)), &n->ledState);
+        }
+        played |= writeLeds(n->fd, n->leds, LED_MASK);
+    }
+
+    if (!played) {
+        const int savedErrno = errno;
+        error = n->rumble || n->leds ? errnoString() : QStringLiteral("No rumble or LEDs");
+        // ENODEV: unplugged, a new node comes with the next event number
+        if (n->pulses == 0 && (!m_retained.contains(path) || savedErrno == ENODEV)) {
+            closeNode(path);
+        }
+        return false;
+    }
+
+    // The fd stays open while the effect plays, closing it stops the effect
+    ++n->pulses;
+    QTimer::singleShot(durationMs, m_context, [this, path]() {
+        endPulse(path);
+    });
+    return true;
+}
+
+void EvdevWorker::endPulse(const QString &path)
+{
+    const auto it = m_nodes.find(path);
+    if (it == m_nodes.end() || --it->pulses > 0) {
+        return;
+    }
+    if (it->leds) {
+        writeLeds(it->fd, it->leds, it->ledState);
+    }
+    if (!m_retained.contains(path)) {
+        // Let the tail of the effect play out
+        QTimer::singleShot(100, m_context, [this, path]() {
+            if (m_nodes.contains(path) && m_nodes.value(path).pulses == 0 && !m_retained.contains(path)) {
+                closeNode(path);
+            }
+        });
+    }
+}
+
+void EvdevWorker::closeNode(const QString &path)
+{
+    const Node node = m_nodes.take(path);
+    if (node.fd >= 0) {
+        close(node.fd);  // Also erases the uploaded effect
+    }
+}
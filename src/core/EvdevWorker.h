@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+#include <functional>
+
+/**
+ * @brief Identification feedback (rumble, lock LEDs) off the GUI thread
+ *
+ * Commands are queued to a thread of its own, which opens the evdev nodes
+ * non-blocking, uploads one FF_RUMBLE effect per node and rewrites it for
+ * each pulse, and writes EV_LED events to devices with Num/Caps/Scroll
+ * Lock LEDs, restoring their state afterwards. A slow Bluetooth open() or
+ * a batch of requests never holds up the UI.
+ *
+ * Retained nodes (the assigned controllers) stay open between commands:
+ * they keep working once ownership has been handed to a player, as an
+ * open fd survives the chown. Others are closed when their pulse ends.
+ */
+class EvdevWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int IDENTIFY_MS = 1000;
+    // identifyAll(): each device pulses for PULSE_MS, PULSE_GAP_MS apart
+    static constexpr int PULSE_MS = 350;
+    static constexpr int PULSE_GAP_MS = 150;
+
+    explicit EvdevWorker(QObject *parent = nullptr);
+    ~EvdevWorker() override;
+
+    /**
+     * @brief Keep @p paths open between commands, close the other idle nodes
+     */
+    void setRetained(const QStringList &paths);
+
+    /**
+     * @brief Rumble and/or light the LEDs of @p path for @p durationMs
+     */
+    void identify(const QString &path, int durationMs = IDENTIFY_MS);
+
+    /**
+     * @brief Pulse @p paths one after the other, replacing a running sequence
+     */
+    void identifyAll(const QStringList &paths);
+
+Q_SIGNALS:
+    /**
+     * @brief A pulse of @p path was played, or failed with @p error
+     *
+     * Emitted from the worker thread.
+     */
+    void identified(const QString &path, bool success, const QString &error);
+
+private:
+    struct Node {
+        int fd = -1;
+        int effectId = -1;       // Uploaded FF_RUMBLE effect
+        bool rumble = false;
+        unsigned long leds = 0;  // Bits of LED_NUML, LED_CAPSL and LED_SCROLLL
+        unsigned long ledState = 0;
+        int pulses = 0;          // Pulses still playing
+    };
+
+    // Worker thread only
+    void post(const std::function<void()> &command);
+    Node *node(const QString &path, QString &error);
+    void runIdentify(const QString &path, int durationMs);
+    bool pulse(const QString &path, int durationMs, QString &error);
+    void endPulse(const QString &path);
+    void closeNode(const QString &path);
+
+    QThread m_thread;
+    QObject *m_context = nullptr;  // Lives on m_thread, commands are posted to it
+    QHash<QString, Node> m_nodes;
+    QSet<QString> m_retained;
+    quint64 m_sequence = 0;
+    bool m_closing = false;
+};
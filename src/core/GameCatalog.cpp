@@ -0,0 +1,561 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "GameCatalog.h"
+#include "GameLibrary.h"
+#include "HeroicConfigManager.h"
+#include "Logging.h"
+#include "StartupTrace.h"
+#include "SteamConfigManager.h"
+#include "Vdf.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <algorithm>
+
+namespace {
+
+// Built-in sources in merge priority: a game Steam has wins over the Heroic
+// copy, and both win over a shortcut pointing at either
+const QStringList kSourcePriority = {
+    QStringLiteral("steam"),
+    QStringLiteral("legendary"),
+    QStringLiteral("gog"),
+    QStringLiteral("nile"),
+    QStringLiteral("sideload"),
+    QStringLiteral("shortcut"),
+};
+
+// "DOOM (2016)" and "Doom 2016" are the same game
+QString normalizedName(const QString &name)
+{
+    QString normalized;
+    normalized.reserve(name.size());
+    for (const QChar c : name) {
+        if (c.isLetterOrNumber()) {
+            normalized.append(c.toCaseFolded());
+        }
+    }
+    return normalized;
+}
+
+QJsonObject gameToJson(const GameCatalog::Game &game)
+{
+    QJsonObject obj;
+    obj[QStringLiteral("id")] = game.id;
+    obj[QStringLiteral("name")] = game.name;
+    obj[QStringLiteral("command")] = game.command;
+    obj[QStringLiteral("installPath")] = game.installPath;
+    obj[QStringLiteral("installSize")] = game.installSize;
+    obj[QStringLiteral("lastPlayed")] = game.lastPlayed;
+    return obj;
+}
+
+GameCatalog::Game gameFromJson(const QString &source, const QJsonObject &obj)
+{
+    GameCatalog::Game game;
+    game.source = source;
+    game.id = obj[QStringLiteral("id")].toString();
+    game.name = obj[QStringLiteral("name")].toString();
+    game.command = obj[QStringLiteral("command")].toString();
+    game.installPath = obj[QStringLiteral("installPath")].toString();
+    game.installSize = obj[QStringLiteral("installSize")].toInteger();
+    game.lastPlayed = obj[QStringLiteral("lastPlayed")].toInteger();
+    return game;
+}
+
+QList<GameCatalog::Game> heroicGames(const QString &source, const QString &heroicCommand,
+                                     const QList<HeroicGame> &installed)
+{
+    QList<GameCatalog::Game> games;
+    games.reserve(installed.size());
+    for (const HeroicGame &heroic : installed) {
+        GameCatalog::Game game;
+        game.source = source;
+        game.id = heroic.appName;
+        game.name = heroic.title.isEmpty() ? heroic.appName : heroic.title;
+        game.command = HeroicConfigManager::launchCommand(heroicCommand, heroic);
+        game.installPath = heroic.installPath;
+        game.installSize = heroic.installSize;
+        games.append(game);
+    }
+    return games;
+}
+
+} // namespace
+
+GameCatalog::GameCatalog(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_cachePath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/catalog.json"))
+{
+    StartupTrace::Scope trace("GameCatalog");
+    // Sources are mostly disk bound, one thread each is plenty
+    m_pool.setMaxThreadCount(std::max(2, std::min(QThread::idealThreadCount(), int(kSourcePriority.size()))));
+}
+
+GameCatalog::~GameCatalog()
+{
+    // Running loads post their results to this object
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+int GameCatalog::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_games.size();
+}
+
+QVariant GameCatalog::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_games.size()) {
+        return QVariant();
+    }
+
+    const Game &game = m_games.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return game.name;
+    case KeyRole:
+        return game.key();
+    case SourceRole:
+        return game.source;
+    case IdRole:
+        return game.id;
+    case CommandRole:
+        return game.command;
+    case InstallPathRole:
+        return game.installPath;
+    case InstallSizeRole:
+        return game.installSize;
+    case LastPlayedRole:
+        return game.lastPlayed;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> GameCatalog::roleNames() const
+{
+    return {
+        {KeyRole, "key"},
+        {NameRole, "name"},
+        {SourceRole, "source"},
+        {IdRole, "gameId"},
+        {CommandRole, "command"},
+        {InstallPathRole, "installPath"},
+        {InstallSizeRole, "installSize"},
+        {LastPlayedRole, "lastPlayed"},
+    };
+}
+
+void GameCatalog::setSteamConfigManager(SteamConfigManager *manager)
+{
+    if (m_steamConfigManager == manager) {
+        return;
+    }
+    if (m_steamConfigManager) {
+        disconnect(m_steamConfigManager, nullptr, this, nullptr);
+    }
+    m_steamConfigManager = manager;
+    if (manager) {
+        connect(manager, &SteamConfigManager::steamPathsChanged, this, &GameCatalog::rebuildSources);
+    }
+    rebuildSources();
+}
+
+void GameCatalog::setHeroicConfigManager(HeroicConfigManager *manager)
+{
+    if (m_heroicConfigManager == manager) {
+        return;
+    }
+    if (m_heroicConfigManager) {
+        disconnect(m_heroicConfigManager, nullptr, this, nullptr);
+    }
+    m_heroicConfigManager = manager;
+    if (manager) {
+        connect(manager, &HeroicConfigManager::heroicPathsChanged, this, &GameCatalog::rebuildSources);
+    }
+    rebuildSources();
+}
+
+void GameCatalog::addSource(const QString &name, const QStringList &files, std::function<QList<Game>()> load)
+{
+    if (!m_sources.contains(name)) {
+        m_sourceOrder.append(name);
+        // Built-in sources keep their priority whichever manager was set first
+        std::stable_sort(m_sourceOrder.begin(), m_sourceOrder.end(), [](const QString &a, const QString &b) {
+            const auto rank = [](const QString &source) {
+                const qsizetype index = kSourcePriority.indexOf(source);
+                return index < 0 ? kSourcePriority.size() : index;
+            };
+            return rank(a) < rank(b);
+        });
+    }
+    m_sources.insert(name, Source{files, std::move(load)});
+}
+
+void GameCatalog::rebuildSources()
+{
+    for (const QString &name : kSourcePriority) {
+        m_sources.remove(name);
+        m_sourceOrder.removeAll(name);
+    }
+
+    if (m_steamConfigManager && m_steamConfigManager->isSteamDetected()) {
+        const SteamPaths paths = m_steamConfigManager->steamPaths();
+        // Recent Steam keeps the authoritative copy in steamapps/
+        const QStringList libraryFiles = {paths.libraryFoldersVdf,
+                                          paths.steamRoot + QStringLiteral("/steamapps/libraryfolders.vdf")};
+        const auto libraries = [root = paths.steamRoot, libraryFiles]() {
+            QStringList libraries = {root};
+            for (const QString &vdf : libraryFiles) {
+                libraries.append(GameLibrary::steamLibraryFolders(vdf));
+            }
+            return libraries;
+        };
+
+        // The library list and every steamapps/ in it stamp the source
+        QStringList files = libraryFiles;
+        for (const QString &library : libraries()) {
+            files.append(library + QStringLiteral("/steamapps"));
+        }
+        files.removeDuplicates();
+
+        addSource(QStringLiteral("steam"), files, [libraries]() {
+            QList<Game> games;
+            const QVariantList scanned = GameLibrary::scanSteamGames(libraries());
+            games.reserve(scanned.size());
+            for (const QVariant &entry : scanned) {
+                const QVariantMap map = entry.toMap();
+                Game game;
+                game.source = QStringLiteral("steam");
+                game.id = map.value(QStringLiteral("appId")).toString();
+                game.name = map.value(QStringLiteral("name")).toString();
+                game.command = map.value(QStringLiteral("command")).toString();
+                game.installPath = map.value(QStringLiteral("installPath")).toString();
+                game.installSize = map.value(QStringLiteral("installSize")).toLongLong();
+                game.lastPlayed = map.value(QStringLiteral("lastPlayed")).toLongLong();
+                games.append(game);
+            }
+            return games;
+        });
+
+        if (!paths.shortcutsVdf.isEmpty()) {
+            addSource(QStringLiteral("shortcut"), {paths.shortcutsVdf}, [path = paths.shortcutsVdf]() {
+                QList<Game> games;
+                VdfFile file(path);
+                if (!file.isOpen()) {
+                    return games;
+                }
+                for (const SteamShortcut &shortcut : SteamConfigManager::parseShortcuts(file.data())) {
+                    if (shortcut.isHidden) {
+                        continue;
+                    }
+                    // Steam launches shortcuts by their 64-bit game ID
+                    const quint64 gameId = (quint64(shortcut.appId) << 32) | 0x02000000;
+                    Game game;
+                    game.source = QStringLiteral("shortcut");
+                    game.id = QString::number(shortcut.appId);
+                    game.name = shortcut.appName;
+                    game.command = QStringLiteral("steam://rungameid/%1").arg(gameId);
+                    game.installPath = shortcut.startDir;
+                    game.installPath.remove(QLatin1Char('"'));
+                    game.lastPlayed = shortcut.lastPlayTime;
+                    games.append(game);
+                }
+                return games;
+            });
+        }
+    }
+
+    if (m_heroicConfigManager && m_heroicConfigManager->isHeroicDetected()) {
+        const HeroicPaths paths = m_heroicConfigManager->heroicPaths();
+        const QString command = m_heroicConfigManager->heroicCommand();
+        const struct {
+            QString name;
+            QString path;
+            QList<HeroicGame> (*parse)(const QString &);
+        } backends[] = {
+            {QStringLiteral("legendary"), paths.legendaryInstalled, &HeroicConfigManager::parseLegendaryGames},
+            {QStringLiteral("gog"), paths.gogInstalled, &HeroicConfigManager::parseGogGames},
+            {QStringLiteral("nile"), paths.nileInstalled, &HeroicConfigManager::parseNileGames},
+            {QStringLiteral("sideload"), paths.sideloadLibrary, &HeroicConfigManager::parseSideloadGames},
+        };
+        for (const auto &backend : backends) {
+            if (backend.path.isEmpty()) {
+                continue;
+            }
+            addSource(backend.name, {backend.path}, [name = backend.name, path = backend.path,
+                                                     parse = backend.parse, command]() {
+                return heroicGames(name, command, parse(path));
+            });
+        }
+    }
+}
+
+QString GameCatalog::stampFor(const QStringList &files)
+{
+    // mtime and size of each file; a directory stands for the files directly in it
+    QByteArray stamp;
+    for (const QString &path : files) {
+        const QFileInfo info(path);
+        stamp += path.toUtf8();
+        if (!info.exists()) {
+            stamp += "|-";
+        } else if (info.isDir()) {
+            const QFileInfoList entries = QDir(path).entryInfoList(QDir::Files, QDir::Name);
+            for (const QFileInfo &entry : entries) {
+                stamp += '|' + entry.fileName().toUtf8() + ':'
+                    + QByteArray::number(entry.lastModified().toMSecsSinceEpoch()) + ':'
+                    + QByteArray::number(entry.size());
+            }
+        } else {
+            stamp += '|' + QByteArray::number(info.lastModified().toMSecsSinceEpoch()) + ':'
+                + QByteArray::number(info.size());
+        }
+        stamp += '\n';
+    }
+    return QString::fromLatin1(QCryptographicHash::hash(stamp, QCryptographicHash::Sha1).toHex());
+}
+
+void GameCatalog::refresh()
+{
+    StartupTrace::Scope trace("GameCatalog::refresh");
+    if (!m_cacheLoaded) {
+        m_cacheLoaded = true;
+        loadCache();
+        merge();
+    }
+
+    const bool wasLoading = isLoading();
+    const quint64 generation = ++m_generation;
+    m_pending = m_sourceOrder.size();
+
+    for (const QString &name : std::as_const(m_sourceOrder)) {
+        const Source source = m_sources.value(name);
+        const QString cachedStamp = m_states.contains(name) ? m_states.value(name).stamp : QString();
+        m_pool.start([this, generation, name, source, cachedStamp]() {
+            const QString stamp = stampFor(source.files);
+            // A source without files has nothing to stamp and always loads
+            const bool unchanged = !source.files.isEmpty() && stamp == cachedStamp;
+            const QList<Game> games = unchanged ? QList<Game>() : source.load();
+            QMetaObject::invokeMethod(
+                this,
+                [this, generation, name, stamp, games, unchanged]() {
+                    sourceLoaded(generation, name, stamp, games, unchanged);
+                },
+                Qt::QueuedConnection);
+        });
+    }
+
+    if (m_pending == 0) {
+        merge();
+        Q_EMIT refreshed();
+    }
+    if (isLoading() != wasLoading) {
+        Q_EMIT loadingChanged();
+    }
+}
+
+void GameCatalog::sourceLoaded(quint64 generation, const QString &name, const QString &stamp,
+                               const QList<Game> &games, bool unchanged)
+{
+    if (generation != m_generation) {
+        return;  // A newer refresh() is on its way
+    }
+
+    if (!unchanged) {
+        qCDebug(couchplayCore) << "GameCatalog: loaded" << games.size() << "games from" << name;
+        m_states.insert(name, SourceState{stamp, games});
+        m_cacheDirty = true;
+        merge();
+    }
+
+    if (--m_pending == 0) {
+        // Forget sources that are gone, so the cache doesn't grow stale entries
+        for (auto it = m_states.begin(); it != m_states.end();) {
+            if (m_sources.contains(it.key())) {
+                ++it;
+            } else {
+                it = m_states.erase(it);
+                m_cacheDirty = true;
+            }
+        }
+        merge();
+        if (m_cacheDirty) {
+            m_cacheDirty = false;
+            saveCache();
+        }
+        Q_EMIT loadingChanged();
+        Q_EMIT refreshed();
+    }
+}
+
+void GameCatalog::setSortBy(const QString &sortBy)
+{
+    if (m_sortBy == sortBy) {
+        return;
+    }
+    m_sortBy = sortBy;
+    merge();
+    Q_EMIT sortByChanged();
+}
+
+void GameCatalog::merge()
+{
+    QList<Game> games;
+    QSet<QString> seen;
+    for (const QString &name : std::as_const(m_sourceOrder)) {
+        const auto state = m_states.constFind(name);
+        if (state == m_states.constEnd()) {
+            continue;
+        }
+        for (const Game &game : state->games) {
+            const QString normalized = normalizedName(game.name);
+            if (normalized.isEmpty() || seen.contains(normalized)) {
+                continue;
+            }
+            seen.insert(normalized);
+            games.append(game);
+        }
+    }
+
+    const auto byName = [](const Game &a, const Game &b) {
+        return a.name.compare(b.name, Qt::CaseInsensitive) < 0;
+    };
+    if (m_sortBy == QLatin1String("source")) {
+        std::stable_sort(games.begin(), games.end(), [&](const Game &a, const Game &b) {
+            return a.source != b.source ? a.source < b.source : byName(a, b);
+        });
+    } else if (m_sortBy == QLatin1String("size")) {
+        std::stable_sort(games.begin(), games.end(), [&](const Game &a, const Game &b) {
+            return a.installSize != b.installSize ? a.installSize > b.installSize : byName(a, b);
+        });
+    } else if (m_sortBy == QLatin1String("lastPlayed")) {
+        std::stable_sort(games.begin(), games.end(), [&](const Game &a, const Game &b) {
+            return a.lastPlayed != b.lastPlayed ? a.lastPlayed > b.lastPlayed : byName(a, b);
+        });
+    } else {
+        std::stable_sort(games.begin(), games.end(), byName);
+    }
+
+    sync(games);
+}
+
+void GameCatalog::sync(const QList<Game> &games)
+{
+    const int oldCount = m_games.size();
+
+    QSet<QString> incoming;
+    incoming.reserve(games.size());
+    for (const Game &game : games) {
+        incoming.insert(game.key());
+    }
+
+    // Rows whose game went away
+    for (int row = m_games.size() - 1; row >= 0; --row) {
+        if (!incoming.contains(m_games.at(row).key())) {
+            beginRemoveRows(QModelIndex(), row, row);
+            m_games.removeAt(row);
+            endRemoveRows();
+        }
+    }
+
+    QSet<QString> remaining;
+    remaining.reserve(m_games.size());
+    for (const Game &game : std::as_const(m_games)) {
+        remaining.insert(game.key());
+    }
+
+    // Walk the new list: update rows in place, insert new games where they appear
+    int row = 0;
+    for (const Game &game : games) {
+        if (row < m_games.size() && m_games.at(row).key() == game.key()) {
+            if (!(m_games.at(row) == game)) {
+                m_games[row] = game;
+                const QModelIndex changed = index(row);
+                Q_EMIT dataChanged(changed, changed);
+            }
+            ++row;
+        } else if (!remaining.contains(game.key())) {
+            beginInsertRows(QModelIndex(), row, row);
+            m_games.insert(row, game);
+            endInsertRows();
+            ++row;
+        } else {
+            // Surviving games changed order (renamed, or a new sort order)
+            beginResetModel();
+            m_games = games;
+            endResetModel();
+            break;
+        }
+    }
+
+    if (m_games.size() != oldCount) {
+        Q_EMIT countChanged();
+    }
+}
+
+void GameCatalog::loadCache()
+{
+    QFile file(m_cachePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject sources = QJsonDocument::fromJson(file.readAll()).object()[QStringLiteral("sources")].toObject();
+    for (auto it = sources.constBegin(); it != sources.constEnd(); ++it) {
+        if (!m_sources.contains(it.key())) {
+            continue;
+        }
+        const QJsonObject obj = it.value().toObject();
+        SourceState state;
+        state.stamp = obj[QStringLiteral("stamp")].toString();
+        const QJsonArray games = obj[QStringLiteral("games")].toArray();
+        state.games.reserve(games.size());
+        for (const QJsonValue &game : games) {
+            state.games.append(gameFromJson(it.key(), game.toObject()));
+        }
+        m_states.insert(it.key(), state);
+    }
+}
+
+void GameCatalog::saveCache() const
+{
+    QJsonObject sources;
+    for (auto it = m_states.constBegin(); it != m_states.constEnd(); ++it) {
+        QJsonArray games;
+        for (const Game &game : it->games) {
+            games.append(gameToJson(game));
+        }
+        QJsonObject obj;
+        obj[QStringLiteral("stamp")] = it->stamp;
+        obj[QStringLiteral("games")] = games;
+        sources[it.key()] = obj;
+    }
+
+    QJsonObject root;
+    root[QStringLiteral("sources")] = sources;
+
+    QDir().mkpath(QFileInfo(m_cachePath).absolutePath());
+    QSaveFile file(m_cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(couchplayCore) << "GameCatalog: failed to save" << m_cachePath;
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.commit();
+}
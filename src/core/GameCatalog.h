@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <functional>
+#include <qqmlintegration.h>
+
+class HeroicConfigManager;
+class SteamConfigManager;
+
+/**
+ * @brief One list of every installed game, from all launchers
+ *
+ * Sources are Steam's app manifests, Heroic's Legendary, GOG, Nile and
+ * sideload libraries, and Steam shortcuts. refresh() loads them in
+ * parallel on a thread pool; each source is only parsed again if the
+ * files it came from changed (mtime and size). The merged list is cached
+ * in ~/.cache/couchplay/catalog.json, so a new catalog shows the last
+ * known games right away and patches its rows as sources finish.
+ *
+ * A game found by several sources (a Heroic game added to Steam as a
+ * shortcut, say) is listed once, from the first source in the order above.
+ */
+class GameCatalog : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged)
+    Q_PROPERTY(QString sortBy READ sortBy WRITE setSortBy NOTIFY sortByChanged)
+
+public:
+    enum Roles {
+        KeyRole = Qt::UserRole + 1,  // Source and id, unique in the catalog
+        NameRole,
+        SourceRole,                  // "steam", "shortcut", "legendary", "gog", "nile", "sideload"
+        IdRole,                      // App ID or launcher-specific name
+        CommandRole,
+        InstallPathRole,
+        InstallSizeRole,             // Bytes, 0 if unknown
+        LastPlayedRole,              // Seconds since the epoch, 0 if unknown
+    };
+    Q_ENUM(Roles)
+
+    struct Game {
+        QString source;
+        QString id;
+        QString name;
+        QString command;
+        QString installPath;
+        qint64 installSize = 0;
+        qint64 lastPlayed = 0;
+
+        QString key() const { return source + QLatin1Char(':') + id; }
+        bool operator==(const Game &other) const = default;
+    };
+
+    explicit GameCatalog(QObject *parent = nullptr);
+    ~GameCatalog() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    Q_INVOKABLE void setSteamConfigManager(SteamConfigManager *manager);
+    Q_INVOKABLE void setHeroicConfigManager(HeroicConfigManager *manager);
+
+    /**
+     * @brief Reload the sources whose files changed, in the background
+     */
+    Q_INVOKABLE void refresh();
+
+    int count() const { return m_games.size(); }
+    bool isLoading() const { return m_pending > 0; }
+    QList<Game> games() const { return m_games; }
+
+    /**
+     * @brief Row order: "name" (default), "source", "size" (largest first)
+     * or "lastPlayed" (most recent first)
+     */
+    QString sortBy() const { return m_sortBy; }
+    void setSortBy(const QString &sortBy);
+
+    /**
+     * @brief Where the catalog is cached, for tests
+     */
+    void setCachePath(const QString &path) { m_cachePath = path; }
+
+    /**
+     * @brief Register a source; the built-in ones come from the managers
+     *
+     * @p load runs on a worker thread and must only use what it captured.
+     * @p files stamp the source: it is loaded again when one of them changes,
+     * or on every refresh() if there are none.
+     */
+    void addSource(const QString &name, const QStringList &files, std::function<QList<Game>()> load);
+
+Q_SIGNALS:
+    void countChanged();
+    void loadingChanged();
+    void sortByChanged();
+    void refreshed();
+
+private:
+    struct Source {
+        QStringList files;
+        std::function<QList<Game>()> load;
+    };
+    struct SourceState {
+        QString stamp;
+        QList<Game> games;
+    };
+
+    static QString stampFor(const QStringList &files);
+    void sourceLoaded(quint64 generation, const QString &name, const QString &stamp,
+                      const QList<Game> &games, bool unchanged);
+    void rebuildSources();
+    void merge();
+    void sync(const QList<Game> &games);
+    void loadCache();
+    void saveCache() const;
+
+    QList<Game> m_games;
+    QList<QString> m_sourceOrder;
+    QHash<QString, Source> m_sources;
+    QHash<QString, SourceState> m_states;  // Last loaded or cached result per source
+    QPointer<SteamConfigManager> m_steamConfigManager;
+    QPointer<HeroicConfigManager> m_heroicConfigManager;
+    QString m_sortBy = QStringLiteral("name");
+    QString m_cachePath;
+    bool m_cacheLoaded = false;
+    bool m_cacheDirty = false;
+    quint64 m_generation = 0;
+    int m_pending = 0;
+    QThreadPool m_pool;
+};
@@ -2,9 +2,17 @@
 // SPDX-FileCopyrightText: 2024 hikaps
 
 #include "GameLibrary.h"
+#include "StartupTrace.h"
+#include "Vdf.h"
 
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QSaveFile>
+#include <QSet>
 #include <QStandardPaths>
 #include <QJsonDocument>
 #include <QJsonArray>
@@ -14,6 +22,7 @@
 GameLibrary::GameLibrary(QObject *parent)
     : QObject(parent)
 {
+    StartupTrace::Scope trace("GameLibrary");
     loadGames();
 }
 
@@ -220,55 +229,213 @@ bool GameLibrary::createDesktopShortcut(const QString &gameName, const QString &
 
 QVariantList GameLibrary::getSteamGames() const
 {
-    QVariantList games;
-
-    // Try to find Steam library folders
-    QStringList steamPaths = {
+    // Every library of each Steam installation we know of
+    QStringList libraries;
+    const QStringList steamRoots = {
         QDir::homePath() + QStringLiteral("/.steam/steam"),
         QDir::homePath() + QStringLiteral("/.local/share/Steam"),
-        QStringLiteral("/run/media/mmcblk0p1/steamapps") // Steam Deck SD card
+        QDir::homePath() + QStringLiteral("/.var/app/com.valvesoftware.Steam/.local/share/Steam"),  // Flatpak
     };
-
-    for (const QString &steamPath : steamPaths) {
-        QString appsPath = steamPath + QStringLiteral("/steamapps");
-        QDir appsDir(appsPath);
-
-        if (!appsDir.exists()) {
+    for (const QString &root : steamRoots) {
+        if (!QFileInfo::exists(root)) {
             continue;
         }
+        libraries.append(root);
+        libraries.append(steamLibraryFolders(root + QStringLiteral("/config/libraryfolders.vdf")));
+        libraries.append(steamLibraryFolders(root + QStringLiteral("/steamapps/libraryfolders.vdf")));
+    }
+    libraries.append(QStringLiteral("/run/media/mmcblk0p1"));  // Steam Deck SD card
 
-        // Read appmanifest files
-        QStringList manifests = appsDir.entryList({QStringLiteral("appmanifest_*.acf")}, QDir::Files);
+    return scanSteamGames(libraries);
+}
 
-        for (const QString &manifest : manifests) {
-            QFile file(appsDir.absoluteFilePath(manifest));
-            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-                continue;
+QStringList GameLibrary::steamLibraryFolders(const QString &libraryFoldersVdf)
+{
+    QStringList folders;
+    VdfFile file(libraryFoldersVdf);
+    if (!file.isOpen()) {
+        return folders;
+    }
+
+    // "libraryfolders" { "0" { "path" "..." "apps" { ... } } ... }
+    // Older Steam: "LibraryFolders" { "1" "/path" ... }
+    TextVdfReader reader(file.data());
+    while (reader.next()) {
+        if (reader.type() == TextVdfReader::ObjectBegin && reader.depth() > 2) {
+            reader.skipObject();
+        } else if (reader.type() == TextVdfReader::Value) {
+            bool numeric = false;
+            reader.key().toInt(&numeric);
+            if ((reader.depth() == 2 && reader.key() == "path") || (reader.depth() == 1 && numeric)) {
+                folders.append(TextVdfReader::decode(reader.value()));
             }
+        }
+    }
+    return folders;
+}
+
+QString GameLibrary::steamManifestIndexPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/steam-manifests.json");
+}
+
+namespace {
 
-            QString content = QString::fromUtf8(file.readAll());
-            file.close();
+struct SteamManifest {
+    qint64 modified = 0;
+    qint64 size = -1;
+    QString appId;
+    QString name;
+    QString installDir;
+    qint64 sizeOnDisk = 0;
+    qint64 lastPlayed = 0;
+};
 
-            // Simple parsing of VDF format
-            QString appId;
-            QString name;
+SteamManifest parseSteamManifest(QByteArrayView data)
+{
+    // "AppState" { "appid" "..." "name" "..." ... }
+    SteamManifest manifest;
+    TextVdfReader reader(data);
+    while (reader.next()) {
+        if (reader.type() == TextVdfReader::ObjectBegin && reader.depth() > 1) {
+            reader.skipObject();
+        } else if (reader.type() == TextVdfReader::Value && reader.depth() == 1) {
+            const QByteArrayView key = reader.key();
+            if (key == "appid") {
+                manifest.appId = QString::fromLatin1(reader.value());
+            } else if (key == "name") {
+                manifest.name = TextVdfReader::decode(reader.value());
+            } else if (key == "installdir") {
+                manifest.installDir = TextVdfReader::decode(reader.value());
+            } else if (key == "SizeOnDisk") {
+                manifest.sizeOnDisk = reader.value().toLongLong();
+            } else if (key == "LastPlayed") {
+                manifest.lastPlayed = reader.value().toLongLong();
+            }
+        }
+    }
+    return manifest;
+}
 
-            QRegularExpression appIdRegex(QStringLiteral("\"appid\"\\s+\"(\\d+)\""));
-            QRegularExpression nameRegex(QStringLiteral("\"name\"\\s+\"([^\"]+)\""));
+} // namespace
 
-            QRegularExpressionMatch appIdMatch = appIdRegex.match(content);
-            QRegularExpressionMatch nameMatch = nameRegex.match(content);
+QVariantList GameLibrary::scanSteamGames(const QStringList &libraries, const QString &indexPath)
+{
+    // The GUI and GameCatalog's workers may scan at the same time
+    static QMutex indexMutex;
+    QMutexLocker locker(&indexMutex);
+
+    // Parsed manifests by path, reparsed only when their mtime or size changes
+    QHash<QString, SteamManifest> index;
+    if (!indexPath.isEmpty()) {
+        QFile file(indexPath);
+        if (file.open(QIODevice::ReadOnly)) {
+            const QJsonObject manifests = QJsonDocument::fromJson(file.readAll()).object()[QStringLiteral("manifests")].toObject();
+            index.reserve(manifests.size());
+            for (auto it = manifests.constBegin(); it != manifests.constEnd(); ++it) {
+                const QJsonObject obj = it.value().toObject();
+                SteamManifest manifest;
+                manifest.modified = obj[QStringLiteral("modified")].toInteger();
+                manifest.size = obj[QStringLiteral("size")].toInteger(-1);
+                manifest.appId = obj[QStringLiteral("appId")].toString();
+                manifest.name = obj[QStringLiteral("name")].toString();
+                manifest.installDir = obj[QStringLiteral("installDir")].toString();
+                manifest.sizeOnDisk = obj[QStringLiteral("sizeOnDisk")].toInteger();
+                manifest.lastPlayed = obj[QStringLiteral("lastPlayed")].toInteger();
+                index.insert(it.key(), manifest);
+            }
+        }
+    }
 
-            if (appIdMatch.hasMatch() && nameMatch.hasMatch()) {
-                appId = appIdMatch.captured(1);
-                name = nameMatch.captured(1);
+    QVariantList games;
+    QSet<QString> seenLibraries;
+    QSet<QString> seenApps;
+    QSet<QString> scanned;
+    bool dirty = false;
+
+    for (const QString &library : libraries) {
+        // ~/.steam/steam is usually a symlink to ~/.local/share/Steam
+        const QString appsPath = QFileInfo(library + QStringLiteral("/steamapps")).canonicalFilePath();
+        if (appsPath.isEmpty() || seenLibraries.contains(appsPath)) {
+            continue;
+        }
+        seenLibraries.insert(appsPath);
+
+        const QDir appsDir(appsPath);
+        const QFileInfoList manifests = appsDir.entryInfoList({QStringLiteral("appmanifest_*.acf")}, QDir::Files);
+        for (const QFileInfo &info : manifests) {
+            const QString path = info.absoluteFilePath();
+            scanned.insert(path);
+
+            const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+            auto entry = index.find(path);
+            if (entry == index.end() || entry->modified != modified || entry->size != info.size()) {
+                VdfFile file(path);
+                if (!file.isOpen()) {
+                    continue;
+                }
+                SteamManifest manifest = parseSteamManifest(file.data());
+                manifest.modified = modified;
+                manifest.size = info.size();
+                entry = index.insert(path, manifest);
+                dirty = true;
+            }
 
-                QVariantMap game;
-                game[QStringLiteral("name")] = name;
-                game[QStringLiteral("appId")] = appId;
-                game[QStringLiteral("command")] = QStringLiteral("steam://rungameid/%1").arg(appId);
-                games.append(game);
+            if (entry->appId.isEmpty() || entry->name.isEmpty() || seenApps.contains(entry->appId)) {
+                continue;
             }
+            seenApps.insert(entry->appId);
+
+            QVariantMap game;
+            game[QStringLiteral("name")] = entry->name;
+            game[QStringLiteral("appId")] = entry->appId;
+            game[QStringLiteral("command")] = QStringLiteral("steam://rungameid/%1").arg(entry->appId);
+            game[QStringLiteral("installPath")] = entry->installDir.isEmpty()
+                ? QString()
+                : appsPath + QStringLiteral("/common/") + entry->installDir;
+            game[QStringLiteral("installSize")] = entry->sizeOnDisk;
+            game[QStringLiteral("lastPlayed")] = entry->lastPlayed;
+            games.append(game);
+        }
+    }
+
+    if (indexPath.isEmpty()) {
+        return games;
+    }
+
+    // Drop manifests that were uninstalled; other callers' libraries stay
+    for (auto it = index.begin(); it != index.end();) {
+        if (!scanned.contains(it.key()) && !QFileInfo::exists(it.key())) {
+            it = index.erase(it);
+            dirty = true;
+        } else {
+            ++it;
+        }
+    }
+
+    if (dirty) {
+        QJsonObject manifests;
+        for (auto it = index.constBegin(); it != index.constEnd(); ++it) {
+            QJsonObject obj;
+            obj[QStringLiteral("modified")] = it->modified;
+            obj[QStringLiteral("size")] = it->size;
+            obj[QStringLiteral("appId")] = it->appId;
+            obj[QStringLiteral("name")] = it->name;
+            obj[QStringLiteral("installDir")] = it->installDir;
+            obj[QStringLiteral("sizeOnDisk")] = it->sizeOnDisk;
+            obj[QStringLiteral("lastPlayed")] = it->lastPlayed;
+            manifests[it.key()] = obj;
+        }
+        QJsonObject root;
+        root[QStringLiteral("manifests")] = manifests;
+
+        QDir().mkpath(QFileInfo(indexPath).absolutePath());
+        QSaveFile file(indexPath);
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+            file.commit();
+        } else {
+            qWarning() << "GameLibrary: failed to save Steam manifest index:" << indexPath;
         }
     }
 
@@ -57,10 +57,34 @@ public:
     Q_INVOKABLE bool createDesktopShortcut(const QString &gameName, const QString &profileName);
 
     /**
-     * @brief Get Steam games from Steam library (if Steam is installed)
+     * @brief Get Steam games from every library of the local Steam installations
+     *
+     * Libraries come from libraryfolders.vdf, so games on other drives are found too.
      */
     Q_INVOKABLE QVariantList getSteamGames() const;
 
+    /**
+     * @brief Installed games in the steamapps/ of each of @p libraries
+     *
+     * Parsed manifests are kept in @p indexPath by mtime and size, so only
+     * new or changed ones are read again; an empty path disables the index.
+     * Libraries reached twice through symlinks are scanned once. Only touches
+     * files, so it can run on a worker thread.
+     * @return Maps with "name", "appId", "command", "installPath",
+     * "installSize" (bytes) and "lastPlayed" (seconds since the epoch)
+     */
+    static QVariantList scanSteamGames(const QStringList &libraries, const QString &indexPath = steamManifestIndexPath());
+
+    /**
+     * @brief Library folders listed in a libraryfolders.vdf
+     */
+    static QStringList steamLibraryFolders(const QString &libraryFoldersVdf);
+
+    /**
+     * @brief Default location of the manifest index, ~/.cache/couchplay/steam-manifests.json
+     */
+    static QString steamManifestIndexPath();
+
     QVariantList gamesAsVariant() const;
 
 Q_SIGNALS:
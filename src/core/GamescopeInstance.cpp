@@ -2,19 +2,51 @@
 // SPDX-FileCopyrightText: 2025 CouchPlay Contributors
 
 #include "GamescopeInstance.h"
+#include "ProcessExitWatcher.h"
+#include "../dbus/CouchPlayHelperClient.h"
 
 #include <QDBusConnection>
 #include <QDBusInterface>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDBusReply>
 #include <QDir>
 #include <QFile>
+#include <QTimer>
 
 #include <pwd.h>
 #include <unistd.h>
 
+namespace {
+
+// Plain method call, so nothing introspects the helper on the GUI thread
+QDBusPendingCall callHelperAsync(const QString &method, const QVariantList &arguments)
+{
+    QDBusMessage msg = QDBusMessage::createMethodCall(
+        QStringLiteral("io.github.hikaps.CouchPlayHelper"),
+        QStringLiteral("/io/github/hikaps/CouchPlayHelper"),
+        QStringLiteral("io.github.hikaps.CouchPlayHelper"),
+        method
+    );
+    msg.setArguments(arguments);
+    return QDBusConnection::systemBus().asyncCall(msg);
+}
+
+} // namespace
+
 GamescopeInstance::GamescopeInstance(QObject *parent)
     : QObject(parent)
+    , m_exitWatcher(new ProcessExitWatcher(this))
+    , m_stopTimer(new QTimer(this))
 {
+    m_stopTimer->setSingleShot(true);
+    connect(m_stopTimer, &QTimer::timeout, this, &GamescopeInstance::onStopTimeout);
+    connect(m_exitWatcher, &ProcessExitWatcher::exited, this, [this]() {
+        if (m_stopping) {
+            finishStop();
+        }
+    });
 }
 
 GamescopeInstance::~GamescopeInstance()
@@ -24,114 +56,215 @@ GamescopeInstance::~GamescopeInstance()
 
 bool GamescopeInstance::start(const QVariantMap &config, int index)
 {
-    if (m_helperPid > 0 || (m_process && m_process->state() != QProcess::NotRunning)) {
+    if (m_launching || m_helperPid > 0 || (m_process && m_process->state() != QProcess::NotRunning)) {
         Q_EMIT errorOccurred(QStringLiteral("Instance already running"));
         return false;
     }
 
-    m_index = index;
-    m_username = config.value(QStringLiteral("username")).toString();
-
-    // Store window geometry for UI display
-    int posX = config.value(QStringLiteral("positionX"), 0).toInt();
-    int posY = config.value(QStringLiteral("positionY"), 0).toInt();
-    int outputW = config.value(QStringLiteral("outputWidth"), 960).toInt();
-    int outputH = config.value(QStringLiteral("outputHeight"), 1080).toInt();
-    m_windowGeometry = QRect(posX, posY, outputW, outputH);
-    Q_EMIT configChanged();
+    applyConfig(config, index);
 
-    // Build gamescope arguments
-    QStringList gamescopeArgs = buildGamescopeArgs(config);
-
-    // Build environment
-    QStringList envVars = buildEnvironment(config);
+    QStringList gamescopeArgs;
+    QStringList envVars;
+    QString gameCommand;
+    launchCommandLine(config, gamescopeArgs, envVars, gameCommand);
 
-    // Get preset command from SessionRunner (resolved from PresetManager)
-    // Fallback to Steam Big Picture if no preset command provided
-    QString gameCommand = config.value(QStringLiteral("presetCommand")).toString();
-    QString workingDirectory = config.value(QStringLiteral("presetWorkingDirectory")).toString();
-    
-    if (gameCommand.isEmpty()) {
-        // Fallback to Steam Big Picture if no preset configured
-        gameCommand = QStringLiteral("steam -tenfoot -steamdeck");
-    }
-    
     // Verify we have a command to run
     if (gameCommand.isEmpty()) {
         Q_EMIT errorOccurred(QStringLiteral("No game command configured"));
         return false;
     }
 
-    // Create process
-    m_process = new QProcess(this);
+    // All instances go through the D-Bus helper service, which provides
+    // uniform handling for all users, including the compositor user.
+    // compositorUid is the UID of the user running CouchPlay (owns the Wayland socket)
+    m_launching = true;
+    const quint64 generation = ++m_launchGeneration;
+    setStatus(QStringLiteral("Launching..."));
+
+    const QVariantMap resources = config.value(QStringLiteral("resources")).toMap();
+    auto *watcher = new QDBusPendingCallWatcher(
+        callHelperAsync(QStringLiteral("LaunchInstance"),
+                        {m_username, static_cast<uint>(getuid()), gamescopeArgs, gameCommand, envVars}),
+        this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this,
+            [this, generation, resources](QDBusPendingCallWatcher *call) {
+        call->deleteLater();
+        QDBusPendingReply<qint64> reply = *call;
+        const qint64 pid = reply.isError() ? 0 : reply.value();
+
+        if (generation != m_launchGeneration) {
+            // Stopped while launching
+            if (pid > 0) {
+                callHelperAsync(QStringLiteral("StopInstance"), {pid});
+            }
+            return;
+        }
+        m_launching = false;
+
+        if (reply.isError()) {
+            qWarning() << "Instance" << m_index << "helper LaunchInstance failed:" << reply.error().message();
+            setStatus(QStringLiteral("Failed to launch"));
+            if (reply.error().type() == QDBusError::ServiceUnknown) {
+                Q_EMIT errorOccurred(QStringLiteral("CouchPlay Helper service is not available. Please run: sudo ./scripts/install-helper.sh install"));
+            } else {
+                Q_EMIT errorOccurred(QStringLiteral("Failed to launch instance: %1").arg(reply.error().message()));
+            }
+            return;
+        }
+        if (pid <= 0) {
+            qWarning() << "Instance" << m_index << "helper returned PID 0";
+            setStatus(QStringLiteral("Failed to launch"));
+            Q_EMIT errorOccurred(QStringLiteral("Helper service failed to launch instance"));
+            return;
+        }
 
-    connect(m_process, &QProcess::started, this, &GamescopeInstance::onProcessStarted);
-    connect(m_process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            this, &GamescopeInstance::onProcessFinished);
-    connect(m_process, &QProcess::errorOccurred, this, &GamescopeInstance::onProcessError);
-    connect(m_process, &QProcess::readyReadStandardOutput, this, &GamescopeInstance::onReadyReadStandardOutput);
-    connect(m_process, &QProcess::readyReadStandardError, this, &GamescopeInstance::onReadyReadStandardError);
+        m_helperPid = pid;
+        setStatus(QStringLiteral("Running as %1").arg(m_username));
+        subscribeHelperExits();
+        applyResources(resources);
 
-    // All instances go through the D-Bus helper service
-    // This provides uniform handling for all users, including the compositor user
-    
-    // Use the D-Bus helper to launch the instance
-    QDBusInterface helper(
+        // Signal running right away since helper-launched instances don't use QProcess signals
+        Q_EMIT runningChanged();
+        Q_EMIT started();
+    });
+
+    return true;
+}
+
+void GamescopeInstance::launchCommandLine(const QVariantMap &config, QStringList &gamescopeArgs,
+                                          QStringList &environment, QString &gameCommand)
+{
+    // A resumed LaunchPlan brings the command line it was recorded with
+    if (config.contains(QStringLiteral("launchArgs"))) {
+        gamescopeArgs = config.value(QStringLiteral("launchArgs")).toStringList();
+        environment = config.value(QStringLiteral("launchEnvironment")).toStringList();
+        gameCommand = config.value(QStringLiteral("launchCommand")).toString();
+        return;
+    }
+    gamescopeArgs = buildGamescopeArgs(config);
+    environment = buildEnvironment(config);
+    gameCommand = buildGameCommand(config);
+}
+
+void GamescopeInstance::applyResources(const QVariantMap &resources)
+{
+    if (m_helperPid <= 0 || resources.isEmpty()) {
+        return;
+    }
+
+    auto *watcher = new QDBusPendingCallWatcher(
+        callHelperAsync(QStringLiteral("SetInstanceResources"), {m_helperPid, resources}), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *call) {
+        QDBusPendingReply<bool> reply = *call;
+        if (reply.isError()) {
+            qWarning() << "Instance" << m_index << "resource controls not applied:" << reply.error().message();
+        }
+        call->deleteLater();
+    });
+}
+
+bool GamescopeInstance::attach(const QVariantMap &config, int index, qint64 helperPid)
+{
+    if (m_launching || m_helperPid > 0 || (m_process && m_process->state() != QProcess::NotRunning)) {
+        Q_EMIT errorOccurred(QStringLiteral("Instance already running"));
+        return false;
+    }
+    if (helperPid <= 0) {
+        return false;
+    }
+
+    applyConfig(config, index);
+    m_helperPid = helperPid;
+    setStatus(QStringLiteral("Running as %1").arg(m_username));
+    subscribeHelperExits();
+
+    Q_EMIT runningChanged();
+    Q_EMIT started();
+    return true;
+}
+
+void GamescopeInstance::subscribeHelperExits()
+{
+    if (m_helperExitsSubscribed) {
+        return;
+    }
+    m_helperExitsSubscribed = QDBusConnection::systemBus().connect(
         QStringLiteral("io.github.hikaps.CouchPlayHelper"),
         QStringLiteral("/io/github/hikaps/CouchPlayHelper"),
         QStringLiteral("io.github.hikaps.CouchPlayHelper"),
-        QDBusConnection::systemBus()
-    );
-    
-    if (!helper.isValid()) {
-        qWarning() << "Instance" << m_index << "helper service not available";
-        Q_EMIT errorOccurred(QStringLiteral("CouchPlay Helper service is not available. Please run: sudo ./scripts/install-helper.sh install"));
-        m_process->deleteLater();
-        m_process = nullptr;
-        return false;
+        QStringLiteral("InstanceExited"), this, SLOT(onHelperInstanceExited(qint64,int,qint64)));
+}
+
+void GamescopeInstance::onHelperInstanceExited(qint64 pid, int status, qint64 runtimeMs)
+{
+    if (pid != m_helperPid || m_helperPid <= 0) {
+        return;
     }
-    
-    // Use the helper service to launch the instance
-    // compositorUid is the UID of the user running CouchPlay (owns the Wayland socket)
-    uid_t compositorUid = getuid();
-    
-    QDBusReply<qint64> reply = helper.call(
-        QStringLiteral("LaunchInstance"),
-        m_username,
-        static_cast<uint>(compositorUid),
-        gamescopeArgs,
-        gameCommand,
-        envVars
-    );
-    
-    if (!reply.isValid()) {
-        qWarning() << "Instance" << m_index << "helper LaunchInstance failed:" << reply.error().message();
-        Q_EMIT errorOccurred(QStringLiteral("Failed to launch instance: %1").arg(reply.error().message()));
-        m_process->deleteLater();
-        m_process = nullptr;
-        return false;
+    if (m_stopping) {
+        finishStop();
+        return;
     }
-    
-    m_helperPid = reply.value();
-    if (m_helperPid == 0) {
-        qWarning() << "Instance" << m_index << "helper returned PID 0";
-        Q_EMIT errorOccurred(QStringLiteral("Helper service failed to launch instance"));
+
+    qDebug() << "Instance" << m_index << "exited with status" << status << "after" << runtimeMs << "ms";
+    m_helperPid = 0;
+    if (m_process) {
+        disconnect(m_process, nullptr, this, nullptr);
         m_process->deleteLater();
         m_process = nullptr;
-        return false;
     }
-    
-    setStatus(QStringLiteral("Running as %1").arg(m_username));
-    
-    // Signal running immediately since helper-launched instances don't use QProcess signals
+
+    // -1: the helper couldn't read the status
+    if (status < 0 || status == 0) {
+        setStatus(QStringLiteral("Exited normally"));
+    } else if (status > 128) {
+        setStatus(QStringLiteral("Crashed (signal %1)").arg(status - 128));
+    } else {
+        setStatus(QStringLiteral("Exited (code %1)").arg(status));
+    }
     Q_EMIT runningChanged();
-    Q_EMIT started();
+    Q_EMIT stopped();
+}
 
-    return true;
+void GamescopeInstance::applyConfig(const QVariantMap &config, int index)
+{
+    m_index = index;
+    m_username = config.value(QStringLiteral("username")).toString();
+
+    // Store window geometry for UI display
+    int posX = config.value(QStringLiteral("positionX"), 0).toInt();
+    int posY = config.value(QStringLiteral("positionY"), 0).toInt();
+    int outputW = config.value(QStringLiteral("outputWidth"), 960).toInt();
+    int outputH = config.value(QStringLiteral("outputHeight"), 1080).toInt();
+    m_windowGeometry = QRect(posX, posY, outputW, outputH);
+    m_internalSize = QSize(config.value(QStringLiteral("internalWidth"), 1920).toInt(),
+                           config.value(QStringLiteral("internalHeight"), 1080).toInt());
+    Q_EMIT configChanged();
+}
+
+void GamescopeInstance::setWindowGeometry(const QRect &geometry)
+{
+    if (m_windowGeometry != geometry) {
+        m_windowGeometry = geometry;
+        Q_EMIT configChanged();
+    }
+}
+
+QString GamescopeInstance::buildGameCommand(const QVariantMap &config)
+{
+    // Fallback to Steam Big Picture if no preset command provided
+    QString gameCommand = config.value(QStringLiteral("presetCommand")).toString();
+    if (gameCommand.isEmpty()) {
+        gameCommand = QStringLiteral("steam -tenfoot -steamdeck");
+    }
+    return gameCommand;
 }
 
 void GamescopeInstance::stop(int timeoutMs)
 {
+    // Takes over from a pending stopAsync()
+    cancelStopAsync();
+    cancelLaunch();
+
     // Handle helper-launched instances
     if (m_helperPid > 0) {
         setStatus(QStringLiteral("Stopping..."));
@@ -182,8 +315,123 @@ void GamescopeInstance::stop(int timeoutMs)
     Q_EMIT stopped();
 }
 
+void GamescopeInstance::stopAsync(int timeoutMs)
+{
+    if (m_stopping) {
+        return;
+    }
+    if (!isRunning()) {
+        // Nothing to wait for; tidies up a finished process
+        stop();
+        return;
+    }
+
+    m_stopping = true;
+    m_killSent = false;
+    setStatus(QStringLiteral("Stopping..."));
+
+    if (m_helperPid > 0) {
+        // Open the pidfd before signalling, so the exit can't be missed and
+        // a recycled PID can't be mistaken for the instance
+        const qint64 pid = m_helperPid;
+        if (!m_exitWatcher->watch(static_cast<pid_t>(pid))) {
+            // Can't observe the exit; report it once the helper has signalled
+            qWarning() << "Instance" << m_index << "exit can't be watched, not waiting for it";
+            CouchPlayHelperClient::callAuthorized([pid]() {
+                return callHelperAsync(QStringLiteral("StopInstance"), {pid});
+            }, this, [this](const QDBusPendingCall &) {
+                if (m_stopping) {
+                    finishStop();
+                }
+            });
+            return;
+        }
+
+        // Retried after re-authorizing, so a lapsed session grant can't leave it running
+        CouchPlayHelperClient::callAuthorized([pid]() {
+            return callHelperAsync(QStringLiteral("StopInstance"), {pid});
+        }, this, [this, pid](const QDBusPendingCall &call) {
+            const QDBusPendingReply<bool> reply = call;
+            if ((reply.isError() || !reply.value()) && m_stopping && m_helperPid == pid && !m_killSent) {
+                qWarning() << "Instance" << m_index << "helper StopInstance failed, trying KillInstance";
+                m_killSent = true;
+                CouchPlayHelperClient::callAuthorized([pid]() {
+                    return callHelperAsync(QStringLiteral("KillInstance"), {pid});
+                }, this);
+            }
+        });
+    } else {
+        m_process->terminate();
+    }
+
+    m_stopTimer->start(timeoutMs);
+}
+
+void GamescopeInstance::onStopTimeout()
+{
+    if (!m_stopping) {
+        return;
+    }
+
+    if (m_killSent) {
+        // Stuck in the kernel (or the helper lost it); don't hold up teardown
+        qWarning() << "Instance" << m_index << "still running" << KILL_GRACE_MS << "ms after SIGKILL, giving up on it";
+        finishStop();
+        return;
+    }
+
+    qWarning() << "Instance" << m_index << "did not stop gracefully, killing...";
+    m_killSent = true;
+    if (m_helperPid > 0) {
+        const qint64 pid = m_helperPid;
+        CouchPlayHelperClient::callAuthorized([pid]() {
+            return callHelperAsync(QStringLiteral("KillInstance"), {pid});
+        }, this);
+    } else if (m_process) {
+        m_process->kill();
+    }
+    m_stopTimer->start(KILL_GRACE_MS);
+}
+
+void GamescopeInstance::cancelStopAsync()
+{
+    m_stopTimer->stop();
+    m_exitWatcher->stop();
+    m_stopping = false;
+    m_killSent = false;
+}
+
+void GamescopeInstance::cancelLaunch()
+{
+    if (m_launching) {
+        // The LaunchInstance reply stops whatever it launched
+        ++m_launchGeneration;
+        m_launching = false;
+        setStatus(QStringLiteral("Stopped"));
+    }
+}
+
+void GamescopeInstance::finishStop()
+{
+    cancelStopAsync();
+    m_helperPid = 0;
+
+    if (m_process) {
+        disconnect(m_process, nullptr, this, nullptr);
+        m_process->deleteLater();
+        m_process = nullptr;
+    }
+
+    setStatus(QStringLiteral("Stopped"));
+    Q_EMIT runningChanged();
+    Q_EMIT stopped();
+}
+
 void GamescopeInstance::kill()
 {
+    cancelStopAsync();
+    cancelLaunch();
+
     // Handle helper-launched instances
     if (m_helperPid > 0) {
         setStatus(QStringLiteral("Killing..."));
@@ -280,6 +528,12 @@ QStringList GamescopeInstance::buildGamescopeArgs(const QVariantMap &config)
         args << QStringLiteral("-r") << QString::number(refreshRate);
     }
 
+    // Frame rate cap, so one uncapped game can't take the whole GPU
+    const int frameLimit = config.value(QStringLiteral("frameLimit"), 0).toInt();
+    if (frameLimit > 0) {
+        args << QStringLiteral("--framerate-limit") << QString::number(frameLimit);
+    }
+
     // Scaling mode: auto, integer, fit, fill, stretch
     QString scalingMode = config.value(QStringLiteral("scalingMode"), QStringLiteral("fit")).toString();
     if (!scalingMode.isEmpty() && scalingMode != QStringLiteral("auto")) {
@@ -308,6 +562,18 @@ QStringList GamescopeInstance::buildGamescopeArgs(const QVariantMap &config)
         args << QStringLiteral("--prefer-output") << monitorName;
     }
 
+    // GPU the instance composites on, see GpuTopology
+    const QString gpuDevice = config.value(QStringLiteral("gpuDevice")).toString();
+    if (!gpuDevice.isEmpty()) {
+        args << QStringLiteral("--prefer-vk-device") << gpuDevice;
+    }
+
+    // Frame statistics for InstanceTelemetry
+    const QString statsPath = config.value(QStringLiteral("statsPath")).toString();
+    if (!statsPath.isEmpty()) {
+        args << QStringLiteral("--stats-path") << statsPath;
+    }
+
     // NOTE: Input device isolation is handled via device ownership (chown/chmod),
     // NOT via gamescope flags. The --input-device flag doesn't exist in gamescope,
     // and --grab only grabs the keyboard, not gamepads/controllers.
@@ -319,8 +585,6 @@ QStringList GamescopeInstance::buildGamescopeArgs(const QVariantMap &config)
 
 QStringList GamescopeInstance::buildEnvironment(const QVariantMap &config)
 {
-    Q_UNUSED(config)
-    
     QStringList envVars;
     
     // Enable Gamescope WSI layer - critical for Vulkan games to work inside gamescope
@@ -338,6 +602,37 @@ QStringList GamescopeInstance::buildEnvironment(const QVariantMap &config)
     
     // Force GTK applications to use XDG portals for file dialogs
     envVars << QStringLiteral("GTK_USE_PORTAL=1");
+
+    // Cap D3D games in the translation layer too: it stops them before
+    // rendering the frame rather than blocking them in gamescope's present
+    const int frameLimit = config.value(QStringLiteral("frameLimit"), 0).toInt();
+    if (frameLimit > 0) {
+        envVars << QStringLiteral("DXVK_FRAME_RATE=%1").arg(frameLimit);
+        envVars << QStringLiteral("VKD3D_FRAME_RATE=%1").arg(frameLimit);
+    }
+
+    // Per-player sink: PulseAudio clients and native PipeWire streams both target it
+    const QString audioSink = config.value(QStringLiteral("audioSink")).toString();
+    if (!audioSink.isEmpty()) {
+        envVars << QStringLiteral("PULSE_SINK=%1").arg(audioSink);
+        envVars << QStringLiteral("PIPEWIRE_NODE=%1").arg(audioSink);
+    }
+
+    // Games render on the instance's GPU too: DRI_PRIME for GL and as
+    // fallback for Vulkan, MESA_VK_DEVICE_SELECT only if it is unambiguous
+    const QString gpuPrime = config.value(QStringLiteral("gpuPrime")).toString();
+    if (!gpuPrime.isEmpty()) {
+        envVars << QStringLiteral("DRI_PRIME=%1").arg(gpuPrime);
+    }
+    const QString gpuDevice = config.value(QStringLiteral("gpuDevice")).toString();
+    if (!gpuDevice.isEmpty() && !config.value(QStringLiteral("gpuTwin")).toBool()) {
+        envVars << QStringLiteral("MESA_VK_DEVICE_SELECT=%1").arg(gpuDevice);
+    }
+
+    // The helper tags the instance's journal entries with it
+    if (config.contains(QStringLiteral("instanceIndex"))) {
+        envVars << QStringLiteral("COUCHPLAY_INSTANCE=%1").arg(config.value(QStringLiteral("instanceIndex")).toInt());
+    }
     
     return envVars;
 }
@@ -351,6 +646,11 @@ void GamescopeInstance::onProcessStarted()
 
 void GamescopeInstance::onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus)
 {
+    if (m_stopping) {
+        finishStop();
+        return;
+    }
+
     QString statusStr;
     if (exitStatus == QProcess::CrashExit) {
         statusStr = QStringLiteral("Crashed (code %1)").arg(exitCode);
@@ -392,19 +692,3 @@ void GamescopeInstance::onProcessError(QProcess::ProcessError error)
     Q_EMIT errorOccurred(errorMsg);
     qWarning() << "Instance" << m_index << "error:" << errorMsg;
 }
-
-void GamescopeInstance::onReadyReadStandardOutput()
-{
-    QString output = QString::fromUtf8(m_process->readAllStandardOutput());
-    if (!output.trimmed().isEmpty()) {
-        Q_EMIT outputReceived(output);
-    }
-}
-
-void GamescopeInstance::onReadyReadStandardError()
-{
-    QString output = QString::fromUtf8(m_process->readAllStandardError());
-    if (!output.trimmed().isEmpty()) {
-        Q_EMIT outputReceived(QStringLiteral("[stderr] ") + output);
-    }
-}
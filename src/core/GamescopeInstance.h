@@ -9,9 +9,12 @@
 #include <QStringList>
 #include <QList>
 #include <QRect>
+#include <QSize>
 #include <QVariantMap>
 #include <qqmlintegration.h>
 
+class ProcessExitWatcher;
+class QTimer;
 struct InstanceConfig;
 
 /**
@@ -50,27 +53,67 @@ public:
      *   - filterMode: linear, nearest, FSR, NIS
      *   - monitor: Monitor index for multi-monitor
      *   - positionX/Y: Window position for split-screen
+     *   - gpuDevice/gpuPrime/gpuTwin: GPU to use, see GpuTopology::Gpu
      *   - devicePaths: List of /dev/input/eventN paths for input isolation
      *   - executablePath: Path to game executable (.exe or native binary)
      *   - protonPath: Path to Proton installation (for Windows games)
      *   - prefixPath: Path to Wine/Proton prefix (WINEPREFIX/STEAM_COMPAT_DATA_PATH)
      *   - workingDirectory: Working directory for the game (optional)
+     *   - launchArgs/launchEnvironment/launchCommand: Command line to use
+     *     as is instead of building it (see LaunchPlan::Instance::launchConfig())
      * @param index Instance index (0 = primary, 1+ = secondary)
-     * @return true if started successfully
+     * @return Whether the launch was sent to the helper; started() or
+     *         errorOccurred() follows once it has answered
      */
     Q_INVOKABLE bool start(const QVariantMap &config, int index);
 
+    /**
+     * @brief Take over an instance the helper has already launched
+     *
+     * Used for instances started ahead of time by the helper's
+     * PrepareInstance (warm standby). Emits started() like start().
+     *
+     * @param config Configuration the instance was launched with
+     * @param index Instance index
+     * @param helperPid PID returned by the helper
+     */
+    bool attach(const QVariantMap &config, int index, qint64 helperPid);
+
+    /**
+     * @brief Apply cgroup resource controls to the running instance
+     *
+     * @p resources uses the keys of the helper's SetInstanceResources
+     * ("cpuWeight", "cpuCores", "ioWeight", "memoryHighMb"). Asynchronous;
+     * failures are only logged since the instance runs fine without them.
+     */
+    void applyResources(const QVariantMap &resources);
+
     /**
      * @brief Stop the gamescope instance gracefully
      * @param timeoutMs Timeout before force kill (default 5000ms)
      */
     Q_INVOKABLE void stop(int timeoutMs = 5000);
 
+    /**
+     * @brief Ask the instance to exit without waiting for it
+     *
+     * Sends SIGTERM (through the helper for helper-launched instances) and
+     * returns. stopped() fires once the process has exited; if it is still
+     * there after @p timeoutMs it is killed, and given KILL_GRACE_MS more.
+     * Exits of helper-launched instances are observed through a pidfd.
+     */
+    void stopAsync(int timeoutMs = 5000);
+
     /**
      * @brief Force kill the gamescope instance
      */
     Q_INVOKABLE void kill();
 
+    /**
+     * @brief Whether stopAsync() is waiting for the process to exit
+     */
+    bool isStopping() const { return m_stopping; }
+
     /**
      * @brief Check if instance is running
      */
@@ -83,6 +126,19 @@ public:
     QString username() const { return m_username; }
     QRect windowGeometry() const { return m_windowGeometry; }
 
+    /**
+     * @brief Resolution games render at (gamescope's -w/-h)
+     */
+    QSize internalSize() const { return m_internalSize; }
+
+    /**
+     * @brief Record that the window was moved to @p geometry
+     *
+     * A nested gamescope follows its window's size, so a live re-layout
+     * only has to move the window; the command line is left as it was.
+     */
+    void setWindowGeometry(const QRect &geometry);
+
     /**
      * @brief Build gamescope command line arguments from config
      * @param config Configuration map
@@ -97,6 +153,20 @@ public:
      */
     static QStringList buildEnvironment(const QVariantMap &config);
 
+    /**
+     * @brief Command run inside gamescope, Steam Big Picture if none is configured
+     */
+    static QString buildGameCommand(const QVariantMap &config);
+
+    /**
+     * @brief What start() hands the helper for @p config
+     *
+     * The recorded command line of a resumed LaunchPlan, otherwise
+     * buildGamescopeArgs(), buildEnvironment() and buildGameCommand().
+     */
+    static void launchCommandLine(const QVariantMap &config, QStringList &gamescopeArgs,
+                                  QStringList &environment, QString &gameCommand);
+
 Q_SIGNALS:
     void runningChanged();
     void statusChanged();
@@ -104,22 +174,38 @@ Q_SIGNALS:
     void started();
     void stopped();
     void errorOccurred(const QString &message);
-    void outputReceived(const QString &output);
 
 private Q_SLOTS:
     void onProcessStarted();
     void onProcessFinished(int exitCode, QProcess::ExitStatus exitStatus);
     void onProcessError(QProcess::ProcessError error);
-    void onReadyReadStandardOutput();
-    void onReadyReadStandardError();
+    void onHelperInstanceExited(qint64 pid, int status, qint64 runtimeMs);
 
 private:
     void setStatus(const QString &status);
+    void applyConfig(const QVariantMap &config, int index);
+    void onStopTimeout();
+    void cancelStopAsync();
+    // Forgets a start() the helper hasn't answered yet
+    void cancelLaunch();
+    void finishStop();
+    // Learn about helper-launched instances exiting on their own
+    void subscribeHelperExits();
+
+    static constexpr int KILL_GRACE_MS = 2000;
 
     QProcess *m_process = nullptr;
+    ProcessExitWatcher *m_exitWatcher = nullptr;
+    QTimer *m_stopTimer = nullptr;
+    bool m_stopping = false;
+    bool m_killSent = false;
+    bool m_launching = false;      // start() waits for LaunchInstance
+    quint64 m_launchGeneration = 0; // Bumped by cancelLaunch(), so a late reply is stopped
+    bool m_helperExitsSubscribed = false;
     int m_index = -1;
     QString m_status;
     QString m_username;
     QRect m_windowGeometry;
+    QSize m_internalSize;
     qint64 m_helperPid = 0;        // PID from helper service
 };
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "GpuTopology.h"
+#include "UserDirectory.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+#include <sys/stat.h>
+
+const QString GpuTopology::AUTO = QStringLiteral("auto");
+
+namespace {
+
+QString readSysfs(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? QString::fromLatin1(file.readAll().trimmed()) : QString();
+}
+
+// "0x1002" -> "1002"
+QString pciId(const QString &value)
+{
+    return value.startsWith(QLatin1String("0x")) ? value.mid(2).toLower() : value.toLower();
+}
+
+QString vendorName(const QString &vendorId)
+{
+    if (vendorId == QLatin1String("1002")) {
+        return QStringLiteral("AMD");
+    }
+    if (vendorId == QLatin1String("10de")) {
+        return QStringLiteral("NVIDIA");
+    }
+    if (vendorId == QLatin1String("8086")) {
+        return QStringLiteral("Intel");
+    }
+    return vendorId;
+}
+
+} // namespace
+
+QString GpuTopology::Gpu::primeTag() const
+{
+    QString tag = pciAddress;
+    tag.replace(QLatin1Char(':'), QLatin1Char('_')).replace(QLatin1Char('.'), QLatin1Char('_'));
+    return QStringLiteral("pci-") + tag;
+}
+
+QList<GpuTopology::Gpu> GpuTopology::enumerate(const QString &drmRoot, const QString &devRoot)
+{
+    static const QRegularExpression cardPattern(QStringLiteral("^card\\d+$"));
+
+    QList<Gpu> gpus;
+    const QStringList cards = QDir(drmRoot).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &card : cards) {
+        if (!cardPattern.match(card).hasMatch()) {
+            continue;  // Connectors and render nodes
+        }
+
+        // The render node is listed next to the card under its device
+        const QString device = QStringLiteral("%1/%2/device").arg(drmRoot, card);
+        const QStringList renderNodes = QDir(device + QStringLiteral("/drm"))
+                                            .entryList({QStringLiteral("renderD*")}, QDir::Dirs | QDir::NoDotAndDotDot);
+        Gpu gpu;
+        gpu.vendorId = pciId(readSysfs(device + QStringLiteral("/vendor")));
+        gpu.deviceId = pciId(readSysfs(device + QStringLiteral("/device")));
+        if (renderNodes.isEmpty() || gpu.vendorId.isEmpty()) {
+            continue;  // Display-only (simpledrm, USB displays)
+        }
+        gpu.pciAddress = QFileInfo(QFileInfo(device).canonicalFilePath()).fileName();
+        gpu.renderNode = devRoot + QLatin1Char('/') + renderNodes.constFirst();
+        gpu.name = vendorName(gpu.vendorId) + QLatin1Char(' ') + gpu.deviceId;
+        gpu.gpuClass = RenderBudget::classify(device);
+        gpu.bootVga = readSysfs(device + QStringLiteral("/boot_vga")) == QLatin1String("1");
+        gpus.append(gpu);
+    }
+
+    std::stable_sort(gpus.begin(), gpus.end(), [](const Gpu &a, const Gpu &b) {
+        const bool aDiscrete = a.gpuClass == RenderBudget::GpuClass::Discrete;
+        const bool bDiscrete = b.gpuClass == RenderBudget::GpuClass::Discrete;
+        return aDiscrete != bDiscrete ? aDiscrete : a.pciAddress < b.pciAddress;
+    });
+    return gpus;
+}
+
+int GpuTopology::indexOf(const QList<Gpu> &gpus, const QString &pciAddress)
+{
+    for (qsizetype i = 0; i < gpus.size(); ++i) {
+        if (gpus.at(i).pciAddress == pciAddress) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+bool GpuTopology::hasTwin(const QList<Gpu> &gpus, const Gpu &gpu)
+{
+    return std::any_of(gpus.cbegin(), gpus.cend(), [&gpu](const Gpu &other) {
+        return other.pciAddress != gpu.pciAddress && other.vkDevice() == gpu.vkDevice();
+    });
+}
+
+bool GpuTopology::canAccess(const QString &node, const UserEntry &user)
+{
+    struct stat st;
+    if (::stat(QFile::encodeName(node).constData(), &st) != 0) {
+        return false;
+    }
+    if (user.uid == 0) {
+        return true;
+    }
+    if (st.st_uid == user.uid) {
+        return (st.st_mode & (S_IRUSR | S_IWUSR)) == (S_IRUSR | S_IWUSR);
+    }
+    if (user.groups.contains(st.st_gid) || user.gid == st.st_gid) {
+        return (st.st_mode & (S_IRGRP | S_IWGRP)) == (S_IRGRP | S_IWGRP);
+    }
+    return (st.st_mode & (S_IROTH | S_IWOTH)) == (S_IROTH | S_IWOTH);
+}
+
+QStringList GpuTopology::balance(const QList<Gpu> &gpus, const QStringList &requested, const QList<double> &loads,
+                                 const std::function<bool(int, const Gpu &)> &usable)
+{
+    QStringList placement(requested.size());
+    if (gpus.size() < 2) {
+        return placement;
+    }
+
+    QList<double> used(gpus.size(), 0.0);
+    QList<int> pending;
+    for (qsizetype i = 0; i < requested.size(); ++i) {
+        const QString &gpu = requested.at(i);
+        if (gpu.isEmpty()) {
+            continue;
+        }
+        const int pinned = gpu == AUTO ? -1 : indexOf(gpus, gpu);
+        if (pinned >= 0) {
+            placement[i] = gpu;
+            used[pinned] += loads.value(i);
+        } else {
+            pending.append(int(i));
+        }
+    }
+
+    // Heaviest first, so the small ones fill in around them
+    std::stable_sort(pending.begin(), pending.end(), [&loads](int a, int b) {
+        return loads.value(a) > loads.value(b);
+    });
+    for (int i : std::as_const(pending)) {
+        int best = -1;
+        double bestShare = 0.0;
+        for (qsizetype g = 0; g < gpus.size(); ++g) {
+            if (usable && !usable(i, gpus.at(g))) {
+                continue;
+            }
+            const double share = (used.at(g) + loads.value(i)) / qMax(1, gpus.at(g).budget());
+            if (best < 0 || share < bestShare) {
+                best = int(g);
+                bestShare = share;
+            }
+        }
+        if (best >= 0) {
+            placement[i] = gpus.at(best).pciAddress;
+            used[best] += loads.value(i);
+        }
+    }
+    return placement;
+}
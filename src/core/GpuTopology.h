@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include "RenderBudget.h"
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+struct UserEntry;
+
+/**
+ * @brief The system's GPUs, and which player renders on which
+ *
+ * A GPU is a DRM card with a render node. It is identified by its PCI
+ * address, which stays the same across boots while card and renderD
+ * numbers don't. An instance is pointed at one with gamescope's
+ * --prefer-vk-device (PCI vendor:device), MESA_VK_DEVICE_SELECT (the same)
+ * and DRI_PRIME (the PCI address, which also tells identical cards apart).
+ *
+ * An instance's "gpu" is empty for the system default, AUTO to be placed
+ * by balance(), or the PCI address of the card it is pinned to.
+ */
+class GpuTopology
+{
+public:
+    static const QString AUTO;  // "auto"
+
+    struct Gpu {
+        QString pciAddress;     // "0000:03:00.0"
+        QString vendorId;       // "1002"
+        QString deviceId;       // "73bf"
+        QString renderNode;     // "/dev/dri/renderD129"
+        QString name;           // "AMD 73bf", for the UI
+        RenderBudget::GpuClass gpuClass = RenderBudget::GpuClass::Unknown;
+        bool bootVga = false;   // Drives the console, usually the desktop's GPU
+
+        /**
+         * @brief "vendor:device", as --prefer-vk-device and MESA_VK_DEVICE_SELECT take it
+         */
+        QString vkDevice() const { return vendorId + QLatin1Char(':') + deviceId; }
+
+        /**
+         * @brief DRI_PRIME value selecting exactly this card: "pci-0000_03_00_0"
+         */
+        QString primeTag() const;
+
+        /**
+         * @brief RenderBudget::defaultBudget() of its class, in Mpx/s
+         */
+        int budget() const { return RenderBudget::defaultBudget(gpuClass); }
+    };
+
+    /**
+     * @brief GPUs with a render node, discrete ones first, then by PCI address
+     *
+     * @param drmRoot sysfs DRM class directory
+     * @param devRoot Where the render nodes are
+     */
+    static QList<Gpu> enumerate(const QString &drmRoot = QStringLiteral("/sys/class/drm"),
+                                const QString &devRoot = QStringLiteral("/dev/dri"));
+
+    /**
+     * @brief Index of the GPU at @p pciAddress in @p gpus, -1 if there is none
+     */
+    static int indexOf(const QList<Gpu> &gpus, const QString &pciAddress);
+
+    /**
+     * @brief Whether another GPU in @p gpus has the same vendor:device as @p gpu
+     *
+     * MESA_VK_DEVICE_SELECT would pick the first of them, so only DRI_PRIME
+     * is set for such twins.
+     */
+    static bool hasTwin(const QList<Gpu> &gpus, const Gpu &gpu);
+
+    /**
+     * @brief Whether @p user can open @p node read-write, going by its mode bits
+     *
+     * Render nodes are usually 0666 or group "render"; a user outside that
+     * group gets llvmpipe, or nothing, from that card.
+     */
+    static bool canAccess(const QString &node, const UserEntry &user);
+
+    /**
+     * @brief PCI address per instance, empty for the system default
+     *
+     * Instances pinned to a GPU that exists keep it, and count towards its
+     * load. AUTO instances, and pinned ones whose GPU is gone, are then
+     * handed out heaviest first, each to the GPU it loads least relative
+     * to its budget(). With fewer than two GPUs nothing is placed.
+     *
+     * @param gpus From enumerate()
+     * @param requested "gpu" of each instance
+     * @param loads Expected render load of each instance in Mpx/s, parallel to requested
+     * @param usable Whether instance i may use a GPU, e.g. canAccess() for its player; all if empty
+     */
+    static QStringList balance(const QList<Gpu> &gpus, const QStringList &requested, const QList<double> &loads,
+                               const std::function<bool(int, const Gpu &)> &usable = {});
+};
@@ -3,6 +3,7 @@
 
 #include "HeroicConfigManager.h"
 #include "Logging.h"
+#include "StartupTrace.h"
 
 #include <QDebug>
 #include <QDir>
@@ -20,6 +21,7 @@
 HeroicConfigManager::HeroicConfigManager(QObject *parent)
     : QObject(parent)
 {
+    StartupTrace::Scope trace("HeroicConfigManager");
     // Get current user's home directory
     const char *home = getenv("HOME");
     if (home) {
@@ -113,6 +115,11 @@ QString HeroicConfigManager::heroicCommand() const
     }
 }
 
+QString HeroicConfigManager::launchCommand(const QString &heroicCommand, const HeroicGame &game)
+{
+    return QStringLiteral("%1 --no-gui \"heroic://launch/%2/%3\"").arg(heroicCommand, game.runner, game.appName);
+}
+
 void HeroicConfigManager::loadHeroicConfig()
 {
     if (!QFile::exists(m_heroicPaths.configJson)) {
@@ -163,25 +170,25 @@ void HeroicConfigManager::loadGames()
     }
     
     // Load games from all backends
-    m_games.append(parseLegendaryGames());
-    m_games.append(parseGogGames());
-    m_games.append(parseNileGames());
-    m_games.append(parseSideloadGames());
+    m_games.append(parseLegendaryGames(m_heroicPaths.legendaryInstalled));
+    m_games.append(parseGogGames(m_heroicPaths.gogInstalled));
+    m_games.append(parseNileGames(m_heroicPaths.nileInstalled));
+    m_games.append(parseSideloadGames(m_heroicPaths.sideloadLibrary));
     
     qDebug() << "HeroicConfigManager: Loaded" << m_games.size() << "total games";
     Q_EMIT gamesLoaded();
 }
 
-QList<HeroicGame> HeroicConfigManager::parseLegendaryGames()
+QList<HeroicGame> HeroicConfigManager::parseLegendaryGames(const QString &path)
 {
     QList<HeroicGame> games;
     
-    if (!QFile::exists(m_heroicPaths.legendaryInstalled)) {
+    if (!QFile::exists(path)) {
         qDebug() << "HeroicConfigManager: Legendary installed.json not found";
         return games;
     }
     
-    QFile file(m_heroicPaths.legendaryInstalled);
+    QFile file(path);
     if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "HeroicConfigManager: Failed to open Legendary installed.json";
         return games;
@@ -220,16 +227,16 @@ QList<HeroicGame> HeroicConfigManager::parseLegendaryGames()
     return games;
 }
 
-QList<HeroicGame> HeroicConfigManager::parseGogGames()
+QList<HeroicGame> HeroicConfigManager::parseGogGames(const QString &path)
 {
     QList<HeroicGame> games;
     
-    if (!QFile::exists(m_heroicPaths.gogInstalled)) {
+    if (!QFile::exists(path)) {
         qDebug() << "HeroicConfigManager: GOG installed.json not found";
         return games;
     }
     
-    QFile file(m_heroicPaths.gogInstalled);
+    QFile file(path);
     if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "HeroicConfigManager: Failed to open GOG installed.json";
         return games;
@@ -266,16 +273,16 @@ QList<HeroicGame> HeroicConfigManager::parseGogGames()
     return games;
 }
 
-QList<HeroicGame> HeroicConfigManager::parseNileGames()
+QList<HeroicGame> HeroicConfigManager::parseNileGames(const QString &path)
 {
     QList<HeroicGame> games;
     
-    if (!QFile::exists(m_heroicPaths.nileInstalled)) {
+    if (!QFile::exists(path)) {
         qDebug() << "HeroicConfigManager: Nile installed.json not found (Amazon Games)";
         return games;
     }
     
-    QFile file(m_heroicPaths.nileInstalled);
+    QFile file(path);
     if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "HeroicConfigManager: Failed to open Nile installed.json";
         return games;
@@ -348,16 +355,16 @@ QStringList HeroicConfigManager::extractGameDirectories() const
 
 
 
-QList<HeroicGame> HeroicConfigManager::parseSideloadGames()
+QList<HeroicGame> HeroicConfigManager::parseSideloadGames(const QString &path)
 {
     QList<HeroicGame> games;
     
-    if (!QFile::exists(m_heroicPaths.sideloadLibrary)) {
+    if (!QFile::exists(path)) {
         qDebug() << "HeroicConfigManager: Sideload library.json not found";
         return games;
     }
     
-    QFile file(m_heroicPaths.sideloadLibrary);
+    QFile file(path);
     if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "HeroicConfigManager: Failed to open sideload library.json";
         return games;
@@ -154,12 +154,24 @@ Q_SIGNALS:
     void gamesLoaded();
     void errorOccurred(const QString &message);
 
+public:
+    /**
+     * @brief Parse one backend's list of installed games
+     *
+     * They only read the file at @p path, so GameCatalog runs them on worker threads.
+     */
+    static QList<HeroicGame> parseLegendaryGames(const QString &path);
+    static QList<HeroicGame> parseGogGames(const QString &path);
+    static QList<HeroicGame> parseNileGames(const QString &path);
+    static QList<HeroicGame> parseSideloadGames(const QString &path);
+
+    /**
+     * @brief Command that launches @p game through Heroic
+     * @param heroicCommand heroicCommand() of the manager that found the game
+     */
+    static QString launchCommand(const QString &heroicCommand, const HeroicGame &game);
+
 private:
-    QList<HeroicGame> parseLegendaryGames();
-    QList<HeroicGame> parseGogGames();
-    QList<HeroicGame> parseNileGames();
-    QList<HeroicGame> parseSideloadGames();
-    
     /**
      * @brief Read Heroic's config.json for default settings
      */
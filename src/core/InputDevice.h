@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+
+/**
+ * @brief Represents an input device (controller, keyboard, mouse)
+ */
+struct InputDevice {
+    Q_GADGET
+    Q_PROPERTY(int eventNumber MEMBER eventNumber)
+    Q_PROPERTY(QString name MEMBER name)
+    Q_PROPERTY(QString type MEMBER type)
+    Q_PROPERTY(QString path MEMBER path)
+    Q_PROPERTY(QString joyPath MEMBER joyPath)
+    Q_PROPERTY(QString vendorId MEMBER vendorId)
+    Q_PROPERTY(QString productId MEMBER productId)
+    Q_PROPERTY(QString physPath MEMBER physPath)
+    Q_PROPERTY(bool assigned MEMBER assigned)
+    Q_PROPERTY(int assignedInstance MEMBER assignedInstance)
+    Q_PROPERTY(bool isVirtual MEMBER isVirtual)
+    Q_PROPERTY(bool isInternal MEMBER isInternal)
+    Q_PROPERTY(QString stableId MEMBER stableId)
+    Q_PROPERTY(int batteryLevel MEMBER batteryLevel)
+    Q_PROPERTY(bool batteryCharging MEMBER batteryCharging)
+
+public:
+    int eventNumber = -1;
+    QString name;
+    QString type; // "controller", "keyboard", "mouse", "other"
+    QString path; // /dev/input/eventN
+    QString joyPath; // /dev/input/jsN (optional)
+    QString vendorId;
+    QString productId;
+    QString physPath; // Physical device path (for grouping)
+    QString stableId; // Stable identifier: "vendorId:productId:physPath" - survives hotplug/reboot
+    bool assigned = false;
+    int assignedInstance = -1;
+    bool isVirtual = false;  // Virtual/software device
+    bool isInternal = false; // Internal device (power buttons, etc.)
+    int batteryLevel = -1;   // Percent, -1 without a device battery
+    bool batteryCharging = false;
+};
+
+Q_DECLARE_METATYPE(InputDevice)
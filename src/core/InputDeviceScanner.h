@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QByteArrayView>
+
+/**
+ * @brief One device block of /proc/bus/input/devices
+ *
+ * All views point into the buffer handed to InputDeviceScanner::scan() and
+ * are only valid while it lives.
+ */
+struct ProcInputRecord {
+    QByteArrayView block;     // Whole block including B:/U:/S: lines, usable as cache key
+    QByteArrayView name;      // N: Name="..." (without quotes)
+    QByteArrayView phys;      // P: Phys=...
+    QByteArrayView handlers;  // H: Handlers=...
+    QByteArrayView vendor;    // I: ... Vendor=...
+    QByteArrayView product;   // I: ... Product=...
+    int eventNumber = -1;     // First eventN handler
+    int joyNumber = -1;       // First jsN handler
+};
+
+/**
+ * @brief Single-pass, allocation-free scanner for /proc/bus/input/devices
+ *
+ * Works on the raw bytes: lines are dispatched on their first byte and
+ * fields are sliced out as views, no QString decoding or regular
+ * expressions are involved. Blocks without a name or eventN handler are
+ * skipped, matching what DeviceManager can use.
+ */
+class InputDeviceScanner
+{
+public:
+    template<typename Callback>
+    static void scan(QByteArrayView content, Callback &&onRecord)
+    {
+        ProcInputRecord record;
+        qsizetype blockStart = 0;
+        qsizetype pos = 0;
+
+        auto finish = [&](qsizetype blockEnd) {
+            if (!record.name.isEmpty() && record.eventNumber >= 0) {
+                record.block = content.sliced(blockStart, blockEnd - blockStart);
+                onRecord(record);
+            }
+            record = ProcInputRecord();
+        };
+
+        while (pos < content.size()) {
+            qsizetype end = content.indexOf('\n', pos);
+            if (end < 0) {
+                end = content.size();
+            }
+            const QByteArrayView line = content.sliced(pos, end - pos);
+
+            if (line.isEmpty()) {
+                finish(pos);
+                blockStart = end + 1;
+            } else if (line.size() > 3 && line[1] == ':' && line[2] == ' ') {
+                const QByteArrayView value = line.sliced(3);
+                switch (line[0]) {
+                case 'N':
+                    if (value.startsWith("Name=")) {
+                        QByteArrayView name = value.sliced(5);
+                        if (name.startsWith('"') && name.endsWith('"') && name.size() >= 2) {
+                            name = name.sliced(1, name.size() - 2);
+                        }
+                        record.name = name;
+                    }
+                    break;
+                case 'P':
+                    if (value.startsWith("Phys=")) {
+                        record.phys = value.sliced(5);
+                    }
+                    break;
+                case 'H':
+                    if (value.startsWith("Handlers=")) {
+                        record.handlers = value.sliced(9);
+                        parseHandlers(record);
+                    }
+                    break;
+                case 'I':
+                    parseIds(value, record);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            pos = end + 1;
+        }
+
+        // Last block if the file doesn't end with an empty line
+        finish(content.size());
+    }
+
+    /**
+     * @brief Parse a non-negative decimal number, -1 if @p digits isn't one
+     */
+    static int parseNumber(QByteArrayView digits)
+    {
+        if (digits.isEmpty() || digits.size() > 9) {
+            return -1;
+        }
+        int value = 0;
+        for (char c : digits) {
+            if (c < '0' || c > '9') {
+                return -1;
+            }
+            value = value * 10 + (c - '0');
+        }
+        return value;
+    }
+
+private:
+    static void parseHandlers(ProcInputRecord &record)
+    {
+        // "sysrq kbd leds event3 js0 " - space separated tokens
+        QByteArrayView rest = record.handlers;
+        while (!rest.isEmpty()) {
+            qsizetype space = rest.indexOf(' ');
+            const QByteArrayView token = space < 0 ? rest : rest.first(space);
+            rest = space < 0 ? QByteArrayView() : rest.sliced(space + 1);
+
+            if (record.eventNumber < 0 && token.startsWith("event")) {
+                record.eventNumber = parseNumber(token.sliced(5));
+            } else if (record.joyNumber < 0 && token.startsWith("js")) {
+                record.joyNumber = parseNumber(token.sliced(2));
+            }
+        }
+    }
+
+    static void parseIds(QByteArrayView value, ProcInputRecord &record)
+    {
+        // "Bus=0003 Vendor=045e Product=028e Version=0110"
+        if (!value.startsWith("Bus=")) {
+            return;
+        }
+        while (!value.isEmpty()) {
+            qsizetype space = value.indexOf(' ');
+            const QByteArrayView token = space < 0 ? value : value.first(space);
+            value = space < 0 ? QByteArrayView() : value.sliced(space + 1);
+
+            if (token.startsWith("Vendor=")) {
+                record.vendor = token.sliced(7);
+            } else if (token.startsWith("Product=")) {
+                record.product = token.sliced(8);
+            }
+        }
+    }
+};
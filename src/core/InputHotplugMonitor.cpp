@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "InputHotplugMonitor.h"
+
+#include <QByteArrayView>
+#include <QDebug>
+#include <QSocketNotifier>
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Multicast group udevd re-sends processed events on (group 1 is raw kernel)
+static constexpr unsigned int UDEV_MONITOR_GROUP = 2;
+
+// Header udevd prepends to its netlink messages (see libudev-monitor.c)
+static constexpr char UDEV_PREFIX[] = "libudev";
+static constexpr quint32 UDEV_MAGIC = 0xfeedcafe;
+static constexpr int UDEV_MAGIC_OFFSET = 8;
+static constexpr int UDEV_PROPERTIES_OFF_OFFSET = 16;
+static constexpr int UDEV_PROPERTIES_LEN_OFFSET = 20;
+
+InputHotplugMonitor::InputHotplugMonitor(QObject *parent)
+    : QObject(parent)
+{
+}
+
+InputHotplugMonitor::~InputHotplugMonitor()
+{
+    stop();
+}
+
+bool InputHotplugMonitor::start()
+{
+    if (m_fd >= 0) {
+        return true;
+    }
+
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        qDebug() << "InputHotplugMonitor: netlink socket unavailable:" << strerror(errno);
+        return false;
+    }
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = UDEV_MONITOR_GROUP;
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+        qDebug() << "InputHotplugMonitor: Failed to bind netlink socket:" << strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &InputHotplugMonitor::onReadyRead);
+
+    qDebug() << "InputHotplugMonitor: Listening for udev input events";
+    return true;
+}
+
+void InputHotplugMonitor::stop()
+{
+    delete m_notifier;
+    m_notifier = nullptr;
+
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void InputHotplugMonitor::onReadyRead()
+{
+    // uevents are capped at 2 KiB by the kernel, udev adds a small header
+    char buffer[8192];
+
+    while (true) {
+        ssize_t len = recv(m_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == ENOBUFS) {
+                qWarning() << "InputHotplugMonitor: Event buffer overrun, requesting full rescan";
+                Q_EMIT overflowed();
+                continue;
+            }
+            // EAGAIN: drained
+            break;
+        }
+        if (len == 0) {
+            break;
+        }
+
+        Event event;
+        if (!parseUevent(QByteArray::fromRawData(buffer, len), event)) {
+            continue;
+        }
+
+        if (!event.powerSupply.isEmpty()) {
+            Q_EMIT powerSupplyChanged(event.powerSupply);
+        } else if (event.action == Action::Add) {
+            Q_EMIT eventDeviceAdded(event.eventNumber);
+        } else if (event.action == Action::Remove) {
+            Q_EMIT eventDeviceRemoved(event.eventNumber);
+        }
+    }
+}
+
+bool InputHotplugMonitor::parseUevent(const QByteArray &message, Event &event)
+{
+    event = Event();
+
+    QByteArrayView properties(message);
+    if (message.startsWith(QByteArrayView(UDEV_PREFIX, sizeof(UDEV_PREFIX)))) {
+        // udev format: fixed header, then NUL separated KEY=VALUE pairs
+        if (message.size() < UDEV_PROPERTIES_LEN_OFFSET + 4) {
+            return false;
+        }
+        quint32 magic;
+        quint32 offset;
+        quint32 length;
+        memcpy(&magic, message.constData() + UDEV_MAGIC_OFFSET, sizeof(magic));
+        memcpy(&offset, message.constData() + UDEV_PROPERTIES_OFF_OFFSET, sizeof(offset));
+        memcpy(&length, message.constData() + UDEV_PROPERTIES_LEN_OFFSET, sizeof(length));
+        if (ntohl(magic) != UDEV_MAGIC || qint64(offset) + length > message.size()) {
+            return false;
+        }
+        properties = properties.sliced(offset, length);
+    } else {
+        // Kernel format: "action@devpath" header, then KEY=VALUE pairs
+        const qsizetype headerEnd = properties.indexOf('\0');
+        if (headerEnd < 0 || !properties.first(headerEnd).contains('@')) {
+            return false;
+        }
+        properties = properties.sliced(headerEnd + 1);
+    }
+
+    QByteArrayView action;
+    QByteArrayView subsystem;
+    QByteArrayView devname;
+    QByteArrayView devpath;
+    QByteArrayView supplyName;
+
+    while (!properties.isEmpty()) {
+        qsizetype end = properties.indexOf('\0');
+        const QByteArrayView entry = end < 0 ? properties : properties.first(end);
+        properties = end < 0 ? QByteArrayView() : properties.sliced(end + 1);
+
+        if (entry.startsWith("ACTION=")) {
+            action = entry.sliced(7);
+        } else if (entry.startsWith("SUBSYSTEM=")) {
+            subsystem = entry.sliced(10);
+        } else if (entry.startsWith("DEVNAME=")) {
+            devname = entry.sliced(8);
+        } else if (entry.startsWith("DEVPATH=")) {
+            devpath = entry.sliced(8);
+        } else if (entry.startsWith("POWER_SUPPLY_NAME=")) {
+            supplyName = entry.sliced(18);
+        }
+    }
+
+    if (subsystem == "power_supply") {
+        // Removals carry no POWER_SUPPLY_* properties; DEVPATH ends in the name
+        if (supplyName.isEmpty()) {
+            supplyName = devpath.sliced(devpath.lastIndexOf('/') + 1);
+        }
+        if (supplyName.isEmpty()) {
+            return false;
+        }
+        if (action == "add") {
+            event.action = Action::Add;
+        } else if (action == "change") {
+            event.action = Action::Change;
+        } else if (action == "remove") {
+            event.action = Action::Remove;
+        } else {
+            return false;
+        }
+        event.powerSupply = QString::fromUtf8(supplyName);
+        return true;
+    }
+
+    if (subsystem != "input") {
+        return false;
+    }
+
+    // Kernel sends "input/event5", udev "/dev/input/event5"
+    const qsizetype slash = devname.lastIndexOf('/');
+    const QByteArrayView node = slash < 0 ? devname : devname.sliced(slash + 1);
+    if (!node.startsWith("event") || node.size() == 5) {
+        return false;
+    }
+
+    bool ok = false;
+    const int eventNumber = node.sliced(5).toInt(&ok);
+    if (!ok || eventNumber < 0) {
+        return false;
+    }
+
+    if (action == "add") {
+        event.action = Action::Add;
+    } else if (action == "remove") {
+        event.action = Action::Remove;
+    } else {
+        return false;
+    }
+
+    event.eventNumber = eventNumber;
+    return true;
+}
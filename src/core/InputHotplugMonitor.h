@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+class QSocketNotifier;
+
+/**
+ * @brief Per-device input hotplug events from the kernel uevent netlink socket
+ *
+ * Listens on NETLINK_KOBJECT_UEVENT for the multicast group udevd rebroadcasts
+ * on, so an "add" is only reported once udev has created the node and applied
+ * its rules (ownership we restore afterwards isn't overwritten). Only
+ * /dev/input/eventN nodes and power_supply devices (controller batteries
+ * report level changes as "change" uevents) are reported; no libudev
+ * dependency.
+ */
+class InputHotplugMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Action {
+        Other,
+        Add,
+        Remove,
+        Change,
+    };
+
+    struct Event {
+        Action action = Action::Other;
+        int eventNumber = -1;   // Input events
+        QString powerSupply;    // power_supply events: the supply's name
+    };
+
+    explicit InputHotplugMonitor(QObject *parent = nullptr);
+    ~InputHotplugMonitor() override;
+
+    /**
+     * @brief Open and bind the netlink socket
+     * @return false if netlink uevents are unavailable (e.g. in a sandbox)
+     */
+    bool start();
+    void stop();
+    bool isActive() const { return m_fd >= 0; }
+
+    /**
+     * @brief Decode a kernel or udev netlink message
+     * @return true if it describes an input eventN node being added or
+     *         removed, or a power supply being added, changed or removed
+     */
+    static bool parseUevent(const QByteArray &message, Event &event);
+
+Q_SIGNALS:
+    void eventDeviceAdded(int eventNumber);
+    void eventDeviceRemoved(int eventNumber);
+
+    /**
+     * @brief /sys/class/power_supply/@p name appeared, changed or went away
+     */
+    void powerSupplyChanged(const QString &name);
+
+    /**
+     * @brief Messages were dropped (socket buffer overrun); state must be rescanned
+     */
+    void overflowed();
+
+private Q_SLOTS:
+    void onReadyRead();
+
+private:
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+};
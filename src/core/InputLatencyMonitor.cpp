@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "InputLatencyMonitor.h"
+
+#include <QDebug>
+#include <QMap>
+#include <QSocketNotifier>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+InputLatencyMonitor::InputLatencyMonitor(QObject *parent)
+    : QObject(parent)
+{
+}
+
+InputLatencyMonitor::~InputLatencyMonitor()
+{
+    clear();
+}
+
+bool InputLatencyMonitor::watch(const QString &devicePath, int instanceIndex)
+{
+    if (m_devices.contains(devicePath)) {
+        m_devices[devicePath].instanceIndex = instanceIndex;
+        return m_devices[devicePath].fd >= 0;
+    }
+
+    const int fd = open(devicePath.toLocal8Bit().constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        qDebug() << "InputLatencyMonitor: Cannot open" << devicePath << ":" << strerror(errno);
+        return false;
+    }
+
+    // Event timestamps on the same clock as frame timing
+    int clock = CLOCK_MONOTONIC;
+    ioctl(fd, EVIOCSCLOCKID, &clock);
+
+    track(devicePath, instanceIndex);
+    Device &device = m_devices[devicePath];
+    device.fd = fd;
+    device.notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(device.notifier, &QSocketNotifier::activated, this, [this, devicePath]() {
+        readDevice(devicePath);
+    });
+
+    qDebug() << "InputLatencyMonitor: Watching" << devicePath << "for instance" << instanceIndex;
+    return true;
+}
+
+void InputLatencyMonitor::track(const QString &devicePath, int instanceIndex)
+{
+    Device &device = m_devices[devicePath];
+    device.instanceIndex = instanceIndex;
+    if (device.intervals.isEmpty()) {
+        device.intervals.reserve(MAX_SAMPLES);
+    }
+}
+
+void InputLatencyMonitor::unwatch(const QString &devicePath)
+{
+    auto it = m_devices.find(devicePath);
+    if (it == m_devices.end()) {
+        return;
+    }
+    closeDevice(it.value());
+    m_devices.erase(it);
+}
+
+void InputLatencyMonitor::clear()
+{
+    for (Device &device : m_devices) {
+        closeDevice(device);
+    }
+    m_devices.clear();
+    m_frameIntervals.clear();
+}
+
+void InputLatencyMonitor::setFrameInterval(int instanceIndex, qint64 micros)
+{
+    if (micros > 0) {
+        m_frameIntervals.insert(instanceIndex, micros);
+    } else {
+        m_frameIntervals.remove(instanceIndex);
+    }
+}
+
+void InputLatencyMonitor::recordReport(const QString &devicePath, qint64 timestampUs, int eventCount)
+{
+    auto it = m_devices.find(devicePath);
+    if (it == m_devices.end()) {
+        return;
+    }
+
+    Device &device = it.value();
+    device.events += eventCount;
+
+    const qint64 interval = device.lastReportUs >= 0 ? timestampUs - device.lastReportUs : -1;
+    device.lastReportUs = timestampUs;
+    if (interval <= 0 || interval > IDLE_GAP_US) {
+        return;
+    }
+
+    if (device.intervals.size() < MAX_SAMPLES) {
+        device.intervals.append(interval);
+    } else {
+        device.intervals[device.nextSample] = interval;
+        device.nextSample = (device.nextSample + 1) % MAX_SAMPLES;
+    }
+}
+
+QVariantList InputLatencyMonitor::stats() const
+{
+    struct Player {
+        int devices = 0;
+        quint64 events = 0;
+        QList<qint64> intervals;
+    };
+
+    QMap<int, Player> players;
+    for (const Device &device : m_devices) {
+        Player &player = players[device.instanceIndex];
+        player.devices++;
+        player.events += device.events;
+        player.intervals += device.intervals;
+    }
+
+    QVariantList result;
+    for (auto it = players.begin(); it != players.end(); ++it) {
+        Player &player = it.value();
+
+        qint64 sum = 0;
+        for (qint64 interval : player.intervals) {
+            sum += interval;
+        }
+        const double meanInterval = player.intervals.isEmpty() ? 0.0 : double(sum) / player.intervals.size();
+        const qint64 p50 = percentile(player.intervals, 0.5);
+        const qint64 p99 = percentile(player.intervals, 0.99);
+        const qint64 frame = m_frameIntervals.value(it.key(), 0);
+
+        QVariantMap entry;
+        entry[QStringLiteral("instanceIndex")] = it.key();
+        entry[QStringLiteral("devices")] = player.devices;
+        entry[QStringLiteral("events")] = player.events;
+        entry[QStringLiteral("reportRateHz")] = meanInterval > 0 ? qRound(1e6 / meanInterval) : 0;
+        entry[QStringLiteral("reportIntervalP50Ms")] = p50 / 1000.0;
+        entry[QStringLiteral("reportIntervalP99Ms")] = p99 / 1000.0;
+        entry[QStringLiteral("frameIntervalMs")] = frame / 1000.0;
+        entry[QStringLiteral("inputToPhotonP50Ms")] = (p50 / 2.0 + 1.5 * frame) / 1000.0;
+        entry[QStringLiteral("inputToPhotonP99Ms")] = (p99 + 2.0 * frame) / 1000.0;
+        result.append(entry);
+    }
+    return result;
+}
+
+qint64 InputLatencyMonitor::percentile(QList<qint64> &samples, double fraction)
+{
+    if (samples.isEmpty()) {
+        return 0;
+    }
+    const qsizetype rank = qBound<qsizetype>(1, qsizetype(std::ceil(fraction * samples.size())), samples.size());
+    std::nth_element(samples.begin(), samples.begin() + (rank - 1), samples.end());
+    return samples[rank - 1];
+}
+
+void InputLatencyMonitor::readDevice(const QString &devicePath)
+{
+    auto it = m_devices.find(devicePath);
+    if (it == m_devices.end() || it->fd < 0) {
+        return;
+    }
+
+    struct input_event events[64];
+    while (true) {
+        const ssize_t bytes = read(it->fd, events, sizeof(events));
+        if (bytes <= 0) {
+            if (bytes < 0 && errno == ENODEV) {
+                // Unplugged; the reconnected node is watched again by the caller
+                qDebug() << "InputLatencyMonitor: Lost" << devicePath;
+                closeDevice(it.value());
+            }
+            return;
+        }
+
+        const int count = int(bytes / sizeof(struct input_event));
+        for (int i = 0; i < count; ++i) {
+            const struct input_event &event = events[i];
+            if (event.type == EV_SYN && event.code == SYN_REPORT) {
+                const qint64 timestamp = qint64(event.input_event_sec) * 1000000 + event.input_event_usec;
+                recordReport(devicePath, timestamp, it->pendingEvents);
+                it->pendingEvents = 0;
+            } else if (event.type != EV_SYN) {
+                it->pendingEvents++;
+            }
+        }
+    }
+}
+
+void InputLatencyMonitor::closeDevice(Device &device)
+{
+    delete device.notifier;
+    device.notifier = nullptr;
+    if (device.fd >= 0) {
+        close(device.fd);
+        device.fd = -1;
+    }
+}
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QVariantList>
+
+class QSocketNotifier;
+
+/**
+ * @brief Per-player input latency diagnostics
+ *
+ * Opens the evdev nodes assigned to each player as an additional, non-grabbing
+ * reader and timestamps every SYN_REPORT with the kernel's CLOCK_MONOTONIC
+ * event time. The interval between consecutive reports while a device is
+ * active is its sampling period, the device's contribution to input lag.
+ *
+ * Gamescope doesn't hand per-frame presentation timestamps to clients, so the
+ * display side is modelled from each instance's frame interval (its -r rate,
+ * or the output's refresh rate): an input waits on average half a frame to be
+ * picked up, then one frame for gamescope to composite and present.
+ *
+ *   p50 estimate = report interval p50 / 2 + 1.5 x frame interval
+ *   p99 estimate = report interval p99     + 2   x frame interval
+ *
+ * Nodes must be opened before ownership is handed to the player; an open fd
+ * stays readable after the chown. Devices grabbed by the helper's input
+ * router deliver no events here.
+ */
+class InputLatencyMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Gaps longer than this are idle time, not a sampling period
+    static constexpr qint64 IDLE_GAP_US = 100000;
+    static constexpr int MAX_SAMPLES = 256;
+
+    explicit InputLatencyMonitor(QObject *parent = nullptr);
+    ~InputLatencyMonitor() override;
+
+    /**
+     * @brief Start reading @p devicePath on behalf of player @p instanceIndex
+     * @return false if the node can't be opened
+     */
+    bool watch(const QString &devicePath, int instanceIndex);
+
+    /**
+     * @brief Account @p devicePath to @p instanceIndex without reading it
+     *
+     * watch() calls this; reports can then be fed with recordReport().
+     */
+    void track(const QString &devicePath, int instanceIndex);
+
+    void unwatch(const QString &devicePath);
+    void clear();
+
+    bool isWatching(const QString &devicePath) const { return m_devices.contains(devicePath); }
+
+    void setFrameInterval(int instanceIndex, qint64 micros);
+
+    /**
+     * @brief Record one SYN_REPORT of @p devicePath carrying @p eventCount events
+     */
+    void recordReport(const QString &devicePath, qint64 timestampUs, int eventCount);
+
+    /**
+     * @brief Per-player statistics, ordered by instance index
+     *
+     * Each entry has "instanceIndex", "devices", "events", "reportRateHz",
+     * "reportIntervalP50Ms", "reportIntervalP99Ms", "frameIntervalMs",
+     * "inputToPhotonP50Ms" and "inputToPhotonP99Ms".
+     */
+    QVariantList stats() const;
+
+    /**
+     * @brief Nearest-rank percentile of @p samples (sorted in place)
+     */
+    static qint64 percentile(QList<qint64> &samples, double fraction);
+
+private:
+    struct Device {
+        int fd = -1;
+        int instanceIndex = -1;
+        QSocketNotifier *notifier = nullptr;
+        qint64 lastReportUs = -1;
+        int pendingEvents = 0;  // Events since the last SYN_REPORT
+        quint64 events = 0;
+        QList<qint64> intervals;  // Ring of recent report intervals (µs)
+        int nextSample = 0;
+    };
+
+    void readDevice(const QString &devicePath);
+    void closeDevice(Device &device);
+
+    QHash<QString, Device> m_devices;
+    QHash<int, qint64> m_frameIntervals;  // instance index -> µs
+};
@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "InstanceListModel.h"
+
+InstanceListModel::InstanceListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+int InstanceListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_instances.size();
+}
+
+QVariant InstanceListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_instances.size()) {
+        return QVariant();
+    }
+    return value(m_instances.at(index.row()), role == Qt::DisplayRole ? UsernameRole : role);
+}
+
+QVariant InstanceListModel::value(const InstanceConfig &instance, int role)
+{
+    switch (role) {
+    case UsernameRole:
+        return instance.username;
+    case MonitorRole:
+        return instance.monitor;
+    case InternalWidthRole:
+        return instance.internalWidth;
+    case InternalHeightRole:
+        return instance.internalHeight;
+    case OutputWidthRole:
+        return instance.outputWidth;
+    case OutputHeightRole:
+        return instance.outputHeight;
+    case RefreshRateRole:
+        return instance.refreshRate;
+    case FrameLimitRole:
+        return instance.frameLimit;
+    case ScalingModeRole:
+        return instance.scalingMode;
+    case FilterModeRole:
+        return instance.filterMode;
+    case DevicesRole:
+        return QVariant::fromValue(instance.devices);
+    case DeviceStableIdsRole:
+        return instance.deviceStableIds;
+    case DeviceStableIdNamesRole:
+        return instance.deviceStableIdNames;
+    case GameCommandRole:
+        return instance.gameCommand;
+    case SteamAppIdRole:
+        return instance.steamAppId;
+    case PresetIdRole:
+        return instance.presetId;
+    case SharedDirectoriesRole:
+        return instance.sharedDirectories;
+    case CpuWeightRole:
+        return instance.cpuWeight;
+    case CpuCoresRole:
+        return instance.cpuCores;
+    case IoWeightRole:
+        return instance.ioWeight;
+    case MemoryHighMbRole:
+        return instance.memoryHighMb;
+    case GpuRole:
+        return instance.gpu;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> InstanceListModel::roleNames() const
+{
+    return {
+        {UsernameRole, "username"},
+        {MonitorRole, "monitor"},
+        {InternalWidthRole, "internalWidth"},
+        {InternalHeightRole, "internalHeight"},
+        {OutputWidthRole, "outputWidth"},
+        {OutputHeightRole, "outputHeight"},
+        {RefreshRateRole, "refreshRate"},
+        {FrameLimitRole, "frameLimit"},
+        {ScalingModeRole, "scalingMode"},
+        {FilterModeRole, "filterMode"},
+        {DevicesRole, "devices"},
+        {DeviceStableIdsRole, "deviceStableIds"},
+        {DeviceStableIdNamesRole, "deviceStableIdNames"},
+        {GameCommandRole, "gameCommand"},
+        {SteamAppIdRole, "steamAppId"},
+        {PresetIdRole, "presetId"},
+        {SharedDirectoriesRole, "sharedDirectories"},
+        {CpuWeightRole, "cpuWeight"},
+        {CpuCoresRole, "cpuCores"},
+        {IoWeightRole, "ioWeight"},
+        {MemoryHighMbRole, "memoryHighMb"},
+        {GpuRole, "gpu"},
+    };
+}
+
+bool InstanceListModel::sync(const QList<InstanceConfig> &instances)
+{
+    bool changed = false;
+    const int common = qMin(m_instances.size(), instances.size());
+
+    for (int row = 0; row < common; ++row) {
+        QList<int> roles;
+        for (int role = UsernameRole; role <= GpuRole; ++role) {
+            if (value(m_instances.at(row), role) != value(instances.at(row), role)) {
+                roles.append(role);
+            }
+        }
+        if (!roles.isEmpty()) {
+            m_instances[row] = instances.at(row);
+            const QModelIndex modelIndex = index(row);
+            Q_EMIT dataChanged(modelIndex, modelIndex, roles);
+            changed = true;
+        }
+    }
+
+    if (instances.size() > m_instances.size()) {
+        beginInsertRows(QModelIndex(), m_instances.size(), instances.size() - 1);
+        m_instances.append(instances.mid(m_instances.size()));
+        endInsertRows();
+        Q_EMIT countChanged();
+        changed = true;
+    } else if (instances.size() < m_instances.size()) {
+        beginRemoveRows(QModelIndex(), instances.size(), m_instances.size() - 1);
+        m_instances.resize(instances.size());
+        endRemoveRows();
+        Q_EMIT countChanged();
+        changed = true;
+    }
+
+    return changed;
+}
@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QList>
+#include <qqmlintegration.h>
+
+#include "SessionManager.h"
+
+/**
+ * @brief List model of the current session's instances
+ *
+ * SessionManager pushes its instances with sync(), which compares them
+ * with the current rows field by field. Only the roles that changed get
+ * dataChanged, so moving one player's refresh rate re-evaluates that
+ * SpinBox and not every card on the page.
+ */
+class InstanceListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("Provided by SessionManager")
+
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    // Role names match the keys of SessionManager::getInstanceConfig()
+    enum Roles {
+        UsernameRole = Qt::UserRole + 1,
+        MonitorRole,
+        InternalWidthRole,
+        InternalHeightRole,
+        OutputWidthRole,
+        OutputHeightRole,
+        RefreshRateRole,
+        FrameLimitRole,
+        ScalingModeRole,
+        FilterModeRole,
+        DevicesRole,
+        DeviceStableIdsRole,
+        DeviceStableIdNamesRole,
+        GameCommandRole,
+        SteamAppIdRole,
+        PresetIdRole,
+        SharedDirectoriesRole,
+        CpuWeightRole,
+        CpuCoresRole,
+        IoWeightRole,
+        MemoryHighMbRole,
+        GpuRole,
+    };
+    Q_ENUM(Roles)
+
+    explicit InstanceListModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int count() const { return m_instances.size(); }
+
+    /**
+     * @brief Update the rows to match @p instances
+     *
+     * Rows past the shorter list are inserted or removed at the end; rows
+     * in both get dataChanged with just the roles whose value differs.
+     * @return whether anything changed
+     */
+    bool sync(const QList<InstanceConfig> &instances);
+
+Q_SIGNALS:
+    void countChanged();
+
+private:
+    static QVariant value(const InstanceConfig &instance, int role);
+
+    QList<InstanceConfig> m_instances;
+};
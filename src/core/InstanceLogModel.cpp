@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "InstanceLogModel.h"
+#include "Logging.h"
+
+#include <QDBusArgument>
+#include <QDBusPendingReply>
+#include <QTimer>
+
+InstanceLogModel::InstanceLogModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_pollTimer(new QTimer(this))
+{
+    m_pollTimer->setInterval(POLL_INTERVAL_MS);
+    connect(m_pollTimer, &QTimer::timeout, this, &InstanceLogModel::poll);
+}
+
+int InstanceLogModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_lines.size();
+}
+
+QVariant InstanceLogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_lines.size()) {
+        return QVariant();
+    }
+
+    const Line &line = m_lines.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+    case MessageRole:
+        return line.message;
+    case TimestampRole:
+        return line.timestamp;
+    case PriorityRole:
+        return line.priority;
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> InstanceLogModel::roleNames() const
+{
+    return {
+        {MessageRole, "message"},
+        {TimestampRole, "timestamp"},
+        {PriorityRole, "priority"},
+    };
+}
+
+void InstanceLogModel::setHelperClient(CouchPlayHelperClient *client)
+{
+    if (m_helperClient == client) {
+        return;
+    }
+    m_helperClient = client;
+    Q_EMIT helperClientChanged();
+    restart();
+}
+
+void InstanceLogModel::setUsername(const QString &username)
+{
+    if (m_username == username) {
+        return;
+    }
+    m_username = username;
+    Q_EMIT usernameChanged();
+    restart();
+}
+
+void InstanceLogModel::setActive(bool active)
+{
+    if (m_active == active) {
+        return;
+    }
+    m_active = active;
+    Q_EMIT activeChanged();
+
+    if (m_active) {
+        m_pollTimer->start();
+        poll();
+    } else {
+        m_pollTimer->stop();
+    }
+}
+
+void InstanceLogModel::setMaxLines(int maxLines)
+{
+    maxLines = qBound(1, maxLines, MAX_LINES_LIMIT);
+    if (m_maxLines == maxLines) {
+        return;
+    }
+    m_maxLines = maxLines;
+    Q_EMIT maxLinesChanged();
+    trim(m_maxLines);
+}
+
+void InstanceLogModel::clear()
+{
+    trim(0);
+}
+
+QString InstanceLogModel::text() const
+{
+    QStringList messages;
+    messages.reserve(m_lines.size());
+    for (const Line &line : m_lines) {
+        messages.append(line.message);
+    }
+    return messages.join(QLatin1Char('\n'));
+}
+
+void InstanceLogModel::append(const QVariantList &entries)
+{
+    if (entries.isEmpty()) {
+        return;
+    }
+
+    // A burst larger than the model: only its newest lines would survive
+    const qsizetype incoming = qMin<qsizetype>(entries.size(), m_maxLines);
+    trim(int(m_maxLines - incoming));
+
+    const qsizetype first = m_lines.size();
+    beginInsertRows(QModelIndex(), int(first), int(first + incoming - 1));
+    for (qsizetype i = entries.size() - incoming; i < entries.size(); ++i) {
+        const QVariantMap entry = qdbus_cast<QVariantMap>(entries.at(i));
+        Line line;
+        line.message = entry.value(QStringLiteral("message")).toString();
+        line.timestamp = entry.value(QStringLiteral("timestamp")).toLongLong();
+        line.priority = entry.value(QStringLiteral("priority"), 6).toInt();
+        m_lines.append(line);
+    }
+    endInsertRows();
+    Q_EMIT countChanged();
+}
+
+void InstanceLogModel::trim(int maxLines)
+{
+    const qsizetype excess = m_lines.size() - qMax(0, maxLines);
+    if (excess <= 0) {
+        return;
+    }
+    beginRemoveRows(QModelIndex(), 0, int(excess - 1));
+    m_lines.remove(0, excess);
+    endRemoveRows();
+    Q_EMIT countChanged();
+}
+
+void InstanceLogModel::restart()
+{
+    // A reply still in flight is for the old source
+    ++m_generation;
+    m_pending = false;
+    m_cursor.clear();
+    trim(0);
+    if (m_active) {
+        poll();
+    }
+}
+
+void InstanceLogModel::poll()
+{
+    if (!m_active || m_pending || !m_helperClient || !m_helperClient->isAvailable() || m_username.isEmpty()) {
+        return;
+    }
+
+    m_pending = true;
+    const quint64 generation = m_generation;
+    QDBusPendingReply<QVariantMap> call = m_helperClient->readInstanceLogAsync(m_username, m_cursor, m_maxLines);
+    CouchPlayHelperClient::awaitAll({call}, this, [this, generation, call]() {
+        if (generation != m_generation) {
+            return;
+        }
+        m_pending = false;
+
+        QDBusPendingReply<QVariantMap> reply = call;
+        if (reply.isError()) {
+            qCDebug(couchplayCore) << "Reading the log of" << m_username << "failed:" << reply.error().message();
+            return;
+        }
+        m_cursor = reply.value().value(QStringLiteral("cursor")).toString();
+        append(qdbus_cast<QVariantList>(reply.value().value(QStringLiteral("entries"))));
+    });
+}
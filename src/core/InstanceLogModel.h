@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QString>
+#include <qqmlintegration.h>
+
+#include "../dbus/CouchPlayHelperClient.h"
+
+class QTimer;
+
+/**
+ * @brief Tail of one player's instance output
+ *
+ * Instances log to the system journal (see CouchPlayHelper::ReadInstanceLog).
+ * Nothing is read until active is set, e.g. while a log view is open; then
+ * the model fetches the last maxLines entries and polls every
+ * POLL_INTERVAL_MS for what was logged since. Each poll lands as one row
+ * insertion, and rows past maxLines are dropped from the top in one
+ * removal, so a chatty game costs one model update per poll.
+ */
+class InstanceLogModel : public QAbstractListModel
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(CouchPlayHelperClient *helperClient READ helperClient WRITE setHelperClient NOTIFY helperClientChanged)
+    Q_PROPERTY(QString username READ username WRITE setUsername NOTIFY usernameChanged)
+    Q_PROPERTY(bool active READ isActive WRITE setActive NOTIFY activeChanged)
+    Q_PROPERTY(int maxLines READ maxLines WRITE setMaxLines NOTIFY maxLinesChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    static constexpr int POLL_INTERVAL_MS = 1000;
+    static constexpr int DEFAULT_MAX_LINES = 500;
+    static constexpr int MAX_LINES_LIMIT = 1000;  // CouchPlayHelper::MAX_LOG_LINES
+
+    enum Roles {
+        MessageRole = Qt::UserRole + 1,
+        TimestampRole,      // ms since the epoch
+        PriorityRole,       // syslog level, 3 and below are errors
+    };
+    Q_ENUM(Roles)
+
+    explicit InstanceLogModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    CouchPlayHelperClient *helperClient() const { return m_helperClient; }
+    void setHelperClient(CouchPlayHelperClient *client);
+    QString username() const { return m_username; }
+    void setUsername(const QString &username);
+    bool isActive() const { return m_active; }
+    void setActive(bool active);
+    int maxLines() const { return m_maxLines; }
+    void setMaxLines(int maxLines);
+    int count() const { return m_lines.size(); }
+
+    /**
+     * @brief Drop the rows; polling continues from the current position
+     */
+    Q_INVOKABLE void clear();
+
+    /**
+     * @brief All rows as one string, for copying
+     */
+    Q_INVOKABLE QString text() const;
+
+    /**
+     * @brief Add the "entries" of a ReadInstanceLog reply as one batch
+     */
+    void append(const QVariantList &entries);
+
+Q_SIGNALS:
+    void helperClientChanged();
+    void usernameChanged();
+    void activeChanged();
+    void maxLinesChanged();
+    void countChanged();
+
+private:
+    void poll();
+    void restart();
+    void trim(int maxLines);
+
+    struct Line {
+        QString message;
+        qint64 timestamp = 0;
+        int priority = 6;
+    };
+
+    CouchPlayHelperClient *m_helperClient = nullptr;
+    QString m_username;
+    bool m_active = false;
+    int m_maxLines = DEFAULT_MAX_LINES;
+    QList<Line> m_lines;
+    QTimer *m_pollTimer = nullptr;
+    QString m_cursor;
+    bool m_pending = false;
+    quint64 m_generation = 0;   // Bumped when the source changes, drops stale replies
+};
@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "InstancePool.h"
+#include "GamescopeInstance.h"
+#include "Logging.h"
+#include "UserDirectory.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QTimer>
+
+// Checks are cheap; twice a minute is plenty for minute-granularity timeouts
+static constexpr int CHECK_INTERVAL_MS = 30000;
+
+InstancePool::InstancePool(QObject *parent)
+    : QObject(parent)
+    , m_checkTimer(new QTimer(this))
+{
+    m_checkTimer->setInterval(CHECK_INTERVAL_MS);
+    connect(m_checkTimer, &QTimer::timeout, this, &InstancePool::checkEntries);
+}
+
+InstancePool::~InstancePool()
+{
+    clear();
+}
+
+void InstancePool::setEnabled(bool enabled)
+{
+    if (m_enabled != enabled) {
+        m_enabled = enabled;
+        if (!enabled) {
+            clear();
+        }
+        Q_EMIT enabledChanged();
+    }
+}
+
+void InstancePool::setPrelaunch(bool prelaunch)
+{
+    if (m_prelaunch != prelaunch) {
+        m_prelaunch = prelaunch;
+        Q_EMIT prelaunchChanged();
+    }
+}
+
+void InstancePool::setIdleTimeoutMinutes(int minutes)
+{
+    minutes = qMax(0, minutes);
+    if (m_idleTimeoutMinutes != minutes) {
+        m_idleTimeoutMinutes = minutes;
+        Q_EMIT idleTimeoutMinutesChanged();
+    }
+}
+
+void InstancePool::setMemoryLimitMb(int megabytes)
+{
+    megabytes = qMax(0, megabytes);
+    if (m_memoryLimitMb != megabytes) {
+        m_memoryLimitMb = megabytes;
+        Q_EMIT memoryLimitMbChanged();
+    }
+}
+
+QVariantList InstancePool::entriesAsVariant() const
+{
+    QVariantList list;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        const Entry &entry = it.value();
+        const std::optional<UserEntry> user = UserDirectory::instance().user(entry.username);
+
+        QVariantMap map;
+        map[QStringLiteral("index")] = it.key();
+        map[QStringLiteral("username")] = entry.username;
+        map[QStringLiteral("launched")] = entry.instance != nullptr;
+        map[QStringLiteral("windowId")] = entry.windowId;
+        map[QStringLiteral("idleSeconds")] = entry.idle.elapsed() / 1000;
+        map[QStringLiteral("memoryBytes")] = user ? userMemoryBytes(user->uid, m_cgroupRoot) : qint64(-1);
+        list.append(map);
+    }
+    return list;
+}
+
+void InstancePool::add(int index, const QString &username, const QString &key, GamescopeInstance *instance)
+{
+    if (m_entries.contains(index)) {
+        evict(index, QStringLiteral("replaced"));
+    }
+
+    Entry entry;
+    entry.username = username;
+    entry.key = key;
+    entry.instance = instance;
+    entry.idle.start();
+    if (instance) {
+        instance->setParent(this);
+    }
+    m_entries.insert(index, entry);
+
+    qCDebug(couchplayCore) << "Instance pool: player" << index << "(" << username << ")"
+                           << (instance ? "pre-launched" : "prepared");
+
+    if (!m_checkTimer->isActive()) {
+        m_checkTimer->start();
+    }
+    Q_EMIT entriesChanged();
+}
+
+bool InstancePool::matches(int index, const QString &key) const
+{
+    auto it = m_entries.constFind(index);
+    return it != m_entries.constEnd() && it->key == key;
+}
+
+GamescopeInstance *InstancePool::take(int index)
+{
+    auto it = m_entries.find(index);
+    if (it == m_entries.end()) {
+        return nullptr;
+    }
+
+    GamescopeInstance *instance = it->instance;
+    if (instance) {
+        instance->setParent(nullptr);
+    }
+    m_entries.erase(it);
+
+    if (m_entries.isEmpty()) {
+        m_checkTimer->stop();
+    }
+    Q_EMIT entriesChanged();
+    return instance;
+}
+
+QString InstancePool::windowId(int index) const
+{
+    return m_entries.value(index).windowId;
+}
+
+void InstancePool::setWindowId(int index, const QString &windowId)
+{
+    auto it = m_entries.find(index);
+    if (it != m_entries.end() && it->windowId != windowId) {
+        it->windowId = windowId;
+        Q_EMIT entriesChanged();
+    }
+}
+
+QStringList InstancePool::windowIds() const
+{
+    QStringList ids;
+    for (const Entry &entry : m_entries) {
+        if (!entry.windowId.isEmpty()) {
+            ids.append(entry.windowId);
+        }
+    }
+    return ids;
+}
+
+void InstancePool::evict(int index, const QString &reason)
+{
+    auto it = m_entries.find(index);
+    if (it == m_entries.end()) {
+        return;
+    }
+
+    const QString username = it->username;
+    GamescopeInstance *instance = it->instance;
+    m_entries.erase(it);
+
+    qCDebug(couchplayCore) << "Instance pool: evicting player" << index << "(" << username << ") -" << reason;
+    stopInstance(instance);
+
+    if (m_entries.isEmpty()) {
+        m_checkTimer->stop();
+    }
+    Q_EMIT evicted(index, username, reason);
+    Q_EMIT entriesChanged();
+}
+
+void InstancePool::clear()
+{
+    const QList<int> indexes = m_entries.keys();
+    for (int index : indexes) {
+        evict(index, QStringLiteral("cleared"));
+    }
+}
+
+void InstancePool::checkEntries()
+{
+    const qint64 idleLimitMs = qint64(m_idleTimeoutMinutes) * 60 * 1000;
+    const qint64 memoryLimit = qint64(m_memoryLimitMb) * 1024 * 1024;
+
+    QMap<int, QString> expired;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        // Helper-launched instances don't report their exit, look at the PID
+        if (it->instance && (!it->instance->isRunning()
+                             || !QFile::exists(QStringLiteral("/proc/%1").arg(it->instance->pid())))) {
+            expired.insert(it.key(), QStringLiteral("instance exited"));
+            continue;
+        }
+        if (idleLimitMs > 0 && it->idle.elapsed() >= idleLimitMs) {
+            expired.insert(it.key(), QStringLiteral("idle timeout"));
+            continue;
+        }
+        if (memoryLimit > 0) {
+            const std::optional<UserEntry> user = UserDirectory::instance().user(it->username);
+            const qint64 used = user ? userMemoryBytes(user->uid, m_cgroupRoot) : -1;
+            if (used > memoryLimit) {
+                expired.insert(it.key(), QStringLiteral("memory limit (%1 MiB used)").arg(used / (1024 * 1024)));
+            }
+        }
+    }
+
+    for (auto it = expired.constBegin(); it != expired.constEnd(); ++it) {
+        evict(it.key(), it.value());
+    }
+}
+
+QString InstancePool::launchKey(const QVariantMap &config)
+{
+    // Position is applied by the window manager, everything else is baked
+    // into the gamescope command line or the launched process
+    QStringList parts;
+    parts << config.value(QStringLiteral("username")).toString()
+          << GamescopeInstance::buildGamescopeArgs(config).join(QLatin1Char(' '))
+          << GamescopeInstance::buildGameCommand(config)
+          << GamescopeInstance::buildEnvironment(config).join(QLatin1Char(' '))
+          << config.value(QStringLiteral("presetWorkingDirectory")).toString();
+    return QString::fromLatin1(QCryptographicHash::hash(parts.join(QLatin1Char('\n')).toUtf8(),
+                                                        QCryptographicHash::Sha1).toHex());
+}
+
+qint64 InstancePool::userMemoryBytes(uid_t uid, const QString &cgroupRoot)
+{
+    QFile file(QStringLiteral("%1/user.slice/user-%2.slice/memory.current").arg(cgroupRoot).arg(uid));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    bool ok = false;
+    const qint64 bytes = file.readAll().trimmed().toLongLong(&ok);
+    return ok ? bytes : -1;
+}
+
+void InstancePool::stopInstance(GamescopeInstance *instance)
+{
+    if (!instance) {
+        return;
+    }
+    if (instance->isRunning()) {
+        instance->stop();
+    }
+    instance->deleteLater();
+}
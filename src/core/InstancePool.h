@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <qqmlintegration.h>
+
+#include <sys/types.h>
+
+class GamescopeInstance;
+class QTimer;
+
+/**
+ * @brief Warm standby entries for the players of the selected profile
+ *
+ * SessionRunner prepares each player ahead of time (linger, runtime socket
+ * ACLs, shared directory mounts, launcher ACLs) and, with prelaunch enabled,
+ * starts their gamescope instance hidden. Starting the session then takes the
+ * matching entry instead of launching from scratch, leaving only window
+ * placement.
+ *
+ * The pool only keeps the bookkeeping and eviction policy: entries idle for
+ * longer than idleTimeoutMinutes, or whose user's cgroup
+ * (user-UID.slice/memory.current) exceeds memoryLimitMb, are evicted and
+ * their instance stopped.
+ */
+class InstancePool : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("InstancePool is owned by SessionRunner")
+
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool prelaunch READ prelaunch WRITE setPrelaunch NOTIFY prelaunchChanged)
+    Q_PROPERTY(int idleTimeoutMinutes READ idleTimeoutMinutes WRITE setIdleTimeoutMinutes NOTIFY idleTimeoutMinutesChanged)
+    Q_PROPERTY(int memoryLimitMb READ memoryLimitMb WRITE setMemoryLimitMb NOTIFY memoryLimitMbChanged)
+    Q_PROPERTY(int count READ count NOTIFY entriesChanged)
+    Q_PROPERTY(QVariantList entries READ entriesAsVariant NOTIFY entriesChanged)
+
+public:
+    explicit InstancePool(QObject *parent = nullptr);
+    ~InstancePool() override;
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Also launch the instances, not just prepare the users
+     */
+    bool prelaunch() const { return m_prelaunch; }
+    void setPrelaunch(bool prelaunch);
+
+    /**
+     * @brief Evict entries unused for this long, 0 keeps them until the profile changes
+     */
+    int idleTimeoutMinutes() const { return m_idleTimeoutMinutes; }
+    void setIdleTimeoutMinutes(int minutes);
+
+    /**
+     * @brief Per-entry memory cap in MiB, 0 for none
+     */
+    int memoryLimitMb() const { return m_memoryLimitMb; }
+    void setMemoryLimitMb(int megabytes);
+
+    int count() const { return m_entries.size(); }
+    bool contains(int index) const { return m_entries.contains(index); }
+    QList<int> indexes() const { return m_entries.keys(); }
+    bool isLaunched(int index) const { return m_entries.value(index).instance != nullptr; }
+
+    /**
+     * @brief Entries as maps with "index", "username", "launched", "windowId",
+     *        "idleSeconds" and "memoryBytes" (-1 if unknown)
+     */
+    QVariantList entriesAsVariant() const;
+
+    /**
+     * @brief Record player @p index as prepared with @p key
+     *
+     * @p instance (optional) is the pre-launched instance; the pool takes
+     * ownership and stops it on eviction. Replaces an existing entry.
+     */
+    void add(int index, const QString &username, const QString &key, GamescopeInstance *instance = nullptr);
+
+    /**
+     * @brief True if player @p index is prepared with the same @p key
+     */
+    bool matches(int index, const QString &key) const;
+
+    /**
+     * @brief Remove the entry for @p index and hand its instance to the caller
+     * @return The pre-launched instance (ownership passes to the caller) or nullptr
+     */
+    GamescopeInstance *take(int index);
+
+    QString windowId(int index) const;
+    void setWindowId(int index, const QString &windowId);
+    QStringList windowIds() const;
+
+    /**
+     * @brief Drop the entry for @p index, stopping its instance
+     */
+    void evict(int index, const QString &reason);
+    void clear();
+
+    /**
+     * @brief Identity of a launch, everything except the window position
+     */
+    static QString launchKey(const QVariantMap &config);
+
+    /**
+     * @brief Memory charged to @p uid's user slice, -1 if unknown
+     */
+    static qint64 userMemoryBytes(uid_t uid, const QString &cgroupRoot = QStringLiteral("/sys/fs/cgroup"));
+
+    void setCgroupRoot(const QString &root) { m_cgroupRoot = root; }
+
+public Q_SLOTS:
+    /**
+     * @brief Apply the idle timeout and memory cap
+     */
+    void checkEntries();
+
+Q_SIGNALS:
+    void enabledChanged();
+    void prelaunchChanged();
+    void idleTimeoutMinutesChanged();
+    void memoryLimitMbChanged();
+    void entriesChanged();
+
+    /**
+     * @brief An entry was evicted; its instance (if any) has been stopped
+     */
+    void evicted(int index, const QString &username, const QString &reason);
+
+private:
+    struct Entry {
+        QString username;
+        QString key;
+        GamescopeInstance *instance = nullptr;
+        QString windowId;
+        QElapsedTimer idle;
+    };
+
+    static void stopInstance(GamescopeInstance *instance);
+
+    QMap<int, Entry> m_entries;
+    QTimer *m_checkTimer = nullptr;
+    QString m_cgroupRoot = QStringLiteral("/sys/fs/cgroup");
+    bool m_enabled = false;
+    bool m_prelaunch = false;
+    int m_idleTimeoutMinutes = 15;
+    int m_memoryLimitMb = 0;
+};
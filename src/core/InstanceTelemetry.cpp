@@ -0,0 +1,428 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "InstanceTelemetry.h"
+#include "CgroupStats.h"
+#include "Logging.h"
+#include "../dbus/CouchPlayHelperClient.h"
+
+#include <QDBusPendingReply>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+InstanceTelemetry::InstanceTelemetry(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+{
+    m_timer->setInterval(SAMPLE_INTERVAL_MS);
+    connect(m_timer, &QTimer::timeout, this, &InstanceTelemetry::sample);
+}
+
+InstanceTelemetry::~InstanceTelemetry()
+{
+    for (StatsPipe &pipe : m_pipes) {
+        closeStatsPipe(pipe);
+        unlink(pipe.path.toLocal8Bit().constData());
+    }
+}
+
+void InstanceTelemetry::track(int index, qint64 pid)
+{
+    if (pid <= 0) {
+        return;
+    }
+
+    Entry entry;
+    entry.pid = pid;
+    entry.history.reserve(HISTORY_SIZE);
+    m_entries.insert(index, entry);
+
+    if (!m_timer->isActive()) {
+        m_timer->start();
+    }
+    sample();
+}
+
+void InstanceTelemetry::untrack(int index)
+{
+    if (m_entries.remove(index) > 0) {
+        if (m_entries.isEmpty()) {
+            m_timer->stop();
+        }
+        Q_EMIT updated();
+    }
+}
+
+void InstanceTelemetry::clear()
+{
+    m_timer->stop();
+    if (!m_entries.isEmpty()) {
+        m_entries.clear();
+        Q_EMIT updated();
+    }
+}
+
+QString InstanceTelemetry::statsPipe(int index)
+{
+    auto existing = m_pipes.constFind(index);
+    if (existing != m_pipes.constEnd()) {
+        return existing->path;
+    }
+
+    const QString directory = m_statsDirectory.isEmpty()
+        ? QStringLiteral("/tmp/couchplay-%1").arg(getuid())
+        : m_statsDirectory;
+    const QByteArray dirPath = directory.toLocal8Bit();
+
+    // Players only need to reach the pipe, not list or replace it. Refuse a
+    // directory someone else created in /tmp.
+    struct stat st {};
+    if (mkdir(dirPath.constData(), 0711) != 0 && errno != EEXIST) {
+        qCWarning(couchplayCore) << "Telemetry: Cannot create" << directory << ":" << strerror(errno);
+        return QString();
+    }
+    if (lstat(dirPath.constData(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != getuid()) {
+        qCWarning(couchplayCore) << "Telemetry: Not using" << directory << "- not a directory owned by us";
+        return QString();
+    }
+    chmod(dirPath.constData(), 0711);
+
+    StatsPipe pipe;
+    pipe.path = QStringLiteral("%1/stats-%2").arg(directory).arg(index);
+    const QByteArray path = pipe.path.toLocal8Bit();
+    unlink(path.constData());
+    if (mkfifo(path.constData(), 0600) != 0 || chmod(path.constData(), 0622) != 0) {
+        qCWarning(couchplayCore) << "Telemetry: Cannot create" << pipe.path << ":" << strerror(errno);
+        return QString();
+    }
+
+    pipe.readFd = open(path.constData(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    pipe.writeFd = pipe.readFd >= 0 ? open(path.constData(), O_WRONLY | O_NONBLOCK | O_CLOEXEC) : -1;
+    if (pipe.writeFd < 0) {
+        qCWarning(couchplayCore) << "Telemetry: Cannot open" << pipe.path << ":" << strerror(errno);
+        closeStatsPipe(pipe);
+        unlink(path.constData());
+        return QString();
+    }
+
+    pipe.notifier = new QSocketNotifier(pipe.readFd, QSocketNotifier::Read, this);
+    connect(pipe.notifier, &QSocketNotifier::activated, this, [this, index]() {
+        readStatsPipe(index);
+    });
+    m_pipes.insert(index, pipe);
+    return pipe.path;
+}
+
+QVariantMap InstanceTelemetry::latest(int index) const
+{
+    QVariantMap map;
+    auto it = m_entries.constFind(index);
+    if (it == m_entries.constEnd()) {
+        return map;
+    }
+
+    const Sample *last = lastSample(it.value());
+    const Sample sample = last ? *last : Sample();
+    map[QStringLiteral("index")] = index;
+    map[QStringLiteral("cpuPercent")] = sample.cpuPercent;
+    map[QStringLiteral("rssBytes")] = sample.rssBytes;
+    map[QStringLiteral("memoryBytes")] = sample.memoryBytes;
+    map[QStringLiteral("gpuPercent")] = sample.gpuPercent;
+    map[QStringLiteral("gpuMemoryBytes")] = sample.gpuMemoryBytes;
+    map[QStringLiteral("fps")] = sample.fps;
+    return map;
+}
+
+QVariantList InstanceTelemetry::latestAsVariant() const
+{
+    QVariantList list;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        list.append(latest(it.key()));
+    }
+    return list;
+}
+
+QVariantList InstanceTelemetry::history(int index, const QString &metric) const
+{
+    QVariantList values;
+    auto it = m_entries.constFind(index);
+    if (it == m_entries.constEnd()) {
+        return values;
+    }
+
+    const Entry &entry = it.value();
+    const qsizetype count = entry.history.size();
+    values.reserve(count);
+    for (qsizetype i = 0; i < count; ++i) {
+        const Sample &sample = entry.history.at((entry.next + i) % count);
+        if (metric == QLatin1String("cpuPercent")) {
+            values.append(sample.cpuPercent);
+        } else if (metric == QLatin1String("rssBytes")) {
+            values.append(sample.rssBytes);
+        } else if (metric == QLatin1String("memoryBytes")) {
+            values.append(sample.memoryBytes);
+        } else if (metric == QLatin1String("gpuPercent")) {
+            values.append(sample.gpuPercent);
+        } else if (metric == QLatin1String("gpuMemoryBytes")) {
+            values.append(sample.gpuMemoryBytes);
+        } else if (metric == QLatin1String("fps")) {
+            values.append(sample.fps);
+        } else {
+            return QVariantList();
+        }
+    }
+    return values;
+}
+
+qint64 InstanceTelemetry::processCpuTimeUs(qint64 pid, const QString &procRoot)
+{
+    QFile file(QStringLiteral("%1/%2/stat").arg(procRoot).arg(pid));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+
+    // The command name may contain spaces and parentheses, fields follow the last ')'
+    const QByteArray stat = file.readAll();
+    const int end = stat.lastIndexOf(')');
+    if (end < 0) {
+        return -1;
+    }
+    const QList<QByteArray> fields = stat.mid(end + 2).split(' ');
+    if (fields.size() < 13) {
+        return -1;
+    }
+    // Fields 14 and 15 (utime, stime); fields[0] is field 3 (state)
+    const qint64 ticks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+    static const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    return ticksPerSecond > 0 ? ticks * 1000000 / ticksPerSecond : -1;
+}
+
+qint64 InstanceTelemetry::processRssBytes(qint64 pid, const QString &procRoot)
+{
+    QFile file(QStringLiteral("%1/%2/statm").arg(procRoot).arg(pid));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    const QList<QByteArray> fields = file.readAll().trimmed().split(' ');
+    bool ok = false;
+    const qint64 pages = fields.value(1).toLongLong(&ok);
+    static const long pageSize = sysconf(_SC_PAGESIZE);
+    return ok ? pages * pageSize : -1;
+}
+
+double InstanceTelemetry::parseStatsFps(const QByteArray &data)
+{
+    double fps = -1.0;
+    const QList<QByteArray> lines = data.split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith("fps=")) {
+            bool ok = false;
+            const double value = line.mid(4).trimmed().toDouble(&ok);
+            if (ok && value >= 0.0) {
+                fps = value;
+            }
+        }
+    }
+    return fps;
+}
+
+void InstanceTelemetry::sample()
+{
+    sampleAt(nowUs());
+}
+
+void InstanceTelemetry::sampleAt(qint64 nowUs)
+{
+    if (m_entries.isEmpty()) {
+        return;
+    }
+
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        Entry &entry = it.value();
+        const Sample sample = sampleEntry(it.key(), entry, nowUs);
+        if (entry.history.size() < HISTORY_SIZE) {
+            entry.history.append(sample);
+        } else {
+            entry.history[entry.next] = sample;
+            entry.next = (entry.next + 1) % HISTORY_SIZE;
+        }
+    }
+    Q_EMIT updated();
+}
+
+InstanceTelemetry::Sample InstanceTelemetry::sampleEntry(int index, Entry &entry, qint64 nowUs)
+{
+    Sample sample;
+    sample.timeUs = nowUs;
+
+    const QString cgroup = CgroupStats::cgroupOf(entry.pid, m_procRoot);
+    const QList<qint64> pids = DrmFdinfo::processTree(entry.pid, m_procRoot, m_cgroupRoot);
+    const bool ownUnit = pids.size() > 1 || (cgroup.contains(QLatin1String("/couchplay-"))
+                                             && cgroup.endsWith(QLatin1String(".service")));
+
+    // CPU: the unit's cgroup counts every process of the instance; without
+    // one (machinectl fallback) only gamescope itself can be attributed
+    qint64 cpuTimeUs = -1;
+    if (ownUnit) {
+        const CgroupStats::Usage usage = CgroupStats::readUsage(cgroup, m_cgroupRoot);
+        cpuTimeUs = usage.cpuUsageUs;
+        sample.memoryBytes = usage.memoryBytes;
+    }
+    if (cpuTimeUs < 0) {
+        cpuTimeUs = processCpuTimeUs(entry.pid, m_procRoot);
+    }
+    if (cpuTimeUs >= 0 && entry.cpuTimeUs >= 0 && cpuTimeUs >= entry.cpuTimeUs && nowUs > entry.timeUs) {
+        sample.cpuPercent = 100.0 * double(cpuTimeUs - entry.cpuTimeUs) / double(nowUs - entry.timeUs);
+    }
+    entry.cpuTimeUs = cpuTimeUs;
+    entry.timeUs = nowUs;
+
+    qint64 rss = -1;
+    for (qint64 pid : pids) {
+        const qint64 bytes = processRssBytes(pid, m_procRoot);
+        if (bytes >= 0) {
+            rss = qMax<qint64>(rss, 0) + bytes;
+        }
+    }
+    sample.rssBytes = rss;
+
+    // GPU: read fdinfo ourselves when we may, otherwise use the helper's last answer
+    DrmFdinfo drm;
+    qint64 gpuTimeUs = nowUs;
+    if (!entry.remoteGpu) {
+        drm = DrmFdinfo::read(pids, m_procRoot);
+        if (drm.clients == 0 && m_helperClient
+            && QFileInfo(QStringLiteral("%1/%2").arg(m_procRoot).arg(entry.pid)).ownerId() != getuid()) {
+            entry.remoteGpu = true;
+        }
+    }
+    if (entry.remoteGpu) {
+        drm = entry.remoteUsage;
+        gpuTimeUs = entry.remoteTimeUs;
+        requestRemoteGpu(index);
+    }
+    if (drm.clients > 0) {
+        if (gpuTimeUs > entry.gpuTimeUs && entry.gpuTimeUs >= 0) {
+            double busiest = 0.0;
+            for (auto it = drm.engineNs.constBegin(); it != drm.engineNs.constEnd(); ++it) {
+                const qint64 previous = entry.engineNs.value(it.key(), -1);
+                if (previous >= 0 && it.value() >= previous) {
+                    const double percent = 100.0 * double(it.value() - previous) / (1000.0 * double(gpuTimeUs - entry.gpuTimeUs));
+                    busiest = qMax(busiest, qMin(percent, 100.0));
+                }
+            }
+            sample.gpuPercent = busiest;
+        } else if (const Sample *last = lastSample(entry)) {
+            sample.gpuPercent = last->gpuPercent;
+        }
+        sample.gpuMemoryBytes = drm.memoryBytes;
+        if (gpuTimeUs != entry.gpuTimeUs) {
+            entry.engineNs = drm.engineNs;
+            entry.gpuTimeUs = gpuTimeUs;
+        }
+    }
+
+    auto pipe = m_pipes.constFind(index);
+    if (pipe != m_pipes.constEnd() && pipe->updatedUs >= 0 && nowUs - pipe->updatedUs <= FPS_STALE_US) {
+        sample.fps = pipe->fps;
+    }
+
+    return sample;
+}
+
+const InstanceTelemetry::Sample *InstanceTelemetry::lastSample(const Entry &entry) const
+{
+    if (entry.history.isEmpty()) {
+        return nullptr;
+    }
+    const qsizetype last = entry.history.size() < HISTORY_SIZE ? entry.history.size() - 1
+                                                                : (entry.next + HISTORY_SIZE - 1) % HISTORY_SIZE;
+    return &entry.history.at(last);
+}
+
+void InstanceTelemetry::requestRemoteGpu(int index)
+{
+    auto it = m_entries.find(index);
+    if (it == m_entries.end() || it->remotePending || !m_helperClient || !m_helperClient->isAvailable()) {
+        return;
+    }
+
+    it->remotePending = true;
+    const qint64 pid = it->pid;
+    QDBusPendingReply<QVariantMap> call = m_helperClient->instanceGpuUsageAsync(pid);
+    CouchPlayHelperClient::awaitAll({call}, this, [this, index, pid, call]() {
+        auto entry = m_entries.find(index);
+        if (entry == m_entries.end() || entry->pid != pid) {
+            return;
+        }
+        entry->remotePending = false;
+        QDBusPendingReply<QVariantMap> reply = call;
+        if (reply.isError()) {
+            return;
+        }
+        entry->remoteUsage = DrmFdinfo::fromVariantMap(reply.value());
+        entry->remoteTimeUs = nowUs();
+    });
+}
+
+void InstanceTelemetry::readStatsPipe(int index)
+{
+    auto it = m_pipes.find(index);
+    if (it == m_pipes.end() || it->readFd < 0) {
+        return;
+    }
+
+    char buffer[4096];
+    while (true) {
+        const ssize_t bytes = read(it->readFd, buffer, sizeof(buffer));
+        if (bytes <= 0) {
+            break;
+        }
+        it->partial.append(buffer, bytes);
+    }
+
+    // Only complete lines count; a stuck writer can't grow the buffer unbounded
+    const qsizetype end = it->partial.lastIndexOf('\n');
+    if (end >= 0) {
+        const double fps = parseStatsFps(it->partial.left(end));
+        if (fps >= 0.0) {
+            it->fps = fps;
+            it->updatedUs = nowUs();
+        }
+        it->partial.remove(0, end + 1);
+    }
+    if (it->partial.size() > 4096) {
+        it->partial.clear();
+    }
+}
+
+void InstanceTelemetry::closeStatsPipe(StatsPipe &pipe)
+{
+    delete pipe.notifier;
+    pipe.notifier = nullptr;
+    if (pipe.readFd >= 0) {
+        close(pipe.readFd);
+        pipe.readFd = -1;
+    }
+    if (pipe.writeFd >= 0) {
+        close(pipe.writeFd);
+        pipe.writeFd = -1;
+    }
+}
+
+qint64 InstanceTelemetry::nowUs() const
+{
+    struct timespec ts {};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
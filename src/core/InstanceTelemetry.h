@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <qqmlintegration.h>
+
+#include "../../helper/DrmFdinfo.h"
+
+class CouchPlayHelperClient;
+class QSocketNotifier;
+class QTimer;
+
+/**
+ * @brief Cached per-instance resource telemetry with short history
+ *
+ * Samples every tracked instance once a second and keeps the results, so
+ * readers (QML bindings, SessionRunner::instances) never touch procfs:
+ * - CPU share and memory from the instance's cgroup when it runs in its own
+ *   couchplay-*.service, otherwise from /proc/PID/stat of gamescope alone
+ * - RSS summed over the instance's processes (/proc/PID/statm)
+ * - GPU engine busy time and VRAM from the DRM fdinfo of those processes;
+ *   other users' fdinfo is only readable by root, so for those it comes
+ *   from the helper's GetInstanceGpuUsage(), one sample behind
+ * - Frame rate from gamescope's --stats-path pipe (see statsPipe())
+ *
+ * The last HISTORY_SIZE samples per instance are kept in a ring buffer for
+ * graphs, see history().
+ */
+class InstanceTelemetry : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("InstanceTelemetry is owned by SessionRunner")
+
+    Q_PROPERTY(QVariantList latest READ latestAsVariant NOTIFY updated)
+
+public:
+    static constexpr int SAMPLE_INTERVAL_MS = 1000;
+    static constexpr int HISTORY_SIZE = 120;    // Two minutes of samples
+    static constexpr qint64 FPS_STALE_US = 5000000; // Frame rate unknown after this long without stats
+
+    struct Sample {
+        qint64 timeUs = 0;            // Monotonic sample time
+        double cpuPercent = 0.0;      // Share of one core
+        qint64 rssBytes = -1;         // -1 if unknown
+        qint64 memoryBytes = -1;      // cgroup memory.current, includes page cache
+        double gpuPercent = -1.0;     // Busiest engine
+        qint64 gpuMemoryBytes = -1;
+        double fps = -1.0;
+    };
+
+    explicit InstanceTelemetry(QObject *parent = nullptr);
+    ~InstanceTelemetry() override;
+
+    /**
+     * @brief Start sampling instance @p index running as @p pid
+     */
+    void track(int index, qint64 pid);
+    void untrack(int index);
+    bool isTracking(int index) const { return m_entries.contains(index); }
+
+    /**
+     * @brief Stop sampling all instances and drop their history
+     *
+     * Stats pipes stay open so instances launched with them (standby) can
+     * keep writing.
+     */
+    void clear();
+
+    /**
+     * @brief Path of the stats FIFO for instance @p index, for gamescope's --stats-path
+     *
+     * Created on first use in a directory owned by the current user and kept
+     * open for reading (and by a writer of our own, so it never hits EOF)
+     * until the telemetry is destroyed. That way gamescope's open() of the
+     * pipe never blocks, and its writes never fill it up.
+     *
+     * @return The path, empty if the pipe can't be created
+     */
+    QString statsPipe(int index);
+
+    /**
+     * @brief Latest sample of instance @p index as a map
+     *
+     * Keys: "index", "cpuPercent", "rssBytes", "memoryBytes", "gpuPercent",
+     * "gpuMemoryBytes", "fps" (negative if unknown). Empty if not tracked.
+     */
+    QVariantMap latest(int index) const;
+    QVariantList latestAsVariant() const;
+
+    /**
+     * @brief Recent values of @p metric (a key of latest()) for instance @p index, oldest first
+     */
+    Q_INVOKABLE QVariantList history(int index, const QString &metric) const;
+
+    /**
+     * @brief utime + stime of @p pid in microseconds, -1 if unknown
+     */
+    static qint64 processCpuTimeUs(qint64 pid, const QString &procRoot);
+
+    /**
+     * @brief Resident set size of @p pid, -1 if unknown
+     */
+    static qint64 processRssBytes(qint64 pid, const QString &procRoot);
+
+    /**
+     * @brief Most recent "fps=" value in a chunk of gamescope stats output, -1 if none
+     */
+    static double parseStatsFps(const QByteArray &data);
+
+    /**
+     * @brief Helper used for GPU usage of instances running as other users
+     */
+    void setHelperClient(CouchPlayHelperClient *client) { m_helperClient = client; }
+
+    void setProcRoot(const QString &root) { m_procRoot = root; }
+    void setCgroupRoot(const QString &root) { m_cgroupRoot = root; }
+    void setStatsDirectory(const QString &directory) { m_statsDirectory = directory; }
+
+public Q_SLOTS:
+    /**
+     * @brief Sample all tracked instances now
+     */
+    void sample();
+
+    /**
+     * @brief Sample all tracked instances at @p nowUs (monotonic), for tests
+     */
+    void sampleAt(qint64 nowUs);
+
+Q_SIGNALS:
+    void updated();
+
+private:
+    struct Entry {
+        qint64 pid = 0;
+        qint64 cpuTimeUs = -1;
+        qint64 timeUs = -1;
+        QHash<QString, qint64> engineNs;
+        qint64 gpuTimeUs = -1;        // When engineNs was read
+        bool remoteGpu = false;       // fdinfo only readable by the helper
+        bool remotePending = false;
+        DrmFdinfo remoteUsage;
+        qint64 remoteTimeUs = -1;
+        QList<Sample> history;
+        int next = 0;                 // Oldest slot once history is full
+    };
+
+    struct StatsPipe {
+        QString path;
+        int readFd = -1;
+        int writeFd = -1;
+        QSocketNotifier *notifier = nullptr;
+        QByteArray partial;           // Incomplete last line
+        double fps = -1.0;
+        qint64 updatedUs = -1;
+    };
+
+    Sample sampleEntry(int index, Entry &entry, qint64 nowUs);
+    const Sample *lastSample(const Entry &entry) const;
+    void requestRemoteGpu(int index);
+    void readStatsPipe(int index);
+    void closeStatsPipe(StatsPipe &pipe);
+    qint64 nowUs() const;
+
+    QMap<int, Entry> m_entries;
+    QHash<int, StatsPipe> m_pipes;
+    QTimer *m_timer = nullptr;
+    CouchPlayHelperClient *m_helperClient = nullptr;
+    QString m_procRoot = QStringLiteral("/proc");
+    QString m_cgroupRoot = QStringLiteral("/sys/fs/cgroup");
+    QString m_statsDirectory;         // Default /tmp/couchplay-UID
+};
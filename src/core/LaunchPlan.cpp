@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "LaunchPlan.h"
+#include "DeviceManager.h"
+#include "Logging.h"
+#include "UserDirectory.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+static QJsonArray toJsonArray(const QStringList &list)
+{
+    return QJsonArray::fromStringList(list);
+}
+
+static QStringList toStringList(const QJsonValue &value)
+{
+    QStringList list;
+    for (const QJsonValue &entry : value.toArray()) {
+        list << entry.toString();
+    }
+    return list;
+}
+
+static QString readSysfs(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromUtf8(file.readAll()).trimmed();
+}
+
+QVariantMap LaunchPlan::Instance::launchConfig() const
+{
+    QVariantMap result = config;
+    result[QStringLiteral("launchArgs")] = gamescopeArgs;
+    result[QStringLiteral("launchCommand")] = gameCommand;
+    result[QStringLiteral("launchEnvironment")] = environment;
+    return result;
+}
+
+QString LaunchPlan::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/last-session.json");
+}
+
+LaunchPlan LaunchPlan::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return LaunchPlan();
+    }
+    const QJsonObject json = QJsonDocument::fromJson(file.readAll()).object();
+    if (json.value(QStringLiteral("version")).toInt() != VERSION) {
+        return LaunchPlan();
+    }
+    return fromJson(json);
+}
+
+bool LaunchPlan::save(const QString &path) const
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(couchplayCore) << "LaunchPlan: failed to save" << path;
+        return false;
+    }
+    file.write(QJsonDocument(toJson()).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+QJsonObject LaunchPlan::toJson() const
+{
+    QJsonArray instanceArray;
+    for (const Instance &instance : instances) {
+        QJsonArray deviceArray;
+        for (const Device &device : instance.devices) {
+            deviceArray.append(QJsonObject{
+                {QStringLiteral("stableId"), device.stableId},
+                {QStringLiteral("path"), device.path},
+            });
+        }
+
+        QJsonObject obj;
+        obj[QStringLiteral("config")] = QJsonObject::fromVariantMap(instance.config);
+        obj[QStringLiteral("gamescopeArgs")] = toJsonArray(instance.gamescopeArgs);
+        obj[QStringLiteral("gameCommand")] = instance.gameCommand;
+        obj[QStringLiteral("environment")] = toJsonArray(instance.environment);
+        obj[QStringLiteral("devices")] = deviceArray;
+        obj[QStringLiteral("sharedDirectories")] = toJsonArray(instance.sharedDirectories);
+        obj[QStringLiteral("aclPaths")] = toJsonArray(instance.aclPaths);
+        obj[QStringLiteral("sharedCaches")] = toJsonArray(instance.sharedCaches);
+        instanceArray.append(obj);
+    }
+
+    QJsonObject json;
+    json[QStringLiteral("version")] = VERSION;
+    json[QStringLiteral("profile")] = profileName;
+    json[QStringLiteral("profileHash")] = QString::fromLatin1(profileHash.toHex());
+    json[QStringLiteral("instances")] = instanceArray;
+    return json;
+}
+
+LaunchPlan LaunchPlan::fromJson(const QJsonObject &json)
+{
+    LaunchPlan plan;
+    plan.profileName = json.value(QStringLiteral("profile")).toString();
+    plan.profileHash = QByteArray::fromHex(json.value(QStringLiteral("profileHash")).toString().toLatin1());
+
+    for (const QJsonValue &value : json.value(QStringLiteral("instances")).toArray()) {
+        const QJsonObject obj = value.toObject();
+        Instance instance;
+        instance.config = obj.value(QStringLiteral("config")).toObject().toVariantMap();
+        instance.gamescopeArgs = toStringList(obj.value(QStringLiteral("gamescopeArgs")));
+        instance.gameCommand = obj.value(QStringLiteral("gameCommand")).toString();
+        instance.environment = toStringList(obj.value(QStringLiteral("environment")));
+        for (const QJsonValue &entry : obj.value(QStringLiteral("devices")).toArray()) {
+            const QJsonObject device = entry.toObject();
+            instance.devices.append({device.value(QStringLiteral("stableId")).toString(),
+                                     device.value(QStringLiteral("path")).toString()});
+        }
+        instance.sharedDirectories = toStringList(obj.value(QStringLiteral("sharedDirectories")));
+        instance.aclPaths = toStringList(obj.value(QStringLiteral("aclPaths")));
+        instance.sharedCaches = toStringList(obj.value(QStringLiteral("sharedCaches")));
+        plan.instances.append(instance);
+    }
+    return plan;
+}
+
+QString LaunchPlan::validate(const QString &sysfsRoot) const
+{
+    if (isEmpty()) {
+        return QStringLiteral("no instances");
+    }
+
+    for (int i = 0; i < instances.size(); ++i) {
+        const Instance &instance = instances[i];
+
+        const QString username = instance.config.value(QStringLiteral("username")).toString();
+        if (!username.isEmpty() && !UserDirectory::instance().user(username)) {
+            return QStringLiteral("user %1 no longer exists").arg(username);
+        }
+
+        if (instance.gamescopeArgs.isEmpty() || instance.gameCommand.isEmpty()) {
+            return QStringLiteral("instance %1 has no command line").arg(i);
+        }
+
+        for (const Device &device : instance.devices) {
+            const QString stableId = stableIdFor(device.path, sysfsRoot);
+            if (stableId.isEmpty()) {
+                return QStringLiteral("%1 is gone").arg(device.path);
+            }
+            if (stableId != device.stableId) {
+                return QStringLiteral("%1 is a different device now").arg(device.path);
+            }
+        }
+
+        QStringList paths = instance.aclPaths + instance.sharedCaches;
+        const QString workingDirectory = instance.config.value(QStringLiteral("presetWorkingDirectory")).toString();
+        if (!workingDirectory.isEmpty()) {
+            paths << workingDirectory;
+        }
+        const QString renderNode = instance.config.value(QStringLiteral("gpuRenderNode")).toString();
+        if (!renderNode.isEmpty()) {
+            paths << renderNode;
+        }
+        for (const QString &spec : instance.sharedDirectories) {
+            // "source|alias|mode", source absolute or relative to our home
+            paths << QDir::home().filePath(spec.section(QLatin1Char('|'), 0, 0));
+        }
+        for (const QString &path : std::as_const(paths)) {
+            if (!QFileInfo::exists(path)) {
+                return QStringLiteral("%1 is missing").arg(path);
+            }
+        }
+    }
+    return QString();
+}
+
+QString LaunchPlan::stableIdFor(const QString &devicePath, const QString &sysfsRoot)
+{
+    const QString node = QFileInfo(devicePath).fileName();
+    if (!node.startsWith(QLatin1String("event")) || !QFileInfo::exists(devicePath)) {
+        return QString();
+    }
+
+    // /sys/class/input/eventN/device is the inputN the node belongs to
+    const QString inputDir = sysfsRoot + QStringLiteral("/class/input/") + node + QStringLiteral("/device");
+    return DeviceManager::generateStableId(readSysfs(inputDir + QStringLiteral("/id/vendor")),
+                                           readSysfs(inputDir + QStringLiteral("/id/product")),
+                                           readSysfs(inputDir + QStringLiteral("/phys")));
+}
+
+QByteArray LaunchPlan::fileHash(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha1);
+}
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+/**
+ * @brief Fully resolved start of a session, to resume it without discovery
+ *
+ * SessionRunner records one after every successful start: per player the
+ * instance config with its preset already resolved, the gamescope command
+ * line, environment and game command built from it, the devices by
+ * stableId and node, and the mounts, ACL paths and caches of the prepare
+ * stage. Resuming launches exactly that, skipping preset lookup, Steam and
+ * Heroic detection and shortcut scanning.
+ *
+ * Before that, validate() checks the plan still holds with stat()s and a
+ * few sysfs reads, no device enumeration; anything off and the session is
+ * started the regular way instead.
+ */
+class LaunchPlan
+{
+public:
+    static constexpr int VERSION = 1;
+
+    struct Device {
+        QString stableId;
+        QString path;       // /dev/input/eventN when the plan was recorded
+    };
+
+    struct Instance {
+        QVariantMap config;             // As given to GamescopeInstance::start()
+        QStringList gamescopeArgs;
+        QString gameCommand;
+        QStringList environment;
+        QList<Device> devices;
+        QStringList sharedDirectories;  // PrepareInstanceSpec fields
+        QStringList aclPaths;
+        QStringList sharedCaches;
+
+        /**
+         * @brief config carrying the recorded command line, see GamescopeInstance::start()
+         */
+        QVariantMap launchConfig() const;
+    };
+
+    QString profileName;
+    QByteArray profileHash;  // Of the profile file; any edit invalidates the plan
+    QList<Instance> instances;
+
+    bool isEmpty() const { return instances.isEmpty(); }
+
+    /**
+     * @brief Where the last session's plan is kept
+     */
+    static QString defaultPath();
+
+    /**
+     * @brief Read a plan, empty if there is none or it's from another version
+     */
+    static LaunchPlan load(const QString &path);
+    bool save(const QString &path) const;
+
+    QJsonObject toJson() const;
+    static LaunchPlan fromJson(const QJsonObject &json);
+
+    /**
+     * @brief Why the plan can't be launched as recorded, empty if it can
+     *
+     * Every device node must still be the same device (its stableId read
+     * back from sysfs), and the players, working directories, shared
+     * directories, ACL paths, caches and GPU render nodes must still exist.
+     */
+    QString validate(const QString &sysfsRoot = QStringLiteral("/sys")) const;
+
+    /**
+     * @brief stableId of @p devicePath as DeviceManager forms it, from sysfs
+     *
+     * Empty if the node doesn't exist.
+     */
+    static QString stableIdFor(const QString &devicePath, const QString &sysfsRoot = QStringLiteral("/sys"));
+
+    /**
+     * @brief SHA-1 of the file at @p path, empty if it can't be read
+     */
+    static QByteArray fileHash(const QString &path);
+};
@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "MonitorLayout.h"
+
+#include <algorithm>
+
+QList<MonitorLayout::Slot> MonitorLayout::assign(int instanceCount,
+                                                 const QList<MonitorManager::MonitorInfo> &monitors)
+{
+    QList<Slot> result;
+    if (instanceCount < 1 || monitors.isEmpty()) {
+        return result;
+    }
+
+    QList<MonitorManager::MonitorInfo> ordered = monitors;
+    std::stable_sort(ordered.begin(), ordered.end(), [](const auto &a, const auto &b) {
+        if (a.primary != b.primary) {
+            return a.primary;
+        }
+        if (a.geometry.x() != b.geometry.x()) {
+            return a.geometry.x() < b.geometry.x();
+        }
+        return a.geometry.y() < b.geometry.y();
+    });
+
+    const int monitorCount = qMin<int>(ordered.size(), instanceCount);
+    const int perMonitor = instanceCount / monitorCount;
+    const int extra = instanceCount % monitorCount;
+
+    for (int m = 0; m < monitorCount; ++m) {
+        const MonitorManager::MonitorInfo &monitor = ordered.at(m);
+        const QRect area = monitor.geometry.isValid()
+            ? monitor.geometry
+            : QRect(0, 0, monitor.width, monitor.height);
+        // Device pixels per logical pixel, per axis
+        const double scaleX = area.width() > 0 && monitor.nativeSize.isValid()
+            ? double(monitor.nativeSize.width()) / area.width() : 1.0;
+        const double scaleY = area.height() > 0 && monitor.nativeSize.isValid()
+            ? double(monitor.nativeSize.height()) / area.height() : 1.0;
+
+        const QList<QRect> tiles = split(area, perMonitor + (m < extra ? 1 : 0));
+        for (const QRect &tile : tiles) {
+            Slot slot;
+            slot.geometry = tile;
+            slot.nativeSize = QSize(qRound(tile.width() * scaleX), qRound(tile.height() * scaleY));
+            slot.monitor = monitor.index;
+            slot.output = monitor.connector;
+            slot.refreshRate = monitor.refreshRate;
+            result.append(slot);
+        }
+    }
+
+    return result;
+}
+
+QList<QRect> MonitorLayout::split(const QRect &area, int count)
+{
+    QList<QRect> tiles;
+    if (count < 1) {
+        return tiles;
+    }
+
+    if (count == 4) {
+        const int w = area.width() / 2;
+        const int h = area.height() / 2;
+        for (int i = 0; i < 4; ++i) {
+            tiles.append(QRect(area.x() + (i % 2) * w, area.y() + (i / 2) * h, w, h));
+        }
+        return tiles;
+    }
+
+    const bool sideBySide = area.width() >= area.height();
+    for (int i = 0; i < count; ++i) {
+        if (sideBySide) {
+            const int w = area.width() / count;
+            tiles.append(QRect(area.x() + i * w, area.y(), w, area.height()));
+        } else {
+            const int h = area.height() / count;
+            tiles.append(QRect(area.x(), area.y() + i * h, area.width(), h));
+        }
+    }
+    return tiles;
+}
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QList>
+#include <QRect>
+#include <QSize>
+#include <QString>
+
+#include "MonitorManager.h"
+
+/**
+ * @brief Places instances across all monitors for the "multi-monitor" layout
+ *
+ * Every monitor gets an even share of the instances, the primary monitor
+ * first, then left to right. An instance alone on a monitor covers it at
+ * the monitor's native mode and refresh rate; monitors holding several are
+ * split along their longer side (2x2 for four). Each slot names its
+ * monitor's connector for gamescope's --prefer-output, so no instance is
+ * scaled across displays.
+ */
+class MonitorLayout
+{
+public:
+    struct Slot {
+        QRect geometry;       // Logical window geometry in the desktop
+        QSize nativeSize;     // Same area in device pixels, to render at
+        int monitor = -1;     // MonitorInfo::index, -1 if not on a known monitor
+        QString output;       // Connector, empty if unknown
+        int refreshRate = 0;  // 0 if unknown
+    };
+
+    /**
+     * @brief Slots for @p instanceCount instances over @p monitors
+     * @return One slot per instance, empty if there are no monitors
+     */
+    static QList<Slot> assign(int instanceCount, const QList<MonitorManager::MonitorInfo> &monitors);
+
+    /**
+     * @brief Split @p area into @p count tiles along its longer side, 2x2 for four
+     */
+    static QList<QRect> split(const QRect &area, int count);
+};
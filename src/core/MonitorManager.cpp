@@ -2,6 +2,7 @@
 // SPDX-FileCopyrightText: 2024 hikaps
 
 #include "MonitorManager.h"
+#include "StartupTrace.h"
 
 #include <QGuiApplication>
 #include <QScreen>
@@ -10,11 +11,13 @@
 MonitorManager::MonitorManager(QObject *parent)
     : QObject(parent)
 {
+    StartupTrace::Scope trace("MonitorManager");
     refresh();
 
     // Connect to screen changes
     connect(qApp, &QGuiApplication::screenAdded, this, &MonitorManager::refresh);
     connect(qApp, &QGuiApplication::screenRemoved, this, &MonitorManager::refresh);
+    connect(qApp, &QGuiApplication::primaryScreenChanged, this, &MonitorManager::refresh);
 }
 
 MonitorManager::~MonitorManager() = default;
@@ -29,6 +32,10 @@ void MonitorManager::refresh()
     for (int i = 0; i < screens.size(); ++i) {
         QScreen *screen = screens[i];
 
+        // Mode changes of a screen that stays connected
+        connect(screen, &QScreen::geometryChanged, this, &MonitorManager::refresh, Qt::UniqueConnection);
+        connect(screen, &QScreen::refreshRateChanged, this, &MonitorManager::refresh, Qt::UniqueConnection);
+
         MonitorInfo info;
         info.index = i;
         info.name = screen->name();
@@ -37,6 +44,8 @@ void MonitorManager::refresh()
         info.height = screen->size().height();
         info.refreshRate = qRound(screen->refreshRate());
         info.primary = (screen == primaryScreen);
+        info.geometry = screen->geometry();
+        info.nativeSize = (QSizeF(screen->size()) * screen->devicePixelRatio()).toSize();
 
         m_monitors.append(info);
     }
@@ -56,6 +65,10 @@ QVariantList MonitorManager::monitorsAsVariant() const
         map[QStringLiteral("height")] = monitor.height;
         map[QStringLiteral("refreshRate")] = monitor.refreshRate;
         map[QStringLiteral("primary")] = monitor.primary;
+        map[QStringLiteral("x")] = monitor.geometry.x();
+        map[QStringLiteral("y")] = monitor.geometry.y();
+        map[QStringLiteral("nativeWidth")] = monitor.nativeSize.width();
+        map[QStringLiteral("nativeHeight")] = monitor.nativeSize.height();
         map[QStringLiteral("displayString")] = QStringLiteral("%1 (%2x%3 @ %4Hz)")
             .arg(monitor.name)
             .arg(monitor.width)
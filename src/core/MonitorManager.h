@@ -3,14 +3,20 @@
 
 #pragma once
 
+#include <QList>
 #include <QObject>
+#include <QRect>
+#include <QSize>
 #include <QString>
 #include <QVariantMap>
 #include <qqmlintegration.h>
 
 /**
- * @brief Placeholder for monitor detection
- * Full implementation will use KScreen or Qt's screen APIs
+ * @brief Monitor detection through Qt's screen APIs
+ *
+ * monitorsChanged() fires when screens are added or removed, the primary
+ * screen changes, or a screen changes mode (geometry, scale or refresh
+ * rate), e.g. a TV switching modes in the middle of a session.
  */
 class MonitorManager : public QObject
 {
@@ -20,27 +26,30 @@ class MonitorManager : public QObject
     Q_PROPERTY(int monitorCount READ monitorCount NOTIFY monitorsChanged)
 
 public:
+    struct MonitorInfo {
+        int index = 0;
+        QString name;
+        QString connector; // e.g., HDMI-A-1, DP-1
+        int width = 0;     // Logical size, as windows are placed
+        int height = 0;
+        int refreshRate = 0;
+        bool primary = false;
+        QRect geometry;    // Logical position in the desktop
+        QSize nativeSize;  // Mode in device pixels
+    };
+
     explicit MonitorManager(QObject *parent = nullptr);
     ~MonitorManager() override;
 
     Q_INVOKABLE void refresh();
 
     int monitorCount() const { return m_monitors.size(); }
+    QList<MonitorInfo> monitors() const { return m_monitors; }
     QVariantList monitorsAsVariant() const;
 
 Q_SIGNALS:
     void monitorsChanged();
 
 private:
-    struct MonitorInfo {
-        int index;
-        QString name;
-        QString connector; // e.g., HDMI-A-1, DP-1
-        int width;
-        int height;
-        int refreshRate;
-        bool primary;
-    };
-
     QList<MonitorInfo> m_monitors;
 };
@@ -0,0 +1,298 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "PipeWireGraph.h"
+#include "Logging.h"
+
+#ifdef COUCHPLAY_HAVE_PIPEWIRE
+#include <pipewire/impl.h>
+#include <pipewire/pipewire.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+#ifdef COUCHPLAY_HAVE_PIPEWIRE
+
+struct PipeWireGraph::Private {
+    PipeWireGraph *q = nullptr;
+    pw_thread_loop *loop = nullptr;
+    pw_context *context = nullptr;
+    pw_core *core = nullptr;
+    pw_registry *registry = nullptr;
+    spa_hook coreListener = {};
+    spa_hook registryListener = {};
+    QHash<QString, pw_impl_module *> modules;  // Touched with the loop locked
+
+    // Called on the loop thread; results are handed to the GUI thread
+    static void onGlobal(void *data, uint32_t id, uint32_t permissions, const char *type, uint32_t version,
+                         const spa_dict *props)
+    {
+        Q_UNUSED(permissions)
+        Q_UNUSED(version)
+        auto *d = static_cast<Private *>(data);
+        if (!props || std::strcmp(type, PW_TYPE_INTERFACE_Node) != 0) {
+            return;
+        }
+        const char *name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+        if (!name) {
+            return;
+        }
+        const QString nodeName = QString::fromUtf8(name);
+        PipeWireGraph *q = d->q;
+        QMetaObject::invokeMethod(
+            q,
+            [q, id, nodeName]() {
+                q->m_nodes.insert(id, nodeName);
+                Q_EMIT q->nodeAdded(nodeName);
+            },
+            Qt::QueuedConnection);
+    }
+
+    static void onGlobalRemove(void *data, uint32_t id)
+    {
+        PipeWireGraph *q = static_cast<Private *>(data)->q;
+        QMetaObject::invokeMethod(
+            q,
+            [q, id]() {
+                const QString name = q->m_nodes.take(id);
+                if (!name.isEmpty()) {
+                    Q_EMIT q->nodeRemoved(name);
+                }
+            },
+            Qt::QueuedConnection);
+    }
+
+    static void onCoreError(void *data, uint32_t id, int seq, int res, const char *message)
+    {
+        Q_UNUSED(seq)
+        qCWarning(couchplayCore) << "PipeWire error on object" << id << ":" << message;
+        if (id == PW_ID_CORE && res == -EPIPE) {
+            PipeWireGraph *q = static_cast<Private *>(data)->q;
+            QMetaObject::invokeMethod(q, [q]() { Q_EMIT q->disconnected(); }, Qt::QueuedConnection);
+        }
+    }
+
+    static inline const pw_registry_events registryEvents = {
+        .version = PW_VERSION_REGISTRY_EVENTS,
+        .global = &onGlobal,
+        .global_remove = &onGlobalRemove,
+    };
+
+    static inline const pw_core_events coreEvents = {
+        .version = PW_VERSION_CORE_EVENTS,
+        .error = &onCoreError,
+    };
+
+    void teardown()
+    {
+        if (loop) {
+            pw_thread_loop_lock(loop);
+            for (pw_impl_module *module : std::as_const(modules)) {
+                pw_impl_module_destroy(module);
+            }
+            modules.clear();
+            if (registry) {
+                spa_hook_remove(&registryListener);
+                pw_proxy_destroy(reinterpret_cast<pw_proxy *>(registry));
+                registry = nullptr;
+            }
+            if (core) {
+                spa_hook_remove(&coreListener);
+                pw_core_disconnect(core);
+                core = nullptr;
+            }
+            pw_thread_loop_unlock(loop);
+            pw_thread_loop_stop(loop);
+        }
+        if (context) {
+            pw_context_destroy(context);
+            context = nullptr;
+        }
+        if (loop) {
+            pw_thread_loop_destroy(loop);
+            loop = nullptr;
+        }
+    }
+};
+
+namespace {
+
+// Module arguments are SPA JSON; keep user text inside its quotes
+QByteArray jsonString(const QString &value)
+{
+    QByteArray quoted = value.toUtf8();
+    quoted.replace('\\', "\\\\");
+    quoted.replace('"', "\\\"");
+    return '"' + quoted + '"';
+}
+
+} // namespace
+
+#else
+
+struct PipeWireGraph::Private {
+};
+
+#endif
+
+PipeWireGraph::PipeWireGraph(QObject *parent)
+    : QObject(parent)
+    , d(std::make_unique<Private>())
+{
+}
+
+PipeWireGraph::~PipeWireGraph()
+{
+#ifdef COUCHPLAY_HAVE_PIPEWIRE
+    // Stops the loop thread before the queued callbacks' target goes away
+    d->teardown();
+#endif
+}
+
+bool PipeWireGraph::isCompiledIn()
+{
+#ifdef COUCHPLAY_HAVE_PIPEWIRE
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PipeWireGraph::connectToDaemon(QString &error)
+{
+#ifdef COUCHPLAY_HAVE_PIPEWIRE
+    if (d->core) {
+        return true;
+    }
+
+    pw_init(nullptr, nullptr);
+    d->q = this;
+    d->loop = pw_thread_loop_new("couchplay-audio", nullptr);
+    if (!d->loop) {
+        error = QStringLiteral("Failed to create PipeWire loop");
+        return false;
+    }
+    d->context = pw_context_new(pw_thread_loop_get_loop(d->loop), nullptr, 0);
+    if (!d->context) {
+        error = QStringLiteral("Failed to create PipeWire context");
+        d->teardown();
+        return false;
+    }
+
+    pw_thread_loop_lock(d->loop);
+    if (pw_thread_loop_start(d->loop) < 0) {
+        pw_thread_loop_unlock(d->loop);
+        error = QStringLiteral("Failed to start PipeWire loop");
+        d->teardown();
+        return false;
+    }
+
+    d->core = pw_context_connect(d->context, nullptr, 0);
+    if (!d->core) {
+        error = QStringLiteral("Failed to connect to PipeWire: %1").arg(QString::fromLocal8Bit(std::strerror(errno)));
+        pw_thread_loop_unlock(d->loop);
+        d->teardown();
+        return false;
+    }
+    pw_core_add_listener(d->core, &d->coreListener, &Private::coreEvents, d.get());
+    d->registry = pw_core_get_registry(d->core, PW_VERSION_REGISTRY, 0);
+    pw_registry_add_listener(d->registry, &d->registryListener, &Private::registryEvents, d.get());
+    pw_thread_loop_unlock(d->loop);
+
+    qCDebug(couchplayCore) << "Connected to PipeWire" << pw_get_library_version();
+    return true;
+#else
+    error = QStringLiteral("Built without PipeWire support");
+    return false;
+#endif
+}
+
+bool PipeWireGraph::isConnected() const
+{
+#ifdef COUCHPLAY_HAVE_PIPEWIRE
+    return d->core != nullptr;
+#else
+    return false;
+#endif
+}
+
+bool PipeWireGraph::createSink(const QString &name, const QString &description, QString &error)
+{
+#ifdef COUCHPLAY_HAVE_PIPEWIRE
+    if (!d->core) {
+        error = QStringLiteral("Not connected to PipeWire");
+        return false;
+    }
+
+    // Stereo sink for the player; its output stream is passive so an idle
+    // player doesn't keep the real device awake
+    const QByteArray args = "{ node.description = " + jsonString(description)
+        + " audio.position = [ FL FR ]"
+          " capture.props = { node.name = " + jsonString(name) + " media.class = Audio/Sink node.virtual = true }"
+          " playback.props = { node.name = " + jsonString(name + QStringLiteral(".output")) + " node.passive = true } }";
+
+    pw_thread_loop_lock(d->loop);
+    if (d->modules.contains(name)) {
+        pw_thread_loop_unlock(d->loop);
+        return true;
+    }
+    pw_impl_module *module = pw_context_load_module(d->context, "libpipewire-module-loopback", args.constData(), nullptr);
+    if (module) {
+        d->modules.insert(name, module);
+    }
+    pw_thread_loop_unlock(d->loop);
+
+    if (!module) {
+        error = QStringLiteral("Failed to load loopback for %1: %2").arg(name, QString::fromLocal8Bit(std::strerror(errno)));
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(name)
+    Q_UNUSED(description)
+    error = QStringLiteral("Built without PipeWire support");
+    return false;
+#endif
+}
+
+void PipeWireGraph::destroySink(const QString &name)
+{
+#ifdef COUCHPLAY_HAVE_PIPEWIRE
+    if (!d->loop) {
+        return;
+    }
+    pw_thread_loop_lock(d->loop);
+    if (pw_impl_module *module = d->modules.take(name)) {
+        pw_impl_module_destroy(module);
+    }
+    pw_thread_loop_unlock(d->loop);
+#else
+    Q_UNUSED(name)
+#endif
+}
+
+QStringList PipeWireGraph::sinks() const
+{
+#ifdef COUCHPLAY_HAVE_PIPEWIRE
+    if (!d->loop) {
+        return {};
+    }
+    pw_thread_loop_lock(d->loop);
+    const QStringList names = d->modules.keys();
+    pw_thread_loop_unlock(d->loop);
+    return names;
+#else
+    return {};
+#endif
+}
+
+bool PipeWireGraph::hasNode(const QString &name) const
+{
+    for (const QString &node : m_nodes) {
+        if (node == name) {
+            return true;
+        }
+    }
+    return false;
+}
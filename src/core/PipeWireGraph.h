@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+/**
+ * @brief In-process connection to the user's PipeWire daemon
+ *
+ * libpipewire runs on its own loop thread. A registry listener mirrors the
+ * daemon's nodes onto the GUI thread, so callers can see when a sink has
+ * appeared without asking pactl or pw-cli.
+ *
+ * Per-player sinks are libpipewire-module-loopback instances loaded into
+ * this process: the capture side is an Audio/Sink named after the player
+ * and the playback side follows the default output. Nothing else is
+ * spawned, and the sinks go away with this object or the connection.
+ *
+ * When CouchPlay is built without libpipewire, connectToDaemon() fails and
+ * the rest is inert.
+ */
+class PipeWireGraph : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PipeWireGraph(QObject *parent = nullptr);
+    ~PipeWireGraph() override;
+
+    /**
+     * @brief Whether this build can talk to PipeWire at all
+     */
+    static bool isCompiledIn();
+
+    /**
+     * @brief Connect and start watching the registry
+     * @return false with @p error set if the daemon can't be reached
+     */
+    bool connectToDaemon(QString &error);
+
+    bool isConnected() const;
+
+    /**
+     * @brief Create a sink called @p name that plays to the default output
+     */
+    bool createSink(const QString &name, const QString &description, QString &error);
+
+    /**
+     * @brief Remove a sink created by createSink()
+     */
+    void destroySink(const QString &name);
+
+    /**
+     * @brief Names of the sinks created by createSink()
+     */
+    QStringList sinks() const;
+
+    /**
+     * @brief Whether the daemon has announced a node called @p name
+     */
+    bool hasNode(const QString &name) const;
+
+Q_SIGNALS:
+    void nodeAdded(const QString &name);
+    void nodeRemoved(const QString &name);
+    void disconnected();
+
+private:
+    struct Private;
+    std::unique_ptr<Private> d;
+
+    QHash<quint32, QString> m_nodes;  // Registry ID to node.name, GUI thread
+};
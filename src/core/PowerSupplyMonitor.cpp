@@ -0,0 +1,128 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "PowerSupplyMonitor.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+PowerSupplyMonitor::PowerSupplyMonitor(const QString &sysfsRoot)
+    : m_sysfsRoot(sysfsRoot)
+{
+}
+
+QString PowerSupplyMonitor::readAttribute(const QString &supplyDir, const char *attribute) const
+{
+    QFile file(supplyDir + QLatin1Char('/') + QLatin1String(attribute));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromUtf8(file.readAll()).trimmed();
+}
+
+void PowerSupplyMonitor::readState(const QString &name, Supply &supply) const
+{
+    const QString dir = m_sysfsRoot + QStringLiteral("/class/power_supply/") + name;
+
+    bool ok = false;
+    const int capacity = readAttribute(dir, "capacity").toInt(&ok);
+    supply.level = ok ? qBound(0, capacity, 100) : levelFromCapacityLevel(readAttribute(dir, "capacity_level"));
+    supply.charging = readAttribute(dir, "status") == QLatin1String("Charging");
+}
+
+int PowerSupplyMonitor::levelFromCapacityLevel(const QString &capacityLevel)
+{
+    if (capacityLevel == QLatin1String("Critical")) {
+        return 5;
+    }
+    if (capacityLevel == QLatin1String("Low")) {
+        return 10;
+    }
+    if (capacityLevel == QLatin1String("Normal")) {
+        return 50;
+    }
+    if (capacityLevel == QLatin1String("High")) {
+        return 80;
+    }
+    if (capacityLevel == QLatin1String("Full")) {
+        return 100;
+    }
+    return -1;  // "Unknown" or missing
+}
+
+void PowerSupplyMonitor::rescan()
+{
+    m_supplies.clear();
+    m_otherSupplies.clear();
+    m_inputSupplies.clear();
+
+    const QString classDir = m_sysfsRoot + QStringLiteral("/class/power_supply");
+    const QStringList names = QDir(classDir).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &name : names) {
+        const QString dir = classDir + QLatin1Char('/') + name;
+        // Laptop batteries and AC adapters have scope "System" or none
+        if (readAttribute(dir, "type") != QLatin1String("Battery")
+            || readAttribute(dir, "scope") != QLatin1String("Device")) {
+            m_otherSupplies.insert(name);
+            continue;
+        }
+        Supply supply;
+        supply.deviceDir = QFileInfo(dir + QStringLiteral("/device")).canonicalFilePath();
+        if (supply.deviceDir.isEmpty()) {
+            m_otherSupplies.insert(name);
+            continue;
+        }
+        readState(name, supply);
+        m_supplies.insert(name, supply);
+    }
+}
+
+bool PowerSupplyMonitor::update(const QString &name)
+{
+    const bool exists = QFileInfo::exists(m_sysfsRoot + QStringLiteral("/class/power_supply/") + name);
+    const auto it = m_supplies.find(name);
+    if (exists && it != m_supplies.end()) {
+        const Supply old = it.value();
+        readState(name, it.value());
+        return it->level != old.level || it->charging != old.charging;
+    }
+    if (exists && m_otherSupplies.contains(name)) {
+        return false;
+    }
+    rescan();
+    return true;
+}
+
+PowerSupplyMonitor::Battery PowerSupplyMonitor::batteryFor(int eventNumber)
+{
+    auto it = m_inputSupplies.find(eventNumber);
+    if (it == m_inputSupplies.end()) {
+        QString match;
+        if (!m_supplies.isEmpty()) {
+            const QString inputDir = QFileInfo(m_sysfsRoot + QStringLiteral("/class/input/event")
+                                               + QString::number(eventNumber) + QStringLiteral("/device"))
+                                         .canonicalFilePath();
+            for (auto supply = m_supplies.cbegin(); !inputDir.isEmpty() && supply != m_supplies.cend(); ++supply) {
+                if (inputDir.startsWith(supply->deviceDir + QLatin1Char('/'))) {
+                    match = supply.key();
+                    break;
+                }
+            }
+        }
+        it = m_inputSupplies.insert(eventNumber, match);
+    }
+    return battery(it.value());
+}
+
+PowerSupplyMonitor::Battery PowerSupplyMonitor::battery(const QString &name) const
+{
+    Battery result;
+    const auto it = m_supplies.constFind(name);
+    if (it != m_supplies.cend()) {
+        result.name = name;
+        result.level = it->level;
+        result.charging = it->charging;
+    }
+    return result;
+}
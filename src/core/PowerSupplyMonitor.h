@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+
+/**
+ * @brief Batteries of input devices, from /sys/class/power_supply
+ *
+ * Controllers (hid-sony, hid-playstation, xpadneo, hid-nintendo, ...)
+ * register a power supply of type "Battery" and scope "Device" under the
+ * same HID device as their input nodes; a supply belongs to an eventN node
+ * if that node's input device lies below the supply's device directory.
+ *
+ * Nothing is polled: rescan() walks the class directory when devices come
+ * and go, update() re-reads one supply when the kernel sends a "change"
+ * uevent for it (see InputHotplugMonitor::powerSupplyChanged). Lookups
+ * per event node are cached until the next rescan().
+ */
+class PowerSupplyMonitor
+{
+public:
+    struct Battery {
+        QString name;       // Empty without a battery
+        int level = -1;     // Percent, -1 if unknown
+        bool charging = false;
+    };
+
+    explicit PowerSupplyMonitor(const QString &sysfsRoot = QStringLiteral("/sys"));
+
+    /**
+     * @brief Re-read the list of device batteries and their state
+     */
+    void rescan();
+
+    /**
+     * @brief Re-read supply @p name after a uevent for it
+     *
+     * Supplies that are new or gone cause a rescan(); changes of system
+     * batteries and AC adapters (frequent on laptops) are ignored.
+     *
+     * @return true if a device battery may have changed
+     */
+    bool update(const QString &name);
+
+    /**
+     * @brief Battery powering /dev/input/event@p eventNumber, if any
+     */
+    Battery batteryFor(int eventNumber);
+
+    Battery battery(const QString &name) const;
+
+    /**
+     * @brief Map POWER_SUPPLY_CAPACITY_LEVEL to a percentage, for drivers without "capacity"
+     */
+    static int levelFromCapacityLevel(const QString &capacityLevel);
+
+private:
+    struct Supply {
+        QString deviceDir;  // Canonical sysfs path of the supply's parent device
+        int level = -1;
+        bool charging = false;
+    };
+
+    QString readAttribute(const QString &supplyDir, const char *attribute) const;
+    void readState(const QString &name, Supply &supply) const;
+
+    QString m_sysfsRoot;
+    QHash<QString, Supply> m_supplies;
+    QSet<QString> m_otherSupplies;        // Not device batteries
+    QHash<int, QString> m_inputSupplies;  // eventNumber -> supply name, "" for none
+};
@@ -3,20 +3,38 @@
 
 #include "PresetManager.h"
 #include "HeroicConfigManager.h"
+#include "StartupTrace.h"
 #include "SteamConfigManager.h"
 
+#include <QDateTime>
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QSettings>
+#include <QSaveFile>
 #include <QStandardPaths>
+#include <QTimer>
 #include <QUuid>
 
 PresetManager::PresetManager(QObject *parent)
     : QObject(parent)
 {
+    StartupTrace::Scope trace("PresetManager");
+    // Standard .desktop file locations
+    m_applicationDirectories = {
+        QStringLiteral("/usr/share/applications"),
+        QStringLiteral("/usr/local/share/applications"),
+        QDir::homePath() + QStringLiteral("/.local/share/applications"),
+        // Flatpak
+        QDir::homePath() + QStringLiteral("/.local/share/flatpak/exports/share/applications"),
+        QStringLiteral("/var/lib/flatpak/exports/share/applications"),
+        // Snap
+        QStringLiteral("/var/lib/snapd/desktop/applications")
+    };
+
     initBuiltinPresets();
     loadCustomPresets();
 }
@@ -299,6 +317,12 @@ QString PresetManager::addPresetFromDesktopFile(const QString &desktopFilePath)
     saveCustomPresets();
     Q_EMIT presetsChanged();
 
+    if (m_applicationWatcher) {
+        // It's a preset now, not an application to offer
+        rebuildAvailableApplications();
+        Q_EMIT applicationsChanged();
+    }
+
     return preset.id;
 }
 
@@ -335,6 +359,10 @@ bool PresetManager::removeCustomPreset(const QString &id)
             m_customPresets.removeAt(i);
             saveCustomPresets();
             Q_EMIT presetsChanged();
+            if (m_applicationWatcher) {
+                rebuildAvailableApplications();
+                Q_EMIT applicationsChanged();
+            }
 
             return true;
         }
@@ -346,47 +374,117 @@ bool PresetManager::removeCustomPreset(const QString &id)
 
 void PresetManager::scanApplications()
 {
-    m_availableApplications.clear();
+    if (!m_desktopIndexLoaded) {
+        loadDesktopIndex();
+        m_desktopIndexLoaded = true;
+    }
 
-    // Standard .desktop file locations
-    QStringList searchPaths = {
-        QStringLiteral("/usr/share/applications"),
-        QStringLiteral("/usr/local/share/applications"),
-        QDir::homePath() + QStringLiteral("/.local/share/applications"),
-        // Flatpak
-        QDir::homePath() + QStringLiteral("/.local/share/flatpak/exports/share/applications"),
-        QStringLiteral("/var/lib/flatpak/exports/share/applications"),
-        // Snap
-        QStringLiteral("/var/lib/snapd/desktop/applications")
-    };
+    bool changed = false;
+    for (const QString &directory : std::as_const(m_applicationDirectories)) {
+        changed |= updateApplicationDirectory(directory);
+    }
+
+    // Forget files that disappeared while we weren't watching
+    QSet<QString> listed;
+    for (const QStringList &files : std::as_const(m_applicationFiles)) {
+        for (const QString &path : files) {
+            listed.insert(path);
+        }
+    }
+    for (auto it = m_desktopIndex.begin(); it != m_desktopIndex.end();) {
+        if (listed.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_desktopIndex.erase(it);
+            changed = true;
+        }
+    }
 
-    QSet<QString> seenNames;  // Avoid duplicates by name
+    if (changed) {
+        saveDesktopIndex();
+    }
 
-    for (const QString &searchPath : searchPaths) {
-        QDir dir(searchPath);
-        if (!dir.exists()) {
+    rebuildAvailableApplications();
+    watchApplicationDirectories();
+    Q_EMIT applicationsChanged();
+}
+
+void PresetManager::setApplicationDirectories(const QStringList &directories)
+{
+    if (m_applicationDirectories == directories) {
+        return;
+    }
+    m_applicationDirectories = directories;
+    m_applicationFiles.clear();
+    m_pendingDirectories.clear();
+    if (m_applicationWatcher) {
+        // Rescan and watch the new set
+        delete m_applicationWatcher;
+        m_applicationWatcher = nullptr;
+        scanApplications();
+    }
+}
+
+bool PresetManager::updateApplicationDirectory(const QString &directory)
+{
+    // Listing and stat are cheap; only new or changed files are opened
+    const QFileInfoList files = QDir(directory).entryInfoList({QStringLiteral("*.desktop")}, QDir::Files, QDir::Name);
+    QStringList paths;
+    paths.reserve(files.size());
+    bool changed = false;
+
+    for (const QFileInfo &info : files) {
+        const QString path = info.absoluteFilePath();
+        paths.append(path);
+
+        const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+        const auto it = m_desktopIndex.constFind(path);
+        if (it != m_desktopIndex.constEnd() && it->modified == modified && it->size == info.size()) {
             continue;
         }
 
-        const QStringList desktopFiles = dir.entryList({QStringLiteral("*.desktop")}, QDir::Files);
-        for (const QString &fileName : desktopFiles) {
-            QString filePath = dir.absoluteFilePath(fileName);
-            LaunchPreset app = parseDesktopFile(filePath);
+        DesktopIndexEntry entry;
+        entry.modified = modified;
+        entry.size = info.size();
+        entry.application = parseDesktopFile(path);
+        m_desktopIndex.insert(path, entry);
+        changed = true;
+    }
 
-            // Skip invalid or already seen
-            if (app.name.isEmpty() || seenNames.contains(app.name)) {
-                continue;
+    const QStringList previous = m_applicationFiles.value(directory);
+    if (previous != paths) {
+        const QSet<QString> current(paths.cbegin(), paths.cend());
+        for (const QString &path : previous) {
+            if (!current.contains(path)) {
+                m_desktopIndex.remove(path);
             }
+        }
+        m_applicationFiles.insert(directory, paths);
+        changed = true;
+    }
 
-            // Skip if already added as a custom preset
-            bool alreadyAdded = false;
-            for (const LaunchPreset &custom : m_customPresets) {
-                if (custom.desktopFilePath == filePath) {
-                    alreadyAdded = true;
-                    break;
-                }
-            }
-            if (alreadyAdded) {
+    return changed;
+}
+
+void PresetManager::rebuildAvailableApplications()
+{
+    m_availableApplications.clear();
+
+    QSet<QString> customPaths;
+    for (const LaunchPreset &custom : std::as_const(m_customPresets)) {
+        if (!custom.desktopFilePath.isEmpty()) {
+            customPaths.insert(custom.desktopFilePath);
+        }
+    }
+
+    QSet<QString> seenNames;  // Avoid duplicates by name, earlier directories win
+
+    for (const QString &directory : std::as_const(m_applicationDirectories)) {
+        for (const QString &path : m_applicationFiles.value(directory)) {
+            const LaunchPreset &app = m_desktopIndex[path].application;
+
+            // Skip invalid, already seen or already added as a custom preset
+            if (app.name.isEmpty() || seenNames.contains(app.name) || customPaths.contains(path)) {
                 continue;
             }
 
@@ -400,8 +498,111 @@ void PresetManager::scanApplications()
               [](const LaunchPreset &a, const LaunchPreset &b) {
                   return a.name.toLower() < b.name.toLower();
               });
+}
 
-    Q_EMIT applicationsChanged();
+void PresetManager::watchApplicationDirectories()
+{
+    if (!m_applicationWatcher) {
+        m_applicationWatcher = new QFileSystemWatcher(this);
+        connect(m_applicationWatcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString &path) {
+            m_pendingDirectories.insert(path);
+            m_applicationRescan->start();
+        });
+    }
+    if (!m_applicationRescan) {
+        // Package managers install many files at once
+        m_applicationRescan = new QTimer(this);
+        m_applicationRescan->setSingleShot(true);
+        m_applicationRescan->setInterval(250);
+        connect(m_applicationRescan, &QTimer::timeout, this, &PresetManager::updatePendingDirectories);
+    }
+
+    QStringList missing;
+    const QStringList watched = m_applicationWatcher->directories();
+    for (const QString &directory : std::as_const(m_applicationDirectories)) {
+        if (!watched.contains(directory) && QFileInfo(directory).isDir()) {
+            missing.append(directory);
+        }
+    }
+    if (!missing.isEmpty()) {
+        m_applicationWatcher->addPaths(missing);
+    }
+}
+
+void PresetManager::updatePendingDirectories()
+{
+    bool changed = false;
+    for (const QString &directory : std::as_const(m_pendingDirectories)) {
+        changed |= updateApplicationDirectory(directory);
+    }
+    m_pendingDirectories.clear();
+
+    if (changed) {
+        saveDesktopIndex();
+        rebuildAvailableApplications();
+        Q_EMIT applicationsChanged();
+    }
+}
+
+QString PresetManager::desktopIndexPath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/applications.json");
+}
+
+void PresetManager::loadDesktopIndex()
+{
+    QFile file(desktopIndexPath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    const QJsonObject entries = root[QStringLiteral("entries")].toObject();
+    m_desktopIndex.reserve(entries.size());
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        const QJsonObject obj = it.value().toObject();
+        DesktopIndexEntry entry;
+        entry.modified = obj[QStringLiteral("modified")].toInteger();
+        entry.size = obj[QStringLiteral("size")].toInteger(-1);
+        entry.application.name = obj[QStringLiteral("name")].toString();
+        if (!entry.application.name.isEmpty()) {
+            entry.application.command = obj[QStringLiteral("command")].toString();
+            entry.application.workingDirectory = obj[QStringLiteral("workingDirectory")].toString();
+            entry.application.iconName = obj[QStringLiteral("iconName")].toString();
+            entry.application.desktopFilePath = it.key();
+        }
+        m_desktopIndex.insert(it.key(), entry);
+    }
+}
+
+void PresetManager::saveDesktopIndex() const
+{
+    QJsonObject entries;
+    for (auto it = m_desktopIndex.constBegin(); it != m_desktopIndex.constEnd(); ++it) {
+        QJsonObject obj;
+        obj[QStringLiteral("modified")] = it->modified;
+        obj[QStringLiteral("size")] = it->size;
+        if (!it->application.name.isEmpty()) {
+            obj[QStringLiteral("name")] = it->application.name;
+            obj[QStringLiteral("command")] = it->application.command;
+            obj[QStringLiteral("workingDirectory")] = it->application.workingDirectory;
+            obj[QStringLiteral("iconName")] = it->application.iconName;
+        }
+        entries[it.key()] = obj;
+    }
+
+    QJsonObject root;
+    root[QStringLiteral("entries")] = entries;
+
+    const QString path = desktopIndexPath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to save application index:" << path;
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.commit();
 }
 
 void PresetManager::refresh()
@@ -412,38 +613,114 @@ void PresetManager::refresh()
 
 LaunchPreset PresetManager::parseDesktopFile(const QString &filePath) const
 {
-    LaunchPreset preset;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return LaunchPreset();
+    }
 
-    if (!QFile::exists(filePath)) {
-        return preset;
+    LaunchPreset preset = parseDesktopEntry(file.readAll());
+    if (!preset.name.isEmpty()) {
+        preset.desktopFilePath = filePath;
     }
+    return preset;
+}
 
-    // Use QSettings to parse INI-like .desktop format
-    QSettings desktop(filePath, QSettings::IniFormat);
-    desktop.beginGroup(QStringLiteral("Desktop Entry"));
+LaunchPreset PresetManager::parseDesktopEntry(QByteArrayView data)
+{
+    // Value with the spec's escapes resolved: \s \n \t \r and \\.
+    auto unescape = [](QByteArrayView raw) {
+        if (!raw.contains('\\')) {
+            return QString::fromUtf8(raw);
+        }
+        QByteArray value;
+        value.reserve(raw.size());
+        for (qsizetype i = 0; i < raw.size(); ++i) {
+            char c = raw.at(i);
+            if (c == '\\' && i + 1 < raw.size()) {
+                switch (raw.at(++i)) {
+                case 's': c = ' '; break;
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case '\\': c = '\\'; break;
+                default:
+                    // Kept for Exec=, which has its own quoting rules
+                    value.append('\\');
+                    c = raw.at(i);
+                    break;
+                }
+            }
+            value.append(c);
+        }
+        return QString::fromUtf8(value);
+    };
 
-    // Check if it's an application
-    QString type = desktop.value(QStringLiteral("Type")).toString();
-    if (type != QStringLiteral("Application")) {
-        return preset;
+    QString type;
+    QString name;
+    QString exec;
+    QString path;
+    QString icon;
+    bool hidden = false;
+    bool inEntry = false;
+
+    qsizetype pos = 0;
+    while (pos < data.size()) {
+        qsizetype end = data.indexOf('\n', pos);
+        if (end < 0) {
+            end = data.size();
+        }
+        const QByteArrayView line = data.sliced(pos, end - pos).trimmed();
+        pos = end + 1;
+
+        if (line.isEmpty() || line.front() == '#') {
+            continue;
+        }
+        if (line.front() == '[') {
+            // The first group must be [Desktop Entry]; nothing after it matters
+            if (inEntry) {
+                break;
+            }
+            inEntry = line == "[Desktop Entry]";
+            continue;
+        }
+        if (!inEntry) {
+            continue;
+        }
+
+        const qsizetype equals = line.indexOf('=');
+        if (equals <= 0) {
+            continue;
+        }
+        const QByteArrayView key = line.first(equals).trimmed();
+        const QByteArrayView value = line.sliced(equals + 1).trimmed();
+        // Localized keys (Name[de]) don't match any of these
+        if (key == "Type") {
+            type = unescape(value);
+        } else if (key == "Name") {
+            name = unescape(value);
+        } else if (key == "Exec") {
+            exec = unescape(value);
+        } else if (key == "Path") {
+            path = unescape(value);
+        } else if (key == "Icon") {
+            icon = unescape(value);
+        } else if ((key == "Hidden" || key == "NoDisplay") && value == "true") {
+            hidden = true;
+        }
     }
 
-    // Skip hidden entries
-    if (desktop.value(QStringLiteral("Hidden"), false).toBool() ||
-        desktop.value(QStringLiteral("NoDisplay"), false).toBool()) {
+    LaunchPreset preset;
+    // Only displayed applications
+    if (type != QStringLiteral("Application") || hidden) {
         return preset;
     }
 
-    // Extract fields
-    preset.name = desktop.value(QStringLiteral("Name")).toString();
-    preset.command = cleanExecCommand(desktop.value(QStringLiteral("Exec")).toString());
-    preset.workingDirectory = desktop.value(QStringLiteral("Path")).toString();
-    preset.iconName = desktop.value(QStringLiteral("Icon")).toString();
-    preset.desktopFilePath = filePath;
+    preset.name = name;
+    preset.command = cleanExecCommand(exec);
+    preset.workingDirectory = path;
+    preset.iconName = icon;
 
     // Check Categories for Game - could filter to only games in the future
-    // QString categories = desktop.value(QStringLiteral("Categories")).toString();
-
     return preset;
 }
 
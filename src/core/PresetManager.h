@@ -3,7 +3,10 @@
 
 #pragma once
 
+#include <QByteArrayView>
+#include <QHash>
 #include <QObject>
+#include <QSet>
 #include <QString>
 #include <QList>
 #include <QStringList>
@@ -13,6 +16,9 @@
 #include "HeroicConfigManager.h"
 #include "SteamConfigManager.h"
 
+class QFileSystemWatcher;
+class QTimer;
+
 /**
  * LauncherInfo - Launcher-specific configuration and paths
  * 
@@ -245,10 +251,22 @@ public:
 
     /**
      * @brief Scan for installed applications (.desktop files)
-     * Results are available via availableApplications()
+     *
+     * Results are available via availableApplications(). Only files that
+     * are new or whose mtime or size changed are parsed; the rest come from
+     * an index persisted in the cache directory. After the first scan the
+     * directories are watched and the list follows changes on its own.
      */
     Q_INVOKABLE void scanApplications();
 
+    /**
+     * @brief Directories scanned for .desktop files, in order of precedence
+     *
+     * Defaults to the system, user, Flatpak and Snap application directories.
+     */
+    QStringList applicationDirectories() const { return m_applicationDirectories; }
+    void setApplicationDirectories(const QStringList &directories);
+
     /**
      * @brief Reload presets from disk
      */
@@ -267,6 +285,17 @@ public:
      */
     static QString cleanExecCommand(const QString &exec);
 
+    /**
+     * @brief Parse the [Desktop Entry] group of a .desktop file
+     *
+     * Follows the Desktop Entry Specification's escapes and ignores
+     * localized keys and other groups.
+     *
+     * @param data File content
+     * @return The preset, with an empty name unless it's a displayed application
+     */
+    static LaunchPreset parseDesktopEntry(QByteArrayView data);
+
 private:
     void initBuiltinPresets();
     void loadCustomPresets();
@@ -293,9 +322,31 @@ private:
      */
     QStringList getDefaultSharedDirectories(const QString &id) const;
 
+    // .desktop index, see scanApplications()
+    struct DesktopIndexEntry {
+        qint64 modified = 0;      // mtime in ms
+        qint64 size = -1;
+        LaunchPreset application; // Empty name: not a displayed application
+    };
+    bool updateApplicationDirectory(const QString &directory);
+    void rebuildAvailableApplications();
+    void watchApplicationDirectories();
+    void updatePendingDirectories();
+    void loadDesktopIndex();
+    void saveDesktopIndex() const;
+    QString desktopIndexPath() const;
+
     HeroicConfigManager *m_heroicConfigManager = nullptr;
     SteamConfigManager *m_steamConfigManager = nullptr;
     QList<LaunchPreset> m_builtinPresets;
     QList<LaunchPreset> m_customPresets;
     QList<LaunchPreset> m_availableApplications;
+
+    QStringList m_applicationDirectories;
+    QHash<QString, DesktopIndexEntry> m_desktopIndex;  // .desktop path -> entry
+    QHash<QString, QStringList> m_applicationFiles;    // directory -> .desktop paths by name
+    bool m_desktopIndexLoaded = false;
+    QFileSystemWatcher *m_applicationWatcher = nullptr;
+    QTimer *m_applicationRescan = nullptr;            // Coalesces bursts of directory changes
+    QSet<QString> m_pendingDirectories;
 };
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "ProcessExitWatcher.h"
+
+#include <QDebug>
+#include <QSocketNotifier>
+#include <QTimer>
+
+#include <cerrno>
+#include <cstring>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// glibc only wraps it from 2.36
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+ProcessExitWatcher::ProcessExitWatcher(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ProcessExitWatcher::~ProcessExitWatcher()
+{
+    stop();
+}
+
+bool ProcessExitWatcher::watch(pid_t pid)
+{
+    stop();
+    if (pid <= 0) {
+        return false;
+    }
+
+    // pidfds are always close-on-exec
+    const int fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+    if (fd < 0) {
+        if (errno == ESRCH) {
+            // Already gone; report it like any other exit
+            QTimer::singleShot(0, this, [this, pid]() {
+                Q_EMIT exited(qint64(pid));
+            });
+            return true;
+        }
+        qWarning() << "ProcessExitWatcher: pidfd_open failed for" << pid << ":" << strerror(errno);
+        return false;
+    }
+
+    m_pid = pid;
+    m_fd = fd;
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &ProcessExitWatcher::onActivated);
+    return true;
+}
+
+void ProcessExitWatcher::stop()
+{
+    delete m_notifier;
+    m_notifier = nullptr;
+
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_pid = 0;
+}
+
+void ProcessExitWatcher::onActivated()
+{
+    // A pidfd only becomes readable once, on exit
+    const qint64 pid = m_pid;
+    stop();
+    Q_EMIT exited(pid);
+}
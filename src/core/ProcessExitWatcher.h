@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QObject>
+
+#include <sys/types.h>
+
+class QSocketNotifier;
+
+/**
+ * @brief Reports when a process that isn't our child exits
+ *
+ * Holds a pidfd for the process, which becomes readable once it has
+ * exited, and watches it from the event loop; the PID can't be reused
+ * behind our back while the pidfd is open. Works for any process we may
+ * see, including ones the helper started as root.
+ */
+class ProcessExitWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProcessExitWatcher(QObject *parent = nullptr);
+    ~ProcessExitWatcher() override;
+
+    /**
+     * @brief Start watching @p pid, replacing any previous process
+     *
+     * If the process is already gone, exited() is emitted from the event
+     * loop.
+     * @return false if pidfds are unavailable (kernel before 5.3)
+     */
+    bool watch(pid_t pid);
+    void stop();
+
+    bool isWatching() const { return m_fd >= 0; }
+    pid_t pid() const { return m_pid; }
+
+Q_SIGNALS:
+    void exited(qint64 pid);
+
+private:
+    void onActivated();
+
+    pid_t m_pid = 0;
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+};
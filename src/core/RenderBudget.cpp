@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "RenderBudget.h"
+
+#include <QDir>
+#include <QFile>
+#include <QRegularExpression>
+
+#include <cmath>
+#include <iterator>
+
+namespace {
+
+QByteArray readSysfs(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll().trimmed() : QByteArray();
+}
+
+} // namespace
+
+RenderBudget::GpuClass RenderBudget::detectGpu(const QString &drmRoot)
+{
+    static const QRegularExpression cardPattern(QStringLiteral("^card\\d+$"));
+
+    GpuClass best = GpuClass::Unknown;
+    const QStringList cards = QDir(drmRoot).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &card : cards) {
+        if (!cardPattern.match(card).hasMatch()) {
+            continue;  // Connectors (card0-HDMI-A-1) and render nodes
+        }
+
+        const GpuClass gpu = classify(QStringLiteral("%1/%2/device").arg(drmRoot, card));
+        if (gpu == GpuClass::Discrete) {
+            return gpu;
+        }
+        if (gpu == GpuClass::Integrated) {
+            best = gpu;
+        }
+    }
+    return best;
+}
+
+RenderBudget::GpuClass RenderBudget::classify(const QString &deviceDir)
+{
+    static constexpr qint64 DISCRETE_VRAM = qint64(2) * 1024 * 1024 * 1024;
+
+    const QByteArray vendor = readSysfs(deviceDir + QStringLiteral("/vendor"));
+    if (vendor == "0x10de") {
+        return GpuClass::Discrete;
+    }
+    if (vendor == "0x8086") {
+        return GpuClass::Integrated;
+    }
+    if (vendor == "0x1002") {
+        bool ok = false;
+        const qint64 vram = readSysfs(deviceDir + QStringLiteral("/mem_info_vram_total")).toLongLong(&ok);
+        return ok && vram >= DISCRETE_VRAM ? GpuClass::Discrete : GpuClass::Integrated;
+    }
+    return GpuClass::Unknown;
+}
+
+RenderBudget::GpuClass RenderBudget::systemGpu()
+{
+    static const GpuClass gpu = detectGpu();
+    return gpu;
+}
+
+int RenderBudget::defaultBudget(GpuClass gpu)
+{
+    switch (gpu) {
+    case GpuClass::Integrated:
+        return 250;   // Two 1080p60 instances
+    case GpuClass::Discrete:
+        return 1000;  // Four 1080p120 instances
+    case GpuClass::Unknown:
+        break;
+    }
+    return 500;
+}
+
+double RenderBudget::scaleFor(const QList<QSize> &outputs, const QList<int> &refreshRates, int budgetMpx)
+{
+    if (budgetMpx <= 0) {
+        return 1.0;
+    }
+
+    double demandMpx = 0.0;
+    for (qsizetype i = 0; i < outputs.size(); ++i) {
+        const int refresh = refreshRates.value(i, 60) > 0 ? refreshRates.value(i, 60) : 60;
+        demandMpx += double(outputs.at(i).width()) * outputs.at(i).height() * refresh / 1e6;
+    }
+    if (demandMpx <= budgetMpx) {
+        return 1.0;
+    }
+
+    // Pixel count goes with the square of the per-axis scale
+    const double ideal = std::sqrt(budgetMpx / demandMpx);
+    for (double scale : SCALES) {
+        if (scale <= ideal) {
+            return scale;
+        }
+    }
+    return SCALES[std::size(SCALES) - 1];
+}
+
+QSize RenderBudget::internalSize(const QSize &output, double scale)
+{
+    auto even = [scale](int length) {
+        return qMax(2, int(std::lround(length * scale / 2.0)) * 2);
+    };
+    return QSize(even(output.width()), even(output.height()));
+}
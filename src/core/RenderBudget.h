@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QList>
+#include <QSize>
+#include <QString>
+
+/**
+ * @brief Fits the combined render load of all instances into a GPU budget
+ *
+ * The budget is the number of pixels the GPU can render per second across
+ * all instances, in megapixels (1920x1080 at 60 Hz is ~124 Mpx/s). When the
+ * instances' output resolutions and refresh rates exceed it, every instance
+ * renders at the same lower internal resolution, snapped to one of FSR's
+ * quality levels, and gamescope upscales it to the window with -F fsr.
+ */
+class RenderBudget
+{
+public:
+    enum class GpuClass {
+        Unknown,
+        Integrated,
+        Discrete,
+    };
+
+    // Render scale per axis of FSR's Ultra Quality, Quality, Balanced and
+    // Performance modes; 1.0 renders natively
+    static constexpr double SCALES[] = {1.0, 0.77, 0.67, 0.59, 0.5};
+
+    /**
+     * @brief Class of the most capable GPU under @p drmRoot
+     *
+     * Discrete: NVIDIA, or AMD with at least 2 GiB of VRAM. Integrated:
+     * Intel, or AMD APUs with a small carve-out.
+     */
+    static GpuClass detectGpu(const QString &drmRoot = QStringLiteral("/sys/class/drm"));
+
+    /**
+     * @brief Class of one GPU, from its PCI device directory in sysfs
+     */
+    static GpuClass classify(const QString &deviceDir);
+
+    /**
+     * @brief detectGpu() of the running system, detected once
+     */
+    static GpuClass systemGpu();
+
+    /**
+     * @brief Default budget in Mpx/s for a GPU class
+     */
+    static int defaultBudget(GpuClass gpu);
+
+    /**
+     * @brief Render scale so @p outputs at @p refreshRates fit @p budgetMpx
+     *
+     * @param outputs Output (window) size per instance
+     * @param refreshRates Refresh rate per instance, parallel to outputs
+     * @param budgetMpx Budget in Mpx/s, 0 or less for no limit
+     * @return One of SCALES; the smallest if even that exceeds the budget
+     */
+    static double scaleFor(const QList<QSize> &outputs, const QList<int> &refreshRates, int budgetMpx);
+
+    /**
+     * @brief @p output scaled by @p scale, rounded to even dimensions
+     */
+    static QSize internalSize(const QSize &output, double scale);
+};
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "ResolutionController.h"
+#include "RenderBudget.h"
+
+#include <QDebug>
+
+static constexpr double SCALE_EPSILON = 0.005;
+
+ResolutionController::ResolutionController(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void ResolutionController::setBounds(double minScale, double maxScale)
+{
+    maxScale = qBound(0.1, maxScale, 1.0);
+    minScale = qBound(0.1, minScale, maxScale);
+
+    // The bounds themselves, and FSR's levels in between
+    m_levels = {maxScale};
+    for (double scale : RenderBudget::SCALES) {
+        if (scale < maxScale - SCALE_EPSILON && scale > minScale + SCALE_EPSILON) {
+            m_levels.append(scale);
+        }
+    }
+    if (minScale < maxScale - SCALE_EPSILON) {
+        m_levels.append(minScale);
+    }
+}
+
+void ResolutionController::track(int index, double scale, int targetFps)
+{
+    Player player;
+    player.targetFps = targetFps;
+    // Highest level not above the scale the player was launched with
+    player.level = m_levels.size() - 1;
+    for (int level = 0; level < m_levels.size(); ++level) {
+        if (m_levels.at(level) <= scale + SCALE_EPSILON) {
+            player.level = level;
+            break;
+        }
+    }
+    m_players.insert(index, player);
+}
+
+double ResolutionController::scale(int index) const
+{
+    const auto it = m_players.constFind(index);
+    return it == m_players.cend() ? 1.0 : m_levels.value(it->level, 1.0);
+}
+
+void ResolutionController::addSample(int index, double fps, double gpuPercent)
+{
+    const auto it = m_players.find(index);
+    if (it == m_players.end()) {
+        return;
+    }
+    Player &player = it.value();
+
+    if (player.settle > 0) {
+        --player.settle;
+        return;
+    }
+    if (fps < 0 || player.targetFps <= 0) {
+        player.misses = 0;
+        player.hits = 0;
+        return;
+    }
+    if (player.sinceUp >= 0) {
+        ++player.sinceUp;
+    }
+
+    if (fps < player.targetFps * MISS_RATIO) {
+        player.hits = 0;
+        if (++player.misses >= DOWN_SAMPLES && player.level + 1 < m_levels.size()) {
+            // The level just tried doesn't hold, be slower to try it again
+            if (player.sinceUp >= 0 && player.sinceUp <= FLAP_WINDOW_SAMPLES) {
+                player.upSamples = qMin(player.upSamples * 2, UP_SAMPLES * 8);
+            }
+            player.sinceUp = -1;
+            step(index, player, player.level + 1);
+        }
+        return;
+    }
+    player.misses = 0;
+
+    if (player.level == 0 || fps < player.targetFps * HIT_RATIO) {
+        player.hits = 0;
+        return;
+    }
+
+    // The next level renders (next / current)^2 as many pixels
+    if (gpuPercent >= 0) {
+        const double growth = m_levels.at(player.level - 1) / m_levels.at(player.level);
+        if (gpuPercent * growth * growth > GPU_HEADROOM_PERCENT) {
+            player.hits = 0;
+            return;
+        }
+    }
+
+    if (++player.hits >= player.upSamples) {
+        player.sinceUp = 0;
+        step(index, player, player.level - 1);
+    }
+}
+
+void ResolutionController::step(int index, Player &player, int level)
+{
+    qDebug() << "ResolutionController: Player" << index << "render scale"
+             << m_levels.at(player.level) << "->" << m_levels.at(level);
+    player.level = level;
+    player.misses = 0;
+    player.hits = 0;
+    player.settle = SETTLE_SAMPLES;
+    Q_EMIT scaleChanged(index, m_levels.at(level));
+}
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+
+/**
+ * @brief Per-player render scale driven by frame rate feedback
+ *
+ * Fed one telemetry sample per instance and second (see addSample()). A
+ * player below MISS_RATIO of their frame target for DOWN_SAMPLES samples
+ * in a row steps down one level; one at the target for long enough, with
+ * the GPU busy little enough that the next level would still fit, steps
+ * back up. Levels are RenderBudget's FSR scales between the bounds.
+ *
+ * A change relaunches the instance, so the controller is deliberately
+ * slow: samples right after a change are ignored while the game starts
+ * again, and a level that had to be left again shortly after stepping up
+ * to it is retried only after twice the wait (up to 8x).
+ */
+class ResolutionController : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DOWN_SAMPLES = 5;      // Seconds of misses before stepping down
+    static constexpr int UP_SAMPLES = 30;       // Seconds at the target before stepping up
+    static constexpr int SETTLE_SAMPLES = 20;   // Ignored after a change (relaunch, shader warm-up)
+    static constexpr int FLAP_WINDOW_SAMPLES = 120; // A drop this soon after a step up backs off
+    static constexpr double MISS_RATIO = 0.9;   // Below 90% of the target is a miss
+    static constexpr double HIT_RATIO = 0.97;
+    static constexpr double GPU_HEADROOM_PERCENT = 85.0; // Busiest engine, projected to the next level
+
+    explicit ResolutionController(QObject *parent = nullptr);
+
+    /**
+     * @brief Scales players may use, per axis (e.g. 0.5 to 1.0)
+     *
+     * Applies to players tracked afterwards.
+     */
+    void setBounds(double minScale, double maxScale);
+    QList<double> levels() const { return m_levels; }
+
+    /**
+     * @brief Start controlling player @p index, rendering at @p scale, aiming for @p targetFps
+     */
+    void track(int index, double scale, int targetFps);
+    void untrack(int index) { m_players.remove(index); }
+    void clear() { m_players.clear(); }
+    bool isTracking(int index) const { return m_players.contains(index); }
+
+    /**
+     * @brief Current scale of player @p index, 1.0 if not tracked
+     */
+    double scale(int index) const;
+
+    /**
+     * @brief One sample of player @p index
+     * @param fps Frame rate, negative if unknown
+     * @param gpuPercent Busiest GPU engine, negative if unknown
+     */
+    void addSample(int index, double fps, double gpuPercent);
+
+Q_SIGNALS:
+    void scaleChanged(int index, double scale);
+
+private:
+    struct Player {
+        int level = 0;          // Index into m_levels
+        int targetFps = 0;
+        int misses = 0;
+        int hits = 0;
+        int settle = SETTLE_SAMPLES;
+        int upSamples = UP_SAMPLES;
+        int sinceUp = -1;       // Samples since the last step up, -1 if none
+    };
+
+    void step(int index, Player &player, int level);
+
+    QList<double> m_levels{1.0};  // Largest first
+    QHash<int, Player> m_players;
+};
@@ -2,14 +2,24 @@
 // SPDX-FileCopyrightText: 2024 hikaps
 
 #include "SessionManager.h"
+#include "InstanceListModel.h"
+#include "StartupTrace.h"
 
 #include <QDir>
 #include <QStandardPaths>
+#include <QTimer>
 #include <QDebug>
 
 SessionManager::SessionManager(QObject *parent)
     : QObject(parent)
+    , m_instanceModel(new InstanceListModel(this))
+    , m_autosaveTimer(new QTimer(this))
 {
+    StartupTrace::Scope trace("SessionManager");
+    m_autosaveTimer->setSingleShot(true);
+    m_autosaveTimer->setInterval(AUTOSAVE_DELAY_MS);
+    connect(m_autosaveTimer, &QTimer::timeout, this, &SessionManager::flushAutosave);
+
     // Ensure profiles directory exists
     QDir().mkpath(profilesDir());
 
@@ -20,7 +30,10 @@ SessionManager::SessionManager(QObject *parent)
     refreshProfiles();
 }
 
-SessionManager::~SessionManager() = default;
+SessionManager::~SessionManager()
+{
+    flushAutosave();
+}
 
 QString SessionManager::profilesDir() const
 {
@@ -35,6 +48,9 @@ QString SessionManager::profilePath(const QString &name) const
 
 void SessionManager::newSession()
 {
+    // Edits to the profile being left still belong to it
+    flushAutosave();
+
     m_currentProfile = SessionProfile();
     m_currentProfile.name = QString();
     m_currentProfile.layout = QStringLiteral("horizontal");
@@ -48,9 +64,17 @@ void SessionManager::newSession()
         // No default user assignment - user must select explicitly
         m_currentProfile.instances.append(config);
     }
+    m_instanceModel->sync(m_currentProfile.instances);
 
     Q_EMIT currentProfileChanged();
     Q_EMIT currentLayoutChanged();
+    Q_EMIT performanceModeChanged();
+    Q_EMIT gpuBudgetChanged();
+    Q_EMIT dynamicResolutionChanged();
+    Q_EMIT frameLimitChanged();
+    Q_EMIT equalFrameShareChanged();
+    Q_EMIT shareCachesChanged();
+    Q_EMIT writableSharesChanged();
     Q_EMIT instanceCountChanged();
     Q_EMIT instancesChanged();
 }
@@ -90,12 +114,37 @@ bool SessionManager::saveProfile(const QString &name)
     }
 
     QString path = profilePath(name);
+    writeProfile(path, name);
+
+    m_autosaveTimer->stop();
+    m_dirty = false;
+
+    m_currentProfile.name = name;
+    m_currentProfile.filePath = path;
+
+    Q_EMIT currentProfileChanged();
+    refreshProfiles();
+
+    return true;
+}
+
+void SessionManager::writeProfile(const QString &path, const QString &name) const
+{
     KConfig config(path);
 
     // General section
     KConfigGroup general = config.group(QStringLiteral("General"));
     general.writeEntry("name", name);
     general.writeEntry("layout", m_currentProfile.layout);
+    general.writeEntry("performanceMode", m_currentProfile.performanceMode);
+    general.writeEntry("gpuBudget", m_currentProfile.gpuBudget);
+    general.writeEntry("dynamicResolution", m_currentProfile.dynamicResolution);
+    general.writeEntry("minRenderScale", m_currentProfile.minRenderScale);
+    general.writeEntry("maxRenderScale", m_currentProfile.maxRenderScale);
+    general.writeEntry("frameLimit", m_currentProfile.frameLimit);
+    general.writeEntry("equalFrameShare", m_currentProfile.equalFrameShare);
+    general.writeEntry("shareCaches", m_currentProfile.shareCaches);
+    general.writeEntry("writableShares", m_currentProfile.writableShares);
     general.writeEntry("instanceCount", m_currentProfile.instances.size());
 
     // Instance sections
@@ -110,12 +159,18 @@ bool SessionManager::saveProfile(const QString &name)
         instGroup.writeEntry("outputWidth", inst.outputWidth);
         instGroup.writeEntry("outputHeight", inst.outputHeight);
         instGroup.writeEntry("refreshRate", inst.refreshRate);
+        instGroup.writeEntry("frameLimit", inst.frameLimit);
         instGroup.writeEntry("scalingMode", inst.scalingMode);
         instGroup.writeEntry("filterMode", inst.filterMode);
         instGroup.writeEntry("gameCommand", inst.gameCommand);
         instGroup.writeEntry("steamAppId", inst.steamAppId);
         instGroup.writeEntry("presetId", inst.presetId);
         instGroup.writeEntry("sharedDirectories", inst.sharedDirectories);
+        instGroup.writeEntry("cpuWeight", inst.cpuWeight);
+        instGroup.writeEntry("cpuCores", inst.cpuCores);
+        instGroup.writeEntry("ioWeight", inst.ioWeight);
+        instGroup.writeEntry("memoryHighMb", inst.memoryHighMb);
+        instGroup.writeEntry("gpu", inst.gpu);
 
         // Convert devices to string list (legacy - for backwards compatibility)
         QStringList deviceStrings;
@@ -129,15 +184,55 @@ bool SessionManager::saveProfile(const QString &name)
         instGroup.writeEntry("deviceStableIdNames", inst.deviceStableIdNames);
     }
 
+    // Drop players removed since the last save
+    for (const QString &group : config.groupList()) {
+        if (group.startsWith(QStringLiteral("Instance"))) {
+            bool ok = false;
+            const int index = group.mid(8).toInt(&ok);
+            if (ok && index >= m_currentProfile.instances.size()) {
+                config.deleteGroup(group);
+            }
+        }
+    }
+
+    // KConfig only rewrites the file when an entry differs, and then
+    // through QSaveFile, so a crash never leaves half a profile
     config.sync();
+}
 
-    m_currentProfile.name = name;
-    m_currentProfile.filePath = path;
+bool SessionManager::hasPendingAutosave() const
+{
+    return m_dirty;
+}
 
-    Q_EMIT currentProfileChanged();
-    refreshProfiles();
+void SessionManager::flushAutosave()
+{
+    m_autosaveTimer->stop();
+    if (!m_dirty) {
+        return;
+    }
+    m_dirty = false;
+    if (!m_currentProfile.name.isEmpty()) {
+        writeProfile(profilePath(m_currentProfile.name), m_currentProfile.name);
+    }
+}
 
-    return true;
+void SessionManager::scheduleAutosave()
+{
+    // A session without a profile is only written by saveProfile()
+    if (m_currentProfile.name.isEmpty()) {
+        return;
+    }
+    m_dirty = true;
+    m_autosaveTimer->start();
+}
+
+void SessionManager::instancesEdited()
+{
+    if (m_instanceModel->sync(m_currentProfile.instances)) {
+        Q_EMIT instancesChanged();
+        scheduleAutosave();
+    }
 }
 
 bool SessionManager::loadProfile(const QString &name)
@@ -149,6 +244,7 @@ bool SessionManager::loadProfile(const QString &name)
         return false;
     }
 
+    flushAutosave();
     KConfig config(path);
 
     // Read general section
@@ -156,6 +252,15 @@ bool SessionManager::loadProfile(const QString &name)
     m_currentProfile.name = name;
     m_currentProfile.filePath = path;
     m_currentProfile.layout = general.readEntry("layout", QStringLiteral("horizontal"));
+    m_currentProfile.performanceMode = general.readEntry("performanceMode", false);
+    m_currentProfile.gpuBudget = general.readEntry("gpuBudget", 0);
+    m_currentProfile.dynamicResolution = general.readEntry("dynamicResolution", false);
+    m_currentProfile.minRenderScale = qBound(MIN_RENDER_SCALE, general.readEntry("minRenderScale", 50), 100);
+    m_currentProfile.maxRenderScale = qBound(m_currentProfile.minRenderScale, general.readEntry("maxRenderScale", 100), 100);
+    m_currentProfile.frameLimit = general.readEntry("frameLimit", 0);
+    m_currentProfile.equalFrameShare = general.readEntry("equalFrameShare", false);
+    m_currentProfile.shareCaches = general.readEntry("shareCaches", true);
+    m_currentProfile.writableShares = general.readEntry("writableShares", false);
     int instanceCount = general.readEntry("instanceCount", 2);
 
     // Read instances
@@ -171,12 +276,18 @@ bool SessionManager::loadProfile(const QString &name)
         inst.outputWidth = instGroup.readEntry("outputWidth", 960);
         inst.outputHeight = instGroup.readEntry("outputHeight", 1080);
         inst.refreshRate = instGroup.readEntry("refreshRate", 60);
+        inst.frameLimit = instGroup.readEntry("frameLimit", 0);
         inst.scalingMode = instGroup.readEntry("scalingMode", QStringLiteral("fit"));
         inst.filterMode = instGroup.readEntry("filterMode", QStringLiteral("linear"));
         inst.gameCommand = instGroup.readEntry("gameCommand", QString());
         inst.steamAppId = instGroup.readEntry("steamAppId", QString());
         inst.presetId = instGroup.readEntry("presetId", QStringLiteral("steam"));
         inst.sharedDirectories = instGroup.readEntry("sharedDirectories", QStringList());
+        inst.cpuWeight = instGroup.readEntry("cpuWeight", 0);
+        inst.cpuCores = instGroup.readEntry("cpuCores", QString());
+        inst.ioWeight = instGroup.readEntry("ioWeight", 0);
+        inst.memoryHighMb = instGroup.readEntry("memoryHighMb", 0);
+        inst.gpu = instGroup.readEntry("gpu", QString());
 
         // Read stable device IDs (primary - survives hotplug/reboot)
         inst.deviceStableIds = instGroup.readEntry("deviceStableIds", QStringList());
@@ -191,9 +302,17 @@ bool SessionManager::loadProfile(const QString &name)
 
         m_currentProfile.instances.append(inst);
     }
+    m_instanceModel->sync(m_currentProfile.instances);
 
     Q_EMIT currentProfileChanged();
     Q_EMIT currentLayoutChanged();
+    Q_EMIT performanceModeChanged();
+    Q_EMIT gpuBudgetChanged();
+    Q_EMIT dynamicResolutionChanged();
+    Q_EMIT frameLimitChanged();
+    Q_EMIT equalFrameShareChanged();
+    Q_EMIT shareCachesChanged();
+    Q_EMIT writableSharesChanged();
     Q_EMIT instanceCountChanged();
     Q_EMIT instancesChanged();
 
@@ -232,6 +351,8 @@ bool SessionManager::deleteProfile(const QString &name)
 
     // Clear current profile name if we just deleted the current profile
     if (m_currentProfile.name == name) {
+        m_autosaveTimer->stop();
+        m_dirty = false;
         m_currentProfile.name = QString();
         m_currentProfile.filePath = QString();
         Q_EMIT currentProfileChanged();
@@ -246,6 +367,94 @@ void SessionManager::setCurrentLayout(const QString &layout)
     if (m_currentProfile.layout != layout) {
         m_currentProfile.layout = layout;
         Q_EMIT currentLayoutChanged();
+        scheduleAutosave();
+    }
+}
+
+void SessionManager::setPerformanceMode(bool enabled)
+{
+    if (m_currentProfile.performanceMode != enabled) {
+        m_currentProfile.performanceMode = enabled;
+        Q_EMIT performanceModeChanged();
+        scheduleAutosave();
+    }
+}
+
+void SessionManager::setGpuBudget(int megapixelsPerSecond)
+{
+    megapixelsPerSecond = qMax(0, megapixelsPerSecond);
+    if (m_currentProfile.gpuBudget != megapixelsPerSecond) {
+        m_currentProfile.gpuBudget = megapixelsPerSecond;
+        Q_EMIT gpuBudgetChanged();
+        scheduleAutosave();
+    }
+}
+
+void SessionManager::setDynamicResolution(bool enabled)
+{
+    if (m_currentProfile.dynamicResolution != enabled) {
+        m_currentProfile.dynamicResolution = enabled;
+        Q_EMIT dynamicResolutionChanged();
+        scheduleAutosave();
+    }
+}
+
+void SessionManager::setMinRenderScale(int percent)
+{
+    percent = qBound(MIN_RENDER_SCALE, percent, 100);
+    if (m_currentProfile.minRenderScale != percent) {
+        m_currentProfile.minRenderScale = percent;
+        m_currentProfile.maxRenderScale = qMax(m_currentProfile.maxRenderScale, percent);
+        Q_EMIT dynamicResolutionChanged();
+        scheduleAutosave();
+    }
+}
+
+void SessionManager::setMaxRenderScale(int percent)
+{
+    percent = qBound(MIN_RENDER_SCALE, percent, 100);
+    if (m_currentProfile.maxRenderScale != percent) {
+        m_currentProfile.maxRenderScale = percent;
+        m_currentProfile.minRenderScale = qMin(m_currentProfile.minRenderScale, percent);
+        Q_EMIT dynamicResolutionChanged();
+        scheduleAutosave();
+    }
+}
+
+void SessionManager::setFrameLimit(int fps)
+{
+    fps = qMax(0, fps);
+    if (m_currentProfile.frameLimit != fps) {
+        m_currentProfile.frameLimit = fps;
+        Q_EMIT frameLimitChanged();
+        scheduleAutosave();
+    }
+}
+
+void SessionManager::setEqualFrameShare(bool enabled)
+{
+    if (m_currentProfile.equalFrameShare != enabled) {
+        m_currentProfile.equalFrameShare = enabled;
+        Q_EMIT equalFrameShareChanged();
+        scheduleAutosave();
+    }
+}
+
+void SessionManager::setShareCaches(bool enabled)
+{
+    if (m_currentProfile.shareCaches != enabled) {
+        m_currentProfile.shareCaches = enabled;
+        Q_EMIT shareCachesChanged();
+        scheduleAutosave();
+    }
+}
+
+void SessionManager::setWritableShares(bool enabled)
+{
+    if (m_currentProfile.writableShares != enabled) {
+        m_currentProfile.writableShares = enabled;
+        Q_EMIT writableSharesChanged();
+        scheduleAutosave();
     }
 }
 
@@ -269,7 +478,7 @@ void SessionManager::setInstanceCount(int count)
     }
 
     Q_EMIT instanceCountChanged();
-    Q_EMIT instancesChanged();
+    instancesEdited();
 }
 
 QVariantMap SessionManager::getInstanceConfig(int index) const
@@ -288,11 +497,17 @@ QVariantMap SessionManager::getInstanceConfig(int index) const
     map[QStringLiteral("outputWidth")] = inst.outputWidth;
     map[QStringLiteral("outputHeight")] = inst.outputHeight;
     map[QStringLiteral("refreshRate")] = inst.refreshRate;
+    map[QStringLiteral("frameLimit")] = inst.frameLimit;
     map[QStringLiteral("scalingMode")] = inst.scalingMode;
     map[QStringLiteral("filterMode")] = inst.filterMode;
     map[QStringLiteral("gameCommand")] = inst.gameCommand;
     map[QStringLiteral("steamAppId")] = inst.steamAppId;
     map[QStringLiteral("presetId")] = inst.presetId;
+    map[QStringLiteral("cpuWeight")] = inst.cpuWeight;
+    map[QStringLiteral("cpuCores")] = inst.cpuCores;
+    map[QStringLiteral("ioWeight")] = inst.ioWeight;
+    map[QStringLiteral("memoryHighMb")] = inst.memoryHighMb;
+    map[QStringLiteral("gpu")] = inst.gpu;
 
     QVariantList deviceList;
     for (int dev : inst.devices) {
@@ -347,15 +562,27 @@ void SessionManager::setInstanceConfig(int index, const QVariantMap &config)
         inst.steamAppId = config[QStringLiteral("steamAppId")].toString();
     if (config.contains(QStringLiteral("presetId")))
         inst.presetId = config[QStringLiteral("presetId")].toString();
-
-    Q_EMIT instancesChanged();
+    if (config.contains(QStringLiteral("frameLimit")))
+        inst.frameLimit = qMax(0, config[QStringLiteral("frameLimit")].toInt());
+    if (config.contains(QStringLiteral("cpuWeight")))
+        inst.cpuWeight = config[QStringLiteral("cpuWeight")].toInt();
+    if (config.contains(QStringLiteral("cpuCores")))
+        inst.cpuCores = config[QStringLiteral("cpuCores")].toString().trimmed();
+    if (config.contains(QStringLiteral("ioWeight")))
+        inst.ioWeight = config[QStringLiteral("ioWeight")].toInt();
+    if (config.contains(QStringLiteral("memoryHighMb")))
+        inst.memoryHighMb = config[QStringLiteral("memoryHighMb")].toInt();
+    if (config.contains(QStringLiteral("gpu")))
+        inst.gpu = config[QStringLiteral("gpu")].toString();
+
+    instancesEdited();
 }
 
 void SessionManager::setInstanceUser(int index, const QString &username)
 {
     if (index >= 0 && index < m_currentProfile.instances.size()) {
         m_currentProfile.instances[index].username = username;
-        Q_EMIT instancesChanged();
+        instancesEdited();
     }
 }
 
@@ -363,7 +590,7 @@ void SessionManager::setInstanceMonitor(int index, int monitor)
 {
     if (index >= 0 && index < m_currentProfile.instances.size()) {
         m_currentProfile.instances[index].monitor = monitor;
-        Q_EMIT instancesChanged();
+        instancesEdited();
     }
 }
 
@@ -375,7 +602,7 @@ void SessionManager::setInstanceResolution(int index, int internalW, int interna
         inst.internalHeight = internalH;
         inst.outputWidth = outputW;
         inst.outputHeight = outputH;
-        Q_EMIT instancesChanged();
+        instancesEdited();
     }
 }
 
@@ -383,7 +610,7 @@ void SessionManager::setInstanceDevices(int index, const QList<int> &devices)
 {
     if (index >= 0 && index < m_currentProfile.instances.size()) {
         m_currentProfile.instances[index].devices = devices;
-        Q_EMIT instancesChanged();
+        instancesEdited();
     }
 }
 
@@ -392,7 +619,7 @@ void SessionManager::setInstanceDeviceStableIds(int index, const QStringList &st
     if (index >= 0 && index < m_currentProfile.instances.size()) {
         m_currentProfile.instances[index].deviceStableIds = stableIds;
         m_currentProfile.instances[index].deviceStableIdNames = names;
-        Q_EMIT instancesChanged();
+        instancesEdited();
     }
 }
 
@@ -400,7 +627,7 @@ void SessionManager::setInstanceGame(int index, const QString &gameCommand)
 {
     if (index >= 0 && index < m_currentProfile.instances.size()) {
         m_currentProfile.instances[index].gameCommand = gameCommand;
-        Q_EMIT instancesChanged();
+        instancesEdited();
     }
 }
 
@@ -408,7 +635,7 @@ void SessionManager::setInstancePreset(int index, const QString &presetId)
 {
     if (index >= 0 && index < m_currentProfile.instances.size()) {
         m_currentProfile.instances[index].presetId = presetId;
-        Q_EMIT instancesChanged();
+        instancesEdited();
     }
 }
 
@@ -416,7 +643,7 @@ void SessionManager::setInstanceSharedDirectories(int index, const QStringList &
 {
     if (index >= 0 && index < m_currentProfile.instances.size()) {
         m_currentProfile.instances[index].sharedDirectories = directories;
-        Q_EMIT instancesChanged();
+        instancesEdited();
     }
 }
 
@@ -477,7 +704,7 @@ void SessionManager::recalculateOutputResolutions(int screenWidth, int screenHei
         inst.internalHeight = inst.outputHeight;
     }
 
-    Q_EMIT instancesChanged();
+    instancesEdited();
 }
 
 QStringList SessionManager::getAssignedUsers(int excludeIndex) const
@@ -12,7 +12,8 @@
 #include <KConfig>
 #include <KConfigGroup>
 
-class SessionManager;
+class InstanceListModel;
+class QTimer;
 
 /**
  * @brief Configuration for a single gamescope instance
@@ -26,6 +27,7 @@ struct InstanceConfig {
     Q_PROPERTY(int outputWidth MEMBER outputWidth)
     Q_PROPERTY(int outputHeight MEMBER outputHeight)
     Q_PROPERTY(int refreshRate MEMBER refreshRate)
+    Q_PROPERTY(int frameLimit MEMBER frameLimit)
     Q_PROPERTY(QString scalingMode MEMBER scalingMode)
     Q_PROPERTY(QString filterMode MEMBER filterMode)
     Q_PROPERTY(QList<int> devices MEMBER devices)
@@ -35,6 +37,11 @@ struct InstanceConfig {
     Q_PROPERTY(QString steamAppId MEMBER steamAppId)
     Q_PROPERTY(QString presetId MEMBER presetId)
     Q_PROPERTY(QStringList sharedDirectories MEMBER sharedDirectories)
+    Q_PROPERTY(int cpuWeight MEMBER cpuWeight)
+    Q_PROPERTY(QString cpuCores MEMBER cpuCores)
+    Q_PROPERTY(int ioWeight MEMBER ioWeight)
+    Q_PROPERTY(int memoryHighMb MEMBER memoryHighMb)
+    Q_PROPERTY(QString gpu MEMBER gpu)
 
 public:
     QString username;
@@ -44,6 +51,7 @@ public:
     int outputWidth = 960;
     int outputHeight = 1080;
     int refreshRate = 60;
+    int frameLimit = 0;                               // fps cap, 0 = the profile's frameLimit
     QString scalingMode = QStringLiteral("fit");
     QString filterMode = QStringLiteral("linear");
     QList<int> devices;                               // Runtime: current event numbers
@@ -53,6 +61,12 @@ public:
     QString steamAppId;                              // Steam App ID for Steam launch mode
     QString presetId = QStringLiteral("steam");      // ID of the launch preset to use
     QStringList sharedDirectories;                   // Per-instance shared directories (from preset)
+    // Resource controls for the instance's cgroup, 0/empty keeps the system default
+    int cpuWeight = 0;                               // cpu.weight, 1-10000 (default 100)
+    QString cpuCores;                                // cpuset, e.g. "0-3,8-11"
+    int ioWeight = 0;                                // io.weight, 1-10000 (default 100)
+    int memoryHighMb = 0;                            // memory.high in MiB
+    QString gpu;                                     // PCI address, "auto" or empty, see GpuTopology
 };
 
 Q_DECLARE_METATYPE(InstanceConfig)
@@ -65,11 +79,29 @@ struct SessionProfile {
     Q_PROPERTY(QString name MEMBER name)
     Q_PROPERTY(QString layout MEMBER layout)
     Q_PROPERTY(QString filePath MEMBER filePath)
+    Q_PROPERTY(bool performanceMode MEMBER performanceMode)
+    Q_PROPERTY(int gpuBudget MEMBER gpuBudget)
+    Q_PROPERTY(bool dynamicResolution MEMBER dynamicResolution)
+    Q_PROPERTY(int minRenderScale MEMBER minRenderScale)
+    Q_PROPERTY(int maxRenderScale MEMBER maxRenderScale)
+    Q_PROPERTY(int frameLimit MEMBER frameLimit)
+    Q_PROPERTY(bool equalFrameShare MEMBER equalFrameShare)
+    Q_PROPERTY(bool shareCaches MEMBER shareCaches)
+    Q_PROPERTY(bool writableShares MEMBER writableShares)
 
 public:
     QString name;
     QString layout = QStringLiteral("horizontal"); // horizontal, vertical, multi-monitor
     QString filePath;
+    bool performanceMode = false;                  // Lower internal resolution + FSR to fit gpuBudget
+    int gpuBudget = 0;                             // Mpx/s for all instances, 0 = from the detected GPU
+    bool dynamicResolution = false;                // Per-player render scale from frame times
+    int minRenderScale = 50;                       // Percent per axis dynamicResolution goes down to
+    int maxRenderScale = 100;                      // ... and up to
+    int frameLimit = 0;                            // fps cap for instances without their own, 0 = none
+    bool equalFrameShare = false;                  // Same cap for all, an even share of the display refresh
+    bool shareCaches = true;                       // Seed players' shader caches and Proton prefixes by reflink
+    bool writableShares = false;                   // Shared directories as per-player overlays, not bind mounts
     QList<InstanceConfig> instances;
 };
 
@@ -77,18 +109,39 @@ Q_DECLARE_METATYPE(SessionProfile)
 
 /**
  * @brief Manages session profiles - save, load, and current session state
+ *
+ * Once the current session has a profile (saved or loaded), edits are
+ * written back to it automatically. Changes are coalesced and written
+ * AUTOSAVE_DELAY_MS after the last one, so dragging a slider writes
+ * the file once; setters that don't change anything don't schedule a
+ * write at all.
  */
 class SessionManager : public QObject
 {
     Q_OBJECT
     QML_ELEMENT
+    Q_MOC_INCLUDE("InstanceListModel.h")
     Q_PROPERTY(QString currentProfileName READ currentProfileName NOTIFY currentProfileChanged)
     Q_PROPERTY(QString currentLayout READ currentLayout WRITE setCurrentLayout NOTIFY currentLayoutChanged)
     Q_PROPERTY(int instanceCount READ instanceCount WRITE setInstanceCount NOTIFY instanceCountChanged)
+    Q_PROPERTY(bool performanceMode READ performanceMode WRITE setPerformanceMode NOTIFY performanceModeChanged)
+    Q_PROPERTY(int gpuBudget READ gpuBudget WRITE setGpuBudget NOTIFY gpuBudgetChanged)
+    Q_PROPERTY(bool dynamicResolution READ dynamicResolution WRITE setDynamicResolution NOTIFY dynamicResolutionChanged)
+    Q_PROPERTY(int minRenderScale READ minRenderScale WRITE setMinRenderScale NOTIFY dynamicResolutionChanged)
+    Q_PROPERTY(int maxRenderScale READ maxRenderScale WRITE setMaxRenderScale NOTIFY dynamicResolutionChanged)
+    Q_PROPERTY(int frameLimit READ frameLimit WRITE setFrameLimit NOTIFY frameLimitChanged)
+    Q_PROPERTY(bool equalFrameShare READ equalFrameShare WRITE setEqualFrameShare NOTIFY equalFrameShareChanged)
+    Q_PROPERTY(bool shareCaches READ shareCaches WRITE setShareCaches NOTIFY shareCachesChanged)
+    Q_PROPERTY(bool writableShares READ writableShares WRITE setWritableShares NOTIFY writableSharesChanged)
     Q_PROPERTY(QVariantList savedProfiles READ savedProfilesAsVariant NOTIFY savedProfilesChanged)
     Q_PROPERTY(QVariantList instances READ instancesAsVariant NOTIFY instancesChanged)
+    Q_PROPERTY(InstanceListModel* instanceModel READ instanceModel CONSTANT)
 
 public:
+    static constexpr int AUTOSAVE_DELAY_MS = 1000;
+    // Lowest minRenderScale/maxRenderScale, in percent
+    static constexpr int MIN_RENDER_SCALE = 25;
+
     explicit SessionManager(QObject *parent = nullptr);
     ~SessionManager() override;
 
@@ -131,16 +184,94 @@ public:
     int instanceCount() const { return m_currentProfile.instances.size(); }
     void setInstanceCount(int count);
 
+    /**
+     * @brief Render below the window resolution when the GPU can't keep up
+     *
+     * See RenderBudget; gpuBudget 0 picks the budget from the detected GPU.
+     */
+    bool performanceMode() const { return m_currentProfile.performanceMode; }
+    void setPerformanceMode(bool enabled);
+    int gpuBudget() const { return m_currentProfile.gpuBudget; }
+    void setGpuBudget(int megapixelsPerSecond);
+
+    /**
+     * @brief Adjust each player's render resolution to their frame rate while the session runs
+     *
+     * See ResolutionController. The scale stays between minRenderScale and
+     * maxRenderScale percent per axis; a change relaunches the player's
+     * instance, so it is only made after a sustained miss or headroom.
+     */
+    bool dynamicResolution() const { return m_currentProfile.dynamicResolution; }
+    void setDynamicResolution(bool enabled);
+    int minRenderScale() const { return m_currentProfile.minRenderScale; }
+    void setMinRenderScale(int percent);
+    int maxRenderScale() const { return m_currentProfile.maxRenderScale; }
+    void setMaxRenderScale(int percent);
+
+    /**
+     * @brief Session-wide frame rate cap, used by instances without their own
+     *
+     * With equalFrameShare every instance gets the same cap instead, see
+     * SessionRunner::equalShareFrameLimit().
+     */
+    int frameLimit() const { return m_currentProfile.frameLimit; }
+    void setFrameLimit(int fps);
+    bool equalFrameShare() const { return m_currentProfile.equalFrameShare; }
+    void setEqualFrameShare(bool enabled);
+
+    /**
+     * @brief Whether players start from the compositor user's caches
+     *
+     * Steam games' shader caches and Proton prefixes are reflinked into a
+     * player's home when they have none yet, so the first launch doesn't
+     * rebuild them. Needs a filesystem with reflinks (btrfs, XFS).
+     */
+    bool shareCaches() const { return m_currentProfile.shareCaches; }
+    void setShareCaches(bool enabled);
+
+    /**
+     * @brief Whether players get a writable view of shared directories
+     *
+     * Each player sees an overlay of the compositor user's directory with
+     * their own changes on top, instead of a bind mount they can only
+     * write to where permissions allow. See the helper's
+     * MountSharedDirectories().
+     */
+    bool writableShares() const { return m_currentProfile.writableShares; }
+    void setWritableShares(bool enabled);
+
     QList<SessionProfile> savedProfiles() const { return m_savedProfiles; }
     QVariantList savedProfilesAsVariant() const;
     QVariantList instancesAsVariant() const;
 
+    /**
+     * @brief The instances as a model with per-role change notifications
+     */
+    InstanceListModel *instanceModel() const { return m_instanceModel; }
+
     const SessionProfile &currentProfile() const { return m_currentProfile; }
 
+    /**
+     * @brief Whether edits are waiting to be written to the current profile
+     */
+    bool hasPendingAutosave() const;
+
+    /**
+     * @brief Write pending edits now instead of waiting for the timer
+     */
+    void flushAutosave();
+
 Q_SIGNALS:
     void currentProfileChanged();
     void currentLayoutChanged();
     void instanceCountChanged();
+    void performanceModeChanged();
+    void gpuBudgetChanged();
+    void dynamicResolutionChanged();
+    void frameLimitChanged();
+    void equalFrameShareChanged();
+    void shareCachesChanged();
+    void writableSharesChanged();
     void savedProfilesChanged();
     void instancesChanged();
     void errorOccurred(const QString &message);
@@ -157,7 +288,15 @@ Q_SIGNALS:
 private:
     QString profilesDir() const;
     QString profilePath(const QString &name) const;
+    void writeProfile(const QString &path, const QString &name) const;
+
+    // After any instance edit: update the model, notify, schedule a save
+    void instancesEdited();
+    void scheduleAutosave();
 
     SessionProfile m_currentProfile;
     QList<SessionProfile> m_savedProfiles;
+    InstanceListModel *m_instanceModel = nullptr;
+    QTimer *m_autosaveTimer = nullptr;
+    bool m_dirty = false;
 };
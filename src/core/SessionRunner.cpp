@@ -2,27 +2,39 @@
 // SPDX-FileCopyrightText: 2025 CouchPlay Contributors
 
 #include "SessionRunner.h"
+#include "AudioManager.h"
 #include "GamescopeInstance.h"
+#include "InputLatencyMonitor.h"
+#include "InstancePool.h"
 #include "Logging.h"
 #include "SessionManager.h"
+#include "SessionTrace.h"
 #include "DeviceManager.h"
+#include "GpuTopology.h"
+#include "MonitorManager.h"
 #include "PresetManager.h"
+#include "RenderBudget.h"
+#include "ResolutionController.h"
+#include "StartupTrace.h"
 #include "SteamConfigManager.h"
+#include "UserDirectory.h"
+#include "UserManager.h"
 #include "WindowManager.h"
 #include "../dbus/CouchPlayHelperClient.h"
 
 #include <QAction>
+#include <QDBusPendingReply>
 #include <QDebug>
 #include <QDir>
 #include <QGuiApplication>
+#include <QPointer>
 #include <QScreen>
 #include <QSet>
+#include <QTimer>
 
 #include <KGlobalAccel>
 #include <KLocalizedString>
 
-#include <pwd.h>
-#include <grp.h>
 #include <unistd.h>
 
 // Name of the couchplay group for managed users
@@ -31,31 +43,19 @@ static const QString COUCHPLAY_GROUP = QStringLiteral("couchplay");
 // Helper function to check if a user is in the couchplay group
 static bool isUserInCouchPlayGroup(const QString &username)
 {
-    struct group *grp = getgrnam(COUCHPLAY_GROUP.toLocal8Bit().constData());
-    if (!grp) {
-        return false;  // Group doesn't exist
-    }
-
-    // Check if username is in the group's member list
-    for (char **member = grp->gr_mem; *member != nullptr; ++member) {
-        if (username == QString::fromLocal8Bit(*member)) {
-            return true;
-        }
-    }
-
-    // Also check if couchplay is the user's primary group
-    struct passwd *pw = getpwnam(username.toLocal8Bit().constData());
-    if (pw && pw->pw_gid == grp->gr_gid) {
-        return true;
-    }
-
-    return false;
+    return UserDirectory::instance().isInGroup(username, COUCHPLAY_GROUP);
 }
 
 SessionRunner::SessionRunner(QObject *parent)
     : QObject(parent)
     , m_windowManager(new WindowManager(this))
+    , m_telemetry(new InstanceTelemetry(this))
+    , m_resolution(new ResolutionController(this))
+    , m_pool(new InstancePool(this))
+    , m_warmTimer(new QTimer(this))
+    , m_relayoutTimer(new QTimer(this))
 {
+    StartupTrace::Scope trace("SessionRunner");
     setStatus(QStringLiteral("Ready"));
     
     // Set up global shortcut for stopping session
@@ -66,11 +66,67 @@ SessionRunner::SessionRunner(QObject *parent)
             this, &SessionRunner::onWindowPositioned);
     connect(m_windowManager, &WindowManager::positioningTimedOut,
             this, &SessionRunner::onWindowPositioningTimeout);
+
+    // Profile edits arrive in bursts (one signal per field), warm up once they settle
+    m_warmTimer->setSingleShot(true);
+    m_warmTimer->setInterval(2000);
+    connect(m_warmTimer, &QTimer::timeout, this, &SessionRunner::warmStandby);
+    connect(m_pool, &InstancePool::enabledChanged, this, &SessionRunner::scheduleWarmStandby);
+    connect(m_pool, &InstancePool::prelaunchChanged, this, &SessionRunner::scheduleWarmStandby);
+    connect(m_pool, &InstancePool::evicted, this, &SessionRunner::onStandbyEvicted);
+
+    // A mode switch reports geometry and refresh rate separately
+    m_relayoutTimer->setSingleShot(true);
+    m_relayoutTimer->setInterval(250);
+    connect(m_relayoutTimer, &QTimer::timeout, this, &SessionRunner::relayout);
+
+    // Telemetry follows the instances, whichever way they were started
+    connect(this, &SessionRunner::instanceStarted, this, [this](int index) {
+        for (const auto *instance : std::as_const(m_instances)) {
+            if (instance->index() == index && instance->isRunning()) {
+                m_telemetry->track(index, instance->pid());
+            }
+        }
+    });
+    connect(this, &SessionRunner::instanceStopped, m_telemetry, &InstanceTelemetry::untrack);
+
+    // Dynamic resolution: instances are tracked from their first start on,
+    // relaunches keep their state
+    connect(this, &SessionRunner::instanceStarted, this, [this](int index) {
+        if (m_sessionManager && m_sessionManager->currentProfile().dynamicResolution
+            && !m_resolution->isTracking(index)) {
+            m_resolution->track(index, instanceRenderScale(index), targetFrameRate(index));
+        }
+    });
+    connect(m_telemetry, &InstanceTelemetry::updated, this, &SessionRunner::updateDynamicResolution);
+    connect(m_resolution, &ResolutionController::scaleChanged, this, &SessionRunner::onRenderScaleChanged);
+
+    m_resumableProfile = LaunchPlan::load(LaunchPlan::defaultPath()).profileName;
 }
 
 SessionRunner::~SessionRunner()
 {
-    stop();
+    // There is no event loop left to wait on, so tear down synchronously
+    const bool active = isRunning() || m_starting || m_stopping;
+    ++m_startGeneration;
+    for (auto *instance : std::as_const(m_instances)) {
+        disconnect(instance, nullptr, this, nullptr);
+        if (instance->isRunning()) {
+            instance->stop();
+        }
+    }
+    if (active) {
+        if (m_helperClient && m_helperClient->isAvailable()) {
+            if (!m_ownedDevicePaths.isEmpty()) {
+                m_helperClient->restoreAllDevices();
+            }
+            m_helperClient->unmountAllSharedDirectories();
+        }
+        releaseSessionPlayers();
+    }
+    // Stop standby instances without queueing unmounts on the way out
+    disconnect(m_pool, nullptr, this, nullptr);
+    m_pool->clear();
 }
 
 void SessionRunner::setStatus(const QString &status)
@@ -84,8 +140,29 @@ void SessionRunner::setStatus(const QString &status)
 void SessionRunner::setSessionManager(SessionManager *manager)
 {
     if (m_sessionManager != manager) {
+        if (m_sessionManager) {
+            disconnect(m_sessionManager, nullptr, this, nullptr);
+        }
+
         m_sessionManager = manager;
+
+        if (m_sessionManager) {
+            connect(m_sessionManager, &SessionManager::currentProfileChanged,
+                    this, &SessionRunner::scheduleWarmStandby);
+            connect(m_sessionManager, &SessionManager::instancesChanged,
+                    this, &SessionRunner::scheduleWarmStandby);
+            connect(m_sessionManager, &SessionManager::performanceModeChanged,
+                    this, &SessionRunner::scheduleWarmStandby);
+            connect(m_sessionManager, &SessionManager::gpuBudgetChanged,
+                    this, &SessionRunner::scheduleWarmStandby);
+            connect(m_sessionManager, &SessionManager::frameLimitChanged,
+                    this, &SessionRunner::scheduleWarmStandby);
+            connect(m_sessionManager, &SessionManager::equalFrameShareChanged,
+                    this, &SessionRunner::scheduleWarmStandby);
+        }
+
         Q_EMIT sessionManagerChanged();
+        scheduleWarmStandby();
     }
 }
 
@@ -96,6 +173,8 @@ void SessionRunner::setDeviceManager(DeviceManager *manager)
         if (m_deviceManager) {
             disconnect(m_deviceManager, &DeviceManager::deviceReconnected,
                       this, &SessionRunner::onDeviceReconnected);
+            disconnect(m_deviceManager, &DeviceManager::deviceAssigned,
+                      this, &SessionRunner::onDeviceAssigned);
         }
         
         m_deviceManager = manager;
@@ -104,6 +183,8 @@ void SessionRunner::setDeviceManager(DeviceManager *manager)
         if (m_deviceManager) {
             connect(m_deviceManager, &DeviceManager::deviceReconnected,
                    this, &SessionRunner::onDeviceReconnected);
+            connect(m_deviceManager, &DeviceManager::deviceAssigned,
+                   this, &SessionRunner::onDeviceAssigned);
         }
         
         Q_EMIT deviceManagerChanged();
@@ -113,7 +194,17 @@ void SessionRunner::setDeviceManager(DeviceManager *manager)
 void SessionRunner::setHelperClient(CouchPlayHelperClient *client)
 {
     if (m_helperClient != client) {
+        if (m_helperClient) {
+            disconnect(m_helperClient, &CouchPlayHelperClient::availabilityChanged,
+                       this, &SessionRunner::scheduleWarmStandby);
+        }
         m_helperClient = client;
+        m_telemetry->setHelperClient(client);
+        // The helper answers after startup; standby instances need it
+        if (m_helperClient) {
+            connect(m_helperClient, &CouchPlayHelperClient::availabilityChanged,
+                    this, &SessionRunner::scheduleWarmStandby);
+        }
         Q_EMIT helperClientChanged();
     }
 }
@@ -126,6 +217,35 @@ void SessionRunner::setPresetManager(PresetManager *manager)
     }
 }
 
+void SessionRunner::setAudioManager(AudioManager *manager)
+{
+    if (m_audioManager != manager) {
+        m_audioManager = manager;
+        Q_EMIT audioManagerChanged();
+    }
+}
+
+void SessionRunner::setMonitorManager(MonitorManager *manager)
+{
+    if (m_monitorManager != manager) {
+        if (m_monitorManager) {
+            disconnect(m_monitorManager, nullptr, this, nullptr);
+        }
+
+        m_monitorManager = manager;
+
+        if (m_monitorManager) {
+            connect(m_monitorManager, &MonitorManager::monitorsChanged,
+                    this, &SessionRunner::scheduleWarmStandby);
+            connect(m_monitorManager, &MonitorManager::monitorsChanged,
+                    this, &SessionRunner::scheduleRelayout);
+        }
+
+        Q_EMIT monitorManagerChanged();
+        scheduleWarmStandby();
+    }
+}
+
 void SessionRunner::setSteamConfigManager(SteamConfigManager *manager)
 {
     if (m_steamConfigManager != manager) {
@@ -139,21 +259,116 @@ void SessionRunner::setBorderlessWindows(bool borderless)
     if (m_borderlessWindows != borderless) {
         m_borderlessWindows = borderless;
         Q_EMIT borderlessWindowsChanged();
+        scheduleWarmStandby(); // Part of the gamescope command line
+    }
+}
+
+void SessionRunner::setInputRouting(bool enabled)
+{
+    if (m_inputRouting != enabled) {
+        m_inputRouting = enabled;
+        Q_EMIT inputRoutingChanged();
+    }
+}
+
+void SessionRunner::setInputDiagnostics(bool enabled)
+{
+    if (m_inputDiagnostics == enabled) {
+        return;
+    }
+    m_inputDiagnostics = enabled;
+    Q_EMIT inputDiagnosticsChanged();
+
+    if (!enabled) {
+        stopInputDiagnostics();
+    } else if (isRunning() || m_starting) {
+        startInputDiagnostics();
     }
 }
 
 bool SessionRunner::start()
+{
+    return startSession(LaunchPlan());
+}
+
+bool SessionRunner::resume()
+{
+    if (!m_sessionManager) {
+        Q_EMIT errorOccurred(QStringLiteral("No session manager configured"));
+        return false;
+    }
+
+    // Checked by startSession() too, but before the profile is switched
+    if (isRunning() || m_starting || m_stopping) {
+        Q_EMIT errorOccurred(QStringLiteral("Session already running"));
+        return false;
+    }
+
+    const LaunchPlan plan = LaunchPlan::load(LaunchPlan::defaultPath());
+    if (plan.profileName.isEmpty()) {
+        Q_EMIT errorOccurred(QStringLiteral("No session to resume"));
+        return false;
+    }
+    if (m_sessionManager->currentProfile().name != plan.profileName
+        && !m_sessionManager->loadProfile(plan.profileName)) {
+        return false; // loadProfile() reports why
+    }
+
+    const QString blocker = resumeBlocker(plan);
+    if (!blocker.isEmpty()) {
+        qCDebug(couchplayCore) << "Starting" << plan.profileName << "afresh:" << blocker;
+        return startSession(LaunchPlan());
+    }
+
+    qCDebug(couchplayCore) << "Resuming" << plan.profileName << "from its launch plan";
+    return startSession(plan);
+}
+
+QString SessionRunner::resumeBlocker(const LaunchPlan &plan) const
+{
+    const SessionProfile &profile = m_sessionManager->currentProfile();
+    if (plan.instances.size() != profile.instances.size()
+        || LaunchPlan::fileHash(profile.filePath) != plan.profileHash) {
+        return QStringLiteral("profile changed");
+    }
+
+    const bool perPlayerAudio = m_audioManager && m_audioManager->hasPerPlayerAudio();
+    const QList<MonitorLayout::Slot> layouts = layoutSlots();
+    for (int i = 0; i < plan.instances.size(); ++i) {
+        const QVariantMap &config = plan.instances[i].config;
+        const QRect geometry(config.value(QStringLiteral("positionX")).toInt(),
+                             config.value(QStringLiteral("positionY")).toInt(),
+                             config.value(QStringLiteral("outputWidth")).toInt(),
+                             config.value(QStringLiteral("outputHeight")).toInt());
+        if (i >= layouts.size() || layouts[i].geometry != geometry) {
+            return QStringLiteral("monitors changed");
+        }
+        if (config.value(QStringLiteral("borderless")).toBool() != m_borderlessWindows
+            || config.contains(QStringLiteral("audioSink")) != perPlayerAudio) {
+            return QStringLiteral("settings changed");
+        }
+    }
+
+    return plan.validate();
+}
+
+bool SessionRunner::startSession(const LaunchPlan &plan)
 {
     if (!m_sessionManager) {
         Q_EMIT errorOccurred(QStringLiteral("No session manager configured"));
         return false;
     }
 
-    if (isRunning()) {
+    if (isRunning() || m_starting) {
         Q_EMIT errorOccurred(QStringLiteral("Session already running"));
         return false;
     }
 
+    if (m_stopping) {
+        Q_EMIT errorOccurred(QStringLiteral("Previous session is still stopping"));
+        return false;
+    }
+
     setStatus(QStringLiteral("Starting session..."));
 
     // Clean up any previous instances
@@ -185,8 +400,8 @@ bool SessionRunner::start()
 
     // Validate that all users either are the compositor user or are in the couchplay group
     // This ensures only CouchPlay-managed users can be assigned to sessions
-    struct passwd *compositorPw = getpwuid(getuid());
-    QString compositorUser = compositorPw ? QString::fromLocal8Bit(compositorPw->pw_name) : QString();
+    const std::optional<UserEntry> compositorEntry = UserDirectory::instance().user(getuid());
+    QString compositorUser = compositorEntry ? compositorEntry->name : QString();
     
     for (int i = 0; i < instanceCount; ++i) {
         const QString &username = profile.instances[i].username;
@@ -207,134 +422,1118 @@ bool SessionRunner::start()
         }
     }
 
-    // Calculate window layouts
-    QRect screenGeometry = getScreenGeometry();
-    QList<QRect> layouts = calculateLayout(profile.layout, instanceCount, screenGeometry);
+    // A player pinned to a GPU they can't open would get software rendering
+    const QList<GpuTopology::Gpu> gpus = GpuTopology::enumerate();
+    for (int i = 0; i < instanceCount; ++i) {
+        const int gpu = GpuTopology::indexOf(gpus, profile.instances[i].gpu);
+        if (gpu < 0) {
+            continue;  // Default, automatic, or gone and placed automatically
+        }
+        const QString &username = profile.instances[i].username;
+        const std::optional<UserEntry> entry = username.isEmpty() ? compositorEntry
+                                                                  : UserDirectory::instance().user(username);
+        if (entry && !GpuTopology::canAccess(gpus[gpu].renderNode, *entry)) {
+            Q_EMIT errorOccurred(QStringLiteral("User '%1' cannot access %2 (%3). Add them to its group, usually 'render', or choose another GPU.")
+                                     .arg(entry->name, gpus[gpu].renderNode, gpus[gpu].name));
+            setStatus(QStringLiteral("Error"));
+            return false;
+        }
+    }
 
-    // Set up device ownership (requires polkit helper)
-    if (!setupDeviceOwnership()) {
-        qWarning() << "Failed to set up device ownership - continuing anyway";
+    // Either launch what an earlier start recorded, or record this one
+    m_resuming = !plan.isEmpty();
+    m_plan = plan;
+    m_startFailed = false;
+    if (!m_resuming) {
+        m_plan.profileName = profile.name;
+        m_plan.profileHash = LaunchPlan::fileHash(profile.filePath);
+        m_plan.instances.resize(instanceCount);
     }
 
-    // Set up shared directory mounts (requires polkit helper)
-    if (!setupSharedDirectories()) {
-        qWarning() << "Failed to set up shared directories - continuing anyway";
+    if (SessionTrace::enabled()) {
+        // The helper handles our calls in order: everything sent after this is traced
+        SessionTrace::begin(profile.name);
+        m_tracing = true;
+        m_traceWindows = 0;
+        m_traceSpan = SessionTrace::open("session", QStringLiteral("Start session"), QStringLiteral("Session"));
+        if (m_helperClient && m_helperClient->isAvailable()) {
+            m_helperClient->beginTraceAsync();
+        }
     }
 
-    // Set up launcher access (ACLs, shortcut sync)
-    if (!setupLauncherAccess()) {
-        qWarning() << "Failed to set up launcher access - continuing anyway";
+    // One polkit check for the whole start; the calls queued behind it ride on the grant
+    if (m_helperClient && m_helperClient->isAvailable()) {
+        m_helperClient->authorizeSessionAsync();
     }
 
-    // Create and start instances
-    for (int i = 0; i < instanceCount; ++i) {
-        const InstanceConfig &instConfig = profile.instances[i];
-        
-        // Create instance
-        auto *instance = new GamescopeInstance(this);
-        connect(instance, &GamescopeInstance::started, this, &SessionRunner::onInstanceStarted);
-        connect(instance, &GamescopeInstance::stopped, this, &SessionRunner::onInstanceStopped);
-        connect(instance, &GamescopeInstance::errorOccurred, this, &SessionRunner::onInstanceError);
-
-        // Build config map for the instance
-        QVariantMap config;
-        config[QStringLiteral("username")] = instConfig.username;
-        config[QStringLiteral("monitor")] = instConfig.monitor;
-        
-        // Derive resolution from layout - internal resolution matches output resolution
-        // This ensures games render at the correct size for their window
-        config[QStringLiteral("internalWidth")] = layouts[i].width();
-        config[QStringLiteral("internalHeight")] = layouts[i].height();
-        config[QStringLiteral("outputWidth")] = layouts[i].width();
-        config[QStringLiteral("outputHeight")] = layouts[i].height();
-        config[QStringLiteral("positionX")] = layouts[i].x();
-        config[QStringLiteral("positionY")] = layouts[i].y();
-        config[QStringLiteral("refreshRate")] = instConfig.refreshRate;
-        config[QStringLiteral("scalingMode")] = instConfig.scalingMode;
-        config[QStringLiteral("filterMode")] = instConfig.filterMode;
-        config[QStringLiteral("gameCommand")] = instConfig.gameCommand;
-        config[QStringLiteral("steamAppId")] = instConfig.steamAppId;
-        config[QStringLiteral("borderless")] = m_borderlessWindows;
-
-        // Look up preset and add resolved command/settings
-        if (m_presetManager) {
-            QString presetId = instConfig.presetId;
-            if (presetId.isEmpty()) {
-                presetId = QStringLiteral("steam");  // Default
-            }
-            config[QStringLiteral("presetId")] = presetId;
-            config[QStringLiteral("presetCommand")] = m_presetManager->getCommand(presetId);
-            config[QStringLiteral("presetWorkingDirectory")] = m_presetManager->getWorkingDirectory(presetId);
-            config[QStringLiteral("steamIntegration")] = m_presetManager->getSteamIntegration(presetId);
-        } else {
-            // Fallback if no PresetManager
-            config[QStringLiteral("presetId")] = QStringLiteral("steam");
-            config[QStringLiteral("presetCommand")] = QStringLiteral("steam -tenfoot -steamdeck");
-            config[QStringLiteral("steamIntegration")] = true;
+    // Sinks first: they are part of each instance's config
+    if (m_audioManager) {
+        m_audioManager->createPlayerSinks(instanceCount);
+    }
+
+    // Calculate window layouts
+    m_startLayouts = layoutSlots();
+    m_resolution->clear();
+    m_resolution->setBounds(profile.minRenderScale / 100.0, profile.maxRenderScale / 100.0);
+
+    // Standby entries that no longer match what would be launched are useless
+    m_warmTimer->stop();
+    ++m_warmGeneration;
+    for (int index : m_pool->indexes()) {
+        if (index >= instanceCount
+            || !m_pool->matches(index, InstancePool::launchKey(startConfig(index)))) {
+            m_pool->evict(index, QStringLiteral("profile changed"));
         }
+    }
 
-        // Get device paths for this instance
-        if (m_deviceManager) {
-            QStringList devicePaths = m_deviceManager->getDevicePathsForInstance(i);
-            QVariantList pathList;
-            for (const QString &path : devicePaths) {
-                pathList.append(path);
-            }
-            config[QStringLiteral("devicePaths")] = pathList;
+    // Open device nodes for diagnostics while they still belong to us
+    if (m_inputDiagnostics) {
+        startInputDiagnostics();
+    }
+
+    // Prepare (one PrepareInstance call) and launch run as a staged pipeline
+    // on the event loop. Each instance advances through its own stages
+    // independently and launches as soon as it is prepared, so the UI stays
+    // responsive while the helper works.
+    m_ownedDevicePaths.clear();
+    m_startStates.clear();
+    m_startStates.resize(instanceCount);
+    m_completedStartStages = 0;
+    ++m_startGeneration;
+    m_starting = true;
+    m_startTimer.start();
+    Q_EMIT startingChanged();
+    Q_EMIT startProgressChanged();
+
+    for (int i = 0; i < instanceCount; ++i) {
+        scheduleStartStage(i);
+    }
+
+    return true;
+}
+
+QString SessionRunner::startStageName(int stage)
+{
+    switch (stage) {
+    case StagePrepare:
+        return QStringLiteral("prepare");
+    case StageLaunch:
+        return QStringLiteral("launch");
+    default:
+        return QString();
+    }
+}
+
+qreal SessionRunner::startProgress() const
+{
+    const int totalStages = m_startStates.size() * StageCount;
+    if (totalStages == 0) {
+        return m_starting ? 0.0 : 1.0;
+    }
+    return static_cast<qreal>(m_completedStartStages) / totalStages;
+}
+
+void SessionRunner::scheduleStartStage(int index)
+{
+    const quint64 generation = m_startGeneration;
+    QTimer::singleShot(0, this, [this, index, generation]() {
+        // Ignore stages queued by a start() that has since been stopped
+        if (!isCurrentStart(generation)) {
+            return;
         }
+        runStartStage(index);
+    });
+}
 
-        m_instances.append(instance);
+void SessionRunner::runStartStage(int index)
+{
+    if (index < 0 || index >= m_startStates.size()) {
+        return;
+    }
+
+    InstanceStartState &state = m_startStates[index];
+    const int stage = state.nextStage;
+    state.stageTimer.start();
+    state.traceSpan = SessionTrace::open("stage", startStageName(stage), QStringLiteral("Instance %1").arg(index));
+    Q_EMIT startStageStarted(index, startStageName(stage));
+
+    switch (stage) {
+    case StagePrepare:
+        runPrepareStage(index);
+        break;
+    case StageLaunch:
+        launchInstance(index);
+        break;
+    default:
+        finishStartStage(index, m_startGeneration, true);
+        break;
+    }
+}
+
+void SessionRunner::finishStartStage(int index, quint64 generation, bool success)
+{
+    // Replies that arrive after stop() belong to an aborted start
+    if (!isCurrentStart(generation) || index < 0 || index >= m_startStates.size()) {
+        return;
+    }
+
+    InstanceStartState &state = m_startStates[index];
+    const int stage = state.nextStage;
+    const qint64 elapsedMs = state.stageTimer.elapsed();
+
+    if (!success) {
+        m_startFailed = true;
+        // Setup failures are not fatal: the instance still launches, matching
+        // the previous "continuing anyway" behaviour of the serial start path
+        qCWarning(couchplayCore) << "Instance" << index << "stage" << startStageName(stage)
+                                 << "failed - continuing anyway";
+    }
+    qCDebug(couchplayCore) << "Instance" << index << "stage" << startStageName(stage)
+                           << "finished in" << elapsedMs << "ms";
+    SessionTrace::close(state.traceSpan, {{QStringLiteral("success"), success}});
+
+    ++m_completedStartStages;
+    Q_EMIT startStageFinished(index, startStageName(stage), success, elapsedMs);
+    Q_EMIT startProgressChanged();
+
+    state.nextStage = stage + 1;
+    if (state.nextStage < StageCount) {
+        scheduleStartStage(index);
+        return;
+    }
 
-        // Start with slight delay between instances to avoid resource contention
-        if (!instance->start(config, i)) {
-            qWarning() << "Failed to start instance" << i;
+    for (const InstanceStartState &other : std::as_const(m_startStates)) {
+        if (other.nextStage < StageCount) {
+            return;
         }
     }
 
+    finishStart();
+}
+
+void SessionRunner::finishStart()
+{
+    const qint64 elapsedMs = m_startTimer.elapsed();
+    m_starting = false;
+    qCDebug(couchplayCore) << "Session start completed in" << elapsedMs << "ms";
+
+    // Only a start that fully went through is worth repeating; unsaved
+    // profiles can't be loaded again to resume
+    if (!m_startFailed && !m_plan.profileName.isEmpty()
+        && runningInstanceCount() == m_plan.instances.size()
+        && m_plan.save(LaunchPlan::defaultPath()) && m_resumableProfile != m_plan.profileName) {
+        m_resumableProfile = m_plan.profileName;
+        Q_EMIT resumableProfileChanged();
+    }
+    m_resuming = false;
+
     setStatus(QStringLiteral("Session running"));
+    Q_EMIT startingChanged();
     Q_EMIT runningChanged();
     Q_EMIT instancesChanged();
+    Q_EMIT startupFinished(elapsedMs);
     Q_EMIT sessionStarted();
 
+    SessionTrace::close(m_traceSpan);
+    if (m_tracing && m_traceWindows <= 0) {
+        finishTrace();
+    }
+}
+
+void SessionRunner::windowPlacementSettled()
+{
+    if (!m_tracing) {
+        return;
+    }
+    --m_traceWindows;
+    if (m_traceWindows <= 0 && !m_starting) {
+        finishTrace();
+    }
+}
+
+void SessionRunner::finishTrace()
+{
+    if (!m_tracing) {
+        return;
+    }
+    m_tracing = false;
+    SessionTrace::close(m_traceSpan);
+
+    if (!m_helperClient || !m_helperClient->isAvailable()) {
+        SessionTrace::save();
+        return;
+    }
+
+    QDBusPendingReply<QVariantMap> call = m_helperClient->takeTraceAsync();
+    CouchPlayHelperClient::awaitAll({call}, this, [this, call]() {
+        // A start in the meantime began a new trace
+        if (m_tracing) {
+            return;
+        }
+        QDBusPendingReply<QVariantMap> reply = call;
+        if (reply.isError()) {
+            qCWarning(couchplayCore) << "Session trace without the helper's spans:" << reply.error().message();
+        } else {
+            SessionTrace::addHelperSpans(reply.value());
+        }
+        SessionTrace::save();
+    });
+}
+
+bool SessionRunner::isCurrentStart(quint64 generation) const
+{
+    return m_starting && generation == m_startGeneration;
+}
+
+void SessionRunner::launchInstance(int index)
+{
+    const quint64 generation = m_startGeneration;
+    if (!m_sessionManager) {
+        finishStartStage(index, generation, false);
+        return;
+    }
+
+    const SessionProfile &profile = m_sessionManager->currentProfile();
+    if (index < 0 || index >= profile.instances.size() || index >= m_startLayouts.size()) {
+        finishStartStage(index, generation, false);
+        return;
+    }
+
+    const QVariantMap config = startConfig(index);
+    if (!m_resuming && index < m_plan.instances.size()) {
+        LaunchPlan::Instance &planned = m_plan.instances[index];
+        planned.config = config;
+        planned.gamescopeArgs = GamescopeInstance::buildGamescopeArgs(config);
+        planned.gameCommand = GamescopeInstance::buildGameCommand(config);
+        planned.environment = GamescopeInstance::buildEnvironment(config);
+        planned.devices.clear();
+        for (const QVariant &path : config.value(QStringLiteral("devicePaths")).toList()) {
+            planned.devices.append({LaunchPlan::stableIdFor(path.toString()), path.toString()});
+        }
+    }
+
+    if (takeStandbyInstance(index, config)) {
+        finishStartStage(index, generation, true);
+        return;
+    }
+
+    auto *instance = new GamescopeInstance(this);
+    connect(instance, &GamescopeInstance::started, this, &SessionRunner::onInstanceStarted);
+    connect(instance, &GamescopeInstance::stopped, this, &SessionRunner::onInstanceStopped);
+    connect(instance, &GamescopeInstance::errorOccurred, this, &SessionRunner::onInstanceError);
+
+    m_instances.append(instance);
+
+    // Usually the prepare stage's call has launched it already
+    const InstanceStartState &state = m_startStates.at(index);
+    if (state.launchedPid > 0) {
+        finishStartStage(index, generation, instance->attach(config, index, state.launchedPid));
+        return;
+    }
+    if (state.launchFailed) {
+        finishStartStage(index, generation, false);  // Reported by the prepare stage
+        return;
+    }
+
+    launchThroughHelper(instance, config, [this, generation]() { return isCurrentStart(generation); },
+                        [this, index, generation](bool success) { finishStartStage(index, generation, success); });
+}
+
+void SessionRunner::launchThroughHelper(GamescopeInstance *instance, const QVariantMap &config,
+                                        const std::function<bool()> &current,
+                                        const std::function<void(bool)> &done)
+{
+    const int index = config.value(QStringLiteral("instanceIndex")).toInt();
+    if (!m_helperClient || !m_helperClient->isAvailable()) {
+        qWarning() << "Failed to start instance" << index << "- helper not available";
+        Q_EMIT errorOccurred(QStringLiteral("Instance %1: CouchPlay Helper service is not available. Please run: sudo ./scripts/install-helper.sh install")
+                                 .arg(index));
+        done(false);
+        return;
+    }
+
+    QStringList gamescopeArgs;
+    QStringList environment;
+    QString gameCommand;
+    GamescopeInstance::launchCommandLine(config, gamescopeArgs, environment, gameCommand);
+
+    // Relaunches come long after the session was authorized, whose grant may have lapsed
+    const QPointer<CouchPlayHelperClient> helper(m_helperClient);
+    const QString username = config.value(QStringLiteral("username")).toString();
+    const QPointer<GamescopeInstance> target(instance);
+    CouchPlayHelperClient::callAuthorized([helper, username, gamescopeArgs, gameCommand, environment]() {
+        if (!helper) {
+            return QDBusPendingCall::fromError(
+                QDBusError(QDBusError::ServiceUnknown, QStringLiteral("Helper not available")));
+        }
+        return QDBusPendingCall(helper->launchInstanceAsync(username, static_cast<uint>(getuid()),
+                                                            gamescopeArgs, gameCommand, environment));
+    }, this, [this, target, config, index, current, done](const QDBusPendingCall &call) {
+        QDBusPendingReply<qint64> reply = call;
+        const qint64 pid = reply.isError() ? 0 : reply.value();
+
+        // Stopped in the meantime: nothing would ever stop what was launched
+        if (!target || !m_instances.contains(target) || !current()) {
+            if (pid > 0 && m_helperClient) {
+                m_helperClient->stopInstanceAsync(pid);
+            }
+            return;
+        }
+
+        if (pid <= 0) {
+            const QString error = reply.isError() ? reply.error().message()
+                                                  : QStringLiteral("Helper service failed to launch instance");
+            qWarning() << "Failed to start instance" << index << ":" << error;
+            Q_EMIT errorOccurred(QStringLiteral("Instance %1: Failed to launch instance: %2").arg(index).arg(error));
+            done(false);
+            return;
+        }
+
+        const bool attached = target->attach(config, index, pid);
+        if (attached) {
+            target->applyResources(config.value(QStringLiteral("resources")).toMap());
+        }
+        done(attached);
+    });
+}
+
+QVariantMap SessionRunner::startConfig(int index) const
+{
+    if (m_resuming) {
+        QVariantMap config = m_plan.instances.value(index).launchConfig();
+        // The stats pipe lives in /tmp and may have to be created again
+        config[QStringLiteral("statsPath")] = m_telemetry->statsPipe(index);
+        return config;
+    }
+    return buildInstanceConfig(index, m_startLayouts.value(index));
+}
+
+QList<MonitorLayout::Slot> SessionRunner::layoutSlots() const
+{
+    QList<MonitorLayout::Slot> result;
+    if (!m_sessionManager) {
+        return result;
+    }
+
+    const SessionProfile &profile = m_sessionManager->currentProfile();
+    const int instanceCount = profile.instances.size();
+    if (profile.layout == QStringLiteral("multi-monitor") && m_monitorManager) {
+        result = MonitorLayout::assign(instanceCount, m_monitorManager->monitors());
+        if (result.size() == instanceCount) {
+            return result;
+        }
+        result.clear();
+    }
+
+    const QList<QRect> layouts = calculateLayout(profile.layout, instanceCount, getScreenGeometry());
+    for (const QRect &layout : layouts) {
+        MonitorLayout::Slot slot;
+        slot.geometry = layout;
+        slot.nativeSize = layout.size();
+        result.append(slot);
+    }
+    return result;
+}
+
+QVariantMap SessionRunner::buildInstanceConfig(int index, const MonitorLayout::Slot &slot) const
+{
+    QVariantMap config;
+    if (!m_sessionManager) {
+        return config;
+    }
+
+    const InstanceConfig instConfig = m_sessionManager->currentProfile().instances.value(index);
+
+    // Build config map for the instance
+    config[QStringLiteral("username")] = instConfig.username;
+    config[QStringLiteral("instanceIndex")] = index;
+    config[QStringLiteral("monitor")] = slot.monitor >= 0 ? slot.monitor : instConfig.monitor;
+
+    // Derive resolution from layout - games render at the window's size in
+    // device pixels, so gamescope doesn't scale at all
+    const QRect &layout = slot.geometry;
+    config[QStringLiteral("internalWidth")] = slot.nativeSize.width();
+    config[QStringLiteral("internalHeight")] = slot.nativeSize.height();
+    config[QStringLiteral("outputWidth")] = layout.width();
+    config[QStringLiteral("outputHeight")] = layout.height();
+    config[QStringLiteral("positionX")] = layout.x();
+    config[QStringLiteral("positionY")] = layout.y();
+    // An instance on its own monitor follows that monitor's mode
+    config[QStringLiteral("refreshRate")] = slot.refreshRate > 0 ? slot.refreshRate : instConfig.refreshRate;
+    if (!slot.output.isEmpty()) {
+        config[QStringLiteral("monitorName")] = slot.output;
+    }
+    config[QStringLiteral("frameLimit")] = frameLimitFor(index);
+    config[QStringLiteral("scalingMode")] = instConfig.scalingMode;
+
+    // Spread players over the GPUs; the render node is kept so a resumed
+    // plan can tell the card is still there
+    const QList<GpuTopology::Gpu> gpus = GpuTopology::enumerate();
+    const int gpu = GpuTopology::indexOf(gpus, gpuPlacement(gpus).value(index));
+    if (gpu >= 0) {
+        config[QStringLiteral("gpu")] = gpus[gpu].pciAddress;
+        config[QStringLiteral("gpuDevice")] = gpus[gpu].vkDevice();
+        config[QStringLiteral("gpuPrime")] = gpus[gpu].primeTag();
+        config[QStringLiteral("gpuTwin")] = GpuTopology::hasTwin(gpus, gpus[gpu]);
+        config[QStringLiteral("gpuRenderNode")] = gpus[gpu].renderNode;
+    }
+    config[QStringLiteral("filterMode")] = instConfig.filterMode;
+
+    // Performance target: render lower and let gamescope upscale with FSR
+    const double scale = instanceRenderScale(index);
+    if (scale < 1.0) {
+        const QSize internal = RenderBudget::internalSize(slot.nativeSize, scale);
+        config[QStringLiteral("internalWidth")] = internal.width();
+        config[QStringLiteral("internalHeight")] = internal.height();
+        config[QStringLiteral("filterMode")] = QStringLiteral("fsr");
+    }
+
+    config[QStringLiteral("gameCommand")] = instConfig.gameCommand;
+    config[QStringLiteral("steamAppId")] = instConfig.steamAppId;
+    config[QStringLiteral("borderless")] = m_borderlessWindows;
+    config[QStringLiteral("statsPath")] = m_telemetry->statsPipe(index);
+    if (m_audioManager && m_audioManager->hasPerPlayerAudio()) {
+        config[QStringLiteral("audioSink")] = AudioManager::playerSinkName(index);
+    }
+
+    // Look up preset and add resolved command/settings
+    if (m_presetManager) {
+        QString presetId = instConfig.presetId;
+        if (presetId.isEmpty()) {
+            presetId = QStringLiteral("steam");  // Default
+        }
+        config[QStringLiteral("presetId")] = presetId;
+        config[QStringLiteral("presetCommand")] = m_presetManager->getCommand(presetId);
+        config[QStringLiteral("presetWorkingDirectory")] = m_presetManager->getWorkingDirectory(presetId);
+        config[QStringLiteral("steamIntegration")] = m_presetManager->getSteamIntegration(presetId);
+    } else {
+        // Fallback if no PresetManager
+        config[QStringLiteral("presetId")] = QStringLiteral("steam");
+        config[QStringLiteral("presetCommand")] = QStringLiteral("steam -tenfoot -steamdeck");
+        config[QStringLiteral("steamIntegration")] = true;
+    }
+
+    // Get device paths for this instance
+    if (m_deviceManager) {
+        QStringList devicePaths = m_deviceManager->getDevicePathsForInstance(index);
+        QVariantList pathList;
+        for (const QString &path : devicePaths) {
+            pathList.append(path);
+        }
+        config[QStringLiteral("devicePaths")] = pathList;
+    }
+
+    // Applied to the instance's cgroup, not part of its command line
+    QVariantMap resources;
+    if (instConfig.cpuWeight > 0) {
+        resources[QStringLiteral("cpuWeight")] = instConfig.cpuWeight;
+    }
+    if (!instConfig.cpuCores.isEmpty()) {
+        resources[QStringLiteral("cpuCores")] = instConfig.cpuCores;
+    }
+    if (instConfig.ioWeight > 0) {
+        resources[QStringLiteral("ioWeight")] = instConfig.ioWeight;
+    }
+    if (instConfig.memoryHighMb > 0) {
+        resources[QStringLiteral("memoryHighMb")] = instConfig.memoryHighMb;
+    }
+    config[QStringLiteral("resources")] = resources;
+
+    return config;
+}
+
+int SessionRunner::gpuBudget() const
+{
+    if (m_sessionManager && m_sessionManager->currentProfile().gpuBudget > 0) {
+        return m_sessionManager->currentProfile().gpuBudget;
+    }
+    return RenderBudget::defaultBudget(RenderBudget::systemGpu());
+}
+
+QVariantList SessionRunner::availableGpus() const
+{
+    QVariantList result;
+    for (const GpuTopology::Gpu &gpu : GpuTopology::enumerate()) {
+        result.append(QVariantMap{
+            {QStringLiteral("pciAddress"), gpu.pciAddress},
+            {QStringLiteral("name"), gpu.name},
+            {QStringLiteral("renderNode"), gpu.renderNode},
+            {QStringLiteral("discrete"), gpu.gpuClass == RenderBudget::GpuClass::Discrete},
+        });
+    }
+    return result;
+}
+
+QStringList SessionRunner::gpuPlacement() const
+{
+    return gpuPlacement(GpuTopology::enumerate());
+}
+
+QStringList SessionRunner::gpuPlacement(const QList<GpuTopology::Gpu> &gpus) const
+{
+    if (!m_sessionManager) {
+        return QStringList();
+    }
+
+    const SessionProfile &profile = m_sessionManager->currentProfile();
+    const QList<MonitorLayout::Slot> layouts = layoutSlots();
+    QStringList requested;
+    QList<double> loads;
+    QList<std::optional<UserEntry>> users;
+    for (qsizetype i = 0; i < profile.instances.size(); ++i) {
+        const InstanceConfig &instance = profile.instances.at(i);
+        const MonitorLayout::Slot slot = layouts.value(i);
+        const QSize size = slot.nativeSize.isValid() ? slot.nativeSize
+                                                     : QSize(instance.outputWidth, instance.outputHeight);
+        int rate = slot.refreshRate > 0 ? slot.refreshRate : instance.refreshRate;
+        const int limit = frameLimitFor(int(i));
+        if (limit > 0 && (rate <= 0 || limit < rate)) {
+            rate = limit;
+        }
+        requested.append(instance.gpu);
+        loads.append(double(size.width()) * size.height() * qMax(rate, 1) / 1e6);
+        users.append(instance.username.isEmpty() ? UserDirectory::instance().user(getuid())
+                                                 : UserDirectory::instance().user(instance.username));
+    }
+
+    return GpuTopology::balance(gpus, requested, loads, [&users](int i, const GpuTopology::Gpu &gpu) {
+        return !users.at(i) || GpuTopology::canAccess(gpu.renderNode, *users.at(i));
+    });
+}
+
+double SessionRunner::renderScale() const
+{
+    if (!m_sessionManager || !m_sessionManager->currentProfile().performanceMode) {
+        return 1.0;
+    }
+
+    const SessionProfile &profile = m_sessionManager->currentProfile();
+    const QList<MonitorLayout::Slot> layouts = layoutSlots();
+    QList<QSize> outputs;
+    QList<int> refreshRates;
+    for (qsizetype i = 0; i < layouts.size(); ++i) {
+        outputs.append(layouts.at(i).nativeSize);
+        refreshRates.append(layouts.at(i).refreshRate > 0 ? layouts.at(i).refreshRate
+                                                          : profile.instances.value(i).refreshRate);
+    }
+    return RenderBudget::scaleFor(outputs, refreshRates, gpuBudget());
+}
+
+double SessionRunner::instanceRenderScale(int index) const
+{
+    if (!m_sessionManager || !m_sessionManager->currentProfile().dynamicResolution) {
+        return renderScale();
+    }
+    if (m_resolution->isTracking(index)) {
+        return m_resolution->scale(index);
+    }
+    // First launch: the performance target's scale, within the profile's bounds
+    const SessionProfile &profile = m_sessionManager->currentProfile();
+    return qBound(profile.minRenderScale / 100.0, renderScale(), profile.maxRenderScale / 100.0);
+}
+
+int SessionRunner::targetFrameRate(int index) const
+{
+    const int limit = frameLimitFor(index);
+    if (limit > 0) {
+        return limit;
+    }
+    if (index >= 0 && index < m_startLayouts.size() && m_startLayouts.at(index).refreshRate > 0) {
+        return m_startLayouts.at(index).refreshRate;
+    }
+    return m_sessionManager ? m_sessionManager->currentProfile().instances.value(index).refreshRate : 0;
+}
+
+void SessionRunner::updateDynamicResolution()
+{
+    if (!isRunning() || m_starting || m_stopping) {
+        return;
+    }
+    for (const auto *instance : std::as_const(m_instances)) {
+        const int index = instance->index();
+        if (!instance->isRunning() || instance->isStopping() || !m_resolution->isTracking(index)) {
+            continue;
+        }
+        const QVariantMap sample = m_telemetry->latest(index);
+        m_resolution->addSample(index, sample.value(QStringLiteral("fps"), -1.0).toDouble(),
+                                sample.value(QStringLiteral("gpuPercent"), -1.0).toDouble());
+    }
+}
+
+void SessionRunner::onRenderScaleChanged(int index, double scale)
+{
+    GamescopeInstance *instance = instanceAt(index);
+    if (!instance || !instance->isRunning() || instance->isStopping() || m_stopping
+        || index >= m_startLayouts.size()) {
+        return;
+    }
+    restartInstance(instance, buildInstanceConfig(index, m_startLayouts[index]));
+    Q_EMIT renderScaleChanged(index, scale);
+}
+
+QVariantList SessionRunner::renderPlan() const
+{
+    QVariantList plan;
+    if (!m_sessionManager) {
+        return plan;
+    }
+
+    const QList<MonitorLayout::Slot> layouts = layoutSlots();
+    const double scale = renderScale();
+    for (qsizetype i = 0; i < layouts.size(); ++i) {
+        const QSize internal = RenderBudget::internalSize(layouts.at(i).nativeSize, scale);
+        QVariantMap entry;
+        entry[QStringLiteral("index")] = int(i);
+        entry[QStringLiteral("outputWidth")] = layouts.at(i).geometry.width();
+        entry[QStringLiteral("outputHeight")] = layouts.at(i).geometry.height();
+        entry[QStringLiteral("output")] = layouts.at(i).output;
+        entry[QStringLiteral("internalWidth")] = internal.width();
+        entry[QStringLiteral("internalHeight")] = internal.height();
+        entry[QStringLiteral("scale")] = scale;
+        entry[QStringLiteral("fsr")] = scale < 1.0;
+        plan.append(entry);
+    }
+    return plan;
+}
+
+bool SessionRunner::takeStandbyInstance(int index, const QVariantMap &config)
+{
+    if (!m_pool->isLaunched(index) || !m_pool->matches(index, InstancePool::launchKey(config))) {
+        return false;
+    }
+
+    const QString windowId = m_pool->windowId(index);
+    GamescopeInstance *instance = m_pool->take(index);
+    if (!instance || !instance->isRunning()) {
+        delete instance;
+        return false;
+    }
+
+    qCDebug(couchplayCore) << "Instance" << index << "taken from the standby pool, window" << windowId;
+
+    instance->setParent(this);
+    connect(instance, &GamescopeInstance::started, this, &SessionRunner::onInstanceStarted);
+    connect(instance, &GamescopeInstance::stopped, this, &SessionRunner::onInstanceStopped);
+    connect(instance, &GamescopeInstance::errorOccurred, this, &SessionRunner::onInstanceError);
+    m_instances.append(instance);
+
+    // Resource controls aren't part of the launch key, apply the current ones
+    instance->applyResources(config.value(QStringLiteral("resources")).toMap());
+
+    // A normal placement also reveals the minimized standby window
+    if (m_windowManager) {
+        m_windowManager->cancelPositionRequest(STANDBY_REQUEST_OFFSET + index);
+        if (!windowId.isEmpty() && m_windowManager->positionWindow(windowId, instance->windowGeometry())) {
+            m_positionedWindowIds.append(windowId);
+            m_instanceWindowIds.insert(index, windowId);
+        } else {
+            positionInstanceWindow(instance);
+        }
+    }
+
+    Q_EMIT instanceStarted(index);
+    Q_EMIT instancesChanged();
+    Q_EMIT runningInstanceCountChanged();
     return true;
 }
 
+void SessionRunner::scheduleWarmStandby()
+{
+    if (m_pool->isEnabled() && !isRunning() && !m_starting) {
+        m_warmTimer->start();
+    }
+}
+
+void SessionRunner::scheduleRelayout()
+{
+    if (isRunning() && !m_starting && !m_stopping) {
+        m_relayoutTimer->start();
+    }
+}
+
+bool SessionRunner::relayoutNeedsRestart(const QSize &current, const QSize &target)
+{
+    if (current == target || current.isEmpty() || target.isEmpty()) {
+        return false;
+    }
+    const qint64 a = qint64(current.width()) * target.height();
+    const qint64 b = qint64(target.width()) * current.height();
+    return qAbs(a - b) * 100 > b;
+}
+
+void SessionRunner::relayout()
+{
+    if (!isRunning() || m_starting || m_stopping || !m_sessionManager) {
+        return;
+    }
+
+    const QList<MonitorLayout::Slot> layouts = layoutSlots();
+    if (layouts.size() != m_sessionManager->currentProfile().instances.size()) {
+        return;
+    }
+
+    int moved = 0;
+    int restarted = 0;
+    for (GamescopeInstance *instance : std::as_const(m_instances)) {
+        const int index = instance->index();
+        if (index < 0 || index >= layouts.size() || !instance->isRunning() || instance->isStopping()) {
+            continue;
+        }
+
+        const QVariantMap config = buildInstanceConfig(index, layouts[index]);
+        const QRect geometry(config.value(QStringLiteral("positionX")).toInt(),
+                             config.value(QStringLiteral("positionY")).toInt(),
+                             config.value(QStringLiteral("outputWidth")).toInt(),
+                             config.value(QStringLiteral("outputHeight")).toInt());
+        const QSize internal(config.value(QStringLiteral("internalWidth")).toInt(),
+                             config.value(QStringLiteral("internalHeight")).toInt());
+
+        if (relayoutNeedsRestart(instance->internalSize(), internal)) {
+            restartInstance(instance, config);
+            ++restarted;
+            continue;
+        }
+        if (geometry == instance->windowGeometry()) {
+            continue;
+        }
+
+        // Placements made in this pass go out to KWin together
+        instance->setWindowGeometry(geometry);
+        const QString windowId = m_instanceWindowIds.value(index);
+        if (!windowId.isEmpty()) {
+            m_windowManager->positionWindow(windowId, geometry);
+        }
+        ++moved;
+    }
+    m_startLayouts = layouts;
+
+    if (moved > 0 || restarted > 0) {
+        qCDebug(couchplayCore) << "Re-layout after a monitor change:" << moved << "moved," << restarted << "relaunched";
+    }
+}
+
+void SessionRunner::restartInstance(GamescopeInstance *instance, const QVariantMap &config)
+{
+    const int index = instance->index();
+    qCDebug(couchplayCore) << "Relaunching instance" << index << "at"
+                           << config.value(QStringLiteral("internalWidth")).toInt() << "x"
+                           << config.value(QStringLiteral("internalHeight")).toInt();
+
+    // Its window goes away, the relaunched one is placed like a new one
+    m_positionedWindowIds.removeAll(m_instanceWindowIds.take(index));
+    m_windowManager->cancelPositionRequest(index);
+    m_restartConfigs.insert(index, config);
+    instance->stopAsync();
+}
+
+void SessionRunner::warmStandby()
+{
+    if (!m_pool->isEnabled() || isRunning() || m_starting || !m_sessionManager
+        || !m_helperClient || !m_helperClient->isAvailable()) {
+        return;
+    }
+
+    // Standby mounts and launches are session calls like any other; the
+    // grant also covers unmounting them when they are evicted
+    const quint64 generation = ++m_warmGeneration;
+    QDBusPendingReply<QVariantMap> call = m_helperClient->authorizeSessionAsync();
+    CouchPlayHelperClient::awaitAll({call}, this, [this, generation, call]() {
+        QDBusPendingReply<QVariantMap> reply = call;
+        if (generation != m_warmGeneration) {
+            return;
+        }
+        if (reply.isError() || !reply.value().value(QStringLiteral("authorized")).toBool()) {
+            qCWarning(couchplayCore) << "Not warming standby instances, the session wasn't authorized:"
+                                     << (reply.isError() ? reply.error().message() : QStringLiteral("denied"));
+            return;
+        }
+        warmStandbyInstances(generation);
+    });
+}
+
+void SessionRunner::warmStandbyInstances(quint64 generation)
+{
+    if (!m_pool->isEnabled() || isRunning() || m_starting || !m_sessionManager
+        || !m_helperClient || !m_helperClient->isAvailable()) {
+        return;
+    }
+
+    const SessionProfile &profile = m_sessionManager->currentProfile();
+    const int instanceCount = profile.instances.size();
+    const QList<MonitorLayout::Slot> layouts = layoutSlots();
+
+    for (int index : m_pool->indexes()) {
+        if (index >= instanceCount) {
+            m_pool->evict(index, QStringLiteral("profile changed"));
+        }
+    }
+
+    for (int i = 0; i < instanceCount; ++i) {
+        const QString username = profile.instances[i].username;
+        if (username.isEmpty()) {
+            m_pool->evict(i, QStringLiteral("no user"));
+            continue;
+        }
+
+        const QVariantMap config = buildInstanceConfig(i, layouts[i]);
+        const QString key = InstancePool::launchKey(config);
+        if (m_pool->matches(i, key) && (m_pool->isLaunched(i) || !m_pool->prelaunch())) {
+            continue;
+        }
+        // Evict first so its unmount is queued ahead of the new mounts
+        m_pool->evict(i, QStringLiteral("profile changed"));
+
+        // Everything the prepare stage would do except device ownership, which
+        // must not change hands before the session starts
+        PrepareInstanceSpec spec;
+        spec.session = true;
+        spec.sharedDirectories = sharedDirectorySpecs(i);
+        bool syncShortcuts = false;
+        spec.aclPaths = launcherAclDirectories(i, syncShortcuts);
+
+        if (m_pool->prelaunch()) {
+            spec.launch = true;
+            spec.gamescopeArgs = GamescopeInstance::buildGamescopeArgs(config);
+            spec.gameCommand = GamescopeInstance::buildGameCommand(config);
+            spec.environment = GamescopeInstance::buildEnvironment(config);
+            spec.resources = config.value(QStringLiteral("resources")).toMap();
+        }
+
+        qCDebug(couchplayCore) << "Warming standby instance" << i << "for" << username
+                               << (spec.launch ? "(prelaunch)" : "");
+
+        QDBusPendingReply<QVariantMap> call =
+            m_helperClient->prepareInstanceAsync(username, static_cast<uint>(getuid()), spec);
+        CouchPlayHelperClient::awaitAll({call}, this, [this, i, generation, username, key, config, call]() {
+            QDBusPendingReply<QVariantMap> reply = call;
+            if (reply.isError() || !reply.value().value(QStringLiteral("success")).toBool()) {
+                qCWarning(couchplayCore) << "Failed to warm standby instance" << i << "for" << username << ":"
+                                         << (reply.isError() ? reply.error().message()
+                                                             : reply.value().value(QStringLiteral("error")).toString());
+                return;
+            }
+
+            const qint64 pid = reply.value().value(QStringLiteral("pid")).toLongLong();
+            if (generation != m_warmGeneration || !m_pool->isEnabled()) {
+                // Superseded by a newer warm-up or a session start
+                if (pid > 0) {
+                    m_helperClient->stopInstanceAsync(pid);
+                }
+                return;
+            }
+
+            GamescopeInstance *instance = nullptr;
+            if (pid > 0) {
+                instance = new GamescopeInstance;
+                instance->attach(config, i, pid);
+            }
+            m_pool->add(i, username, key, instance);
+
+            if (instance && m_windowManager && m_windowManager->isAvailable()) {
+                m_windowManager->queuePositionRequest(STANDBY_REQUEST_OFFSET + i, instance->windowGeometry(),
+                                                      m_positionedWindowIds + m_pool->windowIds(),
+                                                      60000, true);
+            }
+        });
+    }
+}
+
+void SessionRunner::onStandbyEvicted(int index, const QString &username, const QString &reason)
+{
+    Q_UNUSED(reason)
+
+    if (m_windowManager) {
+        m_windowManager->cancelPositionRequest(STANDBY_REQUEST_OFFSET + index);
+    }
+
+    // While a session runs its mounts belong to the session and are torn down by stop()
+    if (isRunning() || m_starting || !m_helperClient || !m_helperClient->isAvailable()) {
+        return;
+    }
+    // Under the grant warmStandby() took, which the mounts keep alive
+    QDBusPendingReply<int> call = m_helperClient->unmountSharedDirectoriesAsync(username);
+    CouchPlayHelperClient::awaitAll({call}, this, [username, call]() {
+        QDBusPendingReply<int> reply = call;
+        if (reply.isError()) {
+            qCWarning(couchplayCore) << "Failed to unmount standby directories of" << username << ":"
+                                     << reply.error().message();
+        }
+    });
+}
+
 void SessionRunner::stop()
 {
-    if (!isRunning()) {
+    const bool wasStarting = m_starting;
+    if (wasStarting) {
+        // Abort the start pipeline; queued stages check the generation and bail out
+        ++m_startGeneration;
+        m_starting = false;
+        Q_EMIT startingChanged();
+    }
+
+    // Whatever was recorded up to now, e.g. windows that never appeared
+    finishTrace();
+
+    if (m_stopping || (!isRunning() && !wasStarting && m_relaunching.isEmpty())) {
         return;
     }
 
     setStatus(QStringLiteral("Stopping session..."));
-
-    // Stop all instances
-    for (auto *instance : m_instances) {
+    m_stopping = true;
+    m_stopTimer.start();
+    Q_EMIT stoppingChanged();
+
+    // Signal every instance at once; the session takes as long to stop as
+    // its slowest instance rather than the sum of them. Each exit comes
+    // back through onInstanceStopped(), which calls finishStop() after the last.
+    for (auto *instance : std::as_const(m_instances)) {
         if (instance->isRunning()) {
-            instance->stop();
+            instance->stopAsync();
+        }
+    }
+
+    stopInputDiagnostics();
+
+    if (!isRunning()) {
+        finishStop();
+    }
+}
+
+void SessionRunner::finishStop()
+{
+    qCDebug(couchplayCore) << "SessionRunner: Instances exited after" << m_stopTimer.elapsed() << "ms";
+
+    // Everything the helper still holds for the session, in one call each
+    const QList<QDBusPendingCall> calls = {restoreDeviceOwnership(), teardownSharedDirectories()};
+    CouchPlayHelperClient::awaitAll(calls, this, [this, calls]() {
+        const auto denied = [](const QDBusPendingCall &call) {
+            return call.isError() && call.error().type() == QDBusError::AccessDenied;
+        };
+        if (!m_helperClient || (!denied(calls.at(0)) && !denied(calls.at(1)))) {
+            completeStop(calls);
+            return;
         }
+
+        // The session's grant lapsed while it ran; what it set up still has to go
+        qCDebug(couchplayCore) << "SessionRunner: Teardown denied, authorizing the session again";
+        QDBusPendingReply<QVariantMap> authorize = m_helperClient->authorizeSessionAsync();
+        CouchPlayHelperClient::awaitAll({authorize}, this, [this, calls, denied, authorize]() {
+            QList<QDBusPendingCall> retried = calls;
+            if (!authorize.isError() && authorize.value().value(QStringLiteral("authorized")).toBool()
+                && m_helperClient) {
+                if (denied(calls.at(0))) {
+                    retried[0] = m_helperClient->restoreAllDevicesAsync();
+                }
+                if (denied(calls.at(1))) {
+                    retried[1] = m_helperClient->unmountAllSharedDirectoriesAsync();
+                }
+            }
+            CouchPlayHelperClient::awaitAll(retried, this, [this, retried]() {
+                completeStop(retried);
+            });
+        });
+    });
+}
+
+void SessionRunner::completeStop(const QList<QDBusPendingCall> &calls)
+{
+    QDBusPendingReply<int> reset = calls.at(0);
+    if (reset.isError() && reset.error().type() != QDBusError::ServiceUnknown) {
+        qWarning() << "SessionRunner: Failed to restore devices:" << reset.error().message();
+    }
+    QDBusPendingReply<int> unmount = calls.at(1);
+    if (unmount.isError() && unmount.error().type() != QDBusError::ServiceUnknown) {
+        qWarning() << "SessionRunner: Failed to unmount shared directories:" << unmount.error().message();
     }
 
-    // Restore device ownership
-    restoreDeviceOwnership();
+    cleanupInstances();
+    releaseSessionPlayers();
+    if (m_helperClient) {
+        m_helperClient->endSessionAsync();
+    }
 
-    // Teardown shared directory mounts
-    teardownSharedDirectories();
+    qCDebug(couchplayCore) << "SessionRunner: Session torn down after" << m_stopTimer.elapsed() << "ms";
+    m_stopping = false;
+    setStatus(QStringLiteral("Stopped"));
+    Q_EMIT stoppingChanged();
+    Q_EMIT runningChanged();
+    Q_EMIT instancesChanged();
+    Q_EMIT sessionStopped();
+
+    scheduleWarmStandby();
+}
+
+void SessionRunner::releaseSessionPlayers()
+{
+    // Standby instances keep playing into their sinks
+    if (m_audioManager && !m_pool->isEnabled()) {
+        m_audioManager->removePlayerSinks();
+    }
+
+    // Ephemeral players are done once their session is; standby would
+    // relaunch them, so they stay while the pool is on
+    if (m_helperClient && m_sessionManager && !m_pool->isEnabled()) {
+        const QSet<QString> guests = UserManager::guestUsers();
+        QStringList usernames;
+        for (const InstanceConfig &instance : m_sessionManager->currentProfile().instances) {
+            if (guests.contains(instance.username) && !usernames.contains(instance.username)) {
+                usernames.append(instance.username);
+            }
+        }
+        deleteGuests(usernames);
+    }
+}
+
+void SessionRunner::deleteGuests(QStringList usernames)
+{
+    if (usernames.isEmpty() || !m_helperClient) {
+        return;
+    }
 
-    cleanupInstances();
+    // No session grant covers delete-user: each deletion takes a one-shot
+    // grant first, so one at a time
+    const QString username = usernames.takeFirst();
+    const auto failed = [this, username](const QString &error) {
+        qWarning() << "SessionRunner: Failed to remove guest player" << username << ":" << error;
+        Q_EMIT errorOccurred(QStringLiteral("Guest player %1 could not be removed: %2").arg(username, error));
+    };
+
+    QDBusPendingReply<bool> authorize = m_helperClient->authorizeUserDeletionAsync();
+    CouchPlayHelperClient::awaitAll({authorize}, this, [this, username, usernames, failed, authorize]() {
+        if (authorize.isError() || !authorize.value() || !m_helperClient) {
+            failed(authorize.isError() ? authorize.error().message() : QStringLiteral("Not authorized"));
+            deleteGuests(usernames);
+            return;
+        }
 
-    setStatus(QStringLiteral("Stopped"));
-    Q_EMIT runningChanged();
-    Q_EMIT instancesChanged();
-    Q_EMIT sessionStopped();
+        QDBusPendingReply<bool> call = m_helperClient->deleteUserAsync(username, true);
+        CouchPlayHelperClient::awaitAll({call}, this, [this, usernames, failed, call]() {
+            if (call.isError() || !call.value()) {
+                failed(call.isError() ? call.error().message() : QStringLiteral("Deletion did not start"));
+            }
+            deleteGuests(usernames);
+        });
+    });
 }
 
 void SessionRunner::stopInstance(int index)
 {
-    if (index >= 0 && index < m_instances.size()) {
-        m_instances[index]->stop();
+    if (GamescopeInstance *instance = instanceAt(index)) {
+        instance->stop();
     }
 }
 
+GamescopeInstance *SessionRunner::instanceAt(int index) const
+{
+    // Instances are appended in launch order, which may differ from index order
+    for (auto *instance : m_instances) {
+        if (instance->index() == index) {
+            return instance;
+        }
+    }
+    return nullptr;
+}
+
 bool SessionRunner::isRunning() const
 {
     for (const auto *instance : m_instances) {
@@ -372,6 +1571,14 @@ QVariantList SessionRunner::instancesAsVariant() const
         map[QStringLiteral("y")] = geom.y();
         map[QStringLiteral("width")] = geom.width();
         map[QStringLiteral("height")] = geom.height();
+
+        // Cached by the telemetry, cheap to read on every binding evaluation
+        const QVariantMap telemetry = m_telemetry->latest(instance->index());
+        for (auto it = telemetry.constBegin(); it != telemetry.constEnd(); ++it) {
+            if (it.key() != QLatin1String("index")) {
+                map.insert(it.key(), it.value());
+            }
+        }
         
         list.append(map);
     }
@@ -390,222 +1597,425 @@ void SessionRunner::cleanupInstances()
     }
     m_instances.clear();
     m_positionedWindowIds.clear(); // Clear tracked window IDs for next session
+    m_instanceWindowIds.clear();
+    m_restartConfigs.clear();
+    m_relaunching.clear();
+
+    m_telemetry->clear();
+    m_resolution->clear();
 }
 
-bool SessionRunner::setupDeviceOwnership()
+void SessionRunner::runPrepareStage(int index)
 {
-    if (!m_deviceManager || !m_helperClient) {
-        return true; // No helper, skip ownership setup
+    const quint64 generation = m_startGeneration;
+
+    if (!m_helperClient || !m_sessionManager) {
+        finishStartStage(index, generation, true); // No helper, nothing to prepare
+        return;
     }
 
     if (!m_helperClient->isAvailable()) {
-        qWarning() << "SessionRunner: Helper not available, skipping device ownership setup";
-        return true;
+        qWarning() << "SessionRunner: Helper not available, skipping instance preparation";
+        finishStartStage(index, generation, true);
+        return;
     }
 
-    // Clear previous ownership tracking
-    m_ownedDevicePaths.clear();
+    const auto &profile = m_sessionManager->currentProfile();
+    if (index < 0 || index >= profile.instances.size()) {
+        finishStartStage(index, generation, true);
+        return;
+    }
 
-    // For each instance, get its assigned devices and set ownership
-    if (!m_sessionManager) {
-        return true;
+    const QString username = profile.instances[index].username;
+    if (username.isEmpty()) {
+        finishStartStage(index, generation, true);
+        return;
     }
 
-    const auto &profile = m_sessionManager->currentProfile();
-    
-    for (int i = 0; i < profile.instances.size(); ++i) {
-        const QString &username = profile.instances[i].username;
-        
-        if (username.isEmpty()) {
-            continue;
+    // Collect everything this player needs so the helper can apply it in one
+    // round trip (one authorization, one user lookup)
+    PrepareInstanceSpec spec;
+    spec.routeDevices = m_inputRouting;
+    QString shortcutsTarget;
+
+    if (m_resuming) {
+        // As resolved by the start the plan was recorded from, which also
+        // synced the shortcuts
+        const LaunchPlan::Instance planned = m_plan.instances.value(index);
+        for (const LaunchPlan::Device &device : planned.devices) {
+            spec.devices << device.path;
         }
-        
-        // Get UID for this user
-        struct passwd *pw = getpwnam(username.toLocal8Bit().constData());
-        if (!pw) {
-            qWarning() << "SessionRunner: User" << username << "not found, skipping device ownership for instance" << i;
-            continue;
+        spec.sharedDirectories = planned.sharedDirectories;
+        spec.aclPaths = planned.aclPaths;
+        spec.sharedCaches = planned.sharedCaches;
+    } else {
+        if (m_deviceManager) {
+            spec.devices = m_deviceManager->getDevicePathsForInstance(index);
         }
-        int uid = static_cast<int>(pw->pw_uid);
-        
-        // Get device paths assigned to this instance
-        QStringList devicePaths = m_deviceManager->getDevicePathsForInstance(i);
-        
-        for (const QString &path : devicePaths) {
-            if (m_helperClient->setDeviceOwner(path, uid)) {
-                if (!m_ownedDevicePaths.contains(path)) {
-                    m_ownedDevicePaths.append(path);
-                }
-            } else {
-                qWarning() << "SessionRunner: Failed to set ownership of" << path;
-                Q_EMIT errorOccurred(QStringLiteral("Failed to set device ownership for %1").arg(path));
+
+        spec.sharedDirectories = sharedDirectorySpecs(index);
+
+        bool syncShortcuts = false;
+        spec.aclPaths = launcherAclDirectories(index, syncShortcuts);
+
+        if (syncShortcuts) {
+            QVariant shortcutsContent;
+            QString error;
+            if (m_steamConfigManager->prepareShortcutsSync(username, shortcutsContent, shortcutsTarget, error)
+                && !shortcutsTarget.isEmpty()) {
+                spec.files.insert(shortcutsTarget, shortcutsContent);
+            } else if (!error.isEmpty()) {
+                qCWarning(couchplaySteam) << "Failed to sync shortcuts to user" << username << "-" << error;
             }
         }
+
+        spec.sharedCaches = sharedCacheDirectories(index);
+
+        if (index < m_plan.instances.size()) {
+            LaunchPlan::Instance &planned = m_plan.instances[index];
+            planned.sharedDirectories = spec.sharedDirectories;
+            planned.aclPaths = spec.aclPaths;
+            planned.sharedCaches = spec.sharedCaches;
+        }
     }
 
-    return true;
-}
+    // The same call launches the player once everything is in place, unless
+    // a standby instance takes its place in the launch stage
+    const QVariantMap config = startConfig(index);
+    if (!m_pool->isLaunched(index) || !m_pool->matches(index, InstancePool::launchKey(config))) {
+        spec.launch = true;
+        GamescopeInstance::launchCommandLine(config, spec.gamescopeArgs, spec.environment, spec.gameCommand);
+        spec.resources = config.value(QStringLiteral("resources")).toMap();
+    }
 
-void SessionRunner::restoreDeviceOwnership()
-{
-    if (!m_helperClient || m_ownedDevicePaths.isEmpty()) {
+    if (!spec.launch && spec.devices.isEmpty() && spec.sharedDirectories.isEmpty()
+        && spec.aclPaths.isEmpty() && spec.files.isEmpty() && spec.sharedCaches.isEmpty()) {
+        finishStartStage(index, generation, true);
         return;
     }
 
-    if (!m_helperClient->isAvailable()) {
-        qWarning() << "SessionRunner: Helper not available, cannot restore device ownership";
-        m_ownedDevicePaths.clear();
-        return;
+    qDebug() << "SessionRunner: Preparing instance" << index << "for" << username << "-"
+             << spec.devices.size() << "devices," << spec.sharedDirectories.size() << "shared directories,"
+             << spec.aclPaths.size() << "ACL paths," << spec.files.size() << "files,"
+             << spec.sharedCaches.size() << "shared caches" << (spec.launch ? "and launch" : "");
+
+    // Recorded as soon as the call is on its way: if the start is aborted
+    // before the reply, the helper may still have taken the devices, and
+    // stop() must reset them regardless
+    for (const QString &path : std::as_const(spec.devices)) {
+        if (!m_ownedDevicePaths.contains(path)) {
+            m_ownedDevicePaths.append(path);
+        }
     }
 
-    // Use restoreAllDevices() which resets all modified devices tracked by the helper
-    m_helperClient->restoreAllDevices();
-    
-    m_ownedDevicePaths.clear();
+    QDBusPendingReply<QVariantMap> call =
+        m_helperClient->prepareInstanceAsync(username, static_cast<uint>(getuid()), spec);
+    CouchPlayHelperClient::awaitAll({call}, this, [this, index, generation, username, spec, shortcutsTarget, call]() {
+        QDBusPendingReply<QVariantMap> reply = call;
+        const qint64 pid = reply.isError() ? 0 : reply.value().value(QStringLiteral("pid")).toLongLong();
+        if (!isCurrentStart(generation)) {
+            // Aborted: nothing would take over what the call launched
+            if (pid > 0) {
+                m_helperClient->stopInstanceAsync(pid);
+            }
+            return;
+        }
+
+        if (reply.isError()) {
+            qWarning() << "SessionRunner: Failed to prepare instance" << index << ":" << reply.error().message();
+            Q_EMIT errorOccurred(QStringLiteral("Failed to prepare instance %1: %2")
+                                     .arg(index).arg(reply.error().message()));
+            finishStartStage(index, generation, false);
+            return;
+        }
+
+        const QVariantMap result = reply.value();
+        auto stepSucceeded = [&result](const QString &step) {
+            return result.value(step + QStringLiteral(".success"), true).toBool();
+        };
+
+        for (const QString &step : result.value(QStringLiteral("steps")).toStringList()) {
+            qCDebug(couchplayCore) << "Instance" << index << "helper step" << step
+                                   << "succeeded:" << stepSucceeded(step)
+                                   << "in" << result.value(step + QStringLiteral(".elapsedMs")).toLongLong() << "ms";
+        }
+
+        if (!spec.devices.isEmpty() && !stepSucceeded(QStringLiteral("devices"))) {
+            const QString error = result.value(QStringLiteral("devices.error")).toString();
+            qWarning() << "SessionRunner: Failed to set device ownership:" << error;
+            Q_EMIT errorOccurred(QStringLiteral("Failed to set device ownership for instance %1: %2")
+                                     .arg(index).arg(error));
+        }
+
+        if (!spec.sharedDirectories.isEmpty() && !stepSucceeded(QStringLiteral("mounts"))) {
+            qWarning() << "SessionRunner: Failed to mount shared directories for user" << username;
+        }
+
+        if (!spec.aclPaths.isEmpty() && !stepSucceeded(QStringLiteral("acls"))) {
+            qCWarning(couchplaySteam) << "Failed to set ACLs for" << username << "-"
+                                      << result.value(QStringLiteral("acls.error")).toString();
+        }
+
+        if (!spec.sharedCaches.isEmpty()) {
+            // Without reflinks the player simply builds their own cache
+            if (stepSucceeded(QStringLiteral("caches"))) {
+                qCDebug(couchplaySteam) << "Shared" << result.value(QStringLiteral("caches.bytes")).toLongLong()
+                                        << "bytes of caches with" << username;
+            } else {
+                qCDebug(couchplaySteam) << "Could not share caches with" << username << "-"
+                                        << result.value(QStringLiteral("caches.error")).toString();
+            }
+        }
+
+        if (!shortcutsTarget.isEmpty()) {
+            m_steamConfigManager->finishShortcutsSync(username, shortcutsTarget, stepSucceeded(QStringLiteral("files")));
+        }
+
+        // A failed launch is the launch stage's failure; the setup was
+        // rolled back, so the launch stage doesn't try again without it
+        InstanceStartState &state = m_startStates[index];
+        state.launchedPid = pid;
+        state.launchFailed = spec.launch && pid <= 0
+            && result.value(QStringLiteral("steps")).toStringList().contains(QStringLiteral("launch"));
+        if (state.launchFailed) {
+            const QString error = result.value(QStringLiteral("launch.error")).toString();
+            qWarning() << "SessionRunner: Failed to launch instance" << index << ":" << error;
+            Q_EMIT errorOccurred(QStringLiteral("Instance %1: Failed to launch instance: %2").arg(index).arg(error));
+        }
+
+        finishStartStage(index, generation, result.value(QStringLiteral("success")).toBool() || state.launchFailed);
+    });
 }
 
-bool SessionRunner::setupSharedDirectories()
+void SessionRunner::startInputDiagnostics()
 {
-    if (!m_helperClient || !m_sessionManager) {
-        return true;
+    if (!m_sessionManager || !m_deviceManager) {
+        return;
     }
 
-    if (!m_helperClient->isAvailable()) {
-        qWarning() << "SessionRunner: Helper not available, skipping shared directory setup";
-        return true;
+    if (!m_latencyMonitor) {
+        m_latencyMonitor = new InputLatencyMonitor(this);
+    }
+    if (!m_latencyTimer) {
+        m_latencyTimer = new QTimer(this);
+        m_latencyTimer->setInterval(1000);
+        connect(m_latencyTimer, &QTimer::timeout, this, &SessionRunner::updateInputLatency);
     }
 
-    uint compositorUid = static_cast<uint>(getuid());
-
-    const auto &profile = m_sessionManager->currentProfile();
-    bool allSucceeded = true;
-
+    const qreal screenRefresh = QGuiApplication::primaryScreen()
+        ? QGuiApplication::primaryScreen()->refreshRate() : 60.0;
+    const SessionProfile &profile = m_sessionManager->currentProfile();
     for (int i = 0; i < profile.instances.size(); ++i) {
-        const QString &username = profile.instances[i].username;
-        const QStringList &sharedDirs = profile.instances[i].sharedDirectories;
-        
-        if (username.isEmpty()) {
-            continue;
-        }
+        // Gamescope runs at -r when set, otherwise at the output's rate
+        const qreal refresh = profile.instances[i].refreshRate > 0 ? profile.instances[i].refreshRate : screenRefresh;
+        m_latencyMonitor->setFrameInterval(i, refresh > 0 ? qRound64(1e6 / refresh) : 0);
 
-        if (sharedDirs.isEmpty()) {
-            qDebug() << "SessionRunner: No shared directories for instance" << i << "user" << username;
-            continue;
+        for (const QString &path : m_deviceManager->getDevicePathsForInstance(i)) {
+            if (!m_latencyMonitor->watch(path, i)) {
+                qCDebug(couchplayCore) << "Input diagnostics can't read" << path << "for instance" << i;
+            }
         }
+    }
 
-        qDebug() << "SessionRunner: Mounting" << sharedDirs.size() << "shared directories for user" << username;
-        
-        QStringList formattedDirs;
-        for (const QString &dir : sharedDirs) {
-            formattedDirs << dir + QLatin1Char('|');
-        }
-        
-        int mountResult = m_helperClient->mountSharedDirectories(username, compositorUid, formattedDirs);
-        if (mountResult < 0) {
-            qWarning() << "SessionRunner: Failed to mount shared directories for user" << username;
-            allSucceeded = false;
-        } else {
-            qDebug() << "SessionRunner: Mounted" << mountResult << "directories for user" << username;
+    m_latencyTimer->start();
+    updateInputLatency();
+}
+
+void SessionRunner::stopInputDiagnostics()
+{
+    if (m_latencyTimer) {
+        m_latencyTimer->stop();
+    }
+    if (m_latencyMonitor) {
+        // Keep the final figures around for the session page
+        updateInputLatency();
+        for (const QVariant &player : std::as_const(m_inputLatency)) {
+            qCDebug(couchplayCore) << "Input latency" << player.toMap();
         }
+        delete m_latencyMonitor;
+        m_latencyMonitor = nullptr;
+    }
+}
+
+void SessionRunner::updateInputLatency()
+{
+    if (!m_latencyMonitor) {
+        return;
+    }
+    m_inputLatency = m_latencyMonitor->stats();
+    Q_EMIT inputLatencyChanged();
+}
+
+QDBusPendingCall SessionRunner::restoreDeviceOwnership()
+{
+    if (!m_helperClient || m_ownedDevicePaths.isEmpty()) {
+        return CouchPlayHelperClient::completedCall(0);
+    }
+
+    if (!m_helperClient->isAvailable()) {
+        qWarning() << "SessionRunner: Helper not available, cannot restore device ownership";
+        m_ownedDevicePaths.clear();
+        return CouchPlayHelperClient::completedCall(0);
+    }
+
+    if (m_inputRouting) {
+        // Report forwarding latency before the router discards its statistics
+        QDBusPendingReply<QVariantMap> statsCall = m_helperClient->inputRouterStatsAsync();
+        QDBusPendingReply<int> stopCall = m_helperClient->stopInputRoutingAsync();
+        CouchPlayHelperClient::awaitAll({statsCall, stopCall}, this, [statsCall, stopCall]() {
+            QDBusPendingReply<QVariantMap> stats = statsCall;
+            if (!stats.isError()) {
+                const QVariantMap values = stats.value();
+                qCDebug(couchplayCore) << "Input router forwarded" << values.value(QStringLiteral("events")).toULongLong()
+                                       << "events, latency mean" << values.value(QStringLiteral("latencyMeanUs")).toULongLong()
+                                       << "us, p99" << values.value(QStringLiteral("latencyP99Us")).toULongLong()
+                                       << "us, max" << values.value(QStringLiteral("latencyMaxUs")).toULongLong() << "us";
+            }
+            QDBusPendingReply<int> stopped = stopCall;
+            if (stopped.isError()) {
+                qWarning() << "SessionRunner: Failed to stop input routing:" << stopped.error().message();
+            }
+        });
     }
 
-    return allSucceeded;
+    // ResetAllDevices resets every device the helper has modified; it is
+    // queued behind the routing calls above on the same connection
+    m_ownedDevicePaths.clear();
+    return m_helperClient->restoreAllDevicesAsync();
 }
 
-void SessionRunner::teardownSharedDirectories()
+QDBusPendingCall SessionRunner::teardownSharedDirectories()
 {
     if (!m_helperClient) {
-        return;
+        return CouchPlayHelperClient::completedCall(0);
     }
 
     if (!m_helperClient->isAvailable()) {
         qWarning() << "SessionRunner: Helper not available, cannot unmount shared directories";
-        return;
+        return CouchPlayHelperClient::completedCall(0);
     }
 
     // Unmount all shared directories for all users
-    m_helperClient->unmountAllSharedDirectories();
+    return m_helperClient->unmountAllSharedDirectoriesAsync();
 }
 
-bool SessionRunner::setupLauncherAccess()
+QStringList SessionRunner::launcherAclDirectories(int index, bool &syncShortcuts)
 {
+    QStringList directories;
+    syncShortcuts = false;
+
     if (!m_sessionManager || !m_presetManager || !m_helperClient) {
-        return true;
+        return directories;
     }
 
     const auto &profile = m_sessionManager->currentProfile();
-    bool allSucceeded = true;
+    if (index < 0 || index >= profile.instances.size()) {
+        return directories;
+    }
 
-    for (int i = 0; i < profile.instances.size(); ++i) {
-        const QString &username = profile.instances[i].username;
-        const QString &presetId = profile.instances[i].presetId;
+    const QString &username = profile.instances[index].username;
+    const QString &presetId = profile.instances[index].presetId;
 
-        if (username.isEmpty()) {
-            qCDebug(couchplaySteam) << "Skipping instance" << i << "- no username";
-            continue;
-        }
+    if (username.isEmpty()) {
+        qCDebug(couchplaySteam) << "Skipping instance" << index << "- no username";
+        return directories;
+    }
 
-        LaunchPreset preset = m_presetManager->getPreset(presetId);
+    LaunchPreset preset = m_presetManager->getPreset(presetId);
 
-        if (preset.launcherInfo.requiresAcls) {
-            for (const QString &dir : preset.launcherInfo.gameDirectories) {
-                if (dir.isEmpty()) {
-                    continue;
-                }
-                qCDebug(couchplaySteam) << "Setting ACL with parents on" << dir << "for" << username;
-                if (!m_helperClient->setPathAclWithParents(dir, username)) {
-                    qCWarning(couchplaySteam) << "Failed to set ACL on" << dir;
-                }
+    if (preset.launcherInfo.requiresAcls) {
+        for (const QString &dir : preset.launcherInfo.gameDirectories) {
+            if (!dir.isEmpty()) {
+                directories << dir;
             }
         }
+    }
 
-        if (!m_steamConfigManager) {
-            continue;
-        }
+    if (!m_steamConfigManager) {
+        return directories;
+    }
 
-        if (!m_steamConfigManager->syncShortcutsEnabled()) {
-            qCDebug(couchplaySteam) << "Shortcut sync disabled, skipping";
-            continue;
-        }
+    if (!m_steamConfigManager->syncShortcutsEnabled()) {
+        qCDebug(couchplaySteam) << "Shortcut sync disabled, skipping";
+        return directories;
+    }
 
-        if (!m_steamConfigManager->isSteamDetected()) {
-            m_steamConfigManager->detectSteamPaths();
-        }
+    if (!m_steamConfigManager->isSteamDetected()) {
+        m_steamConfigManager->detectSteamPaths();
+    }
 
-        if (!m_steamConfigManager->isSteamDetected()) {
-            qCDebug(couchplaySteam) << "Steam not detected, skipping config sync";
-            continue;
-        }
+    if (!m_steamConfigManager->isSteamDetected()) {
+        qCDebug(couchplaySteam) << "Steam not detected, skipping config sync";
+        return directories;
+    }
 
-        if (!(preset.steamIntegration || preset.launcherId == QStringLiteral("steam"))) {
-            qCDebug(couchplaySteam) << "Skipping instance" << i << "- preset" << presetId
-                                    << "does not use Steam integration";
-            continue;
-        }
+    if (!(preset.steamIntegration || preset.launcherId == QStringLiteral("steam"))) {
+        qCDebug(couchplaySteam) << "Skipping instance" << index << "- preset" << presetId
+                                << "does not use Steam integration";
+        return directories;
+    }
 
-        m_steamConfigManager->loadShortcuts();
-        QStringList shortcutDirs = m_steamConfigManager->extractShortcutDirectories();
-        qCDebug(couchplaySteam) << "Found" << shortcutDirs.size() << "directories in shortcuts";
+    m_steamConfigManager->loadShortcuts();
+    QStringList shortcutDirs = m_steamConfigManager->extractShortcutDirectories();
+    qCDebug(couchplaySteam) << "Found" << shortcutDirs.size() << "directories in shortcuts";
 
-        qCDebug(couchplaySteam) << "Setting up Steam shortcuts for user" << username;
+    qCDebug(couchplaySteam) << "Setting up Steam shortcuts for user" << username;
 
-        for (const QString &dir : shortcutDirs) {
-            if (QDir(dir).exists()) {
-                qCDebug(couchplaySteam) << "Setting ACL with parents on" << dir << "for" << username;
-                if (!m_helperClient->setPathAclWithParents(dir, username)) {
-                    qCWarning(couchplaySteam) << "Failed to set ACL on" << dir;
-                }
-            }
+    for (const QString &dir : shortcutDirs) {
+        if (QDir(dir).exists()) {
+            directories << dir;
         }
+    }
 
-        qCDebug(couchplaySteam) << "Calling syncShortcutsToUser for" << username;
-        if (!m_steamConfigManager->syncShortcutsToUser(username)) {
-            qCWarning(couchplaySteam) << "Failed to sync shortcuts to user" << username;
-            allSucceeded = false;
-        }
+    syncShortcuts = true;
+    return directories;
+}
+
+QStringList SessionRunner::sharedDirectorySpecs(int index) const
+{
+    // "source|alias|mode" as MountSharedDirectories() takes them, home-relative
+    QStringList specs;
+    const auto &profile = m_sessionManager->currentProfile();
+    if (index < 0 || index >= profile.instances.size()) {
+        return specs;
+    }
+    const QString mode = profile.writableShares ? QStringLiteral("|overlay") : QString();
+    for (const QString &dir : profile.instances[index].sharedDirectories) {
+        specs << dir + QLatin1Char('|') + mode;
+    }
+    return specs;
+}
+
+QStringList SessionRunner::sharedCacheDirectories(int index) const
+{
+    // The compositor user's caches for this instance's Steam game; the helper
+    // seeds them only into players that have none of their own
+    QStringList directories;
+    if (!m_sessionManager || !m_presetManager || !m_steamConfigManager
+        || !m_sessionManager->shareCaches() || !m_steamConfigManager->isSteamDetected()) {
+        return directories;
+    }
+
+    const auto &profile = m_sessionManager->currentProfile();
+    if (index < 0 || index >= profile.instances.size()) {
+        return directories;
     }
 
-    return allSucceeded;
+    const InstanceConfig &instance = profile.instances[index];
+    const LaunchPreset preset = m_presetManager->getPreset(instance.presetId);
+    if (instance.steamAppId.isEmpty()
+        || !(preset.steamIntegration || preset.launcherId == QStringLiteral("steam"))) {
+        return directories;
+    }
+
+    const QString steamApps = m_steamConfigManager->steamPaths().steamRoot + QStringLiteral("/steamapps/");
+    for (const QString &cache : {QStringLiteral("shadercache/"), QStringLiteral("compatdata/")}) {
+        const QString path = steamApps + cache + instance.steamAppId;
+        if (QDir(path).exists()) {
+            directories << path;
+        }
+    }
+    return directories;
 }
 
 QRect SessionRunner::getScreenGeometry() const
@@ -620,6 +2030,46 @@ QRect SessionRunner::getScreenGeometry() const
     return QRect(0, 0, 1920, 1080);
 }
 
+int SessionRunner::getScreenRefreshRate() const
+{
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if (screen && screen->refreshRate() > 0) {
+        return qRound(screen->refreshRate());
+    }
+    return 60;
+}
+
+int SessionRunner::frameLimitFor(int index) const
+{
+    if (!m_sessionManager) {
+        return 0;
+    }
+
+    const SessionProfile &profile = m_sessionManager->currentProfile();
+    if (profile.equalFrameShare) {
+        const int share = equalShareFrameLimit(getScreenRefreshRate(), profile.instances.size());
+        return profile.frameLimit > 0 ? qMin(share, profile.frameLimit) : share;
+    }
+
+    const int own = profile.instances.value(index).frameLimit;
+    return own > 0 ? own : profile.frameLimit;
+}
+
+int SessionRunner::equalShareFrameLimit(int displayRefresh, int instanceCount)
+{
+    if (displayRefresh <= 0) {
+        displayRefresh = 60;
+    }
+
+    // Fewest instances per vblank that still divides the refresh evenly
+    for (int divisor = qMax(1, instanceCount); divisor > 1; --divisor) {
+        if (displayRefresh % divisor == 0 && displayRefresh / divisor >= MIN_EQUAL_SHARE_FPS) {
+            return displayRefresh / divisor;
+        }
+    }
+    return displayRefresh;
+}
+
 QList<QRect> SessionRunner::calculateLayout(const QString &layout,
                                              int instanceCount,
                                              const QRect &screenGeometry)
@@ -667,8 +2117,8 @@ QList<QRect> SessionRunner::calculateLayout(const QString &layout,
             result.append(QRect(x + col * cellWidth, y + row * cellHeight, cellWidth, cellHeight));
         }
     } else if (layout == QStringLiteral("multi-monitor")) {
-        // Each instance on a different monitor - just use full screen for now
-        // In a real implementation, we'd get each monitor's geometry
+        // Without monitor information every instance gets the full screen;
+        // layoutSlots() spreads them over the monitors with MonitorLayout
         for (int i = 0; i < instanceCount; ++i) {
             result.append(screenGeometry);
         }
@@ -700,17 +2150,50 @@ void SessionRunner::onInstanceStopped()
 {
     auto *instance = qobject_cast<GamescopeInstance*>(sender());
     if (instance) {
-        Q_EMIT instanceStopped(instance->index());
-        Q_EMIT instancesChanged();
-        Q_EMIT runningInstanceCountChanged();
+        const int index = instance->index();
+        Q_EMIT instanceStopped(index);
+
+        // Relaunched by relayout(); started again right away, so the session
+        // never looks like it ended
+        const QVariantMap restart = m_restartConfigs.take(index);
+        if (!restart.isEmpty() && !m_stopping) {
+            m_relaunching.insert(index);
+            launchThroughHelper(
+                instance, restart,
+                [this, index]() { return m_relaunching.contains(index) && !m_stopping; },
+                [this, index](bool success) {
+                    m_relaunching.remove(index);
+                    if (!success) {
+                        onInstanceGone();
+                    }
+                });
+            return;
+        }
+        onInstanceGone();
+    }
+}
+
+void SessionRunner::onInstanceGone()
+{
+    Q_EMIT instancesChanged();
+    Q_EMIT runningInstanceCountChanged();
 
-        // Check if all instances have stopped
+    if (m_stopping) {
         if (!isRunning()) {
-            setStatus(QStringLiteral("Session ended"));
-            restoreDeviceOwnership();
-            Q_EMIT runningChanged();
-            Q_EMIT sessionStopped();
+            finishStop();
         }
+        return;
+    }
+
+    // Check if all instances have stopped (instances still being brought
+    // up by the start pipeline or relaunched keep the session alive)
+    if (!isRunning() && !m_starting && m_relaunching.isEmpty()) {
+        setStatus(QStringLiteral("Session ended"));
+        stopInputDiagnostics();
+        restoreDeviceOwnership();
+        Q_EMIT runningChanged();
+        Q_EMIT sessionStopped();
+        scheduleWarmStandby();
     }
 }
 
@@ -732,32 +2215,51 @@ void SessionRunner::positionInstanceWindow(GamescopeInstance *instance)
         return;
     }
 
+    if (m_tracing) {
+        ++m_traceWindows;
+    }
+
     QRect targetGeometry = instance->windowGeometry();
     int instanceIndex = instance->index();
 
     // Queue a position request - the WindowManager will find and position
-    // the next gamescope window that appears (excluding already-positioned ones)
+    // the next gamescope window that appears (excluding already-positioned
+    // ones and hidden standby windows)
     m_windowManager->queuePositionRequest(
         instanceIndex,
         targetGeometry,
-        m_positionedWindowIds,
+        m_positionedWindowIds + m_pool->windowIds(),
         60000  // 60 second timeout for Steam login on secondary instances
     );
 }
 
 void SessionRunner::onWindowPositioned(int requestId, const QString &windowId)
 {
-    Q_UNUSED(requestId)
+    if (requestId >= STANDBY_REQUEST_OFFSET) {
+        m_pool->setWindowId(requestId - STANDBY_REQUEST_OFFSET, windowId);
+        return;
+    }
+
     // Track this window so it's excluded from future positioning
     if (!m_positionedWindowIds.contains(windowId)) {
         m_positionedWindowIds.append(windowId);
     }
+    m_instanceWindowIds.insert(requestId, windowId);
+    windowPlacementSettled();
 }
 
 void SessionRunner::onWindowPositioningTimeout(int requestId)
 {
+    if (requestId >= STANDBY_REQUEST_OFFSET) {
+        // Placed like any other window once the session takes it over
+        qCDebug(couchplayCore) << "Standby window for instance" << requestId - STANDBY_REQUEST_OFFSET
+                               << "did not appear";
+        return;
+    }
+
     qWarning() << "SessionRunner: Failed to position window for instance" << requestId 
                << "after timeout";
+    windowPlacementSettled();
     Q_EMIT errorOccurred(QStringLiteral("Failed to position window for instance %1").arg(requestId));
 }
 
@@ -808,14 +2310,24 @@ void SessionRunner::onDeviceReconnected(const QString &stableId, int eventNumber
         qWarning() << "SessionRunner: No username for instance" << instanceIndex;
         return;
     }
+
+    if (m_latencyMonitor) {
+        m_latencyMonitor->watch(QStringLiteral("/dev/input/event%1").arg(eventNumber), instanceIndex);
+    }
+
+    if (m_inputRouting) {
+        qDebug() << "SessionRunner: Device reconnected, routing" << stableId << "to instance" << instanceIndex;
+        routeDevice(QStringLiteral("/dev/input/event%1").arg(eventNumber), instanceIndex);
+        return;
+    }
     
     // Get UID for this user
-    struct passwd *pw = getpwnam(username.toLocal8Bit().constData());
-    if (!pw) {
+    const std::optional<UserEntry> entry = UserDirectory::instance().user(username);
+    if (!entry) {
         qWarning() << "SessionRunner: User" << username << "not found";
         return;
     }
-    int uid = static_cast<int>(pw->pw_uid);
+    int uid = static_cast<int>(entry->uid);
     
     // Construct the new device path
     QString devicePath = QStringLiteral("/dev/input/event%1").arg(eventNumber);
@@ -834,3 +2346,66 @@ void SessionRunner::onDeviceReconnected(const QString &stableId, int eventNumber
         Q_EMIT errorOccurred(QStringLiteral("Failed to restore device ownership for %1").arg(devicePath));
     }
 }
+
+void SessionRunner::onDeviceAssigned(int eventNumber, int instanceIndex, int previousInstanceIndex)
+{
+    Q_UNUSED(previousInstanceIndex)
+
+    // Without routing a reassignment is picked up on the next session start
+    if (!m_inputRouting || !isRunning() || !m_helperClient || !m_helperClient->isAvailable()) {
+        return;
+    }
+
+    const QString devicePath = QStringLiteral("/dev/input/event%1").arg(eventNumber);
+    if (instanceIndex < 0) {
+        QDBusPendingReply<bool> call = m_helperClient->unrouteDeviceAsync(devicePath);
+        CouchPlayHelperClient::awaitAll({call}, this, [this, devicePath, call]() {
+            QDBusPendingReply<bool> reply = call;
+            if (reply.isError()) {
+                qWarning() << "SessionRunner: Failed to unroute" << devicePath << ":" << reply.error().message();
+                return;
+            }
+            m_ownedDevicePaths.removeAll(devicePath);
+        });
+        return;
+    }
+
+    routeDevice(devicePath, instanceIndex);
+}
+
+void SessionRunner::routeDevice(const QString &devicePath, int instanceIndex)
+{
+    if (!m_sessionManager) {
+        return;
+    }
+
+    const auto &profile = m_sessionManager->currentProfile();
+    if (instanceIndex >= profile.instances.size()) {
+        return;
+    }
+
+    const QString &username = profile.instances[instanceIndex].username;
+    const std::optional<UserEntry> entry = username.isEmpty() ? std::nullopt : UserDirectory::instance().user(username);
+    if (!entry) {
+        qWarning() << "SessionRunner: Cannot route" << devicePath << "- no user for instance" << instanceIndex;
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QDBusPendingReply<QString> call = m_helperClient->routeDeviceAsync(devicePath, static_cast<uint>(entry->uid));
+    CouchPlayHelperClient::awaitAll({call}, this, [this, devicePath, username, timer, call]() {
+        QDBusPendingReply<QString> reply = call;
+        if (reply.isError()) {
+            qWarning() << "SessionRunner: Failed to route" << devicePath << "to" << username << ":" << reply.error().message();
+            Q_EMIT errorOccurred(QStringLiteral("Failed to route %1 to %2: %3")
+                                     .arg(devicePath, username, reply.error().message()));
+            return;
+        }
+        if (!m_ownedDevicePaths.contains(devicePath)) {
+            m_ownedDevicePaths.append(devicePath);
+        }
+        qCDebug(couchplayCore) << "Routed" << devicePath << "to" << username << "as" << reply.value()
+                               << "in" << timer.elapsed() << "ms";
+    });
+}
@@ -3,23 +3,39 @@
 
 #pragma once
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QList>
 #include <QVariantMap>
 #include <QRect>
+#include <QSet>
+#include <QSize>
 #include <qqmlintegration.h>
 
+#include <functional>
+
 #include "../dbus/CouchPlayHelperClient.h"
+#include "GpuTopology.h"
+#include "InstancePool.h"
+#include "InstanceTelemetry.h"
+#include "LaunchPlan.h"
+#include "MonitorLayout.h"
 #include "SteamConfigManager.h"
 
 class QAction;
+class QTimer;
 
 class GamescopeInstance;
+class InputLatencyMonitor;
 class DeviceManager;
 class SessionManager;
+class ResolutionController;
 class WindowManager;
 class PresetManager;
+class MonitorManager;
+class AudioManager;
 
 /**
  * @brief Orchestrates running a complete split-screen gaming session
@@ -40,17 +56,28 @@ class SessionRunner : public QObject
     QML_ELEMENT
 
     Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged)
+    Q_PROPERTY(bool starting READ isStarting NOTIFY startingChanged)
+    Q_PROPERTY(bool stopping READ isStopping NOTIFY stoppingChanged)
+    Q_PROPERTY(qreal startProgress READ startProgress NOTIFY startProgressChanged)
     Q_PROPERTY(int runningInstanceCount READ runningInstanceCount NOTIFY runningInstanceCountChanged)
     Q_PROPERTY(QString status READ status NOTIFY statusChanged)
     Q_PROPERTY(QVariantList instances READ instancesAsVariant NOTIFY instancesChanged)
     Q_PROPERTY(bool borderlessWindows READ borderlessWindows WRITE setBorderlessWindows NOTIFY borderlessWindowsChanged)
+    Q_PROPERTY(bool inputRouting READ inputRouting WRITE setInputRouting NOTIFY inputRoutingChanged)
+    Q_PROPERTY(bool inputDiagnostics READ inputDiagnostics WRITE setInputDiagnostics NOTIFY inputDiagnosticsChanged)
+    Q_PROPERTY(QVariantList inputLatency READ inputLatency NOTIFY inputLatencyChanged)
+    Q_PROPERTY(InstanceTelemetry* telemetry READ telemetry CONSTANT)
+    Q_PROPERTY(InstancePool* instancePool READ instancePool CONSTANT)
+    Q_PROPERTY(QString resumableProfile READ resumableProfile NOTIFY resumableProfileChanged)
     
     // Dependencies
     Q_PROPERTY(SessionManager* sessionManager READ sessionManager WRITE setSessionManager NOTIFY sessionManagerChanged)
     Q_PROPERTY(DeviceManager* deviceManager READ deviceManager WRITE setDeviceManager NOTIFY deviceManagerChanged)
     Q_PROPERTY(CouchPlayHelperClient* helperClient READ helperClient WRITE setHelperClient NOTIFY helperClientChanged)
     Q_PROPERTY(PresetManager* presetManager READ presetManager WRITE setPresetManager NOTIFY presetManagerChanged)
+    Q_PROPERTY(MonitorManager* monitorManager READ monitorManager WRITE setMonitorManager NOTIFY monitorManagerChanged)
     Q_PROPERTY(SteamConfigManager* steamConfigManager READ steamConfigManager WRITE setSteamConfigManager NOTIFY steamConfigManagerChanged)
+    Q_PROPERTY(AudioManager* audioManager READ audioManager WRITE setAudioManager NOTIFY audioManagerChanged)
 
 public:
     explicit SessionRunner(QObject *parent = nullptr);
@@ -58,12 +85,41 @@ public:
 
     /**
      * @brief Start all instances in the current session
-     * @return true if all instances started successfully
+     *
+     * Validates the profile synchronously, then brings each instance up through
+     * a two-stage pipeline driven by the event loop: StagePrepare hands device
+     * ownership, shared directories, launcher ACLs, files and caches to the
+     * helper in one PrepareInstance call, which also launches gamescope once
+     * they are in place; StageLaunch takes over that instance (or a warm
+     * standby one, or launches it on its own if the preparation failed).
+     * No helper call blocks the GUI thread. Progress is reported through
+     * startStageStarted()/startStageFinished() and startupFinished() fires once
+     * every instance has been launched.
+     *
+     * @return true if the start pipeline was started
      */
     Q_INVOKABLE bool start();
 
+    /**
+     * @brief Start the last session again from its LaunchPlan
+     *
+     * Loads the plan's profile if another one is current, checks the plan
+     * still holds (LaunchPlan::validate(), same profile, monitors and
+     * settings) and runs the start pipeline on what it recorded, without
+     * resolving presets, detecting launchers or scanning shortcuts. If it
+     * doesn't hold any more, the profile is started the regular way.
+     *
+     * @return true if the start pipeline was started
+     */
+    Q_INVOKABLE bool resume();
+
     /**
      * @brief Stop all running instances
+     *
+     * Returns straight away: every instance is asked to exit at once and
+     * their exits are awaited together, then devices and shared
+     * directories are released with one helper call each. sessionStopped()
+     * fires once all of that is done; meanwhile isStopping() is true.
      */
     Q_INVOKABLE void stop();
 
@@ -78,6 +134,21 @@ public:
      */
     bool isRunning() const;
 
+    /**
+     * @brief Check if the start pipeline is still bringing instances up
+     */
+    bool isStarting() const { return m_starting; }
+
+    /**
+     * @brief Check if stop() is still waiting for instances or the helper
+     */
+    bool isStopping() const { return m_stopping; }
+
+    /**
+     * @brief Fraction of start pipeline stages completed (0.0 - 1.0)
+     */
+    qreal startProgress() const;
+
     /**
      * @brief Get the number of currently running instances
      */
@@ -109,9 +180,104 @@ public:
     SteamConfigManager* steamConfigManager() const { return m_steamConfigManager; }
     void setSteamConfigManager(SteamConfigManager *manager);
 
+    /**
+     * @brief Monitors the "multi-monitor" layout spreads instances over
+     *
+     * Without one, or with no monitors detected, "multi-monitor" stacks
+     * every instance on the primary screen.
+     */
+    MonitorManager* monitorManager() const { return m_monitorManager; }
+    void setMonitorManager(MonitorManager *manager);
+
+    /**
+     * @brief Gives each player their own sink when per-player audio is available
+     */
+    AudioManager* audioManager() const { return m_audioManager; }
+    void setAudioManager(AudioManager *manager);
+
     bool borderlessWindows() const { return m_borderlessWindows; }
     void setBorderlessWindows(bool borderless);
 
+    /**
+     * @brief Route assigned devices through the helper's input router
+     *
+     * Instead of handing device nodes to players, the helper grabs them and
+     * forwards events to per-player virtual devices. Reassigning a device
+     * during a session then takes effect immediately.
+     */
+    bool inputRouting() const { return m_inputRouting; }
+    void setInputRouting(bool enabled);
+
+    /**
+     * @brief Measure per-player input latency while the session runs
+     *
+     * Assigned devices are read alongside the players (see
+     * InputLatencyMonitor); results are published through inputLatency
+     * once a second. Enable before starting the session, device nodes can't
+     * be opened once they have been handed to the players.
+     */
+    bool inputDiagnostics() const { return m_inputDiagnostics; }
+    void setInputDiagnostics(bool enabled);
+
+    /**
+     * @brief Per-player latency figures, see InputLatencyMonitor::stats()
+     */
+    QVariantList inputLatency() const { return m_inputLatency; }
+
+    /**
+     * @brief Per-instance CPU, memory, GPU and frame rate while the session runs
+     *
+     * Sampled once a second; instances also carries the latest values.
+     */
+    InstanceTelemetry* telemetry() const { return m_telemetry; }
+
+    /**
+     * @brief GPU budget in Mpx/s, the profile's or the detected GPU's default
+     */
+    Q_INVOKABLE int gpuBudget() const;
+
+    /**
+     * @brief GPUs an instance can be placed on, see GpuTopology
+     *
+     * Entries have "pciAddress", "name", "renderNode" and "discrete".
+     */
+    Q_INVOKABLE QVariantList availableGpus() const;
+
+    /**
+     * @brief PCI address of the GPU each instance would get now, empty for the default
+     *
+     * Resolves the instances' "auto" with GpuTopology::balance(), loads
+     * being their output pixels per second, and only offering a player the
+     * GPUs whose render node their user can open.
+     */
+    Q_INVOKABLE QStringList gpuPlacement() const;
+
+    /**
+     * @brief Output and internal resolution each instance would get now
+     *
+     * Entries have "index", "output" (connector, empty on a single screen),
+     * "outputWidth", "outputHeight", "internalWidth", "internalHeight",
+     * "scale" and "fsr". The internal resolution is in device pixels and
+     * only drops below the window's in the profile's performance mode.
+     */
+    Q_INVOKABLE QVariantList renderPlan() const;
+
+    /**
+     * @brief Warm standby for the current profile's players
+     *
+     * While enabled and no session runs, each player of the current profile
+     * is prepared ahead of time and, with prelaunch, launched hidden. start()
+     * takes over matching entries instead of launching from scratch.
+     */
+    InstancePool* instancePool() const { return m_pool; }
+
+    /**
+     * @brief Profile of the last successfully started session, empty if none
+     *
+     * That session can be started again with resume().
+     */
+    QString resumableProfile() const { return m_resumableProfile; }
+
     /**
      * @brief Calculate window geometries for a given layout
      * @param layout Layout type: "horizontal", "vertical", "multi-monitor", "grid"
@@ -123,8 +289,34 @@ public:
                                          int instanceCount,
                                          const QRect &screenGeometry);
 
+    /// Lowest frame rate equal frame sharing goes down to
+    static constexpr int MIN_EQUAL_SHARE_FPS = 30;
+
+    /**
+     * @brief Frame rate cap giving @p instanceCount instances an even share of the display
+     *
+     * The display refresh divided by the instance count, rounded to a whole
+     * divisor of the refresh so every instance presents on the same vblank
+     * cadence (120 Hz, 2 players: 60), but not below MIN_EQUAL_SHARE_FPS
+     * (60 Hz, 3 players: 30).
+     */
+    static int equalShareFrameLimit(int displayRefresh, int instanceCount);
+
+    /**
+     * @brief Whether a running instance has to be relaunched to render at @p target
+     *
+     * gamescope scales its internal resolution to whatever size its window
+     * gets, so a re-layout only restarts an instance when the shape of its
+     * tile changes (aspect ratio off by more than 1%), not for a mode
+     * switch of the same shape.
+     */
+    static bool relayoutNeedsRestart(const QSize &current, const QSize &target);
+
 Q_SIGNALS:
     void runningChanged();
+    void startingChanged();
+    void stoppingChanged();
+    void startProgressChanged();
     void runningInstanceCountChanged();
     void statusChanged();
     void instancesChanged();
@@ -133,13 +325,42 @@ Q_SIGNALS:
     void helperClientChanged();
     void presetManagerChanged();
     void steamConfigManagerChanged();
+    void monitorManagerChanged();
+    void audioManagerChanged();
     void borderlessWindowsChanged();
+    void inputRoutingChanged();
+    void inputDiagnosticsChanged();
+    void inputLatencyChanged();
+    void resumableProfileChanged();
     void errorOccurred(const QString &message);
     void sessionStarted();
     void sessionStopped();
     void instanceStarted(int index);
     void instanceStopped(int index);
 
+    /**
+     * @brief A start pipeline stage began for an instance
+     * @param stage One of "prepare" (devices, mounts, ACLs, shortcuts) or "launch"
+     */
+    void startStageStarted(int index, const QString &stage);
+
+    /**
+     * @brief A start pipeline stage finished for an instance
+     * @param elapsedMs Wall-clock time spent in the stage
+     */
+    void startStageFinished(int index, const QString &stage, bool success, qint64 elapsedMs);
+
+    /**
+     * @brief Every instance has been through the start pipeline
+     * @param elapsedMs Total time since start() was called
+     */
+    void startupFinished(qint64 elapsedMs);
+
+    /**
+     * @brief Dynamic resolution relaunched instance @p index at @p scale per axis
+     */
+    void renderScaleChanged(int index, double scale);
+
 private Q_SLOTS:
     void onInstanceStarted();
     void onInstanceStopped();
@@ -159,15 +380,122 @@ private Q_SLOTS:
      */
     void onDeviceReconnected(const QString &stableId, int eventNumber, int instanceIndex);
 
+    /**
+     * @brief Move a routed device to its new player while the session runs
+     */
+    void onDeviceAssigned(int eventNumber, int instanceIndex, int previousInstanceIndex);
+
+    /**
+     * @brief Bring the instance pool in line with the current profile
+     */
+    void warmStandby();
+
+    /**
+     * @brief Fit the running instances to the current monitors
+     *
+     * Moves every window whose tile changed in one batch of placements;
+     * instances whose tile changed shape are relaunched (see
+     * relayoutNeedsRestart()).
+     */
+    void relayout();
+    void onStandbyEvicted(int index, const QString &username, const QString &reason);
+
 private:
+    // Window positioning request ids of standby instances (pool index + offset)
+    static constexpr int STANDBY_REQUEST_OFFSET = 1000;
+
+    // Second half of warmStandby(), once the session is authorized
+    void warmStandbyInstances(quint64 generation);
+
+    // Stages of the per-instance start pipeline, in execution order
+    enum StartStage {
+        StagePrepare,
+        StageLaunch,
+        StageCount
+    };
+
+    struct InstanceStartState {
+        int nextStage = StagePrepare;
+        QElapsedTimer stageTimer;
+        quint64 traceSpan = 0; // SessionTrace span of the running stage
+        qint64 launchedPid = 0; // Launched by the prepare stage's call
+        bool launchFailed = false; // The prepare stage's call tried to launch and failed
+    };
+
     void setStatus(const QString &status);
     void cleanupInstances();
-    bool setupDeviceOwnership();
-    void restoreDeviceOwnership();
-    bool setupSharedDirectories();
-    void teardownSharedDirectories();
-    bool setupLauncherAccess();
+    GamescopeInstance *instanceAt(int index) const;
+
+    // Start pipeline
+    static QString startStageName(int stage);
+    void scheduleStartStage(int index);
+    void runStartStage(int index);
+    void finishStartStage(int index, quint64 generation, bool success);
+    void finishStart();
+    bool isCurrentStart(quint64 generation) const;
+    // start() and resume(): launches @p plan, or records a new one if it is empty
+    bool startSession(const LaunchPlan &plan);
+    // Why m_sessionManager's profile can't be resumed from @p plan, empty if it can
+    QString resumeBlocker(const LaunchPlan &plan) const;
+    // What launchInstance() launches: the resumed plan's config or a fresh one
+    QVariantMap startConfig(int index) const;
+    // Collect the helper's spans and write the SessionTrace once the start
+    // and the placement of its windows are done (or the session is stopped)
+    void windowPlacementSettled();
+    void finishTrace();
+    // The launch stage: takes over a standby instance or what the prepare
+    // stage launched, else launches through the helper; ends with finishStartStage()
+    void launchInstance(int index);
+    // LaunchInstance for @p config and attach @p instance to it. @p done gets
+    // whether it runs, unless @p current says by the reply that the launch
+    // is no longer wanted; the instance is then stopped again.
+    void launchThroughHelper(GamescopeInstance *instance, const QVariantMap &config,
+                             const std::function<bool()> &current, const std::function<void(bool)> &done);
+    QVariantMap buildInstanceConfig(int index, const MonitorLayout::Slot &slot) const;
+    QList<MonitorLayout::Slot> layoutSlots() const;
+    double renderScale() const;
+    // renderScale(), or the dynamic resolution's scale for the player
+    double instanceRenderScale(int index) const;
+    // Frame rate the player should reach: its cap, else its refresh rate
+    int targetFrameRate(int index) const;
+    void updateDynamicResolution();
+    void onRenderScaleChanged(int index, double scale);
+    bool takeStandbyInstance(int index, const QVariantMap &config);
+    void scheduleWarmStandby();
+    void scheduleRelayout();
+    // Stop @p instance and launch it again with @p config once it has exited
+    void restartInstance(GamescopeInstance *instance, const QVariantMap &config);
+    // An instance stopped for good: the session ends with its last one
+    void onInstanceGone();
+
+    // Device ownership, mounts, ACLs and shortcuts in one helper call;
+    // ends with finishStartStage()
+    void runPrepareStage(int index);
+
+    void startInputDiagnostics();
+    void stopInputDiagnostics();
+    void updateInputLatency();
+    // Both return the helper call in flight, already finished if there was
+    // nothing to do
+    QDBusPendingCall restoreDeviceOwnership();
+    void routeDevice(const QString &devicePath, int instanceIndex);
+    QDBusPendingCall teardownSharedDirectories();
+
+    // Second half of stop(), once no instance is running any more
+    void finishStop();
+    // Once the helper has answered the reset and unmount @p calls of finishStop()
+    void completeStop(const QList<QDBusPendingCall> &calls);
+    // Player sinks and guest accounts of the session that just ended
+    void releaseSessionPlayers();
+    // Removes each of @p usernames in turn, reporting failures through errorOccurred()
+    void deleteGuests(QStringList usernames);
+    QStringList launcherAclDirectories(int index, bool &syncShortcuts);
+    QStringList sharedCacheDirectories(int index) const;
+    QStringList sharedDirectorySpecs(int index) const;
     QRect getScreenGeometry() const;
+    int getScreenRefreshRate() const;
+    int frameLimitFor(int index) const;
+    QStringList gpuPlacement(const QList<GpuTopology::Gpu> &gpus) const;
     void positionInstanceWindow(GamescopeInstance *instance);
     void setupGlobalShortcut();
 
@@ -177,10 +505,46 @@ private:
     CouchPlayHelperClient *m_helperClient = nullptr;
     PresetManager *m_presetManager = nullptr;
     SteamConfigManager *m_steamConfigManager = nullptr;
+    MonitorManager *m_monitorManager = nullptr;
+    AudioManager *m_audioManager = nullptr;
     WindowManager *m_windowManager = nullptr;
     QAction *m_stopAction = nullptr;
     QString m_status;
     QStringList m_ownedDevicePaths; // Devices we've taken ownership of
     QStringList m_positionedWindowIds; // Window IDs we've positioned (for excluding)
+    QHash<int, QString> m_instanceWindowIds; // Instance index -> its window
+    QHash<int, QVariantMap> m_restartConfigs; // Instances being relaunched, by index
+    QSet<int> m_relaunching; // Of those, the ones whose LaunchInstance is in flight
     bool m_borderlessWindows = false; // Default to decorated windows
+    bool m_inputRouting = false; // Default to chown-based device isolation
+    bool m_inputDiagnostics = false;
+    InputLatencyMonitor *m_latencyMonitor = nullptr; // Only while diagnostics run
+    QTimer *m_latencyTimer = nullptr;
+    QVariantList m_inputLatency;
+    InstanceTelemetry *m_telemetry = nullptr;
+    ResolutionController *m_resolution = nullptr;
+    InstancePool *m_pool = nullptr;
+    QTimer *m_warmTimer = nullptr; // Debounces profile edits before warming
+    quint64 m_warmGeneration = 0; // Bumped when a session starts to drop warm-up replies
+    QTimer *m_relayoutTimer = nullptr; // Monitor changes arrive in bursts
+
+    // Start pipeline state
+    QList<InstanceStartState> m_startStates;
+    QList<MonitorLayout::Slot> m_startLayouts;
+    QElapsedTimer m_startTimer;
+    LaunchPlan m_plan; // Being resumed, or recorded for the next resume()
+    bool m_resuming = false;
+    bool m_startFailed = false; // A stage failed, don't record the plan
+    QString m_resumableProfile;
+    quint64 m_startGeneration = 0; // Bumped on stop() to drop queued stages
+    int m_completedStartStages = 0;
+    bool m_starting = false;
+
+    // SessionTrace of the current start (COUCHPLAY_SESSION_TRACE)
+    bool m_tracing = false;
+    quint64 m_traceSpan = 0;
+    int m_traceWindows = 0; // Launched instances whose window isn't placed yet
+
+    bool m_stopping = false;
+    QElapsedTimer m_stopTimer;
 };
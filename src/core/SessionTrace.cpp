@@ -0,0 +1,240 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "SessionTrace.h"
+#include "Logging.h"
+
+#include <QCoreApplication>
+#include <QDBusArgument>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+
+#include <time.h>
+
+namespace {
+
+struct HelperSpan {
+    QString name;
+    qint64 startUs = 0;
+    qint64 durationUs = 0;
+    quint64 parent = 0;
+};
+
+bool s_active = false;
+QString s_name;
+QList<SessionTrace::Span> s_spans;
+QList<HelperSpan> s_helperSpans;
+qint64 s_helperPid = 0;
+quint64 s_baseId = 0;   // IDs of the current trace are above this
+quint64 s_nextId = 0;
+
+QJsonObject event(const char *phase, const QString &name, const QString &category, qint64 pid, qint64 tid,
+                  qint64 ts)
+{
+    return QJsonObject{
+        {QStringLiteral("ph"), QLatin1String(phase)},
+        {QStringLiteral("name"), name},
+        {QStringLiteral("cat"), category},
+        {QStringLiteral("pid"), pid},
+        {QStringLiteral("tid"), tid},
+        {QStringLiteral("ts"), ts},
+    };
+}
+
+QJsonObject metadata(const char *kind, qint64 pid, qint64 tid, const QString &name)
+{
+    QJsonObject object = event("M", QLatin1String(kind), QString(), pid, tid, 0);
+    object.insert(QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), name}});
+    return object;
+}
+
+} // namespace
+
+qint64 SessionTrace::nowUs()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+bool SessionTrace::enabled()
+{
+    static const bool enabled = qEnvironmentVariableIsSet("COUCHPLAY_SESSION_TRACE");
+    return enabled;
+}
+
+void SessionTrace::begin(const QString &name)
+{
+    s_active = true;
+    s_name = name;
+    s_spans.clear();
+    s_helperSpans.clear();
+    s_helperPid = 0;
+    s_baseId = s_nextId;
+}
+
+bool SessionTrace::isActive()
+{
+    return s_active;
+}
+
+quint64 SessionTrace::open(const char *category, const QString &name, const QString &track)
+{
+    if (!s_active || s_spans.size() >= MAX_SPANS) {
+        return 0;
+    }
+
+    Span span;
+    span.id = ++s_nextId;
+    span.category = QLatin1String(category);
+    span.name = name;
+    span.track = track;
+    span.startUs = nowUs();
+    s_spans.append(span);
+    return span.id;
+}
+
+void SessionTrace::close(quint64 id, const QVariantMap &args)
+{
+    // IDs from an earlier trace, or spans that were never opened
+    if (!s_active || id <= s_baseId || id - s_baseId > quint64(s_spans.size())) {
+        return;
+    }
+
+    Span &span = s_spans[qsizetype(id - s_baseId - 1)];
+    if (span.durationUs < 0) {
+        span.durationUs = nowUs() - span.startUs;
+        span.args.insert(args);
+    }
+}
+
+void SessionTrace::addHelperSpans(const QVariantMap &trace)
+{
+    if (!s_active) {
+        return;
+    }
+
+    s_helperPid = trace.value(QStringLiteral("pid")).toLongLong();
+    const QVariantList spans = qdbus_cast<QVariantList>(trace.value(QStringLiteral("spans")));
+    for (const QVariant &value : spans) {
+        const QVariantMap map = qdbus_cast<QVariantMap>(value);
+        HelperSpan span;
+        span.name = map.value(QStringLiteral("name")).toString();
+        span.startUs = map.value(QStringLiteral("start")).toLongLong();
+        span.durationUs = map.value(QStringLiteral("duration")).toLongLong();
+        span.parent = map.value(QStringLiteral("parent")).toULongLong();
+        s_helperSpans.append(span);
+    }
+}
+
+QList<SessionTrace::Span> SessionTrace::spans()
+{
+    return s_spans;
+}
+
+QByteArray SessionTrace::toChromeTrace()
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    const qint64 now = nowUs();
+
+    QJsonArray events;
+    events.append(metadata("process_name", pid, 0, QStringLiteral("CouchPlay")));
+
+    // One thread track per named track, in order of first use; async spans go on track 0
+    QHash<QString, qint64> tids;
+    for (const Span &span : std::as_const(s_spans)) {
+        if (!span.track.isEmpty() && !tids.contains(span.track)) {
+            const qint64 tid = tids.size() + 1;
+            tids.insert(span.track, tid);
+            events.append(metadata("thread_name", pid, tid, span.track));
+        }
+    }
+
+    for (const Span &span : std::as_const(s_spans)) {
+        QJsonObject args = QJsonObject::fromVariantMap(span.args);
+        qint64 duration = span.durationUs;
+        if (duration < 0) {
+            // Still open when the trace was saved, e.g. a window that never appeared
+            duration = now - span.startUs;
+            args.insert(QStringLiteral("unfinished"), true);
+        }
+
+        if (span.track.isEmpty()) {
+            args.insert(QStringLiteral("span"), QString::number(span.id));
+            QJsonObject beginEvent = event("b", span.name, span.category, pid, 0, span.startUs);
+            beginEvent.insert(QStringLiteral("id"), QString::number(span.id));
+            beginEvent.insert(QStringLiteral("args"), args);
+            events.append(beginEvent);
+            QJsonObject endEvent = event("e", span.name, span.category, pid, 0, span.startUs + duration);
+            endEvent.insert(QStringLiteral("id"), QString::number(span.id));
+            events.append(endEvent);
+        } else {
+            QJsonObject complete = event("X", span.name, span.category, pid, tids.value(span.track), span.startUs);
+            complete.insert(QStringLiteral("dur"), duration);
+            complete.insert(QStringLiteral("args"), args);
+            events.append(complete);
+        }
+    }
+
+    if (!s_helperSpans.isEmpty()) {
+        events.append(metadata("process_name", s_helperPid, 0, QStringLiteral("couchplay-helper")));
+        for (const HelperSpan &span : std::as_const(s_helperSpans)) {
+            QJsonObject complete =
+                event("X", span.name, QStringLiteral("helper"), s_helperPid, s_helperPid, span.startUs);
+            complete.insert(QStringLiteral("dur"), span.durationUs);
+            if (span.parent > 0) {
+                // The client's D-Bus span for this call
+                complete.insert(QStringLiteral("args"),
+                                QJsonObject{{QStringLiteral("parent"), QString::number(span.parent)}});
+            }
+            events.append(complete);
+        }
+    }
+
+    const QJsonObject trace{
+        {QStringLiteral("traceEvents"), events},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")},
+        {QStringLiteral("otherData"), QJsonObject{{QStringLiteral("session"), s_name}}},
+    };
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+QString SessionTrace::save()
+{
+    if (!s_active) {
+        return QString();
+    }
+
+    const QByteArray json = toChromeTrace();
+    s_active = false;
+
+    const QString directory =
+        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/traces");
+    const QString path = directory + QStringLiteral("/session-%1.json")
+                                         .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss")));
+    QFile file(path);
+    if (!QDir().mkpath(directory) || !file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || file.write(json) != json.size()) {
+        qCWarning(couchplayCore) << "Cannot write session trace to" << path << ":" << file.errorString();
+        return QString();
+    }
+
+    qCInfo(couchplayCore) << "Session trace written to" << path;
+    return path;
+}
+
+SessionTrace::Scope::Scope(const char *category, const QString &name, const QString &track)
+    : m_id(open(category, name, track))
+{
+}
+
+SessionTrace::Scope::~Scope()
+{
+    close(m_id);
+}
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+
+/**
+ * @brief Timeline of one session start, across CouchPlay and the helper
+ *
+ * With COUCHPLAY_SESSION_TRACE set, SessionRunner calls begin() when a
+ * session starts and the components on the start path open spans: the start
+ * pipeline's stages (one track per instance), every helper call made through
+ * CouchPlayHelperClient::callAsync() and the wait for each window in
+ * WindowManager. Helper calls carry their span ID to the helper (see
+ * HelperTrace), whose handler spans come back through addHelperSpans().
+ * save() writes everything as Chrome trace event JSON, which Perfetto and
+ * chrome://tracing open as one timeline.
+ *
+ * Times are CLOCK_MONOTONIC microseconds, shared with the helper. Nothing is
+ * recorded while no trace is active. GUI thread only.
+ */
+class SessionTrace
+{
+public:
+    static constexpr int MAX_SPANS = 16384;
+
+    struct Span {
+        quint64 id = 0;
+        QString category;
+        QString name;
+        QString track;          // Empty for async spans such as D-Bus calls
+        qint64 startUs = 0;
+        qint64 durationUs = -1; // Still open
+        QVariantMap args;
+    };
+
+    class Scope
+    {
+    public:
+        Scope(const char *category, const QString &name, const QString &track);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        quint64 m_id;
+    };
+
+    /**
+     * @brief Whether traces are enabled (COUCHPLAY_SESSION_TRACE)
+     */
+    static bool enabled();
+
+    /**
+     * @brief Drop the previous trace and start recording
+     */
+    static void begin(const QString &name);
+    static bool isActive();
+
+    /**
+     * @brief Open a span
+     * @return Its ID for close(), 0 when no trace is active
+     */
+    static quint64 open(const char *category, const QString &name, const QString &track = QString());
+    static void close(quint64 id, const QVariantMap &args = QVariantMap());
+
+    /**
+     * @brief Merge a CouchPlayHelper::TakeTrace reply
+     */
+    static void addHelperSpans(const QVariantMap &trace);
+
+    static QList<Span> spans();
+
+    /**
+     * @brief The trace as Chrome trace event JSON
+     */
+    static QByteArray toChromeTrace();
+
+    /**
+     * @brief Stop recording and write the trace
+     *
+     * To traces/session-<time>.json in the cache directory.
+     *
+     * @return Path of the file, empty if nothing was written
+     */
+    static QString save();
+
+    static qint64 nowUs();
+};
@@ -2,6 +2,7 @@
 // SPDX-FileCopyrightText: 2025 CouchPlay Contributors
 
 #include "SettingsManager.h"
+#include "StartupTrace.h"
 
 #include <QDebug>
 
@@ -11,6 +12,7 @@
 SettingsManager::SettingsManager(QObject *parent)
     : QObject(parent)
 {
+    StartupTrace::Scope trace("SettingsManager");
     loadSettings();
 }
 
@@ -24,6 +26,11 @@ void SettingsManager::loadSettings()
     m_killSteam = general.readEntry(QStringLiteral("KillSteam"), true);
     m_restoreSession = general.readEntry(QStringLiteral("RestoreSession"), false);
     m_ignoredDevices = general.readEntry(QStringLiteral("IgnoredDevices"), QStringList());
+    m_inputRouting = general.readEntry(QStringLiteral("InputRouting"), false);
+    m_warmStandby = general.readEntry(QStringLiteral("WarmStandby"), false);
+    m_prelaunchInstances = general.readEntry(QStringLiteral("PrelaunchInstances"), false);
+    m_standbyIdleTimeout = general.readEntry(QStringLiteral("StandbyIdleTimeout"), 15);
+    m_standbyMemoryLimit = general.readEntry(QStringLiteral("StandbyMemoryLimit"), 0);
     
     // Gamescope settings
     KConfigGroup gamescope = config->group(QStringLiteral("Gamescope"));
@@ -45,6 +52,11 @@ void SettingsManager::saveSettings()
     general.writeEntry(QStringLiteral("KillSteam"), m_killSteam);
     general.writeEntry(QStringLiteral("RestoreSession"), m_restoreSession);
     general.writeEntry(QStringLiteral("IgnoredDevices"), m_ignoredDevices);
+    general.writeEntry(QStringLiteral("InputRouting"), m_inputRouting);
+    general.writeEntry(QStringLiteral("WarmStandby"), m_warmStandby);
+    general.writeEntry(QStringLiteral("PrelaunchInstances"), m_prelaunchInstances);
+    general.writeEntry(QStringLiteral("StandbyIdleTimeout"), m_standbyIdleTimeout);
+    general.writeEntry(QStringLiteral("StandbyMemoryLimit"), m_standbyMemoryLimit);
     
     // Gamescope settings
     KConfigGroup gamescope = config->group(QStringLiteral("Gamescope"));
@@ -146,6 +158,53 @@ void SettingsManager::removeIgnoredDevice(const QString &stableId)
     }
 }
 
+void SettingsManager::setInputRouting(bool value)
+{
+    if (m_inputRouting != value) {
+        m_inputRouting = value;
+        saveSettings();
+        Q_EMIT inputRoutingChanged();
+    }
+}
+
+void SettingsManager::setWarmStandby(bool value)
+{
+    if (m_warmStandby != value) {
+        m_warmStandby = value;
+        saveSettings();
+        Q_EMIT warmStandbyChanged();
+    }
+}
+
+void SettingsManager::setPrelaunchInstances(bool value)
+{
+    if (m_prelaunchInstances != value) {
+        m_prelaunchInstances = value;
+        saveSettings();
+        Q_EMIT prelaunchInstancesChanged();
+    }
+}
+
+void SettingsManager::setStandbyIdleTimeout(int value)
+{
+    value = qMax(0, value);
+    if (m_standbyIdleTimeout != value) {
+        m_standbyIdleTimeout = value;
+        saveSettings();
+        Q_EMIT standbyIdleTimeoutChanged();
+    }
+}
+
+void SettingsManager::setStandbyMemoryLimit(int value)
+{
+    value = qMax(0, value);
+    if (m_standbyMemoryLimit != value) {
+        m_standbyMemoryLimit = value;
+        saveSettings();
+        Q_EMIT standbyMemoryLimitChanged();
+    }
+}
+
 void SettingsManager::resetToDefaults()
 {
     m_hidePanels = true;
@@ -156,6 +215,11 @@ void SettingsManager::resetToDefaults()
     m_steamIntegration = true;
     m_borderlessWindows = false;
     m_ignoredDevices.clear();
+    m_inputRouting = false;
+    m_warmStandby = false;
+    m_prelaunchInstances = false;
+    m_standbyIdleTimeout = 15;
+    m_standbyMemoryLimit = 0;
     
     saveSettings();
     
@@ -167,6 +231,11 @@ void SettingsManager::resetToDefaults()
     Q_EMIT steamIntegrationChanged();
     Q_EMIT borderlessWindowsChanged();
     Q_EMIT ignoredDevicesChanged();
+    Q_EMIT inputRoutingChanged();
+    Q_EMIT warmStandbyChanged();
+    Q_EMIT prelaunchInstancesChanged();
+    Q_EMIT standbyIdleTimeoutChanged();
+    Q_EMIT standbyMemoryLimitChanged();
     
     qDebug() << "SettingsManager: Reset all settings to defaults";
 }
@@ -23,6 +23,10 @@ class SettingsManager : public QObject
     Q_PROPERTY(bool hidePanels READ hidePanels WRITE setHidePanels NOTIFY hidePanelsChanged)
     Q_PROPERTY(bool killSteam READ killSteam WRITE setKillSteam NOTIFY killSteamChanged)
     Q_PROPERTY(bool restoreSession READ restoreSession WRITE setRestoreSession NOTIFY restoreSessionChanged)
+    Q_PROPERTY(bool warmStandby READ warmStandby WRITE setWarmStandby NOTIFY warmStandbyChanged)
+    Q_PROPERTY(bool prelaunchInstances READ prelaunchInstances WRITE setPrelaunchInstances NOTIFY prelaunchInstancesChanged)
+    Q_PROPERTY(int standbyIdleTimeout READ standbyIdleTimeout WRITE setStandbyIdleTimeout NOTIFY standbyIdleTimeoutChanged)
+    Q_PROPERTY(int standbyMemoryLimit READ standbyMemoryLimit WRITE setStandbyMemoryLimit NOTIFY standbyMemoryLimitChanged)
 
     // Gamescope settings
     Q_PROPERTY(QString scalingMode READ scalingMode WRITE setScalingMode NOTIFY scalingModeChanged)
@@ -32,6 +36,7 @@ class SettingsManager : public QObject
 
     // Device settings
     Q_PROPERTY(QStringList ignoredDevices READ ignoredDevices WRITE setIgnoredDevices NOTIFY ignoredDevicesChanged)
+    Q_PROPERTY(bool inputRouting READ inputRouting WRITE setInputRouting NOTIFY inputRoutingChanged)
 
 public:
     explicit SettingsManager(QObject *parent = nullptr);
@@ -47,6 +52,21 @@ public:
     bool restoreSession() const { return m_restoreSession; }
     void setRestoreSession(bool value);
 
+    // Prepare (and optionally launch) the current profile's players ahead of time
+    bool warmStandby() const { return m_warmStandby; }
+    void setWarmStandby(bool value);
+
+    bool prelaunchInstances() const { return m_prelaunchInstances; }
+    void setPrelaunchInstances(bool value);
+
+    // Minutes before an unused standby entry is dropped, 0 for never
+    int standbyIdleTimeout() const { return m_standbyIdleTimeout; }
+    void setStandbyIdleTimeout(int value);
+
+    // MiB a standby user may use before its entry is dropped, 0 for no limit
+    int standbyMemoryLimit() const { return m_standbyMemoryLimit; }
+    void setStandbyMemoryLimit(int value);
+
     // Gamescope settings
     QString scalingMode() const { return m_scalingMode; }
     void setScalingMode(const QString &value);
@@ -66,6 +86,10 @@ public:
     Q_INVOKABLE void addIgnoredDevice(const QString &stableId);
     Q_INVOKABLE void removeIgnoredDevice(const QString &stableId);
 
+    // Route devices through the helper's input router instead of chown
+    bool inputRouting() const { return m_inputRouting; }
+    void setInputRouting(bool value);
+
     /**
      * Reset all settings to defaults
      */
@@ -75,11 +99,16 @@ Q_SIGNALS:
     void hidePanelsChanged();
     void killSteamChanged();
     void restoreSessionChanged();
+    void warmStandbyChanged();
+    void prelaunchInstancesChanged();
+    void standbyIdleTimeoutChanged();
+    void standbyMemoryLimitChanged();
     void scalingModeChanged();
     void filterModeChanged();
     void steamIntegrationChanged();
     void borderlessWindowsChanged();
     void ignoredDevicesChanged();
+    void inputRoutingChanged();
 
 private:
     void loadSettings();
@@ -89,6 +118,10 @@ private:
     bool m_hidePanels = true;
     bool m_killSteam = true;
     bool m_restoreSession = false;
+    bool m_warmStandby = false;
+    bool m_prelaunchInstances = false;
+    int m_standbyIdleTimeout = 15;
+    int m_standbyMemoryLimit = 0;
 
     // Gamescope settings
     QString m_scalingMode = QStringLiteral("fit");
@@ -98,4 +131,5 @@ private:
 
     // Device settings
     QStringList m_ignoredDevices;
+    bool m_inputRouting = false;
 };
@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "StartupTrace.h"
+#include "Logging.h"
+
+#include <QFile>
+
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+QList<StartupTrace::Entry> s_entries;
+int s_depth = 0;
+bool s_finished = false;
+
+qint64 bootTimeUs()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    return qint64(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+// Start of the process in CLOCK_BOOTTIME, so dynamic linking and static
+// initializers count too; field 22 of /proc/self/stat, in clock ticks
+qint64 processStartUs()
+{
+    QFile stat(QStringLiteral("/proc/self/stat"));
+    if (stat.open(QIODevice::ReadOnly)) {
+        const QByteArray line = stat.readAll();
+        // comm may contain spaces; the fields after it don't
+        const QList<QByteArray> fields = line.mid(line.lastIndexOf(')') + 2).split(' ');
+        const long ticks = sysconf(_SC_CLK_TCK);
+        bool ok = false;
+        const qint64 start = fields.value(19).toLongLong(&ok);
+        if (ok && ticks > 0) {
+            return start * 1000000 / ticks;
+        }
+    }
+    return bootTimeUs();
+}
+
+} // namespace
+
+qint64 StartupTrace::elapsedUs()
+{
+    static const qint64 origin = processStartUs();
+    return bootTimeUs() - origin;
+}
+
+StartupTrace::Scope::Scope(const char *name)
+    : m_name(name)
+    , m_startUs(elapsedUs())
+{
+    if (s_finished) {
+        return;
+    }
+    m_index = s_entries.size();
+    s_entries.append({QString::fromLatin1(m_name), m_startUs, 0, s_depth++});
+}
+
+StartupTrace::Scope::~Scope()
+{
+    if (m_index < 0) {
+        return;
+    }
+    --s_depth;
+    if (!s_finished) {
+        s_entries[m_index].durationUs = elapsedUs() - m_startUs;
+    }
+}
+
+qint64 StartupTrace::firstFrame()
+{
+    static qint64 total = -1;
+    if (s_finished) {
+        return total;
+    }
+    s_finished = true;
+    total = elapsedUs();
+
+    auto line = [](const Entry &entry) {
+        return QStringLiteral("%1%2 at %3 ms: %4 ms")
+            .arg(QString(entry.depth * 2, QLatin1Char(' ')), entry.name)
+            .arg(entry.startUs / 1000.0, 0, 'f', 1)
+            .arg(entry.durationUs / 1000.0, 0, 'f', 1);
+    };
+    const QString summary = QStringLiteral("Startup: first frame after %1 ms (budget %2 ms)")
+                                .arg(total / 1000.0, 0, 'f', 1)
+                                .arg(BUDGET_MS);
+
+    if (qEnvironmentVariableIsSet("COUCHPLAY_STARTUP_TRACE")) {
+        qInfo().noquote() << summary;
+        for (const Entry &entry : std::as_const(s_entries)) {
+            qInfo().noquote() << line(entry);
+        }
+        return total;
+    }
+
+    if (total > BUDGET_MS * 1000) {
+        qCWarning(couchplayCore).noquote() << summary << "- set COUCHPLAY_STARTUP_TRACE=1 for details";
+    } else {
+        qCDebug(couchplayCore).noquote() << summary;
+    }
+    for (const Entry &entry : std::as_const(s_entries)) {
+        qCDebug(couchplayCore).noquote() << line(entry);
+    }
+    return total;
+}
+
+bool StartupTrace::finished()
+{
+    return s_finished;
+}
+
+QList<StartupTrace::Entry> StartupTrace::entries()
+{
+    return s_entries;
+}
@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QList>
+#include <QString>
+
+/**
+ * @brief Where the time before the first frame goes
+ *
+ * Managers open a Scope in their constructor (and around any other work
+ * done at startup); main() calls firstFrame() when the window is first
+ * shown, which logs each scope's offset and duration and the total.
+ * With COUCHPLAY_STARTUP_TRACE set the report is always printed; otherwise
+ * it goes to couchplay.core at debug level, plus a warning when the first
+ * frame missed BUDGET_MS.
+ *
+ * Scopes opened after the first frame are ignored. GUI thread only.
+ */
+class StartupTrace
+{
+public:
+    static constexpr qint64 BUDGET_MS = 300;
+
+    struct Entry {
+        QString name;
+        qint64 startUs = 0;     // Since the process started
+        qint64 durationUs = 0;
+        int depth = 0;          // Scopes opened inside other scopes
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *m_name;
+        qint64 m_startUs;
+        int m_index = -1;
+    };
+
+    /**
+     * @brief Log the report; later calls do nothing
+     * @return microseconds from process start to the first frame
+     */
+    static qint64 firstFrame();
+
+    static bool finished();
+    static QList<Entry> entries();
+
+    /**
+     * @brief Microseconds since the process started
+     */
+    static qint64 elapsedUs();
+};
@@ -3,8 +3,13 @@
 
 #include "SteamConfigManager.h"
 #include "Logging.h"
+#include "StartupTrace.h"
+#include "UserDirectory.h"
+#include "Vdf.h"
 #include "../dbus/CouchPlayHelperClient.h"
 
+#include <QDBusPendingCallWatcher>
+#include <QDBusUnixFileDescriptor>
 #include <QDataStream>
 #include <QDebug>
 #include <QDir>
@@ -22,6 +27,7 @@
 SteamConfigManager::SteamConfigManager(QObject *parent)
     : QObject(parent)
 {
+    StartupTrace::Scope trace("SteamConfigManager");
     // Get current user's home directory
     const char *home = getenv("HOME");
     if (home) {
@@ -67,6 +73,7 @@ void SteamConfigManager::setSyncShortcutsEnabled(bool enabled)
 
 void SteamConfigManager::detectSteamPaths()
 {
+    StartupTrace::Scope trace("SteamConfigManager::detectSteamPaths");
     m_steamPaths = SteamPaths();
     
     // Check common Steam locations
@@ -143,13 +150,13 @@ QString SteamConfigManager::getTargetSteamUserId(const QString &username) const
     // Fallback: try to read directly (will only work for current user)
     qDebug() << "SteamConfigManager: Helper not available, trying direct access for" << username;
     
-    struct passwd *pw = getpwnam(username.toLocal8Bit().constData());
-    if (!pw) {
+    const std::optional<UserEntry> user = UserDirectory::instance().user(username);
+    if (!user) {
         qWarning() << "SteamConfigManager: User not found:" << username;
         return QString();
     }
     
-    QString targetHome = QString::fromLocal8Bit(pw->pw_dir);
+    QString targetHome = user->home;
     
     // Check for Steam userdata in common locations
     QStringList possibleRoots = {
@@ -285,44 +292,125 @@ bool SteamConfigManager::syncShortcutsToUser(const QString &targetUsername)
 {
     qCDebug(couchplaySteam) << "syncShortcutsToUser called for" << targetUsername;
     
+    QVariant content;
+    QString targetVdf;
+    QString error;
+    if (!prepareShortcutsSync(targetUsername, content, targetVdf, error)) {
+        return false;
+    }
+    if (targetVdf.isEmpty()) {
+        return true;  // Not an error, just nothing to do
+    }
+    
+    // Write directly to target user via helper (avoids PrivateTmp issues)
+    bool success = content.userType() == qMetaTypeId<QDBusUnixFileDescriptor>()
+        ? m_helperClient->copyFileDescriptorToUser(content.value<QDBusUnixFileDescriptor>(), targetVdf,
+                                                   targetUsername).value(QStringLiteral("success")).toBool()
+        : m_helperClient->writeFileToUser(content.toByteArray(), targetVdf, targetUsername);
+    finishShortcutsSync(targetUsername, targetVdf, success);
+    return success;
+}
+
+QDBusPendingCall SteamConfigManager::syncShortcutsToUserAsync(const QString &targetUsername)
+{
+    qCDebug(couchplaySteam) << "syncShortcutsToUserAsync called for" << targetUsername;
+    
+    QVariant content;
+    QString targetVdf;
+    QString error;
+    if (!prepareShortcutsSync(targetUsername, content, targetVdf, error)) {
+        return QDBusPendingCall::fromError(QDBusError(QDBusError::Failed, error));
+    }
+    if (targetVdf.isEmpty()) {
+        return CouchPlayHelperClient::completedCall(true);
+    }
+    
+    const bool descriptor = content.userType() == qMetaTypeId<QDBusUnixFileDescriptor>();
+    QDBusPendingCall call = descriptor
+        ? QDBusPendingCall(m_helperClient->copyFileDescriptorToUserAsync(content.value<QDBusUnixFileDescriptor>(),
+                                                                        targetVdf, targetUsername))
+        : QDBusPendingCall(m_helperClient->writeFileToUserAsync(content.toByteArray(), targetVdf, targetUsername));
+    auto *watcher = new QDBusPendingCallWatcher(call, this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this,
+            [this, targetUsername, targetVdf, descriptor](QDBusPendingCallWatcher *finishedWatcher) {
+        finishedWatcher->deleteLater();
+        bool success = false;
+        if (descriptor) {
+            QDBusPendingReply<QVariantMap> result = *finishedWatcher;
+            success = !result.isError() && result.value().value(QStringLiteral("success")).toBool();
+        } else {
+            QDBusPendingReply<bool> result = *finishedWatcher;
+            success = !result.isError() && result.value();
+        }
+        finishShortcutsSync(targetUsername, targetVdf, success);
+    });
+    return call;
+}
+
+bool SteamConfigManager::prepareShortcutsSync(const QString &targetUsername, QVariant &content,
+                                              QString &targetVdf, QString &error)
+{
+    auto fail = [this, &targetUsername, &error](const QString &message) {
+        error = message;
+        Q_EMIT syncFailed(targetUsername, message);
+        return false;
+    };
+    
     if (!m_helperClient || !m_helperClient->isAvailable()) {
         qCWarning(couchplaySteam) << "syncShortcutsToUser failed - Helper not available";
-        Q_EMIT syncFailed(targetUsername, QStringLiteral("Helper not available"));
-        return false;
+        return fail(QStringLiteral("Helper not available"));
     }
     
     // Get source shortcuts.vdf path
     if (!m_steamPaths.valid || m_steamPaths.shortcutsVdf.isEmpty()) {
         qCWarning(couchplaySteam) << "syncShortcutsToUser failed - Steam not detected";
-        Q_EMIT syncFailed(targetUsername, QStringLiteral("Steam not detected"));
-        return false;
+        return fail(QStringLiteral("Steam not detected"));
     }
     
     QString sourceFile = m_steamPaths.shortcutsVdf;
     if (!QFile::exists(sourceFile)) {
         qCDebug(couchplaySteam) << "No shortcuts.vdf to sync";
-        return true;  // Not an error, just nothing to do
+        targetVdf.clear();
+        return true;
     }
     
     qCDebug(couchplaySteam) << "Source file:" << sourceFile;
     
+    VdfFile source(sourceFile);
+    if (!source.isOpen()) {
+        qCWarning(couchplaySteam) << "Failed to open source file:" << sourceFile;
+        return fail(QStringLiteral("Failed to open source shortcuts.vdf"));
+    }
+    const size_t sourceHash = qHashBits(source.data().data(), source.data().size());
+    
+    // Skip the helper entirely while neither side has changed since the last write
+    const auto synced = m_syncedShortcuts.constFind(targetUsername);
+    if (synced != m_syncedShortcuts.constEnd() && synced->sourceHash == sourceHash) {
+        ShortcutsSyncState current;
+        current.targetVdf = synced->targetVdf;
+        readTargetState(current);
+        if (current.targetSize == synced->targetSize && current.targetModified == synced->targetModified) {
+            qCDebug(couchplaySteam) << "shortcuts.vdf of" << targetUsername << "is up to date";
+            targetVdf.clear();
+            return true;
+        }
+    }
+    
     // Get target user's Steam ID
     QString targetSteamId = getTargetSteamUserId(targetUsername);
     if (targetSteamId.isEmpty()) {
         qCWarning(couchplaySteam) << "syncShortcutsToUser failed - Steam not set up for user" << targetUsername;
-        Q_EMIT syncFailed(targetUsername, QStringLiteral("Steam not set up for user (run Steam once first)"));
-        return false;
+        return fail(QStringLiteral("Steam not set up for user (run Steam once first)"));
     }
     qCDebug(couchplaySteam) << "Target Steam ID:" << targetSteamId;
     
     // Get target user's home
-    struct passwd *pw = getpwnam(targetUsername.toLocal8Bit().constData());
-    if (!pw) {
+    const std::optional<UserEntry> user = UserDirectory::instance().user(targetUsername);
+    if (!user) {
         qCWarning(couchplaySteam) << "syncShortcutsToUser failed - User not found:" << targetUsername;
-        Q_EMIT syncFailed(targetUsername, QStringLiteral("User not found"));
-        return false;
+        return fail(QStringLiteral("User not found"));
     }
-    QString targetHome = QString::fromLocal8Bit(pw->pw_dir);
+    QString targetHome = user->home;
     qCDebug(couchplaySteam) << "Target home:" << targetHome;
     
     // Target path uses TARGET user's Steam ID (not compositor's)
@@ -343,25 +431,34 @@ bool SteamConfigManager::syncShortcutsToUser(const QString &targetUsername)
     }
     
     QString targetConfigDir = targetSteamRoot + QStringLiteral("/userdata/") + targetSteamId + QStringLiteral("/config");
-    QString targetVdf = targetConfigDir + QStringLiteral("/shortcuts.vdf");
     
     // Direct byte copy - preserves exact Steam format including all end markers
-    // This is the preferred approach as it avoids any serialization differences
-    QFile sourceFileHandle(sourceFile);
-    if (!sourceFileHandle.open(QIODevice::ReadOnly)) {
-        qCWarning(couchplaySteam) << "Failed to open source file:" << sourceFile;
-        Q_EMIT syncFailed(targetUsername, QStringLiteral("Failed to open source shortcuts.vdf"));
-        return false;
+    // This is the preferred approach as it avoids any serialization differences.
+    // A sealed memfd keeps the bytes off the bus.
+    targetVdf = targetConfigDir + QStringLiteral("/shortcuts.vdf");
+    const QDBusUnixFileDescriptor descriptor = CouchPlayHelperClient::sealedFileDescriptor(source.data());
+    content = descriptor.isValid() ? QVariant::fromValue(descriptor) : QVariant(source.data().toByteArray());
+    
+    ShortcutsSyncState pending;
+    pending.sourceHash = sourceHash;
+    pending.targetVdf = targetVdf;
+    m_pendingShortcuts.insert(targetUsername, pending);
+    
+    qCDebug(couchplaySteam) << "Syncing" << source.data().size() << "bytes from source"
+                            << (descriptor.isValid() ? "via memfd" : "inline") << "to" << targetVdf;
+    return true;
+}
+
+void SteamConfigManager::finishShortcutsSync(const QString &targetUsername, const QString &targetVdf, bool success)
+{
+    ShortcutsSyncState state = m_pendingShortcuts.take(targetUsername);
+    if (success && state.targetVdf == targetVdf) {
+        readTargetState(state);
+        m_syncedShortcuts.insert(targetUsername, state);
+    } else {
+        m_syncedShortcuts.remove(targetUsername);
     }
-    
-    QByteArray vdfData = sourceFileHandle.readAll();
-    sourceFileHandle.close();
-    
-    qCDebug(couchplaySteam) << "Read" << vdfData.size() << "bytes from source, writing directly to" << targetVdf;
-    
-    // Write directly to target user via helper (avoids PrivateTmp issues)
-    bool success = m_helperClient->writeFileToUser(vdfData, targetVdf, targetUsername);
-    
+
     if (success) {
         qCDebug(couchplaySteam) << "Synced shortcuts to" << targetUsername;
         Q_EMIT syncCompleted(targetUsername);
@@ -369,8 +466,15 @@ bool SteamConfigManager::syncShortcutsToUser(const QString &targetUsername)
         qCWarning(couchplaySteam) << "syncShortcutsToUser failed - Failed to write shortcuts.vdf to" << targetVdf;
         Q_EMIT syncFailed(targetUsername, QStringLiteral("Failed to write shortcuts.vdf"));
     }
-    
-    return success;
+}
+
+void SteamConfigManager::readTargetState(ShortcutsSyncState &state)
+{
+    // Player homes are often not searchable by the compositor user; the
+    // source hash alone then decides
+    const QFileInfo info(state.targetVdf);
+    state.targetSize = info.exists() ? info.size() : -1;
+    state.targetModified = info.exists() ? info.lastModified() : QDateTime();
 }
 
 // Get target Steam paths for a user (uses target user's Steam ID)
@@ -379,13 +483,13 @@ SteamPaths SteamConfigManager::getTargetSteamPaths(const QString &username) cons
     SteamPaths paths;
     
     // Get target user's home directory
-    struct passwd *pw = getpwnam(username.toLocal8Bit().constData());
-    if (!pw) {
+    const std::optional<UserEntry> user = UserDirectory::instance().user(username);
+    if (!user) {
         qWarning() << "SteamConfigManager: User not found:" << username;
         return paths;
     }
     
-    QString targetHome = QString::fromLocal8Bit(pw->pw_dir);
+    QString targetHome = user->home;
     
     // Check for Steam in common locations relative to target home
     QStringList possibleRoots = {
@@ -437,163 +541,143 @@ SteamPaths SteamConfigManager::getTargetSteamPaths(const QString &username) cons
 // Binary VDF Parsing
 // ============================================================================
 
-// Binary VDF type markers
-constexpr char VDF_TYPE_OBJECT = 0x00;
-constexpr char VDF_TYPE_STRING = 0x01;
-constexpr char VDF_TYPE_INT32 = 0x02;
-constexpr char VDF_TYPE_END = 0x08;
-
 QList<SteamShortcut> SteamConfigManager::parseShortcutsVdf(const QString &path)
 {
-    QList<SteamShortcut> result;
-    
-    QFile file(path);
-    if (!file.open(QIODevice::ReadOnly)) {
+    VdfFile file(path);
+    if (!file.isOpen()) {
         qWarning() << "SteamConfigManager: Failed to open" << path;
-        return result;
+        return {};
     }
-    
-    QByteArray data = file.readAll();
-    file.close();
-    
+    return parseShortcuts(file.data());
+}
+
+QList<SteamShortcut> SteamConfigManager::parseShortcuts(QByteArrayView data)
+{
+    QList<SteamShortcut> result;
     if (data.isEmpty()) {
         return result;
     }
-    
-    // Parse binary VDF
-    int pos = 0;
-    
-    // Read root object marker and "shortcuts" key
-    if (pos >= data.size() || data[pos] != VDF_TYPE_OBJECT) {
+
+    BinaryVdfReader reader(data);
+
+    // Root object: "shortcuts", holding one object per shortcut ("0", "1", ...)
+    if (!reader.next() || reader.type() != BinaryVdfReader::Object) {
         qWarning() << "SteamConfigManager: Invalid VDF format - expected object marker";
         return result;
     }
-    pos++;
-    
-    // Read "shortcuts" string
-    QString rootKey;
-    while (pos < data.size() && data[pos] != '\0') {
-        rootKey += QChar::fromLatin1(data[pos]);
-        pos++;
-    }
-    pos++;  // Skip null terminator
-    
-    if (rootKey != QStringLiteral("shortcuts")) {
-        qWarning() << "SteamConfigManager: Unexpected root key:" << rootKey;
+    if (reader.key() != "shortcuts") {
+        qWarning() << "SteamConfigManager: Unexpected root key:" << reader.key();
         return result;
     }
-    
-    // Now parse each shortcut (numbered 0, 1, 2, ...)
-    while (pos < data.size()) {
-        if (data[pos] == VDF_TYPE_END) {
-            break;  // End of shortcuts object
-        }
-        
-        if (data[pos] != VDF_TYPE_OBJECT) {
-            break;  // Unexpected type
-        }
-        pos++;
-        
-        // Read shortcut index key
-        QString indexKey;
-        while (pos < data.size() && data[pos] != '\0') {
-            indexKey += QChar::fromLatin1(data[pos]);
-            pos++;
-        }
-        pos++;  // Skip null terminator
-        
+
+    auto is = [&reader](const char *name) {
+        return reader.key().compare(name, Qt::CaseInsensitive) == 0;
+    };
+
+    while (reader.next() && reader.type() == BinaryVdfReader::Object) {
         SteamShortcut shortcut;
-        
+
         // Parse shortcut properties
-        while (pos < data.size()) {
-            char type = data[pos];
-            if (type == VDF_TYPE_END) {
-                pos++;
-                break;  // End of this shortcut
-            }
-            pos++;
-            
-            // Read key
-            QString key;
-            while (pos < data.size() && data[pos] != '\0') {
-                key += QChar::fromLatin1(data[pos]);
-                pos++;
-            }
-            pos++;  // Skip null terminator
-            
-            if (type == VDF_TYPE_STRING) {
-                QString value;
-                while (pos < data.size() && data[pos] != '\0') {
-                    value += QChar::fromLatin1(data[pos]);
-                    pos++;
-                }
-                pos++;  // Skip null terminator
-                
-                if (key == QStringLiteral("AppName")) {
+        while (reader.next() && reader.type() != BinaryVdfReader::End) {
+            if (reader.type() == BinaryVdfReader::String) {
+                const QString value = QString::fromUtf8(reader.value());
+                if (is("AppName")) {
                     shortcut.appName = value;
-                } else if (key == QStringLiteral("exe") || key == QStringLiteral("Exe")) {
+                } else if (is("exe")) {
                     shortcut.exe = value;
-                } else if (key == QStringLiteral("StartDir")) {
+                } else if (is("StartDir")) {
                     shortcut.startDir = value;
-                } else if (key == QStringLiteral("icon")) {
+                } else if (is("icon")) {
                     shortcut.icon = value;
-                } else if (key == QStringLiteral("ShortcutPath")) {
+                } else if (is("ShortcutPath")) {
                     shortcut.shortcutPath = value;
-                } else if (key == QStringLiteral("LaunchOptions")) {
+                } else if (is("LaunchOptions")) {
                     shortcut.launchOptions = value;
-                } else if (key == QStringLiteral("DevkitGameID")) {
+                } else if (is("DevkitGameID")) {
                     shortcut.devkitGameId = value;
-                } else if (key == QStringLiteral("FlatpakAppID")) {
+                } else if (is("FlatpakAppID")) {
                     shortcut.flatpakAppId = value;
-                } else if (key == QStringLiteral("sortas")) {
+                } else if (is("sortas")) {
                     shortcut.sortAs = value;
                 }
-            } else if (type == VDF_TYPE_INT32) {
-                if (pos + 4 > data.size()) break;
-                quint32 value = 0;
-                value |= static_cast<quint8>(data[pos++]);
-                value |= static_cast<quint8>(data[pos++]) << 8;
-                value |= static_cast<quint8>(data[pos++]) << 16;
-                value |= static_cast<quint8>(data[pos++]) << 24;
-                
-                if (key == QStringLiteral("appid") || key == QStringLiteral("AppId")) {
+            } else if (reader.type() == BinaryVdfReader::Int32) {
+                const quint32 value = reader.int32Value();
+                if (is("appid")) {
                     shortcut.appId = value;
-                } else if (key == QStringLiteral("IsHidden")) {
+                } else if (is("IsHidden")) {
                     shortcut.isHidden = (value != 0);
-                } else if (key == QStringLiteral("AllowDesktopConfig")) {
+                } else if (is("AllowDesktopConfig")) {
                     shortcut.allowDesktopConfig = (value != 0);
-                } else if (key == QStringLiteral("AllowOverlay")) {
+                } else if (is("AllowOverlay")) {
                     shortcut.allowOverlay = (value != 0);
-                } else if (key == QStringLiteral("OpenVR")) {
+                } else if (is("OpenVR")) {
                     shortcut.openVR = (value != 0);
-                } else if (key == QStringLiteral("Devkit")) {
+                } else if (is("Devkit")) {
                     shortcut.devkit = (value != 0);
-                } else if (key == QStringLiteral("DevkitOverrideAppID")) {
+                } else if (is("DevkitOverrideAppID")) {
                     shortcut.devkitOverrideAppId = value;
-                } else if (key == QStringLiteral("LastPlayTime")) {
+                } else if (is("LastPlayTime")) {
                     shortcut.lastPlayTime = value;
                 }
-            } else if (type == VDF_TYPE_OBJECT) {
-                // Handle nested objects like "tags"
-                if (key == QStringLiteral("tags")) {
-                    // Skip tags for now - just consume until end marker
-                    while (pos < data.size() && data[pos] != VDF_TYPE_END) {
-                        // Skip type marker
-                        pos++;
-                        // Skip key
-                        while (pos < data.size() && data[pos] != '\0') pos++;
-                        pos++;
-                        // Skip value based on type (assume string)
-                        while (pos < data.size() && data[pos] != '\0') pos++;
-                        pos++;
+            } else if (reader.type() == BinaryVdfReader::Object) {
+                if (is("tags")) {
+                    while (reader.next() && reader.type() != BinaryVdfReader::End) {
+                        if (reader.type() == BinaryVdfReader::String) {
+                            shortcut.tags.append(QString::fromUtf8(reader.value()));
+                        } else if (reader.type() == BinaryVdfReader::Object) {
+                            reader.skipObject();
+                        }
                     }
-                    if (pos < data.size()) pos++;  // Skip end marker
+                } else {
+                    reader.skipObject();
                 }
             }
         }
-        
+        if (reader.hasError()) {
+            break;
+        }
+
         result.append(shortcut);
     }
-    
+
+    if (reader.hasError()) {
+        qWarning() << "SteamConfigManager: Truncated or malformed shortcuts.vdf, read" << result.size() << "shortcuts";
+    }
     return result;
 }
+
+QByteArray SteamConfigManager::serializeShortcuts(const QList<SteamShortcut> &shortcuts)
+{
+    BinaryVdfWriter writer;
+    writer.beginObject("shortcuts");
+    for (qsizetype i = 0; i < shortcuts.size(); ++i) {
+        const SteamShortcut &shortcut = shortcuts.at(i);
+        writer.beginObject(QByteArray::number(i));
+        writer.writeInt32("appid", shortcut.appId);
+        writer.writeString("AppName", shortcut.appName.toUtf8());
+        writer.writeString("Exe", shortcut.exe.toUtf8());
+        writer.writeString("StartDir", shortcut.startDir.toUtf8());
+        writer.writeString("icon", shortcut.icon.toUtf8());
+        writer.writeString("ShortcutPath", shortcut.shortcutPath.toUtf8());
+        writer.writeString("LaunchOptions", shortcut.launchOptions.toUtf8());
+        writer.writeInt32("IsHidden", shortcut.isHidden);
+        writer.writeInt32("AllowDesktopConfig", shortcut.allowDesktopConfig);
+        writer.writeInt32("AllowOverlay", shortcut.allowOverlay);
+        writer.writeInt32("OpenVR", shortcut.openVR);
+        writer.writeInt32("Devkit", shortcut.devkit);
+        writer.writeString("DevkitGameID", shortcut.devkitGameId.toUtf8());
+        writer.writeInt32("DevkitOverrideAppID", shortcut.devkitOverrideAppId);
+        writer.writeInt32("LastPlayTime", shortcut.lastPlayTime);
+        writer.writeString("FlatpakAppID", shortcut.flatpakAppId.toUtf8());
+        writer.writeString("sortas", shortcut.sortAs.toUtf8());
+        writer.beginObject("tags");
+        for (qsizetype tag = 0; tag < shortcut.tags.size(); ++tag) {
+            writer.writeString(QByteArray::number(tag), shortcut.tags.at(tag).toUtf8());
+        }
+        writer.endObject();
+        writer.endObject();
+    }
+    writer.endObject();
+    writer.endObject();  // Closes the file
+    return writer.data();
+}
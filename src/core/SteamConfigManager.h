@@ -3,6 +3,10 @@
 
 #pragma once
 
+#include <QByteArrayView>
+#include <QDBusPendingReply>
+#include <QDateTime>
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QStringList>
@@ -166,6 +170,52 @@ public:
      */
     bool syncShortcutsToUser(const QString &targetUsername);
 
+    /**
+     * Non-blocking variant of syncShortcutsToUser()
+     * The file write is sent to the helper without waiting for the reply;
+     * syncCompleted()/syncFailed() are emitted once it finishes.
+     * 
+     * @param targetUsername Username to sync to
+     * @return Pending call, already finished when there is nothing to write
+     */
+    QDBusPendingCall syncShortcutsToUserAsync(const QString &targetUsername);
+
+    /**
+     * Resolve what a shortcut sync would write, without writing it
+     * Lets callers batch the write with other helper work. Emits
+     * syncFailed() when the sync cannot happen.
+     * 
+     * Nothing is written when the source is unchanged since the last
+     * successful sync to this user and the target still looks as that sync
+     * left it (same size and mtime, where it is visible to us).
+     * 
+     * @param targetUsername Username to sync to
+     * @param content Receives the shortcuts.vdf content: a sealed memfd as a
+     *        QDBusUnixFileDescriptor, or the bytes if no descriptor can be passed
+     * @param targetVdf Receives the target path, empty when there is nothing to sync
+     * @param error Receives the failure reason
+     * @return false if the sync cannot happen
+     */
+    bool prepareShortcutsSync(const QString &targetUsername, QVariant &content,
+                              QString &targetVdf, QString &error);
+
+    /**
+     * Report the outcome of a write prepared with prepareShortcutsSync()
+     * Emits syncCompleted() or syncFailed().
+     */
+    void finishShortcutsSync(const QString &targetUsername, const QString &targetVdf, bool success);
+
+    /**
+     * Parse the binary contents of a shortcuts.vdf
+     * Unknown fields are skipped; a truncated file yields the shortcuts before the damage.
+     */
+    static QList<SteamShortcut> parseShortcuts(QByteArrayView data);
+
+    /**
+     * Binary shortcuts.vdf contents for @p shortcuts, as Steam writes them
+     */
+    static QByteArray serializeShortcuts(const QList<SteamShortcut> &shortcuts);
+
 Q_SIGNALS:
     void steamPathsChanged();
     void shortcutsLoaded();
@@ -181,10 +231,21 @@ private:
     
     // Get target Steam paths for a user
     SteamPaths getTargetSteamPaths(const QString &username) const;
+
+    // A shortcuts.vdf written to a user, see prepareShortcutsSync()
+    struct ShortcutsSyncState {
+        size_t sourceHash = 0;
+        QString targetVdf;
+        qint64 targetSize = -1;       // -1 when the target isn't visible to us
+        QDateTime targetModified;
+    };
+    static void readTargetState(ShortcutsSyncState &state);
     
     CouchPlayHelperClient *m_helperClient = nullptr;
     SteamPaths m_steamPaths;
     QList<SteamShortcut> m_shortcuts;
     QString m_userHome;
     bool m_syncShortcutsEnabled = false;
+    QHash<QString, ShortcutsSyncState> m_syncedShortcuts;   // By target user, last successful write
+    QHash<QString, ShortcutsSyncState> m_pendingShortcuts;  // Prepared writes awaiting finishShortcutsSync()
 };
@@ -0,0 +1,284 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "UserDirectory.h"
+
+#include <QFile>
+#include <QMutexLocker>
+
+#include <cerrno>
+#include <climits>
+#include <grp.h>
+#include <pwd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <vector>
+
+namespace {
+
+// Size hint for the *_r buffers when sysconf() has none
+constexpr long kDefaultBufferSize = 16384;
+
+long bufferSize(int name)
+{
+    const long size = sysconf(name);
+    return size > 0 ? size : kDefaultBufferSize;
+}
+
+UserEntry toEntry(const passwd *pw)
+{
+    UserEntry entry;
+    entry.name = QString::fromLocal8Bit(pw->pw_name);
+    entry.uid = pw->pw_uid;
+    entry.gid = pw->pw_gid;
+    entry.home = QFile::decodeName(pw->pw_dir);
+    entry.shell = QFile::decodeName(pw->pw_shell);
+    entry.gecos = QString::fromLocal8Bit(pw->pw_gecos);
+
+    int count = 32;
+    std::vector<gid_t> groups(count);
+    if (getgrouplist(pw->pw_name, pw->pw_gid, groups.data(), &count) < 0) {
+        // count now holds the real number
+        groups.resize(count);
+        if (getgrouplist(pw->pw_name, pw->pw_gid, groups.data(), &count) < 0) {
+            count = 0;
+        }
+    }
+    entry.groups.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        entry.groups.append(groups[i]);
+    }
+    if (!entry.groups.contains(pw->pw_gid)) {
+        entry.groups.prepend(pw->pw_gid);
+    }
+    return entry;
+}
+
+// The *_r calls report ERANGE until the buffer is large enough
+template<typename Lookup>
+std::optional<UserEntry> lookupUser(Lookup lookup)
+{
+    std::vector<char> buffer(bufferSize(_SC_GETPW_R_SIZE_MAX));
+    passwd pw = {};
+    passwd *result = nullptr;
+    int rc;
+    while ((rc = lookup(&pw, buffer.data(), buffer.size(), &result)) == ERANGE && buffer.size() < (1 << 20)) {
+        buffer.resize(buffer.size() * 2);
+    }
+    if (rc != 0 || !result) {
+        return std::nullopt;
+    }
+    return toEntry(result);
+}
+
+std::optional<GroupEntry> lookupGroup(const QString &name)
+{
+    const QByteArray encoded = name.toLocal8Bit();
+    std::vector<char> buffer(bufferSize(_SC_GETGR_R_SIZE_MAX));
+    group gr = {};
+    group *result = nullptr;
+    int rc;
+    while ((rc = getgrnam_r(encoded.constData(), &gr, buffer.data(), buffer.size(), &result)) == ERANGE
+           && buffer.size() < (1 << 20)) {
+        buffer.resize(buffer.size() * 2);
+    }
+    if (rc != 0 || !result) {
+        return std::nullopt;
+    }
+
+    GroupEntry entry;
+    entry.name = QString::fromLocal8Bit(result->gr_name);
+    entry.gid = result->gr_gid;
+    for (char **member = result->gr_mem; member && *member; ++member) {
+        entry.members.append(QString::fromLocal8Bit(*member));
+    }
+
+    // Members by primary group aren't listed in gr_mem. Only local
+    // accounts are walked; enumerating a directory server is too slow.
+    QFile passwdFile(QStringLiteral("/etc/passwd"));
+    if (passwdFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QByteArray gid = QByteArray::number(entry.gid);
+        while (!passwdFile.atEnd()) {
+            const QList<QByteArray> fields = passwdFile.readLine().split(':');
+            if (fields.size() >= 4 && fields[3] == gid) {
+                const QString user = QString::fromLocal8Bit(fields[0]);
+                if (!entry.members.contains(user)) {
+                    entry.members.append(user);
+                }
+            }
+        }
+    }
+    return entry;
+}
+
+} // namespace
+
+UserDirectory::Backend UserDirectory::systemBackend()
+{
+    Backend backend;
+    backend.userByName = [](const QString &name) {
+        const QByteArray encoded = name.toLocal8Bit();
+        return lookupUser([&encoded](passwd *pw, char *buffer, size_t size, passwd **result) {
+            return getpwnam_r(encoded.constData(), pw, buffer, size, result);
+        });
+    };
+    backend.userByUid = [](uid_t uid) {
+        return lookupUser([uid](passwd *pw, char *buffer, size_t size, passwd **result) {
+            return getpwuid_r(uid, pw, buffer, size, result);
+        });
+    };
+    backend.group = &lookupGroup;
+    return backend;
+}
+
+UserDirectory &UserDirectory::instance()
+{
+    static UserDirectory directory;
+    return directory;
+}
+
+UserDirectory::UserDirectory(const QString &watchDirectory, Backend backend)
+    : m_backend(std::move(backend))
+{
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd >= 0) {
+        // shadow-utils writes passwd.+ and renames it over, so watch the directory
+        const QByteArray path = QFile::encodeName(watchDirectory);
+        if (inotify_add_watch(m_inotifyFd, path.constData(),
+                              IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0) {
+            ::close(m_inotifyFd);
+            m_inotifyFd = -1;
+        }
+    }
+    // Without a watch, the TTL alone bounds staleness
+}
+
+UserDirectory::~UserDirectory()
+{
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+    }
+}
+
+void UserDirectory::checkForChanges()
+{
+    if (m_inotifyFd < 0) {
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+    ssize_t length;
+    while ((length = ::read(m_inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char *p = buffer; p < buffer + length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(p);
+            if (event->len > 0) {
+                const char *name = event->name;
+                if (qstrcmp(name, "passwd") == 0 || qstrcmp(name, "group") == 0) {
+                    changed = true;
+                }
+            }
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    if (changed) {
+        m_usersByName.clear();
+        m_usersByUid.clear();
+        m_groups.clear();
+    }
+}
+
+void UserDirectory::storeUser(const QString &name, const std::optional<UserEntry> &entry)
+{
+    const QDeadlineTimer expiry(m_ttl);
+    m_usersByName.insert(name, {entry, expiry});
+    if (entry) {
+        m_usersByName.insert(entry->name, {entry, expiry});
+        m_usersByUid.insert(entry->uid, {entry, expiry});
+    }
+}
+
+std::optional<UserEntry> UserDirectory::user(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    checkForChanges();
+    auto it = m_usersByName.constFind(name);
+    if (it != m_usersByName.constEnd() && !it->expiry.hasExpired()) {
+        return it->value;
+    }
+    locker.unlock();
+
+    // NSS may block; don't hold up other threads meanwhile
+    std::optional<UserEntry> entry = m_backend.userByName ? m_backend.userByName(name) : std::nullopt;
+
+    locker.relock();
+    storeUser(name, entry);
+    return entry;
+}
+
+std::optional<UserEntry> UserDirectory::user(uid_t uid)
+{
+    QMutexLocker locker(&m_mutex);
+    checkForChanges();
+    auto it = m_usersByUid.constFind(uid);
+    if (it != m_usersByUid.constEnd() && !it->expiry.hasExpired()) {
+        return it->value;
+    }
+    locker.unlock();
+
+    std::optional<UserEntry> entry = m_backend.userByUid ? m_backend.userByUid(uid) : std::nullopt;
+
+    locker.relock();
+    if (entry) {
+        storeUser(entry->name, entry);
+    } else {
+        m_usersByUid.insert(uid, {std::nullopt, QDeadlineTimer(m_ttl)});
+    }
+    return entry;
+}
+
+std::optional<GroupEntry> UserDirectory::group(const QString &name)
+{
+    QMutexLocker locker(&m_mutex);
+    checkForChanges();
+    auto it = m_groups.constFind(name);
+    if (it != m_groups.constEnd() && !it->expiry.hasExpired()) {
+        return it->value;
+    }
+    locker.unlock();
+
+    std::optional<GroupEntry> entry = m_backend.group ? m_backend.group(name) : std::nullopt;
+
+    locker.relock();
+    m_groups.insert(name, {entry, QDeadlineTimer(m_ttl)});
+    return entry;
+}
+
+bool UserDirectory::isInGroup(const QString &user, const QString &group)
+{
+    const std::optional<GroupEntry> groupEntry = this->group(group);
+    if (!groupEntry) {
+        return false;
+    }
+    if (groupEntry->members.contains(user)) {
+        return true;
+    }
+    const std::optional<UserEntry> userEntry = this->user(user);
+    return userEntry && userEntry->groups.contains(groupEntry->gid);
+}
+
+void UserDirectory::setTimeToLive(int msecs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_ttl = msecs;
+}
+
+void UserDirectory::invalidate()
+{
+    QMutexLocker locker(&m_mutex);
+    m_usersByName.clear();
+    m_usersByUid.clear();
+    m_groups.clear();
+}
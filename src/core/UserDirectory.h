@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <optional>
+
+#include <sys/types.h>
+
+/**
+ * @brief One passwd entry together with the groups the user is in
+ */
+struct UserEntry {
+    QString name;
+    uid_t uid = 0;
+    gid_t gid = 0;
+    QString home;
+    QString shell;
+    QString gecos;
+    QList<gid_t> groups;  // Primary and supplementary GIDs (getgrouplist)
+};
+
+/**
+ * @brief One group entry; members include users with it as primary group
+ */
+struct GroupEntry {
+    QString name;
+    gid_t gid = 0;
+    QStringList members;
+};
+
+/**
+ * @brief Cached passwd/group lookups shared by the app and the helper
+ *
+ * With SSSD or LDAP behind NSS every getpwnam() can be a network round
+ * trip, and a session start used to make several per player. Entries,
+ * misses included, are kept by name and UID until their TTL runs out.
+ * An inotify watch on /etc drops everything as soon as passwd or group
+ * is rewritten, so local changes (useradd, usermod -aG) show up at once.
+ *
+ * Only QtCore; safe to use from any thread. The watch is checked on
+ * each lookup, so no event loop is needed.
+ */
+class UserDirectory
+{
+public:
+    /**
+     * @brief Where entries come from; the default is NSS
+     */
+    struct Backend {
+        std::function<std::optional<UserEntry>(const QString &name)> userByName;
+        std::function<std::optional<UserEntry>(uid_t uid)> userByUid;
+        std::function<std::optional<GroupEntry>(const QString &name)> group;
+    };
+
+    static Backend systemBackend();
+
+    /**
+     * @brief The process-wide directory on NSS, watching /etc
+     */
+    static UserDirectory &instance();
+
+    explicit UserDirectory(const QString &watchDirectory = QStringLiteral("/etc"),
+                           Backend backend = systemBackend());
+    ~UserDirectory();
+
+    UserDirectory(const UserDirectory &) = delete;
+    UserDirectory &operator=(const UserDirectory &) = delete;
+
+    std::optional<UserEntry> user(const QString &name);
+    std::optional<UserEntry> user(uid_t uid);
+    std::optional<GroupEntry> group(const QString &name);
+
+    /**
+     * @brief Whether @p user is in @p group, as primary or supplementary group
+     */
+    bool isInGroup(const QString &user, const QString &group);
+
+    /**
+     * @brief How long entries are trusted without a change to /etc (default 60 s)
+     */
+    void setTimeToLive(int msecs);
+
+    void invalidate();
+
+private:
+    template<typename T>
+    struct Cached {
+        std::optional<T> value;
+        QDeadlineTimer expiry;
+    };
+
+    // Drops the cache if passwd or group changed; m_mutex held
+    void checkForChanges();
+    void storeUser(const QString &name, const std::optional<UserEntry> &entry);
+
+    Backend m_backend;
+    int m_inotifyFd = -1;
+    int m_ttl = 60000;
+
+    QMutex m_mutex;
+    QHash<QString, Cached<UserEntry>> m_usersByName;
+    QHash<uid_t, Cached<UserEntry>> m_usersByUid;
+    QHash<QString, Cached<GroupEntry>> m_groups;
+};
@@ -2,28 +2,30 @@
 // SPDX-FileCopyrightText: 2024 hikaps
 
 #include "UserManager.h"
+#include "StartupTrace.h"
+#include "UserDirectory.h"
 #include "../dbus/CouchPlayHelperClient.h"
 
-#include <QFile>
-#include <QTextStream>
 #include <QRegularExpression>
 #include <QDebug>
 #include <QDir>
 
+#include <algorithm>
+
 #include <unistd.h>
-#include <pwd.h>
-#include <grp.h>
 
 // Name of the couchplay group for managed users
 static const QString COUCHPLAY_GROUP = QStringLiteral("couchplay");
+// Ephemeral players, see CouchPlayHelper::CreateEphemeralUser()
+static const QString GUEST_GROUP = QStringLiteral("couchplay-guest");
 
 UserManager::UserManager(QObject *parent)
     : QObject(parent)
 {
+    StartupTrace::Scope trace("UserManager");
     // Get current user
-    struct passwd *pw = getpwuid(getuid());
-    if (pw) {
-        m_currentUser = QString::fromLocal8Bit(pw->pw_name);
+    if (const std::optional<UserEntry> entry = UserDirectory::instance().user(getuid())) {
+        m_currentUser = entry->name;
     }
 
     refresh();
@@ -33,7 +35,17 @@ UserManager::~UserManager() = default;
 
 void UserManager::setHelperClient(CouchPlayHelperClient *client)
 {
+    if (m_helperClient) {
+        disconnect(m_helperClient, nullptr, this, nullptr);
+    }
     m_helperClient = client;
+    if (m_helperClient) {
+        connect(m_helperClient, &CouchPlayHelperClient::userDeletionFinished,
+                this, &UserManager::onUserDeletionFinished);
+        connect(m_helperClient, &CouchPlayHelperClient::availabilityChanged,
+                this, &UserManager::templateChanged);
+    }
+    Q_EMIT templateChanged();
 }
 
 void UserManager::setHelper(QObject *helper)
@@ -43,6 +55,8 @@ void UserManager::setHelper(QObject *helper)
 
 void UserManager::refresh()
 {
+    // An explicit refresh shouldn't wait out the cache TTL
+    UserDirectory::instance().invalidate();
     m_users.clear();
     parseUsers();
     Q_EMIT usersChanged();
@@ -50,100 +64,71 @@ void UserManager::refresh()
 
 QSet<QString> UserManager::getCouchPlayGroupMembers() const
 {
-    QSet<QString> members;
-    
-    struct group *grp = getgrnam(COUCHPLAY_GROUP.toLocal8Bit().constData());
-    if (!grp) {
-        return members;  // Group doesn't exist yet
-    }
-
-    // Get all members from the group
-    for (char **member = grp->gr_mem; *member != nullptr; ++member) {
-        members.insert(QString::fromLocal8Bit(*member));
-    }
-
-    // Also check for users with couchplay as primary group
-    QFile file(QStringLiteral("/etc/passwd"));
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QTextStream stream(&file);
-        while (!stream.atEnd()) {
-            QString line = stream.readLine();
-            QStringList parts = line.split(QLatin1Char(':'));
-            if (parts.size() >= 4) {
-                int userGid = parts[3].toInt();
-                if (static_cast<gid_t>(userGid) == grp->gr_gid) {
-                    members.insert(parts[0]);
-                }
-            }
-        }
-        file.close();
+    // Includes users with couchplay as their primary group
+    const std::optional<GroupEntry> group = UserDirectory::instance().group(COUCHPLAY_GROUP);
+    if (!group) {
+        return {};  // Group doesn't exist yet
     }
+    return QSet<QString>(group->members.cbegin(), group->members.cend());
+}
 
-    return members;
+QSet<QString> UserManager::guestUsers()
+{
+    const std::optional<GroupEntry> group = UserDirectory::instance().group(GUEST_GROUP);
+    if (!group) {
+        return {};
+    }
+    return QSet<QString>(group->members.cbegin(), group->members.cend());
 }
 
 void UserManager::parseUsers()
 {
     // Get couchplay group members
     QSet<QString> couchplayMembers = getCouchPlayGroupMembers();
-    
-    QFile file(QStringLiteral("/etc/passwd"));
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        Q_EMIT errorOccurred(QStringLiteral("Failed to read /etc/passwd"));
-        return;
-    }
-
-    QTextStream stream(&file);
-
-    while (!stream.atEnd()) {
-        QString line = stream.readLine();
-        QStringList parts = line.split(QLatin1Char(':'));
-
-        if (parts.size() < 7) {
-            continue;
-        }
-
-        QString username = parts[0];
-        int uid = parts[2].toInt();
-        QString homeDir = parts[5];
-        QString shell = parts[6];
+    const QSet<QString> guests = guestUsers();
 
+    // Members come from NSS, so directory accounts show up too
+    for (const QString &username : std::as_const(couchplayMembers)) {
         // Skip current user - they run the app, not available for assignment
         if (username == m_currentUser) {
             continue;
         }
 
-        // Only include users in the couchplay group
-        if (!couchplayMembers.contains(username)) {
+        const std::optional<UserEntry> entry = UserDirectory::instance().user(username);
+        if (!entry) {
             continue;
         }
 
         // Filter: only regular users (UID >= 1000 and < 65534)
-        if (uid < 1000 || uid >= 65534) {
+        if (entry->uid < 1000 || entry->uid >= 65534) {
             continue;
         }
 
         // Check for valid login shell (not nologin or false)
-        if (shell.contains(QStringLiteral("nologin")) || 
-            shell.contains(QStringLiteral("false"))) {
+        if (entry->shell.contains(QStringLiteral("nologin")) ||
+            entry->shell.contains(QStringLiteral("false"))) {
             continue;
         }
 
         // Check if home directory exists
-        if (!QDir(homeDir).exists()) {
+        if (!QDir(entry->home).exists()) {
             continue;
         }
 
         UserInfo user;
         user.username = username;
-        user.uid = uid;
-        user.homeDir = homeDir;
-        user.shell = shell;
+        user.uid = static_cast<int>(entry->uid);
+        user.homeDir = entry->home;
+        user.shell = entry->shell;
+        user.ephemeral = guests.contains(username);
 
         m_users.append(user);
     }
 
-    file.close();
+    // Group order is arbitrary; keep the list stable
+    std::sort(m_users.begin(), m_users.end(), [](const UserInfo &a, const UserInfo &b) {
+        return a.uid < b.uid;
+    });
 }
 
 QVariantList UserManager::usersAsVariant() const
@@ -155,6 +140,7 @@ QVariantList UserManager::usersAsVariant() const
         map[QStringLiteral("username")] = user.username;
         map[QStringLiteral("uid")] = user.uid;
         map[QStringLiteral("homeDir")] = user.homeDir;
+        map[QStringLiteral("ephemeral")] = user.ephemeral;
         // isCurrent is always false since we filter out current user
         map[QStringLiteral("isCurrent")] = false;
         list.append(map);
@@ -189,6 +175,51 @@ bool UserManager::createUser(const QString &username)
     return false;
 }
 
+bool UserManager::createEphemeralUser(const QString &username)
+{
+    if (!isValidUsername(username)) {
+        Q_EMIT errorOccurred(QStringLiteral("Invalid username"));
+        return false;
+    }
+
+    if (userExists(username)) {
+        Q_EMIT errorOccurred(QStringLiteral("User already exists"));
+        return false;
+    }
+
+    if (!m_helperClient || !m_helperClient->isAvailable()) {
+        Q_EMIT errorOccurred(QStringLiteral("Helper service not available. Please run install-helper.sh"));
+        return false;
+    }
+
+    if (m_helperClient->createEphemeralUser(username)) {
+        refresh();
+        Q_EMIT userCreated(username);
+        return true;
+    }
+
+    return false;
+}
+
+bool UserManager::saveTemplate(const QString &username)
+{
+    if (!m_helperClient || !m_helperClient->isAvailable()) {
+        Q_EMIT errorOccurred(QStringLiteral("Helper service not available"));
+        return false;
+    }
+
+    if (m_helperClient->saveUserTemplate(username)) {
+        Q_EMIT templateChanged();
+        return true;
+    }
+    return false;
+}
+
+bool UserManager::hasTemplate() const
+{
+    return m_helperClient && m_helperClient->hasUserTemplate();
+}
+
 bool UserManager::deleteUser(const QString &username, bool removeHome)
 {
     if (!isValidUsername(username)) {
@@ -212,16 +243,36 @@ bool UserManager::deleteUser(const QString &username, bool removeHome)
         return false;
     }
 
+    if (m_deletingUsers.contains(username)) {
+        Q_EMIT errorOccurred(QStringLiteral("User is already being deleted"));
+        return false;
+    }
+
     // Helper will verify user is in couchplay group
     if (m_helperClient->deleteUser(username, removeHome)) {
-        refresh();
-        Q_EMIT userDeleted(username);
+        m_deletingUsers.append(username);
+        Q_EMIT deletingUsersChanged();
         return true;
     }
 
     return false;
 }
 
+void UserManager::onUserDeletionFinished(const QString &username, bool success, const QString &error)
+{
+    // Also deletions started elsewhere: the user list is stale either way
+    if (m_deletingUsers.removeAll(username) > 0) {
+        Q_EMIT deletingUsersChanged();
+    }
+    refresh();
+
+    if (success) {
+        Q_EMIT userDeleted(username);
+    } else {
+        Q_EMIT errorOccurred(error);
+    }
+}
+
 bool UserManager::isValidUsername(const QString &username) const
 {
     if (username.isEmpty() || username.length() > 32) {
@@ -240,9 +291,7 @@ bool UserManager::isValidUsername(const QString &username) const
 
 bool UserManager::userExists(const QString &username) const
 {
-    // Check getpwnam for any user
-    struct passwd *pw = getpwnam(username.toLocal8Bit().constData());
-    return pw != nullptr;
+    return UserDirectory::instance().user(username).has_value();
 }
 
 bool UserManager::isInCouchPlayGroup(const QString &username) const
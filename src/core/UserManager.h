@@ -5,6 +5,7 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <QList>
 #include <QSet>
 #include <QVariantMap>
@@ -25,6 +26,8 @@ class UserManager : public QObject
     QML_ELEMENT
     Q_PROPERTY(QString currentUser READ currentUser CONSTANT)
     Q_PROPERTY(QVariantList users READ usersAsVariant NOTIFY usersChanged)
+    Q_PROPERTY(QStringList deletingUsers READ deletingUsers NOTIFY deletingUsersChanged)
+    Q_PROPERTY(bool hasTemplate READ hasTemplate NOTIFY templateChanged)
 
 public:
     explicit UserManager(QObject *parent = nullptr);
@@ -64,14 +67,43 @@ public:
      */
     Q_INVOKABLE bool createUser(const QString &username);
 
+    /**
+     * @brief Create a throwaway player from the saved template home
+     *
+     * The account is in the couchplay-guest group; SessionRunner deletes it
+     * when the session it played in stops.
+     */
+    Q_INVOKABLE bool createEphemeralUser(const QString &username);
+
+    /**
+     * @brief Save a set-up player's home as the template for ephemeral players
+     */
+    Q_INVOKABLE bool saveTemplate(const QString &username);
+
+    /**
+     * @brief Whether ephemeral players can be created
+     */
+    bool hasTemplate() const;
+
+    /**
+     * @brief Members of the couchplay-guest group
+     */
+    static QSet<QString> guestUsers();
+
     /**
      * @brief Delete a CouchPlay user
      * @param username The username to delete
      * @param removeHome If true, also delete the user's home directory
-     * @return true if deletion was successful
+     * @return true if the helper started the deletion; userDeleted() or
+     *         errorOccurred() follows when it is done
      */
     Q_INVOKABLE bool deleteUser(const QString &username, bool removeHome);
 
+    /**
+     * @brief Users whose deletion is still running in the helper
+     */
+    QStringList deletingUsers() const { return m_deletingUsers; }
+
     /**
      * @brief Check if a username is valid
      */
@@ -91,10 +123,13 @@ Q_SIGNALS:
     void usersChanged();
     void userCreated(const QString &username);
     void userDeleted(const QString &username);
+    void deletingUsersChanged();
+    void templateChanged();
     void errorOccurred(const QString &message);
 
 private:
     void parseUsers();
+    void onUserDeletionFinished(const QString &username, bool success, const QString &error);
     QSet<QString> getCouchPlayGroupMembers() const;
 
     struct UserInfo {
@@ -102,9 +137,11 @@ private:
         int uid;
         QString homeDir;
         QString shell;
+        bool ephemeral = false;
     };
 
     CouchPlayHelperClient *m_helperClient = nullptr;
     QString m_currentUser;
     QList<UserInfo> m_users;
+    QStringList m_deletingUsers;
 };
@@ -0,0 +1,360 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "Vdf.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+VdfFile::VdfFile(const QString &path)
+    : m_file(path)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    m_open = true;
+
+    const qint64 size = m_file.size();
+    if (size > 0) {
+        m_map = m_file.map(0, size);
+    }
+    if (m_map) {
+        m_data = QByteArrayView(m_map, size);
+    } else {
+        m_buffer = m_file.readAll();
+        m_data = m_buffer;
+    }
+}
+
+VdfFile::~VdfFile()
+{
+    if (m_map) {
+        m_file.unmap(m_map);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// BinaryVdfReader
+// ---------------------------------------------------------------------------
+
+bool BinaryVdfReader::readCString(QByteArrayView &out)
+{
+    if (m_pos >= m_data.size()) {
+        return false;
+    }
+    const void *end = std::memchr(m_data.data() + m_pos, '\0', m_data.size() - m_pos);
+    if (!end) {
+        return false;
+    }
+    const qsizetype length = static_cast<const char *>(end) - (m_data.data() + m_pos);
+    out = m_data.sliced(m_pos, length);
+    m_pos += length + 1;
+    return true;
+}
+
+bool BinaryVdfReader::next()
+{
+    m_key = QByteArrayView();
+    m_value = QByteArrayView();
+    if (m_error || m_pos >= m_data.size()) {
+        return false;
+    }
+
+    m_type = static_cast<Type>(m_data.at(m_pos++));
+    if (m_type == End || m_type == AlternateEnd) {
+        // The last End closes the implicit root and leaves the depth at 0
+        if (m_depth > 0) {
+            --m_depth;
+        }
+        return true;
+    }
+
+    if (!readCString(m_key)) {
+        m_error = true;
+        return false;
+    }
+
+    qsizetype valueSize = 0;
+    switch (m_type) {
+    case Object:
+        ++m_depth;
+        return true;
+    case String:
+        if (!readCString(m_value)) {
+            m_error = true;
+            return false;
+        }
+        return true;
+    case WideString: {
+        // UTF-16, terminated by a 16-bit zero
+        qsizetype end = m_pos;
+        while (end + 1 < m_data.size() && (m_data.at(end) != '\0' || m_data.at(end + 1) != '\0')) {
+            end += 2;
+        }
+        if (end + 1 >= m_data.size()) {
+            m_error = true;
+            return false;
+        }
+        m_value = m_data.sliced(m_pos, end - m_pos);
+        m_pos = end + 2;
+        return true;
+    }
+    case Int32:
+    case Float32:
+    case Pointer:
+    case Color:
+        valueSize = 4;
+        break;
+    case UInt64:
+    case Int64:
+        valueSize = 8;
+        break;
+    default:
+        m_error = true;
+        return false;
+    }
+
+    if (m_pos + valueSize > m_data.size()) {
+        m_error = true;
+        return false;
+    }
+    m_value = m_data.sliced(m_pos, valueSize);
+    m_pos += valueSize;
+    return true;
+}
+
+bool BinaryVdfReader::skipObject()
+{
+    const int target = m_depth - 1;
+    while (next()) {
+        if ((m_type == End || m_type == AlternateEnd) && m_depth == target) {
+            return true;
+        }
+    }
+    return false;
+}
+
+quint32 BinaryVdfReader::int32Value() const
+{
+    return m_value.size() >= 4 ? qFromLittleEndian<quint32>(m_value.data()) : 0;
+}
+
+quint64 BinaryVdfReader::uint64Value() const
+{
+    return m_value.size() >= 8 ? qFromLittleEndian<quint64>(m_value.data()) : int32Value();
+}
+
+float BinaryVdfReader::floatValue() const
+{
+    const quint32 bits = int32Value();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// ---------------------------------------------------------------------------
+// BinaryVdfWriter
+// ---------------------------------------------------------------------------
+
+void BinaryVdfWriter::writeKey(char type, QByteArrayView key)
+{
+    m_data.append(type);
+    m_data.append(key);
+    m_data.append('\0');
+}
+
+void BinaryVdfWriter::beginObject(QByteArrayView key)
+{
+    writeKey(BinaryVdfReader::Object, key);
+}
+
+void BinaryVdfWriter::endObject()
+{
+    m_data.append(char(BinaryVdfReader::End));
+}
+
+void BinaryVdfWriter::writeString(QByteArrayView key, QByteArrayView value)
+{
+    writeKey(BinaryVdfReader::String, key);
+    m_data.append(value);
+    m_data.append('\0');
+}
+
+void BinaryVdfWriter::writeInt32(QByteArrayView key, quint32 value)
+{
+    writeKey(BinaryVdfReader::Int32, key);
+    char bytes[4];
+    qToLittleEndian(value, bytes);
+    m_data.append(bytes, sizeof(bytes));
+}
+
+void BinaryVdfWriter::writeUInt64(QByteArrayView key, quint64 value)
+{
+    writeKey(BinaryVdfReader::UInt64, key);
+    char bytes[8];
+    qToLittleEndian(value, bytes);
+    m_data.append(bytes, sizeof(bytes));
+}
+
+void BinaryVdfWriter::copyField(const BinaryVdfReader &reader)
+{
+    switch (reader.type()) {
+    case BinaryVdfReader::End:
+    case BinaryVdfReader::AlternateEnd:
+        m_data.append(char(reader.type()));
+        return;
+    case BinaryVdfReader::Object:
+        writeKey(reader.type(), reader.key());
+        return;
+    case BinaryVdfReader::String:
+        writeString(reader.key(), reader.value());
+        return;
+    case BinaryVdfReader::WideString:
+        writeKey(reader.type(), reader.key());
+        m_data.append(reader.value());
+        m_data.append(2, '\0');
+        return;
+    default:
+        writeKey(reader.type(), reader.key());
+        m_data.append(reader.value());
+        return;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// TextVdfReader
+// ---------------------------------------------------------------------------
+
+void TextVdfReader::skipSpace()
+{
+    while (m_pos < m_data.size()) {
+        const char c = m_data.at(m_pos);
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            ++m_pos;
+        } else if (c == '/' && m_pos + 1 < m_data.size() && m_data.at(m_pos + 1) == '/') {
+            while (m_pos < m_data.size() && m_data.at(m_pos) != '\n') {
+                ++m_pos;
+            }
+        } else if (c == '[') {
+            // Platform conditional, e.g. [$WIN32]
+            while (m_pos < m_data.size() && m_data.at(m_pos) != ']') {
+                ++m_pos;
+            }
+            ++m_pos;
+        } else {
+            break;
+        }
+    }
+}
+
+bool TextVdfReader::readToken(QByteArrayView &out)
+{
+    if (m_pos >= m_data.size()) {
+        return false;
+    }
+
+    if (m_data.at(m_pos) == '"') {
+        const qsizetype start = ++m_pos;
+        while (m_pos < m_data.size() && m_data.at(m_pos) != '"') {
+            m_pos += m_data.at(m_pos) == '\\' ? 2 : 1;
+        }
+        if (m_pos >= m_data.size()) {
+            return false;
+        }
+        out = m_data.sliced(start, m_pos - start);
+        ++m_pos;
+        return true;
+    }
+
+    const qsizetype start = m_pos;
+    while (m_pos < m_data.size()) {
+        const char c = m_data.at(m_pos);
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '{' || c == '}' || c == '"') {
+            break;
+        }
+        ++m_pos;
+    }
+    out = m_data.sliced(start, m_pos - start);
+    return !out.isEmpty();
+}
+
+bool TextVdfReader::next()
+{
+    m_key = QByteArrayView();
+    m_value = QByteArrayView();
+    if (m_error) {
+        return false;
+    }
+
+    skipSpace();
+    if (m_pos >= m_data.size()) {
+        m_error = m_depth != 0;  // Unclosed object
+        return false;
+    }
+
+    if (m_data.at(m_pos) == '}') {
+        ++m_pos;
+        if (m_depth == 0) {
+            m_error = true;
+            return false;
+        }
+        --m_depth;
+        m_type = ObjectEnd;
+        return true;
+    }
+
+    if (m_data.at(m_pos) == '{' || !readToken(m_key)) {
+        m_error = true;
+        return false;
+    }
+
+    skipSpace();
+    if (m_pos < m_data.size() && m_data.at(m_pos) == '{') {
+        ++m_pos;
+        ++m_depth;
+        m_type = ObjectBegin;
+        return true;
+    }
+
+    if (!readToken(m_value)) {
+        m_error = true;
+        return false;
+    }
+    m_type = Value;
+    return true;
+}
+
+bool TextVdfReader::skipObject()
+{
+    const int target = m_depth - 1;
+    while (next()) {
+        if (m_type == ObjectEnd && m_depth == target) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString TextVdfReader::decode(QByteArrayView raw)
+{
+    if (!raw.contains('\\')) {
+        return QString::fromUtf8(raw);
+    }
+
+    QByteArray unescaped;
+    unescaped.reserve(raw.size());
+    for (qsizetype i = 0; i < raw.size(); ++i) {
+        char c = raw.at(i);
+        if (c == '\\' && i + 1 < raw.size()) {
+            c = raw.at(++i);
+            if (c == 'n') {
+                c = '\n';
+            } else if (c == 't') {
+                c = '\t';
+            }
+        }
+        unescaped.append(c);
+    }
+    return QString::fromUtf8(unescaped);
+}
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QFile>
+#include <QString>
+
+/**
+ * VdfFile - Read-only memory mapping of a VDF file
+ *
+ * The readers below only hand out views into data(), so they must not
+ * outlive the VdfFile. Files that can't be mapped (empty files, pipes) are
+ * read into memory instead. Steam replaces its files by renaming a new one
+ * over them, so a mapping never sees a file shrink underneath it.
+ */
+class VdfFile
+{
+public:
+    explicit VdfFile(const QString &path);
+    ~VdfFile();
+
+    bool isOpen() const { return m_open; }
+    QByteArrayView data() const { return m_data; }
+
+private:
+    Q_DISABLE_COPY(VdfFile)
+
+    QFile m_file;
+    uchar *m_map = nullptr;
+    QByteArray m_buffer;
+    QByteArrayView m_data;
+    bool m_open = false;
+};
+
+/**
+ * BinaryVdfReader - Streaming reader for Valve's binary KeyValues
+ *
+ * As used by shortcuts.vdf. Each next() steps to the following field
+ * without allocating: key() and the value accessors are views into the
+ * data. An Object field opens a nested object that a later End closes;
+ * depth() is the nesting level after the current field.
+ *
+ * @code
+ * BinaryVdfReader reader(file.data());
+ * while (reader.next()) {
+ *     if (reader.type() == BinaryVdfReader::String && reader.key() == "AppName") { ... }
+ * }
+ * @endcode
+ */
+class BinaryVdfReader
+{
+public:
+    enum Type : char {
+        Object = 0x00,
+        String = 0x01,
+        Int32 = 0x02,
+        Float32 = 0x03,
+        Pointer = 0x04,
+        WideString = 0x05,
+        Color = 0x06,
+        UInt64 = 0x07,
+        End = 0x08,
+        Int64 = 0x0a,
+        AlternateEnd = 0x0b,
+    };
+
+    explicit BinaryVdfReader(QByteArrayView data)
+        : m_data(data)
+    {
+    }
+
+    /**
+     * Advance to the next field
+     * @return false at the end of the data or on malformed input, see hasError()
+     */
+    bool next();
+
+    /**
+     * Skip the fields of the object the current Object field opened,
+     * up to and including its End
+     */
+    bool skipObject();
+
+    Type type() const { return m_type; }
+    QByteArrayView key() const { return m_key; }
+    int depth() const { return m_depth; }
+    bool hasError() const { return m_error; }
+
+    // Value of a String field, without its terminator; for other types the raw bytes
+    QByteArrayView value() const { return m_value; }
+    quint32 int32Value() const;
+    quint64 uint64Value() const;
+    float floatValue() const;
+
+private:
+    bool readCString(QByteArrayView &out);
+
+    QByteArrayView m_data;
+    qsizetype m_pos = 0;
+    Type m_type = End;
+    QByteArrayView m_key;
+    QByteArrayView m_value;
+    int m_depth = 0;
+    bool m_error = false;
+};
+
+/**
+ * BinaryVdfWriter - Builds binary KeyValues, the counterpart of BinaryVdfReader
+ *
+ * Writing every field a reader returns (see copyField()) reproduces the
+ * input byte for byte.
+ */
+class BinaryVdfWriter
+{
+public:
+    void beginObject(QByteArrayView key);
+    void endObject();
+    void writeString(QByteArrayView key, QByteArrayView value);
+    void writeInt32(QByteArrayView key, quint32 value);
+    void writeUInt64(QByteArrayView key, quint64 value);
+
+    /**
+     * Append the reader's current field as is
+     */
+    void copyField(const BinaryVdfReader &reader);
+
+    const QByteArray &data() const { return m_data; }
+
+private:
+    void writeKey(char type, QByteArrayView key);
+
+    QByteArray m_data;
+};
+
+/**
+ * TextVdfReader - Streaming reader for text KeyValues (ACF, libraryfolders.vdf)
+ *
+ * Like BinaryVdfReader, fields are views into the data. Quoted and bare
+ * tokens, // comments and [$PLATFORM] conditionals are understood; values
+ * keep their backslash escapes, decode() resolves them.
+ */
+class TextVdfReader
+{
+public:
+    enum Type {
+        Value,       // "key" "value"
+        ObjectBegin, // "key" {
+        ObjectEnd,   // }
+    };
+
+    explicit TextVdfReader(QByteArrayView data)
+        : m_data(data)
+    {
+    }
+
+    bool next();
+    bool skipObject();
+
+    Type type() const { return m_type; }
+    QByteArrayView key() const { return m_key; }
+    QByteArrayView value() const { return m_value; }
+    int depth() const { return m_depth; }
+    bool hasError() const { return m_error; }
+
+    /**
+     * @p raw with its escape sequences resolved, as UTF-8
+     */
+    static QString decode(QByteArrayView raw);
+
+private:
+    void skipSpace();
+    bool readToken(QByteArrayView &out);
+
+    QByteArrayView m_data;
+    qsizetype m_pos = 0;
+    Type m_type = ObjectEnd;
+    QByteArrayView m_key;
+    QByteArrayView m_value;
+    int m_depth = 0;
+    bool m_error = false;
+};
@@ -2,34 +2,136 @@
 // SPDX-FileCopyrightText: 2025 CouchPlay Contributors
 
 #include "WindowManager.h"
+#include "SessionTrace.h"
+#include "StartupTrace.h"
 
+#include <QCoreApplication>
 #include <QDBusArgument>
 #include <QDBusConnection>
+#include <QDBusConnectionInterface>
 #include <QDBusInterface>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QDBusReply>
 #include <QDateTime>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QStandardPaths>
-#include <QThread>
+
+static const QString WATCHER_INTERFACE = QStringLiteral("io.github.hikaps.couchplay.WindowWatcher");
+
+// Persistent KWin script reporting gamescope windows as they come and go
+// and applying the placements CouchPlay hands back. Existing windows are
+// reported once on start so requests queued after the window appeared can
+// still be matched.
+//
+// Placements travel as "uuid,x,y,width,height,flags" strings: callDBus()
+// converts plain string lists reliably, nested D-Bus structures not so much.
+static const char WATCHER_SCRIPT[] = R"(
+(function() {
+    var service = "%1";
+    var path = "%2";
+    var iface = "%3";
+    var shortcut = "%4";
+
+    var NoBorder = 0x1;
+    var KeepAbove = 0x2;
+    var SkipTaskbar = 0x4;
+    var Minimized = 0x8;
+
+    function isGamescope(win) {
+        return String(win.resourceClass) === "gamescope" || String(win.desktopFileName) === "gamescope";
+    }
+
+    function placeWindows(placements) {
+        var byId = {};
+        for (var i = 0; i < placements.length; i++) {
+            byId[placements[i].uuid] = placements[i];
+        }
+
+        var windows = workspace.windowList();
+        for (var j = 0; j < windows.length; j++) {
+            var win = windows[j];
+            var p = byId[win.internalId.toString()];
+            if (!p) {
+                continue;
+            }
+            win.frameGeometry = {x: p.x, y: p.y, width: p.w, height: p.h};
+            if (p.flags & NoBorder) {
+                win.noBorder = true;
+            }
+            if (p.flags & KeepAbove) {
+                win.keepAbove = true;
+            }
+            if (p.flags & SkipTaskbar) {
+                win.skipTaskbar = true;
+                win.skipPager = true;
+            }
+            // Standby windows stay minimized until placed for the session
+            win.minimized = Boolean(p.flags & Minimized);
+        }
+    }
+
+    function applyPlacements(entries) {
+        if (!entries || entries.length === 0) {
+            return;
+        }
+        var placements = [];
+        for (var i = 0; i < entries.length; i++) {
+            var f = String(entries[i]).split(",");
+            placements.push({uuid: f[0], x: Number(f[1]), y: Number(f[2]),
+                             w: Number(f[3]), h: Number(f[4]), flags: Number(f[5])});
+        }
+        placeWindows(placements);
+    }
+
+    function reportAdded(win) {
+        if (isGamescope(win)) {
+            callDBus(service, path, iface, "windowAdded", win.internalId.toString(), applyPlacements);
+        }
+    }
+
+    workspace.windowAdded.connect(reportAdded);
+    workspace.windowRemoved.connect(function(win) {
+        if (isGamescope(win)) {
+            callDBus(service, path, iface, "windowRemoved", win.internalId.toString());
+        }
+    });
+
+    // Triggered from CouchPlay via kglobalaccel when placements are queued
+    registerShortcut(shortcut, "CouchPlay: apply window placements", "", function() {
+        callDBus(service, path, iface, "takePlacements", applyPlacements);
+    });
+
+    var windows = workspace.windowList();
+    for (var i = 0; i < windows.length; i++) {
+        reportAdded(windows[i]);
+    }
+})();
+)";
 
 WindowManager::WindowManager(QObject *parent)
     : QObject(parent)
 {
-    // Check if KWin is available
-    QDBusInterface kwin(
-        QStringLiteral("org.kde.KWin"),
-        QStringLiteral("/KWin"),
-        QStringLiteral("org.kde.KWin"),
-        QDBusConnection::sessionBus()
-    );
-    m_kwinAvailable = kwin.isValid();
-    
-    if (!m_kwinAvailable) {
-        qWarning() << "WindowManager: KWin D-Bus interface not available";
-    } else {
-        qDebug() << "WindowManager: KWin D-Bus interface available";
+    StartupTrace::Scope trace("WindowManager");
+    // Check if KWin is available. Introspecting it would block startup, and
+    // nothing needs the answer before a session starts, so just ask the bus.
+    QDBusConnectionInterface *bus = QDBusConnection::sessionBus().interface();
+    if (bus) {
+        auto *watcher = new QDBusPendingCallWatcher(
+            bus->asyncCall(QStringLiteral("NameHasOwner"), QStringLiteral("org.kde.KWin")), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *call) {
+            QDBusPendingReply<bool> reply = *call;
+            call->deleteLater();
+            m_kwinAvailable = !reply.isError() && reply.value();
+            if (!m_kwinAvailable) {
+                qWarning() << "WindowManager: KWin D-Bus interface not available";
+            } else {
+                qDebug() << "WindowManager: KWin D-Bus interface available";
+            }
+        });
     }
     
     // Create the monitoring timer (but don't start it yet)
@@ -38,7 +140,10 @@ WindowManager::WindowManager(QObject *parent)
     connect(m_monitorTimer, &QTimer::timeout, this, &WindowManager::checkForNewWindows);
 }
 
-WindowManager::~WindowManager() = default;
+WindowManager::~WindowManager()
+{
+    unloadWatcher();
+}
 
 bool WindowManager::isAvailable() const
 {
@@ -209,13 +314,19 @@ bool WindowManager::positionWindow(const QString &windowId, const QRect &geometr
 
     qDebug() << "WindowManager: Positioning window" << windowId << "to" << geometry;
 
+    if (m_watcherActive) {
+        // windowPositioned() follows once the script takes it
+        queuePlacement(windowId, geometry, DEFAULT_PLACEMENT_FLAGS);
+        return true;
+    }
+
     // Use KWin scripting to position the window
     return executePositionScript(windowId, geometry);
 }
 
 void WindowManager::queuePositionRequest(int requestId, const QRect &geometry,
                                           const QStringList &excludeWindowIds,
-                                          int timeoutMs)
+                                          int timeoutMs, bool minimized)
 {
     if (!m_kwinAvailable) {
         qWarning() << "WindowManager: Cannot queue position request - KWin not available";
@@ -227,6 +338,7 @@ void WindowManager::queuePositionRequest(int requestId, const QRect &geometry,
     for (int i = 0; i < m_pendingRequests.size(); ++i) {
         if (m_pendingRequests[i].requestId == requestId) {
             qWarning() << "WindowManager: Replacing existing request" << requestId;
+            SessionTrace::close(m_pendingRequests[i].traceSpan, {{QStringLiteral("replaced"), true}});
             m_pendingRequests.removeAt(i);
             break;
         }
@@ -237,6 +349,8 @@ void WindowManager::queuePositionRequest(int requestId, const QRect &geometry,
     request.geometry = geometry;
     request.excludeWindowIds = excludeWindowIds;
     request.expiresAt = QDateTime::currentMSecsSinceEpoch() + timeoutMs;
+    request.minimized = minimized;
+    request.traceSpan = SessionTrace::open("window", QStringLiteral("Window %1").arg(requestId));
     
     m_pendingRequests.append(request);
     
@@ -245,6 +359,9 @@ void WindowManager::queuePositionRequest(int requestId, const QRect &geometry,
              << "excluding" << excludeWindowIds.size() << "windows"
              << "timeout:" << timeoutMs << "ms";
     
+    // Load the watcher on first use; falls back to polling if it fails
+    ensureWatcher();
+    
     // Start monitoring if not already running
     startMonitoring();
     
@@ -256,6 +373,7 @@ void WindowManager::cancelPositionRequest(int requestId)
 {
     for (int i = 0; i < m_pendingRequests.size(); ++i) {
         if (m_pendingRequests[i].requestId == requestId) {
+            SessionTrace::close(m_pendingRequests[i].traceSpan, {{QStringLiteral("cancelled"), true}});
             m_pendingRequests.removeAt(i);
             qDebug() << "WindowManager: Cancelled position request" << requestId;
             break;
@@ -268,6 +386,9 @@ void WindowManager::cancelPositionRequest(int requestId)
 void WindowManager::cancelAllRequests()
 {
     int count = m_pendingRequests.size();
+    for (const PositionRequest &request : std::as_const(m_pendingRequests)) {
+        SessionTrace::close(request.traceSpan, {{QStringLiteral("cancelled"), true}});
+    }
     m_pendingRequests.clear();
     m_knownWindowIds.clear();
     stopMonitoringIfEmpty();
@@ -280,13 +401,118 @@ bool WindowManager::hasPendingRequests() const
     return !m_pendingRequests.isEmpty();
 }
 
+QStringList WindowManager::windowAdded(const QString &windowId)
+{
+    if (windowId.isEmpty() || m_knownWindowIds.contains(windowId)
+        || m_availableWindowIds.contains(windowId)) {
+        return {};
+    }
+
+    qDebug() << "WindowManager: Watcher reported gamescope window" << windowId;
+    m_availableWindowIds.append(windowId);
+
+    if (!m_pendingRequests.isEmpty()) {
+        // Placements made while matching go back in the reply
+        m_inWatcherCallback = true;
+        checkForNewWindows();
+        m_inWatcherCallback = false;
+    }
+
+    return takePlacements();
+}
+
+void WindowManager::windowRemoved(const QString &windowId)
+{
+    m_availableWindowIds.removeAll(windowId);
+    m_knownWindowIds.removeAll(windowId);
+}
+
+QStringList WindowManager::takePlacements()
+{
+    QList<Placement> placements;
+    placements.swap(m_pendingPlacements);
+
+    QStringList entries;
+    for (const Placement &placement : std::as_const(placements)) {
+        entries.append(QStringLiteral("%1,%2,%3,%4,%5,%6")
+            .arg(placement.windowId)
+            .arg(placement.geometry.x())
+            .arg(placement.geometry.y())
+            .arg(placement.geometry.width())
+            .arg(placement.geometry.height())
+            .arg(placement.flags));
+    }
+
+    // The script applies them as soon as this returns
+    for (const Placement &placement : std::as_const(placements)) {
+        Q_EMIT windowPositioned(placement.windowId, placement.geometry);
+    }
+    return entries;
+}
+
+void WindowManager::queuePlacement(const QString &windowId, const QRect &geometry, int flags)
+{
+    m_pendingPlacements.append({windowId, geometry, flags});
+
+    if (!m_inWatcherCallback && !m_flushScheduled) {
+        m_flushScheduled = true;
+        QTimer::singleShot(0, this, &WindowManager::flushPlacements);
+    }
+}
+
+void WindowManager::flushPlacements()
+{
+    m_flushScheduled = false;
+    if (m_pendingPlacements.isEmpty() || !m_watcherActive) {
+        return;
+    }
+
+    // The script answers by calling takePlacements()
+    QDBusMessage invoke = QDBusMessage::createMethodCall(
+        QStringLiteral("org.kde.kglobalaccel"),
+        QStringLiteral("/component/kwin"),
+        QStringLiteral("org.kde.kglobalaccel.Component"),
+        QStringLiteral("invokeShortcut")
+    );
+    invoke << m_watcherShortcutName;
+    auto *watcher = new QDBusPendingCallWatcher(QDBusConnection::sessionBus().asyncCall(invoke), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *call) {
+        call->deleteLater();
+        if (!call->isError() || m_pendingPlacements.isEmpty()) {
+            return;
+        }
+
+        // The script will never ask for them; place them the slow way
+        qWarning() << "WindowManager: Failed to trigger the watcher script:" << call->error().message()
+                   << "- positioning" << m_pendingPlacements.size() << "windows one by one";
+        QList<Placement> placements;
+        placements.swap(m_pendingPlacements);
+        for (const Placement &placement : std::as_const(placements)) {
+            executePositionScript(placement.windowId, placement.geometry);
+        }
+    });
+
+    qDebug() << "WindowManager: Requested placement of" << m_pendingPlacements.size() << "windows";
+}
+
 void WindowManager::checkForNewWindows()
 {
+    expireRequests();
+    
     if (m_pendingRequests.isEmpty()) {
         stopMonitoringIfEmpty();
         return;
     }
     
+    // With the watcher running, windows are pushed to windowAdded() and the
+    // timer only expires requests; otherwise fall back to a KRunner query
+    matchPendingRequests(m_watcherActive ? m_availableWindowIds : findAllGamescopeWindows());
+    
+    stopMonitoringIfEmpty();
+}
+
+void WindowManager::expireRequests()
+{
     qint64 now = QDateTime::currentMSecsSinceEpoch();
     
     // Check for expired requests first
@@ -294,6 +520,7 @@ void WindowManager::checkForNewWindows()
     for (int i = m_pendingRequests.size() - 1; i >= 0; --i) {
         if (m_pendingRequests[i].expiresAt <= now) {
             expiredRequestIds.append(m_pendingRequests[i].requestId);
+            SessionTrace::close(m_pendingRequests[i].traceSpan, {{QStringLiteral("timedOut"), true}});
             m_pendingRequests.removeAt(i);
         }
     }
@@ -303,15 +530,10 @@ void WindowManager::checkForNewWindows()
         qWarning() << "WindowManager: Position request" << requestId << "timed out";
         Q_EMIT positioningTimedOut(requestId);
     }
-    
-    if (m_pendingRequests.isEmpty()) {
-        stopMonitoringIfEmpty();
-        return;
-    }
-    
-    // Find all current gamescope windows
-    QStringList currentWindows = findAllGamescopeWindows();
-    
+}
+
+void WindowManager::matchPendingRequests(QStringList currentWindows)
+{
     // Process pending requests in order (FIFO)
     // We iterate carefully since we may remove elements
     int i = 0;
@@ -333,17 +555,27 @@ void WindowManager::checkForNewWindows()
             qDebug() << "WindowManager: Matched window" << matchedWindowId 
                      << "to request" << request.requestId;
             
-            bool success = positionWindow(matchedWindowId, request.geometry);
+            // Copy before positionWindow(), its signals may re-enter and modify the queue
+            const int requestId = request.requestId;
+            const QRect geometry = request.geometry;
+            const bool minimized = request.minimized;
+            SessionTrace::close(request.traceSpan, {{QStringLiteral("window"), matchedWindowId}});
+            m_pendingRequests.removeAt(i);
             
             // Track this window as known (positioned)
             m_knownWindowIds.append(matchedWindowId);
+            m_availableWindowIds.removeAll(matchedWindowId);
             
             // Remove from available windows for subsequent requests
             currentWindows.removeAll(matchedWindowId);
             
-            // Remove this request and emit signal
-            int requestId = request.requestId;
-            m_pendingRequests.removeAt(i);
+            bool success;
+            if (minimized && m_watcherActive) {
+                queuePlacement(matchedWindowId, geometry, DEFAULT_PLACEMENT_FLAGS | Minimized);
+                success = true;
+            } else {
+                success = positionWindow(matchedWindowId, geometry);
+            }
             
             if (success) {
                 Q_EMIT gamescopeWindowPositioned(requestId, matchedWindowId);
@@ -357,14 +589,107 @@ void WindowManager::checkForNewWindows()
             ++i;
         }
     }
-    
-    stopMonitoringIfEmpty();
+}
+
+bool WindowManager::ensureWatcher()
+{
+    if (m_watcherActive) {
+        return true;
+    }
+    if (m_watcherFailed || !m_kwinAvailable) {
+        return false;
+    }
+
+    // Each instance gets its own callback path and plugin name; the QML
+    // singleton and SessionRunner may both own a WindowManager
+    static int s_watcherCount = 0;
+    const int watcherId = ++s_watcherCount;
+    const QString suffix = QStringLiteral("%1-%2").arg(QCoreApplication::applicationPid()).arg(watcherId);
+
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    m_watcherObjectPath = QStringLiteral("/io/github/hikaps/CouchPlay/WindowWatcher%1").arg(watcherId);
+    if (!bus.registerObject(m_watcherObjectPath, this, QDBusConnection::ExportScriptableSlots)) {
+        qWarning() << "WindowManager: Failed to export watcher callback, falling back to polling";
+        m_watcherFailed = true;
+        return false;
+    }
+
+    // Shortcut names are persisted by kglobalaccel, so keep them stable across runs
+    m_watcherShortcutName = QStringLiteral("CouchPlay Place Windows %1").arg(watcherId);
+
+    const QString script = QString::fromLatin1(WATCHER_SCRIPT)
+        .arg(bus.baseService(), m_watcherObjectPath, WATCHER_INTERFACE, m_watcherShortcutName);
+
+    m_watcherScriptPath = QDir::tempPath() + QStringLiteral("/couchplay-windows-%1.js").arg(suffix);
+    QFile scriptFile(m_watcherScriptPath);
+    if (!scriptFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qWarning() << "WindowManager: Failed to write watcher script:" << m_watcherScriptPath;
+        unloadWatcher();
+        m_watcherFailed = true;
+        return false;
+    }
+    scriptFile.write(script.toUtf8());
+    scriptFile.close();
+
+    QDBusInterface scripting(
+        QStringLiteral("org.kde.KWin"),
+        QStringLiteral("/Scripting"),
+        QStringLiteral("org.kde.kwin.Scripting"),
+        bus
+    );
+
+    m_watcherPluginName = QStringLiteral("couchplay-windows-%1").arg(suffix);
+    QDBusReply<int> loadReply = scripting.call(QStringLiteral("loadScript"), m_watcherScriptPath, m_watcherPluginName);
+    if (!loadReply.isValid() || loadReply.value() < 0) {
+        qWarning() << "WindowManager: Failed to load watcher script, falling back to polling:"
+                   << loadReply.error().message();
+        unloadWatcher();
+        m_watcherFailed = true;
+        return false;
+    }
+
+    scripting.call(QStringLiteral("start"));
+    m_watcherActive = true;
+
+    qDebug() << "WindowManager: Watcher script loaded as" << m_watcherPluginName;
+    return true;
+}
+
+void WindowManager::unloadWatcher()
+{
+    if (!m_watcherPluginName.isEmpty()) {
+        QDBusInterface scripting(
+            QStringLiteral("org.kde.KWin"),
+            QStringLiteral("/Scripting"),
+            QStringLiteral("org.kde.kwin.Scripting"),
+            QDBusConnection::sessionBus()
+        );
+        if (scripting.isValid()) {
+            scripting.call(QStringLiteral("unloadScript"), m_watcherPluginName);
+        }
+        m_watcherPluginName.clear();
+    }
+
+    if (!m_watcherScriptPath.isEmpty()) {
+        QFile::remove(m_watcherScriptPath);
+        m_watcherScriptPath.clear();
+    }
+
+    if (!m_watcherObjectPath.isEmpty()) {
+        QDBusConnection::sessionBus().unregisterObject(m_watcherObjectPath);
+        m_watcherObjectPath.clear();
+    }
+
+    m_watcherActive = false;
+    m_availableWindowIds.clear();
+    m_pendingPlacements.clear();
 }
 
 void WindowManager::startMonitoring()
 {
     if (!m_monitorTimer->isActive()) {
-        qDebug() << "WindowManager: Starting window monitoring (interval:" << MONITOR_INTERVAL_MS << "ms)";
+        qDebug() << "WindowManager: Starting window monitoring (interval:" << MONITOR_INTERVAL_MS << "ms,"
+                 << (m_watcherActive ? "event-driven)" : "polling)");
         m_monitorTimer->start();
     }
 }
@@ -379,6 +704,8 @@ void WindowManager::stopMonitoringIfEmpty()
 
 bool WindowManager::executePositionScript(const QString &windowId, const QRect &geometry)
 {
+    SessionTrace::Scope trace("window", QStringLiteral("Position script"), QStringLiteral("Windows"));
+
     // Create a temporary KWin script to position the window
     // KWin scripts use JavaScript and can access window properties
     
@@ -414,10 +741,13 @@ bool WindowManager::executePositionScript(const QString &windowId, const QRect &
         .arg(geometry.width())
         .arg(geometry.height());
     
-    // Write script to a temporary file
+    // Write script to a temporary file (unique per call, cleanup is deferred)
+    static int s_positionScriptCount = 0;
+    const QString scriptId = QStringLiteral("%1-%2")
+        .arg(QString::number(reinterpret_cast<quintptr>(this), 16))
+        .arg(++s_positionScriptCount);
     QString tempDir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
-    QString scriptPath = tempDir + QStringLiteral("/couchplay-position-%1.js")
-        .arg(QString::number(reinterpret_cast<quintptr>(this), 16));
+    QString scriptPath = tempDir + QStringLiteral("/couchplay-position-%1.js").arg(scriptId);
     
     QFile scriptFile(scriptPath);
     if (!scriptFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
@@ -445,8 +775,7 @@ bool WindowManager::executePositionScript(const QString &windowId, const QRect &
     }
     
     // Generate a unique plugin name for this positioning operation
-    QString pluginName = QStringLiteral("couchplay-position-%1").arg(
-        QString::number(QDateTime::currentMSecsSinceEpoch()));
+    QString pluginName = QStringLiteral("couchplay-position-%1").arg(scriptId);
     
     // Load the script
     QDBusReply<int> loadReply = scripting.call(QStringLiteral("loadScript"), scriptPath, pluginName);
@@ -464,15 +793,18 @@ bool WindowManager::executePositionScript(const QString &windowId, const QRect &
     // Start the scripts (this actually executes them)
     scripting.call(QStringLiteral("start"));
     
-    // Give the script a moment to execute - use QTimer for non-blocking delay would be better
-    // but for simplicity we use a short blocking wait here
-    QThread::msleep(100);
-    
-    // Unload the script
-    scripting.call(QStringLiteral("unloadScript"), pluginName);
-    
-    // Clean up the temporary file
-    QFile::remove(scriptPath);
+    // Give the script a moment to execute before unloading it, without
+    // blocking the GUI thread
+    QTimer::singleShot(100, this, [pluginName, scriptPath]() {
+        QDBusInterface scripting(
+            QStringLiteral("org.kde.KWin"),
+            QStringLiteral("/Scripting"),
+            QStringLiteral("org.kde.kwin.Scripting"),
+            QDBusConnection::sessionBus()
+        );
+        scripting.call(QStringLiteral("unloadScript"), pluginName);
+        QFile::remove(scriptPath);
+    });
     
     Q_EMIT windowPositioned(windowId, geometry);
     qDebug() << "WindowManager: Successfully positioned window" << windowId;
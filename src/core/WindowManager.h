@@ -21,10 +21,20 @@
  * 
  * Supports event-driven positioning through a queue system where
  * positioning requests are queued and fulfilled as windows appear.
+ * New gamescope windows are pushed to us by a small KWin script that
+ * listens to workspace.windowAdded and calls back over D-Bus; polling
+ * KRunner is only used when that script can't be loaded.
+ *
+ * The same script applies geometry: placements are batched and handed to
+ * its placeWindows() either in the reply to windowAdded() or, for windows
+ * positioned later, when it pulls them via takePlacements() after we
+ * trigger its kglobalaccel shortcut. No temporary scripts or sleeps,
+ * unless that shortcut can't be triggered.
  */
 class WindowManager : public QObject
 {
     Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "io.github.hikaps.couchplay.WindowWatcher")
     QML_ELEMENT
     QML_SINGLETON
 
@@ -50,7 +60,8 @@ public:
      * @brief Position a window at the specified geometry
      * @param windowId The window UUID from KWin
      * @param geometry The target geometry (x, y, width, height)
-     * @return true if successful
+     * @return true if the placement was made or handed on; with the watcher
+     *         script windowPositioned() follows once the script has taken it
      */
     Q_INVOKABLE bool positionWindow(const QString &windowId, const QRect &geometry);
 
@@ -60,6 +71,8 @@ public:
      * @param geometry The target geometry for the window
      * @param excludeWindowIds Window IDs to exclude (already positioned windows)
      * @param timeoutMs Maximum time to wait for the window (default 60 seconds)
+     * @param minimized Place the window but keep it minimized (standby instances);
+     *        a later positionWindow() reveals it
      * 
      * When a matching gamescope window appears (not in excludeWindowIds), it will be
      * positioned and the gamescopeWindowPositioned signal will be emitted.
@@ -67,7 +80,7 @@ public:
      */
     Q_INVOKABLE void queuePositionRequest(int requestId, const QRect &geometry,
                                            const QStringList &excludeWindowIds,
-                                           int timeoutMs = 60000);
+                                           int timeoutMs = 60000, bool minimized = false);
 
     /**
      * @brief Cancel a pending positioning request
@@ -100,6 +113,8 @@ public:
 Q_SIGNALS:
     /**
      * @brief Emitted when a window is successfully positioned
+     *
+     * For batched placements, once the watcher script has collected them.
      */
     void windowPositioned(const QString &windowId, const QRect &geometry);
 
@@ -120,25 +135,99 @@ Q_SIGNALS:
      */
     void positioningTimedOut(int requestId);
 
+public Q_SLOTS:
+    /**
+     * @brief Called by the KWin watcher script when a gamescope window appears
+     * @param windowId The window UUID from KWin
+     */
+    Q_SCRIPTABLE QStringList windowAdded(const QString &windowId);
+
+    /**
+     * @brief Called by the KWin watcher script when a gamescope window closes
+     */
+    Q_SCRIPTABLE void windowRemoved(const QString &windowId);
+
+    /**
+     * @brief Called by the KWin watcher script to fetch queued placements
+     * @return Entries of the form "uuid,x,y,width,height,flags"
+     */
+    Q_SCRIPTABLE QStringList takePlacements();
+
 private Q_SLOTS:
     /**
-     * @brief Called by timer to check for new gamescope windows
+     * @brief Called by timer to expire requests (and poll when the watcher is unavailable)
      */
     void checkForNewWindows();
 
 private:
+    // Window state applied together with the geometry (mirrored in the script)
+    enum PlacementFlag {
+        NoBorder = 0x1,
+        KeepAbove = 0x2,
+        SkipTaskbar = 0x4,  // Taskbar and pager, Alt+Tab still works
+        Minimized = 0x8,
+    };
+
+    // A placement waiting for the watcher script to take it
+    struct Placement {
+        QString windowId;
+        QRect geometry;
+        int flags;
+    };
+
     struct PositionRequest {
         int requestId;
         QRect geometry;
         QStringList excludeWindowIds;
         qint64 expiresAt;  // milliseconds since epoch
+        bool minimized = false;
+        quint64 traceSpan = 0;  // SessionTrace span of the wait for the window
     };
 
     /**
-     * @brief Execute a KWin script to position a specific window
+     * @brief Execute a one-off KWin script to position a specific window
+     *
+     * Only used when the persistent watcher script isn't running.
      */
     bool executePositionScript(const QString &windowId, const QRect &geometry);
 
+    /**
+     * @brief Queue a placement for the watcher script
+     *
+     * Outside of a windowAdded() callback a flush is scheduled so all
+     * placements made in the same event loop pass go out together.
+     */
+    void queuePlacement(const QString &windowId, const QRect &geometry, int flags);
+
+    /**
+     * @brief Ask the watcher script to pull queued placements
+     *
+     * If the shortcut can't be triggered the queued placements are applied
+     * one by one through executePositionScript() instead.
+     */
+    void flushPlacements();
+
+    /**
+     * @brief Hand windows from @p candidates to pending requests in FIFO order
+     */
+    void matchPendingRequests(QStringList candidates);
+
+    /**
+     * @brief Emit positioningTimedOut for and drop expired requests
+     */
+    void expireRequests();
+
+    /**
+     * @brief Export the callback object and load the KWin watcher script once
+     * @return true if windows will be reported through windowAdded()
+     */
+    bool ensureWatcher();
+
+    /**
+     * @brief Unload the watcher script and unregister the callback object
+     */
+    void unloadWatcher();
+
     /**
      * @brief Start the monitoring timer if not already running
      */
@@ -152,7 +241,22 @@ private:
     QTimer *m_monitorTimer = nullptr;
     QList<PositionRequest> m_pendingRequests;
     QStringList m_knownWindowIds;  // Windows we've already seen/positioned
+    QStringList m_availableWindowIds;  // Gamescope windows reported by the watcher, not yet positioned
     bool m_kwinAvailable = false;
+
+    // KWin watcher script state
+    bool m_watcherActive = false;
+    bool m_watcherFailed = false;  // Don't retry loading on every request
+    QString m_watcherObjectPath;
+    QString m_watcherPluginName;
+    QString m_watcherScriptPath;
+    QString m_watcherShortcutName;
+
+    QList<Placement> m_pendingPlacements;
+    bool m_inWatcherCallback = false;
+    bool m_flushScheduled = false;
+
+    static constexpr int DEFAULT_PLACEMENT_FLAGS = NoBorder | KeepAbove | SkipTaskbar;
     
-    static constexpr int MONITOR_INTERVAL_MS = 2000;  // Poll every 2 seconds
+    static constexpr int MONITOR_INTERVAL_MS = 2000;  // Poll/expiry interval
 };
@@ -3,19 +3,36 @@
 
 #include "CouchPlayHelperClient.h"
 #include "../core/Logging.h"
+#include "../core/SessionTrace.h"
+#include "../core/StartupTrace.h"
 
 #include <QDBusConnection>
 #include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
 #include <QDBusReply>
 #include <QDebug>
+#include <QTimer>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 static const QString SERVICE_NAME = QStringLiteral("io.github.hikaps.CouchPlayHelper");
 static const QString OBJECT_PATH = QStringLiteral("/io/github/hikaps/CouchPlayHelper");
 static const QString INTERFACE_NAME = QStringLiteral("io.github.hikaps.CouchPlayHelper");
 
+// polkit actions that no session grant covers, see CouchPlayHelper::AuthorizeAction
+static const QString ACTION_CREATE_USER = QStringLiteral("io.github.hikaps.couchplay.create-user");
+static const QString ACTION_DELETE_USER = QStringLiteral("io.github.hikaps.couchplay.delete-user");
+
 CouchPlayHelperClient::CouchPlayHelperClient(QObject *parent)
     : QObject(parent)
 {
+    StartupTrace::Scope trace("CouchPlayHelperClient");
     m_interface = new QDBusInterface(
         SERVICE_NAME,
         OBJECT_PATH,
@@ -31,15 +48,27 @@ CouchPlayHelperClient::CouchPlayHelperClient(QObject *parent)
         return;
     }
 
-    // Verify we can actually call a method
-    QDBusReply<QString> reply = m_interface->call(QStringLiteral("Version"));
-    if (reply.isValid()) {
+    QDBusConnection::systemBus().connect(SERVICE_NAME, OBJECT_PATH, INTERFACE_NAME,
+        QStringLiteral("UserDeletionProgress"), this, SLOT(onUserDeletionProgress(QString,QString)));
+    QDBusConnection::systemBus().connect(SERVICE_NAME, OBJECT_PATH, INTERFACE_NAME,
+        QStringLiteral("UserDeletionFinished"), this, SLOT(onUserDeletionFinished(QString,bool,QString)));
+    QDBusConnection::systemBus().connect(SERVICE_NAME, OBJECT_PATH, INTERFACE_NAME,
+        QStringLiteral("InstanceExited"), this, SLOT(onInstanceExited(qint64,int,qint64)));
+
+    // Verify we can actually call a method. Activating the helper can take
+    // a while, so don't hold up the first frame; availabilityChanged follows.
+    auto *watcher = new QDBusPendingCallWatcher(m_interface->asyncCall(QStringLiteral("Version")), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *call) {
+        QDBusPendingReply<QString> reply = *call;
+        call->deleteLater();
+        if (reply.isError()) {
+            qWarning() << "CouchPlay helper call failed:" << reply.error().message();
+            return;
+        }
         qWarning() << "CouchPlay helper connected, version:" << reply.value();
         m_available = true;
-    } else {
-        qWarning() << "CouchPlay helper call failed:" << reply.error().message();
-        m_available = false;
-    }
+        Q_EMIT availabilityChanged();
+    });
 }
 
 CouchPlayHelperClient::~CouchPlayHelperClient()
@@ -71,6 +100,10 @@ bool CouchPlayHelperClient::setDeviceOwner(const QString &devicePath, int uid)
         devicePath,
         static_cast<uint>(uid)
     );
+    // A device plugged in after the session grant lapsed
+    if (reauthorize(reply.error())) {
+        reply = m_interface->call(QStringLiteral("ChangeDeviceOwner"), devicePath, static_cast<uint>(uid));
+    }
 
     if (!reply.isValid()) {
         Q_EMIT errorOccurred(reply.error().message());
@@ -124,6 +157,9 @@ bool CouchPlayHelperClient::createUser(const QString &username)
         username,
         fullName
     );
+    if (reauthorize(reply.error(), ACTION_CREATE_USER)) {
+        reply = m_interface->call(QStringLiteral("CreateUser"), username, fullName);
+    }
 
     if (!reply.isValid()) {
         Q_EMIT errorOccurred(reply.error().message());
@@ -134,6 +170,65 @@ bool CouchPlayHelperClient::createUser(const QString &username)
     return reply.value() > 0;
 }
 
+bool CouchPlayHelperClient::createEphemeralUser(const QString &username)
+{
+    if (!m_available) {
+        Q_EMIT errorOccurred(QStringLiteral("Helper not available"));
+        return false;
+    }
+
+    const QString fullName = QStringLiteral("CouchPlay Guest (%1)").arg(username);
+    QDBusReply<uint> reply = m_interface->call(
+        QStringLiteral("CreateEphemeralUser"),
+        username,
+        fullName
+    );
+    if (reauthorize(reply.error(), ACTION_CREATE_USER)) {
+        reply = m_interface->call(QStringLiteral("CreateEphemeralUser"), username, fullName);
+    }
+
+    if (!reply.isValid()) {
+        Q_EMIT errorOccurred(reply.error().message());
+        return false;
+    }
+
+    return reply.value() > 0;
+}
+
+bool CouchPlayHelperClient::saveUserTemplate(const QString &username)
+{
+    if (!m_available) {
+        Q_EMIT errorOccurred(QStringLiteral("Helper not available"));
+        return false;
+    }
+
+    // Reflinking a bootstrapped Steam install takes a while
+    QDBusMessage message = QDBusMessage::createMethodCall(SERVICE_NAME, OBJECT_PATH, INTERFACE_NAME,
+                                                          QStringLiteral("SaveUserTemplate"));
+    message.setArguments({username});
+    QDBusReply<bool> reply = m_interface->connection().call(message, QDBus::Block, 300000);
+    if (reauthorize(reply.error(), ACTION_CREATE_USER)) {
+        reply = m_interface->connection().call(message, QDBus::Block, 300000);
+    }
+
+    if (!reply.isValid()) {
+        Q_EMIT errorOccurred(reply.error().message());
+        return false;
+    }
+
+    return reply.value();
+}
+
+bool CouchPlayHelperClient::hasUserTemplate()
+{
+    if (!m_available) {
+        return false;
+    }
+
+    QDBusReply<bool> reply = m_interface->call(QStringLiteral("HasUserTemplate"));
+    return reply.isValid() && reply.value();
+}
+
 bool CouchPlayHelperClient::deleteUser(const QString &username, bool removeHome)
 {
     if (!m_available) {
@@ -146,6 +241,9 @@ bool CouchPlayHelperClient::deleteUser(const QString &username, bool removeHome)
         username,
         removeHome
     );
+    if (reauthorize(reply.error(), ACTION_DELETE_USER)) {
+        reply = m_interface->call(QStringLiteral("DeleteUser"), username, removeHome);
+    }
 
     if (!reply.isValid()) {
         Q_EMIT errorOccurred(reply.error().message());
@@ -155,6 +253,21 @@ bool CouchPlayHelperClient::deleteUser(const QString &username, bool removeHome)
     return reply.value();
 }
 
+void CouchPlayHelperClient::onUserDeletionProgress(const QString &username, const QString &step)
+{
+    Q_EMIT userDeletionProgress(username, step);
+}
+
+void CouchPlayHelperClient::onUserDeletionFinished(const QString &username, bool success, const QString &error)
+{
+    Q_EMIT userDeletionFinished(username, success, error);
+}
+
+void CouchPlayHelperClient::onInstanceExited(qint64 pid, int status, qint64 runtimeMs)
+{
+    Q_EMIT instanceExited(pid, status, runtimeMs);
+}
+
 bool CouchPlayHelperClient::isInCouchPlayGroup(const QString &username)
 {
     if (!m_available) {
@@ -488,3 +601,388 @@ bool CouchPlayHelperClient::writeFileToUser(const QByteArray &content, const QSt
 
     return result;
 }
+
+QVariantMap CouchPlayHelperClient::copyFileDescriptorToUser(const QDBusUnixFileDescriptor &source,
+                                                           const QString &targetPath, const QString &username)
+{
+    qCDebug(couchplayHelper) << "copyFileDescriptorToUser:" << targetPath << "for" << username;
+
+    if (!m_available) {
+        qCWarning(couchplayHelper) << "copyFileDescriptorToUser: Helper not available";
+        Q_EMIT errorOccurred(QStringLiteral("Helper not available"));
+        return {};
+    }
+
+    QDBusPendingReply<QVariantMap> reply = copyFileDescriptorToUserAsync(source, targetPath, username);
+    reply.waitForFinished();
+    if (reply.isError()) {
+        qCWarning(couchplayHelper) << "copyFileDescriptorToUser failed:" << reply.error().message();
+        Q_EMIT errorOccurred(reply.error().message());
+        return {};
+    }
+
+    const QVariantMap result = reply.value();
+    if (!result.value(QStringLiteral("success")).toBool()) {
+        qCWarning(couchplayHelper) << "copyFileDescriptorToUser:" << result.value(QStringLiteral("error")).toString();
+    } else {
+        qCDebug(couchplayHelper) << "copyFileDescriptorToUser:" << result.value(QStringLiteral("bytes")).toLongLong()
+                                 << "bytes by" << result.value(QStringLiteral("method")).toString()
+                                 << "in" << result.value(QStringLiteral("elapsedMs")).toLongLong() << "ms";
+    }
+    return result;
+}
+
+// ============================================================================
+// Non-blocking API
+// ============================================================================
+
+bool CouchPlayHelperClient::reauthorize(const QDBusError &error, const QString &action)
+{
+    if (error.type() != QDBusError::AccessDenied) {
+        return false;
+    }
+
+    // The helper itself never prompts; these may wait for the user to answer polkit
+    QDBusMessage message = QDBusMessage::createMethodCall(
+        SERVICE_NAME, OBJECT_PATH, INTERFACE_NAME,
+        action.isEmpty() ? QStringLiteral("AuthorizeSession") : QStringLiteral("AuthorizeAction"));
+    if (action.isEmpty()) {
+        const QDBusReply<QVariantMap> reply = m_interface->connection().call(message, QDBus::Block, 300000);
+        return reply.isValid() && reply.value().value(QStringLiteral("authorized")).toBool();
+    }
+    message.setArguments({action});
+    const QDBusReply<bool> reply = m_interface->connection().call(message, QDBus::Block, 300000);
+    return reply.isValid() && reply.value();
+}
+
+QDBusPendingCall CouchPlayHelperClient::callAsync(const QString &method, const QVariantList &arguments,
+                                                  int timeoutMs) const
+{
+    if (!m_available) {
+        return QDBusPendingCall::fromError(
+            QDBusError(QDBusError::ServiceUnknown, QStringLiteral("Helper not available")));
+    }
+
+    QDBusMessage msg = QDBusMessage::createMethodCall(
+        SERVICE_NAME,
+        OBJECT_PATH,
+        INTERFACE_NAME,
+        method
+    );
+    msg.setArguments(arguments);
+
+    QDBusConnection connection = m_interface->connection();
+    // BeginTrace and TakeTrace frame the trace rather than being part of it
+    const quint64 span = method.endsWith(QLatin1String("Trace")) ? 0 : SessionTrace::open("dbus", method);
+    if (span > 0) {
+        // The helper handles one connection's calls in order, so this tags the
+        // call right behind it (see HelperTrace); the reply isn't needed
+        QDBusMessage parent = QDBusMessage::createMethodCall(SERVICE_NAME, OBJECT_PATH, INTERFACE_NAME,
+                                                             QStringLiteral("SetTraceParent"));
+        parent.setArguments({method, qulonglong(span)});
+        connection.send(parent);
+    }
+
+    QDBusPendingCall call = connection.asyncCall(msg, timeoutMs);
+    if (span > 0) {
+        auto *watcher = new QDBusPendingCallWatcher(call, m_interface);
+        connect(watcher, &QDBusPendingCallWatcher::finished, m_interface, [span](QDBusPendingCallWatcher *w) {
+            QVariantMap args;
+            if (w->isError()) {
+                args[QStringLiteral("error")] = w->error().name();
+            }
+            SessionTrace::close(span, args);
+            w->deleteLater();
+        });
+    }
+    return call;
+}
+
+void CouchPlayHelperClient::awaitAll(const QList<QDBusPendingCall> &calls, QObject *context,
+                                     const std::function<void()> &callback)
+{
+    if (calls.isEmpty()) {
+        QTimer::singleShot(0, context, callback);
+        return;
+    }
+
+    auto remaining = std::make_shared<int>(calls.size());
+    for (const QDBusPendingCall &call : calls) {
+        auto *watcher = new QDBusPendingCallWatcher(call, context);
+        connect(watcher, &QDBusPendingCallWatcher::finished, context,
+                [remaining, callback](QDBusPendingCallWatcher *finishedWatcher) {
+            finishedWatcher->deleteLater();
+            if (--(*remaining) == 0) {
+                callback();
+            }
+        });
+    }
+}
+
+void CouchPlayHelperClient::callAuthorized(const std::function<QDBusPendingCall()> &send, QObject *context,
+                                           const std::function<void(const QDBusPendingCall &)> &callback)
+{
+    const QDBusPendingCall first = send();
+    awaitAll({first}, context, [send, context, callback, first]() {
+        if (!first.isError() || first.error().type() != QDBusError::AccessDenied) {
+            if (callback) {
+                callback(first);
+            }
+            return;
+        }
+
+        // The grant lapsed; this may wait for the user to answer polkit
+        const QDBusMessage message = QDBusMessage::createMethodCall(
+            SERVICE_NAME, OBJECT_PATH, INTERFACE_NAME, QStringLiteral("AuthorizeSession"));
+        const QDBusPendingCall authorize = QDBusConnection::systemBus().asyncCall(message, 300000);
+        awaitAll({authorize}, context, [send, context, callback, first, authorize]() {
+            const QDBusPendingReply<QVariantMap> reply = authorize;
+            if (reply.isError() || !reply.value().value(QStringLiteral("authorized")).toBool()) {
+                qCWarning(couchplayHelper) << "Helper denied the call and the session wasn't authorized again";
+                if (callback) {
+                    callback(first);
+                }
+                return;
+            }
+
+            const QDBusPendingCall second = send();
+            awaitAll({second}, context, [callback, second]() {
+                if (callback) {
+                    callback(second);
+                }
+            });
+        });
+    });
+}
+
+QDBusPendingCall CouchPlayHelperClient::completedCall(const QVariant &value)
+{
+    QDBusMessage msg = QDBusMessage::createMethodCall(
+        SERVICE_NAME,
+        OBJECT_PATH,
+        INTERFACE_NAME,
+        QStringLiteral("Version")
+    );
+    return QDBusPendingCall::fromCompletedCall(msg.createReply(value));
+}
+
+QDBusUnixFileDescriptor CouchPlayHelperClient::sealedFileDescriptor(QByteArrayView data)
+{
+    if (!(QDBusConnection::systemBus().connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing)) {
+        return QDBusUnixFileDescriptor();
+    }
+
+    const int fd = memfd_create("couchplay-file", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        qCWarning(couchplayHelper) << "memfd_create failed:" << strerror(errno);
+        return QDBusUnixFileDescriptor();
+    }
+
+    qsizetype written = 0;
+    while (written < data.size()) {
+        const ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            qCWarning(couchplayHelper) << "Failed to fill memfd:" << strerror(errno);
+            close(fd);
+            return QDBusUnixFileDescriptor();
+        }
+        written += n;
+    }
+
+    // Sealed, so the helper reads exactly these bytes
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+        qCWarning(couchplayHelper) << "Failed to seal memfd:" << strerror(errno);
+    }
+
+    QDBusUnixFileDescriptor descriptor;
+    descriptor.giveFileDescriptor(fd);
+    return descriptor;
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::setDeviceOwnerAsync(const QString &devicePath, uint uid)
+{
+    return callAsync(QStringLiteral("ChangeDeviceOwner"), {devicePath, uid});
+}
+
+QDBusPendingReply<int> CouchPlayHelperClient::setDeviceOwnerBatchAsync(const QStringList &devicePaths, uint uid)
+{
+    return callAsync(QStringLiteral("ChangeDeviceOwnerBatch"), {devicePaths, uid});
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::restoreDeviceOwnerAsync(const QString &devicePath)
+{
+    return callAsync(QStringLiteral("ResetDeviceOwner"), {devicePath});
+}
+
+QDBusPendingReply<int> CouchPlayHelperClient::restoreAllDevicesAsync()
+{
+    return callAsync(QStringLiteral("ResetAllDevices"), {});
+}
+
+QDBusPendingReply<QString> CouchPlayHelperClient::routeDeviceAsync(const QString &devicePath, uint uid)
+{
+    return callAsync(QStringLiteral("RouteDevice"), {devicePath, uid});
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::unrouteDeviceAsync(const QString &devicePath)
+{
+    return callAsync(QStringLiteral("UnrouteDevice"), {devicePath});
+}
+
+QDBusPendingReply<int> CouchPlayHelperClient::stopInputRoutingAsync()
+{
+    return callAsync(QStringLiteral("StopInputRouting"), {});
+}
+
+QDBusPendingReply<QVariantMap> CouchPlayHelperClient::inputRouterStatsAsync()
+{
+    return callAsync(QStringLiteral("GetInputRouterStats"), {});
+}
+
+QDBusPendingReply<uint> CouchPlayHelperClient::createUserAsync(const QString &username)
+{
+    QString fullName = QStringLiteral("CouchPlay Player (%1)").arg(username);
+    return callAsync(QStringLiteral("CreateUser"), {username, fullName}, 60000);
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::deleteUserAsync(const QString &username, bool removeHome)
+{
+    return callAsync(QStringLiteral("DeleteUser"), {username, removeHome});
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::authorizeUserDeletionAsync()
+{
+    return callAsync(QStringLiteral("AuthorizeAction"), {ACTION_DELETE_USER}, 300000);
+}
+
+QDBusPendingReply<qint64> CouchPlayHelperClient::launchInstanceAsync(const QString &username, uint compositorUid,
+                                                                     const QStringList &gamescopeArgs,
+                                                                     const QString &gameCommand,
+                                                                     const QStringList &environment)
+{
+    return callAsync(QStringLiteral("LaunchInstance"),
+                     {username, compositorUid, gamescopeArgs, gameCommand, environment});
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::stopInstanceAsync(qint64 pid)
+{
+    return callAsync(QStringLiteral("StopInstance"), {pid});
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::killInstanceAsync(qint64 pid)
+{
+    return callAsync(QStringLiteral("KillInstance"), {pid});
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::setInstanceResourcesAsync(qint64 pid, const QVariantMap &resources)
+{
+    return callAsync(QStringLiteral("SetInstanceResources"), {pid, resources});
+}
+
+QDBusPendingReply<QVariantMap> CouchPlayHelperClient::instanceGpuUsageAsync(qint64 pid)
+{
+    return callAsync(QStringLiteral("GetInstanceGpuUsage"), {pid});
+}
+
+QDBusPendingReply<> CouchPlayHelperClient::beginTraceAsync()
+{
+    return callAsync(QStringLiteral("BeginTrace"), {});
+}
+
+QDBusPendingReply<QVariantMap> CouchPlayHelperClient::takeTraceAsync()
+{
+    return callAsync(QStringLiteral("TakeTrace"), {});
+}
+
+QDBusPendingReply<QVariantMap> CouchPlayHelperClient::metricsAsync()
+{
+    return callAsync(QStringLiteral("GetMetrics"), {});
+}
+
+QDBusPendingReply<QVariantMap> CouchPlayHelperClient::authorizeSessionAsync()
+{
+    // May wait for the user to answer a polkit prompt
+    return callAsync(QStringLiteral("AuthorizeSession"), {}, 300000);
+}
+
+QDBusPendingReply<> CouchPlayHelperClient::endSessionAsync()
+{
+    return callAsync(QStringLiteral("EndSession"), {});
+}
+
+QDBusPendingReply<QVariantMap> CouchPlayHelperClient::readInstanceLogAsync(const QString &username,
+                                                                          const QString &cursor, int maxLines)
+{
+    return callAsync(QStringLiteral("ReadInstanceLog"), {username, cursor, maxLines});
+}
+
+QDBusPendingReply<int> CouchPlayHelperClient::mountSharedDirectoriesAsync(const QString &username, uint compositorUid,
+                                                                          const QStringList &directories)
+{
+    if (directories.isEmpty() && m_available) {
+        // Nothing to mount, that's fine
+        return completedCall(0);
+    }
+    return callAsync(QStringLiteral("MountSharedDirectories"), {username, compositorUid, directories});
+}
+
+QDBusPendingReply<int> CouchPlayHelperClient::unmountSharedDirectoriesAsync(const QString &username)
+{
+    return callAsync(QStringLiteral("UnmountSharedDirectories"), {username});
+}
+
+QDBusPendingReply<int> CouchPlayHelperClient::unmountAllSharedDirectoriesAsync()
+{
+    return callAsync(QStringLiteral("UnmountAllSharedDirectories"), {});
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::copyFileToUserAsync(const QString &sourcePath, const QString &targetPath,
+                                                                   const QString &username)
+{
+    return callAsync(QStringLiteral("CopyFileToUser"), {sourcePath, targetPath, username}, 30000);
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::createUserDirectoryAsync(const QString &path, const QString &username)
+{
+    return callAsync(QStringLiteral("CreateUserDirectory"), {path, username});
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::setDirectoryAclAsync(const QString &path, const QString &username,
+                                                                    bool recursive)
+{
+    // A recursive ACL walk over a large, not yet prepared library can take a while
+    return callAsync(QStringLiteral("SetDirectoryAcl"), {path, username, recursive}, 120000);
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::setPathAclWithParentsAsync(const QString &path, const QString &username)
+{
+    return callAsync(QStringLiteral("SetPathAclWithParents"), {path, username});
+}
+
+QDBusPendingReply<QString> CouchPlayHelperClient::getUserSteamIdAsync(const QString &username)
+{
+    return callAsync(QStringLiteral("GetUserSteamId"), {username});
+}
+
+QDBusPendingReply<bool> CouchPlayHelperClient::writeFileToUserAsync(const QByteArray &content, const QString &targetPath,
+                                                                    const QString &username)
+{
+    return callAsync(QStringLiteral("WriteFileToUser"), {content, targetPath, username}, 30000);
+}
+
+QDBusPendingReply<QVariantMap> CouchPlayHelperClient::copyFileDescriptorToUserAsync(
+    const QDBusUnixFileDescriptor &source, const QString &targetPath, const QString &username)
+{
+    return callAsync(QStringLiteral("CopyFileDescriptorToUser"),
+                     {QVariant::fromValue(source), targetPath, username}, 30000);
+}
+
+QDBusPendingReply<QVariantMap> CouchPlayHelperClient::prepareInstanceAsync(const QString &username, uint compositorUid,
+                                                                           const PrepareInstanceSpec &spec)
+{
+    // May include recursive ACLs and a launch, so allow well beyond the per-step limits
+    return callAsync(QStringLiteral("PrepareInstance"), {username, compositorUid, spec.toVariantMap()}, 120000);
+}
@@ -4,13 +4,30 @@
 #pragma once
 
 #include <QObject>
+#include <QByteArrayView>
 #include <QDBusInterface>
+#include <QDBusPendingCall>
+#include <QDBusPendingReply>
+#include <QDBusUnixFileDescriptor>
+#include <QList>
 #include <QString>
 #include <QStringList>
+#include <QVariantMap>
 #include <qqmlintegration.h>
 
+#include <functional>
+
+#include "../../helper/PrepareInstanceSpec.h"
+
 /**
  * @brief D-Bus client for the privileged CouchPlay helper
+ *
+ * Every helper method is available in two flavours:
+ * - a blocking wrapper (e.g. setDeviceOwner()) that waits for the reply and
+ *   emits errorOccurred() on failure, used by QML and tests
+ * - a non-blocking *Async() variant that sends the request and returns a
+ *   QDBusPendingReply immediately, so callers can keep several requests in
+ *   flight and handle them together with awaitAll()
  */
 class CouchPlayHelperClient : public QObject
 {
@@ -47,13 +64,28 @@ public:
      */
     Q_INVOKABLE bool createUser(const QString &username);
 
+    /**
+     * @brief Create a throwaway player whose home is cloned from the saved template
+     */
+    Q_INVOKABLE bool createEphemeralUser(const QString &username);
+
+    /**
+     * @brief Save @p username's home as the template for ephemeral players
+     */
+    Q_INVOKABLE bool saveUserTemplate(const QString &username);
+
+    /**
+     * @brief Whether a template for ephemeral players has been saved
+     */
+    Q_INVOKABLE bool hasUserTemplate();
+
     /**
      * @brief Delete a CouchPlay user account
      * Only users in the couchplay group can be deleted
      * 
      * @param username Username to delete (must be in couchplay group)
      * @param removeHome If true, also delete the user's home directory
-     * @return true if successful
+     * @return true if the helper started the deletion; userDeletionFinished() follows
      */
     Q_INVOKABLE bool deleteUser(const QString &username, bool removeHome);
 
@@ -178,11 +210,170 @@ public:
     Q_INVOKABLE bool writeFileToUser(const QByteArray &content, const QString &targetPath,
                                       const QString &username);
 
+    /**
+     * @brief Copy a file into a user's directory by passing its descriptor
+     *
+     * Only the descriptor travels over the bus, see
+     * CouchPlayHelper::CopyFileDescriptorToUser for the result map.
+     *
+     * @param source Regular file or memfd holding the content, see sealedFileDescriptor()
+     * @param targetPath Target file path inside the user's home (will be created/overwritten)
+     * @param username Target user (file will be owned by this user)
+     * @return "success", "bytes", "elapsedMs", "method" and "error"
+     */
+    QVariantMap copyFileDescriptorToUser(const QDBusUnixFileDescriptor &source, const QString &targetPath,
+                                         const QString &username);
+
+    // Non-blocking API
+    //
+    // These return immediately. When the helper is unavailable the returned
+    // reply is already finished with an error. Callers inspect isError()/value()
+    // once the call has finished (see awaitAll()); errorOccurred() is not emitted.
+
+    virtual QDBusPendingReply<bool> setDeviceOwnerAsync(const QString &devicePath, uint uid);
+    QDBusPendingReply<int> setDeviceOwnerBatchAsync(const QStringList &devicePaths, uint uid);
+    QDBusPendingReply<bool> restoreDeviceOwnerAsync(const QString &devicePath);
+    virtual QDBusPendingReply<int> restoreAllDevicesAsync();
+    virtual QDBusPendingReply<QString> routeDeviceAsync(const QString &devicePath, uint uid);
+    virtual QDBusPendingReply<bool> unrouteDeviceAsync(const QString &devicePath);
+    QDBusPendingReply<int> stopInputRoutingAsync();
+    QDBusPendingReply<QVariantMap> inputRouterStatsAsync();
+    QDBusPendingReply<uint> createUserAsync(const QString &username);
+    virtual QDBusPendingReply<bool> deleteUserAsync(const QString &username, bool removeHome);
+    /**
+     * @brief One-shot grant for the next DeleteUser, see CouchPlayHelper::AuthorizeAction
+     *
+     * May wait for the user to answer a polkit prompt.
+     */
+    virtual QDBusPendingReply<bool> authorizeUserDeletionAsync();
+    virtual QDBusPendingReply<qint64> launchInstanceAsync(const QString &username, uint compositorUid,
+                                                          const QStringList &gamescopeArgs,
+                                                          const QString &gameCommand,
+                                                          const QStringList &environment);
+    QDBusPendingReply<bool> stopInstanceAsync(qint64 pid);
+    QDBusPendingReply<bool> killInstanceAsync(qint64 pid);
+    /**
+     * @brief Change cgroup controls of a running instance, see CouchPlayHelper::SetInstanceResources
+     */
+    QDBusPendingReply<bool> setInstanceResourcesAsync(qint64 pid, const QVariantMap &resources);
+    /**
+     * @brief GPU usage of an instance, a DrmFdinfo map, see CouchPlayHelper::GetInstanceGpuUsage
+     */
+    QDBusPendingReply<QVariantMap> instanceGpuUsageAsync(qint64 pid);
+    /**
+     * @brief Start and collect the helper's side of a SessionTrace, see CouchPlayHelper::BeginTrace
+     */
+    QDBusPendingReply<> beginTraceAsync();
+    QDBusPendingReply<QVariantMap> takeTraceAsync();
+    /**
+     * @brief Call counts and latencies of the helper, see CouchPlayHelper::GetMetrics
+     */
+    QDBusPendingReply<QVariantMap> metricsAsync();
+    /**
+     * @brief Authorize this connection for a session's calls, see CouchPlayHelper::AuthorizeSession
+     */
+    virtual QDBusPendingReply<QVariantMap> authorizeSessionAsync();
+    QDBusPendingReply<> endSessionAsync();
+    /**
+     * @brief Journal entries of a player's instance, see CouchPlayHelper::ReadInstanceLog
+     */
+    virtual QDBusPendingReply<QVariantMap> readInstanceLogAsync(const QString &username, const QString &cursor,
+                                                                int maxLines);
+    virtual QDBusPendingReply<int> mountSharedDirectoriesAsync(const QString &username, uint compositorUid,
+                                                               const QStringList &directories);
+    virtual QDBusPendingReply<int> unmountSharedDirectoriesAsync(const QString &username);
+    virtual QDBusPendingReply<int> unmountAllSharedDirectoriesAsync();
+    QDBusPendingReply<bool> copyFileToUserAsync(const QString &sourcePath, const QString &targetPath,
+                                                const QString &username);
+    QDBusPendingReply<bool> createUserDirectoryAsync(const QString &path, const QString &username);
+    QDBusPendingReply<bool> setDirectoryAclAsync(const QString &path, const QString &username, bool recursive);
+    virtual QDBusPendingReply<bool> setPathAclWithParentsAsync(const QString &path, const QString &username);
+    QDBusPendingReply<QString> getUserSteamIdAsync(const QString &username);
+    virtual QDBusPendingReply<bool> writeFileToUserAsync(const QByteArray &content, const QString &targetPath,
+                                                         const QString &username);
+    virtual QDBusPendingReply<QVariantMap> copyFileDescriptorToUserAsync(const QDBusUnixFileDescriptor &source,
+                                                                         const QString &targetPath,
+                                                                         const QString &username);
+
+    /**
+     * @brief Run all setup steps for one player in a single helper call
+     *
+     * See CouchPlayHelper::PrepareInstance for the layout of the result map.
+     *
+     * @param username Target user
+     * @param compositorUid UID of the compositor user
+     * @param spec Steps to run
+     */
+    virtual QDBusPendingReply<QVariantMap> prepareInstanceAsync(const QString &username, uint compositorUid,
+                                                                const PrepareInstanceSpec &spec);
+
+    /**
+     * @brief Invoke a callback once every call in a set has finished
+     *
+     * The callback runs on the event loop even if all calls have already
+     * finished (or the list is empty). It is dropped if @p context is
+     * destroyed first.
+     *
+     * @param calls Pending calls to wait for
+     * @param context Object owning the watchers and the callback
+     * @param callback Invoked once, after the last call finishes
+     */
+    static void awaitAll(const QList<QDBusPendingCall> &calls, QObject *context,
+                         const std::function<void()> &callback);
+
+    /**
+     * @brief Send a call, and once more after AuthorizeSession if the helper denied it
+     *
+     * For calls that have to go through after the session's grant has lapsed,
+     * like stopping instances or relaunching one. @p send builds the call and
+     * may run twice; @p callback gets the last reply. Both are dropped if
+     * @p context is destroyed first.
+     *
+     * @param send Sends the call
+     * @param context Object owning the watchers and the callback
+     * @param callback Invoked once with the final reply, may be empty
+     */
+    static void callAuthorized(const std::function<QDBusPendingCall()> &send, QObject *context,
+                               const std::function<void(const QDBusPendingCall &)> &callback = {});
+
+    /**
+     * @brief Build an already-finished successful reply carrying @p value
+     *
+     * Used by test doubles that override the *Async() methods.
+     */
+    static QDBusPendingCall completedCall(const QVariant &value);
+
+    /**
+     * @brief A sealed, read-only memfd holding @p data
+     *
+     * For passing file content to the helper without copying it onto the
+     * bus. Invalid if the system bus can't carry file descriptors or the
+     * memfd could not be created; callers then fall back to the bytes.
+     */
+    static QDBusUnixFileDescriptor sealedFileDescriptor(QByteArrayView data);
+
 Q_SIGNALS:
     void availabilityChanged();
     void errorOccurred(const QString &message);
+    // Forwarded from the helper, see CouchPlayHelper::DeleteUser
+    void userDeletionProgress(const QString &username, const QString &step);
+    void userDeletionFinished(const QString &username, bool success, const QString &error);
+    // Forwarded from the helper, see CouchPlayHelper::InstanceExited
+    void instanceExited(qint64 pid, int status, qint64 runtimeMs);
+
+private Q_SLOTS:
+    void onUserDeletionProgress(const QString &username, const QString &step);
+    void onUserDeletionFinished(const QString &username, bool success, const QString &error);
+    void onInstanceExited(qint64 pid, int status, qint64 runtimeMs);
 
 private:
+    QDBusPendingCall callAsync(const QString &method, const QVariantList &arguments,
+                               int timeoutMs = -1) const;
+    // After an AccessDenied @p error, asks the helper to authorize @p action
+    // (the session's actions when empty), prompting if needed; true if the
+    // call is worth repeating
+    bool reauthorize(const QDBusError &error, const QString &action = QString());
+
     QDBusInterface *m_interface = nullptr;
     bool m_available = false;
 };
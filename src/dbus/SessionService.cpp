@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include "SessionService.h"
+#include "DeviceManager.h"
+#include "Logging.h"
+#include "SessionManager.h"
+#include "SessionRunner.h"
+
+#include <QDBusConnection>
+#include <QDBusError>
+
+const QString SessionService::SERVICE_NAME = QStringLiteral("io.github.hikaps.couchplay");
+const QString SessionService::OBJECT_PATH = QStringLiteral("/Session");
+const QString SessionService::INTERFACE_NAME = QStringLiteral("io.github.hikaps.couchplay.Session");
+
+SessionService::SessionService(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SessionService::~SessionService()
+{
+    if (m_registered) {
+        QDBusConnection bus = QDBusConnection::sessionBus();
+        bus.unregisterObject(OBJECT_PATH);
+        bus.unregisterService(SERVICE_NAME);
+    }
+}
+
+void SessionService::setSessionRunner(SessionRunner *runner)
+{
+    if (m_runner == runner) {
+        return;
+    }
+    if (m_runner) {
+        disconnect(m_runner, nullptr, this, nullptr);
+    }
+    m_runner = runner;
+    if (m_runner) {
+        connect(m_runner, &SessionRunner::sessionStarted, this, &SessionService::SessionStarted);
+        connect(m_runner, &SessionRunner::sessionStopped, this, &SessionService::SessionStopped);
+        connect(m_runner, &SessionRunner::errorOccurred, this, [this](const QString &message) {
+            m_lastError = message;
+            Q_EMIT ErrorOccurred(message);
+        });
+    }
+    Q_EMIT sessionRunnerChanged();
+}
+
+void SessionService::setSessionManager(SessionManager *manager)
+{
+    if (m_sessionManager == manager) {
+        return;
+    }
+    if (m_sessionManager) {
+        disconnect(m_sessionManager, nullptr, this, nullptr);
+    }
+    m_sessionManager = manager;
+    if (m_sessionManager) {
+        connect(m_sessionManager, &SessionManager::errorOccurred, this, [this](const QString &message) {
+            m_lastError = message;
+        });
+    }
+    Q_EMIT sessionManagerChanged();
+}
+
+void SessionService::setDeviceManager(DeviceManager *manager)
+{
+    if (m_deviceManager != manager) {
+        m_deviceManager = manager;
+        Q_EMIT deviceManagerChanged();
+    }
+}
+
+bool SessionService::registerOnBus()
+{
+    if (m_registered) {
+        return true;
+    }
+
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        qCWarning(couchplayCore) << "SessionService: no session bus";
+        return false;
+    }
+    if (!bus.registerService(SERVICE_NAME)) {
+        qCDebug(couchplayCore) << "SessionService:" << SERVICE_NAME << "is taken:" << bus.lastError().message();
+        return false;
+    }
+    if (!bus.registerObject(OBJECT_PATH, this,
+                            QDBusConnection::ExportScriptableSlots | QDBusConnection::ExportScriptableSignals)) {
+        qCWarning(couchplayCore) << "SessionService: cannot export" << OBJECT_PATH << ":" << bus.lastError().message();
+        bus.unregisterService(SERVICE_NAME);
+        return false;
+    }
+
+    m_registered = true;
+    Q_EMIT registeredChanged();
+    return true;
+}
+
+int SessionService::resolveDevice(const QString &device) const
+{
+    if (!m_deviceManager) {
+        return -1;
+    }
+
+    QString node = device;
+    if (node.startsWith(QLatin1String("/dev/input/"))) {
+        node = node.mid(11);
+    }
+    if (node.startsWith(QLatin1String("event"))) {
+        node = node.mid(5);
+    }
+    bool ok = false;
+    const int eventNumber = node.toInt(&ok);
+    if (ok) {
+        return eventNumber >= 0 && !m_deviceManager->getDevice(eventNumber).isEmpty() ? eventNumber : -1;
+    }
+    return m_deviceManager->findDeviceByStableId(device);
+}
+
+void SessionService::fail(const QString &message)
+{
+    if (calledFromDBus()) {
+        sendErrorReply(QDBusError::Failed, message);
+    } else {
+        qCWarning(couchplayCore) << "SessionService:" << message;
+    }
+}
+
+bool SessionService::Start(const QString &profile)
+{
+    if (!m_runner || !m_sessionManager) {
+        fail(QStringLiteral("No session runner"));
+        return false;
+    }
+
+    m_lastError.clear();
+    if (!profile.isEmpty() && profile != m_sessionManager->currentProfile().name) {
+        // Never swap the profile out from under a running session
+        if (m_runner->isRunning() || m_runner->isStarting() || m_runner->isStopping()) {
+            fail(QStringLiteral("Session already running"));
+            return false;
+        }
+        if (!m_sessionManager->loadProfile(profile)) {
+            fail(m_lastError.isEmpty() ? QStringLiteral("Profile not found: %1").arg(profile) : m_lastError);
+            return false;
+        }
+    }
+
+    if (!m_runner->start()) {
+        fail(m_lastError.isEmpty() ? QStringLiteral("Session could not be started") : m_lastError);
+        return false;
+    }
+    return true;
+}
+
+bool SessionService::Resume()
+{
+    if (!m_runner) {
+        fail(QStringLiteral("No session runner"));
+        return false;
+    }
+
+    m_lastError.clear();
+    if (!m_runner->resume()) {
+        fail(m_lastError.isEmpty() ? QStringLiteral("Session could not be resumed") : m_lastError);
+        return false;
+    }
+    return true;
+}
+
+void SessionService::Stop()
+{
+    if (m_runner && (m_runner->isRunning() || m_runner->isStarting())) {
+        m_runner->stop();
+    }
+}
+
+QVariantMap SessionService::Status()
+{
+    QVariantMap status;
+    if (!m_runner) {
+        return status;
+    }
+    status[QStringLiteral("running")] = m_runner->isRunning();
+    status[QStringLiteral("starting")] = m_runner->isStarting();
+    status[QStringLiteral("stopping")] = m_runner->isStopping();
+    status[QStringLiteral("status")] = m_runner->status();
+    status[QStringLiteral("profile")] = m_sessionManager ? m_sessionManager->currentProfile().name : QString();
+    status[QStringLiteral("instances")] = m_runner->instancesAsVariant();
+    return status;
+}
+
+bool SessionService::AssignDevice(const QString &device, int player)
+{
+    if (!m_deviceManager || !m_sessionManager) {
+        fail(QStringLiteral("No device manager"));
+        return false;
+    }
+    if (player < -1 || player >= m_sessionManager->currentProfile().instances.size()) {
+        fail(QStringLiteral("No player %1 in this profile").arg(player + 1));
+        return false;
+    }
+
+    const int eventNumber = resolveDevice(device);
+    if (eventNumber < 0) {
+        fail(QStringLiteral("No such device: %1").arg(device));
+        return false;
+    }
+    if (!m_deviceManager->assignDevice(eventNumber, player)) {
+        fail(QStringLiteral("Could not assign %1").arg(device));
+        return false;
+    }
+    return true;
+}
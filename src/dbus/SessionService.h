@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#pragma once
+
+#include <QDBusContext>
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+#include <qqmlintegration.h>
+
+class DeviceManager;
+class SessionManager;
+class SessionRunner;
+
+/**
+ * @brief Session control on the session bus, for scripts and shortcuts
+ *
+ * Exports Start, Resume, Stop, Status and AssignDevice as
+ * io.github.hikaps.couchplay.Session on /Session of the
+ * io.github.hikaps.couchplay service, in front of whichever SessionRunner
+ * runs: the GUI's, or the one of `couchplay --headless`. Only members
+ * marked Q_SCRIPTABLE are exported.
+ *
+ * @code
+ * busctl --user call io.github.hikaps.couchplay /Session \
+ *     io.github.hikaps.couchplay.Session Start s "Living room"
+ * @endcode
+ */
+class SessionService : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    QML_ELEMENT
+    Q_CLASSINFO("D-Bus Interface", "io.github.hikaps.couchplay.Session")
+
+    Q_PROPERTY(SessionRunner* sessionRunner READ sessionRunner WRITE setSessionRunner NOTIFY sessionRunnerChanged)
+    Q_PROPERTY(SessionManager* sessionManager READ sessionManager WRITE setSessionManager NOTIFY sessionManagerChanged)
+    Q_PROPERTY(DeviceManager* deviceManager READ deviceManager WRITE setDeviceManager NOTIFY deviceManagerChanged)
+    Q_PROPERTY(bool registered READ isRegistered NOTIFY registeredChanged)
+
+public:
+    static const QString SERVICE_NAME;
+    static const QString OBJECT_PATH;
+    static const QString INTERFACE_NAME;
+
+    explicit SessionService(QObject *parent = nullptr);
+    ~SessionService() override;
+
+    SessionRunner* sessionRunner() const { return m_runner; }
+    void setSessionRunner(SessionRunner *runner);
+
+    SessionManager* sessionManager() const { return m_sessionManager; }
+    void setSessionManager(SessionManager *manager);
+
+    DeviceManager* deviceManager() const { return m_deviceManager; }
+    void setDeviceManager(DeviceManager *manager);
+
+    /**
+     * @brief Claim the service name and export the object
+     *
+     * Fails if another CouchPlay (GUI or headless) already owns the name;
+     * that one is then the one to talk to.
+     */
+    Q_INVOKABLE bool registerOnBus();
+    bool isRegistered() const { return m_registered; }
+
+    /**
+     * @brief Event number of @p device: "/dev/input/eventN", "eventN", "N" or a stableId
+     *
+     * @return -1 if there is no such device
+     */
+    int resolveDevice(const QString &device) const;
+
+public Q_SLOTS:
+    /**
+     * @brief Start profile @p profile, or the current one if empty
+     */
+    Q_SCRIPTABLE bool Start(const QString &profile);
+
+    /**
+     * @brief Start the last session again, see SessionRunner::resume()
+     */
+    Q_SCRIPTABLE bool Resume();
+
+    /**
+     * @brief Stop the running session; returns before the players have exited
+     */
+    Q_SCRIPTABLE void Stop();
+
+    /**
+     * @brief "running", "starting", "stopping", "status", "profile" and "instances"
+     *
+     * "instances" holds SessionRunner::instancesAsVariant().
+     */
+    Q_SCRIPTABLE QVariantMap Status();
+
+    /**
+     * @brief Give @p device (see resolveDevice()) to @p player, -1 to unassign it
+     *
+     * Saved with the profile like an assignment in the UI; during a routed
+     * session it takes effect immediately.
+     */
+    Q_SCRIPTABLE bool AssignDevice(const QString &device, int player);
+
+Q_SIGNALS:
+    Q_SCRIPTABLE void SessionStarted();
+    Q_SCRIPTABLE void SessionStopped();
+    Q_SCRIPTABLE void ErrorOccurred(const QString &message);
+
+    void sessionRunnerChanged();
+    void sessionManagerChanged();
+    void deviceManagerChanged();
+    void registeredChanged();
+
+private:
+    // Reply with @p message if called over the bus, log it otherwise
+    void fail(const QString &message);
+
+    SessionRunner *m_runner = nullptr;
+    SessionManager *m_sessionManager = nullptr;
+    DeviceManager *m_deviceManager = nullptr;
+    bool m_registered = false;
+    QString m_lastError; // Last errorOccurred() of the runner, for failed calls
+};
@@ -2,25 +2,38 @@
 // SPDX-FileCopyrightText: 2024 hikaps
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDBusInterface>
+#include <QDBusReply>
 #include <QQmlApplicationEngine>
 #include <QQuickStyle>
+#include <QQuickWindow>
 #include <QIcon>
 #include <QtQml>
 
 #include <KLocalizedContext>
 #include <KLocalizedString>
 #include <KIconTheme>
+#include <KSignalHandler>
+
+#include <csignal>
 
 #include "core/DeviceManager.h"
 #include "core/SessionManager.h"
 #include "core/SessionRunner.h"
 #include "core/GamescopeInstance.h"
+#include "core/InstancePool.h"
 #include "core/UserManager.h"
 #include "core/MonitorManager.h"
 #include "core/GameLibrary.h"
 #include "core/AudioManager.h"
+#include "core/HeroicConfigManager.h"
 #include "core/PresetManager.h"
+#include "core/SettingsManager.h"
+#include "core/StartupTrace.h"
+#include "core/SteamConfigManager.h"
 #include "dbus/CouchPlayHelperClient.h"
+#include "dbus/SessionService.h"
 
 // Custom message handler to filter noisy Qt warnings
 static QtMessageHandler s_originalHandler = nullptr;
@@ -37,25 +50,176 @@ void couchplayMessageHandler(QtMsgType type, const QMessageLogContext &context,
     }
 }
 
+static void setApplicationMetadata()
+{
+    KLocalizedString::setApplicationDomain("couchplay");
+    QCoreApplication::setOrganizationName(QStringLiteral("hikaps"));
+    QCoreApplication::setOrganizationDomain(QStringLiteral("github.com/hikaps"));
+    QCoreApplication::setApplicationName(QStringLiteral("CouchPlay"));
+    QCoreApplication::setApplicationVersion(QStringLiteral("0.1.0"));
+}
+
+static const QCommandLineOption s_headlessOption(
+    QStringLiteral("headless"), QStringLiteral("Run without the window, controlled through D-Bus (io.github.hikaps.couchplay)."));
+static const QCommandLineOption s_profileOption(
+    QStringLiteral("profile"), QStringLiteral("With --headless: start profile <name>, exit when the session ends."),
+    QStringLiteral("name"));
+static const QCommandLineOption s_resumeOption(
+    QStringLiteral("resume"), QStringLiteral("With --headless: start the last session again, exit when it ends."));
+
+static void processArguments(QCommandLineParser &parser, const QCoreApplication &app)
+{
+    parser.setApplicationDescription(QStringLiteral("Split-screen gaming sessions"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOption(s_headlessOption);
+    parser.addOption(s_profileOption);
+    parser.addOption(s_resumeOption);
+    parser.process(app);
+}
+
+// Sessions without the UI: the managers Main.qml creates, wired up the same
+// way, but no QML engine, widgets or Kirigami. Screens are still needed for
+// the layout, hence QGuiApplication.
+static int runHeadless(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+    setApplicationMetadata();
+
+    QCommandLineParser parser;
+    processArguments(parser, app);
+    const QString profile = parser.value(s_profileOption);
+    const bool resume = parser.isSet(s_resumeOption);
+    const bool oneShot = resume || !profile.isEmpty();
+
+    // Claimed before anything else is set up: if another CouchPlay has it,
+    // that one runs the session
+    SessionService service;
+    if (!service.registerOnBus()) {
+        if (!oneShot) {
+            qCritical() << "CouchPlay is already running";
+            return 1;
+        }
+        QDBusInterface remote(SessionService::SERVICE_NAME, SessionService::OBJECT_PATH,
+                              SessionService::INTERFACE_NAME);
+        const QDBusReply<bool> reply = resume ? remote.call(QStringLiteral("Resume"))
+                                              : remote.call(QStringLiteral("Start"), profile);
+        if (!reply.isValid()) {
+            qCritical() << "Could not start the session:" << reply.error().message();
+            return 1;
+        }
+        return reply.value() ? 0 : 1;
+    }
+
+    SettingsManager settings;
+    CouchPlayHelperClient helper;
+    DeviceManager devices;
+    devices.setSettingsManager(&settings);
+    SessionManager sessions;
+    AudioManager audio;
+    MonitorManager monitors;
+    HeroicConfigManager heroic;
+    SteamConfigManager steam;
+    steam.setHelperClient(&helper);
+    PresetManager presets;
+    presets.setHeroicConfigManager(&heroic);
+    presets.setSteamConfigManager(&steam);
+
+    SessionRunner runner;
+    runner.setSessionManager(&sessions);
+    runner.setDeviceManager(&devices);
+    runner.setAudioManager(&audio);
+    runner.setHelperClient(&helper);
+    runner.setPresetManager(&presets);
+    runner.setSteamConfigManager(&steam);
+    runner.setMonitorManager(&monitors);
+    runner.setInputRouting(settings.inputRouting());
+    runner.setBorderlessWindows(settings.borderlessWindows());
+    runner.instancePool()->setEnabled(settings.warmStandby());
+    runner.instancePool()->setPrelaunch(settings.prelaunchInstances());
+    runner.instancePool()->setIdleTimeoutMinutes(settings.standbyIdleTimeout());
+    runner.instancePool()->setMemoryLimitMb(settings.standbyMemoryLimit());
+
+    // As in Main.qml: assignments are restored with a profile and saved back to it
+    QObject::connect(&sessions, &SessionManager::profileLoaded, &devices,
+                     [&devices](const QVariantMap &deviceInfoByInstance) {
+        devices.clearPendingDevicesForInstance(-1);
+        for (auto it = deviceInfoByInstance.constBegin(); it != deviceInfoByInstance.constEnd(); ++it) {
+            const QVariantMap info = it.value().toMap();
+            const QStringList stableIds = info.value(QStringLiteral("stableIds")).toStringList();
+            if (!stableIds.isEmpty()) {
+                devices.restoreAssignmentsFromStableIds(it.key().toInt(), stableIds,
+                                                        info.value(QStringLiteral("names")).toStringList());
+            }
+        }
+    });
+    QObject::connect(&devices, &DeviceManager::deviceAssigned, &sessions,
+                     [&devices, &sessions](int, int instanceIndex, int previousInstanceIndex) {
+        if (instanceIndex >= 0) {
+            sessions.setInstanceDeviceStableIds(instanceIndex, devices.getStableIdsForInstance(instanceIndex),
+                                                devices.getDeviceNamesForInstance(instanceIndex));
+        }
+        if (previousInstanceIndex >= 0 && previousInstanceIndex != instanceIndex) {
+            sessions.setInstanceDeviceStableIds(previousInstanceIndex,
+                                                devices.getStableIdsForInstance(previousInstanceIndex),
+                                                devices.getDeviceNamesForInstance(previousInstanceIndex));
+        }
+    });
+    QObject::connect(&runner, &SessionRunner::errorOccurred, &app, [](const QString &message) {
+        qWarning().noquote() << message;
+    });
+
+    service.setSessionRunner(&runner);
+    service.setSessionManager(&sessions);
+    service.setDeviceManager(&devices);
+
+    // Ctrl+C or SIGTERM stops the players first; a second one doesn't wait
+    KSignalHandler::self()->watchSignal(SIGINT);
+    KSignalHandler::self()->watchSignal(SIGTERM);
+    QObject::connect(KSignalHandler::self(), &KSignalHandler::signalReceived, &app, [&runner, &app](int) {
+        if ((runner.isRunning() || runner.isStarting()) && !runner.isStopping()) {
+            QObject::connect(&runner, &SessionRunner::sessionStopped, &app, &QCoreApplication::quit);
+            runner.stop();
+        } else {
+            app.quit();
+        }
+    });
+
+    if (oneShot) {
+        if (resume ? !runner.resume() : !(sessions.loadProfile(profile) && runner.start())) {
+            return 1;
+        }
+        QObject::connect(&runner, &SessionRunner::sessionStopped, &app, &QCoreApplication::quit);
+    }
+
+    return app.exec();
+}
+
 int main(int argc, char *argv[])
 {
     // Install custom message handler before QApplication
     s_originalHandler = qInstallMessageHandler(couchplayMessageHandler);
 
+    // The application class depends on it, so look before creating one
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--headless") == 0) {
+            return runHeadless(argc, argv);
+        }
+    }
+
     // Initialize KDE icon theme before QApplication
     KIconTheme::initTheme();
 
     QApplication app(argc, argv);
 
     // Set application metadata
-    KLocalizedString::setApplicationDomain("couchplay");
-    QApplication::setOrganizationName(QStringLiteral("hikaps"));
-    QApplication::setOrganizationDomain(QStringLiteral("github.com/hikaps"));
-    QApplication::setApplicationName(QStringLiteral("CouchPlay"));
-    QApplication::setApplicationVersion(QStringLiteral("0.1.0"));
+    setApplicationMetadata();
     QApplication::setDesktopFileName(QStringLiteral("io.github.hikaps.couchplay"));
     QApplication::setWindowIcon(QIcon::fromTheme(QStringLiteral("io.github.hikaps.couchplay")));
 
+    QCommandLineParser parser;
+    processArguments(parser, app);
+
     // Set Qt Quick style
     QApplication::setStyle(QStringLiteral("breeze"));
     if (qEnvironmentVariableIsEmpty("QT_QUICK_CONTROLS_STYLE")) {
@@ -70,12 +234,21 @@ int main(int argc, char *argv[])
     // Add i18n context
     engine.rootContext()->setContextObject(new KLocalizedContext(&engine));
 
-    // Load main QML file
-    engine.loadFromModule("io.github.hikaps.couchplay", "Main");
+    // Load main QML file; managers trace their own share of this
+    {
+        StartupTrace::Scope trace("QML load");
+        engine.loadFromModule("io.github.hikaps.couchplay", "Main");
+    }
 
     if (engine.rootObjects().isEmpty()) {
         return -1;
     }
 
+    // Rendering runs on its own thread; the report is queued back to this one
+    if (auto *window = qobject_cast<QQuickWindow *>(engine.rootObjects().constFirst())) {
+        QObject::connect(window, &QQuickWindow::frameSwapped, &app, &StartupTrace::firstFrame,
+                         Qt::SingleShotConnection);
+    }
+
     return app.exec();
 }
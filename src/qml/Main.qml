@@ -7,8 +7,6 @@ import QtQuick.Controls as Controls
 import org.kde.kirigami as Kirigami
 import io.github.hikaps.couchplay 1.0
 
-import "pages"
-
 Kirigami.ApplicationWindow {
     id: root
 
@@ -49,6 +47,12 @@ Kirigami.ApplicationWindow {
             applicationWindow().showPassiveNotification(
                 i18nc("@info", "%1 reconnected to Player %2", name, instanceIndex + 1))
         }
+
+        onBatteryLow: function(name, level, instanceIndex) {
+            applicationWindow().showPassiveNotification(instanceIndex >= 0
+                ? i18nc("@info", "Player %1: %2 battery low (%3%)", instanceIndex + 1, name, level)
+                : i18nc("@info", "%1 battery low (%2%)", name, level), "long")
+        }
     }
 
     SessionManager {
@@ -74,13 +78,39 @@ Kirigami.ApplicationWindow {
         }
     }
 
+    AudioManager {
+        id: audioManager
+    }
+
+    SessionService {
+        id: sessionService
+        sessionRunner: sessionRunner
+        sessionManager: sessionManager
+        deviceManager: deviceManager
+
+        Component.onCompleted: registerOnBus()
+    }
+
     SessionRunner {
         id: sessionRunner
         sessionManager: sessionManager
         deviceManager: deviceManager
+        audioManager: audioManager
         helperClient: helperClient
         presetManager: presetManager
         steamConfigManager: steamConfigManager
+        monitorManager: monitorManager
+        inputRouting: settingsManager.inputRouting
+        instancePool.enabled: settingsManager.warmStandby
+        instancePool.prelaunch: settingsManager.prelaunchInstances
+        instancePool.idleTimeoutMinutes: settingsManager.standbyIdleTimeout
+        instancePool.memoryLimitMb: settingsManager.standbyMemoryLimit
+
+        Component.onCompleted: {
+            if (settingsManager.restoreSession && resumableProfile !== "") {
+                sessionManager.loadProfile(resumableProfile)
+            }
+        }
 
         onErrorOccurred: (message) => {
             applicationWindow().showPassiveNotification(message, "long")
@@ -89,25 +119,20 @@ Kirigami.ApplicationWindow {
             applicationWindow().showPassiveNotification(
                 i18nc("@info", "Session started with %1 instances", runningInstanceCount))
         }
+        onRenderScaleChanged: (index, scale) => {
+            applicationWindow().showPassiveNotification(
+                i18nc("@info", "Player %1 now renders at %2%", index + 1, Math.round(scale * 100)))
+        }
         onSessionStopped: {
             applicationWindow().showPassiveNotification(
                 i18nc("@info", "Session stopped"))
         }
     }
 
-    UserManager {
-        id: userManager
-        Component.onCompleted: setHelper(helperClient)
-    }
-
     CouchPlayHelperClient {
         id: helperClient
     }
 
-    GameLibrary {
-        id: gameLibrary
-    }
-
     MonitorManager {
         id: monitorManager
     }
@@ -134,6 +159,56 @@ Kirigami.ApplicationWindow {
         }
     }
 
+    // Only some pages need these; they are created on first use so their
+    // constructors stay out of the first frame (see StartupTrace)
+    property UserManager userManager: null
+    property GameLibrary gameLibrary: null
+    property GameCatalog gameCatalog: null
+
+    Component {
+        id: userManagerComponent
+        UserManager {
+            Component.onCompleted: setHelper(helperClient)
+        }
+    }
+
+    Component {
+        id: gameLibraryComponent
+        GameLibrary {}
+    }
+
+    Component {
+        id: gameCatalogComponent
+        GameCatalog {
+            Component.onCompleted: {
+                setSteamConfigManager(steamConfigManager)
+                setHeroicConfigManager(heroicConfigManager)
+                refresh()
+            }
+        }
+    }
+
+    function ensureUserManager() {
+        if (!userManager) {
+            userManager = userManagerComponent.createObject(root)
+        }
+        return userManager
+    }
+
+    function ensureGameLibrary() {
+        if (!gameLibrary) {
+            gameLibrary = gameLibraryComponent.createObject(root)
+        }
+        return gameLibrary
+    }
+
+    function ensureGameCatalog() {
+        if (!gameCatalog) {
+            gameCatalog = gameCatalogComponent.createObject(root)
+        }
+        return gameCatalog
+    }
+
     globalDrawer: Kirigami.GlobalDrawer {
         id: drawer
         title: i18nc("@title", "CouchPlay")
@@ -147,12 +222,7 @@ Kirigami.ApplicationWindow {
                 text: i18nc("@action:button", "Home")
                 onTriggered: {
                     pageStack.clear()
-                    pageStack.push(homePage, {
-                        sessionManager: sessionManager,
-                        sessionRunner: sessionRunner,
-                        deviceManager: deviceManager,
-                        helperClient: helperClient
-                    })
+                    root.pushHomePage()
                 }
             },
             Kirigami.Action {
@@ -160,14 +230,7 @@ Kirigami.ApplicationWindow {
                 text: i18nc("@action:button", "New Session")
                 onTriggered: {
                     pageStack.clear()
-                    pageStack.push(sessionSetupPage, {
-                        sessionManager: sessionManager,
-                        sessionRunner: sessionRunner,
-                        deviceManager: deviceManager,
-                        monitorManager: monitorManager,
-                        userManager: userManager,
-                        presetManager: presetManager
-                    })
+                    root.pushSessionSetupPage()
                 }
             },
             Kirigami.Action {
@@ -175,10 +238,7 @@ Kirigami.ApplicationWindow {
                 text: i18nc("@action:button", "Profiles")
                 onTriggered: {
                     pageStack.clear()
-                    pageStack.push(profilesPage, {
-                        sessionManager: sessionManager,
-                        sessionRunner: sessionRunner
-                    })
+                    root.pushProfilesPage()
                 }
             },
             Kirigami.Action {
@@ -186,9 +246,7 @@ Kirigami.ApplicationWindow {
                 text: i18nc("@action:button", "Games")
                 onTriggered: {
                     pageStack.clear()
-                    pageStack.push(gamesPage, {
-                        gameLibrary: gameLibrary
-                    })
+                    root.pushGamesPage()
                 }
             },
             Kirigami.Action {
@@ -196,10 +254,7 @@ Kirigami.ApplicationWindow {
                 text: i18nc("@action:button", "Users")
                 onTriggered: {
                     pageStack.clear()
-                    pageStack.push(usersPage, {
-                        userManager: userManager,
-                        helperClient: helperClient
-                    })
+                    root.pushUsersPage()
                 }
             },
             Kirigami.Action {
@@ -207,9 +262,7 @@ Kirigami.ApplicationWindow {
                 text: i18nc("@action:button", "Layout")
                 onTriggered: {
                     pageStack.clear()
-                    pageStack.push(layoutPage, {
-                        monitorManager: monitorManager
-                    })
+                    root.pushLayoutPage()
                 }
             },
             Kirigami.Action {
@@ -217,14 +270,7 @@ Kirigami.ApplicationWindow {
                 text: i18nc("@action:button", "Settings")
                 onTriggered: {
                     pageStack.clear()
-                    pageStack.push(settingsPage, {
-                        sessionRunner: sessionRunner,
-                        helperClient: helperClient,
-                        presetManager: presetManager,
-                        steamConfigManager: steamConfigManager,
-                        settingsManager: settingsManager,
-                        heroicConfigManager: heroicConfigManager
-                    })
+                    root.pushSettingsPage()
                 }
             }
         ]
@@ -237,7 +283,9 @@ Kirigami.ApplicationWindow {
         helperClient: helperClient
     }
 
-    // Page components - properties must be passed via pageStack.push()
+    // Page components - properties must be passed via pageStack.push().
+    // DeviceAssignmentPage, ProfilesPage and GamesPage are not listed here;
+    // see asyncPageComponent() below.
     Component {
         id: homePage
         HomePage {}
@@ -248,26 +296,11 @@ Kirigami.ApplicationWindow {
         SessionSetupPage {}
     }
 
-    Component {
-        id: deviceAssignmentPage
-        DeviceAssignmentPage {}
-    }
-
     Component {
         id: layoutPage
         LayoutPage {}
     }
 
-    Component {
-        id: profilesPage
-        ProfilesPage {}
-    }
-
-    Component {
-        id: gamesPage
-        GamesPage {}
-    }
-
     Component {
         id: usersPage
         UsersPage {}
@@ -280,6 +313,7 @@ Kirigami.ApplicationWindow {
 
     // Helper functions to push pages with required properties
     function pushHomePage() {
+        root.navigationSerial++
         pageStack.push(homePage, {
             sessionManager: sessionManager,
             sessionRunner: sessionRunner,
@@ -289,49 +323,48 @@ Kirigami.ApplicationWindow {
     }
 
     function pushSessionSetupPage() {
+        root.navigationSerial++
         pageStack.push(sessionSetupPage, {
             sessionManager: sessionManager,
             sessionRunner: sessionRunner,
             deviceManager: deviceManager,
             monitorManager: monitorManager,
-            userManager: userManager,
+            userManager: root.ensureUserManager(),
             presetManager: presetManager
         })
+        // Its "Next" goes to device assignment
+        root.preparePage("DeviceAssignmentPage")
     }
 
     function pushDeviceAssignmentPage() {
-        pageStack.push(deviceAssignmentPage, {
-            deviceManager: deviceManager
-        })
+        root.pushAsyncPage("DeviceAssignmentPage")
     }
 
     function pushProfilesPage() {
-        pageStack.push(profilesPage, {
-            sessionManager: sessionManager,
-            sessionRunner: sessionRunner
-        })
+        root.pushAsyncPage("ProfilesPage")
     }
 
     function pushGamesPage() {
-        pageStack.push(gamesPage, {
-            gameLibrary: gameLibrary
-        })
+        root.pushAsyncPage("GamesPage")
     }
 
     function pushUsersPage() {
+        root.navigationSerial++
         pageStack.push(usersPage, {
-            userManager: userManager,
+            userManager: root.ensureUserManager(),
             helperClient: helperClient
         })
     }
 
     function pushLayoutPage() {
+        root.navigationSerial++
         pageStack.push(layoutPage, {
             monitorManager: monitorManager
         })
     }
 
     function pushSettingsPage() {
+        root.navigationSerial++
         pageStack.push(settingsPage, {
             sessionRunner: sessionRunner,
             helperClient: helperClient,
@@ -341,4 +374,129 @@ Kirigami.ApplicationWindow {
             heroicConfigManager: heroicConfigManager
         })
     }
+
+    // DeviceAssignmentPage, ProfilesPage and GamesPage are big and never the
+    // first page, so they stay out of Main's compilation unit. Their
+    // components are compiled in the background once the first frame is
+    // up, pages are incubated asynchronously on push, and the page the user
+    // is most likely to open next is incubated ahead of time.
+    property var asyncPageComponents: ({})
+    property var preparedPages: ({})
+    // Bumped by every push, so a page that finishes incubating after the
+    // user has navigated elsewhere is dropped instead of pushed
+    property int navigationSerial: 0
+    property bool pagesPrefetched: false
+
+    Connections {
+        target: root
+        enabled: !root.pagesPrefetched
+
+        function onFrameSwapped() {
+            root.pagesPrefetched = true
+            for (const name of ["ProfilesPage", "DeviceAssignmentPage", "GamesPage"]) {
+                root.asyncPageComponent(name, function(component) {})
+            }
+            // HomePage links to it and it needs nothing created lazily
+            root.preparePage("ProfilesPage")
+        }
+    }
+
+    function asyncPageProperties(name) {
+        switch (name) {
+        case "DeviceAssignmentPage":
+            return { deviceManager: deviceManager }
+        case "ProfilesPage":
+            return { sessionManager: sessionManager, sessionRunner: sessionRunner }
+        case "GamesPage":
+            return { gameLibrary: root.ensureGameLibrary(), gameCatalog: root.ensureGameCatalog() }
+        }
+        return {}
+    }
+
+    // Calls back once the component has finished loading, successfully or not
+    function asyncPageComponent(name, callback) {
+        let component = asyncPageComponents[name]
+        if (!component) {
+            component = Qt.createComponent("io.github.hikaps.couchplay", name, Component.Asynchronous)
+            asyncPageComponents[name] = component
+        }
+        if (component.status !== Component.Loading) {
+            callback(component)
+            return
+        }
+        const onStatus = function() {
+            component.statusChanged.disconnect(onStatus)
+            callback(component)
+        }
+        component.statusChanged.connect(onStatus)
+    }
+
+    // Calls back with the finished page, or null if it couldn't be built.
+    // The page has no parent; the page stack takes it, and it is collected
+    // once the stack lets go of it.
+    function incubatePage(name, callback) {
+        asyncPageComponent(name, function(component) {
+            if (component.status !== Component.Ready) {
+                console.warn("Cannot load", name + ":", component.errorString())
+                callback(null)
+                return
+            }
+            const incubator = component.incubateObject(null, root.asyncPageProperties(name), Qt.Asynchronous)
+            if (incubator.status === Component.Ready) {
+                callback(incubator.object)
+                return
+            }
+            incubator.onStatusChanged = function(status) {
+                if (status === Component.Ready) {
+                    callback(incubator.object)
+                } else if (status === Component.Error) {
+                    console.warn("Cannot create", name)
+                    callback(null)
+                }
+            }
+        })
+    }
+
+    function preparePage(name) {
+        if (preparedPages[name]) {
+            return
+        }
+        const entry = { page: null, taker: null }
+        preparedPages[name] = entry
+        incubatePage(name, function(page) {
+            if (entry.taker) {
+                entry.taker(page)
+            } else if (page) {
+                entry.page = page
+            } else {
+                delete preparedPages[name]
+            }
+        })
+    }
+
+    function pushAsyncPage(name) {
+        const serial = ++root.navigationSerial
+        const push = function(page) {
+            if (!page) {
+                return
+            }
+            if (serial !== root.navigationSerial) {
+                page.destroy()
+                return
+            }
+            pageStack.push(page)
+        }
+
+        const entry = preparedPages[name]
+        if (!entry) {
+            incubatePage(name, push)
+            return
+        }
+        delete preparedPages[name]
+        if (entry.page) {
+            push(entry.page)
+        } else {
+            entry.taker = push
+        }
+    }
 }
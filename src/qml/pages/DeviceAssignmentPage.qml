@@ -5,6 +5,7 @@ import QtQuick
 import QtQuick.Layouts
 import QtQuick.Controls as QQC2
 import org.kde.kirigami as Kirigami
+import io.github.hikaps.couchplay 1.0
 
 import "../components" as Components
 
@@ -14,7 +15,7 @@ Kirigami.ScrollablePage {
     title: i18nc("@title", "Assign Devices")
     
     // Reference to DeviceManager (injected from parent)
-    required property var deviceManager
+    required property DeviceManager deviceManager
     property int instanceCount: 2
 
     actions: [
@@ -39,6 +40,17 @@ Kirigami.ScrollablePage {
                 }
             }
         },
+        Kirigami.Action {
+            text: i18nc("@action:button", "Identify All")
+            icon.name: "flashlight-on"
+            tooltip: i18nc("@info:tooltip", "Vibrate every controller in turn, player 1 first")
+            onTriggered: {
+                if (deviceManager && deviceManager.identifyAllControllers() === 0) {
+                    applicationWindow().showPassiveNotification(
+                        i18nc("@info", "No controllers connected"))
+                }
+            }
+        },
         Kirigami.Action {
             text: i18nc("@action:button", "Clear All")
             icon.name: "edit-clear-all"
@@ -101,7 +113,6 @@ Kirigami.ScrollablePage {
                     
                     required property int index
                     playerIndex: dropZoneDelegate.index
-                    assignedDevices: (deviceManager?.visibleDevices ?? []).filter(d => d.assignedInstance === dropZoneDelegate.playerIndex)
                     
                     onDeviceDropped: (eventNumber) => {
                         deviceManager?.assignDevice(eventNumber, dropZoneDelegate.playerIndex)
@@ -129,15 +140,15 @@ Kirigami.ScrollablePage {
             Layout.fillWidth: true
 
             QQC2.TabButton {
-                text: "Controllers (" + (deviceManager?.controllers?.length ?? 0) + ")"
+                text: "Controllers (" + (deviceManager?.controllerModel?.count ?? 0) + ")"
                 icon.name: "input-gamepad"
             }
             QQC2.TabButton {
-                text: "Keyboards (" + (deviceManager?.keyboards?.length ?? 0) + ")"
+                text: "Keyboards (" + (deviceManager?.keyboardModel?.count ?? 0) + ")"
                 icon.name: "input-keyboard"
             }
             QQC2.TabButton {
-                text: "Mice (" + (deviceManager?.mice?.length ?? 0) + ")"
+                text: "Mice (" + (deviceManager?.mouseModel?.count ?? 0) + ")"
                 icon.name: "input-mouse"
             }
         }
@@ -148,7 +159,7 @@ Kirigami.ScrollablePage {
 
             // Controllers list
             DeviceList {
-                deviceModel: deviceManager?.controllers ?? []
+                deviceModel: deviceManager?.controllerModel ?? null
                 deviceType: "controller"
                 instanceCount: root.instanceCount
                 onAssignDevice: (eventNumber, instanceIndex) => {
@@ -161,20 +172,20 @@ Kirigami.ScrollablePage {
 
             // Keyboards list
             DeviceList {
-                deviceModel: deviceManager?.keyboards ?? []
+                deviceModel: deviceManager?.keyboardModel ?? null
                 deviceType: "keyboard"
                 instanceCount: root.instanceCount
                 onAssignDevice: (eventNumber, instanceIndex) => {
                     deviceManager?.assignDevice(eventNumber, instanceIndex)
                 }
                 onIdentifyDevice: (eventNumber) => {
-                    // Keyboards don't support identification
+                    deviceManager?.identifyDevice(eventNumber)
                 }
             }
 
             // Mice list
             DeviceList {
-                deviceModel: deviceManager?.mice ?? []
+                deviceModel: deviceManager?.mouseModel ?? null
                 deviceType: "mouse"
                 instanceCount: root.instanceCount
                 onAssignDevice: (eventNumber, instanceIndex) => {
@@ -189,7 +200,7 @@ Kirigami.ScrollablePage {
         // Empty state
         Kirigami.PlaceholderMessage {
             Layout.fillWidth: true
-            visible: (deviceManager?.visibleDevices?.length ?? 0) === 0
+            visible: (deviceManager?.visibleModel?.count ?? 0) === 0
             text: i18nc("@info", "No input devices found")
             explanation: i18nc("@info", "Connect controllers, keyboards, or mice to see them here.")
             icon.name: "input-gamepad"
@@ -207,7 +218,6 @@ Kirigami.ScrollablePage {
         id: dropZone
         
         required property int playerIndex
-        required property var assignedDevices
         
         signal deviceDropped(int eventNumber)
         signal deviceRemoved(int eventNumber)
@@ -239,13 +249,24 @@ Kirigami.ScrollablePage {
 
             // Show assigned devices
             Repeater {
-                model: dropZone.assignedDevices
+                model: DeviceFilterModel {
+                    id: assignedDevices
+                    sourceModel: deviceManager?.deviceModel ?? null
+                    filter: DeviceFilterModel.Visible
+                    showVirtual: deviceManager?.showVirtualDevices ?? false
+                    showInternal: deviceManager?.showInternalDevices ?? false
+                    assignedInstance: dropZone.playerIndex
+                }
 
                 Kirigami.Chip {
+                    required property string name
+                    required property string type
+                    required property int eventNumber
+
                     Layout.fillWidth: true
-                    text: modelData.name
+                    text: name
                     icon.name: {
-                        switch (modelData.type) {
+                        switch (type) {
                             case "controller": return "input-gamepad"
                             case "keyboard": return "input-keyboard"
                             case "mouse": return "input-mouse"
@@ -253,7 +274,7 @@ Kirigami.ScrollablePage {
                         }
                     }
                     closable: true
-                    onRemoved: dropZone.deviceRemoved(modelData.eventNumber)
+                    onRemoved: dropZone.deviceRemoved(eventNumber)
                 }
             }
 
@@ -261,7 +282,7 @@ Kirigami.ScrollablePage {
             Kirigami.PlaceholderMessage {
                 Layout.fillWidth: true
                 Layout.fillHeight: true
-                visible: dropZone.assignedDevices.length === 0
+                visible: assignedDevices.count === 0
                 text: i18nc("@info", "Drop devices here")
                 icon.name: "list-add"
             }
@@ -306,8 +327,7 @@ Kirigami.ScrollablePage {
             delegate: DraggableDeviceCard {
                 Layout.fillWidth: true
                 
-                required property var modelData
-                device: modelData
+                // The required "device" property is filled from the model's device role
                 instanceCount: deviceListRoot.instanceCount
                 
                 onAssign: (eventNumber, instanceIndex) => {
@@ -325,7 +345,7 @@ Kirigami.ScrollablePage {
         // Empty state for this device type
         Kirigami.PlaceholderMessage {
             Layout.fillWidth: true
-            visible: deviceListRoot.deviceModel.length === 0
+            visible: (deviceListRoot.deviceModel?.count ?? 0) === 0
             text: {
                 switch (deviceListRoot.deviceType) {
                     case "controller": return i18nc("@info", "No controllers detected")
@@ -397,6 +417,32 @@ Kirigami.ScrollablePage {
                 }
             }
 
+            // Battery of wireless controllers
+            RowLayout {
+                readonly property int level: deviceCard.device?.batteryLevel ?? -1
+                readonly property bool charging: deviceCard.device?.batteryCharging ?? false
+
+                visible: level >= 0
+                spacing: 0
+
+                Kirigami.Icon {
+                    source: {
+                        const step = String(Math.round(parent.level / 10) * 10).padStart(3, "0")
+                        return parent.charging ? "battery-charging-" + step : "battery-" + step
+                    }
+                    Layout.preferredWidth: Kirigami.Units.iconSizes.small
+                    Layout.preferredHeight: Kirigami.Units.iconSizes.small
+                }
+
+                QQC2.Label {
+                    text: i18nc("@info battery level", "%1%", parent.level)
+                    font: Kirigami.Theme.smallFont
+                    // DeviceManager::LOW_BATTERY_PERCENT
+                    color: parent.level < 15 && !parent.charging
+                        ? Kirigami.Theme.negativeTextColor : Kirigami.Theme.textColor
+                }
+            }
+
             // Assignment indicator
             Kirigami.Chip {
                 visible: deviceCard.device?.assigned ?? false
@@ -430,14 +476,16 @@ Kirigami.ScrollablePage {
                 }
             }
 
-            // Identify button (controllers only)
+            // Identify button (controllers vibrate, keyboards flash their lock LEDs)
             QQC2.Button {
                 icon.name: "flashlight-on"
                 flat: true
-                visible: deviceCard.device?.type === "controller"
+                visible: deviceCard.device?.type === "controller" || deviceCard.device?.type === "keyboard"
                 
                 QQC2.ToolTip.visible: hovered
-                QQC2.ToolTip.text: i18nc("@info:tooltip", "Identify (vibrate controller)")
+                QQC2.ToolTip.text: deviceCard.device?.type === "keyboard"
+                    ? i18nc("@info:tooltip", "Identify (flash keyboard LEDs)")
+                    : i18nc("@info:tooltip", "Identify (vibrate controller)")
                 
                 onClicked: {
                     if (deviceCard.device) {
@@ -5,6 +5,7 @@ import QtQuick
 import QtQuick.Layouts
 import QtQuick.Controls as Controls
 import org.kde.kirigami as Kirigami
+import io.github.hikaps.couchplay 1.0
 
 import "../components" as Components
 
@@ -12,14 +13,18 @@ Kirigami.ScrollablePage {
     id: root
     title: i18nc("@title", "Games")
 
-    required property var gameLibrary
+    required property GameLibrary gameLibrary
+    property GameCatalog gameCatalog: null
     property var steamGames: []
 
     actions: [
         Kirigami.Action {
             icon.name: "view-refresh"
             text: i18nc("@action:button", "Refresh")
-            onTriggered: gameLibrary?.refresh()
+            onTriggered: {
+                gameLibrary?.refresh()
+                gameCatalog?.refresh()
+            }
         },
         Kirigami.Action {
             icon.name: "steam"
@@ -187,6 +192,113 @@ Kirigami.ScrollablePage {
             }
         }
 
+        // Installed games from every launcher, shown from cache while it refreshes
+        RowLayout {
+            Layout.fillWidth: true
+            visible: gameCatalog !== null
+            spacing: Kirigami.Units.smallSpacing
+
+            Kirigami.Heading {
+                text: i18nc("@title", "Installed Games")
+                level: 2
+                Layout.fillWidth: true
+            }
+
+            Controls.BusyIndicator {
+                running: gameCatalog?.loading ?? false
+                visible: running
+                Layout.preferredHeight: Kirigami.Units.iconSizes.medium
+                Layout.preferredWidth: Kirigami.Units.iconSizes.medium
+            }
+
+            Controls.ComboBox {
+                id: catalogSortBox
+                textRole: "text"
+                valueRole: "value"
+                model: [
+                    { text: i18nc("@item:inlistbox sort order", "Name"), value: "name" },
+                    { text: i18nc("@item:inlistbox sort order", "Launcher"), value: "source" },
+                    { text: i18nc("@item:inlistbox sort order", "Size"), value: "size" },
+                    { text: i18nc("@item:inlistbox sort order", "Last Played"), value: "lastPlayed" }
+                ]
+                Component.onCompleted: currentIndex = Math.max(0, indexOfValue(gameCatalog?.sortBy ?? "name"))
+                onActivated: if (gameCatalog) gameCatalog.sortBy = currentValue
+            }
+        }
+
+        Controls.Label {
+            visible: gameCatalog !== null && gameCatalog.count === 0
+            text: (gameCatalog?.loading ?? false)
+                  ? i18nc("@info", "Looking for installed games…")
+                  : i18nc("@info", "No installed Steam or Heroic games found.")
+            opacity: 0.7
+        }
+
+        ColumnLayout {
+            Layout.fillWidth: true
+            visible: gameCatalog !== null
+            spacing: 0
+
+            Repeater {
+                model: gameCatalog
+
+                delegate: Controls.ItemDelegate {
+                    id: catalogDelegate
+                    required property string name
+                    required property string source
+                    required property string command
+                    required property var installSize
+
+                    Layout.fillWidth: true
+
+                    contentItem: RowLayout {
+                        spacing: Kirigami.Units.smallSpacing
+
+                        Controls.Label {
+                            text: catalogDelegate.name
+                            elide: Text.ElideRight
+                            Layout.fillWidth: true
+                        }
+
+                        Controls.Label {
+                            visible: catalogDelegate.installSize > 0
+                            text: i18nc("@info install size", "%1 GB", (catalogDelegate.installSize / 1e9).toFixed(1))
+                            opacity: 0.7
+                        }
+
+                        Kirigami.Chip {
+                            text: {
+                                switch (catalogDelegate.source) {
+                                case "steam": return "Steam"
+                                case "shortcut": return i18nc("@info non-Steam game in Steam", "Steam shortcut")
+                                case "legendary": return "Epic"
+                                case "gog": return "GOG"
+                                case "nile": return "Amazon"
+                                default: return "Heroic"
+                                }
+                            }
+                            closable: false
+                            checkable: false
+                        }
+
+                        Controls.ToolButton {
+                            icon.name: "list-add"
+                            text: i18nc("@action:button", "Add to Library")
+                            display: Controls.AbstractButton.IconOnly
+                            Controls.ToolTip.text: text
+                            Controls.ToolTip.visible: hovered
+                            onClicked: {
+                                if (gameLibrary?.addGame(catalogDelegate.name, catalogDelegate.command, "")) {
+                                    applicationWindow().showPassiveNotification(
+                                        i18nc("@info", "Game '%1' added to library", catalogDelegate.name))
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
         // Tips section
         Components.InfoCard {
             title: i18nc("@title", "Tips")
@@ -417,7 +529,9 @@ Kirigami.ScrollablePage {
                                 }
 
                                 Controls.Label {
-                                    text: i18nc("@info", "App ID: %1", modelData.appId)
+                                    text: modelData.installSize > 0
+                                          ? i18nc("@info", "App ID: %1 · %2 GB", modelData.appId, (modelData.installSize / 1e9).toFixed(1))
+                                          : i18nc("@info", "App ID: %1", modelData.appId)
                                     font.pointSize: Kirigami.Theme.smallFont.pointSize
                                     opacity: 0.7
                                 }
@@ -22,7 +22,7 @@ Kirigami.ScrollablePage {
 
     // Computed properties to avoid repeating conditions
     property bool helperAvailable: helperClient?.available ?? false
-    property bool hasControllers: deviceManager && deviceManager.controllers.length > 0
+    property bool hasControllers: deviceManager && deviceManager.controllerModel.count > 0
 
     // Refresh on page load
     Component.onCompleted: {
@@ -97,6 +97,24 @@ Kirigami.ScrollablePage {
             ]
         }
 
+        // Last session, ready to be launched again as it was
+        Kirigami.InlineMessage {
+            Layout.fillWidth: true
+            visible: sessionRunner && !sessionRunner.running && !sessionRunner.starting
+                     && sessionRunner.resumableProfile !== ""
+            type: Kirigami.MessageType.Information
+            text: i18nc("@info", "Last session: %1", sessionRunner ? sessionRunner.resumableProfile : "")
+
+            actions: [
+                Kirigami.Action {
+                    text: i18nc("@action:button", "Resume")
+                    icon.name: "media-playback-start"
+                    tooltip: i18nc("@info:tooltip", "Start the last session again with the same players, devices and windows")
+                    onTriggered: sessionRunner.resume()
+                }
+            ]
+        }
+
         // Quick Actions
         Kirigami.Heading {
             text: i18nc("@title", "Quick Actions")
@@ -141,7 +159,7 @@ Kirigami.ScrollablePage {
                 iconName: "input-gamepad"
                 title: i18nc("@action", "Manage Devices")
                 description: i18nc("@info", "View and configure input devices")
-                badgeCount: deviceManager ? deviceManager.controllers.length : 0
+                badgeCount: deviceManager ? deviceManager.controllerModel.count : 0
                 onClicked: {
                     applicationWindow().pageStack.clear()
                     applicationWindow().pushDeviceAssignmentPage()
@@ -313,7 +331,7 @@ Kirigami.ScrollablePage {
 
                 Controls.Label {
                     text: deviceManager 
-                        ? i18ncp("@info", "%1 detected", "%1 detected", deviceManager.controllers.length)
+                        ? i18ncp("@info", "%1 detected", "%1 detected", deviceManager.controllerModel.count)
                         : i18nc("@info", "Unknown")
                     color: root.hasControllers ? Kirigami.Theme.positiveTextColor : Kirigami.Theme.neutralTextColor
                 }
@@ -5,18 +5,20 @@ import QtQuick
 import QtQuick.Layouts
 import QtQuick.Controls as Controls
 import org.kde.kirigami as Kirigami
+import io.github.hikaps.couchplay 1.0
 
 Kirigami.ScrollablePage {
     id: root
     title: i18nc("@title", "Profiles")
 
     // Backend managers (from Main.qml)
-    required property var sessionManager
-    required property var sessionRunner
+    required property SessionManager sessionManager
+    required property SessionRunner sessionRunner
 
-    // Refresh profiles when page becomes visible
-    Component.onCompleted: {
-        if (sessionManager) {
+    // Refresh profiles when page becomes visible; Main.qml may have
+    // created it well before that
+    onIsCurrentPageChanged: {
+        if (isCurrentPage && sessionManager) {
             sessionManager.refreshProfiles()
         }
     }
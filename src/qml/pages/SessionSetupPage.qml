@@ -5,6 +5,7 @@ import QtQuick
 import QtQuick.Layouts
 import QtQuick.Controls as Controls
 import org.kde.kirigami as Kirigami
+import io.github.hikaps.couchplay 1.0
 
 import "../components" as Components
 
@@ -25,15 +26,40 @@ Kirigami.ScrollablePage {
     property int instanceCount: sessionManager ? sessionManager.instanceCount : 2
     property string layoutMode: sessionManager ? sessionManager.currentLayout : "horizontal"
 
-    // Revision counter to force re-evaluation of user filtering when instances change
+    // GPUs a player can be placed on; the choice is hidden with only one
+    readonly property var gpuChoices: {
+        let choices = [
+            { value: "", text: i18nc("@item:inlistbox GPU", "Default") },
+            { value: "auto", text: i18nc("@item:inlistbox GPU", "Automatic") }
+        ]
+        let gpus = sessionRunner ? sessionRunner.availableGpus() : []
+        for (let gpu of gpus) {
+            choices.push({ value: gpu.pciAddress, text: gpu.name + " (" + gpu.pciAddress + ")" })
+        }
+        return choices
+    }
+
+    // Revision counter to force re-evaluation of user filtering when assignments change
     property int instancesRevision: 0
     
     // Revision counter to force re-evaluation of device display when devices change
     property int devicesRevision: 0
 
+    // Only user assignments affect the filtering; other edits leave the combos alone
     Connections {
-        target: root.sessionManager
-        function onInstancesChanged() {
+        target: root.sessionManager ? root.sessionManager.instanceModel : null
+        function onDataChanged(topLeft, bottomRight, roles) {
+            if (roles.length === 0 || roles.includes(InstanceListModel.UsernameRole)) {
+                root.instancesRevision++
+            }
+        }
+        function onRowsInserted() {
+            root.instancesRevision++
+        }
+        function onRowsRemoved() {
+            root.instancesRevision++
+        }
+        function onModelReset() {
             root.instancesRevision++
         }
     }
@@ -171,6 +197,114 @@ Kirigami.ScrollablePage {
             ]
         }
 
+        // Start pipeline progress
+        Kirigami.InlineMessage {
+            Layout.fillWidth: true
+            visible: sessionRunner?.starting ?? false
+            type: Kirigami.MessageType.Information
+            text: i18nc("@info", "Starting session… %1%",
+                       Math.round((sessionRunner ? sessionRunner.startProgress : 0) * 100))
+        }
+
+        // Input latency diagnostics
+        Controls.CheckBox {
+            text: i18nc("@option:check", "Measure input latency per player")
+            checked: sessionRunner?.inputDiagnostics ?? false
+            onToggled: sessionRunner.inputDiagnostics = checked
+
+            Controls.ToolTip.text: i18nc("@info:tooltip", "Enable before starting the session. Shows each player's device report rate and an input-to-photon estimate.")
+            Controls.ToolTip.visible: hovered
+            Controls.ToolTip.delay: 1000
+        }
+
+        Repeater {
+            model: sessionRunner && sessionRunner.inputDiagnostics ? sessionRunner.inputLatency : []
+
+            delegate: Controls.Label {
+                required property var modelData
+
+                Layout.fillWidth: true
+                wrapMode: Text.WordWrap
+                text: i18nc("@info", "Player %1: %2 Hz reports, input-to-photon ~%3 ms (p99 %4 ms)",
+                            modelData.instanceIndex + 1,
+                            modelData.reportRateHz,
+                            modelData.inputToPhotonP50Ms.toFixed(1),
+                            modelData.inputToPhotonP99Ms.toFixed(1))
+            }
+        }
+
+        // Per-instance resource use while the session runs
+        Repeater {
+            model: sessionRunner?.running ? sessionRunner.telemetry.latest : []
+
+            delegate: ColumnLayout {
+                id: telemetryRow
+
+                required property var modelData
+
+                Layout.fillWidth: true
+
+                RowLayout {
+                    Layout.fillWidth: true
+
+                    Controls.Label {
+                        Layout.fillWidth: true
+                        wrapMode: Text.WordWrap
+                        opacity: 0.8
+                        text: i18nc("@info", "Player %1: CPU %2%, memory %3, GPU %4, %5",
+                                    telemetryRow.modelData.index + 1,
+                                    Math.round(telemetryRow.modelData.cpuPercent),
+                                    telemetryRow.modelData.rssBytes >= 0 ? Math.round(telemetryRow.modelData.rssBytes / 1048576) + " MiB" : "?",
+                                    telemetryRow.modelData.gpuPercent >= 0 ? Math.round(telemetryRow.modelData.gpuPercent) + "%" : "?",
+                                    telemetryRow.modelData.fps >= 0 ? i18nc("@info frames per second", "%1 fps", Math.round(telemetryRow.modelData.fps))
+                                                                    : i18nc("@info frame rate unknown", "fps unknown"))
+                    }
+
+                    Controls.ToolButton {
+                        id: logButton
+                        checkable: true
+                        icon.name: "viewlog"
+                        text: i18nc("@action:button", "Log")
+                        display: Controls.AbstractButton.IconOnly
+
+                        Controls.ToolTip.text: i18nc("@info:tooltip", "Show this player's game output")
+                        Controls.ToolTip.visible: hovered
+                        Controls.ToolTip.delay: 1000
+                    }
+                }
+
+                // Read from the journal only while shown
+                Controls.ScrollView {
+                    Layout.fillWidth: true
+                    Layout.preferredHeight: Kirigami.Units.gridUnit * 10
+                    visible: logButton.checked
+
+                    ListView {
+                        clip: true
+                        model: InstanceLogModel {
+                            helperClient: root.sessionRunner ? root.sessionRunner.helperClient : null
+                            username: root.sessionManager?.getInstanceConfig(telemetryRow.modelData.index).username ?? ""
+                            active: logButton.checked
+                        }
+                        // Follow new output unless the user is scrolling
+                        onCountChanged: if (!moving) positionViewAtEnd()
+
+                        delegate: Controls.Label {
+                            required property string message
+                            required property int priority
+
+                            width: ListView.view.width
+                            wrapMode: Text.WrapAnywhere
+                            font.family: "monospace"
+                            font.pointSize: Kirigami.Theme.smallFont.pointSize
+                            color: priority <= 3 ? Kirigami.Theme.negativeTextColor : Kirigami.Theme.textColor
+                            text: message
+                        }
+                    }
+                }
+            }
+        }
+
         // Layout Selection
         Kirigami.Heading {
             text: i18nc("@title", "Screen Layout")
@@ -253,6 +387,159 @@ Kirigami.ScrollablePage {
             }
         }
 
+        // Performance target: lower internal resolution with FSR upscaling
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: Kirigami.Units.largeSpacing
+
+            Controls.CheckBox {
+                text: i18nc("@option:check", "Fit the GPU budget with FSR upscaling")
+                checked: sessionManager?.performanceMode ?? false
+                onToggled: sessionManager.performanceMode = checked
+
+                Controls.ToolTip.text: i18nc("@info:tooltip", "Render every instance at a lower resolution when all of them together would exceed the GPU budget, and upscale to the window with FSR.")
+                Controls.ToolTip.visible: hovered
+                Controls.ToolTip.delay: 1000
+            }
+
+            Controls.Label {
+                text: i18nc("@label", "Budget (Mpx/s):")
+                enabled: sessionManager?.performanceMode ?? false
+            }
+
+            Controls.SpinBox {
+                from: 0
+                to: 10000
+                stepSize: 50
+                enabled: sessionManager?.performanceMode ?? false
+                value: sessionManager ? sessionManager.gpuBudget : 0
+                textFromValue: (value) => value === 0
+                    ? i18nc("@item:inrange GPU budget", "Auto (%1)", sessionRunner ? sessionRunner.gpuBudget() : 0)
+                    : value.toString()
+                onValueModified: sessionManager.gpuBudget = value
+            }
+        }
+
+        // Dynamic resolution: per-player render scale from frame times
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: Kirigami.Units.largeSpacing
+
+            Controls.CheckBox {
+                text: i18nc("@option:check", "Adapt each player's resolution to their frame rate")
+                checked: sessionManager?.dynamicResolution ?? false
+                onToggled: sessionManager.dynamicResolution = checked
+
+                Controls.ToolTip.text: i18nc("@info:tooltip", "Lower a player's render resolution when their game keeps missing its frame rate, and raise it again when there is headroom. Each change restarts that player's game.")
+                Controls.ToolTip.visible: hovered
+                Controls.ToolTip.delay: 1000
+            }
+
+            Controls.Label {
+                text: i18nc("@label", "Scale:")
+                enabled: sessionManager?.dynamicResolution ?? false
+            }
+
+            Controls.SpinBox {
+                from: 25
+                to: 100
+                stepSize: 5
+                enabled: sessionManager?.dynamicResolution ?? false
+                value: sessionManager ? sessionManager.minRenderScale : 50
+                textFromValue: (value) => i18nc("@item:inrange render scale", "%1%", value)
+                valueFromText: (text) => parseInt(text) || 50
+                onValueModified: sessionManager.minRenderScale = value
+            }
+
+            Controls.Label {
+                text: i18nc("@label render scale range", "to")
+                enabled: sessionManager?.dynamicResolution ?? false
+            }
+
+            Controls.SpinBox {
+                from: 25
+                to: 100
+                stepSize: 5
+                enabled: sessionManager?.dynamicResolution ?? false
+                value: sessionManager ? sessionManager.maxRenderScale : 100
+                textFromValue: (value) => i18nc("@item:inrange render scale", "%1%", value)
+                valueFromText: (text) => parseInt(text) || 100
+                onValueModified: sessionManager.maxRenderScale = value
+            }
+        }
+
+        // Frame rate caps so one uncapped game can't starve the others
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: Kirigami.Units.largeSpacing
+
+            Controls.CheckBox {
+                text: i18nc("@option:check", "Share the display refresh equally")
+                checked: sessionManager?.equalFrameShare ?? false
+                onToggled: sessionManager.equalFrameShare = checked
+
+                Controls.ToolTip.text: i18nc("@info:tooltip", "Cap every player at the same even share of the display refresh rate for identical frame pacing. Overrides the players' own limits.")
+                Controls.ToolTip.visible: hovered
+                Controls.ToolTip.delay: 1000
+            }
+
+            Controls.Label {
+                text: i18nc("@label", "Frame limit:")
+            }
+
+            Controls.SpinBox {
+                from: 0
+                to: 500
+                stepSize: 5
+                value: sessionManager ? sessionManager.frameLimit : 0
+                textFromValue: (value) => value === 0 ? i18nc("@item:inrange no frame limit", "None")
+                                                      : i18nc("@item:inrange frames per second", "%1 fps", value)
+                valueFromText: (text) => parseInt(text) || 0
+                onValueModified: sessionManager.frameLimit = value
+            }
+        }
+
+        // Players start from the compositor user's compiled shaders and Proton prefixes
+        Controls.CheckBox {
+            text: i18nc("@option:check", "Share shader caches")
+            checked: sessionManager?.shareCaches ?? true
+            onToggled: sessionManager.shareCaches = checked
+
+            Controls.ToolTip.text: i18nc("@info:tooltip", "Give players without their own shader cache or Proton prefix a copy of yours, so their first launch doesn't compile shaders again. Needs a Btrfs or XFS home.")
+            Controls.ToolTip.visible: hovered
+            Controls.ToolTip.delay: 1000
+        }
+
+        Controls.CheckBox {
+            text: i18nc("@option:check", "Writable shared folders")
+            checked: sessionManager?.writableShares ?? false
+            onToggled: sessionManager.writableShares = checked
+
+            Controls.ToolTip.text: i18nc("@info:tooltip", "Players can change shared folders such as your game library. Their changes are kept separately in their own home and never touch your files.")
+            Controls.ToolTip.visible: hovered
+            Controls.ToolTip.delay: 1000
+        }
+
+        Repeater {
+            // Re-evaluated whenever anything the plan depends on changes
+            model: sessionRunner && sessionManager && sessionManager.performanceMode
+                   && sessionManager.gpuBudget >= 0 && root.instanceCount > 0 && root.layoutMode !== ""
+                   ? sessionRunner.renderPlan() : []
+
+            delegate: Controls.Label {
+                required property var modelData
+
+                Layout.fillWidth: true
+                opacity: 0.7
+                text: modelData.fsr
+                    ? i18nc("@info", "Player %1: renders %2 x %3, FSR upscaled to %4 x %5",
+                            modelData.index + 1, modelData.internalWidth, modelData.internalHeight,
+                            modelData.outputWidth, modelData.outputHeight)
+                    : i18nc("@info", "Player %1: renders natively at %2 x %3",
+                            modelData.index + 1, modelData.outputWidth, modelData.outputHeight)
+            }
+        }
+
         // Instance Configuration
         Kirigami.Heading {
             text: i18nc("@title", "Instance Configuration")
@@ -261,7 +548,7 @@ Kirigami.ScrollablePage {
         }
 
         Repeater {
-            model: root.instanceCount
+            model: root.sessionManager ? root.sessionManager.instanceModel : 0
 
             delegate: Kirigami.Card {
                 id: instanceCard
@@ -269,14 +556,44 @@ Kirigami.ScrollablePage {
                 Layout.bottomMargin: Kirigami.Units.smallSpacing
 
                 required property int index
+                // Roles of InstanceListModel; each updates on its own
+                required property string username
+                required property string presetId
+                required property int outputWidth
+                required property int outputHeight
+                required property int refreshRate
+                required property int frameLimit
+                required property int cpuWeight
+                required property string cpuCores
+                required property int ioWeight
+                required property int memoryHighMb
+                required property string gpu
                 
                 // Pre-translated strings to avoid i18nc scoping issues inside FormLayout
                 readonly property string labelUser: i18nc("@label", "User:")
                 readonly property string labelLauncher: i18nc("@label", "Launcher:")
                 readonly property string labelResolution: i18nc("@label", "Game Resolution:")
                 readonly property string labelRefreshRate: i18nc("@label", "Refresh Rate:")
+                readonly property string labelFrameLimit: i18nc("@label", "Frame Limit:")
+                readonly property string textSessionLimit: i18nc("@item:inrange use the session's frame limit", "Session")
                 readonly property string labelScaling: i18nc("@label", "Scaling:")
                 readonly property string labelDevices: i18nc("@label", "Devices:")
+                readonly property string labelCpuWeight: i18nc("@label", "CPU Weight:")
+                readonly property string labelCpuCores: i18nc("@label", "CPU Cores:")
+                readonly property string labelIoWeight: i18nc("@label", "Disk Weight:")
+                readonly property string labelMemoryHigh: i18nc("@label", "Memory Limit:")
+                readonly property string labelGpu: i18nc("@label", "GPU:")
+                readonly property string textDefault: i18nc("@item:inrange no limit or weight set", "Default")
+                readonly property string textAllCores: i18nc("@info:placeholder", "All, or e.g. 0-3,8")
+
+                function updateConfig(key, value) {
+                    if (root.sessionManager) {
+                        // setInstanceConfig() only touches the keys it is given
+                        let config = {}
+                        config[key] = value
+                        root.sessionManager.setInstanceConfig(instanceCard.index, config)
+                    }
+                }
 
                 readonly property string textNoneAssigned: i18nc("@info", "None assigned")
                 readonly property string textAssign: i18nc("@action:button", "Assign...")
@@ -313,8 +630,7 @@ Kirigami.ScrollablePage {
                                 
                                 // Restore selection after model changes
                                 onModelChanged: {
-                                    let config = root.sessionManager?.getInstanceConfig(instanceCard.index)
-                                    let currentUsername = config?.username ?? ""
+                                    let currentUsername = instanceCard.username
                                     if (currentUsername && model) {
                                         // Manual search - indexOfValue doesn't work with JS arrays of objects
                                         // We need to iterate through the model to find the matching username
@@ -357,10 +673,7 @@ Kirigami.ScrollablePage {
                                 Kirigami.FormData.label: instanceCard.labelLauncher
                                 Layout.fillWidth: true
                                 presetManager: root.presetManager
-                                currentPresetId: {
-                                    let config = root.sessionManager?.getInstanceConfig(instanceCard.index)
-                                    return config?.presetId ?? "steam"
-                                }
+                                currentPresetId: instanceCard.presetId || "steam"
                                 
                                 onPresetSelected: function(presetId) {
                                     if (root.sessionManager) {
@@ -378,7 +691,7 @@ Kirigami.ScrollablePage {
                             // Resolution is auto-calculated from monitor size and layout
                             Controls.Label {
                                 Kirigami.FormData.label: instanceCard.labelResolution
-                                text: root.sessionManager ? (root.sessionManager.getInstanceConfig(instanceCard.index).outputWidth + " x " + root.sessionManager.getInstanceConfig(instanceCard.index).outputHeight) : "1920 x 1080"
+                                text: instanceCard.outputWidth + " x " + instanceCard.outputHeight
                                 opacity: 0.8
                             }
 
@@ -387,17 +700,84 @@ Kirigami.ScrollablePage {
                                 Kirigami.FormData.label: instanceCard.labelRefreshRate
                                 from: 30
                                 to: 240
-                                value: root.sessionManager ? root.sessionManager.getInstanceConfig(instanceCard.index).refreshRate : 60
+                                value: instanceCard.refreshRate
                                 textFromValue: function(value) { return value + " Hz" }
                                 valueFromText: function(text) { return parseInt(text) }
-                                
-                                onValueModified: {
-                                    if (root.sessionManager) {
-                                        var config = root.sessionManager.getInstanceConfig(instanceCard.index)
-                                        config.refreshRate = value
-                                        root.sessionManager.setInstanceConfig(instanceCard.index, config)
+                                onValueModified: instanceCard.updateConfig("refreshRate", value)
+                            }
+
+                            Controls.SpinBox {
+                                Kirigami.FormData.label: instanceCard.labelFrameLimit
+                                from: 0
+                                to: 500
+                                stepSize: 5
+                                enabled: !(root.sessionManager?.equalFrameShare ?? false)
+                                value: instanceCard.frameLimit
+                                textFromValue: function(value) { return value === 0 ? instanceCard.textSessionLimit : value }
+                                valueFromText: function(text) { return parseInt(text) || 0 }
+                                onValueModified: instanceCard.updateConfig("frameLimit", value)
+                            }
+
+                            // Resource controls for the instance's cgroup; 0 keeps the default
+                            Controls.SpinBox {
+                                Kirigami.FormData.label: instanceCard.labelCpuWeight
+                                from: 0
+                                to: 10000
+                                stepSize: 50
+                                value: instanceCard.cpuWeight
+                                textFromValue: function(value) { return value === 0 ? instanceCard.textDefault : value }
+                                valueFromText: function(text) { return parseInt(text) || 0 }
+                                onValueModified: instanceCard.updateConfig("cpuWeight", value)
+                            }
+
+                            Controls.TextField {
+                                Kirigami.FormData.label: instanceCard.labelCpuCores
+                                placeholderText: instanceCard.textAllCores
+                                text: instanceCard.cpuCores
+                                validator: RegularExpressionValidator { regularExpression: /^[0-9,\- ]*$/ }
+                                onEditingFinished: instanceCard.updateConfig("cpuCores", text)
+                            }
+
+                            Controls.SpinBox {
+                                Kirigami.FormData.label: instanceCard.labelIoWeight
+                                from: 0
+                                to: 10000
+                                stepSize: 50
+                                value: instanceCard.ioWeight
+                                textFromValue: function(value) { return value === 0 ? instanceCard.textDefault : value }
+                                valueFromText: function(text) { return parseInt(text) || 0 }
+                                onValueModified: instanceCard.updateConfig("ioWeight", value)
+                            }
+
+                            Controls.SpinBox {
+                                Kirigami.FormData.label: instanceCard.labelMemoryHigh
+                                from: 0
+                                to: 65536
+                                stepSize: 512
+                                value: instanceCard.memoryHighMb
+                                textFromValue: function(value) { return value === 0 ? instanceCard.textDefault : value + " MiB" }
+                                valueFromText: function(text) { return parseInt(text) || 0 }
+                                onValueModified: instanceCard.updateConfig("memoryHighMb", value)
+                            }
+
+                            Controls.ComboBox {
+                                Kirigami.FormData.label: instanceCard.labelGpu
+                                visible: root.gpuChoices.length > 3
+                                Layout.fillWidth: true
+                                model: root.gpuChoices
+                                textRole: "text"
+                                valueRole: "value"
+                                // A pinned GPU that is gone shows as automatic, which is what it gets
+                                currentIndex: {
+                                    let choices = root.gpuChoices
+                                    for (let i = 0; i < choices.length; i++) {
+                                        if (choices[i].value === instanceCard.gpu) {
+                                            return i
+                                        }
                                     }
+                                    return 1
                                 }
+                                onActivated: instanceCard.updateConfig("gpu", currentValue)
                             }
 
                             Controls.ComboBox {
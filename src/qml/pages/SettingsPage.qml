@@ -50,6 +50,11 @@ Kirigami.ScrollablePage {
     readonly property string filterMode: settingsManager?.filterMode ?? "linear"
     readonly property bool steamIntegration: settingsManager?.steamIntegration ?? true
     readonly property bool borderlessWindows: settingsManager?.borderlessWindows ?? false
+    readonly property bool inputRouting: settingsManager?.inputRouting ?? false
+    readonly property bool warmStandby: settingsManager?.warmStandby ?? false
+    readonly property bool prelaunchInstances: settingsManager?.prelaunchInstances ?? false
+    readonly property int standbyIdleTimeout: settingsManager?.standbyIdleTimeout ?? 15
+    readonly property int standbyMemoryLimit: settingsManager?.standbyMemoryLimit ?? 0
 
     actions: [
         Kirigami.Action {
@@ -172,6 +177,74 @@ Kirigami.ScrollablePage {
                 Controls.ToolTip.visible: hovered
                 Controls.ToolTip.delay: 1000
             }
+
+            Controls.CheckBox {
+                id: inputRoutingCheck
+                Kirigami.FormData.label: i18nc("@option:check", "Route input devices:")
+                checked: root.sessionRunner ? root.sessionRunner.inputRouting : root.inputRouting
+                onToggled: {
+                    if (root.settingsManager) root.settingsManager.inputRouting = checked
+                    if (root.sessionRunner) {
+                        root.sessionRunner.inputRouting = checked
+                    }
+                }
+
+                Controls.ToolTip.text: i18nc("@info:tooltip", "Forward input through per-player virtual devices instead of changing device ownership. Devices can then be reassigned while a session is running.")
+                Controls.ToolTip.visible: hovered
+                Controls.ToolTip.delay: 1000
+            }
+
+            Controls.CheckBox {
+                id: warmStandbyCheck
+                Kirigami.FormData.label: i18nc("@option:check", "Warm standby:")
+                checked: root.warmStandby
+                onToggled: if (root.settingsManager) root.settingsManager.warmStandby = checked
+
+                Controls.ToolTip.text: i18nc("@info:tooltip", "Prepare the selected profile's players while no session runs so starting a session only has to place the windows.")
+                Controls.ToolTip.visible: hovered
+                Controls.ToolTip.delay: 1000
+            }
+
+            Controls.CheckBox {
+                id: prelaunchCheck
+                Kirigami.FormData.label: i18nc("@option:check", "Pre-launch instances:")
+                enabled: warmStandbyCheck.checked
+                checked: root.prelaunchInstances
+                onToggled: if (root.settingsManager) root.settingsManager.prelaunchInstances = checked
+
+                Controls.ToolTip.text: i18nc("@info:tooltip", "Also start each player's instance in the background, minimized until the session starts. Uses memory while idle.")
+                Controls.ToolTip.visible: hovered
+                Controls.ToolTip.delay: 1000
+            }
+
+            Controls.SpinBox {
+                id: standbyIdleSpin
+                Kirigami.FormData.label: i18nc("@label:spinbox", "Drop standby after (minutes):")
+                enabled: warmStandbyCheck.checked
+                from: 0
+                to: 240
+                value: root.standbyIdleTimeout
+                onValueModified: if (root.settingsManager) root.settingsManager.standbyIdleTimeout = value
+
+                Controls.ToolTip.text: i18nc("@info:tooltip", "Stop unused standby instances after this long. 0 keeps them until the profile changes.")
+                Controls.ToolTip.visible: hovered
+                Controls.ToolTip.delay: 1000
+            }
+
+            Controls.SpinBox {
+                id: standbyMemorySpin
+                Kirigami.FormData.label: i18nc("@label:spinbox", "Standby memory limit (MiB):")
+                enabled: prelaunchCheck.enabled && prelaunchCheck.checked
+                from: 0
+                to: 65536
+                stepSize: 256
+                value: root.standbyMemoryLimit
+                onValueModified: if (root.settingsManager) root.settingsManager.standbyMemoryLimit = value
+
+                Controls.ToolTip.text: i18nc("@info:tooltip", "Stop a standby instance once its user uses more memory than this. 0 for no limit.")
+                Controls.ToolTip.visible: hovered
+                Controls.ToolTip.delay: 1000
+            }
         }
 
         // Launch Presets Section
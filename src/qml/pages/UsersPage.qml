@@ -118,7 +118,9 @@ Kirigami.ScrollablePage {
             delegate: Kirigami.Card {
                 Layout.fillWidth: true
 
-                banner.title: modelData.username
+                banner.title: modelData.ephemeral
+                              ? i18nc("@title:group", "%1 (guest)", modelData.username)
+                              : modelData.username
                 banner.titleIcon: "user"
 
                 contentItem: ColumnLayout {
@@ -156,11 +158,32 @@ Kirigami.ScrollablePage {
                             }
                         }
 
+                        Controls.BusyIndicator {
+                            visible: running
+                            running: userManager?.deletingUsers.includes(modelData.username) ?? false
+                        }
+
+                        Controls.Button {
+                            icon.name: "document-save-as-template"
+                            text: i18nc("@action:button", "Use as Template")
+                            visible: !modelData.ephemeral
+                            enabled: helperClient?.available ?? false
+                            Controls.ToolTip.visible: hovered
+                            Controls.ToolTip.text: i18nc("@info:tooltip", "Guests start with a copy of this player's home. Log out of Steam in this account first.")
+                            onClicked: {
+                                if (userManager.saveTemplate(modelData.username)) {
+                                    applicationWindow().showPassiveNotification(
+                                        i18nc("@info", "Saved %1 as the player template", modelData.username))
+                                }
+                            }
+                        }
+
                         // Delete button
                         Controls.Button {
                             icon.name: "edit-delete"
                             text: i18nc("@action:button", "Delete")
-                            enabled: helperClient?.available ?? false
+                            enabled: (helperClient?.available ?? false)
+                                     && !(userManager?.deletingUsers.includes(modelData.username) ?? false)
                             onClicked: {
                                 root.userToDelete = modelData.username
                                 deleteHomeCheckbox.checked = false
@@ -297,7 +320,10 @@ Kirigami.ScrollablePage {
                 icon.name: "list-add-user"
                 enabled: usernameField.text.length > 0 && userManager.isValidUsername(usernameField.text) && !userManager.userExists(usernameField.text) && (helperClient?.available ?? false)
                 onTriggered: {
-                    if (userManager.createUser(usernameField.text)) {
+                    let created = ephemeralCheckbox.checked
+                        ? userManager.createEphemeralUser(usernameField.text)
+                        : userManager.createUser(usernameField.text)
+                    if (created) {
                         addUserDialog.close()
                     }
                 }
@@ -314,6 +340,14 @@ Kirigami.ScrollablePage {
             }
 
             Kirigami.FormLayout {
+                Controls.CheckBox {
+                    id: ephemeralCheckbox
+                    Kirigami.FormData.label: i18nc("@label", "Guest:")
+                    text: i18nc("@option:check", "Clone from the player template, delete after the session")
+                    visible: userManager?.hasTemplate ?? false
+                    checked: false
+                }
+
                 Controls.TextField {
                     id: usernameField
                     Kirigami.FormData.label: i18nc("@label", "Username:")
@@ -0,0 +1,103 @@
+# SPDX-License-Identifier: GPL-3.0-or-later
+# SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+# Collects the <BenchmarkResult> elements of the QtTest XML files in
+# RESULT_DIR into one JSON file at OUTPUT, for comparing runs:
+#
+#   {"commit": "...", "timestamp": "...", "results": [
+#     {"test": "test_vdf", "function": "benchmarkParseShortcuts", "tag": "1000",
+#      "metric": "WalltimeMilliseconds", "value": 0.52, "iterations": 256}, ...]}
+#
+# Usage: cmake -DRESULT_DIR=<dir> -DOUTPUT=<file> [-DSOURCE_DIR=<repo>] -P BenchmarkResults.cmake
+
+if(NOT RESULT_DIR OR NOT OUTPUT)
+    message(FATAL_ERROR "RESULT_DIR and OUTPUT are required")
+endif()
+
+function(xml_attribute LINE NAME OUT)
+    if("${LINE}" MATCHES " ${NAME}=\"([^\"]*)\"")
+        set(value "${CMAKE_MATCH_1}")
+        string(REPLACE "&quot;" "\"" value "${value}")
+        string(REPLACE "&apos;" "'" value "${value}")
+        string(REPLACE "&lt;" "<" value "${value}")
+        string(REPLACE "&gt;" ">" value "${value}")
+        string(REPLACE "&amp;" "&" value "${value}")
+        set(${OUT} "${value}" PARENT_SCOPE)
+    else()
+        set(${OUT} "" PARENT_SCOPE)
+    endif()
+endfunction()
+
+# JSON string literal for VALUE
+function(json_string VALUE OUT)
+    string(REPLACE "\\" "\\\\" value "${VALUE}")
+    string(REPLACE "\"" "\\\"" value "${value}")
+    set(${OUT} "\"${value}\"" PARENT_SCOPE)
+endfunction()
+
+set(commit "")
+if(SOURCE_DIR)
+    find_package(Git QUIET)
+    if(GIT_FOUND)
+        execute_process(COMMAND ${GIT_EXECUTABLE} rev-parse HEAD
+                        WORKING_DIRECTORY ${SOURCE_DIR}
+                        OUTPUT_VARIABLE commit
+                        OUTPUT_STRIP_TRAILING_WHITESPACE
+                        ERROR_QUIET)
+    endif()
+endif()
+string(TIMESTAMP timestamp "%Y-%m-%dT%H:%M:%SZ" UTC)
+
+set(json "{}")
+json_string("${commit}" value)
+string(JSON json SET "${json}" commit "${value}")
+json_string("${timestamp}" value)
+string(JSON json SET "${json}" timestamp "${value}")
+string(JSON json SET "${json}" results "[]")
+
+set(count 0)
+file(GLOB xml_files "${RESULT_DIR}/*.xml")
+list(SORT xml_files)
+foreach(xml_file IN LISTS xml_files)
+    get_filename_component(test "${xml_file}" NAME_WE)
+    file(STRINGS "${xml_file}" lines REGEX "<TestFunction |<BenchmarkResult ")
+    set(function "")
+    foreach(line IN LISTS lines)
+        if(line MATCHES "<TestFunction ")
+            xml_attribute("${line}" name function)
+            continue()
+        endif()
+
+        xml_attribute("${line}" metric metric)
+        xml_attribute("${line}" tag tag)
+        xml_attribute("${line}" value result)
+        xml_attribute("${line}" iterations iterations)
+        if(NOT result MATCHES "^[-+0-9.eE]+$")
+            continue()
+        endif()
+        if(NOT iterations MATCHES "^[0-9]+$")
+            set(iterations 0)
+        endif()
+
+        set(entry "{}")
+        json_string("${test}" value)
+        string(JSON entry SET "${entry}" test "${value}")
+        json_string("${function}" value)
+        string(JSON entry SET "${entry}" function "${value}")
+        json_string("${tag}" value)
+        string(JSON entry SET "${entry}" tag "${value}")
+        json_string("${metric}" value)
+        string(JSON entry SET "${entry}" metric "${value}")
+        string(JSON entry SET "${entry}" value "${result}")
+        string(JSON entry SET "${entry}" iterations "${iterations}")
+        string(JSON json SET "${json}" results ${count} "${entry}")
+        math(EXPR count "${count} + 1")
+    endforeach()
+endforeach()
+
+if(count EQUAL 0)
+    message(FATAL_ERROR "No benchmark results in ${RESULT_DIR}")
+endif()
+
+file(WRITE "${OUTPUT}" "${json}\n")
+message(STATUS "${count} benchmark results written to ${OUTPUT}")
@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "CgroupStats.h"
+
+class TestCgroupStats : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testCgroupOf();
+    void testReadUsage();
+
+private:
+    static bool writeFile(const QString &path, const QByteArray &contents);
+};
+
+bool TestCgroupStats::writeFile(const QString &path, const QByteArray &contents)
+{
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(contents) == contents.size();
+}
+
+void TestCgroupStats::testCgroupOf()
+{
+    QTemporaryDir proc;
+    QVERIFY(proc.isValid());
+
+    QCOMPARE(CgroupStats::cgroupOf(4242, proc.path()), QString());
+    QCOMPARE(CgroupStats::cgroupOf(0, proc.path()), QString());
+
+    // Hybrid setups list the v1 controllers first
+    QVERIFY(writeFile(proc.path() + QStringLiteral("/4242/cgroup"),
+                      "12:cpuset:/\n0::/user.slice/user-1002.slice/couchplay-player2-1.service\n"));
+    QCOMPARE(CgroupStats::cgroupOf(4242, proc.path()),
+             QStringLiteral("/user.slice/user-1002.slice/couchplay-player2-1.service"));
+}
+
+void TestCgroupStats::testReadUsage()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    const QString cgroup = QStringLiteral("/user.slice/user-1002.slice/couchplay-player2-1.service");
+
+    CgroupStats::Usage usage = CgroupStats::readUsage(cgroup, root.path());
+    QCOMPARE(usage.cpuUsageUs, qint64(-1));
+    QCOMPARE(usage.memoryBytes, qint64(-1));
+
+    QVERIFY(writeFile(root.path() + cgroup + QStringLiteral("/cpu.stat"),
+                      "usage_usec 1500000\nuser_usec 1000000\nsystem_usec 500000\n"));
+    QVERIFY(writeFile(root.path() + cgroup + QStringLiteral("/memory.current"), "734003200\n"));
+    usage = CgroupStats::readUsage(cgroup, root.path());
+    QCOMPARE(usage.cpuUsageUs, qint64(1500000));
+    QCOMPARE(usage.memoryBytes, qint64(734003200));
+}
+
+QTEST_MAIN(TestCgroupStats)
+#include "test_cgroupstats.moc"
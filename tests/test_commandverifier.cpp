@@ -26,8 +26,21 @@ private Q_SLOTS:
     void testAbsoluteValidation();
     void testNonExistentCommand();
     void testFlatpakAppDetection();
+    void testPathCache();
+
+private:
+    static void writeExecutable(const QString &path);
 };
 
+void TestCommandVerifier::writeExecutable(const QString &path)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("#!/bin/sh\n");
+    file.close();
+    QVERIFY(QFile::setPermissions(path, QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner));
+}
+
 void TestCommandVerifier::testFlatpakDetection()
 {
     // Test flatpak command detection
@@ -134,5 +147,40 @@ void TestCommandVerifier::testFlatpakAppDetection()
     QVERIFY(!CommandVerifier::isFlatpakAppInstalled(QStringLiteral("com.example")));
 }
 
+void TestCommandVerifier::testPathCache()
+{
+    QTemporaryDir first;
+    QTemporaryDir second;
+    QVERIFY(first.isValid() && second.isValid());
+
+    const QByteArray originalPath = qgetenv("PATH");
+    qputenv("PATH", QFile::encodeName(first.path() + QLatin1Char(':') + second.path()));
+
+    const QString name = QStringLiteral("couchplay-test-tool");
+    QVERIFY(CommandVerifier::resolveCommandPath(name).isEmpty());
+
+    // A new file changes the directory's mtime, which drops its cached listing
+    QTest::qSleep(20);
+    writeExecutable(second.filePath(name));
+    QCOMPARE(CommandVerifier::resolveCommandPath(name), second.filePath(name));
+    QVERIFY(CommandVerifier::commandExistsInPath(name));
+
+    // Earlier PATH entries win; files that aren't executable are passed over
+    QTest::qSleep(20);
+    QFile plain(first.filePath(name));
+    QVERIFY(plain.open(QIODevice::WriteOnly));
+    plain.close();
+    QCOMPARE(CommandVerifier::resolveCommandPath(name), second.filePath(name));
+    QVERIFY(QFile::setPermissions(first.filePath(name), QFileDevice::ReadOwner | QFileDevice::ExeOwner));
+    QCOMPARE(CommandVerifier::resolveCommandPath(name), first.filePath(name));
+
+    // Arguments are not part of the name
+    const CommandVerificationResult result = CommandVerifier::verifyCommand(name + QStringLiteral(" --fullscreen"));
+    QVERIFY(result.isValid);
+    QCOMPARE(result.resolvedPath, first.filePath(name));
+
+    qputenv("PATH", originalPath);
+}
+
 QTEST_MAIN(TestCommandVerifier)
 #include "test_commandverifier.moc"
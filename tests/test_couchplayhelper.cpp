@@ -4,19 +4,35 @@
 #include <QTest>
 #include <QSignalSpy>
 #include <QProcess>
+#include <QCryptographicHash>
 #include <QDBusConnection>
 #include <QDBusInterface>
 #include <QDBusReply>
-
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+
+#include "../helper/AclStateCache.h"
 #include "../helper/CouchPlayHelper.h"
+#include "../helper/HelperTrace.h"
+#include "../helper/InputRouter.h"
+#include "../helper/InstanceSupervisor.h"
+#include "../helper/PrepareInstanceSpec.h"
 #include "../helper/SystemOps.h"
 
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
 // Mock SystemOps for testing - no real system calls
 class MockSystemOps : public SystemOps
 {
 public:
     MockSystemOps() = default;
-    ~MockSystemOps() override = default;
+    ~MockSystemOps() override { closePidfdWriters(); }
 
     // Configuration methods for test setup
     void setAuthResult(bool authorized) { m_authorized = authorized; }
@@ -54,15 +70,55 @@ public:
         m_files.clear();
         m_directories.clear();
         m_authorized = true;
+        m_authChecks.clear();
+        m_authInteractive.clear();
         m_processExitCode = 0;
         m_chownResult = 0;
         m_chmodResult = 0;
+        m_processCommand.clear();
         m_processArgs.clear();
+        m_aclCalls.clear();
+        setAclResult(true);
+        m_units.clear();
+        m_unitSignals.clear();
+        m_unitPid = 0;
+        m_killUnitResult = true;
+        m_unitProperties.clear();
+        m_writtenFiles.clear();
+        m_seededDirectories.clear();
+        m_seedRoot.clear();
+        m_mountCalls.clear();
+        m_overlayResult = true;
+        m_bindResult = true;
+        m_useraddUser.clear();
+        m_seedCreatesTarget = false;
+        m_pidfdsSupported = true;
+        m_pidfdSignals.clear();
+        m_exitStatuses.clear();
+        m_journalEntries.clear();
+        m_journalReads.clear();
+        QMutexLocker locker(&m_teardownMutex);
+        m_processCalls.clear();
+        m_teardownCalls.clear();
     }
 
     // Get last process arguments for verification
     QStringList getLastProcessArgs() const { return m_processArgs; }
     QString getLastProcessCommand() const { return m_processCommand; }
+    QByteArray writtenFile(const QString &path) const { return m_writtenFiles.value(path); }
+    QList<QPair<QString, QString>> seededDirectories() const { return m_seededDirectories; }
+    QString seedRoot() const { return m_seedRoot; }
+    QStringList mountCalls() const { return m_mountCalls; }
+    void setOverlayResult(bool result) { m_overlayResult = result; }
+    void setBindResult(bool result) { m_bindResult = result; }
+    // useradd creates @p username instead of running
+    void setUseraddCreates(const QString &username, uint uid, const QString &home) {
+        m_useraddUser = username;
+        m_useraddUid = uid;
+        m_useraddHome = home;
+    }
+    void setSeedCreatesTarget(bool creates) { m_seedCreatesTarget = creates; }
+    QList<QStringList> processCalls() const { return m_processCalls; }
 
     // User/group lookup operations
     struct passwd *getpwnam(const char *name) override {
@@ -124,12 +180,89 @@ public:
     }
 
     bool writeFile(const QString &path, const QByteArray &content) override {
+        // Always succeed for tests
+        m_writtenFiles[path] = content;
+        return true;
+    }
+
+    bool makeDirectoryBelow(const QString &root, const QString &path, uid_t uid, gid_t gid,
+                            QString &error) override {
+        Q_UNUSED(root)
         Q_UNUSED(path)
-        Q_UNUSED(content)
+        Q_UNUSED(uid)
+        Q_UNUSED(gid)
+        Q_UNUSED(error)
         // Always succeed for tests
         return true;
     }
 
+    FileTransfer transferFile(int sourceFd, const QString &root, const QString &path, uid_t uid, gid_t gid,
+                              mode_t mode) override {
+        Q_UNUSED(root)
+        Q_UNUSED(uid)
+        Q_UNUSED(gid)
+        Q_UNUSED(mode)
+        QFile source;
+        source.open(sourceFd, QIODevice::ReadOnly);
+        source.seek(0);
+        m_writtenFiles[path] = source.readAll();
+
+        FileTransfer transfer;
+        transfer.success = true;
+        transfer.bytes = m_writtenFiles[path].size();
+        transfer.method = QStringLiteral("copy");
+        return transfer;
+    }
+
+    FileTransfer seedDirectory(const QString &source, const QString &target, uid_t uid, gid_t gid,
+                               const QString &root = QString()) override {
+        Q_UNUSED(uid)
+        Q_UNUSED(gid)
+        m_seededDirectories.append({source, target});
+        m_seedRoot = root;
+        if (m_seedCreatesTarget) {
+            QDir().mkpath(target);
+        }
+
+        FileTransfer transfer;
+        transfer.success = true;
+        transfer.bytes = 4096;
+        transfer.method = QStringLiteral("reflink");
+        return transfer;
+    }
+
+    bool mountIdmapped(const QString &source, const QString &target, uid_t fromUid, gid_t fromGid,
+                       uid_t toUid, gid_t toGid, QString &error) override {
+        Q_UNUSED(fromGid)
+        Q_UNUSED(toGid)
+        m_mountCalls.append(QStringLiteral("idmap %1 %2 %3:%4").arg(source, target).arg(fromUid).arg(toUid));
+        if (!m_overlayResult) {
+            error = QStringLiteral("Invalid argument");
+        }
+        return m_overlayResult;
+    }
+
+    bool mountOverlay(const QString &lower, const QString &upper, const QString &work,
+                      const QString &target, QString &error) override {
+        Q_UNUSED(error)
+        m_mountCalls.append(QStringLiteral("overlay %1 %2 %3 %4").arg(lower, upper, work, target));
+        return true;
+    }
+
+    bool bindMount(const QString &source, const QString &target, QString &error) override {
+        m_mountCalls.append(QStringLiteral("bind %1 %2").arg(source, target));
+        if (!m_bindResult) {
+            error = QStringLiteral("Permission denied");
+        }
+        return m_bindResult;
+    }
+
+    bool unmount(const QString &target, QString &error) override {
+        Q_UNUSED(error)
+        m_mountCalls.append(QStringLiteral("umount %1").arg(target));
+        return true;
+    }
+
     // Device path validation
     bool statPath(const QString &path, struct stat *buf) override {
         Q_UNUSED(path)
@@ -158,14 +291,47 @@ public:
         return m_chmodResult;
     }
 
+    // POSIX ACLs
+    struct AclCall {
+        QString path;
+        uid_t uid;
+        bool recursive;
+        DirectoryFingerprints known;
+    };
+
+    AclResult grantUserAcl(const QString &path, uid_t uid, bool recursive,
+                           const DirectoryFingerprints &known) override {
+        m_aclCalls.append({path, uid, recursive, known});
+        return m_aclResult;
+    }
+
+    void setAclResult(bool success, const QString &error = QString(),
+                      const DirectoryFingerprints &directories = {}) {
+        m_aclResult = AclResult();
+        m_aclResult.success = success;
+        m_aclResult.updated = success ? 1 : 0;
+        m_aclResult.error = error;
+        m_aclResult.directories = directories;
+    }
+    QList<AclCall> aclCalls() const { return m_aclCalls; }
+
     // Process operations
     QProcess *createProcess(QObject *parent = nullptr) override {
         return new QProcess(parent);
     }
 
     void startProcess(QProcess *process, const QString &program, const QStringList &arguments) override {
-        m_processCommand = program;
-        m_processArgs = arguments;
+        {
+            QMutexLocker locker(&m_teardownMutex);
+            m_processCommand = program;
+            m_processArgs = arguments;
+            m_processCalls.append(QStringList{program} + arguments);
+        }
+        if (program == QStringLiteral("useradd") && !m_useraddUser.isEmpty()) {
+            // Simulated, the account appears without touching the system
+            setUserExists(m_useraddUser, true, m_useraddUid, m_useraddUid, m_useraddHome);
+            return;
+        }
         process->start(program, arguments);
     }
 
@@ -198,13 +364,141 @@ public:
         return true;
     }
 
+    // pidfds are the read ends of pipes; exitProcess() makes one readable
+    int openPidfd(pid_t pid) override {
+        if (!m_pidfdsSupported) {
+            errno = ENOSYS;
+            return -1;
+        }
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) != 0) {
+            return -1;
+        }
+        if (m_pidfdWriters.contains(pid)) {
+            ::close(m_pidfdWriters.take(pid));
+        }
+        m_pidfdWriters[pid] = fds[1];
+        m_pidfdPids[fds[0]] = pid;
+        return fds[0];
+    }
+
+    bool signalPidfd(int pidfd, int signal) override {
+        m_pidfdSignals.append({m_pidfdPids.value(pidfd), signal});
+        return true;
+    }
+
+    int pidfdExitStatus(int pidfd) override {
+        return m_exitStatuses.value(m_pidfdPids.value(pidfd), -1);
+    }
+
+    void setPidfdsSupported(bool supported) { m_pidfdsSupported = supported; }
+    void exitProcess(pid_t pid, int status) {
+        m_exitStatuses[pid] = status;
+        if (m_pidfdWriters.contains(pid)) {
+            const int fd = m_pidfdWriters.take(pid);
+            (void)::write(fd, "x", 1);
+            ::close(fd);
+        }
+    }
+    QList<QPair<pid_t, int>> pidfdSignals() const { return m_pidfdSignals; }
+    void closePidfdWriters() {
+        for (int fd : std::as_const(m_pidfdWriters)) {
+            ::close(fd);
+        }
+        m_pidfdWriters.clear();
+    }
+
+    // User teardown; steps of a deletion run on several threads at once
+    int killUserProcesses(uid_t uid, int timeoutMs) override {
+        Q_UNUSED(timeoutMs)
+        recordTeardown(QStringLiteral("kill %1").arg(uid));
+        return 0;
+    }
+
+    int removeUserIpc(uid_t uid) override {
+        recordTeardown(QStringLiteral("ipc %1").arg(uid));
+        return 0;
+    }
+
+    int removeOwnedFiles(const QString &root, uid_t uid) override {
+        recordTeardown(QStringLiteral("files %1 %2").arg(root).arg(uid));
+        return 0;
+    }
+
+    bool setUserLinger(uid_t uid, bool enable, QString &error) override {
+        Q_UNUSED(error)
+        recordTeardown(QStringLiteral("linger %1 %2").arg(uid).arg(enable));
+        return true;
+    }
+
+    QStringList teardownCalls() const {
+        QMutexLocker locker(&m_teardownMutex);
+        return m_teardownCalls;
+    }
+
+    // Transient services
+    qint64 startTransientUnit(const TransientUnitSpec &spec, QString &error) override {
+        m_units.append(spec);
+        if (m_unitPid <= 0) {
+            error = QStringLiteral("systemd unavailable");
+        }
+        return m_unitPid;
+    }
+
+    bool killUnit(const QString &unit, int signal) override {
+        m_unitSignals.append({unit, signal});
+        return m_killUnitResult;
+    }
+
+    bool setUnitProperties(const QString &unit, const QVariantMap &properties, QString &error) override {
+        Q_UNUSED(error)
+        m_unitProperties.append({unit, properties});
+        return true;
+    }
+
+    QList<JournalEntry> readJournal(const QString &identifier, const QString &afterCursor,
+                                    int maxEntries, QString &cursor) override {
+        m_journalReads.append({identifier, afterCursor, maxEntries});
+        cursor = m_journalEntries.isEmpty() ? afterCursor : QStringLiteral("cursor-%1").arg(m_journalEntries.size());
+        return m_journalEntries.mid(0, maxEntries);
+    }
+
+    struct JournalRead {
+        QString identifier;
+        QString afterCursor;
+        int maxEntries = 0;
+    };
+    void setJournalEntries(const QList<JournalEntry> &entries) { m_journalEntries = entries; }
+    QList<JournalRead> journalReads() const { return m_journalReads; }
+
+    void setUnitPid(qint64 pid) { m_unitPid = pid; }
+    void setKillUnitResult(bool result) { m_killUnitResult = result; }
+    QList<TransientUnitSpec> units() const { return m_units; }
+    QList<QPair<QString, int>> unitSignals() const { return m_unitSignals; }
+    QList<QPair<QString, QVariantMap>> unitProperties() const { return m_unitProperties; }
+
+    // Input routing needs real evdev/uinput devices
+    InputRouter *createInputRouter(QObject *parent) override {
+        Q_UNUSED(parent)
+        return nullptr;
+    }
+
     // Authorization check
-    bool checkAuthorization(const QString &action) override {
-        Q_UNUSED(action)
+    bool checkAuthorization(const QString &action, const QString &subject, bool allowInteraction) override {
+        Q_UNUSED(subject)
+        m_authChecks.append(action);
+        m_authInteractive.append(allowInteraction);
         return m_authorized;
     }
+    QStringList authChecks() const { return m_authChecks; }
+    QList<bool> authInteractive() const { return m_authInteractive; }
 
 private:
+    void recordTeardown(const QString &call) {
+        QMutexLocker locker(&m_teardownMutex);
+        m_teardownCalls.append(call);
+    }
+
     struct PwEntry {
         struct passwd pw;
         QByteArray usernameBytes;
@@ -253,11 +547,40 @@ private:
     QMap<QString, bool> m_files;
     QMap<QString, bool> m_directories;
     bool m_authorized = true;
+    QStringList m_authChecks;
+    QList<bool> m_authInteractive;
     int m_processExitCode = 0;
     int m_chownResult = 0;
     int m_chmodResult = 0;
     QString m_processCommand;
     QStringList m_processArgs;
+    QList<AclCall> m_aclCalls;
+    AclResult m_aclResult;
+    QList<TransientUnitSpec> m_units;
+    QList<QPair<QString, int>> m_unitSignals;
+    qint64 m_unitPid = 0;
+    bool m_killUnitResult = true;
+    QList<QPair<QString, QVariantMap>> m_unitProperties;
+    QMap<QString, QByteArray> m_writtenFiles;
+    QList<QPair<QString, QString>> m_seededDirectories;
+    QString m_seedRoot;
+    QStringList m_mountCalls;
+    bool m_overlayResult = true;
+    bool m_bindResult = true;
+    QString m_useraddUser;
+    uint m_useraddUid = 0;
+    QString m_useraddHome;
+    bool m_seedCreatesTarget = false;
+    bool m_pidfdsSupported = true;
+    QMap<pid_t, int> m_pidfdWriters;
+    QMap<int, pid_t> m_pidfdPids;
+    QList<QPair<pid_t, int>> m_pidfdSignals;
+    QList<JournalEntry> m_journalEntries;
+    QList<JournalRead> m_journalReads;
+    QMap<pid_t, int> m_exitStatuses;
+    mutable QMutex m_teardownMutex;
+    QStringList m_teardownCalls;
+    QList<QStringList> m_processCalls;
 };
 
 // Test class for CouchPlayHelper
@@ -278,12 +601,16 @@ private Q_SLOTS:
     void testCreateUserAuthDenied();
     void testCreateUserProcessFailure();
     void testCreateUserLingerFailure();
+    void testCreateEphemeralUserNoTemplate();
+    void testCreateEphemeralUserFromTemplate();
+    void testSaveUserTemplate();
     void testDeleteUserSuccess();
     void testDeleteUserInvalidUsername();
     void testDeleteUserNonexistent();
     void testDeleteUserAuthDenied();
     void testDeleteUserNotInCouchPlayGroup();
     void testDeleteUserProcessFailure();
+    void testDeleteUserConcurrent();
     void testIsInCouchPlayGroupTrue();
     void testIsInCouchPlayGroupFalse();
     void testIsInCouchPlayGroupNonexistent();
@@ -320,6 +647,15 @@ private Q_SLOTS:
     void testChangeDeviceOwnerBatchPartialFailure();
     void testChangeDeviceOwnerBatchAllFailure();
 
+    // Input router tests
+    void testRouteDeviceInvalidPath();
+    void testRouteDeviceAuthorizationDenied();
+    void testRouteDeviceUnavailable();
+    void testRouteDeviceWithoutUdevRule();
+    void testPrepareInstanceRouteDevicesUnavailable();
+    void testInputRouterStatsWithoutRouter();
+    void testLatencyHistogram();
+
     // Runtime access tests (Polkit + D-Bus integration)
     void testSetupRuntimeAccessSuccess();
     void testSetupRuntimeAccessAuthorizationDenied();
@@ -328,12 +664,67 @@ private Q_SLOTS:
     void testRemoveRuntimeAccessAuthorizationDenied();
     void testRemoveRuntimeAccessUserNotFound();
 
+    // Batched instance preparation tests
+    void testPrepareInstanceSuccess();
+    void testPrepareInstanceRollsBackOnDeviceFailure();
+    void testPrepareInstanceFileDescriptor();
+    void testMountSharedDirectoriesOverlay();
+    void testMountSharedDirectoriesOverlayFallback();
+    void testMountSharedDirectoriesBatch();
+    void testPrepareInstanceSharedCaches();
+    void testPrepareInstanceSharedCachesOtherHome();
+    void testPrepareInstanceSessionStep();
+    void testPrepareInstanceAuthorizationDenied();
+    void testPrepareInstanceInvalidUsername();
+
+    // Instance launch tests
+    void testLaunchInstanceTransientUnit();
+    void testStopInstanceSignalsUnit();
+    void testStopInstanceUnitGone();
+    void testInstanceExited();
+    void testInstanceLogFields();
+    void testReadInstanceLog();
+    void testSetInstanceResources();
+    void testSetInstanceResourcesInvalid();
+    void testGetInstanceGpuUsage();
+    void testPrepareInstanceLaunchResources();
+
+    // ACL tests
+    void testSetDirectoryAclRecursive();
+    void testSetDirectoryAclFailure();
+    void testSetPathAclWithParentsWalksUp();
+    void testSetPathAclWithParentsReportsFailure();
+    void testGrantUserAclSkipsExistingEntries();
+    void testSetDirectoryAclReusesFingerprints();
+    void testGrantUserAclSkipsUnchangedDirectories();
+    void testAclStateCacheRoundTrip();
+
+    // File transfer tests
+    void testCopyFileDescriptorToUser();
+    void testCopyFileDescriptorToUserOutsideHome();
+    void testTransferFileReplacesAtomically();
+    void testTransferFileRefusesSymlinks();
+    void testSeedDirectory();
+    void testSeedDirectoryBelowRoot();
+
     // Version test
     void testVersion();
 
+    // Tracing and metrics
+    void testHelperTrace();
+    void testHelperMetrics();
+    void testSessionGrant();
+    void testSessionGrantHeldByResources();
+    void testActionGrant();
+
+    // Benchmarks
+    void benchmarkPrepareInstance();
+    void benchmarkLaunchInstance();
+
 private:
     CouchPlayHelper *m_helper = nullptr;
     MockSystemOps *m_ops = nullptr;
+    QTemporaryDir m_stateDir;
     QString m_serviceName;
     QString m_objectPath;
     QDBusInterface *m_dbusInterface = nullptr;
@@ -353,6 +744,7 @@ void TestCouchPlayHelper::initTestCase()
     m_ops->setGroupExists(QStringLiteral("input"), true, 44, {});
 
     m_helper = new CouchPlayHelper(m_ops);
+    m_helper->setAclCacheDirectory(m_stateDir.path() + QStringLiteral("/acl"));
 
     // Register object on session bus with ExportAllSlots flag
     if (!QDBusConnection::sessionBus().registerObject(m_objectPath, m_helper,
@@ -512,6 +904,85 @@ void TestCouchPlayHelper::testCreateUserLingerFailure()
     QCOMPARE(reply.error().type(), QDBusError::Failed);
 }
 
+void TestCouchPlayHelper::testCreateEphemeralUserNoTemplate()
+{
+    m_ops->clear();
+    m_helper->setTemplateDirectory(QStringLiteral("/var/lib/couchplay/template"));
+
+    QDBusReply<uint> reply = m_dbusInterface->call(
+        QStringLiteral("CreateEphemeralUser"),
+        QStringLiteral("guest1"),
+        QStringLiteral("Guest 1")
+    );
+
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::Failed);
+    QVERIFY(m_ops->processCalls().isEmpty());
+}
+
+void TestCouchPlayHelper::testCreateEphemeralUserFromTemplate()
+{
+    m_ops->clear();
+    const QString templateHome = QStringLiteral("/var/lib/couchplay/template");
+    m_helper->setTemplateDirectory(templateHome);
+    m_ops->setDirectoryExists(templateHome, true);
+    m_ops->setUseraddCreates(QStringLiteral("guest1"), 1005, QStringLiteral("/home/guest1"));
+
+    QDBusReply<uint> reply = m_dbusInterface->call(
+        QStringLiteral("CreateEphemeralUser"),
+        QStringLiteral("guest1"),
+        QStringLiteral("Guest 1")
+    );
+
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value(), 1005u);
+
+    // No skeleton home, the template is cloned in its place
+    QStringList useradd;
+    for (const QStringList &call : m_ops->processCalls()) {
+        if (call.first() == QStringLiteral("useradd")) {
+            useradd = call;
+        }
+    }
+    QVERIFY(useradd.contains(QStringLiteral("-M")));
+    QVERIFY(!useradd.contains(QStringLiteral("-m")));
+    QCOMPARE(useradd.at(useradd.indexOf(QStringLiteral("-G")) + 1), QStringLiteral("input,couchplay,couchplay-guest"));
+    QCOMPARE(m_ops->seededDirectories(),
+             (QList<QPair<QString, QString>>{{templateHome, QStringLiteral("/home/guest1")}}));
+}
+
+void TestCouchPlayHelper::testSaveUserTemplate()
+{
+    m_ops->clear();
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString templateHome = dir.filePath(QStringLiteral("template"));
+    m_helper->setTemplateDirectory(templateHome);
+    m_ops->setSeedCreatesTarget(true);
+    m_ops->setGroupExists(QStringLiteral("couchplay"), true, 1001, {QStringLiteral("player2")});
+    m_ops->setUserExists(QStringLiteral("player2"), true, 1002, 1001, QStringLiteral("/home/player2"));
+
+    for (int i = 0; i < 2; ++i) {
+        QDBusReply<bool> reply = m_dbusInterface->call(QStringLiteral("SaveUserTemplate"), QStringLiteral("player2"));
+        QVERIFY(reply.isValid());
+        QVERIFY(reply.value());
+    }
+
+    // Built aside and swapped in, the earlier template is gone
+    QCOMPARE(m_ops->seededDirectories().size(), 2);
+    QCOMPARE(m_ops->seededDirectories().last(),
+             (QPair<QString, QString>(QStringLiteral("/home/player2"), templateHome + QStringLiteral(".new"))));
+    QVERIFY(QFileInfo(templateHome).isDir());
+    QVERIFY(!QFileInfo::exists(templateHome + QStringLiteral(".new")));
+    QVERIFY(!QFileInfo::exists(templateHome + QStringLiteral(".old")));
+
+    // Not for users CouchPlay doesn't manage
+    m_ops->setUserExists(QStringLiteral("alice"), true, 1000, 1000, QStringLiteral("/home/alice"));
+    QDBusReply<bool> reply = m_dbusInterface->call(QStringLiteral("SaveUserTemplate"), QStringLiteral("alice"));
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::AccessDenied);
+}
+
 // ============ DeleteUser Tests ============
 
 void TestCouchPlayHelper::testDeleteUserSuccess()
@@ -521,6 +992,9 @@ void TestCouchPlayHelper::testDeleteUserSuccess()
     m_ops->setGroupExists(QStringLiteral("input"), true, 44, {});
     m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1001);
 
+    QSignalSpy progress(m_helper, &CouchPlayHelper::UserDeletionProgress);
+    QSignalSpy finished(m_helper, &CouchPlayHelper::UserDeletionFinished);
+
     QDBusReply<bool> reply = m_dbusInterface->call(
         QStringLiteral("DeleteUser"),
         QStringLiteral("testuser"),
@@ -529,6 +1003,32 @@ void TestCouchPlayHelper::testDeleteUserSuccess()
 
     QVERIFY(reply.isValid());
     QVERIFY(reply.value());
+
+    QVERIFY(finished.wait(5000));
+    QCOMPARE(finished.first().at(0).toString(), QStringLiteral("testuser"));
+    QVERIFY(finished.first().at(1).toBool());
+    QCOMPARE(m_ops->getLastProcessCommand(), QStringLiteral("userdel"));
+    QCOMPARE(m_ops->getLastProcessArgs(), QStringList({QStringLiteral("testuser")}));
+
+    // The user is stopped before anything of theirs is removed, userdel goes last
+    QStringList steps;
+    for (const QList<QVariant> &signal : progress) {
+        steps << signal.at(1).toString();
+    }
+    QCOMPARE(steps.size(), 6);
+    QCOMPARE(QSet<QString>(steps.cbegin(), steps.cbegin() + 2),
+             QSet<QString>({QStringLiteral("linger"), QStringLiteral("processes")}));
+    QCOMPARE(QSet<QString>(steps.cbegin() + 2, steps.cbegin() + 5),
+             QSet<QString>({QStringLiteral("ipc"), QStringLiteral("tmp"), QStringLiteral("shm")}));
+    QCOMPARE(steps.last(), QStringLiteral("userdel"));
+
+    const QStringList calls = m_ops->teardownCalls();
+    QCOMPARE(calls.size(), 5);
+    QVERIFY(calls.contains(QStringLiteral("linger 1002 0")));
+    QVERIFY(calls.contains(QStringLiteral("kill 1002")));
+    QVERIFY(calls.contains(QStringLiteral("ipc 1002")));
+    QVERIFY(calls.contains(QStringLiteral("files /tmp 1002")));
+    QVERIFY(calls.contains(QStringLiteral("files /dev/shm 1002")));
 }
 
 void TestCouchPlayHelper::testDeleteUserInvalidUsername()
@@ -606,14 +1106,50 @@ void TestCouchPlayHelper::testDeleteUserProcessFailure()
     m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1001);
     m_ops->setProcessExitCode(1);
 
+    QSignalSpy finished(m_helper, &CouchPlayHelper::UserDeletionFinished);
+
     QDBusReply<bool> reply = m_dbusInterface->call(
         QStringLiteral("DeleteUser"),
         QStringLiteral("testuser"),
         false
     );
 
-    QVERIFY(!reply.isValid());
-    QCOMPARE(reply.error().type(), QDBusError::Failed);
+    // userdel only runs after the call has returned
+    QVERIFY(reply.isValid());
+    QVERIFY(finished.wait(5000));
+    QVERIFY(!finished.first().at(1).toBool());
+    QVERIFY(finished.first().at(2).toString().startsWith(QStringLiteral("Failed to delete user")));
+}
+
+void TestCouchPlayHelper::testDeleteUserConcurrent()
+{
+    m_ops->clear();
+    m_ops->setGroupExists(QStringLiteral("couchplay"), true, 1001,
+                          {QStringLiteral("player2"), QStringLiteral("player3")});
+    m_ops->setGroupExists(QStringLiteral("input"), true, 44, {});
+    m_ops->setUserExists(QStringLiteral("player2"), true, 1002, 1001);
+    m_ops->setUserExists(QStringLiteral("player3"), true, 1003, 1001);
+
+    QSignalSpy finished(m_helper, &CouchPlayHelper::UserDeletionFinished);
+
+    QDBusReply<bool> first = m_dbusInterface->call(QStringLiteral("DeleteUser"), QStringLiteral("player2"), true);
+    QDBusReply<bool> second = m_dbusInterface->call(QStringLiteral("DeleteUser"), QStringLiteral("player3"), true);
+    QVERIFY(first.isValid() && first.value());
+    QVERIFY(second.isValid() && second.value());
+
+    // Still running, nothing has been delivered yet
+    QDBusReply<bool> again = m_dbusInterface->call(QStringLiteral("DeleteUser"), QStringLiteral("player2"), true);
+    QVERIFY(!again.isValid());
+    QCOMPARE(again.error().type(), QDBusError::Failed);
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 2, 5000);
+    QSet<QString> deleted;
+    for (const QList<QVariant> &signal : finished) {
+        QVERIFY(signal.at(1).toBool());
+        deleted.insert(signal.at(0).toString());
+    }
+    QCOMPARE(deleted, QSet<QString>({QStringLiteral("player2"), QStringLiteral("player3")}));
+    QVERIFY(m_ops->teardownCalls().contains(QStringLiteral("kill 1003")));
 }
 
 // ============ IsInCouchPlayGroup Tests ============
@@ -1189,6 +1725,139 @@ void TestCouchPlayHelper::testChangeDeviceOwnerBatchAllFailure()
     QVERIFY(!reply.isValid());
 }
 
+// ============ Input Router Tests ============
+
+void TestCouchPlayHelper::testRouteDeviceInvalidPath()
+{
+    m_ops->clear();
+
+    QDBusReply<QString> reply = m_dbusInterface->call(
+        QStringLiteral("RouteDevice"),
+        QStringLiteral("/dev/input/../sda"),
+        1000u
+    );
+
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::InvalidArgs);
+}
+
+void TestCouchPlayHelper::testRouteDeviceAuthorizationDenied()
+{
+    m_ops->clear();
+    m_ops->setAuthResult(false);
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1000, 1000);
+    m_ops->setFileExists(QStringLiteral("/dev/input/event0"), true);
+
+    QDBusReply<QString> reply = m_dbusInterface->call(
+        QStringLiteral("RouteDevice"),
+        QStringLiteral("/dev/input/event0"),
+        1000u
+    );
+
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::AccessDenied);
+}
+
+void TestCouchPlayHelper::testRouteDeviceUnavailable()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1000, 1000);
+    m_ops->setFileExists(QStringLiteral("/dev/input/event0"), true);
+    m_ops->setFileExists(QStringLiteral("/etc/udev/rules.d/00-couchplay-router.rules"), true);
+
+    QDBusReply<QString> reply = m_dbusInterface->call(
+        QStringLiteral("RouteDevice"),
+        QStringLiteral("/dev/input/event0"),
+        1000u
+    );
+
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::Failed);
+    QVERIFY(reply.error().message().contains(QStringLiteral("not available")));
+}
+
+void TestCouchPlayHelper::testRouteDeviceWithoutUdevRule()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1000, 1000);
+    m_ops->setFileExists(QStringLiteral("/dev/input/event0"), true);
+
+    // The host compositor would pick up the virtual device too
+    QDBusReply<QString> reply = m_dbusInterface->call(
+        QStringLiteral("RouteDevice"),
+        QStringLiteral("/dev/input/event0"),
+        1000u
+    );
+
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::Failed);
+    QVERIFY(reply.error().message().contains(QStringLiteral("udev rule")));
+}
+
+void TestCouchPlayHelper::testPrepareInstanceRouteDevicesUnavailable()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setFileExists(QStringLiteral("/dev/input/event0"), true);
+
+    PrepareInstanceSpec spec;
+    spec.devices = {QStringLiteral("/dev/input/event0")};
+    spec.routeDevices = true;
+
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("PrepareInstance"),
+        QStringLiteral("testuser"),
+        1000u,
+        spec.toVariantMap()
+    );
+
+    QVERIFY(reply.isValid());
+    const QVariantMap result = reply.value();
+    QVERIFY(!result.value(QStringLiteral("success")).toBool());
+    QVERIFY(!result.value(QStringLiteral("devices.success")).toBool());
+
+    // Nothing was chowned as a fallback
+    QDBusReply<int> resetReply = m_dbusInterface->call(QStringLiteral("ResetAllDevices"));
+    QVERIFY(resetReply.isValid());
+    QCOMPARE(resetReply.value(), 0);
+}
+
+void TestCouchPlayHelper::testInputRouterStatsWithoutRouter()
+{
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(QStringLiteral("GetInputRouterStats"));
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value().value(QStringLiteral("devices")).toInt(), 0);
+
+    QDBusReply<int> stopReply = m_dbusInterface->call(QStringLiteral("StopInputRouting"));
+    QVERIFY(stopReply.isValid());
+    QCOMPARE(stopReply.value(), 0);
+}
+
+void TestCouchPlayHelper::testLatencyHistogram()
+{
+    LatencyHistogram histogram;
+    QCOMPARE(histogram.percentile(0.99), quint64(0));
+
+    // 98 fast events (100-127 us) and two slow ones
+    for (int i = 0; i < 98; ++i) {
+        histogram.record(100 + (i % 28));
+    }
+    histogram.record(3000);
+    histogram.record(0);
+
+    QCOMPARE(histogram.count(), quint64(100));
+    QCOMPARE(histogram.maximum(), quint64(3000));
+    QCOMPARE(histogram.percentile(0.5), quint64(128));
+    QCOMPARE(histogram.percentile(0.99), quint64(128));
+    QCOMPARE(histogram.percentile(1.0), quint64(4096));
+    QVERIFY(histogram.mean() >= 100 && histogram.mean() <= 160);
+
+    histogram.reset();
+    QCOMPARE(histogram.count(), quint64(0));
+    QCOMPARE(histogram.maximum(), quint64(0));
+}
+
 // ============ Runtime Access Tests (Polkit + D-Bus Integration) ============
 
 void TestCouchPlayHelper::testSetupRuntimeAccessSuccess()
@@ -1307,18 +1976,1316 @@ void TestCouchPlayHelper::testRemoveRuntimeAccessUserNotFound()
     QVERIFY(reply.value());
 }
 
-// ============ Version Test ============
+// ============ PrepareInstance Tests ============
 
-void TestCouchPlayHelper::testVersion()
+void TestCouchPlayHelper::testPrepareInstanceSuccess()
 {
     m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setFileExists(QStringLiteral("/dev/input/event0"), true);
+    m_ops->setFileExists(QStringLiteral("/dev/input/event1"), true);
 
-    QDBusReply<QString> reply = m_dbusInterface->call(
-        QStringLiteral("Version")
+    m_dbusInterface->call(QStringLiteral("ResetAllDevices"));
+
+    PrepareInstanceSpec spec;
+    spec.devices = {QStringLiteral("/dev/input/event0"), QStringLiteral("/dev/input/event1")};
+    spec.files.insert(QStringLiteral("/home/testuser/.steam/steam/userdata/1/config/shortcuts.vdf"),
+                      QByteArray("shortcuts"));
+
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("PrepareInstance"),
+        QStringLiteral("testuser"),
+        1000u,
+        spec.toVariantMap()
     );
 
     QVERIFY(reply.isValid());
-    QVERIFY(!reply.value().isEmpty());
+    const QVariantMap result = reply.value();
+    QVERIFY(result.value(QStringLiteral("success")).toBool());
+    QCOMPARE(result.value(QStringLiteral("steps")).toStringList(),
+             QStringList({QStringLiteral("devices"), QStringLiteral("files")}));
+    QCOMPARE(result.value(QStringLiteral("devices.count")).toInt(), 2);
+    QVERIFY(result.value(QStringLiteral("files.success")).toBool());
+    QVERIFY(result.contains(QStringLiteral("devices.elapsedMs")));
+    QCOMPARE(result.value(QStringLiteral("pid")).toLongLong(), 0);
+
+    // Both devices are tracked for cleanup
+    QDBusReply<int> resetReply = m_dbusInterface->call(QStringLiteral("ResetAllDevices"));
+    QVERIFY(resetReply.isValid());
+    QCOMPARE(resetReply.value(), 2);
+}
+
+void TestCouchPlayHelper::testPrepareInstanceRollsBackOnDeviceFailure()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setFileExists(QStringLiteral("/dev/input/event0"), true);
+
+    m_dbusInterface->call(QStringLiteral("ResetAllDevices"));
+
+    PrepareInstanceSpec spec;
+    spec.devices = {QStringLiteral("/dev/input/event0"), QStringLiteral("/dev/sda")};
+    spec.files.insert(QStringLiteral("/home/testuser/file"), QByteArray("data"));
+
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("PrepareInstance"),
+        QStringLiteral("testuser"),
+        1000u,
+        spec.toVariantMap()
+    );
+
+    // Step failures are reported in the result, not as a D-Bus error
+    QVERIFY(reply.isValid());
+    const QVariantMap result = reply.value();
+    QVERIFY(!result.value(QStringLiteral("success")).toBool());
+    QVERIFY(!result.value(QStringLiteral("devices.success")).toBool());
+    QVERIFY(result.value(QStringLiteral("error")).toString().contains(QStringLiteral("/dev/sda")));
+
+    // Later steps are skipped and the first device was handed back
+    const QStringList steps = result.value(QStringLiteral("steps")).toStringList();
+    QVERIFY(!steps.contains(QStringLiteral("files")));
+    QVERIFY(steps.contains(QStringLiteral("rollback")));
+
+    QDBusReply<int> resetReply = m_dbusInterface->call(QStringLiteral("ResetAllDevices"));
+    QVERIFY(resetReply.isValid());
+    QCOMPARE(resetReply.value(), 0);
+}
+
+void TestCouchPlayHelper::testPrepareInstanceFileDescriptor()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+
+    if (!(m_dbusInterface->connection().connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing)) {
+        QSKIP("Bus cannot pass file descriptors");
+    }
+
+    QTemporaryFile source;
+    QVERIFY(source.open());
+    source.write("shortcuts via fd");
+    source.flush();
+
+    const QString pipeTarget = QStringLiteral("/home/testuser/pipe");
+    int pipeFds[2];
+    QCOMPARE(pipe(pipeFds), 0);
+
+    const QString target = QStringLiteral("/home/testuser/.steam/steam/userdata/1/config/shortcuts.vdf");
+    PrepareInstanceSpec spec;
+    spec.files.insert(target, QVariant::fromValue(QDBusUnixFileDescriptor(source.handle())));
+    spec.files.insert(pipeTarget, QVariant::fromValue(QDBusUnixFileDescriptor(pipeFds[0])));
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("PrepareInstance"),
+        QStringLiteral("testuser"),
+        1000u,
+        spec.toVariantMap()
+    );
+
+    // The regular file is read from offset 0; a pipe is refused instead of blocking the helper
+    QVERIFY(reply.isValid());
+    const QVariantMap result = reply.value();
+    QCOMPARE(m_ops->writtenFile(target), QByteArray("shortcuts via fd"));
+    QVERIFY(m_ops->writtenFile(pipeTarget).isEmpty());
+    QVERIFY(!result.value(QStringLiteral("files.success")).toBool());
+    QCOMPARE(result.value(QStringLiteral("files.count")).toInt(), 1);
+}
+
+void TestCouchPlayHelper::testMountSharedDirectoriesOverlay()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setFileExists(QStringLiteral("/home/compositor/Games"), true);
+    m_ops->setDirectoryExists(QStringLiteral("/home/compositor/Games"), true);
+
+    QDBusReply<int> reply = m_dbusInterface->call(
+        QStringLiteral("MountSharedDirectories"),
+        QStringLiteral("testuser"),
+        1000u,
+        QStringList({QStringLiteral("/home/compositor/Games||overlay")})
+    );
+
+    // The compositor's files show up as the player's, writes land in the player's upper layer
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value(), 1);
+    const QStringList calls = m_ops->mountCalls();
+    QCOMPARE(calls.size(), 2);
+    QVERIFY(calls.at(0).startsWith(QStringLiteral("idmap /home/compositor/Games /run/couchplay/layers/testuser/")));
+    QVERIFY(calls.at(0).endsWith(QStringLiteral(" 1000:1002")));
+    // Upper layers live where only root can reach them, keyed by a digest of the source
+    const QString key = QString::fromLatin1(
+        QCryptographicHash::hash("/home/compositor/Games", QCryptographicHash::Sha256).toHex());
+    QVERIFY(calls.at(1).contains(QStringLiteral(" /var/lib/couchplay/overlays/testuser/%1/upper ").arg(key)));
+    QVERIFY(calls.at(1).endsWith(QStringLiteral("/work /home/testuser/Games")));
+    QVERIFY(m_ops->getLastProcessCommand().isEmpty());
+
+    // Unmounting takes the overlay and then its lower layer down
+    reply = m_dbusInterface->call(QStringLiteral("UnmountSharedDirectories"), QStringLiteral("testuser"));
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value(), 1);
+    const QStringList unmounts = m_ops->mountCalls().mid(2);
+    QCOMPARE(unmounts.size(), 2);
+    QCOMPARE(unmounts.at(0), QStringLiteral("umount /home/testuser/Games"));
+    QVERIFY(unmounts.at(1).startsWith(QStringLiteral("umount /run/couchplay/layers/testuser/")));
+    QVERIFY(m_ops->getLastProcessCommand().isEmpty());
+}
+
+void TestCouchPlayHelper::testMountSharedDirectoriesOverlayFallback()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setFileExists(QStringLiteral("/home/compositor/Games"), true);
+    m_ops->setDirectoryExists(QStringLiteral("/home/compositor/Games"), true);
+    m_ops->setOverlayResult(false);
+
+    QDBusReply<int> reply = m_dbusInterface->call(
+        QStringLiteral("MountSharedDirectories"),
+        QStringLiteral("testuser"),
+        1000u,
+        QStringList({QStringLiteral("/home/compositor/Games||overlay")})
+    );
+
+    // Without idmapped mounts the player still gets the plain bind mount
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value(), 1);
+    QCOMPARE(m_ops->mountCalls().last(), QStringLiteral("bind /home/compositor/Games /home/testuser/Games"));
+
+    m_dbusInterface->call(QStringLiteral("UnmountSharedDirectories"), QStringLiteral("testuser"));
+}
+
+void TestCouchPlayHelper::testMountSharedDirectoriesBatch()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("player1"), true, 1002, 1002, QStringLiteral("/home/player1"));
+    m_ops->setUserExists(QStringLiteral("player2"), true, 1003, 1003, QStringLiteral("/home/player2"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    QStringList directories;
+    for (const QString &name : {QStringLiteral("Games"), QStringLiteral("Mods"), QStringLiteral("Saves")}) {
+        m_ops->setFileExists(QStringLiteral("/home/compositor/") + name, true);
+        m_ops->setDirectoryExists(QStringLiteral("/home/compositor/") + name, true);
+        directories.append(QStringLiteral("/home/compositor/") + name);
+    }
+
+    for (const QString &player : {QStringLiteral("player1"), QStringLiteral("player2")}) {
+        QDBusReply<int> reply = m_dbusInterface->call(QStringLiteral("MountSharedDirectories"), player, 1000u,
+                                                      directories);
+        QVERIFY(reply.isValid());
+        QCOMPARE(reply.value(), 3);
+    }
+    // No mount(8) per directory
+    QCOMPARE(m_ops->mountCalls().size(), 6);
+    QCOMPARE(m_ops->mountCalls().at(1), QStringLiteral("bind /home/compositor/Mods /home/player1/Mods"));
+    QVERIFY(m_ops->getLastProcessCommand().isEmpty());
+
+    // A failed bind isn't tracked, so teardown doesn't detach it
+    m_ops->setBindResult(false);
+    QDBusReply<int> failed = m_dbusInterface->call(QStringLiteral("MountSharedDirectories"),
+                                                   QStringLiteral("player1"), 1000u,
+                                                   QStringList({QStringLiteral("/home/compositor/Games|Other")}));
+    QCOMPARE(failed.value(), 0);
+
+    // One detach per mount, newest first
+    QDBusReply<int> reply = m_dbusInterface->call(QStringLiteral("UnmountAllSharedDirectories"));
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value(), 6);
+    const QStringList unmounts = m_ops->mountCalls().mid(7);
+    QCOMPARE(unmounts.size(), 6);
+    QCOMPARE(unmounts.at(0), QStringLiteral("umount /home/player1/Saves"));
+    QCOMPARE(unmounts.at(2), QStringLiteral("umount /home/player1/Games"));
+    QVERIFY(m_ops->getLastProcessCommand().isEmpty());
+}
+
+void TestCouchPlayHelper::testPrepareInstanceSharedCaches()
+{
+    // Sources are resolved on disk, so the compositor's home is a real directory
+    QTemporaryDir compositorHome;
+    QVERIFY(compositorHome.isValid());
+    const QString home = QFileInfo(compositorHome.path()).canonicalFilePath();
+    const QString shaderCache = home + QStringLiteral("/.local/share/Steam/steamapps/shadercache/730");
+    const QString prefix = home + QStringLiteral("/.local/share/Steam/steamapps/compatdata/730");
+    QVERIFY(QDir().mkpath(shaderCache));
+    QVERIFY(QDir().mkpath(prefix));
+    QTemporaryDir elsewhere;
+    QVERIFY(elsewhere.isValid());
+
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    // The caller is the compositor
+    m_ops->setUserExists(QStringLiteral("compositor"), true, getuid(), getgid(), home);
+    // The player already has a prefix of their own
+    m_ops->setFileExists(QStringLiteral("/home/testuser/.local/share/Steam/steamapps/compatdata/730"), true);
+
+    PrepareInstanceSpec spec;
+    spec.sharedCaches = {shaderCache, prefix, elsewhere.path()};
+
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("PrepareInstance"),
+        QStringLiteral("testuser"),
+        static_cast<uint>(getuid()),
+        spec.toVariantMap()
+    );
+
+    // Only the missing cache is seeded; a source outside the compositor's home is refused
+    QVERIFY(reply.isValid());
+    const QVariantMap result = reply.value();
+    QVERIFY(result.value(QStringLiteral("success")).toBool());
+    QCOMPARE(m_ops->seededDirectories().size(), 1);
+    QCOMPARE(m_ops->seededDirectories().first().first, shaderCache);
+    QCOMPARE(m_ops->seededDirectories().first().second,
+             QStringLiteral("/home/testuser/.local/share/Steam/steamapps/shadercache/730"));
+    QCOMPARE(m_ops->seedRoot(), home);
+    QCOMPARE(result.value(QStringLiteral("caches.count")).toInt(), 2);
+    QCOMPARE(result.value(QStringLiteral("caches.bytes")).toLongLong(), 4096);
+    QVERIFY(!result.value(QStringLiteral("caches.success")).toBool());
+    QVERIFY(result.value(QStringLiteral("caches.error")).toString().contains(elsewhere.path()));
+}
+
+void TestCouchPlayHelper::testPrepareInstanceSharedCachesOtherHome()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, getuid() + 1, getgid(), QStringLiteral("/home/compositor"));
+
+    PrepareInstanceSpec spec;
+    spec.sharedCaches = {QStringLiteral("/home/compositor/.local/share/Steam/steamapps/shadercache/730")};
+
+    // Someone else's home is never read from
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("PrepareInstance"),
+        QStringLiteral("testuser"),
+        static_cast<uint>(getuid() + 1),
+        spec.toVariantMap()
+    );
+
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::AccessDenied);
+    QVERIFY(m_ops->seededDirectories().isEmpty());
+}
+
+void TestCouchPlayHelper::testPrepareInstanceSessionStep()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setProcessExitCode(0);
+
+    PrepareInstanceSpec spec;
+    spec.session = true;
+
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("PrepareInstance"),
+        QStringLiteral("testuser"),
+        1000u,
+        spec.toVariantMap()
+    );
+
+    // Linger is enabled; without /run/user/1000 the socket ACLs fail, which
+    // is reported but doesn't fail the preparation
+    QVERIFY(reply.isValid());
+    const QVariantMap result = reply.value();
+    QVERIFY(result.value(QStringLiteral("success")).toBool());
+    QCOMPARE(result.value(QStringLiteral("steps")).toStringList(), QStringList({QStringLiteral("session")}));
+    QVERIFY(!result.value(QStringLiteral("session.success")).toBool());
+    QVERIFY(result.value(QStringLiteral("session.error")).toString().contains(QStringLiteral("/run/user/1000")));
+    QCOMPARE(m_ops->getLastProcessCommand(), QStringLiteral("loginctl"));
+    QVERIFY(m_ops->getLastProcessArgs().contains(QStringLiteral("testuser")));
+}
+
+void TestCouchPlayHelper::testPrepareInstanceAuthorizationDenied()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setAuthResult(false);
+
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("PrepareInstance"),
+        QStringLiteral("testuser"),
+        1000u,
+        PrepareInstanceSpec().toVariantMap()
+    );
+
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::AccessDenied);
+}
+
+void TestCouchPlayHelper::testPrepareInstanceInvalidUsername()
+{
+    m_ops->clear();
+
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("PrepareInstance"),
+        QStringLiteral("Invalid User"),
+        1000u,
+        PrepareInstanceSpec().toVariantMap()
+    );
+
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::InvalidArgs);
+}
+
+// ============ Instance Launch Tests ============
+
+void TestCouchPlayHelper::testLaunchInstanceTransientUnit()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setUnitPid(4242);
+
+    QDBusReply<qint64> reply = m_dbusInterface->call(
+        QStringLiteral("LaunchInstance"),
+        QStringLiteral("testuser"),
+        1000u,
+        QStringList({QStringLiteral("-W"), QStringLiteral("960")}),
+        QStringLiteral("steam -tenfoot \"$HOME\""),
+        QStringList({QStringLiteral("SDL_VIDEODRIVER=wayland x11")})
+    );
+
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value(), qint64(4242));
+    QCOMPARE(m_ops->units().size(), 1);
+
+    // gamescope is exec'd directly; only the game command sees a shell, unescaped
+    const TransientUnitSpec unit = m_ops->units().first();
+    QCOMPARE(unit.user, QStringLiteral("testuser"));
+    QCOMPARE(unit.uid, uid_t(1002));
+    QVERIFY(unit.name.startsWith(QStringLiteral("couchplay-testuser-")));
+    QVERIFY(unit.name.endsWith(QStringLiteral(".service")));
+    QCOMPARE(unit.syslogIdentifier, QStringLiteral("couchplay-testuser"));
+    QCOMPARE(unit.argv, QStringList({QStringLiteral("/usr/bin/gamescope"), QStringLiteral("-W"), QStringLiteral("960"),
+                                     QStringLiteral("--"), QStringLiteral("/bin/bash"), QStringLiteral("-c"),
+                                     QStringLiteral("steam -tenfoot \"$HOME\"")}));
+    QVERIFY(unit.environment.contains(QStringLiteral("WAYLAND_DISPLAY=/run/user/1000/wayland-0")));
+    QVERIFY(unit.environment.contains(QStringLiteral("XDG_RUNTIME_DIR=/run/user/1002")));
+    QVERIFY(unit.environment.contains(QStringLiteral("SDL_VIDEODRIVER=wayland x11")));
+    QVERIFY(m_ops->getLastProcessCommand().isEmpty());
+}
+
+void TestCouchPlayHelper::testStopInstanceSignalsUnit()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setUnitPid(4343);
+
+    QDBusReply<qint64> launch = m_dbusInterface->call(
+        QStringLiteral("LaunchInstance"), QStringLiteral("testuser"), 1000u,
+        QStringList(), QStringLiteral("steam"), QStringList());
+    QVERIFY(launch.isValid());
+    const QString unitName = m_ops->units().first().name;
+
+    QDBusReply<bool> stop = m_dbusInterface->call(QStringLiteral("StopInstance"), qint64(4343));
+    QVERIFY(stop.isValid());
+    QVERIFY(stop.value());
+
+    QDBusReply<bool> kill = m_dbusInterface->call(QStringLiteral("KillInstance"), qint64(4343));
+    QVERIFY(kill.isValid());
+    QVERIFY(kill.value());
+
+    const QList<QPair<QString, int>> signalsSent = m_ops->unitSignals();
+    QCOMPARE(signalsSent.size(), 2);
+    QCOMPARE(signalsSent[0], qMakePair(unitName, int(SIGTERM)));
+    QCOMPARE(signalsSent[1], qMakePair(unitName, int(SIGKILL)));
+}
+
+void TestCouchPlayHelper::testStopInstanceUnitGone()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setUnitPid(4444);
+
+    QDBusReply<qint64> launch = m_dbusInterface->call(
+        QStringLiteral("LaunchInstance"), QStringLiteral("testuser"), 1000u,
+        QStringList(), QStringLiteral("steam"), QStringList());
+    QVERIFY(launch.isValid());
+
+    // The unit has already exited: report it rather than signalling the bare PID
+    m_ops->setKillUnitResult(false);
+    QDBusReply<bool> stop = m_dbusInterface->call(QStringLiteral("StopInstance"), qint64(4444));
+    QVERIFY(!stop.isValid());
+    QCOMPARE(stop.error().type(), QDBusError::Failed);
+}
+
+void TestCouchPlayHelper::testInstanceExited()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setUnitPid(4949);
+
+    QSignalSpy exited(m_helper, &CouchPlayHelper::InstanceExited);
+    QDBusReply<qint64> launch = m_dbusInterface->call(
+        QStringLiteral("LaunchInstance"), QStringLiteral("testuser"), 1000u,
+        QStringList(), QStringLiteral("steam"), QStringList());
+    QVERIFY(launch.isValid());
+    QCOMPARE(exited.count(), 0);
+
+    m_ops->exitProcess(4949, 3);
+    QVERIFY(exited.wait(1000));
+    QCOMPARE(exited.count(), 1);
+    QCOMPARE(exited.first().at(0).toLongLong(), qint64(4949));
+    QCOMPARE(exited.first().at(1).toInt(), 3);
+    QVERIFY(exited.first().at(2).toLongLong() >= 0);
+
+    // The unit is forgotten with its process
+    QDBusReply<bool> resources = m_dbusInterface->call(
+        QStringLiteral("SetInstanceResources"), qint64(4949),
+        QVariantMap({{QStringLiteral("cpuWeight"), 200}}));
+    QVERIFY(!resources.isValid());
+    QCOMPARE(resources.error().type(), QDBusError::NotSupported);
+}
+
+void TestCouchPlayHelper::testInstanceLogFields()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setUnitPid(5050);
+
+    QDBusReply<qint64> launch = m_dbusInterface->call(
+        QStringLiteral("LaunchInstance"), QStringLiteral("testuser"), 1000u,
+        QStringList(), QStringLiteral("steam"),
+        QStringList({QStringLiteral("COUCHPLAY_INSTANCE=1"), QStringLiteral("SDL_VIDEODRIVER=wayland")}));
+    QVERIFY(launch.isValid());
+
+    const TransientUnitSpec unit = m_ops->units().first();
+    QCOMPARE(unit.syslogIdentifier, QStringLiteral("couchplay-testuser"));
+    QCOMPARE(unit.logFields, QStringList({QStringLiteral("COUCHPLAY_USER=testuser"),
+                                          QStringLiteral("COUCHPLAY_INSTANCE=1")}));
+}
+
+void TestCouchPlayHelper::testReadInstanceLog()
+{
+    m_ops->clear();
+    m_ops->setJournalEntries({{QStringLiteral("gamescope: starting"), 1700000000000000, 6},
+                              {QStringLiteral("vulkan: no device"), 1700000000500000, 3}});
+
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("ReadInstanceLog"), QStringLiteral("testuser"), QString(), 5000);
+    QVERIFY(reply.isValid());
+
+    // Clamped to the helper's limit
+    QCOMPARE(m_ops->journalReads().size(), 1);
+    QCOMPARE(m_ops->journalReads().first().identifier, QStringLiteral("couchplay-testuser"));
+    QCOMPARE(m_ops->journalReads().first().maxEntries, 1000);
+
+    const QVariantList entries = qdbus_cast<QVariantList>(reply.value().value(QStringLiteral("entries")));
+    QCOMPARE(entries.size(), 2);
+    const QVariantMap last = qdbus_cast<QVariantMap>(entries.last());
+    QCOMPARE(last.value(QStringLiteral("message")).toString(), QStringLiteral("vulkan: no device"));
+    QCOMPARE(last.value(QStringLiteral("timestamp")).toLongLong(), qint64(1700000000500));
+    QCOMPARE(last.value(QStringLiteral("priority")).toInt(), 3);
+    const QString cursor = reply.value().value(QStringLiteral("cursor")).toString();
+    QCOMPARE(cursor, QStringLiteral("cursor-2"));
+
+    // Tailing continues from the cursor
+    reply = m_dbusInterface->call(QStringLiteral("ReadInstanceLog"), QStringLiteral("testuser"), cursor, 100);
+    QVERIFY(reply.isValid());
+    QCOMPARE(m_ops->journalReads().last().afterCursor, cursor);
+    QCOMPARE(m_ops->journalReads().last().maxEntries, 100);
+
+    QDBusReply<QVariantMap> invalid = m_dbusInterface->call(
+        QStringLiteral("ReadInstanceLog"), QStringLiteral("Bad User"), QString(), 10);
+    QVERIFY(!invalid.isValid());
+    QCOMPARE(invalid.error().type(), QDBusError::InvalidArgs);
+}
+
+void TestCouchPlayHelper::testSetInstanceResources()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setUnitPid(4545);
+
+    QDBusReply<qint64> launch = m_dbusInterface->call(
+        QStringLiteral("LaunchInstance"), QStringLiteral("testuser"), 1000u,
+        QStringList(), QStringLiteral("steam"), QStringList());
+    QVERIFY(launch.isValid());
+    const QString unitName = m_ops->units().first().name;
+
+    QVariantMap resources;
+    resources[QStringLiteral("cpuWeight")] = 200;
+    resources[QStringLiteral("ioWeight")] = 0;
+    resources[QStringLiteral("memoryHighMb")] = 4096;
+    resources[QStringLiteral("cpuCores")] = QStringLiteral("0-3,9");
+
+    QDBusReply<bool> reply = m_dbusInterface->call(QStringLiteral("SetInstanceResources"), qint64(4545), resources);
+    QVERIFY(reply.isValid());
+    QVERIFY(reply.value());
+
+    QCOMPARE(m_ops->unitProperties().size(), 1);
+    QCOMPARE(m_ops->unitProperties().first().first, unitName);
+    const QVariantMap properties = m_ops->unitProperties().first().second;
+    QCOMPARE(properties.value(QStringLiteral("CPUWeight")).toULongLong(), 200ULL);
+    QVERIFY(!properties.contains(QStringLiteral("IOWeight")));
+    QCOMPARE(properties.value(QStringLiteral("MemoryHigh")).toULongLong(), 4096ULL * 1024 * 1024);
+    QCOMPARE(properties.value(QStringLiteral("AllowedCPUs")).toByteArray(), QByteArray("\x0f\x02", 2));
+
+    // Only unit-launched instances carry their own cgroup
+    QDBusReply<bool> unknown = m_dbusInterface->call(QStringLiteral("SetInstanceResources"), qint64(1), resources);
+    QVERIFY(!unknown.isValid());
+    QCOMPARE(unknown.error().type(), QDBusError::NotSupported);
+}
+
+void TestCouchPlayHelper::testSetInstanceResourcesInvalid()
+{
+    m_ops->clear();
+
+    QVariantMap weight;
+    weight[QStringLiteral("cpuWeight")] = 20000;
+    QDBusReply<bool> reply = m_dbusInterface->call(QStringLiteral("SetInstanceResources"), qint64(4646), weight);
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::InvalidArgs);
+
+    QVariantMap cores;
+    cores[QStringLiteral("cpuCores")] = QStringLiteral("4-2");
+    reply = m_dbusInterface->call(QStringLiteral("SetInstanceResources"), qint64(4646), cores);
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::InvalidArgs);
+    QVERIFY(m_ops->unitProperties().isEmpty());
+}
+
+void TestCouchPlayHelper::testGetInstanceGpuUsage()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+
+    // Arbitrary processes are off limits
+    QDBusReply<QVariantMap> unknown = m_dbusInterface->call(QStringLiteral("GetInstanceGpuUsage"), qint64(4848));
+    QVERIFY(!unknown.isValid());
+    QCOMPARE(unknown.error().type(), QDBusError::InvalidArgs);
+
+    m_ops->setUnitPid(4848);
+    QDBusReply<qint64> launch = m_dbusInterface->call(
+        QStringLiteral("LaunchInstance"), QStringLiteral("testuser"), 1000u,
+        QStringList(), QStringLiteral("steam"), QStringList());
+    QVERIFY(launch.isValid());
+
+    // The mock PID has no process behind it, so no DRM clients
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(QStringLiteral("GetInstanceGpuUsage"), qint64(4848));
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value().value(QStringLiteral("clients")).toInt(), 0);
+    QCOMPARE(reply.value().value(QStringLiteral("memoryBytes")).toLongLong(), qint64(-1));
+}
+
+void TestCouchPlayHelper::testPrepareInstanceLaunchResources()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setUnitPid(4747);
+
+    PrepareInstanceSpec spec;
+    spec.launch = true;
+    spec.gameCommand = QStringLiteral("steam");
+    spec.resources[QStringLiteral("cpuWeight")] = 50;
+    spec.resources[QStringLiteral("ioWeight")] = 300;
+
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("PrepareInstance"), QStringLiteral("testuser"), 1000u, spec.toVariantMap());
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value().value(QStringLiteral("pid")).toLongLong(), qint64(4747));
+
+    // Limits are part of the unit from the start, no separate call
+    QCOMPARE(m_ops->units().size(), 1);
+    const QVariantMap properties = m_ops->units().first().properties;
+    QCOMPARE(properties.value(QStringLiteral("CPUWeight")).toULongLong(), 50ULL);
+    QCOMPARE(properties.value(QStringLiteral("IOWeight")).toULongLong(), 300ULL);
+    QVERIFY(m_ops->unitProperties().isEmpty());
+}
+
+// ============ ACL Tests ============
+
+void TestCouchPlayHelper::testSetDirectoryAclRecursive()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setFileExists(QStringLiteral("/mnt/games/SteamLibrary"), true);
+
+    QDBusReply<bool> reply = m_dbusInterface->call(
+        QStringLiteral("SetDirectoryAcl"),
+        QStringLiteral("/mnt/games/SteamLibrary"),
+        QStringLiteral("testuser"),
+        true
+    );
+
+    QVERIFY(reply.isValid());
+    QVERIFY(reply.value());
+
+    // Applied in-process, no setfacl spawned
+    QVERIFY(m_ops->getLastProcessCommand() != QStringLiteral("setfacl"));
+    const auto calls = m_ops->aclCalls();
+    QCOMPARE(calls.size(), 1);
+    QCOMPARE(calls[0].path, QStringLiteral("/mnt/games/SteamLibrary"));
+    QCOMPARE(calls[0].uid, static_cast<uid_t>(1002));
+    QVERIFY(calls[0].recursive);
+}
+
+void TestCouchPlayHelper::testSetDirectoryAclFailure()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setFileExists(QStringLiteral("/mnt/ntfs"), true);
+    m_ops->setAclResult(false, QStringLiteral("/mnt/ntfs: Operation not supported"));
+
+    QDBusReply<bool> reply = m_dbusInterface->call(
+        QStringLiteral("SetDirectoryAcl"),
+        QStringLiteral("/mnt/ntfs"),
+        QStringLiteral("testuser"),
+        true
+    );
+
+    QVERIFY(!reply.isValid());
+    QCOMPARE(reply.error().type(), QDBusError::Failed);
+    QVERIFY(reply.error().message().contains(QStringLiteral("Operation not supported")));
+}
+
+void TestCouchPlayHelper::testSetPathAclWithParentsWalksUp()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setFileExists(QStringLiteral("/mnt/games"), true);
+    m_ops->setFileExists(QStringLiteral("/mnt/games/Heroic"), true);
+    m_ops->setFileExists(QStringLiteral("/mnt/games/Heroic/Game"), true);
+
+    QDBusReply<bool> reply = m_dbusInterface->call(
+        QStringLiteral("SetPathAclWithParents"),
+        QStringLiteral("/mnt/games/Heroic/Game/"),
+        QStringLiteral("testuser")
+    );
+
+    QVERIFY(reply.isValid());
+    QVERIFY(reply.value());
+
+    // Top-down below the /mnt boundary, never recursive
+    const auto calls = m_ops->aclCalls();
+    QCOMPARE(calls.size(), 3);
+    QCOMPARE(calls[0].path, QStringLiteral("/mnt/games"));
+    QCOMPARE(calls[1].path, QStringLiteral("/mnt/games/Heroic"));
+    QCOMPARE(calls[2].path, QStringLiteral("/mnt/games/Heroic/Game"));
+    for (const auto &call : calls) {
+        QVERIFY(!call.recursive);
+        QCOMPARE(call.uid, static_cast<uid_t>(1002));
+    }
+}
+
+void TestCouchPlayHelper::testSetPathAclWithParentsReportsFailure()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setFileExists(QStringLiteral("/mnt/games"), true);
+    m_ops->setFileExists(QStringLiteral("/mnt/games/Game"), true);
+    m_ops->setAclResult(false, QStringLiteral("Operation not supported"));
+
+    QDBusReply<bool> reply = m_dbusInterface->call(
+        QStringLiteral("SetPathAclWithParents"),
+        QStringLiteral("/mnt/games/Game"),
+        QStringLiteral("testuser")
+    );
+
+    QVERIFY(reply.isValid());
+    QVERIFY(!reply.value());
+
+    // Every path is still tried
+    QCOMPARE(m_ops->aclCalls().size(), 2);
+}
+
+void TestCouchPlayHelper::testGrantUserAclSkipsExistingEntries()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    QVERIFY(QDir(root.path()).mkpath(QStringLiteral("game/data")));
+    QFile file(root.path() + QStringLiteral("/game/data/pak0.bin"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("x");
+    file.close();
+    QVERIFY(QFile::link(root.path() + QStringLiteral("/game"), root.path() + QStringLiteral("/loop")));
+
+    // Any UID works as an ACL qualifier; the owner may always set ACLs
+    const uid_t otherUid = getuid() + 4242;
+    RealSystemOps ops;
+
+    AclResult first = ops.grantUserAcl(root.path(), otherUid, true, {});
+    if (!first.success && first.error.contains(QStringLiteral("not supported"))) {
+        QSKIP("Temporary directory filesystem does not support POSIX ACLs");
+    }
+    QVERIFY2(first.success, qPrintable(first.error));
+    QCOMPARE(first.failed, 0);
+    // root, game, game/data, pak0.bin - the symlink is not followed
+    QCOMPARE(first.updated, 4);
+    QCOMPARE(first.unchanged, 0);
+
+    AclResult second = ops.grantUserAcl(root.path(), otherUid, true, {});
+    QVERIFY(second.success);
+    QCOMPARE(second.updated, 0);
+    QCOMPARE(second.unchanged, 4);
+}
+
+void TestCouchPlayHelper::testSetDirectoryAclReusesFingerprints()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setFileExists(QStringLiteral("/mnt/games/Library"), true);
+
+    const DirectoryFingerprints fingerprints = {
+        {QString(), 11},
+        {QStringLiteral("steamapps"), 22},
+    };
+    m_ops->setAclResult(true, QString(), fingerprints);
+
+    for (int i = 0; i < 2; ++i) {
+        QDBusReply<bool> reply = m_dbusInterface->call(
+            QStringLiteral("SetDirectoryAcl"),
+            QStringLiteral("/mnt/games/Library"),
+            QStringLiteral("testuser"),
+            true
+        );
+        QVERIFY(reply.isValid());
+        QVERIFY(reply.value());
+    }
+
+    // First pass starts cold, the second one gets the recorded fingerprints
+    const auto calls = m_ops->aclCalls();
+    QCOMPARE(calls.size(), 2);
+    QVERIFY(calls[0].known.isEmpty());
+    QCOMPARE(calls[1].known, fingerprints);
+
+    // A failed pass drops the record
+    m_ops->setAclResult(false, QStringLiteral("boom"));
+    m_dbusInterface->call(QStringLiteral("SetDirectoryAcl"), QStringLiteral("/mnt/games/Library"),
+                          QStringLiteral("testuser"), true);
+    m_ops->setAclResult(true);
+    m_dbusInterface->call(QStringLiteral("SetDirectoryAcl"), QStringLiteral("/mnt/games/Library"),
+                          QStringLiteral("testuser"), true);
+    QVERIFY(m_ops->aclCalls().last().known.isEmpty());
+}
+
+void TestCouchPlayHelper::testGrantUserAclSkipsUnchangedDirectories()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    QVERIFY(QDir(root.path()).mkpath(QStringLiteral("common/GameA")));
+    QFile fileA(root.path() + QStringLiteral("/common/GameA/game.bin"));
+    QVERIFY(fileA.open(QIODevice::WriteOnly));
+    fileA.close();
+
+    const uid_t otherUid = getuid() + 4242;
+    RealSystemOps ops;
+
+    AclResult first = ops.grantUserAcl(root.path(), otherUid, true, {});
+    if (!first.success && first.error.contains(QStringLiteral("not supported"))) {
+        QSKIP("Temporary directory filesystem does not support POSIX ACLs");
+    }
+    QVERIFY(first.success);
+    QCOMPARE(first.directories.size(), 3);  // "", common, common/GameA
+
+    // Nothing changed: every directory is skipped and nothing is checked
+    AclResult second = ops.grantUserAcl(root.path(), otherUid, true, first.directories);
+    QVERIFY(second.success);
+    QCOMPARE(second.skipped, 3);
+    QCOMPARE(second.updated, 0);
+    QCOMPARE(second.unchanged, 1);  // Only the root itself
+
+    // A newly installed game only touches the new subtree
+    QVERIFY(QDir(root.path()).mkpath(QStringLiteral("common/GameB")));
+    QFile fileB(root.path() + QStringLiteral("/common/GameB/game.bin"));
+    QVERIFY(fileB.open(QIODevice::WriteOnly));
+    fileB.close();
+
+    AclResult third = ops.grantUserAcl(root.path(), otherUid, true, second.directories);
+    QVERIFY(third.success);
+    QCOMPARE(third.updated, 2);  // GameB and its file
+    QCOMPARE(third.skipped, 2);  // root and GameA
+}
+
+void TestCouchPlayHelper::testAclStateCacheRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    AclStateCache cache(dir.path() + QStringLiteral("/acl"));
+
+    const DirectoryFingerprints fingerprints = {{QString(), 1}, {QStringLiteral("a/b"), 2}};
+    QVERIFY(cache.load(QStringLiteral("/mnt/lib"), 1002).isEmpty());
+    QVERIFY(cache.store(QStringLiteral("/mnt/lib/"), 1002, fingerprints));
+
+    // Path is normalized, records are per uid
+    QCOMPARE(cache.load(QStringLiteral("/mnt/lib"), 1002), fingerprints);
+    QVERIFY(cache.load(QStringLiteral("/mnt/lib"), 1003).isEmpty());
+
+    cache.remove(QStringLiteral("/mnt/lib"), 1002);
+    QVERIFY(cache.load(QStringLiteral("/mnt/lib"), 1002).isEmpty());
+}
+
+// ============ Version Test ============
+
+// ============ File Transfer Tests ============
+
+void TestCouchPlayHelper::testCopyFileDescriptorToUser()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+
+    if (!(m_dbusInterface->connection().connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing)) {
+        QSKIP("Bus cannot pass file descriptors");
+    }
+
+    QTemporaryFile source;
+    QVERIFY(source.open());
+    source.write("controller config");
+    source.flush();
+
+    const QString target = QStringLiteral("/home/testuser/.config/controller.cfg");
+    QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+        QStringLiteral("CopyFileDescriptorToUser"),
+        QVariant::fromValue(QDBusUnixFileDescriptor(source.handle())),
+        target,
+        QStringLiteral("testuser")
+    );
+
+    QVERIFY(reply.isValid());
+    const QVariantMap result = reply.value();
+    QVERIFY(result.value(QStringLiteral("success")).toBool());
+    QCOMPARE(result.value(QStringLiteral("bytes")).toLongLong(), qint64(17));
+    QCOMPARE(result.value(QStringLiteral("method")).toString(), QStringLiteral("copy"));
+    QVERIFY(result.contains(QStringLiteral("elapsedMs")));
+    QCOMPARE(m_ops->writtenFile(target), QByteArray("controller config"));
+}
+
+void TestCouchPlayHelper::testCopyFileDescriptorToUserOutsideHome()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+
+    if (!(m_dbusInterface->connection().connectionCapabilities() & QDBusConnection::UnixFileDescriptorPassing)) {
+        QSKIP("Bus cannot pass file descriptors");
+    }
+
+    QTemporaryFile source;
+    QVERIFY(source.open());
+
+    for (const QString &target : {QStringLiteral("/etc/passwd"), QStringLiteral("/home/testuser/../other/file"),
+                                  QStringLiteral("/home/testuserx/file")}) {
+        QDBusReply<QVariantMap> reply = m_dbusInterface->call(
+            QStringLiteral("CopyFileDescriptorToUser"),
+            QVariant::fromValue(QDBusUnixFileDescriptor(source.handle())),
+            target,
+            QStringLiteral("testuser")
+        );
+        QVERIFY(reply.isValid());
+        QVERIFY2(!reply.value().value(QStringLiteral("success")).toBool(), qPrintable(target));
+        QVERIFY(m_ops->writtenFile(target).isEmpty());
+    }
+}
+
+void TestCouchPlayHelper::testTransferFileReplacesAtomically()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+
+    const QString target = root.path() + QStringLiteral("/shortcuts.vdf");
+    QFile old(target);
+    QVERIFY(old.open(QIODevice::WriteOnly));
+    old.write("old content");
+    old.close();
+
+    QTemporaryFile source;
+    QVERIFY(source.open());
+    const QByteArray content(256 * 1024, 'x');
+    source.write(content);
+    source.flush();
+
+    RealSystemOps ops;
+    const FileTransfer transfer = ops.transferFile(source.handle(), root.path(), target, getuid(), getgid(), 0640);
+    QVERIFY2(transfer.success, qPrintable(transfer.error));
+    QCOMPARE(transfer.bytes, qint64(content.size()));
+    QVERIFY(!transfer.method.isEmpty());
+
+    QFile result(target);
+    QVERIFY(result.open(QIODevice::ReadOnly));
+    QCOMPARE(result.readAll(), content);
+    QVERIFY(QFileInfo(target).permissions() & QFileDevice::ReadGroup);
+    QVERIFY(!(QFileInfo(target).permissions() & QFileDevice::ReadOther));
+
+    // No temporary names are left behind
+    QCOMPARE(QDir(root.path()).entryList(QDir::Files | QDir::Hidden), QStringList({QStringLiteral("shortcuts.vdf")}));
+}
+
+void TestCouchPlayHelper::testTransferFileRefusesSymlinks()
+{
+    QTemporaryDir home;
+    QTemporaryDir elsewhere;
+    QVERIFY(home.isValid());
+    QVERIFY(elsewhere.isValid());
+    // A player could plant this in their own home
+    QVERIFY(QFile::link(elsewhere.path(), home.path() + QStringLiteral("/config")));
+
+    QTemporaryFile source;
+    QVERIFY(source.open());
+    source.write("content");
+    source.flush();
+
+    RealSystemOps ops;
+    for (const QString &target : {QStringLiteral("/config/shortcuts.vdf"), QStringLiteral("/config/sub/shortcuts.vdf")}) {
+        const FileTransfer transfer = ops.transferFile(source.handle(), home.path(), home.path() + target,
+                                                       getuid(), getgid(), 0644);
+        QVERIFY2(!transfer.success, qPrintable(target));
+        QVERIFY(!transfer.error.isEmpty());
+    }
+    QString error;
+    QVERIFY(!ops.makeDirectoryBelow(home.path(), home.path() + QStringLiteral("/config/sub"), getuid(), getgid(),
+                                    error));
+    QVERIFY(QDir(elsewhere.path()).isEmpty(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot));
+
+    // Missing directories are created below the home
+    const QString target = home.path() + QStringLiteral("/.local/share/app/file");
+    const FileTransfer transfer = ops.transferFile(source.handle(), home.path(), target, getuid(), getgid(), 0644);
+    QVERIFY2(transfer.success, qPrintable(transfer.error));
+    QVERIFY(QFileInfo(target).isFile());
+    QVERIFY(!ops.transferFile(source.handle(), home.path(), elsewhere.path() + QStringLiteral("/file"),
+                              getuid(), getgid(), 0644).success);
+}
+
+void TestCouchPlayHelper::testSeedDirectory()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+
+    const QString source = root.path() + QStringLiteral("/source");
+    QVERIFY(QDir().mkpath(source + QStringLiteral("/pfx/drive_c")));
+    QFile file(source + QStringLiteral("/pfx/system.reg"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("WINE REGISTRY Version 2");
+    file.close();
+    QVERIFY(QFile::link(QStringLiteral("pfx/drive_c"), source + QStringLiteral("/c")));
+
+    RealSystemOps ops;
+    const QString target = root.path() + QStringLiteral("/target");
+    const FileTransfer transfer = ops.seedDirectory(source, target, getuid(), getgid());
+    QCOMPARE(transfer.method, QStringLiteral("reflink"));
+    if (!transfer.success) {
+        // tmpfs and ext4 can't share extents; nothing may be left behind then
+        QVERIFY(!QFileInfo::exists(target));
+        QSKIP("Temporary directory does not support reflinks");
+    }
+
+    QCOMPARE(transfer.bytes, qint64(23));
+    QFile copy(target + QStringLiteral("/pfx/system.reg"));
+    QVERIFY(copy.open(QIODevice::ReadOnly));
+    QCOMPARE(copy.readAll(), QByteArray("WINE REGISTRY Version 2"));
+    QCOMPARE(QFileInfo(target + QStringLiteral("/c")).symLinkTarget(),
+             QFileInfo(target + QStringLiteral("/pfx/drive_c")).filePath());
+
+    // An existing target is never merged into
+    QVERIFY(!ops.seedDirectory(source, target, getuid(), getgid()).success);
+}
+
+void TestCouchPlayHelper::testSeedDirectoryBelowRoot()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    QTemporaryDir elsewhere;
+    QVERIFY(elsewhere.isValid());
+    QVERIFY(QDir().mkpath(elsewhere.path() + QStringLiteral("/cache")));
+    QVERIFY(QDir().mkpath(root.path() + QStringLiteral("/home")));
+    QVERIFY(QFile::link(elsewhere.path(), root.path() + QStringLiteral("/home/link")));
+
+    RealSystemOps ops;
+    const QString home = root.path() + QStringLiteral("/home");
+    const QString target = root.path() + QStringLiteral("/target");
+
+    // A symlink below the root leads nowhere, and nothing is created
+    FileTransfer transfer = ops.seedDirectory(home + QStringLiteral("/link/cache"), target, getuid(), getgid(), home);
+    QVERIFY(!transfer.success);
+    QVERIFY(!QFileInfo::exists(target));
+
+    // Nor does a path that only starts out below it
+    transfer = ops.seedDirectory(home + QStringLiteral("/../home/../.."), target, getuid(), getgid(), home);
+    QVERIFY(!transfer.success);
+    QVERIFY(!QFileInfo::exists(target));
+}
+
+void TestCouchPlayHelper::testVersion()
+{
+    m_ops->clear();
+
+    QDBusReply<QString> reply = m_dbusInterface->call(
+        QStringLiteral("Version")
+    );
+
+    QVERIFY(reply.isValid());
+    QVERIFY(!reply.value().isEmpty());
+}
+
+// ============ Tracing Tests ============
+
+void TestCouchPlayHelper::testHelperTrace()
+{
+    HelperTrace trace;
+    const QString client = QStringLiteral(":1.42");
+
+    // Nothing is kept for clients that aren't tracing
+    {
+        HelperTrace::Scope scope(trace, client, "PrepareInstance");
+        trace.record(QStringLiteral("devices"), HelperTrace::nowUs(), 10);
+    }
+    QVERIFY(trace.take(client).isEmpty());
+
+    trace.begin(client);
+    QVERIFY(trace.isTracing(client));
+    trace.setParent(client, QStringLiteral("PrepareInstance"), 7);
+    {
+        HelperTrace::Scope scope(trace, client, "PrepareInstance");
+        trace.record(QStringLiteral("devices"), HelperTrace::nowUs(), 10);
+        // Calls from other connections aren't this client's
+        HelperTrace::Scope other(trace, QStringLiteral(":1.43"), "RouteDevice");
+        trace.record(QStringLiteral("route"), HelperTrace::nowUs(), 10);
+    }
+    {
+        // The parent belonged to the first call only
+        HelperTrace::Scope scope(trace, client, "PrepareInstance");
+    }
+
+    const QVariantList spans = trace.take(client);
+    QVERIFY(!trace.isTracing(client));
+    QCOMPARE(spans.size(), 3);
+    const QVariantMap handler = spans[0].toMap();
+    QCOMPARE(handler[QStringLiteral("name")].toString(), QStringLiteral("PrepareInstance"));
+    QCOMPARE(handler[QStringLiteral("parent")].toULongLong(), quint64(7));
+    QCOMPARE(handler[QStringLiteral("depth")].toInt(), 0);
+    QVERIFY(handler[QStringLiteral("duration")].toLongLong() >= 0);
+    const QVariantMap step = spans[1].toMap();
+    QCOMPARE(step[QStringLiteral("name")].toString(), QStringLiteral("devices"));
+    QCOMPARE(step[QStringLiteral("depth")].toInt(), 1);
+    QCOMPARE(step[QStringLiteral("duration")].toLongLong(), qint64(10));
+    QCOMPARE(spans[2].toMap()[QStringLiteral("parent")].toULongLong(), quint64(0));
+
+    // The oldest trace makes room for new clients
+    for (int i = 0; i <= HelperTrace::MAX_CLIENTS; ++i) {
+        trace.begin(QStringLiteral(":2.%1").arg(i));
+    }
+    QVERIFY(!trace.isTracing(QStringLiteral(":2.0")));
+    QVERIFY(trace.isTracing(QStringLiteral(":2.%1").arg(HelperTrace::MAX_CLIENTS)));
+}
+
+// ============ Benchmarks ============
+// Through the session bus like the tests above, so each call includes one D-Bus round trip
+
+void TestCouchPlayHelper::benchmarkPrepareInstance()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setFileExists(QStringLiteral("/dev/input/event0"), true);
+    m_ops->setFileExists(QStringLiteral("/dev/input/event1"), true);
+
+    PrepareInstanceSpec spec;
+    spec.devices = {QStringLiteral("/dev/input/event0"), QStringLiteral("/dev/input/event1")};
+    spec.files.insert(QStringLiteral("/home/testuser/.steam/steam/userdata/1/config/shortcuts.vdf"),
+                      QByteArray("shortcuts"));
+    const QVariantMap specMap = spec.toVariantMap();
+
+    QDBusReply<QVariantMap> reply;
+    QBENCHMARK {
+        reply = m_dbusInterface->call(QStringLiteral("PrepareInstance"), QStringLiteral("testuser"), 1000u, specMap);
+    }
+    QVERIFY(reply.isValid());
+    QVERIFY(reply.value().value(QStringLiteral("success")).toBool());
+
+    m_dbusInterface->call(QStringLiteral("ResetAllDevices"));
+}
+
+void TestCouchPlayHelper::benchmarkLaunchInstance()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setUnitPid(4343);
+
+    const QStringList gamescopeArgs({QStringLiteral("-W"), QStringLiteral("960"), QStringLiteral("-H"),
+                                     QStringLiteral("1080")});
+    const QStringList environment({QStringLiteral("SDL_VIDEODRIVER=wayland"), QStringLiteral("COUCHPLAY_INSTANCE=1")});
+
+    QDBusReply<qint64> reply;
+    QBENCHMARK {
+        reply = m_dbusInterface->call(QStringLiteral("LaunchInstance"), QStringLiteral("testuser"), 1000u,
+                                      gamescopeArgs, QStringLiteral("steam -tenfoot"), environment);
+    }
+    QVERIFY(reply.isValid());
+    QCOMPARE(reply.value(), qint64(4343));
+}
+
+void TestCouchPlayHelper::testHelperMetrics()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002);
+    m_ops->setProcessExitCode(0);
+
+    auto value = [this](const QString &group, const QString &name, const QString &key) {
+        const QVariantMap metrics = m_helper->GetMetrics();
+        if (name.isEmpty()) {
+            return metrics.value(group).toMap().value(key).toULongLong();
+        }
+        return metrics.value(group).toMap().value(name).toMap().value(key).toULongLong();
+    };
+    const quint64 calls = value(QStringLiteral("methods"), QStringLiteral("EnableLinger"), QStringLiteral("count"));
+    const quint64 failures = value(QStringLiteral("methods"), QStringLiteral("EnableLinger"), QStringLiteral("failures"));
+    const quint64 spawns = value(QStringLiteral("processes"), QStringLiteral("loginctl"), QStringLiteral("count"));
+    const quint64 checks = value(QStringLiteral("authorization"), QString(), QStringLiteral("count"));
+
+    QDBusReply<bool> reply = m_dbusInterface->call(QStringLiteral("EnableLinger"), QStringLiteral("testuser"));
+    QVERIFY(reply.isValid());
+    // Rejected before authorization
+    reply = m_dbusInterface->call(QStringLiteral("EnableLinger"), QStringLiteral("INVALID-USER"));
+    QVERIFY(!reply.isValid());
+
+    QCOMPARE(value(QStringLiteral("methods"), QStringLiteral("EnableLinger"), QStringLiteral("count")), calls + 2);
+    QCOMPARE(value(QStringLiteral("methods"), QStringLiteral("EnableLinger"), QStringLiteral("failures")), failures + 1);
+    QCOMPARE(value(QStringLiteral("processes"), QStringLiteral("loginctl"), QStringLiteral("count")), spawns + 1);
+    QCOMPARE(value(QStringLiteral("processes"), QStringLiteral("loginctl"), QStringLiteral("running")), quint64(0));
+    QCOMPARE(value(QStringLiteral("authorization"), QString(), QStringLiteral("count")), checks + 1);
+    QVERIFY(m_helper->GetMetrics().value(QStringLiteral("gauges")).toMap().contains(QStringLiteral("activeMounts")));
+
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("couchplay-helper.prom"));
+    m_helper->setMetricsFile(path);
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray text = file.readAll();
+    QVERIFY(text.contains("couchplay_helper_call_duration_seconds_bucket{method=\"EnableLinger\",le=\"+Inf\"} "));
+    QVERIFY(text.contains("couchplay_helper_process_failures_total{program=\"loginctl\"} "));
+    QVERIFY(text.contains("\ncouchplay_helper_active_mounts "));
+    m_helper->setMetricsFile(QString());
+}
+
+void TestCouchPlayHelper::testActionGrant()
+{
+    m_ops->clear();
+    auto createUser = [this]() {
+        const QDBusReply<uint> reply = m_dbusInterface->call(QStringLiteral("CreateUser"), QStringLiteral("grantuser"),
+                                                             QStringLiteral("Grant User"));
+        return reply.error().type();
+    };
+    const QString action = QStringLiteral("io.github.hikaps.couchplay.create-user");
+
+    m_ops->setAuthResult(false);
+    QCOMPARE(createUser(), QDBusError::AccessDenied);
+    QDBusReply<bool> granted = m_dbusInterface->call(QStringLiteral("AuthorizeAction"), action);
+    QVERIFY(granted.isValid());
+    QVERIFY(!granted.value());
+    QCOMPARE(m_ops->authInteractive(), QList<bool>({false, true}));
+
+    // One call gets past the check (useradd then fails in the mock), the next asks polkit again
+    m_ops->setAuthResult(true);
+    granted = m_dbusInterface->call(QStringLiteral("AuthorizeAction"), action);
+    QVERIFY(granted.value());
+    m_ops->setAuthResult(false);
+    m_ops->setProcessExitCode(1);
+    QVERIFY(createUser() != QDBusError::AccessDenied);
+    QCOMPARE(createUser(), QDBusError::AccessDenied);
+
+    // Nothing but CouchPlay's own actions
+    granted = m_dbusInterface->call(QStringLiteral("AuthorizeAction"), QStringLiteral("org.freedesktop.login1.reboot"));
+    QCOMPARE(granted.error().type(), QDBusError::InvalidArgs);
+}
+
+void TestCouchPlayHelper::testSessionGrant()
+{
+    const QString device = QStringLiteral("/dev/input/event7");
+    // Authorized calls get past the check to the unknown UID
+    auto changeOwner = [this, &device]() {
+        const QDBusReply<bool> reply = m_dbusInterface->call(QStringLiteral("ChangeDeviceOwner"), device, 4242u);
+        return reply.error().type();
+    };
+
+    m_ops->clear();
+    m_ops->setAuthResult(false);
+    QDBusReply<QVariantMap> session = m_dbusInterface->call(QStringLiteral("AuthorizeSession"));
+    QVERIFY(session.isValid());
+    QVERIFY(!session.value().value(QStringLiteral("authorized")).toBool());
+    QCOMPARE(changeOwner(), QDBusError::AccessDenied);
+
+    // Only AuthorizeSession() may prompt
+    QCOMPARE(m_ops->authInteractive(), QList<bool>({true, false}));
+
+    m_ops->setAuthResult(true);
+    session = m_dbusInterface->call(QStringLiteral("AuthorizeSession"));
+    QVERIFY(session.value().value(QStringLiteral("authorized")).toBool());
+    QVERIFY(session.value().value(QStringLiteral("expiresInMs")).toInt() > 0);
+    QCOMPARE(m_ops->authChecks().last(), QStringLiteral("io.github.hikaps.couchplay.start-session"));
+
+    // Session calls no longer ask polkit, user management still does
+    m_ops->setAuthResult(false);
+    const qsizetype checks = m_ops->authChecks().size();
+    QCOMPARE(changeOwner(), QDBusError::InvalidArgs);
+    session = m_dbusInterface->call(QStringLiteral("AuthorizeSession"));
+    QVERIFY(session.value().value(QStringLiteral("authorized")).toBool());
+    QCOMPARE(m_ops->authChecks().size(), checks);
+    QDBusReply<uint> user = m_dbusInterface->call(QStringLiteral("CreateUser"), QStringLiteral("grantuser"),
+                                                  QStringLiteral("Grant User"));
+    QCOMPARE(user.error().type(), QDBusError::AccessDenied);
+
+    m_dbusInterface->call(QStringLiteral("EndSession"));
+    QCOMPARE(changeOwner(), QDBusError::AccessDenied);
+
+    // Grants lapse without calls
+    m_helper->setSessionGrantTimeout(50);
+    m_ops->setAuthResult(true);
+    m_dbusInterface->call(QStringLiteral("AuthorizeSession"));
+    m_ops->setAuthResult(false);
+    QTest::qSleep(100);
+    QCOMPARE(changeOwner(), QDBusError::AccessDenied);
+    m_helper->setSessionGrantTimeout(30 * 60 * 1000);
+}
+
+void TestCouchPlayHelper::testSessionGrantHeldByResources()
+{
+    m_ops->clear();
+    m_ops->setUserExists(QStringLiteral("testuser"), true, 1002, 1002, QStringLiteral("/home/testuser"));
+    m_ops->setUserExists(QStringLiteral("compositor"), true, 1000, 1000, QStringLiteral("/home/compositor"));
+    m_ops->setFileExists(QStringLiteral("/home/compositor/Games"), true);
+    m_ops->setDirectoryExists(QStringLiteral("/home/compositor/Games"), true);
+    m_ops->setUnitPid(4646);
+
+    m_helper->setSessionGrantTimeout(50);
+    m_dbusInterface->call(QStringLiteral("AuthorizeSession"));
+    QDBusReply<qint64> launch = m_dbusInterface->call(
+        QStringLiteral("LaunchInstance"), QStringLiteral("testuser"), 1000u,
+        QStringList(), QStringLiteral("steam"), QStringList());
+    QCOMPARE(launch.value(), qint64(4646));
+    QDBusReply<int> mounted = m_dbusInterface->call(QStringLiteral("MountSharedDirectories"),
+                                                    QStringLiteral("testuser"), 1000u,
+                                                    QStringList({QStringLiteral("/home/compositor/Games")}));
+    QCOMPARE(mounted.value(), 1);
+
+    // Idle past the timeout, but the session still runs: the grant holds
+    m_ops->setAuthResult(false);
+    QTest::qSleep(100);
+    QDBusReply<bool> resources = m_dbusInterface->call(QStringLiteral("SetInstanceResources"), qint64(4646),
+                                                       QVariantMap());
+    QVERIFY(resources.error().type() != QDBusError::AccessDenied);
+
+    // Without any grant, what the caller set up can still be torn down
+    m_dbusInterface->call(QStringLiteral("EndSession"));
+    QDBusReply<bool> stop = m_dbusInterface->call(QStringLiteral("StopInstance"), qint64(4646));
+    QVERIFY(stop.isValid());
+    QVERIFY(stop.value());
+    QDBusReply<int> unmounted = m_dbusInterface->call(QStringLiteral("UnmountAllSharedDirectories"));
+    QVERIFY(unmounted.isValid());
+    QCOMPARE(unmounted.value(), 1);
+
+    // With nothing left to tear down it asks polkit again
+    unmounted = m_dbusInterface->call(QStringLiteral("UnmountAllSharedDirectories"));
+    QCOMPARE(unmounted.error().type(), QDBusError::AccessDenied);
+    QDBusReply<bool> other = m_dbusInterface->call(QStringLiteral("StopInstance"), qint64(4747));
+    QCOMPARE(other.error().type(), QDBusError::AccessDenied);
+    m_helper->setSessionGrantTimeout(30 * 60 * 1000);
 }
 
 QTEST_MAIN(TestCouchPlayHelper)
@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QSignalSpy>
+#include <QTest>
+
+#include "DeviceFilterModel.h"
+#include "DeviceListModel.h"
+
+static InputDevice makeDevice(int eventNumber, const QString &type, bool isVirtual = false, bool isInternal = false)
+{
+    InputDevice device;
+    device.eventNumber = eventNumber;
+    device.name = QStringLiteral("Device %1").arg(eventNumber);
+    device.type = type;
+    device.path = QStringLiteral("/dev/input/event%1").arg(eventNumber);
+    device.stableId = QStringLiteral("0000:0000:test-%1").arg(eventNumber);
+    device.isVirtual = isVirtual;
+    device.isInternal = isInternal;
+    return device;
+}
+
+static QList<int> eventNumbers(const QAbstractItemModel &model)
+{
+    QList<int> result;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        result.append(model.index(row, 0).data(DeviceListModel::EventNumberRole).toInt());
+    }
+    return result;
+}
+
+class TestDeviceListModel : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testRoles();
+    void testSyncUpdatesChangedRowOnly();
+    void testSyncInsertsAndRemovesRows();
+    void testSyncResetsOnReorder();
+    void testFilterByType();
+    void testFilterVirtualAndInternal();
+    void testFilterAssignedInstance();
+};
+
+void TestDeviceListModel::testRoles()
+{
+    DeviceListModel model;
+    model.sync({makeDevice(3, QStringLiteral("controller"))});
+
+    const QModelIndex index = model.index(0);
+    QCOMPARE(index.data(DeviceListModel::NameRole).toString(), QStringLiteral("Device 3"));
+    QCOMPARE(index.data(DeviceListModel::PathRole).toString(), QStringLiteral("/dev/input/event3"));
+    QCOMPARE(index.data(DeviceListModel::AssignedInstanceRole).toInt(), -1);
+
+    const QVariantMap map = index.data(DeviceListModel::DeviceRole).toMap();
+    QCOMPARE(map.value(QStringLiteral("eventNumber")).toInt(), 3);
+    QCOMPARE(map.value(QStringLiteral("stableId")).toString(), QStringLiteral("0000:0000:test-3"));
+
+    const QHash<int, QByteArray> roles = model.roleNames();
+    QCOMPARE(roles.value(DeviceListModel::DeviceRole), QByteArray("device"));
+    QCOMPARE(roles.value(DeviceListModel::AssignedInstanceRole), QByteArray("assignedInstance"));
+}
+
+void TestDeviceListModel::testSyncUpdatesChangedRowOnly()
+{
+    QList<InputDevice> devices = {
+        makeDevice(1, QStringLiteral("controller")),
+        makeDevice(2, QStringLiteral("controller")),
+        makeDevice(3, QStringLiteral("keyboard")),
+    };
+
+    DeviceListModel model;
+    model.sync(devices);
+
+    QSignalSpy changedSpy(&model, &QAbstractItemModel::dataChanged);
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+    QSignalSpy countSpy(&model, &DeviceListModel::countChanged);
+
+    devices[1].assigned = true;
+    devices[1].assignedInstance = 1;
+    model.sync(devices);
+
+    QCOMPARE(changedSpy.count(), 1);
+    QCOMPARE(changedSpy.first().at(0).toModelIndex().row(), 1);
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(countSpy.count(), 0);
+    QCOMPARE(model.index(1).data(DeviceListModel::AssignedInstanceRole).toInt(), 1);
+
+    // Syncing the same list again is a no-op
+    model.sync(devices);
+    QCOMPARE(changedSpy.count(), 1);
+}
+
+void TestDeviceListModel::testSyncInsertsAndRemovesRows()
+{
+    DeviceListModel model;
+    model.sync({makeDevice(1, QStringLiteral("controller")), makeDevice(3, QStringLiteral("mouse"))});
+
+    QSignalSpy insertSpy(&model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy removeSpy(&model, &QAbstractItemModel::rowsRemoved);
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+    QSignalSpy countSpy(&model, &DeviceListModel::countChanged);
+
+    model.sync({makeDevice(1, QStringLiteral("controller")),
+                makeDevice(2, QStringLiteral("keyboard")),
+                makeDevice(3, QStringLiteral("mouse"))});
+    QCOMPARE(insertSpy.count(), 1);
+    QCOMPARE(insertSpy.first().at(1).toInt(), 1);
+    QCOMPARE(eventNumbers(model), (QList<int>{1, 2, 3}));
+    QCOMPARE(countSpy.count(), 1);
+
+    model.sync({makeDevice(2, QStringLiteral("keyboard"))});
+    QCOMPARE(removeSpy.count(), 2);
+    QCOMPARE(eventNumbers(model), QList<int>{2});
+    QCOMPARE(model.count(), 1);
+    QCOMPARE(resetSpy.count(), 0);
+}
+
+void TestDeviceListModel::testSyncResetsOnReorder()
+{
+    DeviceListModel model;
+    model.sync({makeDevice(1, QStringLiteral("controller")), makeDevice(2, QStringLiteral("controller"))});
+
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+    model.sync({makeDevice(2, QStringLiteral("controller")), makeDevice(1, QStringLiteral("controller"))});
+
+    QCOMPARE(resetSpy.count(), 1);
+    QCOMPARE(eventNumbers(model), (QList<int>{2, 1}));
+}
+
+void TestDeviceListModel::testFilterByType()
+{
+    DeviceListModel source;
+    source.sync({makeDevice(1, QStringLiteral("controller")),
+                 makeDevice(2, QStringLiteral("keyboard")),
+                 makeDevice(3, QStringLiteral("mouse")),
+                 makeDevice(4, QStringLiteral("other")),
+                 makeDevice(5, QStringLiteral("controller"))});
+
+    DeviceFilterModel filter;
+    filter.setSourceModel(&source);
+    QCOMPARE(filter.count(), 5);
+
+    filter.setFilter(DeviceFilterModel::Controllers);
+    QCOMPARE(eventNumbers(filter), (QList<int>{1, 5}));
+
+    filter.setFilter(DeviceFilterModel::Keyboards);
+    QCOMPARE(eventNumbers(filter), QList<int>{2});
+
+    filter.setFilter(DeviceFilterModel::Mice);
+    QCOMPARE(eventNumbers(filter), QList<int>{3});
+
+    filter.setFilter(DeviceFilterModel::Visible);
+    QCOMPARE(eventNumbers(filter), (QList<int>{1, 2, 3, 5}));
+}
+
+void TestDeviceListModel::testFilterVirtualAndInternal()
+{
+    DeviceListModel source;
+    source.sync({makeDevice(1, QStringLiteral("controller"), true),
+                 makeDevice(2, QStringLiteral("keyboard"), false, true),
+                 makeDevice(3, QStringLiteral("controller"), false, true)});
+
+    DeviceFilterModel filter;
+    filter.setSourceModel(&source);
+    filter.setFilter(DeviceFilterModel::Controllers);
+
+    // Controllers ignore the internal setting, like DeviceManager::controllers
+    QCOMPARE(eventNumbers(filter), QList<int>{3});
+
+    QSignalSpy countSpy(&filter, &DeviceFilterModel::countChanged);
+    filter.setShowVirtual(true);
+    QCOMPARE(eventNumbers(filter), (QList<int>{1, 3}));
+    QVERIFY(countSpy.count() > 0);
+
+    filter.setFilter(DeviceFilterModel::Keyboards);
+    QCOMPARE(filter.count(), 0);
+    filter.setShowInternal(true);
+    QCOMPARE(eventNumbers(filter), QList<int>{2});
+}
+
+void TestDeviceListModel::testFilterAssignedInstance()
+{
+    QList<InputDevice> devices = {
+        makeDevice(1, QStringLiteral("controller")),
+        makeDevice(2, QStringLiteral("controller")),
+    };
+
+    DeviceListModel source;
+    source.sync(devices);
+
+    DeviceFilterModel filter;
+    filter.setSourceModel(&source);
+    filter.setFilter(DeviceFilterModel::Visible);
+    filter.setAssignedInstance(0);
+    QCOMPARE(filter.count(), 0);
+
+    // Assignment changes reach the proxy through dataChanged
+    QSignalSpy countSpy(&filter, &DeviceFilterModel::countChanged);
+    devices[1].assigned = true;
+    devices[1].assignedInstance = 0;
+    source.sync(devices);
+    QCOMPARE(eventNumbers(filter), QList<int>{2});
+    QCOMPARE(countSpy.count(), 1);
+
+    filter.setAssignedInstance(DeviceFilterModel::AnyInstance);
+    QCOMPARE(filter.count(), 2);
+}
+
+QTEST_MAIN(TestDeviceListModel)
+#include "test_devicelistmodel.moc"
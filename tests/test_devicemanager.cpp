@@ -5,10 +5,18 @@
 #include <QSignalSpy>
 #include <QTemporaryFile>
 #include <QTemporaryDir>
+#include <QDir>
+#include <QFile>
 
 #include "DeviceManager.h"
+#include "EvdevWorker.h"
+#include "InputHotplugMonitor.h"
+#include "PowerSupplyMonitor.h"
 #include "SettingsManager.h"
 
+#include <arpa/inet.h>
+#include <cstring>
+
 // Helper macro for QVariantMap key access with proper QString conversion
 #define KEY(x) QStringLiteral(x)
 
@@ -29,6 +37,7 @@ private Q_SLOTS:
     void testGetDevicesForInstance();
     void testGetDevicePathsForInstance();
     void testIdentifyDevice();
+    void testEvdevWorker();
     void testGetDevice();
     
     // Property tests
@@ -60,6 +69,19 @@ private Q_SLOTS:
     // Blacklist tests
     void testIgnoredDevices();
 
+    // Index tests
+    void testPendingDevicesDeduplicated();
+    void testInstanceIndexMatchesDevices();
+
+    // Hotplug monitor tests
+    void testParseKernelUevent();
+    void testParseUdevUevent();
+    void testParseUeventIgnoresOtherDevices();
+    void testParsePowerSupplyUevent();
+
+    // Battery monitoring
+    void testPowerSupplyMonitor();
+
 private:
     DeviceManager *m_deviceManager = nullptr;
 };
@@ -231,6 +253,34 @@ void TestDeviceManager::testIdentifyDevice()
     QVERIFY(true);
 }
 
+void TestDeviceManager::testEvdevWorker()
+{
+    EvdevWorker worker;
+    QSignalSpy spy(&worker, &EvdevWorker::identified);
+
+    // Failures come back from the worker thread instead of blocking the caller
+    worker.identify(QStringLiteral("/dev/input/event-missing"));
+    QVERIFY(spy.wait());
+    QCOMPARE(spy.first().at(0).toString(), QStringLiteral("/dev/input/event-missing"));
+    QVERIFY(!spy.first().at(1).toBool());
+
+    // A node that opens but has neither rumble nor LEDs
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    worker.setRetained({file.fileName()});
+    spy.clear();
+    worker.identify(file.fileName());
+    QVERIFY(spy.wait());
+    QCOMPARE(spy.first().at(2).toString(), QStringLiteral("No rumble or LEDs"));
+
+    // A sequence goes through the devices in order
+    spy.clear();
+    worker.identifyAll({QStringLiteral("/dev/input/event-c"), file.fileName()});
+    QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 2, 5000);
+    QCOMPARE(spy.at(0).at(0).toString(), QStringLiteral("/dev/input/event-c"));
+    QCOMPARE(spy.at(1).at(0).toString(), file.fileName());
+}
+
 void TestDeviceManager::testGetDevice()
 {
     // Test getting a non-existent device
@@ -667,5 +717,251 @@ void TestDeviceManager::testIgnoredDevices()
     m_deviceManager->setSettingsManager(nullptr);
 }
 
+void TestDeviceManager::testPendingDevicesDeduplicated()
+{
+    DeviceManager manager;
+    const QString missing = QStringLiteral("dead:beef:usb-missing/input0");
+
+    QSignalSpy spy(&manager, &DeviceManager::pendingDevicesChanged);
+    manager.restoreAssignmentsFromStableIds(1, {missing, missing}, {QStringLiteral("Pad"), QStringLiteral("Pad")});
+    QCOMPARE(spy.count(), 1);
+
+    QVariantList pending = manager.pendingDevicesAsVariant();
+    QCOMPARE(pending.size(), 1);
+    QVariantMap entry = pending.first().toMap();
+    QCOMPARE(entry.value(KEY("stableId")).toString(), missing);
+    QCOMPARE(entry.value(KEY("name")).toString(), QStringLiteral("Pad"));
+    QCOMPARE(entry.value(KEY("instanceIndex")).toInt(), 1);
+
+    // Clearing another instance keeps it, clearing its own drops it
+    manager.clearPendingDevicesForInstance(0);
+    QCOMPARE(manager.pendingDevicesAsVariant().size(), 1);
+    manager.clearPendingDevicesForInstance(1);
+    QVERIFY(manager.pendingDevicesAsVariant().isEmpty());
+
+    // And it can be added again afterwards
+    manager.restoreAssignmentsFromStableIds(0, {missing}, {QStringLiteral("Pad")});
+    QCOMPARE(manager.pendingDevicesAsVariant().size(), 1);
+    manager.clearPendingDevicesForInstance(-1);
+    QVERIFY(manager.pendingDevicesAsVariant().isEmpty());
+}
+
+void TestDeviceManager::testInstanceIndexMatchesDevices()
+{
+    DeviceManager manager;
+    const QList<InputDevice> devices = manager.devices();
+    if (devices.size() < 2) {
+        QSKIP("Need at least two input devices");
+    }
+
+    QVERIFY(manager.assignDevice(devices[0].eventNumber, 1));
+    QVERIFY(manager.assignDevice(devices[1].eventNumber, 1));
+    QCOMPARE(manager.getDevicesForInstance(1), (QList<int>{devices[0].eventNumber, devices[1].eventNumber}));
+
+    // Moving a device updates both instances
+    QVERIFY(manager.assignDevice(devices[0].eventNumber, 2));
+    QCOMPARE(manager.getDevicesForInstance(1), QList<int>{devices[1].eventNumber});
+    QCOMPARE(manager.getDevicesForInstance(2), QList<int>{devices[0].eventNumber});
+
+    // Unassigned devices are still reported for -1
+    QVERIFY(!manager.getDevicesForInstance(-1).contains(devices[0].eventNumber));
+    QVERIFY(manager.assignDevice(devices[0].eventNumber, -1));
+    QVERIFY(manager.getDevicesForInstance(-1).contains(devices[0].eventNumber));
+    QVERIFY(manager.getDevicesForInstance(2).isEmpty());
+
+    if (!devices[1].stableId.isEmpty()) {
+        QCOMPARE(manager.findDeviceByStableId(devices[1].stableId), manager.getDevice(devices[1].eventNumber).value(KEY("eventNumber")).toInt());
+    }
+}
+
+static QByteArray ueventPayload(const QList<QByteArray> &entries)
+{
+    QByteArray payload;
+    for (const QByteArray &entry : entries) {
+        payload += entry;
+        payload += '\0';
+    }
+    return payload;
+}
+
+void TestDeviceManager::testParseKernelUevent()
+{
+    const QByteArray message = ueventPayload({
+        "add@/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.0/input/input23/event17",
+        "ACTION=add",
+        "DEVPATH=/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.0/input/input23/event17",
+        "SUBSYSTEM=input",
+        "MAJOR=13",
+        "MINOR=81",
+        "DEVNAME=input/event17",
+        "SEQNUM=4242",
+    });
+
+    InputHotplugMonitor::Event event;
+    QVERIFY(InputHotplugMonitor::parseUevent(message, event));
+    QCOMPARE(event.action, InputHotplugMonitor::Action::Add);
+    QCOMPARE(event.eventNumber, 17);
+}
+
+void TestDeviceManager::testParseUdevUevent()
+{
+    const QByteArray properties = ueventPayload({
+        "ACTION=remove",
+        "SUBSYSTEM=input",
+        "DEVNAME=/dev/input/event5",
+        "ID_INPUT_JOYSTICK=1",
+    });
+
+    // libudev header: prefix, magic (network order), header size, properties offset/length
+    QByteArray header(40, '\0');
+    memcpy(header.data(), "libudev", 8);
+    const quint32 magic = htonl(0xfeedcafe);
+    const quint32 headerSize = header.size();
+    const quint32 offset = header.size();
+    const quint32 length = properties.size();
+    memcpy(header.data() + 8, &magic, 4);
+    memcpy(header.data() + 12, &headerSize, 4);
+    memcpy(header.data() + 16, &offset, 4);
+    memcpy(header.data() + 20, &length, 4);
+
+    InputHotplugMonitor::Event event;
+    QVERIFY(InputHotplugMonitor::parseUevent(header + properties, event));
+    QCOMPARE(event.action, InputHotplugMonitor::Action::Remove);
+    QCOMPARE(event.eventNumber, 5);
+
+    // Corrupt magic is rejected
+    QByteArray corrupt = header + properties;
+    corrupt[8] = 0;
+    QVERIFY(!InputHotplugMonitor::parseUevent(corrupt, event));
+}
+
+void TestDeviceManager::testParseUeventIgnoresOtherDevices()
+{
+    InputHotplugMonitor::Event event;
+
+    // The parent inputN device has no node
+    QVERIFY(!InputHotplugMonitor::parseUevent(ueventPayload({
+        "add@/devices/virtual/input/input30",
+        "ACTION=add",
+        "SUBSYSTEM=input",
+    }), event));
+
+    // Joystick nodes are covered by their eventN sibling
+    QVERIFY(!InputHotplugMonitor::parseUevent(ueventPayload({
+        "add@/devices/virtual/input/input30/js0",
+        "ACTION=add",
+        "SUBSYSTEM=input",
+        "DEVNAME=input/js0",
+    }), event));
+
+    // Other subsystems and actions
+    QVERIFY(!InputHotplugMonitor::parseUevent(ueventPayload({
+        "add@/devices/virtual/block/loop0",
+        "ACTION=add",
+        "SUBSYSTEM=block",
+        "DEVNAME=loop0",
+    }), event));
+    QVERIFY(!InputHotplugMonitor::parseUevent(ueventPayload({
+        "change@/devices/virtual/input/input30/event9",
+        "ACTION=change",
+        "SUBSYSTEM=input",
+        "DEVNAME=input/event9",
+    }), event));
+}
+
+void TestDeviceManager::testParsePowerSupplyUevent()
+{
+    InputHotplugMonitor::Event event;
+    QVERIFY(InputHotplugMonitor::parseUevent(ueventPayload({
+        "change@/devices/pci0000:00/0000:00:14.0/usb1/1-3/1-3:1.0/bluetooth/hci0/hci0:11/0005:054C:0CE6.0007/power_supply/ps-controller-battery-aa:bb:cc:dd:ee:ff",
+        "ACTION=change",
+        "DEVPATH=/devices/pci0000:00/0000:00:14.0/usb1/1-3/1-3:1.0/bluetooth/hci0/hci0:11/0005:054C:0CE6.0007/power_supply/ps-controller-battery-aa:bb:cc:dd:ee:ff",
+        "SUBSYSTEM=power_supply",
+        "POWER_SUPPLY_NAME=ps-controller-battery-aa:bb:cc:dd:ee:ff",
+        "POWER_SUPPLY_CAPACITY=40",
+    }), event));
+    QCOMPARE(event.action, InputHotplugMonitor::Action::Change);
+    QCOMPARE(event.powerSupply, QStringLiteral("ps-controller-battery-aa:bb:cc:dd:ee:ff"));
+    QCOMPARE(event.eventNumber, -1);
+
+    // Removals only carry the path
+    QVERIFY(InputHotplugMonitor::parseUevent(ueventPayload({
+        "remove@/devices/virtual/power_supply/hidpp_battery_0",
+        "ACTION=remove",
+        "DEVPATH=/devices/virtual/power_supply/hidpp_battery_0",
+        "SUBSYSTEM=power_supply",
+    }), event));
+    QCOMPARE(event.action, InputHotplugMonitor::Action::Remove);
+    QCOMPARE(event.powerSupply, QStringLiteral("hidpp_battery_0"));
+}
+
+static bool writeSysfsFile(const QString &path, const QByteArray &content)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(content + '\n') == content.size() + 1;
+}
+
+void TestDeviceManager::testPowerSupplyMonitor()
+{
+    QTemporaryDir sysfs;
+    QVERIFY(sysfs.isValid());
+    const QString root = sysfs.path();
+    QDir dir(root);
+
+    // A controller: HID device with an input device, node event7 and a battery
+    const QString hid = root + QStringLiteral("/devices/hid0");
+    QVERIFY(dir.mkpath(QStringLiteral("devices/hid0/input/input9")));
+    QVERIFY(dir.mkpath(QStringLiteral("class/input/event7")));
+    QVERIFY(QFile::link(hid + QStringLiteral("/input/input9"), root + QStringLiteral("/class/input/event7/device")));
+    QVERIFY(dir.mkpath(QStringLiteral("class/power_supply/pad_battery")));
+    const QString battery = root + QStringLiteral("/class/power_supply/pad_battery");
+    QVERIFY(QFile::link(hid, battery + QStringLiteral("/device")));
+    QVERIFY(writeSysfsFile(battery + QStringLiteral("/type"), "Battery"));
+    QVERIFY(writeSysfsFile(battery + QStringLiteral("/scope"), "Device"));
+    QVERIFY(writeSysfsFile(battery + QStringLiteral("/capacity"), "42"));
+    QVERIFY(writeSysfsFile(battery + QStringLiteral("/status"), "Discharging"));
+
+    // A keyboard without battery, and the laptop's own battery
+    QVERIFY(dir.mkpath(QStringLiteral("devices/platform/i8042/input/input3")));
+    QVERIFY(dir.mkpath(QStringLiteral("class/input/event3")));
+    QVERIFY(QFile::link(root + QStringLiteral("/devices/platform/i8042/input/input3"),
+                        root + QStringLiteral("/class/input/event3/device")));
+    QVERIFY(dir.mkpath(QStringLiteral("class/power_supply/BAT0")));
+    QVERIFY(QFile::link(root + QStringLiteral("/devices/platform"),
+                        root + QStringLiteral("/class/power_supply/BAT0/device")));
+    QVERIFY(writeSysfsFile(root + QStringLiteral("/class/power_supply/BAT0/type"), "Battery"));
+    QVERIFY(writeSysfsFile(root + QStringLiteral("/class/power_supply/BAT0/scope"), "System"));
+
+    PowerSupplyMonitor monitor(root);
+    monitor.rescan();
+
+    PowerSupplyMonitor::Battery pad = monitor.batteryFor(7);
+    QCOMPARE(pad.name, QStringLiteral("pad_battery"));
+    QCOMPARE(pad.level, 42);
+    QVERIFY(!pad.charging);
+    QVERIFY(monitor.batteryFor(3).name.isEmpty());
+    QCOMPARE(monitor.batteryFor(3).level, -1);
+    QVERIFY(monitor.batteryFor(99).name.isEmpty());
+
+    // A change uevent re-reads the supply; system batteries are ignored
+    QVERIFY(writeSysfsFile(battery + QStringLiteral("/status"), "Charging"));
+    QVERIFY(monitor.update(QStringLiteral("pad_battery")));
+    QVERIFY(monitor.batteryFor(7).charging);
+    QVERIFY(!monitor.update(QStringLiteral("pad_battery")));
+    QVERIFY(!monitor.update(QStringLiteral("BAT0")));
+
+    // Drivers reporting only a coarse level
+    QVERIFY(QFile::remove(battery + QStringLiteral("/capacity")));
+    QVERIFY(writeSysfsFile(battery + QStringLiteral("/capacity_level"), "Low"));
+    QVERIFY(monitor.update(QStringLiteral("pad_battery")));
+    QCOMPARE(monitor.batteryFor(7).level, 10);
+    QCOMPARE(PowerSupplyMonitor::levelFromCapacityLevel(QStringLiteral("Unknown")), -1);
+
+    // Removal rescans
+    QVERIFY(QDir(battery).removeRecursively());
+    QVERIFY(monitor.update(QStringLiteral("pad_battery")));
+    QVERIFY(monitor.batteryFor(7).name.isEmpty());
+}
+
 QTEST_MAIN(TestDeviceManager)
 #include "test_devicemanager.moc"
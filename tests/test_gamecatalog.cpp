@@ -0,0 +1,217 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <atomic>
+#include <memory>
+
+#include "GameCatalog.h"
+
+class TestGameCatalog : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+
+    void testMergeAndDedupe();
+    void testSortBy();
+    void testCachedSources();
+    void testRowsPatchedInPlace();
+
+private:
+    static GameCatalog::Game game(const QString &source, const QString &id, const QString &name,
+                                  qint64 installSize = 0);
+    static void writeFile(const QString &path, const QByteArray &content);
+    static bool refreshAndWait(GameCatalog &catalog);
+    QStringList names(const GameCatalog &catalog) const;
+
+    QTemporaryDir *m_tempDir = nullptr;
+};
+
+void TestGameCatalog::init()
+{
+    m_tempDir = new QTemporaryDir();
+    QVERIFY(m_tempDir->isValid());
+}
+
+void TestGameCatalog::cleanup()
+{
+    delete m_tempDir;
+    m_tempDir = nullptr;
+}
+
+GameCatalog::Game TestGameCatalog::game(const QString &source, const QString &id, const QString &name,
+                                        qint64 installSize)
+{
+    GameCatalog::Game game;
+    game.source = source;
+    game.id = id;
+    game.name = name;
+    game.command = source + QStringLiteral("://") + id;
+    game.installSize = installSize;
+    return game;
+}
+
+void TestGameCatalog::writeFile(const QString &path, const QByteArray &content)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(content);
+}
+
+bool TestGameCatalog::refreshAndWait(GameCatalog &catalog)
+{
+    QSignalSpy refreshed(&catalog, &GameCatalog::refreshed);
+    catalog.refresh();
+    return refreshed.count() > 0 || refreshed.wait(5000);
+}
+
+QStringList TestGameCatalog::names(const GameCatalog &catalog) const
+{
+    QStringList result;
+    for (const GameCatalog::Game &game : catalog.games()) {
+        result.append(game.name);
+    }
+    return result;
+}
+
+void TestGameCatalog::testMergeAndDedupe()
+{
+    GameCatalog catalog;
+    catalog.setCachePath(m_tempDir->filePath(QStringLiteral("catalog.json")));
+
+    // Registered out of priority order on purpose
+    catalog.addSource(QStringLiteral("shortcut"), {}, [] {
+        return QList<GameCatalog::Game>{game(QStringLiteral("shortcut"), QStringLiteral("1"), QStringLiteral("Hades")),
+                                        game(QStringLiteral("shortcut"), QStringLiteral("2"), QStringLiteral("RetroArch"))};
+    });
+    catalog.addSource(QStringLiteral("legendary"), {}, [] {
+        return QList<GameCatalog::Game>{game(QStringLiteral("legendary"), QStringLiteral("Min"), QStringLiteral("HADES")),
+                                        game(QStringLiteral("legendary"), QStringLiteral("Fn"), QStringLiteral("Fortnite"))};
+    });
+    catalog.addSource(QStringLiteral("steam"), {}, [] {
+        return QList<GameCatalog::Game>{game(QStringLiteral("steam"), QStringLiteral("1145360"), QStringLiteral("Hades")),
+                                        game(QStringLiteral("steam"), QStringLiteral("730"), QStringLiteral("Counter-Strike 2"))};
+    });
+
+    QSignalSpy loading(&catalog, &GameCatalog::loadingChanged);
+    QVERIFY(refreshAndWait(catalog));
+    QVERIFY(!catalog.isLoading());
+    QCOMPARE(loading.count(), 2);
+
+    // Hades is listed once, from Steam; names compare without case or punctuation
+    QCOMPARE(names(catalog), QStringList({QStringLiteral("Counter-Strike 2"), QStringLiteral("Fortnite"),
+                                          QStringLiteral("Hades"), QStringLiteral("RetroArch")}));
+    QCOMPARE(catalog.count(), 4);
+    const QModelIndex hades = catalog.index(2);
+    QCOMPARE(catalog.data(hades, GameCatalog::SourceRole).toString(), QStringLiteral("steam"));
+    QCOMPARE(catalog.data(hades, GameCatalog::CommandRole).toString(), QStringLiteral("steam://1145360"));
+    QCOMPARE(catalog.data(hades, GameCatalog::KeyRole).toString(), QStringLiteral("steam:1145360"));
+}
+
+void TestGameCatalog::testSortBy()
+{
+    GameCatalog catalog;
+    catalog.setCachePath(m_tempDir->filePath(QStringLiteral("catalog.json")));
+    catalog.addSource(QStringLiteral("gog"), {}, [] {
+        return QList<GameCatalog::Game>{game(QStringLiteral("gog"), QStringLiteral("a"), QStringLiteral("Alpha"), 10),
+                                        game(QStringLiteral("gog"), QStringLiteral("b"), QStringLiteral("beta"), 30),
+                                        game(QStringLiteral("gog"), QStringLiteral("c"), QStringLiteral("Gamma"), 20)};
+    });
+    QVERIFY(refreshAndWait(catalog));
+    QCOMPARE(names(catalog), QStringList({QStringLiteral("Alpha"), QStringLiteral("beta"), QStringLiteral("Gamma")}));
+
+    QSignalSpy sortChanged(&catalog, &GameCatalog::sortByChanged);
+    catalog.setSortBy(QStringLiteral("size"));
+    QCOMPARE(sortChanged.count(), 1);
+    QCOMPARE(names(catalog), QStringList({QStringLiteral("beta"), QStringLiteral("Gamma"), QStringLiteral("Alpha")}));
+}
+
+void TestGameCatalog::testCachedSources()
+{
+    const QString cachePath = m_tempDir->filePath(QStringLiteral("catalog.json"));
+    const QString installed = m_tempDir->filePath(QStringLiteral("installed.json"));
+    writeFile(installed, "{}");
+
+    auto loads = std::make_shared<std::atomic<int>>(0);
+    auto name = std::make_shared<QString>(QStringLiteral("Celeste"));
+    const auto addGogSource = [&](GameCatalog &catalog) {
+        catalog.setCachePath(cachePath);
+        catalog.addSource(QStringLiteral("gog"), {installed}, [loads, name] {
+            ++*loads;
+            return QList<GameCatalog::Game>{game(QStringLiteral("gog"), QStringLiteral("1"), *name, 1024)};
+        });
+    };
+
+    {
+        GameCatalog first;
+        addGogSource(first);
+        QVERIFY(refreshAndWait(first));
+        QCOMPARE(loads->load(), 1);
+    }
+    QVERIFY(QFile::exists(cachePath));
+
+    // A new catalog lists the cached games before any source has run
+    GameCatalog second;
+    addGogSource(second);
+    QSignalSpy refreshed(&second, &GameCatalog::refreshed);
+    second.refresh();
+    QCOMPARE(second.count(), 1);
+    QCOMPARE(second.games().first().installSize, qint64(1024));
+    QVERIFY(refreshed.wait(5000));
+    QCOMPARE(loads->load(), 1);  // Unchanged file, not parsed again
+
+    // A changed file is
+    *name = QStringLiteral("Celeste 64");
+    writeFile(installed, "{\"changed\": true}");
+    QVERIFY(refreshAndWait(second));
+    QCOMPARE(loads->load(), 2);
+    QCOMPARE(names(second), QStringList({QStringLiteral("Celeste 64")}));
+}
+
+void TestGameCatalog::testRowsPatchedInPlace()
+{
+    auto games = std::make_shared<QList<GameCatalog::Game>>();
+    *games = {game(QStringLiteral("steam"), QStringLiteral("1"), QStringLiteral("Alpha")),
+              game(QStringLiteral("steam"), QStringLiteral("3"), QStringLiteral("Gamma"))};
+
+    GameCatalog catalog;
+    catalog.setCachePath(m_tempDir->filePath(QStringLiteral("catalog.json")));
+    // No stamped files: the source loads on every refresh
+    catalog.addSource(QStringLiteral("steam"), {}, [games] { return *games; });
+    QVERIFY(refreshAndWait(catalog));
+    QCOMPARE(catalog.count(), 2);
+
+    QSignalSpy reset(&catalog, &QAbstractItemModel::modelReset);
+    QSignalSpy inserted(&catalog, &QAbstractItemModel::rowsInserted);
+    QSignalSpy removed(&catalog, &QAbstractItemModel::rowsRemoved);
+    QSignalSpy changed(&catalog, &QAbstractItemModel::dataChanged);
+
+    // A new game in the middle, an update to an existing one
+    GameCatalog::Game gamma = games->at(1);
+    gamma.installSize = 4096;
+    *games = {games->at(0), game(QStringLiteral("steam"), QStringLiteral("2"), QStringLiteral("Beta")), gamma};
+    QVERIFY(refreshAndWait(catalog));
+
+    QCOMPARE(reset.count(), 0);
+    QCOMPARE(removed.count(), 0);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(inserted.first().at(1).toInt(), 1);
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(names(catalog), QStringList({QStringLiteral("Alpha"), QStringLiteral("Beta"), QStringLiteral("Gamma")}));
+
+    *games = {games->at(2)};
+    QVERIFY(refreshAndWait(catalog));
+    QCOMPARE(reset.count(), 0);
+    QCOMPARE(removed.count(), 2);
+    QCOMPARE(catalog.count(), 1);
+}
+
+QTEST_MAIN(TestGameCatalog)
+#include "test_gamecatalog.moc"
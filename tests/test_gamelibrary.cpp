@@ -6,7 +6,9 @@
 #include <QTemporaryDir>
 #include <QStandardPaths>
 #include <QFile>
+#include <QDateTime>
 #include <QDir>
+#include <QFileInfo>
 #include <QJsonDocument>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -54,6 +56,8 @@ private Q_SLOTS:
     // Steam games tests
     void testGetSteamGamesNoSteam();
     void testParseSteamManifest();
+    void testSteamLibraryFolders();
+    void testSteamManifestIndex();
     
     // Launch mode tests
     void testAddGameSteamMode();
@@ -480,19 +484,111 @@ void TestGameLibrary::testParseSteamManifest()
     "name"      "Counter-Strike 2"
     "StateFlags"        "4"
     "installdir"        "Counter-Strike Global Offensive"
+    "LastPlayed"        "1700000000"
+    "SizeOnDisk"        "35000000000"
+    "UserConfig"
+    {
+        "name"      "not the game"
+    }
 }
 )");
     manifest.close();
     
-    // Note: getSteamGames() uses hardcoded paths, so this test verifies
-    // the manifest parsing logic would work if paths existed.
-    // In a real implementation, we'd need to make the paths configurable
-    // or use dependency injection for testing.
-    
-    // For now, just verify the method doesn't crash
-    GameLibrary library;
-    QVariantList games = library.getSteamGames();
-    // Can't verify specific results without mocking the file paths
+    const QVariantList games = GameLibrary::scanSteamGames({m_tempDir->path() + QStringLiteral("/.steam/steam")}, QString());
+    QCOMPARE(games.size(), 1);
+    const QVariantMap game = games.first().toMap();
+    QCOMPARE(game[QStringLiteral("name")].toString(), QStringLiteral("Counter-Strike 2"));
+    QCOMPARE(game[QStringLiteral("appId")].toString(), QStringLiteral("730"));
+    QCOMPARE(game[QStringLiteral("command")].toString(), QStringLiteral("steam://rungameid/730"));
+    QCOMPARE(game[QStringLiteral("installPath")].toString(),
+             QFileInfo(steamPath).canonicalFilePath() + QStringLiteral("/common/Counter-Strike Global Offensive"));
+    QCOMPARE(game[QStringLiteral("installSize")].toLongLong(), Q_INT64_C(35000000000));
+    QCOMPARE(game[QStringLiteral("lastPlayed")].toLongLong(), Q_INT64_C(1700000000));
+}
+
+void TestGameLibrary::testSteamLibraryFolders()
+{
+    const QString vdfPath = m_tempDir->filePath(QStringLiteral("libraryfolders.vdf"));
+    QFile vdf(vdfPath);
+    QVERIFY(vdf.open(QIODevice::WriteOnly));
+    vdf.write(R"("libraryfolders"
+{
+    "0"
+    {
+        "path"      "/home/player/.local/share/Steam"
+        "label"     ""
+        "apps"
+        {
+            "228980"        "154234831"
+        }
+    }
+    "1"
+    {
+        "path"      "/mnt/games/SteamLibrary"
+        "label"     "Games"
+    }
+}
+)");
+    vdf.close();
+    QCOMPARE(GameLibrary::steamLibraryFolders(vdfPath),
+             QStringList({QStringLiteral("/home/player/.local/share/Steam"), QStringLiteral("/mnt/games/SteamLibrary")}));
+
+    // Format written by older Steam clients
+    QVERIFY(vdf.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    vdf.write(R"("LibraryFolders"
+{
+    "TimeNextStatsReport"       "1700000000"
+    "ContentStatsID"        "-123"
+    "1"     "/mnt/old"
+}
+)");
+    vdf.close();
+    QCOMPARE(GameLibrary::steamLibraryFolders(vdfPath), QStringList({QStringLiteral("/mnt/old")}));
+
+    QVERIFY(GameLibrary::steamLibraryFolders(m_tempDir->filePath(QStringLiteral("missing.vdf"))).isEmpty());
+}
+
+void TestGameLibrary::testSteamManifestIndex()
+{
+    // Two libraries, one also reachable through a symlink
+    const QString first = m_tempDir->filePath(QStringLiteral("Steam"));
+    const QString second = m_tempDir->filePath(QStringLiteral("SteamLibrary"));
+    const QString link = m_tempDir->filePath(QStringLiteral("steam-link"));
+    QDir().mkpath(first + QStringLiteral("/steamapps"));
+    QDir().mkpath(second + QStringLiteral("/steamapps"));
+    QVERIFY(QFile::link(first, link));
+    createSteamManifest(first + QStringLiteral("/steamapps/appmanifest_10.acf"), QStringLiteral("10"), QStringLiteral("First"));
+    createSteamManifest(second + QStringLiteral("/steamapps/appmanifest_20.acf"), QStringLiteral("20"), QStringLiteral("Second"));
+
+    const QString indexPath = m_tempDir->filePath(QStringLiteral("cache/steam-manifests.json"));
+    const QStringList libraries = {first, link, second};
+    QCOMPARE(GameLibrary::scanSteamGames(libraries, indexPath).size(), 2);
+    QVERIFY(QFile::exists(indexPath));
+
+    // Indexed manifests are not read again while their mtime and size hold
+    const QString manifest = second + QStringLiteral("/steamapps/appmanifest_20.acf");
+    const QDateTime modified = QFileInfo(manifest).lastModified();
+    createSteamManifest(manifest, QStringLiteral("20"), QStringLiteral("Secund"));
+    QFile touched(manifest);
+    QVERIFY(touched.open(QIODevice::ReadWrite));
+    QVERIFY(touched.setFileTime(modified, QFileDevice::FileModificationTime));
+    touched.close();
+    QVariantList games = GameLibrary::scanSteamGames(libraries, indexPath);
+    QCOMPARE(games.size(), 2);
+    QCOMPARE(games.at(1).toMap()[QStringLiteral("name")].toString(), QStringLiteral("Second"));
+
+    // A changed one is
+    createSteamManifest(manifest, QStringLiteral("20"), QStringLiteral("Second Edition"));
+    games = GameLibrary::scanSteamGames(libraries, indexPath);
+    QCOMPARE(games.size(), 2);
+    QCOMPARE(games.at(1).toMap()[QStringLiteral("name")].toString(), QStringLiteral("Second Edition"));
+
+    // Uninstalled games leave the index
+    QFile::remove(manifest);
+    QCOMPARE(GameLibrary::scanSteamGames(libraries, indexPath).size(), 1);
+    QFile index(indexPath);
+    QVERIFY(index.open(QIODevice::ReadOnly));
+    QCOMPARE(QJsonDocument::fromJson(index.readAll()).object()[QStringLiteral("manifests")].toObject().size(), 1);
 }
 
 void TestGameLibrary::createSteamManifest(const QString &path, const QString &appId, const QString &name)
@@ -27,6 +27,8 @@ private Q_SLOTS:
     void testBuildArgsMinimal();
     void testBuildArgsResolution();
     void testBuildArgsRefreshRate();
+    void testBuildArgsFrameLimit();
+    void testBuildArgsGpu();
     void testBuildArgsScalingMode();
     void testBuildArgsFilterMode();
     void testBuildArgsPosition();
@@ -36,6 +38,10 @@ private Q_SLOTS:
     // buildEnvironment tests
     void testBuildEnvBasic();
     void testBuildEnvCustomPulseServer();
+    void testBuildEnvFrameLimit();
+    void testBuildEnvAudioSink();
+    void testBuildEnvInstanceIndex();
+    void testBuildEnvGpu();
     
     // Instance state tests
     void testInitialState();
@@ -52,6 +58,9 @@ private Q_SLOTS:
     void testSteamLaunchModeNoAppId();
     void testSteamModeIsDefault();
 
+    // Benchmarks
+    void benchmarkBuildGamescopeArgs();
+
 private:
     GamescopeInstance *m_instance = nullptr;
 };
@@ -136,6 +145,32 @@ void TestGamescopeInstance::testBuildArgsRefreshRate()
     QCOMPARE(args[rIdx + 1], QStringLiteral("144"));
 }
 
+void TestGamescopeInstance::testBuildArgsFrameLimit()
+{
+    QVariantMap config;
+    QVERIFY(!GamescopeInstance::buildGamescopeArgs(config).contains(QStringLiteral("--framerate-limit")));
+
+    config[QStringLiteral("frameLimit")] = 40;
+    QStringList args = GamescopeInstance::buildGamescopeArgs(config);
+
+    int idx = args.indexOf(QStringLiteral("--framerate-limit"));
+    QVERIFY(idx >= 0);
+    QCOMPARE(args[idx + 1], QStringLiteral("40"));
+}
+
+void TestGamescopeInstance::testBuildArgsGpu()
+{
+    QVariantMap config;
+    QVERIFY(!GamescopeInstance::buildGamescopeArgs(config).contains(QStringLiteral("--prefer-vk-device")));
+
+    config[QStringLiteral("gpuDevice")] = QStringLiteral("1002:73bf");
+    QStringList args = GamescopeInstance::buildGamescopeArgs(config);
+
+    int idx = args.indexOf(QStringLiteral("--prefer-vk-device"));
+    QVERIFY(idx >= 0);
+    QCOMPARE(args[idx + 1], QStringLiteral("1002:73bf"));
+}
+
 void TestGamescopeInstance::testBuildArgsScalingMode()
 {
     QVariantMap config;
@@ -270,6 +305,61 @@ void TestGamescopeInstance::testBuildEnvCustomPulseServer()
     QVERIFY(!hasPulseServer);
 }
 
+void TestGamescopeInstance::testBuildEnvFrameLimit()
+{
+    QVariantMap config;
+    QStringList env = GamescopeInstance::buildEnvironment(config);
+    QVERIFY(!env.contains(QStringLiteral("DXVK_FRAME_RATE=0")));
+
+    config[QStringLiteral("frameLimit")] = 60;
+    env = GamescopeInstance::buildEnvironment(config);
+    QVERIFY(env.contains(QStringLiteral("DXVK_FRAME_RATE=60")));
+    QVERIFY(env.contains(QStringLiteral("VKD3D_FRAME_RATE=60")));
+}
+
+void TestGamescopeInstance::testBuildEnvAudioSink()
+{
+    QVariantMap config;
+    QStringList env = GamescopeInstance::buildEnvironment(config);
+    QVERIFY(env.filter(QStringLiteral("PULSE_SINK=")).isEmpty());
+
+    config[QStringLiteral("audioSink")] = QStringLiteral("couchplay-player-2");
+    env = GamescopeInstance::buildEnvironment(config);
+    QVERIFY(env.contains(QStringLiteral("PULSE_SINK=couchplay-player-2")));
+    QVERIFY(env.contains(QStringLiteral("PIPEWIRE_NODE=couchplay-player-2")));
+}
+
+void TestGamescopeInstance::testBuildEnvInstanceIndex()
+{
+    QVariantMap config;
+    QStringList env = GamescopeInstance::buildEnvironment(config);
+    QVERIFY(env.filter(QStringLiteral("COUCHPLAY_INSTANCE=")).isEmpty());
+
+    config[QStringLiteral("instanceIndex")] = 2;
+    env = GamescopeInstance::buildEnvironment(config);
+    QVERIFY(env.contains(QStringLiteral("COUCHPLAY_INSTANCE=2")));
+}
+
+void TestGamescopeInstance::testBuildEnvGpu()
+{
+    QVariantMap config;
+    QStringList env = GamescopeInstance::buildEnvironment(config);
+    QVERIFY(env.filter(QStringLiteral("DRI_PRIME=")).isEmpty());
+    QVERIFY(env.filter(QStringLiteral("MESA_VK_DEVICE_SELECT=")).isEmpty());
+
+    config[QStringLiteral("gpuDevice")] = QStringLiteral("1002:73bf");
+    config[QStringLiteral("gpuPrime")] = QStringLiteral("pci-0000_03_00_0");
+    env = GamescopeInstance::buildEnvironment(config);
+    QVERIFY(env.contains(QStringLiteral("DRI_PRIME=pci-0000_03_00_0")));
+    QVERIFY(env.contains(QStringLiteral("MESA_VK_DEVICE_SELECT=1002:73bf")));
+
+    // With an identical card next to it only the PCI address is exact
+    config[QStringLiteral("gpuTwin")] = true;
+    env = GamescopeInstance::buildEnvironment(config);
+    QVERIFY(env.contains(QStringLiteral("DRI_PRIME=pci-0000_03_00_0")));
+    QVERIFY(env.filter(QStringLiteral("MESA_VK_DEVICE_SELECT=")).isEmpty());
+}
+
 // ============ Instance State Tests ============
 
 void TestGamescopeInstance::testInitialState()
@@ -442,5 +532,27 @@ void TestGamescopeInstance::testSteamModeIsDefault()
     m_instance->stop();
 }
 
+void TestGamescopeInstance::benchmarkBuildGamescopeArgs()
+{
+    QVariantMap config;
+    config[QStringLiteral("internalWidth")] = 1920;
+    config[QStringLiteral("internalHeight")] = 1080;
+    config[QStringLiteral("outputWidth")] = 960;
+    config[QStringLiteral("outputHeight")] = 1080;
+    config[QStringLiteral("refreshRate")] = 60;
+    config[QStringLiteral("frameLimit")] = 30;
+    config[QStringLiteral("scalingMode")] = QStringLiteral("fit");
+    config[QStringLiteral("filterMode")] = QStringLiteral("linear");
+    config[QStringLiteral("borderless")] = true;
+    config[QStringLiteral("steamIntegration")] = true;
+    config[QStringLiteral("devicePaths")] = QVariantList{QStringLiteral("/dev/null")};
+
+    QStringList args;
+    QBENCHMARK {
+        args = GamescopeInstance::buildGamescopeArgs(config);
+    }
+    QVERIFY(args.contains(QStringLiteral("-w")));
+}
+
 QTEST_MAIN(TestGamescopeInstance)
 #include "test_gamescopeinstance.moc"
@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "GpuTopology.h"
+#include "UserDirectory.h"
+
+#include <unistd.h>
+
+class TestGpuTopology : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testEnumerate();
+    void testPrimeTag();
+    void testHasTwin();
+    void testCanAccess();
+    void testBalance();
+    void testBalancePinned();
+    void testBalanceUsable();
+
+private:
+    static bool writeFile(const QString &path, const QByteArray &contents);
+    // cardN in @p root/drm, a PCI device at @p pciAddress with renderD(128 + N)
+    static bool addCard(const QString &root, int card, const QString &pciAddress, const QByteArray &vendor,
+                        const QByteArray &device, const QByteArray &vram = QByteArray());
+    static GpuTopology::Gpu gpu(const QString &pciAddress, RenderBudget::GpuClass gpuClass);
+};
+
+bool TestGpuTopology::writeFile(const QString &path, const QByteArray &contents)
+{
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(contents) == contents.size();
+}
+
+bool TestGpuTopology::addCard(const QString &root, int card, const QString &pciAddress, const QByteArray &vendor,
+                              const QByteArray &device, const QByteArray &vram)
+{
+    const QString pci = root + QStringLiteral("/devices/pci0000:00/") + pciAddress;
+    const QString cardDir = root + QStringLiteral("/drm/card") + QString::number(card);
+    const QString renderNode = QStringLiteral("renderD") + QString::number(128 + card);
+    return QDir().mkpath(pci + QStringLiteral("/drm/") + renderNode)
+        && QDir().mkpath(cardDir)
+        && QFile::link(pci, cardDir + QStringLiteral("/device"))
+        && writeFile(pci + QStringLiteral("/vendor"), vendor + '\n')
+        && writeFile(pci + QStringLiteral("/device"), device + '\n')
+        && (vram.isEmpty() || writeFile(pci + QStringLiteral("/mem_info_vram_total"), vram + '\n'));
+}
+
+GpuTopology::Gpu TestGpuTopology::gpu(const QString &pciAddress, RenderBudget::GpuClass gpuClass)
+{
+    GpuTopology::Gpu gpu;
+    gpu.pciAddress = pciAddress;
+    gpu.vendorId = QStringLiteral("1002");
+    gpu.deviceId = pciAddress.mid(5, 2);
+    gpu.gpuClass = gpuClass;
+    return gpu;
+}
+
+void TestGpuTopology::testEnumerate()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString root = dir.path();
+    const QString drm = root + QStringLiteral("/drm");
+
+    QVERIFY(GpuTopology::enumerate(drm, QStringLiteral("/dev/dri")).isEmpty());
+
+    // APU at 0000:0c:00.0, discrete card at 0000:03:00.0, a connector and a display-only card
+    QVERIFY(addCard(root, 0, QStringLiteral("0000:0c:00.0"), "0x1002", "0x15bf", "536870912"));
+    QVERIFY(addCard(root, 1, QStringLiteral("0000:03:00.0"), "0x1002", "0x73BF", "17163091968"));
+    QVERIFY(writeFile(root + QStringLiteral("/devices/pci0000:00/0000:0c:00.0/boot_vga"), "1\n"));
+    QVERIFY(QDir().mkpath(drm + QStringLiteral("/card1-DP-1")));
+    QVERIFY(QDir().mkpath(drm + QStringLiteral("/card2/device")));
+
+    const QList<GpuTopology::Gpu> gpus = GpuTopology::enumerate(drm, QStringLiteral("/dev/dri"));
+    QCOMPARE(gpus.size(), 2);
+
+    // Discrete first
+    QCOMPARE(gpus[0].pciAddress, QStringLiteral("0000:03:00.0"));
+    QCOMPARE(gpus[0].vkDevice(), QStringLiteral("1002:73bf"));
+    QCOMPARE(gpus[0].renderNode, QStringLiteral("/dev/dri/renderD129"));
+    QCOMPARE(gpus[0].name, QStringLiteral("AMD 73bf"));
+    QCOMPARE(gpus[0].gpuClass, RenderBudget::GpuClass::Discrete);
+    QVERIFY(!gpus[0].bootVga);
+
+    QCOMPARE(gpus[1].pciAddress, QStringLiteral("0000:0c:00.0"));
+    QCOMPARE(gpus[1].renderNode, QStringLiteral("/dev/dri/renderD128"));
+    QCOMPARE(gpus[1].gpuClass, RenderBudget::GpuClass::Integrated);
+    QVERIFY(gpus[1].bootVga);
+
+    QCOMPARE(GpuTopology::indexOf(gpus, QStringLiteral("0000:0c:00.0")), 1);
+    QCOMPARE(GpuTopology::indexOf(gpus, QStringLiteral("0000:04:00.0")), -1);
+    QCOMPARE(GpuTopology::indexOf(gpus, GpuTopology::AUTO), -1);
+}
+
+void TestGpuTopology::testPrimeTag()
+{
+    QCOMPARE(gpu(QStringLiteral("0000:03:00.0"), RenderBudget::GpuClass::Discrete).primeTag(),
+             QStringLiteral("pci-0000_03_00_0"));
+}
+
+void TestGpuTopology::testHasTwin()
+{
+    const GpuTopology::Gpu first = gpu(QStringLiteral("0000:03:00.0"), RenderBudget::GpuClass::Discrete);
+    const GpuTopology::Gpu twin = gpu(QStringLiteral("0000:03:00.1"), RenderBudget::GpuClass::Discrete);
+    const GpuTopology::Gpu other = gpu(QStringLiteral("0000:04:00.0"), RenderBudget::GpuClass::Discrete);
+
+    QVERIFY(!GpuTopology::hasTwin({first, other}, first));
+    QVERIFY(GpuTopology::hasTwin({first, twin, other}, first));
+    QVERIFY(!GpuTopology::hasTwin({first, twin, other}, other));
+}
+
+void TestGpuTopology::testCanAccess()
+{
+    if (getuid() == 0) {
+        QSKIP("root can open anything");
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString node = dir.filePath(QStringLiteral("renderD128"));
+    QVERIFY(writeFile(node, QByteArray()));
+
+    UserEntry owner;
+    owner.uid = getuid();
+    owner.gid = getgid();
+    UserEntry member;
+    member.uid = getuid() + 1;
+    member.gid = getgid() + 1;
+    member.groups = {getgid()};
+    UserEntry stranger;
+    stranger.uid = getuid() + 2;
+    stranger.gid = getgid() + 2;
+
+    QVERIFY(QFile::setPermissions(node, QFile::ReadOwner | QFile::WriteOwner));
+    QVERIFY(GpuTopology::canAccess(node, owner));
+    QVERIFY(!GpuTopology::canAccess(node, member));
+    QVERIFY(!GpuTopology::canAccess(node, stranger));
+
+    // Group "render" style
+    QVERIFY(QFile::setPermissions(node, QFile::ReadOwner | QFile::WriteOwner | QFile::ReadGroup | QFile::WriteGroup));
+    QVERIFY(GpuTopology::canAccess(node, member));
+    QVERIFY(!GpuTopology::canAccess(node, stranger));
+
+    // Read-only for others isn't enough
+    QVERIFY(QFile::setPermissions(node, QFile::ReadOwner | QFile::WriteOwner | QFile::ReadOther));
+    QVERIFY(!GpuTopology::canAccess(node, stranger));
+    QVERIFY(QFile::setPermissions(node, QFile::ReadOwner | QFile::WriteOwner | QFile::ReadOther | QFile::WriteOther));
+    QVERIFY(GpuTopology::canAccess(node, stranger));
+
+    QVERIFY(!GpuTopology::canAccess(dir.filePath(QStringLiteral("renderD129")), owner));
+}
+
+void TestGpuTopology::testBalance()
+{
+    const GpuTopology::Gpu discrete = gpu(QStringLiteral("0000:03:00.0"), RenderBudget::GpuClass::Discrete);
+    const GpuTopology::Gpu integrated = gpu(QStringLiteral("0000:0c:00.0"), RenderBudget::GpuClass::Integrated);
+    const QStringList all(5, GpuTopology::AUTO);
+    const QList<double> loads(5, 124.0);
+
+    // One GPU: leave the choice to the drivers
+    QCOMPARE(GpuTopology::balance({discrete}, all, loads), QStringList(5));
+
+    // Five 1080p60 players: a quarter of the discrete card's budget fits one of them
+    const QStringList placement = GpuTopology::balance({discrete, integrated}, all, loads);
+    QCOMPARE(placement.count(discrete.pciAddress), 4);
+    QCOMPARE(placement.count(integrated.pciAddress), 1);
+
+    // Two equal cards split evenly; the heavy player gets one to itself
+    const GpuTopology::Gpu second = gpu(QStringLiteral("0000:04:00.0"), RenderBudget::GpuClass::Discrete);
+    const QStringList uneven = GpuTopology::balance({discrete, second}, QStringList(3, GpuTopology::AUTO),
+                                                    {60.0, 500.0, 60.0});
+    QCOMPARE(uneven[0], uneven[2]);
+    QVERIFY(uneven[0] != uneven[1]);
+
+    // Players left on the default stay there
+    QCOMPARE(GpuTopology::balance({discrete, integrated}, {QString(), GpuTopology::AUTO}, {124.0, 124.0}),
+             QStringList({QString(), discrete.pciAddress}));
+}
+
+void TestGpuTopology::testBalancePinned()
+{
+    const GpuTopology::Gpu first = gpu(QStringLiteral("0000:03:00.0"), RenderBudget::GpuClass::Discrete);
+    const GpuTopology::Gpu second = gpu(QStringLiteral("0000:04:00.0"), RenderBudget::GpuClass::Discrete);
+
+    // The pinned player's load counts: the automatic one goes to the other card
+    QCOMPARE(GpuTopology::balance({first, second}, {first.pciAddress, GpuTopology::AUTO}, {124.0, 124.0}),
+             QStringList({first.pciAddress, second.pciAddress}));
+
+    // A pinned card that is gone is placed automatically
+    QCOMPARE(GpuTopology::balance({first, second}, {first.pciAddress, QStringLiteral("0000:05:00.0")}, {124.0, 124.0}),
+             QStringList({first.pciAddress, second.pciAddress}));
+}
+
+void TestGpuTopology::testBalanceUsable()
+{
+    const GpuTopology::Gpu discrete = gpu(QStringLiteral("0000:03:00.0"), RenderBudget::GpuClass::Discrete);
+    const GpuTopology::Gpu integrated = gpu(QStringLiteral("0000:0c:00.0"), RenderBudget::GpuClass::Integrated);
+
+    // Player 1 can only open the integrated GPU; player 2 none at all
+    auto usable = [&](int i, const GpuTopology::Gpu &candidate) {
+        return i == 0 ? candidate.pciAddress == integrated.pciAddress : i != 1;
+    };
+    QCOMPARE(GpuTopology::balance({discrete, integrated}, QStringList(3, GpuTopology::AUTO), {124.0, 124.0, 124.0},
+                                  usable),
+             QStringList({integrated.pciAddress, QString(), discrete.pciAddress}));
+}
+
+QTEST_MAIN(TestGpuTopology)
+#include "test_gputopology.moc"
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QTest>
+
+#include "DeviceManager.h"
+#include "InputDeviceScanner.h"
+
+// Blocks as captured from /proc/bus/input/devices on a desktop running
+// Steam and Sunshine; %EV% is replaced by the event number, %JS% by a js index
+static const char *const CAPTURED_BLOCKS[] = {
+    "I: Bus=0019 Vendor=0000 Product=0001 Version=0000\n"
+    "N: Name=\"Power Button\"\n"
+    "P: Phys=PNP0C0C/button/input0\n"
+    "S: Sysfs=/devices/LNXSYSTM:00/LNXSYBUS:00/PNP0C0C:00/input/input0\n"
+    "U: Uniq=\n"
+    "H: Handlers=kbd event%EV% \n"
+    "B: PROP=0\n"
+    "B: EV=3\n"
+    "B: KEY=10000000000000 0\n",
+
+    "I: Bus=0003 Vendor=046d Product=c52b Version=0111\n"
+    "N: Name=\"Logitech USB Receiver Mouse\"\n"
+    "P: Phys=usb-0000:00:14.0-3/input1\n"
+    "S: Sysfs=/devices/pci0000:00/0000:00:14.0/usb1/1-3/1-3:1.1/0003:046D:C52B.0002/input/input5\n"
+    "U: Uniq=\n"
+    "H: Handlers=mouse0 event%EV% \n"
+    "B: PROP=0\n"
+    "B: EV=17\n"
+    "B: KEY=ffff0000 0 0 0 0\n"
+    "B: REL=1943\n"
+    "B: MSC=10\n",
+
+    "I: Bus=0003 Vendor=045e Product=028e Version=0114\n"
+    "N: Name=\"Microsoft X-Box 360 pad\"\n"
+    "P: Phys=usb-0000:00:14.0-2/input0\n"
+    "S: Sysfs=/devices/pci0000:00/0000:00:14.0/usb1/1-2/1-2:1.0/input/input23\n"
+    "U: Uniq=\n"
+    "H: Handlers=event%EV% js%JS% \n"
+    "B: PROP=0\n"
+    "B: EV=20000b\n"
+    "B: KEY=7cdb000000000000 0 0 0 0\n"
+    "B: ABS=3003f\n"
+    "B: FF=107030000 0\n",
+
+    "I: Bus=0003 Vendor=28de Product=11ff Version=0001\n"
+    "N: Name=\"Microsoft X-Box 360 pad 0\"\n"
+    "P: Phys=\n"
+    "S: Sysfs=/devices/virtual/input/input40\n"
+    "U: Uniq=\n"
+    "H: Handlers=event%EV% js%JS% \n"
+    "B: PROP=0\n"
+    "B: EV=20000b\n"
+    "B: KEY=7cdb000000000000 0 0 0 0\n"
+    "B: ABS=3003f\n",
+
+    "I: Bus=0006 Vendor=beef Product=dead Version=0111\n"
+    "N: Name=\"Keyboard passthrough\"\n"
+    "P: Phys=\n"
+    "S: Sysfs=/devices/virtual/input/input52\n"
+    "U: Uniq=\n"
+    "H: Handlers=sysrq kbd leds event%EV% \n"
+    "B: PROP=0\n"
+    "B: EV=120013\n"
+    "B: KEY=1000000000007 ff9f207ac14057ff febeffdfffefffff fffffffffffffffe\n"
+    "B: MSC=10\n"
+    "B: LED=7\n",
+};
+
+// Event numbers start high so type probing never opens a real device node
+static constexpr int FIRST_EVENT = 1000;
+
+static QByteArray capturedDump(int deviceCount)
+{
+    QByteArray dump;
+    const int blockCount = int(sizeof(CAPTURED_BLOCKS) / sizeof(CAPTURED_BLOCKS[0]));
+    for (int i = 0; i < deviceCount; ++i) {
+        QByteArray block(CAPTURED_BLOCKS[i % blockCount]);
+        block.replace("%EV%", QByteArray::number(FIRST_EVENT + i));
+        block.replace("%JS%", QByteArray::number(i / blockCount));
+        dump += block;
+        dump += '\n';
+    }
+    return dump;
+}
+
+class TestInputDeviceScanner : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testScanFields();
+    void testScanSkipsIncompleteBlocks();
+    void testScanWithoutTrailingNewline();
+    void testParseNumber();
+    void testParseProcDevices();
+    void testParseProcDevicesReusesUnchangedBlocks();
+
+    void benchmarkScan_data();
+    void benchmarkScan();
+    void benchmarkParseProcDevices_data();
+    void benchmarkParseProcDevices();
+};
+
+void TestInputDeviceScanner::testScanFields()
+{
+    const QByteArray dump = capturedDump(5);
+    QList<ProcInputRecord> records;
+    InputDeviceScanner::scan(dump, [&](const ProcInputRecord &record) {
+        records.append(record);
+    });
+
+    QCOMPARE(records.size(), 5);
+
+    const ProcInputRecord &pad = records[2];
+    QCOMPARE(pad.name.toByteArray(), QByteArray("Microsoft X-Box 360 pad"));
+    QCOMPARE(pad.phys.toByteArray(), QByteArray("usb-0000:00:14.0-2/input0"));
+    QCOMPARE(pad.vendor.toByteArray(), QByteArray("045e"));
+    QCOMPARE(pad.product.toByteArray(), QByteArray("028e"));
+    QCOMPARE(pad.eventNumber, FIRST_EVENT + 2);
+    QCOMPARE(pad.joyNumber, 0);
+    QVERIFY(pad.block.startsWith("I: Bus=0003 Vendor=045e"));
+    QVERIFY(pad.block.endsWith("B: FF=107030000 0\n"));
+
+    const ProcInputRecord &keyboard = records[4];
+    QCOMPARE(keyboard.eventNumber, FIRST_EVENT + 4);
+    QCOMPARE(keyboard.joyNumber, -1);
+    QVERIFY(keyboard.phys.isEmpty());
+    QCOMPARE(keyboard.handlers.toByteArray(), QByteArray("sysrq kbd leds event1004 "));
+}
+
+void TestInputDeviceScanner::testScanSkipsIncompleteBlocks()
+{
+    const QByteArray dump =
+        "I: Bus=0000 Vendor=0000 Product=0000 Version=0000\n"
+        "N: Name=\"No event handler\"\n"
+        "H: Handlers=kbd \n"
+        "\n"
+        "I: Bus=0000 Vendor=0000 Product=0000 Version=0000\n"
+        "H: Handlers=event7 \n"
+        "\n";
+
+    int count = 0;
+    InputDeviceScanner::scan(dump, [&](const ProcInputRecord &) {
+        ++count;
+    });
+    QCOMPARE(count, 0);
+}
+
+void TestInputDeviceScanner::testScanWithoutTrailingNewline()
+{
+    const QByteArray dump =
+        "I: Bus=0003 Vendor=054c Product=0ce6 Version=8111\n"
+        "N: Name=\"Sony Interactive Entertainment Wireless Controller\"\n"
+        "H: Handlers=event12 js1";
+
+    QList<int> events;
+    InputDeviceScanner::scan(dump, [&](const ProcInputRecord &record) {
+        events.append(record.eventNumber);
+        QCOMPARE(record.joyNumber, 1);
+        QCOMPARE(record.vendor.toByteArray(), QByteArray("054c"));
+    });
+    QCOMPARE(events, QList<int>{12});
+}
+
+void TestInputDeviceScanner::testParseNumber()
+{
+    QCOMPARE(InputDeviceScanner::parseNumber("0"), 0);
+    QCOMPARE(InputDeviceScanner::parseNumber("417"), 417);
+    QCOMPARE(InputDeviceScanner::parseNumber(""), -1);
+    QCOMPARE(InputDeviceScanner::parseNumber("12a"), -1);
+    QCOMPARE(InputDeviceScanner::parseNumber("-3"), -1);
+}
+
+void TestInputDeviceScanner::testParseProcDevices()
+{
+    DeviceManager manager;
+    QList<InputDevice> devices;
+    manager.parseProcDevices(capturedDump(5), devices);
+
+    QCOMPARE(devices.size(), 5);
+    QCOMPARE(devices[0].name, QStringLiteral("Power Button"));
+    QCOMPARE(devices[0].type, QStringLiteral("other"));
+    QVERIFY(devices[0].isInternal);
+    QCOMPARE(devices[1].type, QStringLiteral("mouse"));
+    QCOMPARE(devices[1].path, QStringLiteral("/dev/input/event1001"));
+    QVERIFY(devices[1].joyPath.isEmpty());
+    QCOMPARE(devices[2].type, QStringLiteral("controller"));
+    QCOMPARE(devices[2].joyPath, QStringLiteral("/dev/input/js0"));
+    QCOMPARE(devices[2].stableId, QStringLiteral("045e:028e:usb-0000:00:14.0-2/input0"));
+    QVERIFY(!devices[2].isVirtual);
+    QVERIFY(devices[3].isVirtual);
+    QCOMPARE(devices[4].type, QStringLiteral("keyboard"));
+}
+
+void TestInputDeviceScanner::testParseProcDevicesReusesUnchangedBlocks()
+{
+    DeviceManager manager;
+    QList<InputDevice> first;
+    manager.parseProcDevices(capturedDump(5), first);
+
+    QList<InputDevice> second;
+    manager.parseProcDevices(capturedDump(5), second);
+    QCOMPARE(second.size(), first.size());
+
+    // Reused entries share their string storage with the previous scan
+    for (int i = 0; i < first.size(); ++i) {
+        QCOMPARE(second[i].name.constData(), first[i].name.constData());
+        QCOMPARE(second[i].stableId, first[i].stableId);
+    }
+
+    // A changed block is decoded again
+    QByteArray changed = capturedDump(5);
+    changed.replace("Logitech USB Receiver Mouse", "Logitech G Pro Mouse");
+    QList<InputDevice> third;
+    manager.parseProcDevices(changed, third);
+    QCOMPARE(third[1].name, QStringLiteral("Logitech G Pro Mouse"));
+    QCOMPARE(third[0].name.constData(), first[0].name.constData());
+}
+
+void TestInputDeviceScanner::benchmarkScan_data()
+{
+    QTest::addColumn<int>("deviceCount");
+    QTest::newRow("50 devices") << 50;
+    QTest::newRow("200 devices") << 200;
+    QTest::newRow("500 devices") << 500;
+}
+
+void TestInputDeviceScanner::benchmarkScan()
+{
+    QFETCH(int, deviceCount);
+    const QByteArray dump = capturedDump(deviceCount);
+
+    int count = 0;
+    QBENCHMARK {
+        count = 0;
+        InputDeviceScanner::scan(dump, [&](const ProcInputRecord &) {
+            ++count;
+        });
+    }
+    QCOMPARE(count, deviceCount);
+}
+
+void TestInputDeviceScanner::benchmarkParseProcDevices_data()
+{
+    QTest::addColumn<int>("deviceCount");
+    QTest::addColumn<bool>("warm");
+    QTest::newRow("50 devices, cold") << 50 << false;
+    QTest::newRow("50 devices, rescan") << 50 << true;
+    QTest::newRow("500 devices, cold") << 500 << false;
+    QTest::newRow("500 devices, rescan") << 500 << true;
+}
+
+void TestInputDeviceScanner::benchmarkParseProcDevices()
+{
+    QFETCH(int, deviceCount);
+    QFETCH(bool, warm);
+    const QByteArray dump = capturedDump(deviceCount);
+
+    // Cold runs alternate between two dumps differing in every block, so
+    // nothing can be reused from the previous scan
+    QByteArray other = dump;
+    other.replace("B: PROP=0", "B: PROP=1");
+
+    DeviceManager manager;
+    QList<InputDevice> devices;
+    manager.parseProcDevices(dump, devices);
+
+    bool flip = false;
+    QBENCHMARK {
+        flip = !flip;
+        devices.clear();
+        manager.parseProcDevices(warm || !flip ? dump : other, devices);
+    }
+    QCOMPARE(devices.size(), deviceCount);
+}
+
+QTEST_MAIN(TestInputDeviceScanner)
+#include "test_inputdevicescanner.moc"
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QTest>
+
+#include "InputLatencyMonitor.h"
+
+class TestInputLatencyMonitor : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testPercentile();
+    void testNoReports();
+    void testReportIntervals();
+    void testIdleGapsIgnored();
+    void testDevicesGroupedByPlayer();
+    void testSampleRingWraps();
+    void testWatchMissingDevice();
+};
+
+void TestInputLatencyMonitor::testPercentile()
+{
+    QList<qint64> empty;
+    QCOMPARE(InputLatencyMonitor::percentile(empty, 0.5), qint64(0));
+
+    QList<qint64> samples{5, 1, 4, 2, 3, 10, 9, 8, 7, 6};
+    QCOMPARE(InputLatencyMonitor::percentile(samples, 0.5), qint64(5));
+    QCOMPARE(InputLatencyMonitor::percentile(samples, 0.99), qint64(10));
+    QCOMPARE(InputLatencyMonitor::percentile(samples, 0.0), qint64(1));
+}
+
+void TestInputLatencyMonitor::testNoReports()
+{
+    InputLatencyMonitor monitor;
+    monitor.track(QStringLiteral("/dev/input/event1000"), 0);
+    monitor.setFrameInterval(0, 16667);
+
+    const QVariantList stats = monitor.stats();
+    QCOMPARE(stats.size(), 1);
+    const QVariantMap player = stats.first().toMap();
+    QCOMPARE(player.value(QStringLiteral("devices")).toInt(), 1);
+    QCOMPARE(player.value(QStringLiteral("reportRateHz")).toInt(), 0);
+    QCOMPARE(player.value(QStringLiteral("events")).toULongLong(), 0ULL);
+}
+
+void TestInputLatencyMonitor::testReportIntervals()
+{
+    InputLatencyMonitor monitor;
+    const QString path = QStringLiteral("/dev/input/event1000");
+    monitor.track(path, 0);
+    monitor.setFrameInterval(0, 16000);
+
+    // 8 ms polling (125 Hz) with one slow report
+    qint64 timestamp = 1000000;
+    for (int i = 0; i < 199; ++i) {
+        monitor.recordReport(path, timestamp, 2);
+        timestamp += 8000;
+    }
+    monitor.recordReport(path, timestamp + 24000, 2);
+
+    const QVariantMap player = monitor.stats().first().toMap();
+    QCOMPARE(player.value(QStringLiteral("events")).toULongLong(), 400ULL);
+    QCOMPARE(player.value(QStringLiteral("reportIntervalP50Ms")).toDouble(), 8.0);
+    QCOMPARE(player.value(QStringLiteral("reportIntervalP99Ms")).toDouble(), 8.0);
+    QCOMPARE(player.value(QStringLiteral("frameIntervalMs")).toDouble(), 16.0);
+    QCOMPARE(player.value(QStringLiteral("inputToPhotonP50Ms")).toDouble(), 4.0 + 24.0);
+    QCOMPARE(player.value(QStringLiteral("inputToPhotonP99Ms")).toDouble(), 8.0 + 32.0);
+    QVERIFY(player.value(QStringLiteral("reportRateHz")).toInt() <= 125);
+    QVERIFY(player.value(QStringLiteral("reportRateHz")).toInt() > 110);
+}
+
+void TestInputLatencyMonitor::testIdleGapsIgnored()
+{
+    InputLatencyMonitor monitor;
+    const QString path = QStringLiteral("/dev/input/event1000");
+    monitor.track(path, 0);
+
+    monitor.recordReport(path, 0, 1);
+    monitor.recordReport(path, 1000, 1);
+    monitor.recordReport(path, 1000 + InputLatencyMonitor::IDLE_GAP_US + 1, 1);
+    monitor.recordReport(path, 3000 + InputLatencyMonitor::IDLE_GAP_US + 1, 1);
+
+    const QVariantMap player = monitor.stats().first().toMap();
+    QCOMPARE(player.value(QStringLiteral("reportIntervalP99Ms")).toDouble(), 2.0);
+    QCOMPARE(player.value(QStringLiteral("reportIntervalP50Ms")).toDouble(), 1.0);
+}
+
+void TestInputLatencyMonitor::testDevicesGroupedByPlayer()
+{
+    InputLatencyMonitor monitor;
+    monitor.track(QStringLiteral("/dev/input/event1000"), 1);
+    monitor.track(QStringLiteral("/dev/input/event1001"), 0);
+    monitor.track(QStringLiteral("/dev/input/event1002"), 1);
+
+    const QVariantList stats = monitor.stats();
+    QCOMPARE(stats.size(), 2);
+    QCOMPARE(stats[0].toMap().value(QStringLiteral("instanceIndex")).toInt(), 0);
+    QCOMPARE(stats[0].toMap().value(QStringLiteral("devices")).toInt(), 1);
+    QCOMPARE(stats[1].toMap().value(QStringLiteral("instanceIndex")).toInt(), 1);
+    QCOMPARE(stats[1].toMap().value(QStringLiteral("devices")).toInt(), 2);
+
+    monitor.unwatch(QStringLiteral("/dev/input/event1001"));
+    QCOMPARE(monitor.stats().size(), 1);
+    QVERIFY(!monitor.isWatching(QStringLiteral("/dev/input/event1001")));
+}
+
+void TestInputLatencyMonitor::testSampleRingWraps()
+{
+    InputLatencyMonitor monitor;
+    const QString path = QStringLiteral("/dev/input/event1000");
+    monitor.track(path, 0);
+
+    // Old 4 ms samples are pushed out by newer 1 ms ones
+    qint64 timestamp = 0;
+    monitor.recordReport(path, timestamp, 1);
+    for (int i = 0; i < InputLatencyMonitor::MAX_SAMPLES; ++i) {
+        timestamp += 4000;
+        monitor.recordReport(path, timestamp, 1);
+    }
+    for (int i = 0; i < InputLatencyMonitor::MAX_SAMPLES; ++i) {
+        timestamp += 1000;
+        monitor.recordReport(path, timestamp, 1);
+    }
+
+    const QVariantMap player = monitor.stats().first().toMap();
+    QCOMPARE(player.value(QStringLiteral("reportIntervalP99Ms")).toDouble(), 1.0);
+    QCOMPARE(player.value(QStringLiteral("reportRateHz")).toInt(), 1000);
+}
+
+void TestInputLatencyMonitor::testWatchMissingDevice()
+{
+    InputLatencyMonitor monitor;
+    QVERIFY(!monitor.watch(QStringLiteral("/dev/input/event99999"), 0));
+    QVERIFY(!monitor.isWatching(QStringLiteral("/dev/input/event99999")));
+    QVERIFY(monitor.stats().isEmpty());
+}
+
+QTEST_MAIN(TestInputLatencyMonitor)
+#include "test_inputlatencymonitor.moc"
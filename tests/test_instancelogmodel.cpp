@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QSignalSpy>
+#include <QTest>
+
+#include "InstanceLogModel.h"
+
+class MockLogHelperClient : public CouchPlayHelperClient
+{
+    Q_OBJECT
+
+public:
+    struct Read {
+        QString username;
+        QString cursor;
+        int maxLines = 0;
+    };
+
+    QList<Read> reads;
+    QVariantList nextEntries;
+
+    explicit MockLogHelperClient(QObject *parent = nullptr)
+        : CouchPlayHelperClient(parent)
+    {
+        m_available = true;
+    }
+
+    QDBusPendingReply<QVariantMap> readInstanceLogAsync(const QString &username, const QString &cursor,
+                                                        int maxLines) override
+    {
+        reads.append({username, cursor, maxLines});
+        QVariantMap result;
+        result[QStringLiteral("entries")] = nextEntries;
+        result[QStringLiteral("cursor")] = nextEntries.isEmpty() ? cursor
+                                                                 : QStringLiteral("c%1").arg(reads.size());
+        nextEntries.clear();
+        return completedCall(result);
+    }
+};
+
+class TestInstanceLogModel : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testInactiveReadsNothing();
+    void testTailsFromCursor();
+    void testBatchesAndBounds();
+    void testUsernameChangeResets();
+
+private:
+    static QVariantList entries(int first, int count);
+};
+
+QVariantList TestInstanceLogModel::entries(int first, int count)
+{
+    QVariantList list;
+    for (int i = first; i < first + count; ++i) {
+        list.append(QVariantMap{
+            {QStringLiteral("message"), QStringLiteral("line %1").arg(i)},
+            {QStringLiteral("timestamp"), qint64(1700000000000) + i},
+            {QStringLiteral("priority"), 6},
+        });
+    }
+    return list;
+}
+
+void TestInstanceLogModel::testInactiveReadsNothing()
+{
+    MockLogHelperClient client;
+    InstanceLogModel model;
+    model.setHelperClient(&client);
+    model.setUsername(QStringLiteral("player2"));
+    QTest::qWait(50);
+    QVERIFY(client.reads.isEmpty());
+}
+
+void TestInstanceLogModel::testTailsFromCursor()
+{
+    MockLogHelperClient client;
+    InstanceLogModel model;
+    model.setHelperClient(&client);
+    model.setUsername(QStringLiteral("player2"));
+
+    client.nextEntries = entries(0, 3);
+    model.setActive(true);
+    QTRY_COMPARE(model.count(), 3);
+    QCOMPARE(client.reads.first().username, QStringLiteral("player2"));
+    QVERIFY(client.reads.first().cursor.isEmpty());
+    QCOMPARE(client.reads.first().maxLines, InstanceLogModel::DEFAULT_MAX_LINES);
+    QCOMPARE(model.data(model.index(2), InstanceLogModel::MessageRole).toString(), QStringLiteral("line 2"));
+    QCOMPARE(model.data(model.index(2), InstanceLogModel::TimestampRole).toLongLong(), qint64(1700000000002));
+
+    // The next poll continues after the last entry
+    client.nextEntries = entries(3, 1);
+    QTRY_COMPARE_WITH_TIMEOUT(model.count(), 4, InstanceLogModel::POLL_INTERVAL_MS * 3);
+    QCOMPARE(client.reads.at(1).cursor, QStringLiteral("c1"));
+
+    // Stopped: no more reads
+    model.setActive(false);
+    const qsizetype reads = client.reads.size();
+    QTest::qWait(InstanceLogModel::POLL_INTERVAL_MS + 200);
+    QCOMPARE(client.reads.size(), reads);
+}
+
+void TestInstanceLogModel::testBatchesAndBounds()
+{
+    InstanceLogModel model;
+    model.setMaxLines(5);
+
+    QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+
+    model.append(entries(0, 3));
+    QCOMPARE(model.count(), 3);
+    QCOMPARE(inserted.count(), 1);
+    QCOMPARE(removed.count(), 0);
+
+    // One removal from the top, one insertion at the end
+    model.append(entries(3, 4));
+    QCOMPARE(model.count(), 5);
+    QCOMPARE(inserted.count(), 2);
+    QCOMPARE(removed.count(), 1);
+    QCOMPARE(model.data(model.index(0), InstanceLogModel::MessageRole).toString(), QStringLiteral("line 2"));
+    QCOMPARE(model.data(model.index(4), InstanceLogModel::MessageRole).toString(), QStringLiteral("line 6"));
+
+    // A burst larger than the model keeps its newest lines
+    model.append(entries(100, 20));
+    QCOMPARE(model.count(), 5);
+    QCOMPARE(model.data(model.index(0), InstanceLogModel::MessageRole).toString(), QStringLiteral("line 115"));
+    QCOMPARE(model.text().split(QLatin1Char('\n')).size(), 5);
+
+    model.clear();
+    QCOMPARE(model.count(), 0);
+}
+
+void TestInstanceLogModel::testUsernameChangeResets()
+{
+    MockLogHelperClient client;
+    InstanceLogModel model;
+    model.setHelperClient(&client);
+    model.setUsername(QStringLiteral("player2"));
+    client.nextEntries = entries(0, 2);
+    model.setActive(true);
+    QTRY_COMPARE(model.count(), 2);
+
+    model.setUsername(QStringLiteral("player3"));
+    QCOMPARE(model.count(), 0);
+    QCOMPARE(client.reads.last().username, QStringLiteral("player3"));
+    QVERIFY(client.reads.last().cursor.isEmpty());
+}
+
+QTEST_MAIN(TestInstanceLogModel)
+#include "test_instancelogmodel.moc"
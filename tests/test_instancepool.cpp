@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "InstancePool.h"
+
+#include <pwd.h>
+#include <unistd.h>
+
+class TestInstancePool : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testLaunchKeyIgnoresPosition();
+    void testLaunchKeyTracksCommandLine();
+    void testAddMatchTake();
+    void testWindowIds();
+    void testDisableClearsEntries();
+    void testUserMemoryBytes();
+    void testMemoryLimitEvicts();
+
+private:
+    static QVariantMap baseConfig();
+    static bool writeMemoryCurrent(const QString &root, uid_t uid, qint64 bytes);
+};
+
+QVariantMap TestInstancePool::baseConfig()
+{
+    QVariantMap config;
+    config[QStringLiteral("username")] = QStringLiteral("player2");
+    config[QStringLiteral("internalWidth")] = 960;
+    config[QStringLiteral("internalHeight")] = 1080;
+    config[QStringLiteral("outputWidth")] = 960;
+    config[QStringLiteral("outputHeight")] = 1080;
+    config[QStringLiteral("positionX")] = 0;
+    config[QStringLiteral("positionY")] = 0;
+    config[QStringLiteral("presetCommand")] = QStringLiteral("steam -tenfoot -steamdeck");
+    return config;
+}
+
+bool TestInstancePool::writeMemoryCurrent(const QString &root, uid_t uid, qint64 bytes)
+{
+    const QString dir = QStringLiteral("%1/user.slice/user-%2.slice").arg(root).arg(uid);
+    if (!QDir().mkpath(dir)) {
+        return false;
+    }
+    QFile file(dir + QStringLiteral("/memory.current"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    file.write(QByteArray::number(bytes) + '\n');
+    return true;
+}
+
+void TestInstancePool::testLaunchKeyIgnoresPosition()
+{
+    QVariantMap left = baseConfig();
+    QVariantMap right = baseConfig();
+    right[QStringLiteral("positionX")] = 960;
+
+    QCOMPARE(InstancePool::launchKey(left), InstancePool::launchKey(right));
+}
+
+void TestInstancePool::testLaunchKeyTracksCommandLine()
+{
+    const QString key = InstancePool::launchKey(baseConfig());
+
+    QVariantMap resized = baseConfig();
+    resized[QStringLiteral("outputWidth")] = 1920;
+    QVERIFY(InstancePool::launchKey(resized) != key);
+
+    QVariantMap otherUser = baseConfig();
+    otherUser[QStringLiteral("username")] = QStringLiteral("player3");
+    QVERIFY(InstancePool::launchKey(otherUser) != key);
+
+    QVariantMap otherCommand = baseConfig();
+    otherCommand[QStringLiteral("presetCommand")] = QStringLiteral("lutris");
+    QVERIFY(InstancePool::launchKey(otherCommand) != key);
+}
+
+void TestInstancePool::testAddMatchTake()
+{
+    InstancePool pool;
+    pool.setEnabled(true);
+    QSignalSpy evictedSpy(&pool, &InstancePool::evicted);
+
+    pool.add(0, QStringLiteral("player1"), QStringLiteral("key-a"));
+    QCOMPARE(pool.count(), 1);
+    QVERIFY(pool.matches(0, QStringLiteral("key-a")));
+    QVERIFY(!pool.matches(0, QStringLiteral("key-b")));
+    QVERIFY(!pool.matches(1, QStringLiteral("key-a")));
+    QVERIFY(!pool.isLaunched(0));
+
+    // Replacing an entry evicts the old one
+    pool.add(0, QStringLiteral("player1"), QStringLiteral("key-b"));
+    QCOMPARE(evictedSpy.count(), 1);
+    QCOMPARE(pool.count(), 1);
+    QVERIFY(pool.matches(0, QStringLiteral("key-b")));
+
+    // Taking hands the entry over without evicting it
+    QVERIFY(!pool.take(0));
+    QCOMPARE(pool.count(), 0);
+    QCOMPARE(evictedSpy.count(), 1);
+    QVERIFY(!pool.take(0));
+}
+
+void TestInstancePool::testWindowIds()
+{
+    InstancePool pool;
+    pool.add(0, QStringLiteral("player1"), QStringLiteral("a"));
+    pool.add(1, QStringLiteral("player2"), QStringLiteral("b"));
+    QVERIFY(pool.windowIds().isEmpty());
+
+    pool.setWindowId(1, QStringLiteral("{window-1}"));
+    pool.setWindowId(5, QStringLiteral("{window-5}"));  // No entry, ignored
+    QCOMPARE(pool.windowId(1), QStringLiteral("{window-1}"));
+    QCOMPARE(pool.windowIds(), QStringList({QStringLiteral("{window-1}")}));
+
+    pool.evict(1, QStringLiteral("test"));
+    QVERIFY(pool.windowIds().isEmpty());
+}
+
+void TestInstancePool::testDisableClearsEntries()
+{
+    InstancePool pool;
+    pool.setEnabled(true);
+    pool.add(0, QStringLiteral("player1"), QStringLiteral("a"));
+    pool.add(1, QStringLiteral("player2"), QStringLiteral("b"));
+
+    QSignalSpy evictedSpy(&pool, &InstancePool::evicted);
+    pool.setEnabled(false);
+    QCOMPARE(pool.count(), 0);
+    QCOMPARE(evictedSpy.count(), 2);
+    QCOMPARE(evictedSpy.first().at(1).toString(), QStringLiteral("player1"));
+}
+
+void TestInstancePool::testUserMemoryBytes()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+
+    QCOMPARE(InstancePool::userMemoryBytes(4242, root.path()), qint64(-1));
+    QVERIFY(writeMemoryCurrent(root.path(), 4242, 123456789));
+    QCOMPARE(InstancePool::userMemoryBytes(4242, root.path()), qint64(123456789));
+}
+
+void TestInstancePool::testMemoryLimitEvicts()
+{
+    struct passwd *pw = getpwuid(getuid());
+    if (!pw) {
+        QSKIP("Current user has no passwd entry");
+    }
+    const QString username = QString::fromLocal8Bit(pw->pw_name);
+
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    QVERIFY(writeMemoryCurrent(root.path(), pw->pw_uid, qint64(256) * 1024 * 1024));
+
+    InstancePool pool;
+    pool.setCgroupRoot(root.path());
+    pool.setMemoryLimitMb(512);
+    pool.add(0, username, QStringLiteral("a"));
+    QSignalSpy evictedSpy(&pool, &InstancePool::evicted);
+
+    pool.checkEntries();
+    QCOMPARE(pool.count(), 1);
+
+    QVERIFY(writeMemoryCurrent(root.path(), pw->pw_uid, qint64(768) * 1024 * 1024));
+    pool.checkEntries();
+    QCOMPARE(pool.count(), 0);
+    QCOMPARE(evictedSpy.count(), 1);
+    QVERIFY(evictedSpy.first().at(2).toString().startsWith(QStringLiteral("memory limit")));
+}
+
+QTEST_MAIN(TestInstancePool)
+#include "test_instancepool.moc"
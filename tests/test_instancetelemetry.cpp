@@ -0,0 +1,229 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "InstanceTelemetry.h"
+
+#include <unistd.h>
+
+class TestInstanceTelemetry : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+
+    void testProcessCounters();
+    void testDrmFdinfo();
+    void testSampleUnit();
+    void testHistoryRing();
+    void testParseStatsFps();
+    void testStatsPipe();
+
+private:
+    bool writeFile(const QString &path, const QByteArray &contents);
+    bool writeProcess(qint64 pid, qint64 ticks, qint64 rssPages);
+    bool writeDrmClient(qint64 pid, int fd, const QByteArray &clientId, qint64 gfxNs);
+    bool writeCpuStat(qint64 usageUs);
+
+    QScopedPointer<QTemporaryDir> m_proc;
+    QScopedPointer<QTemporaryDir> m_cgroupRoot;
+    const QString m_cgroup = QStringLiteral("/user.slice/user-1002.slice/couchplay-player2-1.service");
+};
+
+void TestInstanceTelemetry::init()
+{
+    m_proc.reset(new QTemporaryDir);
+    m_cgroupRoot.reset(new QTemporaryDir);
+    QVERIFY(m_proc->isValid());
+    QVERIFY(m_cgroupRoot->isValid());
+}
+
+bool TestInstanceTelemetry::writeFile(const QString &path, const QByteArray &contents)
+{
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(contents) == contents.size();
+}
+
+bool TestInstanceTelemetry::writeProcess(qint64 pid, qint64 ticks, qint64 rssPages)
+{
+    const QString dir = QStringLiteral("%1/%2").arg(m_proc->path()).arg(pid);
+    // Spaces and parentheses in the command name must not shift the fields
+    const QByteArray stat = QByteArray::number(pid) + " (game (x) y) S 1 1 1 0 -1 4194304 100 0 0 0 "
+        + QByteArray::number(ticks) + " 0 0 0 20 0 1 0\n";
+    return writeFile(dir + QStringLiteral("/stat"), stat)
+        && writeFile(dir + QStringLiteral("/statm"), "100000 " + QByteArray::number(rssPages) + " 500 1 0 3000 0\n")
+        && writeFile(dir + QStringLiteral("/cgroup"), "0::" + m_cgroup.toUtf8() + '\n');
+}
+
+bool TestInstanceTelemetry::writeDrmClient(qint64 pid, int fd, const QByteArray &clientId, qint64 gfxNs)
+{
+    const QString dir = QStringLiteral("%1/%2").arg(m_proc->path()).arg(pid);
+    const QString link = QStringLiteral("%1/fd/%2").arg(dir).arg(fd);
+    if (!QDir().mkpath(dir + QStringLiteral("/fd"))) {
+        return false;
+    }
+    if (!QFileInfo(link).isSymLink() && !QFile::link(QStringLiteral("/dev/dri/renderD128"), link)) {
+        return false;
+    }
+    const QByteArray fdinfo = "pos:\t0\nflags:\t02100002\ndrm-driver:\tamdgpu\ndrm-pdev:\t0000:03:00.0\n"
+        "drm-client-id:\t" + clientId + "\ndrm-engine-gfx:\t" + QByteArray::number(gfxNs) + " ns\n"
+        "drm-engine-compute:\t0 ns\ndrm-engine-capacity-gfx:\t1\ndrm-memory-vram:\t524288 KiB\n";
+    return writeFile(QStringLiteral("%1/fdinfo/%2").arg(dir).arg(fd), fdinfo);
+}
+
+bool TestInstanceTelemetry::writeCpuStat(qint64 usageUs)
+{
+    const QString dir = m_cgroupRoot->path() + m_cgroup;
+    return writeFile(dir + QStringLiteral("/cpu.stat"), "usage_usec " + QByteArray::number(usageUs) + "\nuser_usec 0\n")
+        && writeFile(dir + QStringLiteral("/memory.current"), "1073741824\n")
+        && writeFile(dir + QStringLiteral("/cgroup.procs"), "4242\n4243\n");
+}
+
+void TestInstanceTelemetry::testProcessCounters()
+{
+    QVERIFY(writeProcess(4242, 300, 2560));
+
+    QCOMPARE(InstanceTelemetry::processCpuTimeUs(4242, m_proc->path()), qint64(300) * 1000000 / sysconf(_SC_CLK_TCK));
+    QCOMPARE(InstanceTelemetry::processRssBytes(4242, m_proc->path()), qint64(2560) * sysconf(_SC_PAGESIZE));
+    QCOMPARE(InstanceTelemetry::processCpuTimeUs(4343, m_proc->path()), qint64(-1));
+    QCOMPARE(InstanceTelemetry::processRssBytes(4343, m_proc->path()), qint64(-1));
+}
+
+void TestInstanceTelemetry::testDrmFdinfo()
+{
+    QVERIFY(writeCpuStat(0));
+    QVERIFY(writeProcess(4242, 0, 1));
+    QVERIFY(writeProcess(4243, 0, 1));
+    QVERIFY(writeDrmClient(4242, 5, "17", 1000));
+    QVERIFY(writeDrmClient(4242, 6, "17", 1000));  // dup'ed fd, same client
+    QVERIFY(writeDrmClient(4243, 7, "18", 500));
+    QVERIFY(writeFile(m_proc->path() + QStringLiteral("/4242/fd/3"), "not a device"));
+
+    const QList<qint64> pids = DrmFdinfo::processTree(4242, m_proc->path(), m_cgroupRoot->path());
+    QCOMPARE(pids, QList<qint64>({4242, 4243}));
+    QCOMPARE(DrmFdinfo::processTree(4343, m_proc->path(), m_cgroupRoot->path()), QList<qint64>({4343}));
+
+    const DrmFdinfo usage = DrmFdinfo::read(pids, m_proc->path());
+    QCOMPARE(usage.clients, 2);
+    QCOMPARE(usage.engineNs.value(QStringLiteral("gfx")), qint64(1500));
+    QVERIFY(!usage.engineNs.contains(QStringLiteral("capacity-gfx")));
+    QCOMPARE(usage.memoryBytes, qint64(2) * 524288 * 1024);
+
+    // Survives the trip over the bus
+    const DrmFdinfo copy = DrmFdinfo::fromVariantMap(usage.toVariantMap());
+    QCOMPARE(copy.clients, usage.clients);
+    QCOMPARE(copy.engineNs, usage.engineNs);
+    QCOMPARE(copy.memoryBytes, usage.memoryBytes);
+}
+
+void TestInstanceTelemetry::testSampleUnit()
+{
+    QVERIFY(writeCpuStat(1000000));
+    QVERIFY(writeProcess(4242, 0, 1000));
+    QVERIFY(writeProcess(4243, 0, 24));
+    QVERIFY(writeDrmClient(4242, 5, "17", 1000000000));
+
+    InstanceTelemetry telemetry;
+    telemetry.setProcRoot(m_proc->path());
+    telemetry.setCgroupRoot(m_cgroupRoot->path());
+    telemetry.track(1, 4242);
+    QVERIFY(telemetry.isTracking(1));
+
+    telemetry.sampleAt(10000000);
+
+    // 1.5 s of CPU and 0.5 s of gfx engine time over 2 s
+    QVERIFY(writeCpuStat(2500000));
+    QVERIFY(writeDrmClient(4242, 5, "17", 1500000000));
+    telemetry.sampleAt(12000000);
+
+    const QVariantMap latest = telemetry.latest(1);
+    QCOMPARE(latest.value(QStringLiteral("index")).toInt(), 1);
+    QCOMPARE(latest.value(QStringLiteral("cpuPercent")).toDouble(), 75.0);
+    QCOMPARE(latest.value(QStringLiteral("memoryBytes")).toLongLong(), qint64(1073741824));
+    QCOMPARE(latest.value(QStringLiteral("rssBytes")).toLongLong(), qint64(1024) * sysconf(_SC_PAGESIZE));
+    QCOMPARE(latest.value(QStringLiteral("gpuPercent")).toDouble(), 25.0);
+    QCOMPARE(latest.value(QStringLiteral("gpuMemoryBytes")).toLongLong(), qint64(524288) * 1024);
+    QCOMPARE(latest.value(QStringLiteral("fps")).toDouble(), -1.0);
+    QCOMPARE(telemetry.latestAsVariant().size(), 1);
+
+    telemetry.untrack(1);
+    QVERIFY(telemetry.latest(1).isEmpty());
+}
+
+void TestInstanceTelemetry::testHistoryRing()
+{
+    QVERIFY(writeCpuStat(0));
+    QVERIFY(writeProcess(4242, 0, 1));
+
+    InstanceTelemetry telemetry;
+    telemetry.setProcRoot(m_proc->path());
+    telemetry.setCgroupRoot(m_cgroupRoot->path());
+    telemetry.track(0, 4242);
+
+    // CPU share grows by 0.1% per second, old samples fall out of the ring
+    qint64 usage = 0;
+    const int samples = InstanceTelemetry::HISTORY_SIZE + 10;
+    for (int i = 0; i < samples; ++i) {
+        usage += i * 1000;
+        QVERIFY(writeCpuStat(usage));
+        telemetry.sampleAt(qint64(i + 1) * 1000000);
+    }
+
+    const QVariantList cpu = telemetry.history(0, QStringLiteral("cpuPercent"));
+    QCOMPARE(cpu.size(), InstanceTelemetry::HISTORY_SIZE);
+    QCOMPARE(cpu.last().toDouble(), 0.1 * (samples - 1));
+    QCOMPARE(cpu.first().toDouble(), 0.1 * (samples - InstanceTelemetry::HISTORY_SIZE));
+    for (qsizetype i = 1; i < cpu.size(); ++i) {
+        QVERIFY(cpu.at(i).toDouble() > cpu.at(i - 1).toDouble());
+    }
+    QCOMPARE(telemetry.latest(0).value(QStringLiteral("cpuPercent")), cpu.last());
+
+    QVERIFY(telemetry.history(0, QStringLiteral("bogus")).isEmpty());
+    QVERIFY(telemetry.history(3, QStringLiteral("cpuPercent")).isEmpty());
+}
+
+void TestInstanceTelemetry::testParseStatsFps()
+{
+    QCOMPARE(InstanceTelemetry::parseStatsFps(QByteArray()), -1.0);
+    QCOMPARE(InstanceTelemetry::parseStatsFps("app=12345\nfps=59.9\nfps=60.1\n"), 60.1);
+    QCOMPARE(InstanceTelemetry::parseStatsFps("fps=abc\n"), -1.0);
+}
+
+void TestInstanceTelemetry::testStatsPipe()
+{
+    QVERIFY(writeProcess(4242, 0, 1));
+
+    InstanceTelemetry telemetry;
+    telemetry.setProcRoot(m_proc->path());
+    telemetry.setCgroupRoot(m_cgroupRoot->path());
+    telemetry.setStatsDirectory(m_proc->path() + QStringLiteral("/stats"));
+
+    const QString path = telemetry.statsPipe(2);
+    QVERIFY(!path.isEmpty());
+    QCOMPARE(telemetry.statsPipe(2), path);
+    QVERIFY(QFileInfo(path).permissions() & QFileDevice::WriteOther);
+
+    // Opening for writing doesn't block, a reader is always there
+    QFile pipe(path);
+    QVERIFY(pipe.open(QIODevice::WriteOnly | QIODevice::Unbuffered));
+    QVERIFY(pipe.write("fps=59") > 0);
+    QVERIFY(pipe.write(".5\n") > 0);
+
+    telemetry.track(2, 4242);
+    QTRY_COMPARE((telemetry.sample(), telemetry.latest(2).value(QStringLiteral("fps")).toDouble()), 59.5);
+}
+
+QTEST_MAIN(TestInstanceTelemetry)
+#include "test_instancetelemetry.moc"
@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "LaunchPlan.h"
+
+class TestLaunchPlan : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testSaveLoad();
+    void testOtherVersion();
+    void testLaunchConfig();
+    void testStableIdFor();
+    void testValidate();
+
+private:
+    static bool writeFile(const QString &path, const QByteArray &content);
+    // A fake eventN in @p root's sysfs, and its node in @p root/dev
+    static bool addDevice(const QString &root, int eventNumber, const QByteArray &vendor,
+                          const QByteArray &product, const QByteArray &phys);
+    static LaunchPlan samplePlan();
+};
+
+bool TestLaunchPlan::writeFile(const QString &path, const QByteArray &content)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(content) == content.size();
+}
+
+bool TestLaunchPlan::addDevice(const QString &root, int eventNumber, const QByteArray &vendor,
+                               const QByteArray &product, const QByteArray &phys)
+{
+    const QString node = QStringLiteral("event") + QString::number(eventNumber);
+    const QString input = root + QStringLiteral("/sys/devices/input") + QString::number(eventNumber);
+    QDir dir(root);
+    return dir.mkpath(input + QStringLiteral("/id"))
+        && dir.mkpath(root + QStringLiteral("/sys/class/input/") + node)
+        && dir.mkpath(root + QStringLiteral("/dev"))
+        && QFile::link(input, root + QStringLiteral("/sys/class/input/") + node + QStringLiteral("/device"))
+        && writeFile(input + QStringLiteral("/id/vendor"), vendor + '\n')
+        && writeFile(input + QStringLiteral("/id/product"), product + '\n')
+        && writeFile(input + QStringLiteral("/phys"), phys + '\n')
+        && writeFile(root + QStringLiteral("/dev/") + node, QByteArray());
+}
+
+LaunchPlan TestLaunchPlan::samplePlan()
+{
+    LaunchPlan plan;
+    plan.profileName = QStringLiteral("Couch");
+    plan.profileHash = QByteArray::fromHex("00ff10");
+
+    LaunchPlan::Instance instance;
+    instance.config = {
+        {QStringLiteral("instanceIndex"), 1},
+        {QStringLiteral("outputWidth"), 1280},
+        {QStringLiteral("borderless"), true},
+        {QStringLiteral("presetCommand"), QStringLiteral("steam -tenfoot")},
+        {QStringLiteral("resources"), QVariantMap{{QStringLiteral("cpuWeight"), 200}}},
+    };
+    instance.gamescopeArgs = {QStringLiteral("-W"), QStringLiteral("1280")};
+    instance.gameCommand = QStringLiteral("steam -tenfoot");
+    instance.environment = {QStringLiteral("SDL_GAMECONTROLLER_USE_BUTTON_LABELS=0")};
+    instance.devices = {{QStringLiteral("045e:028e:usb-1/input0"), QStringLiteral("/dev/input/event4")}};
+    instance.sharedDirectories = {QStringLiteral("/srv/games|")};
+    instance.aclPaths = {QStringLiteral("/srv/games")};
+    instance.sharedCaches = {QStringLiteral("/srv/steam/steamapps/shadercache/440")};
+    plan.instances = {LaunchPlan::Instance(), instance};
+    return plan;
+}
+
+void TestLaunchPlan::testSaveLoad()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("state/last-session.json"));
+
+    QVERIFY(LaunchPlan::load(path).isEmpty());
+
+    const LaunchPlan plan = samplePlan();
+    QVERIFY(plan.save(path));
+
+    const LaunchPlan loaded = LaunchPlan::load(path);
+    QCOMPARE(loaded.profileName, plan.profileName);
+    QCOMPARE(loaded.profileHash, plan.profileHash);
+    QCOMPARE(loaded.instances.size(), 2);
+    QVERIFY(loaded.instances[0].config.isEmpty());
+
+    const LaunchPlan::Instance &instance = loaded.instances[1];
+    QCOMPARE(instance.config.value(QStringLiteral("instanceIndex")).toInt(), 1);
+    QCOMPARE(instance.config.value(QStringLiteral("outputWidth")).toInt(), 1280);
+    QCOMPARE(instance.config.value(QStringLiteral("borderless")).toBool(), true);
+    QCOMPARE(instance.config.value(QStringLiteral("resources")).toMap().value(QStringLiteral("cpuWeight")).toInt(), 200);
+    QCOMPARE(instance.gamescopeArgs, plan.instances[1].gamescopeArgs);
+    QCOMPARE(instance.gameCommand, plan.instances[1].gameCommand);
+    QCOMPARE(instance.environment, plan.instances[1].environment);
+    QCOMPARE(instance.devices.size(), 1);
+    QCOMPARE(instance.devices[0].stableId, QStringLiteral("045e:028e:usb-1/input0"));
+    QCOMPARE(instance.devices[0].path, QStringLiteral("/dev/input/event4"));
+    QCOMPARE(instance.sharedDirectories, plan.instances[1].sharedDirectories);
+    QCOMPARE(instance.aclPaths, plan.instances[1].aclPaths);
+    QCOMPARE(instance.sharedCaches, plan.instances[1].sharedCaches);
+}
+
+void TestLaunchPlan::testOtherVersion()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("last-session.json"));
+
+    QJsonObject json = samplePlan().toJson();
+    json[QStringLiteral("version")] = LaunchPlan::VERSION + 1;
+    QVERIFY(writeFile(path, QJsonDocument(json).toJson()));
+    QVERIFY(LaunchPlan::load(path).isEmpty());
+
+    QVERIFY(writeFile(path, "not json"));
+    QVERIFY(LaunchPlan::load(path).isEmpty());
+}
+
+void TestLaunchPlan::testLaunchConfig()
+{
+    const LaunchPlan::Instance instance = samplePlan().instances[1];
+    const QVariantMap config = instance.launchConfig();
+    QCOMPARE(config.value(QStringLiteral("launchArgs")).toStringList(), instance.gamescopeArgs);
+    QCOMPARE(config.value(QStringLiteral("launchCommand")).toString(), instance.gameCommand);
+    QCOMPARE(config.value(QStringLiteral("launchEnvironment")).toStringList(), instance.environment);
+    QCOMPARE(config.value(QStringLiteral("outputWidth")).toInt(), 1280);
+}
+
+void TestLaunchPlan::testStableIdFor()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString root = dir.path();
+    QVERIFY(addDevice(root, 4, "045e", "028e", "usb-0000:00:14.0-2/input0"));
+
+    QCOMPARE(LaunchPlan::stableIdFor(root + QStringLiteral("/dev/event4"), root + QStringLiteral("/sys")),
+             QStringLiteral("045e:028e:usb-0000:00:14.0-2/input0"));
+    QVERIFY(LaunchPlan::stableIdFor(root + QStringLiteral("/dev/event5"), root + QStringLiteral("/sys")).isEmpty());
+    QVERIFY(LaunchPlan::stableIdFor(root + QStringLiteral("/sys"), root + QStringLiteral("/sys")).isEmpty());
+}
+
+void TestLaunchPlan::testValidate()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString root = dir.path();
+    const QString sysfs = root + QStringLiteral("/sys");
+    QVERIFY(addDevice(root, 4, "045e", "028e", "usb-1/input0"));
+    QVERIFY(addDevice(root, 6, "054c", "0ce6", "usb-2/input3"));
+    QVERIFY(QDir(root).mkpath(QStringLiteral("games")));
+
+    LaunchPlan plan;
+    QVERIFY(!plan.validate(sysfs).isEmpty());
+
+    LaunchPlan::Instance instance;
+    instance.gamescopeArgs = {QStringLiteral("-W"), QStringLiteral("1280")};
+    instance.gameCommand = QStringLiteral("steam -tenfoot");
+    instance.devices = {{QStringLiteral("045e:028e:usb-1/input0"), root + QStringLiteral("/dev/event4")}};
+    instance.sharedDirectories = {root + QStringLiteral("/games||overlay")};
+    instance.aclPaths = {root + QStringLiteral("/games")};
+    plan.instances = {instance};
+    QCOMPARE(plan.validate(sysfs), QString());
+
+    // The node now belongs to another controller
+    LaunchPlan moved = plan;
+    moved.instances[0].devices[0].path = root + QStringLiteral("/dev/event6");
+    QVERIFY(!moved.validate(sysfs).isEmpty());
+
+    LaunchPlan unplugged = plan;
+    unplugged.instances[0].devices[0].path = root + QStringLiteral("/dev/event9");
+    QVERIFY(!unplugged.validate(sysfs).isEmpty());
+
+    LaunchPlan missingDirectory = plan;
+    missingDirectory.instances[0].sharedDirectories = {root + QStringLiteral("/gone|")};
+    QVERIFY(!missingDirectory.validate(sysfs).isEmpty());
+
+    LaunchPlan missingAclPath = plan;
+    missingAclPath.instances[0].aclPaths << root + QStringLiteral("/gone");
+    QVERIFY(!missingAclPath.validate(sysfs).isEmpty());
+
+    LaunchPlan noCommand = plan;
+    noCommand.instances[0].gameCommand.clear();
+    QVERIFY(!noCommand.validate(sysfs).isEmpty());
+}
+
+QTEST_MAIN(TestLaunchPlan)
+#include "test_launchplan.moc"
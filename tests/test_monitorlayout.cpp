@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QTest>
+
+#include "MonitorLayout.h"
+
+class TestMonitorLayout : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testOnePerMonitor();
+    void testMoreInstancesThanMonitors();
+    void testFewerInstancesThanMonitors();
+    void testNativeSizeFollowsScale();
+    void testSplit();
+    void testNoMonitors();
+
+private:
+    static MonitorManager::MonitorInfo monitor(int index, const QString &connector, const QRect &geometry,
+                                               int refreshRate, bool primary = false);
+    static QList<MonitorManager::MonitorInfo> threeMonitors();
+};
+
+MonitorManager::MonitorInfo TestMonitorLayout::monitor(int index, const QString &connector, const QRect &geometry,
+                                                       int refreshRate, bool primary)
+{
+    MonitorManager::MonitorInfo info;
+    info.index = index;
+    info.name = connector;
+    info.connector = connector;
+    info.width = geometry.width();
+    info.height = geometry.height();
+    info.refreshRate = refreshRate;
+    info.primary = primary;
+    info.geometry = geometry;
+    info.nativeSize = geometry.size();
+    return info;
+}
+
+QList<MonitorManager::MonitorInfo> TestMonitorLayout::threeMonitors()
+{
+    // Listed out of desktop order, primary in the middle
+    return {
+        monitor(0, QStringLiteral("HDMI-A-1"), QRect(4480, 0, 1920, 1080), 60),
+        monitor(1, QStringLiteral("DP-1"), QRect(1920, 0, 2560, 1440), 144, true),
+        monitor(2, QStringLiteral("DP-2"), QRect(0, 0, 1920, 1080), 120),
+    };
+}
+
+void TestMonitorLayout::testOnePerMonitor()
+{
+    const QList<MonitorLayout::Slot> placed = MonitorLayout::assign(3, threeMonitors());
+    QCOMPARE(placed.size(), 3);
+
+    // Primary first, then left to right; native mode and refresh each
+    QCOMPARE(placed.at(0).output, QStringLiteral("DP-1"));
+    QCOMPARE(placed.at(0).geometry, QRect(1920, 0, 2560, 1440));
+    QCOMPARE(placed.at(0).nativeSize, QSize(2560, 1440));
+    QCOMPARE(placed.at(0).refreshRate, 144);
+    QCOMPARE(placed.at(0).monitor, 1);
+    QCOMPARE(placed.at(1).output, QStringLiteral("DP-2"));
+    QCOMPARE(placed.at(1).refreshRate, 120);
+    QCOMPARE(placed.at(2).output, QStringLiteral("HDMI-A-1"));
+    QCOMPARE(placed.at(2).geometry, QRect(4480, 0, 1920, 1080));
+}
+
+void TestMonitorLayout::testMoreInstancesThanMonitors()
+{
+    // The fourth player shares the primary monitor instead of being scaled onto it
+    const QList<MonitorLayout::Slot> placed = MonitorLayout::assign(4, threeMonitors());
+    QCOMPARE(placed.size(), 4);
+    QCOMPARE(placed.at(0).output, QStringLiteral("DP-1"));
+    QCOMPARE(placed.at(0).geometry, QRect(1920, 0, 1280, 1440));
+    QCOMPARE(placed.at(1).output, QStringLiteral("DP-1"));
+    QCOMPARE(placed.at(1).geometry, QRect(3200, 0, 1280, 1440));
+    QCOMPARE(placed.at(2).output, QStringLiteral("DP-2"));
+    QCOMPARE(placed.at(2).geometry, QRect(0, 0, 1920, 1080));
+    QCOMPARE(placed.at(3).output, QStringLiteral("HDMI-A-1"));
+}
+
+void TestMonitorLayout::testFewerInstancesThanMonitors()
+{
+    const QList<MonitorLayout::Slot> placed = MonitorLayout::assign(2, threeMonitors());
+    QCOMPARE(placed.size(), 2);
+    QCOMPARE(placed.at(0).output, QStringLiteral("DP-1"));
+    QCOMPARE(placed.at(1).output, QStringLiteral("DP-2"));
+}
+
+void TestMonitorLayout::testNativeSizeFollowsScale()
+{
+    // 4K panel at 200%: windows are placed in logical pixels, games render in device pixels
+    MonitorManager::MonitorInfo hidpi = monitor(0, QStringLiteral("eDP-1"), QRect(0, 0, 1920, 1080), 60, true);
+    hidpi.nativeSize = QSize(3840, 2160);
+
+    const QList<MonitorLayout::Slot> placed = MonitorLayout::assign(2, {hidpi});
+    QCOMPARE(placed.size(), 2);
+    QCOMPARE(placed.at(1).geometry, QRect(960, 0, 960, 1080));
+    QCOMPARE(placed.at(1).nativeSize, QSize(1920, 2160));
+}
+
+void TestMonitorLayout::testSplit()
+{
+    QCOMPARE(MonitorLayout::split(QRect(0, 0, 1920, 1080), 1), QList<QRect>({QRect(0, 0, 1920, 1080)}));
+    QCOMPARE(MonitorLayout::split(QRect(0, 0, 1920, 1080), 4).at(3), QRect(960, 540, 960, 540));
+
+    // Portrait monitors are split top to bottom
+    const QList<QRect> portrait = MonitorLayout::split(QRect(100, 0, 1080, 1920), 2);
+    QCOMPARE(portrait, QList<QRect>({QRect(100, 0, 1080, 960), QRect(100, 960, 1080, 960)}));
+
+    QVERIFY(MonitorLayout::split(QRect(0, 0, 1920, 1080), 0).isEmpty());
+}
+
+void TestMonitorLayout::testNoMonitors()
+{
+    QVERIFY(MonitorLayout::assign(2, {}).isEmpty());
+    QVERIFY(MonitorLayout::assign(0, threeMonitors()).isEmpty());
+}
+
+QTEST_MAIN(TestMonitorLayout)
+#include "test_monitorlayout.moc"
@@ -5,7 +5,9 @@
 #include <QSignalSpy>
 #include <QTemporaryDir>
 #include <QStandardPaths>
+#include <QDateTime>
 #include <QFile>
+#include <QFileInfo>
 #include <QDir>
 
 #include "PresetManager.h"
@@ -34,7 +36,17 @@ private Q_SLOTS:
     // Shared directories tests
     void testGetSetSharedDirectories();
 
+    // Application discovery tests
+    void testParseDesktopEntry();
+    void testApplicationIndex();
+    void testApplicationWatcher();
+
+    // Benchmarks
+    void benchmarkScanApplications_data();
+    void benchmarkScanApplications();
+
 private:
+    static void writeDesktopFile(const QString &path, const QByteArray &name);
     QTemporaryDir *m_tempDir = nullptr;
 };
 
@@ -62,6 +74,7 @@ void TestPresetManager::init()
     // Remove any existing presets.json to ensure clean state
     QString presetsPath = configDir + QStringLiteral("/presets.json");
     QFile::remove(presetsPath);
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/applications.json"));
 }
 
 void TestPresetManager::cleanup()
@@ -254,5 +267,142 @@ void TestPresetManager::testGetSetSharedDirectories()
     QCOMPARE(dirs, newDirs);
 }
 
+// ============ Application Discovery Tests ============
+
+void TestPresetManager::writeDesktopFile(const QString &path, const QByteArray &name)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("[Desktop Entry]\nType=Application\nName=" + name + "\nExec=/usr/bin/game %U\n");
+}
+
+void TestPresetManager::testParseDesktopEntry()
+{
+    const LaunchPreset app = PresetManager::parseDesktopEntry(
+        "# Comment\n"
+        "[Desktop Entry]\n"
+        "Type = Application\n"
+        "Name=Space\\sRacer\n"
+        "Name[de]=Weltraumrennen\n"
+        "Exec=env GAME=1,2 /opt/racer/run %f\n"
+        "Path=/opt/racer\n"
+        "Icon=racer\n"
+        "\n"
+        "[Desktop Action Editor]\n"
+        "Name=Editor\n"
+        "Exec=/opt/racer/editor\n");
+    QCOMPARE(app.name, QStringLiteral("Space Racer"));
+    // A comma no longer turns the value into a list
+    QCOMPARE(app.command, QStringLiteral("env GAME=1,2 /opt/racer/run"));
+    QCOMPARE(app.workingDirectory, QStringLiteral("/opt/racer"));
+    QCOMPARE(app.iconName, QStringLiteral("racer"));
+
+    QVERIFY(PresetManager::parseDesktopEntry("[Desktop Entry]\nType=Link\nName=Site\n").name.isEmpty());
+    QVERIFY(PresetManager::parseDesktopEntry("[Desktop Entry]\nType=Application\nName=X\nNoDisplay=true\n").name.isEmpty());
+    QVERIFY(PresetManager::parseDesktopEntry("[Other]\nType=Application\nName=X\n").name.isEmpty());
+}
+
+void TestPresetManager::testApplicationIndex()
+{
+    const QString dir = m_tempDir->filePath(QStringLiteral("applications"));
+    QVERIFY(QDir().mkpath(dir));
+    const QString path = dir + QStringLiteral("/game.desktop");
+    writeDesktopFile(path, "Alpha");
+    writeDesktopFile(dir + QStringLiteral("/other.desktop"), "Beta");
+    const QDateTime modified = QFileInfo(path).lastModified();
+
+    {
+        PresetManager manager;
+        manager.setApplicationDirectories({dir});
+        manager.scanApplications();
+        QCOMPARE(manager.availableApplications().size(), 2);
+        QCOMPARE(manager.availableApplications().first().name, QStringLiteral("Alpha"));
+    }
+
+    // Same size and mtime: the next scan takes the entry from the index without opening the file
+    writeDesktopFile(path, "Gamma");
+    QFile touched(path);
+    QVERIFY(touched.open(QIODevice::ReadWrite));
+    QVERIFY(touched.setFileTime(modified, QFileDevice::FileModificationTime));
+    touched.close();
+
+    PresetManager manager;
+    manager.setApplicationDirectories({dir});
+    manager.scanApplications();
+    QCOMPARE(manager.availableApplications().first().name, QStringLiteral("Alpha"));
+
+    // Removed files and files added as presets drop out of the list
+    QVERIFY(QFile::remove(dir + QStringLiteral("/other.desktop")));
+    manager.scanApplications();
+    QCOMPARE(manager.availableApplications().size(), 1);
+    QVERIFY(!manager.addPresetFromDesktopFile(path).isEmpty());
+    QVERIFY(manager.availableApplications().isEmpty());
+}
+
+void TestPresetManager::testApplicationWatcher()
+{
+    const QString dir = m_tempDir->filePath(QStringLiteral("applications"));
+    QVERIFY(QDir().mkpath(dir));
+
+    PresetManager manager;
+    manager.setApplicationDirectories({dir});
+    manager.scanApplications();
+    QVERIFY(manager.availableApplications().isEmpty());
+
+    // New files show up without another scan
+    QSignalSpy spy(&manager, &PresetManager::applicationsChanged);
+    writeDesktopFile(dir + QStringLiteral("/new.desktop"), "Fresh");
+    QVERIFY(spy.wait(5000));
+    QCOMPARE(manager.availableApplications().size(), 1);
+    QCOMPARE(manager.availableApplications().first().name, QStringLiteral("Fresh"));
+}
+
+void TestPresetManager::benchmarkScanApplications_data()
+{
+    QTest::addColumn<QString>("index");
+
+    // cold: no index, every file is parsed
+    // indexed: a fresh manager finds every entry in the saved index (startup)
+    // rescan: the same manager scans again
+    QTest::newRow("cold") << QStringLiteral("cold");
+    QTest::newRow("indexed") << QStringLiteral("indexed");
+    QTest::newRow("rescan") << QStringLiteral("rescan");
+}
+
+void TestPresetManager::benchmarkScanApplications()
+{
+    QFETCH(QString, index);
+
+    const QString dir = m_tempDir->filePath(QStringLiteral("applications"));
+    QVERIFY(QDir().mkpath(dir));
+    constexpr int fileCount = 500;
+    for (int i = 0; i < fileCount; ++i) {
+        writeDesktopFile(dir + QStringLiteral("/game%1.desktop").arg(i), "Game " + QByteArray::number(i));
+    }
+    const QString indexPath = QStandardPaths::writableLocation(QStandardPaths::CacheLocation)
+        + QStringLiteral("/applications.json");
+
+    PresetManager warm;
+    warm.setApplicationDirectories({dir});
+    warm.scanApplications();
+    QCOMPARE(warm.availableApplications().size(), fileCount);
+
+    if (index == QStringLiteral("rescan")) {
+        QBENCHMARK {
+            warm.scanApplications();
+        }
+        return;
+    }
+
+    QBENCHMARK {
+        if (index == QStringLiteral("cold")) {
+            QFile::remove(indexPath);
+        }
+        PresetManager manager;
+        manager.setApplicationDirectories({dir});
+        manager.scanApplications();
+    }
+}
+
 QTEST_MAIN(TestPresetManager)
 #include "test_presetmanager.moc"
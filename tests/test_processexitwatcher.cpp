@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QProcess>
+#include <QSignalSpy>
+#include <QTest>
+
+#include "ProcessExitWatcher.h"
+
+#include <unistd.h>
+
+class TestProcessExitWatcher : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testReportsExit();
+    void testAlreadyExited();
+    void testStop();
+};
+
+void TestProcessExitWatcher::initTestCase()
+{
+    ProcessExitWatcher probe;
+    if (!probe.watch(getpid())) {
+        QSKIP("pidfd_open is not available");
+    }
+}
+
+void TestProcessExitWatcher::testReportsExit()
+{
+    QProcess child;
+    child.start(QStringLiteral("sleep"), {QStringLiteral("30")});
+    QVERIFY(child.waitForStarted());
+    const qint64 pid = child.processId();
+
+    ProcessExitWatcher watcher;
+    QSignalSpy exitedSpy(&watcher, &ProcessExitWatcher::exited);
+    QVERIFY(watcher.watch(static_cast<pid_t>(pid)));
+    QVERIFY(watcher.isWatching());
+    QCOMPARE(watcher.pid(), static_cast<pid_t>(pid));
+
+    QVERIFY(!exitedSpy.wait(100));
+
+    child.terminate();
+    QVERIFY(exitedSpy.wait(2000));
+    QCOMPARE(exitedSpy.count(), 1);
+    QCOMPARE(exitedSpy.first().at(0).toLongLong(), pid);
+    QVERIFY(!watcher.isWatching());
+}
+
+void TestProcessExitWatcher::testAlreadyExited()
+{
+    QProcess child;
+    child.start(QStringLiteral("true"));
+    QVERIFY(child.waitForStarted());
+    const qint64 pid = child.processId();
+    QVERIFY(child.waitForFinished(2000));
+
+    // Reaped: reported from the event loop, like a live exit
+    ProcessExitWatcher watcher;
+    QSignalSpy exitedSpy(&watcher, &ProcessExitWatcher::exited);
+    QVERIFY(watcher.watch(static_cast<pid_t>(pid)));
+    QCOMPARE(exitedSpy.count(), 0);
+    QVERIFY(exitedSpy.wait(1000));
+    QCOMPARE(exitedSpy.first().at(0).toLongLong(), pid);
+}
+
+void TestProcessExitWatcher::testStop()
+{
+    QProcess child;
+    child.start(QStringLiteral("sleep"), {QStringLiteral("30")});
+    QVERIFY(child.waitForStarted());
+
+    ProcessExitWatcher watcher;
+    QSignalSpy exitedSpy(&watcher, &ProcessExitWatcher::exited);
+    QVERIFY(watcher.watch(static_cast<pid_t>(child.processId())));
+    watcher.stop();
+    QVERIFY(!watcher.isWatching());
+
+    child.kill();
+    QVERIFY(child.waitForFinished(2000));
+    QVERIFY(!exitedSpy.wait(200));
+}
+
+QTEST_MAIN(TestProcessExitWatcher)
+#include "test_processexitwatcher.moc"
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "RenderBudget.h"
+
+class TestRenderBudget : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testDetectGpu();
+    void testScaleWithinBudget();
+    void testScaleOverBudget();
+    void testInternalSize();
+
+private:
+    static bool writeFile(const QString &path, const QByteArray &contents);
+};
+
+bool TestRenderBudget::writeFile(const QString &path, const QByteArray &contents)
+{
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(contents) == contents.size();
+}
+
+void TestRenderBudget::testDetectGpu()
+{
+    QTemporaryDir drm;
+    QVERIFY(drm.isValid());
+    const QString root = drm.path();
+
+    QCOMPARE(RenderBudget::detectGpu(root), RenderBudget::GpuClass::Unknown);
+
+    // AMD APU with a 512 MiB carve-out; its connector must not count as a card
+    QVERIFY(writeFile(root + QStringLiteral("/card0/device/vendor"), "0x1002\n"));
+    QVERIFY(writeFile(root + QStringLiteral("/card0/device/mem_info_vram_total"), "536870912\n"));
+    QVERIFY(writeFile(root + QStringLiteral("/card0-eDP-1/device/vendor"), "0x10de\n"));
+    QCOMPARE(RenderBudget::detectGpu(root), RenderBudget::GpuClass::Integrated);
+
+    // A discrete card wins over the integrated one
+    QVERIFY(writeFile(root + QStringLiteral("/card1/device/vendor"), "0x1002\n"));
+    QVERIFY(writeFile(root + QStringLiteral("/card1/device/mem_info_vram_total"), "8589934592\n"));
+    QCOMPARE(RenderBudget::detectGpu(root), RenderBudget::GpuClass::Discrete);
+
+    QVERIFY(RenderBudget::defaultBudget(RenderBudget::GpuClass::Integrated)
+            < RenderBudget::defaultBudget(RenderBudget::GpuClass::Discrete));
+}
+
+void TestRenderBudget::testScaleWithinBudget()
+{
+    const QList<QSize> halves = {QSize(960, 1080), QSize(960, 1080)};
+
+    // ~124 Mpx/s for both halves of a 1080p60 screen
+    QCOMPARE(RenderBudget::scaleFor(halves, {60, 60}, 250), 1.0);
+    QCOMPARE(RenderBudget::scaleFor(halves, {60, 60}, 0), 1.0);
+    QCOMPARE(RenderBudget::scaleFor({}, {}, 250), 1.0);
+
+    // A missing or zero refresh rate counts as 60 Hz
+    QCOMPARE(RenderBudget::scaleFor(halves, {0}, 125), 1.0);
+}
+
+void TestRenderBudget::testScaleOverBudget()
+{
+    const QList<QSize> quarters(4, QSize(1920, 1080));
+
+    // ~498 Mpx/s into 250: ideal ~0.71 per axis, snapped down to Quality
+    QCOMPARE(RenderBudget::scaleFor(quarters, {60, 60, 60, 60}, 250), 0.67);
+
+    // Higher refresh rates need more reduction
+    QCOMPARE(RenderBudget::scaleFor(quarters, {60, 60, 120, 120}, 250), 0.5);
+
+    // Never below Performance, even if that still exceeds the budget
+    QCOMPARE(RenderBudget::scaleFor(quarters, {60, 60, 60, 60}, 10), 0.5);
+}
+
+void TestRenderBudget::testInternalSize()
+{
+    QCOMPARE(RenderBudget::internalSize(QSize(1920, 1080), 1.0), QSize(1920, 1080));
+    QCOMPARE(RenderBudget::internalSize(QSize(1920, 1080), 0.67), QSize(1286, 724));
+    QCOMPARE(RenderBudget::internalSize(QSize(1280, 800), 0.77), QSize(986, 616));
+    QCOMPARE(RenderBudget::internalSize(QSize(3, 1), 0.5), QSize(2, 2));
+}
+
+QTEST_MAIN(TestRenderBudget)
+#include "test_renderbudget.moc"
@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QSignalSpy>
+#include <QTest>
+
+#include "ResolutionController.h"
+
+class TestResolutionController : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testLevels();
+    void testStepDown();
+    void testStepUp();
+    void testGpuHeadroom();
+    void testBackoff();
+
+private:
+    // Feed @p count samples, the settle period of a fresh player included
+    static void feed(ResolutionController &controller, int index, int count, double fps, double gpu = -1.0);
+};
+
+void TestResolutionController::feed(ResolutionController &controller, int index, int count, double fps, double gpu)
+{
+    for (int i = 0; i < count; ++i) {
+        controller.addSample(index, fps, gpu);
+    }
+}
+
+void TestResolutionController::testLevels()
+{
+    ResolutionController controller;
+    controller.setBounds(0.5, 1.0);
+    QCOMPARE(controller.levels(), (QList<double>{1.0, 0.77, 0.67, 0.59, 0.5}));
+
+    // Bounds off FSR's levels are levels themselves
+    controller.setBounds(0.6, 0.9);
+    QCOMPARE(controller.levels(), (QList<double>{0.9, 0.77, 0.67, 0.6}));
+
+    controller.setBounds(0.8, 0.8);
+    QCOMPARE(controller.levels(), QList<double>{0.8});
+
+    // Tracked at the highest level not above the launch scale
+    controller.setBounds(0.5, 1.0);
+    controller.track(0, 0.7, 60);
+    QCOMPARE(controller.scale(0), 0.67);
+    QCOMPARE(controller.scale(1), 1.0);
+}
+
+void TestResolutionController::testStepDown()
+{
+    ResolutionController controller;
+    controller.setBounds(0.5, 1.0);
+    controller.track(0, 1.0, 60);
+    QSignalSpy spy(&controller, &ResolutionController::scaleChanged);
+
+    // Ignored while the instance settles
+    feed(controller, 0, ResolutionController::SETTLE_SAMPLES, 20.0);
+    QCOMPARE(spy.count(), 0);
+
+    // A short dip isn't enough
+    feed(controller, 0, ResolutionController::DOWN_SAMPLES - 1, 40.0);
+    feed(controller, 0, 1, 60.0);
+    feed(controller, 0, ResolutionController::DOWN_SAMPLES - 1, 40.0);
+    QCOMPARE(spy.count(), 0);
+
+    feed(controller, 0, 1, 40.0);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toInt(), 0);
+    QCOMPARE(spy.at(0).at(1).toDouble(), 0.77);
+    QCOMPARE(controller.scale(0), 0.77);
+
+    // Unknown frame rates neither count as misses nor break the floor
+    feed(controller, 0, ResolutionController::SETTLE_SAMPLES, -1.0);
+    feed(controller, 0, 100, -1.0);
+    QCOMPARE(spy.count(), 1);
+
+    controller.track(1, 0.5, 60);
+    feed(controller, 1, 100, 10.0);
+    QCOMPARE(controller.scale(1), 0.5);
+}
+
+void TestResolutionController::testStepUp()
+{
+    ResolutionController controller;
+    controller.setBounds(0.5, 1.0);
+    controller.track(0, 0.67, 60);
+    QSignalSpy spy(&controller, &ResolutionController::scaleChanged);
+
+    feed(controller, 0, ResolutionController::SETTLE_SAMPLES + ResolutionController::UP_SAMPLES - 1, 60.0);
+    QCOMPARE(spy.count(), 0);
+    feed(controller, 0, 1, 59.0);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(controller.scale(0), 0.77);
+
+    // Between the miss and the hit ratio: neither direction
+    feed(controller, 0, ResolutionController::SETTLE_SAMPLES + 200, 56.0);
+    QCOMPARE(spy.count(), 1);
+}
+
+void TestResolutionController::testGpuHeadroom()
+{
+    ResolutionController controller;
+    controller.setBounds(0.5, 1.0);
+    controller.track(0, 0.5, 30);
+    QSignalSpy spy(&controller, &ResolutionController::scaleChanged);
+
+    // 0.5 -> 0.59 is ~39% more pixels: 70% busy would not fit
+    feed(controller, 0, ResolutionController::SETTLE_SAMPLES + 100, 30.0, 70.0);
+    QCOMPARE(spy.count(), 0);
+
+    feed(controller, 0, ResolutionController::UP_SAMPLES, 30.0, 50.0);
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(controller.scale(0), 0.59);
+}
+
+void TestResolutionController::testBackoff()
+{
+    ResolutionController controller;
+    controller.setBounds(0.5, 1.0);
+    controller.track(0, 0.77, 60);
+    QSignalSpy spy(&controller, &ResolutionController::scaleChanged);
+
+    // Up, then straight back down
+    feed(controller, 0, ResolutionController::SETTLE_SAMPLES + ResolutionController::UP_SAMPLES, 60.0);
+    QCOMPARE(controller.scale(0), 1.0);
+    feed(controller, 0, ResolutionController::SETTLE_SAMPLES + ResolutionController::DOWN_SAMPLES, 45.0);
+    QCOMPARE(controller.scale(0), 0.77);
+    QCOMPARE(spy.count(), 2);
+
+    // The next try takes twice as long
+    feed(controller, 0, ResolutionController::SETTLE_SAMPLES + ResolutionController::UP_SAMPLES, 60.0);
+    QCOMPARE(spy.count(), 2);
+    feed(controller, 0, ResolutionController::UP_SAMPLES, 60.0);
+    QCOMPARE(spy.count(), 3);
+    QCOMPARE(controller.scale(0), 1.0);
+}
+
+QTEST_MAIN(TestResolutionController)
+#include "test_resolutioncontroller.moc"
@@ -6,6 +6,7 @@
 #include <QTemporaryDir>
 #include <QDir>
 
+#include "InstanceListModel.h"
 #include "SessionManager.h"
 
 // Helper macro for QVariantMap key access with proper QString conversion
@@ -48,6 +49,10 @@ private Q_SLOTS:
     // User assignment tests
     void testGetAssignedUsers();
 
+    // Instance model and autosave tests
+    void testInstanceModelRoles();
+    void testAutosave();
+
 private:
     SessionManager *m_sessionManager = nullptr;
     QTemporaryDir *m_tempDir = nullptr;
@@ -210,17 +215,40 @@ void TestSessionManager::testLoadProfile()
     // First save a profile
     m_sessionManager->setInstanceCount(4);
     m_sessionManager->setCurrentLayout(QStringLiteral("vertical"));
+    m_sessionManager->setPerformanceMode(true);
+    m_sessionManager->setGpuBudget(300);
+    m_sessionManager->setFrameLimit(90);
+    m_sessionManager->setEqualFrameShare(true);
+    m_sessionManager->setShareCaches(false);
+    m_sessionManager->setWritableShares(true);
+    QVariantMap capped;
+    capped[QStringLiteral("frameLimit")] = 45;
+    m_sessionManager->setInstanceConfig(1, capped);
     m_sessionManager->saveProfile(QStringLiteral("LoadTestProfile"));
     
     // Reset session
     m_sessionManager->newSession();
     QCOMPARE(m_sessionManager->instanceCount(), 2);
+    QCOMPARE(m_sessionManager->performanceMode(), false);
+    QCOMPARE(m_sessionManager->gpuBudget(), 0);
+    QCOMPARE(m_sessionManager->frameLimit(), 0);
+    QCOMPARE(m_sessionManager->equalFrameShare(), false);
+    QCOMPARE(m_sessionManager->shareCaches(), true);
+    QCOMPARE(m_sessionManager->writableShares(), false);
     
     // Load the profile
     bool result = m_sessionManager->loadProfile(QStringLiteral("LoadTestProfile"));
     QCOMPARE(result, true);
     QCOMPARE(m_sessionManager->instanceCount(), 4);
     QCOMPARE(m_sessionManager->currentLayout(), QStringLiteral("vertical"));
+    QCOMPARE(m_sessionManager->performanceMode(), true);
+    QCOMPARE(m_sessionManager->gpuBudget(), 300);
+    QCOMPARE(m_sessionManager->frameLimit(), 90);
+    QCOMPARE(m_sessionManager->equalFrameShare(), true);
+    QCOMPARE(m_sessionManager->shareCaches(), false);
+    QCOMPARE(m_sessionManager->writableShares(), true);
+    QCOMPARE(m_sessionManager->getInstanceConfig(1).value(QStringLiteral("frameLimit")).toInt(), 45);
+    QCOMPARE(m_sessionManager->getInstanceConfig(0).value(QStringLiteral("frameLimit")).toInt(), 0);
     QCOMPARE(m_sessionManager->currentProfileName(), QStringLiteral("LoadTestProfile"));
     
     // Loading non-existent profile should fail
@@ -360,5 +388,77 @@ void TestSessionManager::testGetAssignedUsers()
     QVERIFY(assigned.contains(QStringLiteral("player3")));
 }
 
+void TestSessionManager::testInstanceModelRoles()
+{
+    InstanceListModel *model = m_sessionManager->instanceModel();
+    QVERIFY(model != nullptr);
+    QCOMPARE(model->rowCount(), 2);
+
+    QSignalSpy dataSpy(model, &QAbstractItemModel::dataChanged);
+    QSignalSpy instancesSpy(m_sessionManager, &SessionManager::instancesChanged);
+
+    // Only the roles that moved are reported
+    m_sessionManager->setInstanceResolution(1, 1920, 1080, 1280, 1080);
+    QCOMPARE(dataSpy.count(), 1);
+    QCOMPARE(dataSpy.at(0).at(0).value<QModelIndex>().row(), 1);
+    const QList<int> roles = dataSpy.at(0).at(2).value<QList<int>>();
+    QCOMPARE(roles, QList<int>({InstanceListModel::OutputWidthRole}));
+    QCOMPARE(model->data(model->index(1), InstanceListModel::OutputWidthRole).toInt(), 1280);
+    QCOMPARE(instancesSpy.count(), 1);
+
+    // Setting the same values again is not a change
+    m_sessionManager->setInstanceResolution(1, 1920, 1080, 1280, 1080);
+    QVariantMap same;
+    same[KEY("outputWidth")] = 1280;
+    m_sessionManager->setInstanceConfig(1, same);
+    QCOMPARE(dataSpy.count(), 1);
+    QCOMPARE(instancesSpy.count(), 1);
+
+    QSignalSpy insertSpy(model, &QAbstractItemModel::rowsInserted);
+    m_sessionManager->setInstanceCount(4);
+    QCOMPARE(insertSpy.count(), 1);
+    QCOMPARE(model->count(), 4);
+}
+
+void TestSessionManager::testAutosave()
+{
+    // Nothing to write to until the session has a profile
+    m_sessionManager->setInstanceUser(0, QStringLiteral("player2"));
+    QVERIFY(!m_sessionManager->hasPendingAutosave());
+
+    QVERIFY(m_sessionManager->saveProfile(QStringLiteral("AutosaveProfile")));
+    QVERIFY(!m_sessionManager->hasPendingAutosave());
+
+    // No-op edits don't schedule a write
+    m_sessionManager->setInstanceUser(0, QStringLiteral("player2"));
+    QVERIFY(!m_sessionManager->hasPendingAutosave());
+
+    // A burst of edits is written once the timer runs out
+    QVariantMap config;
+    for (int rate = 60; rate <= 144; rate += 12) {
+        config[KEY("refreshRate")] = rate;
+        m_sessionManager->setInstanceConfig(1, config);
+    }
+    m_sessionManager->setCurrentLayout(QStringLiteral("vertical"));
+    QVERIFY(m_sessionManager->hasPendingAutosave());
+    QTRY_VERIFY_WITH_TIMEOUT(!m_sessionManager->hasPendingAutosave(), SessionManager::AUTOSAVE_DELAY_MS * 5);
+
+    SessionManager reader;
+    QVERIFY(reader.loadProfile(QStringLiteral("AutosaveProfile")));
+    QCOMPARE(reader.getInstanceConfig(1).value(KEY("refreshRate")).toInt(), 144);
+    QCOMPARE(reader.currentLayout(), QStringLiteral("vertical"));
+
+    // Pending edits are written before another profile is loaded
+    config[KEY("refreshRate")] = 75;
+    m_sessionManager->setInstanceConfig(1, config);
+    QVERIFY(m_sessionManager->hasPendingAutosave());
+    m_sessionManager->newSession();
+    QVERIFY(!m_sessionManager->hasPendingAutosave());
+    QVERIFY(reader.loadProfile(QStringLiteral("AutosaveProfile")));
+    QCOMPARE(reader.getInstanceConfig(1).value(KEY("refreshRate")).toInt(), 75);
+
+    m_sessionManager->deleteProfile(QStringLiteral("AutosaveProfile"));
+}
+
 QTEST_MAIN(TestSessionManager)
 #include "test_sessionmanager.moc"
@@ -9,12 +9,16 @@
 #include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QProcess>
 #include <pwd.h>
 #include <unistd.h>
 
 #define private public
 #include "SessionRunner.h"
 #undef private
+#include "GamescopeInstance.h"
+#include "InstancePool.h"
+#include "ProcessExitWatcher.h"
 #include "SessionManager.h"
 #include "PresetManager.h"
 #include "SteamConfigManager.h"
@@ -50,18 +54,120 @@ public:
         m_available = true;
     }
 
-    bool setPathAclWithParents(const QString &path, const QString &username) override
+    int mountSharedDirectories(const QString &username, uint compositorUid,
+                               const QStringList &directories) override
+    {
+        mountCalls.append({username, compositorUid, directories});
+        return directories.size();
+    }
+
+    QDBusPendingReply<bool> setPathAclWithParentsAsync(const QString &path, const QString &username) override
     {
         aclCalls.append({path, username});
-        return true;
+        return completedCall(true);
     }
 
-    int mountSharedDirectories(const QString &username, uint compositorUid,
-                               const QStringList &directories) override
+    QDBusPendingReply<int> mountSharedDirectoriesAsync(const QString &username, uint compositorUid,
+                                                       const QStringList &directories) override
     {
         mountCalls.append({username, compositorUid, directories});
-        return directories.size();
+        return completedCall(static_cast<int>(directories.size()));
+    }
+
+    QDBusPendingReply<QVariantMap> prepareInstanceAsync(const QString &username, uint compositorUid,
+                                                        const PrepareInstanceSpec &spec) override
+    {
+        prepareCalls.append(spec);
+        if (!authorized) {
+            return deniedCall();
+        }
+        if (!spec.sharedDirectories.isEmpty()) {
+            mountCalls.append({username, compositorUid, spec.sharedDirectories});
+        }
+        for (const QString &path : spec.aclPaths) {
+            aclCalls.append({path, username});
+        }
+
+        QVariantMap result;
+        result[QStringLiteral("success")] = true;
+        result[QStringLiteral("pid")] = spec.launch ? preparePid : qint64(0);
+        return completedCall(result);
+    }
+
+    QDBusPendingReply<qint64> launchInstanceAsync(const QString &username, uint compositorUid,
+                                                  const QStringList &gamescopeArgs, const QString &gameCommand,
+                                                  const QStringList &environment) override
+    {
+        Q_UNUSED(compositorUid)
+        Q_UNUSED(gamescopeArgs)
+        Q_UNUSED(gameCommand)
+        Q_UNUSED(environment)
+        launchCalls.append(username);
+        return QDBusPendingCall::fromError(QDBusError(QDBusError::Failed, QStringLiteral("No instances in tests")));
+    }
+
+    QDBusPendingReply<int> restoreAllDevicesAsync() override
+    {
+        ++resetAllCalls;
+        return authorized ? completedCall(0) : deniedCall();
+    }
+
+    QDBusPendingReply<int> unmountSharedDirectoriesAsync(const QString &username) override
+    {
+        unmountCalls.append(username);
+        return authorized ? completedCall(0) : deniedCall();
+    }
+
+    QDBusPendingReply<int> unmountAllSharedDirectoriesAsync() override
+    {
+        ++unmountAllCalls;
+        return authorized ? completedCall(0) : deniedCall();
+    }
+
+    QDBusPendingReply<bool> deleteUserAsync(const QString &username, bool removeHome) override
+    {
+        Q_UNUSED(removeHome)
+        deleteCalls.append(username);
+        const bool granted = deletionGranted;
+        deletionGranted = false;
+        return granted ? completedCall(true) : deniedCall();
     }
+
+    QDBusPendingReply<bool> authorizeUserDeletionAsync() override
+    {
+        ++deletionAuthorizeCalls;
+        deletionGranted = grantsDeletion;
+        return completedCall(deletionGranted);
+    }
+
+    QDBusPendingReply<QVariantMap> authorizeSessionAsync() override
+    {
+        ++authorizeCalls;
+        authorized = grantsAuthorization;
+        QVariantMap result;
+        result[QStringLiteral("authorized")] = authorized;
+        return completedCall(result);
+    }
+
+    // What the helper answers once the session's grant is gone
+    static QDBusPendingCall deniedCall()
+    {
+        return QDBusPendingCall::fromError(QDBusError(QDBusError::AccessDenied, QStringLiteral("Not authorized")));
+    }
+
+    QList<PrepareInstanceSpec> prepareCalls;
+    QStringList launchCalls;
+    QStringList unmountCalls;
+    qint64 preparePid = 0;  // What PrepareInstance "launches"
+    int resetAllCalls = 0;
+    int unmountAllCalls = 0;
+    int authorizeCalls = 0;
+    bool authorized = true;           // Whether the session holds a grant
+    bool grantsAuthorization = true;  // What AuthorizeSession answers
+    QStringList deleteCalls;
+    int deletionAuthorizeCalls = 0;
+    bool deletionGranted = false;     // One-shot delete-user grant, which sessions never carry
+    bool grantsDeletion = true;       // What AuthorizeAction answers for it
 };
 
 class TestSessionRunner : public QObject
@@ -87,6 +193,28 @@ private Q_SLOTS:
     void testSetupSteamConfigAppliesHeroicAcls();
     void testStartSessionHeroicPresetUsesAclsAndSharedConfig();
 
+    // Start pipeline tests
+    void testStartPipelineReportsStages();
+    void testLaunchRidesOnPrepare();
+    void testStopAbortsStartPipeline();
+    void testStopDuringPrepareResetsDevices();
+    void testStopAwaitsInstancesTogether();
+    void testStopReauthorizesLapsedGrant();
+    void testDeleteGuestsAuthorizesEach();
+    void testDeleteGuestsDenied();
+    void testAwaitAllWaitsForEveryCall();
+
+    // Instance pool tests
+    void testWarmStandbyNeedsAuthorization();
+
+    // Frame pacing tests
+    void testEqualShareFrameLimit();
+    void testRelayoutNeedsRestart();
+
+    // Benchmarks
+    void benchmarkCalculateLayout_data();
+    void benchmarkCalculateLayout();
+
 private:
     void createMockHeroicConfig(const QString &basePath);
     void createMockLegendaryConfig(const QString &basePath);
@@ -284,12 +412,19 @@ void TestSessionRunner::testSetupSteamConfigAppliesHeroicAcls()
     m_sessionManager->setInstanceUser(0, QStringLiteral("player1"));
     m_sessionManager->setInstancePreset(0, QStringLiteral("heroic"));
 
-    m_runner->setupLauncherAccess();
+    m_runner->m_starting = true;
+    m_runner->m_startStates.resize(1);
+    m_runner->runPrepareStage(0);
 
     QString expectedPath = homeDir.path() + QStringLiteral("/Games/Heroic/EpicGame");
+    QCOMPARE(m_helperClient->prepareCalls.size(), 1);
+    QCOMPARE(m_helperClient->prepareCalls[0].aclPaths, QStringList({expectedPath}));
     QCOMPARE(m_helperClient->aclCalls.size(), 1);
     QCOMPARE(m_helperClient->aclCalls[0].path, expectedPath);
     QCOMPARE(m_helperClient->aclCalls[0].username, QStringLiteral("player1"));
+
+    // Don't go on to launch gamescope
+    m_runner->stop();
 }
 
 void TestSessionRunner::testStartSessionHeroicPresetUsesAclsAndSharedConfig()
@@ -312,7 +447,11 @@ void TestSessionRunner::testStartSessionHeroicPresetUsesAclsAndSharedConfig()
     m_sessionManager->setInstancePreset(0, QStringLiteral("heroic"));
     m_sessionManager->setInstanceSharedDirectories(0, {heroicManager.configPath()});
 
+    QSignalSpy finishedSpy(m_runner, &SessionRunner::startupFinished);
     QVERIFY(m_runner->start());
+    QVERIFY(m_runner->isStarting());
+    QVERIFY(finishedSpy.wait(5000));
+    QVERIFY(!m_runner->isStarting());
 
     QCOMPARE(m_helperClient->mountCalls.size(), 1);
     QCOMPARE(m_helperClient->mountCalls[0].username, sessionUser);
@@ -327,5 +466,338 @@ void TestSessionRunner::testStartSessionHeroicPresetUsesAclsAndSharedConfig()
     QCOMPARE(m_helperClient->aclCalls[0].username, sessionUser);
 }
 
+void TestSessionRunner::testStartPipelineReportsStages()
+{
+    struct passwd *pw = getpwuid(getuid());
+    QString sessionUser = pw ? QString::fromLocal8Bit(pw->pw_name) : QStringLiteral("compositor");
+
+    m_sessionManager->setInstanceCount(2);
+    m_sessionManager->setInstanceUser(0, sessionUser);
+    m_sessionManager->setInstanceSharedDirectories(0, {QStringLiteral("/tmp")});
+
+    QSignalSpy stageStartedSpy(m_runner, &SessionRunner::startStageStarted);
+    QSignalSpy stageFinishedSpy(m_runner, &SessionRunner::startStageFinished);
+    QSignalSpy finishedSpy(m_runner, &SessionRunner::startupFinished);
+
+    QVERIFY(m_runner->start());
+
+    // Nothing runs synchronously inside start()
+    QCOMPARE(stageStartedSpy.count(), 0);
+    QCOMPARE(m_helperClient->mountCalls.size(), 0);
+    QCOMPARE(m_runner->startProgress(), 0.0);
+
+    QVERIFY(finishedSpy.wait(5000));
+
+    // Two stages per instance, each reported once
+    QCOMPARE(stageStartedSpy.count(), 4);
+    QCOMPARE(stageFinishedSpy.count(), 4);
+    QCOMPARE(m_runner->startProgress(), 1.0);
+
+    // Stages of a single instance run in order
+    QStringList instance0Stages;
+    for (const QList<QVariant> &args : std::as_const(stageFinishedSpy)) {
+        QVERIFY(args.at(3).toLongLong() >= 0);
+        if (args.at(0).toInt() == 0) {
+            instance0Stages << args.at(1).toString();
+        }
+    }
+    QCOMPARE(instance0Stages, QStringList({QStringLiteral("prepare"),
+                                           QStringLiteral("launch")}));
+
+    // One helper round trip for the instance with a player, launching it too
+    QCOMPARE(m_helperClient->prepareCalls.size(), 1);
+    QVERIFY(m_helperClient->prepareCalls[0].launch);
+    QVERIFY(!m_helperClient->prepareCalls[0].gameCommand.isEmpty());
+    QCOMPARE(m_helperClient->mountCalls.size(), 1);
+    QCOMPARE(m_helperClient->mountCalls[0].username, sessionUser);
+
+    // Neither launched there: the launch stage asks the helper on its own
+    QCOMPARE(m_helperClient->launchCalls.size(), 2);
+    QVERIFY(m_helperClient->launchCalls.contains(sessionUser));
+    QVERIFY(m_helperClient->launchCalls.contains(QString()));
+}
+
+void TestSessionRunner::testLaunchRidesOnPrepare()
+{
+    // Stand-in for the instance the helper launched
+    QProcess child;
+    child.start(QStringLiteral("sleep"), {QStringLiteral("30")});
+    QVERIFY(child.waitForStarted());
+    m_helperClient->preparePid = child.processId();
+
+    struct passwd *pw = getpwuid(getuid());
+    QString sessionUser = pw ? QString::fromLocal8Bit(pw->pw_name) : QStringLiteral("compositor");
+    m_sessionManager->setInstanceCount(1);
+    m_sessionManager->setInstanceUser(0, sessionUser);
+
+    QSignalSpy startedSpy(m_runner, &SessionRunner::instanceStarted);
+    QSignalSpy finishedSpy(m_runner, &SessionRunner::startupFinished);
+    QVERIFY(m_runner->start());
+    QVERIFY(finishedSpy.wait(5000));
+
+    // One round trip: nothing launched separately
+    QCOMPARE(m_helperClient->prepareCalls.size(), 1);
+    QVERIFY(m_helperClient->prepareCalls[0].launch);
+    QVERIFY(m_helperClient->launchCalls.isEmpty());
+
+    QCOMPARE(startedSpy.count(), 1);
+    QCOMPARE(m_runner->m_instances.size(), 1);
+    QCOMPARE(m_runner->m_instances[0]->pid(), child.processId());
+    QCOMPARE(m_runner->m_instances[0]->index(), 0);
+
+    child.kill();
+    child.waitForFinished(1000);
+}
+
+void TestSessionRunner::testStopAbortsStartPipeline()
+{
+    m_sessionManager->setInstanceCount(2);
+
+    QSignalSpy stageStartedSpy(m_runner, &SessionRunner::startStageStarted);
+    QSignalSpy finishedSpy(m_runner, &SessionRunner::startupFinished);
+
+    QVERIFY(m_runner->start());
+    QVERIFY(m_runner->isStarting());
+
+    m_runner->stop();
+    QVERIFY(!m_runner->isStarting());
+
+    // Queued stages from the aborted start must not run
+    QVERIFY(!finishedSpy.wait(200));
+    QCOMPARE(stageStartedSpy.count(), 0);
+}
+
+void TestSessionRunner::testStopDuringPrepareResetsDevices()
+{
+    m_sessionManager->setInstanceCount(1);
+    m_sessionManager->setInstanceUser(0, QStringLiteral("player1"));
+
+    // Devices as a resumed plan names them, so no DeviceManager is needed
+    LaunchPlan::Instance planned;
+    planned.devices = {{QStringLiteral("045e:028e:usb-1/input0"), QStringLiteral("/dev/input/event90")}};
+    m_runner->m_plan.instances = {planned};
+    m_runner->m_resuming = true;
+    m_runner->m_starting = true;
+    m_runner->m_startStates.resize(1);
+
+    m_runner->runPrepareStage(0);
+    QCOMPARE(m_helperClient->prepareCalls.size(), 1);
+
+    // Aborted before the reply is handled: the helper may have taken the
+    // devices all the same
+    m_runner->stop();
+    QCoreApplication::processEvents();
+    QCOMPARE(m_helperClient->resetAllCalls, 1);
+    QVERIFY(m_runner->m_ownedDevicePaths.isEmpty());
+}
+
+void TestSessionRunner::testStopAwaitsInstancesTogether()
+{
+    ProcessExitWatcher probe;
+    if (!probe.watch(getpid())) {
+        QSKIP("pidfd_open is not available");
+    }
+
+    // Stand-ins for helper-launched instances
+    QList<QProcess *> children;
+    for (int i = 0; i < 2; ++i) {
+        auto *child = new QProcess(this);
+        child->start(QStringLiteral("sleep"), {QStringLiteral("30")});
+        QVERIFY(child->waitForStarted());
+        children.append(child);
+
+        auto *instance = new GamescopeInstance(m_runner);
+        connect(instance, &GamescopeInstance::stopped, m_runner, &SessionRunner::onInstanceStopped);
+        QVERIFY(instance->attach({}, i, child->processId()));
+        m_runner->m_instances.append(instance);
+    }
+    m_runner->m_ownedDevicePaths = {QStringLiteral("/dev/input/event90"), QStringLiteral("/dev/input/event91")};
+
+    QSignalSpy stoppedSpy(m_runner, &SessionRunner::sessionStopped);
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    m_runner->stop();
+    QVERIFY(m_runner->isStopping());
+    QVERIFY(m_runner->isRunning());
+    QCOMPARE(stoppedSpy.count(), 0);
+
+    // No helper here to deliver SIGTERM; do it for it
+    for (QProcess *child : std::as_const(children)) {
+        child->terminate();
+    }
+
+    QVERIFY(stoppedSpy.wait(3000));
+    QCOMPARE(stoppedSpy.count(), 1);
+    // Well inside a single instance's stop timeout
+    QVERIFY(elapsed.elapsed() < 5000);
+    QVERIFY(!m_runner->isStopping());
+    QVERIFY(!m_runner->isRunning());
+    QVERIFY(m_runner->m_instances.isEmpty());
+
+    // One batched call each, not one per device or instance
+    QCOMPARE(m_helperClient->resetAllCalls, 1);
+    QCOMPARE(m_helperClient->unmountAllCalls, 1);
+
+    for (QProcess *child : std::as_const(children)) {
+        child->waitForFinished(1000);
+    }
+}
+
+void TestSessionRunner::testStopReauthorizesLapsedGrant()
+{
+    m_runner->m_ownedDevicePaths = {QStringLiteral("/dev/input/event90")};
+    m_helperClient->authorized = false;
+
+    QSignalSpy stoppedSpy(m_runner, &SessionRunner::sessionStopped);
+    m_runner->m_stopping = true;
+    m_runner->finishStop();
+    QVERIFY(stoppedSpy.wait(3000));
+
+    // Denied once, then sent again under the renewed grant
+    QCOMPARE(m_helperClient->authorizeCalls, 1);
+    QCOMPARE(m_helperClient->resetAllCalls, 2);
+    QCOMPARE(m_helperClient->unmountAllCalls, 2);
+    QVERIFY(!m_runner->isStopping());
+}
+
+void TestSessionRunner::testDeleteGuestsAuthorizesEach()
+{
+    QSignalSpy errorSpy(m_runner, &SessionRunner::errorOccurred);
+    m_runner->deleteGuests({QStringLiteral("guest1"), QStringLiteral("guest2")});
+    QTRY_COMPARE(m_helperClient->deleteCalls.size(), 2);
+    QCOMPARE(m_helperClient->deleteCalls, QStringList({QStringLiteral("guest1"), QStringLiteral("guest2")}));
+    QCOMPARE(m_helperClient->deletionAuthorizeCalls, 2);
+    QCOMPARE(errorSpy.count(), 0);
+}
+
+void TestSessionRunner::testDeleteGuestsDenied()
+{
+    m_helperClient->grantsDeletion = false;
+    QSignalSpy errorSpy(m_runner, &SessionRunner::errorOccurred);
+    m_runner->deleteGuests({QStringLiteral("guest1"), QStringLiteral("guest2")});
+
+    // Each guest is reported, and nothing is sent the helper would refuse
+    QTRY_COMPARE(errorSpy.count(), 2);
+    QVERIFY(errorSpy.at(0).at(0).toString().contains(QStringLiteral("guest1")));
+    QVERIFY(errorSpy.at(1).at(0).toString().contains(QStringLiteral("guest2")));
+    QCOMPARE(m_helperClient->deletionAuthorizeCalls, 2);
+    QVERIFY(m_helperClient->deleteCalls.isEmpty());
+}
+
+void TestSessionRunner::testAwaitAllWaitsForEveryCall()
+{
+    QList<QDBusPendingCall> calls = {
+        CouchPlayHelperClient::completedCall(true),
+        QDBusPendingCall::fromError(QDBusError(QDBusError::Failed, QStringLiteral("boom"))),
+        CouchPlayHelperClient::completedCall(3),
+    };
+
+    int invocations = 0;
+    CouchPlayHelperClient::awaitAll(calls, this, [&invocations]() { ++invocations; });
+
+    // Callback is always deferred to the event loop
+    QCOMPARE(invocations, 0);
+    QTRY_COMPARE(invocations, 1);
+
+    QDBusPendingReply<bool> first = calls[0];
+    QDBusPendingReply<int> third = calls[2];
+    QVERIFY(first.value());
+    QVERIFY(calls[1].isError());
+    QCOMPARE(third.value(), 3);
+
+    // An empty set still completes
+    int emptyInvocations = 0;
+    CouchPlayHelperClient::awaitAll({}, this, [&emptyInvocations]() { ++emptyInvocations; });
+    QTRY_COMPARE(emptyInvocations, 1);
+}
+
+void TestSessionRunner::testWarmStandbyNeedsAuthorization()
+{
+    m_sessionManager->setInstanceCount(1);
+    m_sessionManager->setInstanceUser(0, QStringLiteral("player1"));
+    InstancePool *pool = m_runner->instancePool();
+    pool->setPrelaunch(false);
+    pool->setEnabled(true);
+    m_runner->m_warmTimer->stop();
+
+    // Denied: nothing is sent that the helper would refuse anyway
+    m_helperClient->authorized = false;
+    m_helperClient->grantsAuthorization = false;
+    m_runner->warmStandby();
+    QCOMPARE(m_helperClient->authorizeCalls, 1);
+    QTest::qWait(50);
+    QVERIFY(m_helperClient->prepareCalls.isEmpty());
+    QCOMPARE(pool->count(), 0);
+
+    // Authorized: the standby entry is prepared under the grant
+    m_helperClient->grantsAuthorization = true;
+    m_runner->warmStandby();
+    QCOMPARE(m_helperClient->authorizeCalls, 2);
+    QTRY_COMPARE(pool->count(), 1);
+    QCOMPARE(m_helperClient->prepareCalls.size(), 1);
+    QVERIFY(!m_helperClient->prepareCalls[0].launch);
+
+    // Its mounts are torn down under the same grant
+    pool->setEnabled(false);
+    QCOMPARE(m_helperClient->unmountCalls, QStringList({QStringLiteral("player1")}));
+}
+
+void TestSessionRunner::testEqualShareFrameLimit()
+{
+    QCOMPARE(SessionRunner::equalShareFrameLimit(120, 2), 60);
+    QCOMPARE(SessionRunner::equalShareFrameLimit(144, 3), 48);
+    QCOMPARE(SessionRunner::equalShareFrameLimit(120, 4), 30);
+
+    // Rounded to a divisor of the refresh, not below the minimum
+    QCOMPARE(SessionRunner::equalShareFrameLimit(144, 5), 36);
+    QCOMPARE(SessionRunner::equalShareFrameLimit(60, 3), 30);
+    QCOMPARE(SessionRunner::equalShareFrameLimit(60, 4), 30);
+    QCOMPARE(SessionRunner::equalShareFrameLimit(50, 2), 50);
+
+    // Unknown refresh counts as 60 Hz
+    QCOMPARE(SessionRunner::equalShareFrameLimit(0, 2), 30);
+}
+
+void TestSessionRunner::testRelayoutNeedsRestart()
+{
+    // Same shape: gamescope scales to the new window size
+    QVERIFY(!SessionRunner::relayoutNeedsRestart(QSize(1920, 1080), QSize(1920, 1080)));
+    QVERIFY(!SessionRunner::relayoutNeedsRestart(QSize(3840, 2160), QSize(1920, 1080)));
+    QVERIFY(!SessionRunner::relayoutNeedsRestart(QSize(1920, 1080), QSize(1366, 768)));
+
+    // A half-screen tile becoming a whole screen (second monitor plugged in)
+    QVERIFY(SessionRunner::relayoutNeedsRestart(QSize(960, 1080), QSize(1920, 1080)));
+    QVERIFY(SessionRunner::relayoutNeedsRestart(QSize(1920, 540), QSize(960, 1080)));
+
+    // Unknown sizes never force a relaunch
+    QVERIFY(!SessionRunner::relayoutNeedsRestart(QSize(), QSize(1920, 1080)));
+}
+
+void TestSessionRunner::benchmarkCalculateLayout_data()
+{
+    QTest::addColumn<QString>("layout");
+    QTest::addColumn<int>("count");
+
+    for (const char *layout : {"horizontal", "vertical", "grid"}) {
+        for (int count : {2, 4}) {
+            QTest::addRow("%s-%d", layout, count) << QString::fromLatin1(layout) << count;
+        }
+    }
+}
+
+void TestSessionRunner::benchmarkCalculateLayout()
+{
+    QFETCH(QString, layout);
+    QFETCH(int, count);
+
+    const QRect screen(0, 0, 3840, 2160);
+    QList<QRect> rects;
+    QBENCHMARK {
+        rects = SessionRunner::calculateLayout(layout, count, screen);
+    }
+    QCOMPARE(rects.size(), count);
+}
+
 QTEST_MAIN(TestSessionRunner)
 #include "test_sessionrunner.moc"
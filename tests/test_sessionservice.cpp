@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QStandardPaths>
+#include <QTest>
+
+#define private public
+#include "DeviceManager.h"
+#include "SessionRunner.h"
+#undef private
+#include "SessionManager.h"
+#include "SessionService.h"
+
+#define KEY(x) QStringLiteral(x)
+
+class TestSessionService : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testStatus();
+    void testStartUnknownProfile();
+    void testStartOtherProfileWhileStarting();
+    void testResolveDevice();
+    void testAssignDevice();
+    void testAssignDeviceInvalid();
+
+private:
+    // Replace whatever the scan found with two known devices
+    void injectDevices();
+
+    SessionManager *m_sessionManager = nullptr;
+    DeviceManager *m_deviceManager = nullptr;
+    SessionRunner *m_runner = nullptr;
+    SessionService *m_service = nullptr;
+};
+
+void TestSessionService::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestSessionService::init()
+{
+    m_sessionManager = new SessionManager(this);
+    m_deviceManager = new DeviceManager(this);
+    m_deviceManager->setHotplugEnabled(false);
+    m_runner = new SessionRunner(this);
+    m_runner->setSessionManager(m_sessionManager);
+
+    m_service = new SessionService(this);
+    m_service->setSessionRunner(m_runner);
+    m_service->setSessionManager(m_sessionManager);
+    m_service->setDeviceManager(m_deviceManager);
+
+    injectDevices();
+}
+
+void TestSessionService::cleanup()
+{
+    delete m_service;
+    m_service = nullptr;
+    delete m_runner;
+    m_runner = nullptr;
+    delete m_deviceManager;
+    m_deviceManager = nullptr;
+    delete m_sessionManager;
+    m_sessionManager = nullptr;
+}
+
+void TestSessionService::injectDevices()
+{
+    InputDevice pad;
+    pad.eventNumber = 90;
+    pad.name = QStringLiteral("Test Pad");
+    pad.type = QStringLiteral("controller");
+    pad.path = QStringLiteral("/dev/input/event90");
+    pad.stableId = QStringLiteral("045e:028e:usb-0000:00:14.0-1/input0");
+
+    InputDevice keyboard;
+    keyboard.eventNumber = 91;
+    keyboard.name = QStringLiteral("Test Keyboard");
+    keyboard.type = QStringLiteral("keyboard");
+    keyboard.path = QStringLiteral("/dev/input/event91");
+    keyboard.stableId = QStringLiteral("046d:c31c:usb-0000:00:14.0-2/input0");
+
+    m_deviceManager->m_devices = {pad, keyboard};
+    m_deviceManager->m_instanceBits.clear();
+    m_deviceManager->rebuildIndices();
+}
+
+void TestSessionService::testStatus()
+{
+    const QVariantMap status = m_service->Status();
+    const QStringList keys = {KEY("running"), KEY("starting"), KEY("stopping"),
+                              KEY("status"), KEY("profile"), KEY("instances")};
+    for (const QString &key : keys) {
+        QVERIFY2(status.contains(key), qPrintable(key));
+    }
+    QCOMPARE(status.value(KEY("running")).toBool(), false);
+    QCOMPARE(status.value(KEY("starting")).toBool(), false);
+    QCOMPARE(status.value(KEY("profile")).toString(), m_sessionManager->currentProfile().name);
+
+    // Nothing to report without a runner
+    m_service->setSessionRunner(nullptr);
+    QVERIFY(m_service->Status().isEmpty());
+}
+
+void TestSessionService::testStartUnknownProfile()
+{
+    const QString before = m_sessionManager->currentProfile().name;
+    QVERIFY(!m_service->Start(QStringLiteral("No Such Profile")));
+    QCOMPARE(m_sessionManager->currentProfile().name, before);
+    QVERIFY(!m_runner->isStarting());
+}
+
+void TestSessionService::testStartOtherProfileWhileStarting()
+{
+    const QString other = QStringLiteral("Service Test Other");
+    QVERIFY(m_sessionManager->saveProfile(other));
+    m_sessionManager->newSession();
+    const QString before = m_sessionManager->currentProfile().name;
+    QVERIFY(before != other);
+
+    // The profile exists, but loading it would swap it out from under the start
+    m_runner->m_starting = true;
+    QVERIFY(!m_service->Start(other));
+    QCOMPARE(m_sessionManager->currentProfile().name, before);
+    m_runner->m_starting = false;
+
+    QVERIFY(m_sessionManager->deleteProfile(other));
+}
+
+void TestSessionService::testResolveDevice()
+{
+    QCOMPARE(m_service->resolveDevice(QStringLiteral("/dev/input/event90")), 90);
+    QCOMPARE(m_service->resolveDevice(QStringLiteral("event91")), 91);
+    QCOMPARE(m_service->resolveDevice(QStringLiteral("90")), 90);
+    QCOMPARE(m_service->resolveDevice(QStringLiteral("046d:c31c:usb-0000:00:14.0-2/input0")), 91);
+
+    QCOMPARE(m_service->resolveDevice(QStringLiteral("/dev/input/event92")), -1);
+    QCOMPARE(m_service->resolveDevice(QStringLiteral("-1")), -1);
+    QCOMPARE(m_service->resolveDevice(QStringLiteral("0000:0000:nowhere")), -1);
+    QCOMPARE(m_service->resolveDevice(QString()), -1);
+
+    m_service->setDeviceManager(nullptr);
+    QCOMPARE(m_service->resolveDevice(QStringLiteral("event90")), -1);
+}
+
+void TestSessionService::testAssignDevice()
+{
+    m_sessionManager->setInstanceCount(2);
+
+    QVERIFY(m_service->AssignDevice(QStringLiteral("/dev/input/event90"), 1));
+    QCOMPARE(m_deviceManager->getDevicesForInstance(1), QList<int>({90}));
+
+    QVERIFY(m_service->AssignDevice(QStringLiteral("event91"), 0));
+    QCOMPARE(m_deviceManager->getDevicesForInstance(0), QList<int>({91}));
+
+    QVERIFY(m_service->AssignDevice(QStringLiteral("91"), 1));
+    QVERIFY(m_deviceManager->getDevicesForInstance(0).isEmpty());
+
+    QVERIFY(m_service->AssignDevice(QStringLiteral("045e:028e:usb-0000:00:14.0-1/input0"), 0));
+    QCOMPARE(m_deviceManager->getDevicesForInstance(0), QList<int>({90}));
+
+    // -1 unassigns
+    QVERIFY(m_service->AssignDevice(QStringLiteral("event90"), -1));
+    QVERIFY(m_deviceManager->getDevicesForInstance(0).isEmpty());
+    QCOMPARE(m_deviceManager->getDevice(90).value(KEY("assignedInstance")).toInt(), -1);
+}
+
+void TestSessionService::testAssignDeviceInvalid()
+{
+    m_sessionManager->setInstanceCount(2);
+
+    QVERIFY(!m_service->AssignDevice(QStringLiteral("event92"), 0));
+    QVERIFY(!m_service->AssignDevice(QStringLiteral("0000:0000:nowhere"), 0));
+    QVERIFY(!m_service->AssignDevice(QStringLiteral("event90"), 2));
+    QVERIFY(!m_service->AssignDevice(QStringLiteral("event90"), -2));
+    QCOMPARE(m_deviceManager->getDevice(90).value(KEY("assignedInstance")).toInt(), -1);
+
+    m_service->setDeviceManager(nullptr);
+    QVERIFY(!m_service->AssignDevice(QStringLiteral("event90"), 0));
+}
+
+QTEST_MAIN(TestSessionService)
+#include "test_sessionservice.moc"
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QTest>
+#include <QThread>
+
+#include "SessionTrace.h"
+
+class TestSessionTrace : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testInactive();
+    void testSpans();
+    void testChromeTrace();
+    void testSave();
+};
+
+void TestSessionTrace::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void TestSessionTrace::testInactive()
+{
+    QVERIFY(!SessionTrace::isActive());
+    QCOMPARE(SessionTrace::open("dbus", QStringLiteral("PrepareInstance")), quint64(0));
+    SessionTrace::close(0);
+    QVERIFY(SessionTrace::spans().isEmpty());
+    QVERIFY(SessionTrace::save().isEmpty());
+}
+
+void TestSessionTrace::testSpans()
+{
+    SessionTrace::begin(QStringLiteral("First"));
+    const quint64 stale = SessionTrace::open("dbus", QStringLiteral("Stale"));
+    QVERIFY(stale > 0);
+
+    // A new trace drops the old one, and its IDs with it
+    SessionTrace::begin(QStringLiteral("Couch"));
+    SessionTrace::close(stale);
+    QVERIFY(SessionTrace::spans().isEmpty());
+
+    const quint64 call = SessionTrace::open("dbus", QStringLiteral("PrepareInstance"));
+    {
+        SessionTrace::Scope stage("stage", QStringLiteral("prepare"), QStringLiteral("Instance 0"));
+        QThread::msleep(2);
+    }
+    SessionTrace::close(call, {{QStringLiteral("error"), QStringLiteral("Denied")}});
+    // Closing twice keeps the first end
+    SessionTrace::close(call, {{QStringLiteral("late"), true}});
+    const quint64 open = SessionTrace::open("window", QStringLiteral("Window 0"));
+    QVERIFY(open > call);
+
+    const QList<SessionTrace::Span> spans = SessionTrace::spans();
+    QCOMPARE(spans.size(), 3);
+    QCOMPARE(spans[0].name, QStringLiteral("PrepareInstance"));
+    QVERIFY(spans[0].track.isEmpty());
+    QVERIFY(spans[0].durationUs >= spans[1].durationUs);
+    QCOMPARE(spans[0].args.value(QStringLiteral("error")).toString(), QStringLiteral("Denied"));
+    QVERIFY(!spans[0].args.contains(QStringLiteral("late")));
+    QCOMPARE(spans[1].category, QStringLiteral("stage"));
+    QCOMPARE(spans[1].track, QStringLiteral("Instance 0"));
+    QVERIFY(spans[1].durationUs >= 2000);
+    QCOMPARE(spans[2].durationUs, qint64(-1));
+}
+
+void TestSessionTrace::testChromeTrace()
+{
+    SessionTrace::begin(QStringLiteral("Couch"));
+    const qint64 start = SessionTrace::nowUs();
+    const quint64 call = SessionTrace::open("dbus", QStringLiteral("PrepareInstance"));
+    {
+        SessionTrace::Scope stage("stage", QStringLiteral("launch"), QStringLiteral("Instance 1"));
+    }
+    SessionTrace::close(call);
+    SessionTrace::open("window", QStringLiteral("Window 1"));
+
+    SessionTrace::addHelperSpans({
+        {QStringLiteral("pid"), qint64(4242)},
+        {QStringLiteral("spans"),
+         QVariantList{QVariantMap{
+             {QStringLiteral("name"), QStringLiteral("PrepareInstance")},
+             {QStringLiteral("start"), start + 10},
+             {QStringLiteral("duration"), qint64(50)},
+             {QStringLiteral("parent"), call},
+         }}},
+    });
+
+    const QJsonObject trace = QJsonDocument::fromJson(SessionTrace::toChromeTrace()).object();
+    QCOMPARE(trace[QStringLiteral("otherData")].toObject()[QStringLiteral("session")].toString(),
+             QStringLiteral("Couch"));
+
+    QHash<QString, QJsonObject> byName;
+    int metadata = 0;
+    for (const QJsonValue &value : trace[QStringLiteral("traceEvents")].toArray()) {
+        const QJsonObject event = value.toObject();
+        const QString phase = event[QStringLiteral("ph")].toString();
+        if (phase == QLatin1String("M")) {
+            ++metadata;
+        } else if (phase != QLatin1String("e")) {
+            byName.insert(event[QStringLiteral("cat")].toString() + QLatin1Char('/')
+                              + event[QStringLiteral("name")].toString(),
+                          event);
+        }
+    }
+    // Both processes and the instance track
+    QCOMPARE(metadata, 3);
+
+    const QJsonObject dbus = byName.value(QStringLiteral("dbus/PrepareInstance"));
+    QCOMPARE(dbus[QStringLiteral("ph")].toString(), QStringLiteral("b"));
+    QCOMPARE(dbus[QStringLiteral("id")].toString(), QString::number(call));
+
+    const QJsonObject stage = byName.value(QStringLiteral("stage/launch"));
+    QCOMPARE(stage[QStringLiteral("ph")].toString(), QStringLiteral("X"));
+    QCOMPARE(stage[QStringLiteral("tid")].toInt(), 1);
+
+    const QJsonObject window = byName.value(QStringLiteral("window/Window 1"));
+    QVERIFY(window[QStringLiteral("args")].toObject()[QStringLiteral("unfinished")].toBool());
+
+    const QJsonObject helper = byName.value(QStringLiteral("helper/PrepareInstance"));
+    QCOMPARE(helper[QStringLiteral("pid")].toInteger(), qint64(4242));
+    QCOMPARE(helper[QStringLiteral("ts")].toInteger(), start + 10);
+    QCOMPARE(helper[QStringLiteral("dur")].toInteger(), qint64(50));
+    QCOMPARE(helper[QStringLiteral("args")].toObject()[QStringLiteral("parent")].toString(), QString::number(call));
+}
+
+void TestSessionTrace::testSave()
+{
+    SessionTrace::begin(QStringLiteral("Couch"));
+    SessionTrace::close(SessionTrace::open("dbus", QStringLiteral("LaunchInstance")));
+
+    const QString path = SessionTrace::save();
+    QVERIFY(!path.isEmpty());
+    QVERIFY(!SessionTrace::isActive());
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QVERIFY(QJsonDocument::fromJson(file.readAll()).object().contains(QStringLiteral("traceEvents")));
+    file.remove();
+}
+
+QTEST_MAIN(TestSessionTrace)
+#include "test_sessiontrace.moc"
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QTest>
+#include <QThread>
+
+#include "StartupTrace.h"
+
+class TestStartupTrace : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testScopes();
+};
+
+void TestStartupTrace::testScopes()
+{
+    QVERIFY(!StartupTrace::finished());
+    QVERIFY(StartupTrace::elapsedUs() > 0);
+
+    {
+        StartupTrace::Scope outer("Outer");
+        QThread::msleep(5);
+        StartupTrace::Scope inner("Inner");
+        QThread::msleep(5);
+    }
+
+    QList<StartupTrace::Entry> entries = StartupTrace::entries();
+    QCOMPARE(entries.size(), 2);
+    QCOMPARE(entries[0].name, QStringLiteral("Outer"));
+    QCOMPARE(entries[0].depth, 0);
+    QCOMPARE(entries[1].name, QStringLiteral("Inner"));
+    QCOMPARE(entries[1].depth, 1);
+    QVERIFY(entries[1].startUs >= entries[0].startUs);
+    QVERIFY(entries[0].durationUs >= 10000);
+    QVERIFY(entries[1].durationUs >= 5000);
+    QVERIFY(entries[0].durationUs >= entries[1].durationUs);
+
+    const qint64 total = StartupTrace::firstFrame();
+    QVERIFY(total >= entries[0].startUs + entries[0].durationUs);
+    QVERIFY(StartupTrace::finished());
+    QCOMPARE(StartupTrace::firstFrame(), total);
+
+    // Work after the first frame isn't startup
+    {
+        StartupTrace::Scope late("Late");
+    }
+    QCOMPARE(StartupTrace::entries().size(), 2);
+}
+
+QTEST_MAIN(TestStartupTrace)
+#include "test_startuptrace.moc"
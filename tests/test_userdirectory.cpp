@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+
+#include <unistd.h>
+
+#include "UserDirectory.h"
+
+class TestUserDirectory : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testCachesLookups();
+    void testCachesMisses();
+    void testTimeToLive();
+    void testInvalidatesOnPasswdWrite();
+    void testIgnoresOtherFiles();
+    void testIsInGroup();
+    void testSystemBackend();
+
+private:
+    // Backend that counts how often each lookup reaches it
+    UserDirectory::Backend countingBackend();
+    static bool writeFile(const QString &path, const QByteArray &contents);
+
+    int m_userLookups = 0;
+    int m_groupLookups = 0;
+};
+
+UserDirectory::Backend TestUserDirectory::countingBackend()
+{
+    m_userLookups = 0;
+    m_groupLookups = 0;
+
+    UserEntry player;
+    player.name = QStringLiteral("player2");
+    player.uid = 1002;
+    player.gid = 1002;
+    player.home = QStringLiteral("/home/player2");
+    player.groups = {1002, 960};
+
+    UserDirectory::Backend backend;
+    backend.userByName = [this, player](const QString &name) -> std::optional<UserEntry> {
+        ++m_userLookups;
+        return name == player.name ? std::optional<UserEntry>(player) : std::nullopt;
+    };
+    backend.userByUid = [this, player](uid_t uid) -> std::optional<UserEntry> {
+        ++m_userLookups;
+        return uid == player.uid ? std::optional<UserEntry>(player) : std::nullopt;
+    };
+    backend.group = [this](const QString &name) -> std::optional<GroupEntry> {
+        ++m_groupLookups;
+        if (name != QStringLiteral("couchplay")) {
+            return std::nullopt;
+        }
+        GroupEntry group;
+        group.name = name;
+        group.gid = 960;
+        return group;
+    };
+    return backend;
+}
+
+bool TestUserDirectory::writeFile(const QString &path, const QByteArray &contents)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(contents) == contents.size();
+}
+
+void TestUserDirectory::testCachesLookups()
+{
+    QTemporaryDir etc;
+    QVERIFY(etc.isValid());
+    UserDirectory directory(etc.path(), countingBackend());
+
+    QCOMPARE(directory.user(QStringLiteral("player2"))->uid, uid_t(1002));
+    QCOMPARE(directory.user(QStringLiteral("player2"))->home, QStringLiteral("/home/player2"));
+    QCOMPARE(m_userLookups, 1);
+
+    // A lookup by name also answers by UID
+    QCOMPARE(directory.user(uid_t(1002))->name, QStringLiteral("player2"));
+    QCOMPARE(m_userLookups, 1);
+}
+
+void TestUserDirectory::testCachesMisses()
+{
+    QTemporaryDir etc;
+    QVERIFY(etc.isValid());
+    UserDirectory directory(etc.path(), countingBackend());
+
+    QVERIFY(!directory.user(QStringLiteral("nobody-here")));
+    QVERIFY(!directory.user(QStringLiteral("nobody-here")));
+    QVERIFY(!directory.group(QStringLiteral("missing")));
+    QVERIFY(!directory.group(QStringLiteral("missing")));
+    QCOMPARE(m_userLookups, 1);
+    QCOMPARE(m_groupLookups, 1);
+}
+
+void TestUserDirectory::testTimeToLive()
+{
+    QTemporaryDir etc;
+    QVERIFY(etc.isValid());
+    UserDirectory directory(etc.path(), countingBackend());
+    directory.setTimeToLive(20);
+
+    QVERIFY(directory.user(QStringLiteral("player2")));
+    QThread::msleep(40);
+    QVERIFY(directory.user(QStringLiteral("player2")));
+    QCOMPARE(m_userLookups, 2);
+
+    directory.invalidate();
+    QVERIFY(directory.user(QStringLiteral("player2")));
+    QCOMPARE(m_userLookups, 3);
+}
+
+void TestUserDirectory::testInvalidatesOnPasswdWrite()
+{
+    QTemporaryDir etc;
+    QVERIFY(etc.isValid());
+    UserDirectory directory(etc.path(), countingBackend());
+
+    QVERIFY(directory.user(QStringLiteral("player2")));
+    QVERIFY(directory.group(QStringLiteral("couchplay")));
+    QVERIFY(writeFile(etc.filePath(QStringLiteral("passwd")), "player2:x:1002:1002::/home/player2:/bin/bash\n"));
+
+    QVERIFY(directory.user(QStringLiteral("player2")));
+    QVERIFY(directory.group(QStringLiteral("couchplay")));
+    QCOMPARE(m_userLookups, 2);
+    QCOMPARE(m_groupLookups, 2);
+
+    // shadow-utils renames a fresh copy over the old one
+    QVERIFY(writeFile(etc.filePath(QStringLiteral("group+")), "couchplay:x:960:player2\n"));
+    QVERIFY(directory.user(QStringLiteral("player2")));
+    QCOMPARE(m_userLookups, 2);
+    QVERIFY(QFile::rename(etc.filePath(QStringLiteral("group+")), etc.filePath(QStringLiteral("group"))));
+    QVERIFY(directory.user(QStringLiteral("player2")));
+    QCOMPARE(m_userLookups, 3);
+}
+
+void TestUserDirectory::testIgnoresOtherFiles()
+{
+    QTemporaryDir etc;
+    QVERIFY(etc.isValid());
+    UserDirectory directory(etc.path(), countingBackend());
+
+    QVERIFY(directory.user(QStringLiteral("player2")));
+    QVERIFY(writeFile(etc.filePath(QStringLiteral("hosts")), "127.0.0.1 localhost\n"));
+    QVERIFY(directory.user(QStringLiteral("player2")));
+    QCOMPARE(m_userLookups, 1);
+}
+
+void TestUserDirectory::testIsInGroup()
+{
+    QTemporaryDir etc;
+    QVERIFY(etc.isValid());
+    UserDirectory directory(etc.path(), countingBackend());
+
+    // Not in gr_mem, but getgrouplist() has it
+    QVERIFY(directory.isInGroup(QStringLiteral("player2"), QStringLiteral("couchplay")));
+    QVERIFY(!directory.isInGroup(QStringLiteral("player3"), QStringLiteral("couchplay")));
+    QVERIFY(!directory.isInGroup(QStringLiteral("player2"), QStringLiteral("wheel")));
+}
+
+void TestUserDirectory::testSystemBackend()
+{
+    UserDirectory directory;
+
+    const std::optional<UserEntry> self = directory.user(getuid());
+    QVERIFY(self);
+    QCOMPARE(self->uid, getuid());
+    QVERIFY(self->groups.contains(self->gid));
+    QCOMPARE(directory.user(self->name)->uid, getuid());
+}
+
+QTEST_MAIN(TestUserDirectory)
+#include "test_userdirectory.moc"
@@ -0,0 +1,319 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// SPDX-FileCopyrightText: 2025 CouchPlay Contributors
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "SteamConfigManager.h"
+#include "Vdf.h"
+
+class TestVdf : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testBinaryFields();
+    void testBinaryRoundTrip();
+    void testBinaryTruncated();
+    void testShortcuts();
+    void testShortcutsRoundTrip();
+    void testTextReader();
+    void testTextDecode();
+    void testTextMalformed();
+    void testMappedFile();
+    void benchmarkParseShortcuts_data();
+    void benchmarkParseShortcuts();
+
+private:
+    static QByteArray shortcutsVdf();
+};
+
+QByteArray TestVdf::shortcutsVdf()
+{
+    // One shortcut as Steam writes it; literals are split so hex escapes end where intended
+    static const char raw[] =
+        "\x00" "shortcuts" "\x00"
+        "\x00" "0" "\x00"
+        "\x02" "appid" "\x00" "\x39\x30\x00\x00"
+        "\x01" "AppName" "\x00" "Caf\xc3\xa9 Racer" "\x00"
+        "\x01" "Exe" "\x00" "\"/opt/game/run.sh\"" "\x00"
+        "\x02" "IsHidden" "\x00" "\x01\x00\x00\x00"
+        "\x07" "Playtime" "\x00" "\x01\x02\x03\x04\x05\x06\x07\x08"
+        "\x00" "tags" "\x00"
+        "\x01" "0" "\x00" "favorite" "\x00"
+        "\x01" "1" "\x00" "couch" "\x00"
+        "\x08"
+        "\x08"
+        "\x08"
+        "\x08";
+    return QByteArray(raw, sizeof(raw) - 1);
+}
+
+void TestVdf::testBinaryFields()
+{
+    const QByteArray data = shortcutsVdf();
+    BinaryVdfReader reader(data);
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.type(), BinaryVdfReader::Object);
+    QCOMPARE(reader.key().toByteArray(), QByteArray("shortcuts"));
+    QCOMPARE(reader.depth(), 1);
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.key().toByteArray(), QByteArray("0"));
+    QCOMPARE(reader.depth(), 2);
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.type(), BinaryVdfReader::Int32);
+    QCOMPARE(reader.key().toByteArray(), QByteArray("appid"));
+    QCOMPARE(reader.int32Value(), quint32(12345));
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.type(), BinaryVdfReader::String);
+    QCOMPARE(reader.value().toByteArray(), QByteArray("Caf\xc3\xa9 Racer"));
+    // Views point into the input, nothing is copied
+    QVERIFY(reader.value().data() > data.constData());
+    QVERIFY(reader.value().data() < data.constData() + data.size());
+
+    QVERIFY(reader.next());  // Exe
+    QVERIFY(reader.next());  // IsHidden
+    QVERIFY(reader.next());
+    QCOMPARE(reader.type(), BinaryVdfReader::UInt64);
+    QCOMPARE(reader.uint64Value(), quint64(0x0807060504030201));
+
+    // Skipping the tags lands on the shortcut's own End
+    QVERIFY(reader.next());
+    QCOMPARE(reader.key().toByteArray(), QByteArray("tags"));
+    QVERIFY(reader.skipObject());
+    QCOMPARE(reader.depth(), 2);
+    QVERIFY(reader.next());
+    QCOMPARE(reader.type(), BinaryVdfReader::End);
+    QCOMPARE(reader.depth(), 1);
+
+    QVERIFY(reader.next());
+    QVERIFY(reader.next());
+    QCOMPARE(reader.depth(), 0);
+    QVERIFY(!reader.next());
+    QVERIFY(!reader.hasError());
+}
+
+void TestVdf::testBinaryRoundTrip()
+{
+    const QByteArray data = shortcutsVdf();
+    BinaryVdfReader reader(data);
+    BinaryVdfWriter writer;
+    while (reader.next()) {
+        writer.copyField(reader);
+    }
+    QVERIFY(!reader.hasError());
+    QCOMPARE(writer.data(), data);
+}
+
+void TestVdf::testBinaryTruncated()
+{
+    const QByteArray data = shortcutsVdf().chopped(30);
+    BinaryVdfReader reader(data);
+    while (reader.next()) {
+    }
+    QVERIFY(reader.hasError());
+
+    BinaryVdfReader unknown(QByteArrayView("\x0f" "key" "\x00", 5));
+    QVERIFY(!unknown.next());
+    QVERIFY(unknown.hasError());
+}
+
+void TestVdf::testShortcuts()
+{
+    const QList<SteamShortcut> shortcuts = SteamConfigManager::parseShortcuts(shortcutsVdf());
+    QCOMPARE(shortcuts.size(), 1);
+
+    const SteamShortcut &shortcut = shortcuts.first();
+    QCOMPARE(shortcut.appId, quint32(12345));
+    QCOMPARE(shortcut.appName, QStringLiteral("Café Racer"));
+    QCOMPARE(shortcut.exe, QStringLiteral("\"/opt/game/run.sh\""));
+    QVERIFY(shortcut.isHidden);
+    QCOMPARE(shortcut.tags, QStringList({QStringLiteral("favorite"), QStringLiteral("couch")}));
+
+    // A truncated file keeps the shortcuts before the damage
+    QVERIFY(SteamConfigManager::parseShortcuts(shortcutsVdf().first(20)).isEmpty());
+    QVERIFY(SteamConfigManager::parseShortcuts(QByteArrayView()).isEmpty());
+}
+
+void TestVdf::testShortcutsRoundTrip()
+{
+    SteamShortcut first;
+    first.appId = 3000000001u;
+    first.appName = QStringLiteral("Emulator");
+    first.exe = QStringLiteral("\"/usr/bin/retroarch\"");
+    first.startDir = QStringLiteral("\"/usr/bin/\"");
+    first.launchOptions = QStringLiteral("-L core.so %command%");
+    first.allowOverlay = false;
+    first.lastPlayTime = 1700000000;
+    first.tags = {QStringLiteral("retro")};
+
+    SteamShortcut second;
+    second.appName = QStringLiteral("日本語ゲーム");
+
+    const QByteArray data = SteamConfigManager::serializeShortcuts({first, second});
+    const QList<SteamShortcut> parsed = SteamConfigManager::parseShortcuts(data);
+    QCOMPARE(parsed.size(), 2);
+    QCOMPARE(parsed.at(0).appId, first.appId);
+    QCOMPARE(parsed.at(0).appName, first.appName);
+    QCOMPARE(parsed.at(0).exe, first.exe);
+    QCOMPARE(parsed.at(0).startDir, first.startDir);
+    QCOMPARE(parsed.at(0).launchOptions, first.launchOptions);
+    QCOMPARE(parsed.at(0).allowOverlay, false);
+    QCOMPARE(parsed.at(0).allowDesktopConfig, true);
+    QCOMPARE(parsed.at(0).lastPlayTime, first.lastPlayTime);
+    QCOMPARE(parsed.at(0).tags, first.tags);
+    QCOMPARE(parsed.at(1).appName, second.appName);
+
+    // Ends like Steam's own files: shortcut, "shortcuts" and root
+    QVERIFY(data.endsWith("\x08\x08\x08"));
+}
+
+void TestVdf::testTextReader()
+{
+    const QByteArray acf = R"(// Written by Steam
+"AppState"
+{
+	"appid"		"730"
+	"name"		"Counter-Strike 2"
+	"UserConfig"
+	{
+		"language"		"english"
+	}
+	bare	token
+	"platform"	"linux" [$LINUX]
+	"quoted"	"say \"hi\""
+}
+)";
+
+    TextVdfReader reader(acf);
+    QVERIFY(reader.next());
+    QCOMPARE(reader.type(), TextVdfReader::ObjectBegin);
+    QCOMPARE(reader.key().toByteArray(), QByteArray("AppState"));
+    QCOMPARE(reader.depth(), 1);
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.type(), TextVdfReader::Value);
+    QCOMPARE(reader.key().toByteArray(), QByteArray("appid"));
+    QCOMPARE(reader.value().toByteArray(), QByteArray("730"));
+    QVERIFY(reader.value().data() > acf.constData());
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.value().toByteArray(), QByteArray("Counter-Strike 2"));
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.type(), TextVdfReader::ObjectBegin);
+    QCOMPARE(reader.depth(), 2);
+    QVERIFY(reader.skipObject());
+    QCOMPARE(reader.depth(), 1);
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.key().toByteArray(), QByteArray("bare"));
+    QCOMPARE(reader.value().toByteArray(), QByteArray("token"));
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.key().toByteArray(), QByteArray("platform"));
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.value().toByteArray(), QByteArray("say \\\"hi\\\""));
+
+    QVERIFY(reader.next());
+    QCOMPARE(reader.type(), TextVdfReader::ObjectEnd);
+    QCOMPARE(reader.depth(), 0);
+    QVERIFY(!reader.next());
+    QVERIFY(!reader.hasError());
+}
+
+void TestVdf::testTextDecode()
+{
+    QCOMPARE(TextVdfReader::decode("plain"), QStringLiteral("plain"));
+    QCOMPARE(TextVdfReader::decode("say \\\"hi\\\""), QStringLiteral("say \"hi\""));
+    QCOMPARE(TextVdfReader::decode("C:\\\\Games\\tTab\\nLine"), QStringLiteral("C:\\Games\tTab\nLine"));
+    QCOMPARE(TextVdfReader::decode("Caf\xc3\xa9"), QStringLiteral("Café"));
+}
+
+void TestVdf::testTextMalformed()
+{
+    TextVdfReader unclosed(QByteArrayView("\"a\" { \"b\" \"c\""));
+    while (unclosed.next()) {
+    }
+    QVERIFY(unclosed.hasError());
+
+    TextVdfReader stray(QByteArrayView("}"));
+    QVERIFY(!stray.next());
+    QVERIFY(stray.hasError());
+
+    TextVdfReader unterminated(QByteArrayView("\"key\" \"value"));
+    QVERIFY(!unterminated.next());
+    QVERIFY(unterminated.hasError());
+}
+
+void TestVdf::testMappedFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    const QString path = dir.filePath(QStringLiteral("shortcuts.vdf"));
+    QFile out(path);
+    QVERIFY(out.open(QIODevice::WriteOnly));
+    QCOMPARE(out.write(shortcutsVdf()), qint64(shortcutsVdf().size()));
+    out.close();
+
+    {
+        VdfFile file(path);
+        QVERIFY(file.isOpen());
+        QCOMPARE(file.data().toByteArray(), shortcutsVdf());
+        QCOMPARE(SteamConfigManager::parseShortcuts(file.data()).size(), 1);
+    }
+
+    QVERIFY(!VdfFile(dir.filePath(QStringLiteral("missing.vdf"))).isOpen());
+
+    const QString emptyPath = dir.filePath(QStringLiteral("empty.vdf"));
+    QFile empty(emptyPath);
+    QVERIFY(empty.open(QIODevice::WriteOnly));
+    empty.close();
+    VdfFile emptyFile(emptyPath);
+    QVERIFY(emptyFile.isOpen());
+    QVERIFY(emptyFile.data().isEmpty());
+}
+
+void TestVdf::benchmarkParseShortcuts_data()
+{
+    QTest::addColumn<int>("shortcutCount");
+    QTest::newRow("50 shortcuts") << 50;
+    QTest::newRow("1000 shortcuts") << 1000;
+}
+
+void TestVdf::benchmarkParseShortcuts()
+{
+    QFETCH(int, shortcutCount);
+
+    // A library that has been synced from every launcher for years
+    QList<SteamShortcut> shortcuts;
+    for (int i = 0; i < shortcutCount; ++i) {
+        SteamShortcut shortcut;
+        shortcut.appId = 3000000000u + quint32(i);
+        shortcut.appName = QStringLiteral("Game %1").arg(i);
+        shortcut.exe = QStringLiteral("\"/home/player/Games/game-%1/start.sh\"").arg(i);
+        shortcut.startDir = QStringLiteral("\"/home/player/Games/game-%1/\"").arg(i);
+        shortcut.icon = QStringLiteral("/home/player/.local/share/icons/game-%1.png").arg(i);
+        shortcut.launchOptions = QStringLiteral("PROTON_LOG=1 %command% --fullscreen");
+        shortcut.lastPlayTime = 1700000000u + quint32(i);
+        shortcut.tags = {QStringLiteral("favorite"), QStringLiteral("couch")};
+        shortcuts.append(shortcut);
+    }
+    const QByteArray data = SteamConfigManager::serializeShortcuts(shortcuts);
+
+    QList<SteamShortcut> parsed;
+    QBENCHMARK {
+        parsed = SteamConfigManager::parseShortcuts(data);
+    }
+    QCOMPARE(parsed.size(), shortcutCount);
+}
+
+QTEST_MAIN(TestVdf)
+#include "test_vdf.moc"